@@ -122,6 +122,8 @@ OBJS += src/utils/eloop.c
 OBJS += src/utils/common.c
 OBJS += src/utils/wpa_debug.c
 OBJS += src/utils/wpabuf.c
+OBJS += src/utils/heap.c
+OBJS += src/utils/tick_wheel.c
 OBJS += src/utils/os_$(CONFIG_OS).c
 OBJS += src/utils/ip_addr.c
 
@@ -797,6 +799,7 @@ endif
 
 OBJS_c = hostapd_cli.c src/common/wpa_ctrl.c src/utils/os_$(CONFIG_OS).c
 OBJS_c += src/utils/eloop.c
+OBJS_c += src/utils/heap.c
 ifdef CONFIG_WPA_TRACE
 OBJS_c += src/utils/trace.c
 endif
@@ -9,6 +9,7 @@
 #include "utils/includes.h"
 #ifndef CONFIG_NATIVE_WINDOWS
 #include <grp.h>
+#include <sys/stat.h>
 #endif /* CONFIG_NATIVE_WINDOWS */
 
 #include "utils/common.h"
@@ -116,8 +117,36 @@ static int hostapd_acl_comp(const void *a, const void *b)
 }
 
 
+static void hostapd_maclist_file_stat(FILE *f, struct mac_acl_file *file)
+{
+#ifndef CONFIG_NATIVE_WINDOWS
+	struct stat st;
+
+	if (fstat(fileno(f), &st) == 0) {
+		file->mtime = st.st_mtime;
+#ifdef __linux__
+		file->mtime_nsec = st.st_mtim.tv_nsec;
+#else /* __linux__ */
+		/* st_mtim is not available on all platforms; use seconds */
+		file->mtime_nsec = 0;
+#endif /* __linux__ */
+		file->size = st.st_size;
+		file->ino = st.st_ino;
+		return;
+	}
+#endif /* CONFIG_NATIVE_WINDOWS */
+	/* Unknown; make the next reload read the file again */
+	file->mtime = -1;
+	file->mtime_nsec = 0;
+	file->size = -1;
+	file->ino = 0;
+}
+
+
 static int hostapd_config_read_maclist(const char *fname,
-				       struct mac_acl_entry **acl, int *num)
+				       struct mac_acl_entry **acl, int *num,
+				       struct mac_acl_hash **hash,
+				       struct mac_acl_file *file)
 {
 	FILE *f;
 	char buf[128], *pos;
@@ -135,6 +164,16 @@ static int hostapd_config_read_maclist(const char *fname,
 		return -1;
 	}
 
+	/*
+	 * Only a list that was read from a single file can be reloaded
+	 * without losing entries from the other files.
+	 */
+	os_free(file->fname);
+	file->fname = NULL;
+	if (++file->num_files == 1)
+		file->fname = os_strdup(fname);
+	hostapd_maclist_file_stat(f, file);
+
 	while (fgets(buf, sizeof(buf), f)) {
 		line++;
 
@@ -184,10 +223,104 @@ static int hostapd_config_read_maclist(const char *fname,
 
 	qsort(*acl, *num, sizeof(**acl), hostapd_acl_comp);
 
+	/* Fall back to binary search if the hash index cannot be allocated */
+	hostapd_maclist_hash_free(*hash);
+	*hash = hostapd_maclist_hash(*acl, *num);
+
 	return 0;
 }
 
 
+static int hostapd_config_reload_maclist(struct mac_acl_entry **acl,
+					 int *num, struct mac_acl_hash **hash,
+					 struct mac_acl_file *file)
+{
+	struct mac_acl_entry *nacl = NULL;
+	struct mac_acl_hash *nhash = NULL;
+	struct mac_acl_file nfile, cur;
+	int nnum = 0;
+	FILE *f;
+
+	if (file->fname == NULL)
+		return file->num_files ? -1 : 0;
+
+	f = fopen(file->fname, "r");
+	if (f) {
+		hostapd_maclist_file_stat(f, &cur);
+		fclose(f);
+		/*
+		 * A file that was replaced or edited within the same second
+		 * is detected from the inode number and the nanoseconds of
+		 * the modification time.
+		 */
+		if (cur.mtime != -1 && cur.mtime == file->mtime &&
+		    cur.mtime_nsec == file->mtime_nsec &&
+		    cur.size == file->size && cur.ino == file->ino)
+			return 0;
+	}
+
+	os_memset(&nfile, 0, sizeof(nfile));
+	if (hostapd_config_read_maclist(file->fname, &nacl, &nnum, &nhash,
+					&nfile) < 0) {
+		/* Keep using the old list */
+		os_free(nacl);
+		hostapd_maclist_hash_free(nhash);
+		os_free(nfile.fname);
+		return -1;
+	}
+
+	wpa_printf(MSG_DEBUG, "Reloaded MAC list '%s' (%d -> %d entries)",
+		   file->fname, *num, nnum);
+	os_free(*acl);
+	*acl = nacl;
+	*num = nnum;
+	hostapd_maclist_hash_free(*hash);
+	*hash = nhash;
+	os_free(file->fname);
+	*file = nfile;
+
+	return 1;
+}
+
+
+/**
+ * hostapd_config_reload_maclists - Reload changed MAC ACL files
+ * @bss: BSS configuration
+ * @changed: Set to 1 if either list was changed or 0 if not
+ * Returns: 0 on success or -1 if either list could not be reloaded
+ *
+ * Only the accept_mac_file and deny_mac_file that have been modified since
+ * they were last read are parsed again. A list that cannot be read keeps its
+ * old contents; the other list is still reloaded.
+ */
+int hostapd_config_reload_maclists(struct hostapd_bss_config *bss,
+				   int *changed)
+{
+	int res, ret = 0;
+
+	*changed = 0;
+
+	res = hostapd_config_reload_maclist(&bss->accept_mac,
+					    &bss->num_accept_mac,
+					    &bss->accept_mac_hash,
+					    &bss->accept_mac_file);
+	if (res < 0)
+		ret = -1;
+	else if (res > 0)
+		*changed = 1;
+
+	res = hostapd_config_reload_maclist(&bss->deny_mac, &bss->num_deny_mac,
+					    &bss->deny_mac_hash,
+					    &bss->deny_mac_file);
+	if (res < 0)
+		ret = -1;
+	else if (res > 0)
+		*changed = 1;
+
+	return ret;
+}
+
+
 #ifdef EAP_SERVER
 static int hostapd_config_read_eap_user(const char *fname,
 					struct hostapd_bss_config *conf)
@@ -1412,7 +1545,9 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 			}
 		} else if (os_strcmp(buf, "accept_mac_file") == 0) {
 			if (hostapd_config_read_maclist(pos, &bss->accept_mac,
-							&bss->num_accept_mac))
+							&bss->num_accept_mac,
+							&bss->accept_mac_hash,
+							&bss->accept_mac_file))
 			{
 				wpa_printf(MSG_ERROR, "Line %d: Failed to "
 					   "read accept_mac_file '%s'",
@@ -1421,12 +1556,22 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 			}
 		} else if (os_strcmp(buf, "deny_mac_file") == 0) {
 			if (hostapd_config_read_maclist(pos, &bss->deny_mac,
-							&bss->num_deny_mac)) {
+							&bss->num_deny_mac,
+							&bss->deny_mac_hash,
+							&bss->deny_mac_file)) {
 				wpa_printf(MSG_ERROR, "Line %d: Failed to "
 					   "read deny_mac_file '%s'",
 					   line, pos);
 				errors++;
 			}
+		} else if (os_strcmp(buf, "radius_acl_cache_size") == 0) {
+			bss->radius_acl_cache_size = atoi(pos);
+			if (bss->radius_acl_cache_size < 1) {
+				wpa_printf(MSG_ERROR, "Line %d: invalid "
+					   "radius_acl_cache_size %d",
+					   line, bss->radius_acl_cache_size);
+				errors++;
+			}
 		} else if (os_strcmp(buf, "wds_sta") == 0) {
 			bss->wds_sta = atoi(pos);
 		} else if (os_strcmp(buf, "ap_isolate") == 0) {
@@ -1484,6 +1629,31 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		} else if (os_strcmp(buf, "dh_file") == 0) {
 			os_free(bss->dh_file);
 			bss->dh_file = os_strdup(pos);
+		} else if (os_strcmp(buf, "tls_server_threads") == 0) {
+			bss->tls_server_threads = atoi(pos);
+#ifndef CONFIG_EAP_SERVER_TLS_THREADS
+			if (bss->tls_server_threads)
+				wpa_printf(MSG_INFO, "Line %d: TLS worker "
+					   "threads not included in the build "
+					   "(CONFIG_EAP_SERVER_TLS_THREADS)",
+					   line);
+#endif /* CONFIG_EAP_SERVER_TLS_THREADS */
+		} else if (os_strcmp(buf, "dh_pool_size") == 0) {
+			bss->dh_pool_size = atoi(pos);
+			if (bss->dh_pool_size < 0) {
+				wpa_printf(MSG_ERROR, "Line %d: invalid "
+					   "dh_pool_size %d", line,
+					   bss->dh_pool_size);
+				errors++;
+			}
+		} else if (os_strcmp(buf, "dh_pool_reuse") == 0) {
+			bss->dh_pool_reuse = atoi(pos);
+			if (bss->dh_pool_reuse < 1) {
+				wpa_printf(MSG_ERROR, "Line %d: invalid "
+					   "dh_pool_reuse %d", line,
+					   bss->dh_pool_reuse);
+				errors++;
+			}
 		} else if (os_strcmp(buf, "fragment_size") == 0) {
 			bss->fragment_size = atoi(pos);
 #ifdef EAP_SERVER_FAST
@@ -1741,6 +1911,13 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 			bss->wpa = atoi(pos);
 		} else if (os_strcmp(buf, "wpa_group_rekey") == 0) {
 			bss->wpa_group_rekey = atoi(pos);
+		} else if (os_strcmp(buf, "wpa_group_rekey_rate") == 0) {
+			bss->wpa_group_rekey_rate = atoi(pos);
+			if (bss->wpa_group_rekey_rate < 0) {
+				wpa_printf(MSG_ERROR, "Line %d: invalid "
+					   "wpa_group_rekey_rate", line);
+				errors++;
+			}
 		} else if (os_strcmp(buf, "wpa_strict_rekey") == 0) {
 			bss->wpa_strict_rekey = atoi(pos);
 		} else if (os_strcmp(buf, "wpa_gmk_rekey") == 0) {
@@ -1785,6 +1962,14 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 					   "failed", line);
 				errors++;
 			}
+		} else if (os_strcmp(buf, "wpa_psk_cache_file") == 0) {
+			os_free(bss->ssid.wpa_psk_cache_file);
+			bss->ssid.wpa_psk_cache_file = os_strdup(pos);
+			if (!bss->ssid.wpa_psk_cache_file) {
+				wpa_printf(MSG_ERROR, "Line %d: allocation "
+					   "failed", line);
+				errors++;
+			}
 		} else if (os_strcmp(buf, "wpa_key_mgmt") == 0) {
 			bss->wpa_key_mgmt =
 				hostapd_config_parse_key_mgmt(line, pos);
@@ -1921,6 +2106,15 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 			bss->radius_server_auth_port = atoi(pos);
 		} else if (os_strcmp(buf, "radius_server_ipv6") == 0) {
 			bss->radius_server_ipv6 = atoi(pos);
+		} else if (os_strcmp(buf, "radius_server_max_sessions") == 0) {
+			bss->radius_server_max_sessions = atoi(pos);
+			if (bss->radius_server_max_sessions < 0) {
+				wpa_printf(MSG_ERROR, "Line %d: invalid "
+					   "radius_server_max_sessions %d",
+					   line,
+					   bss->radius_server_max_sessions);
+				errors++;
+			}
 #endif /* RADIUS_SERVER */
 		} else if (os_strcmp(buf, "test_socket") == 0) {
 			os_free(bss->test_socket);
@@ -2023,6 +2217,22 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 				conf->preamble = LONG_PREAMBLE;
 		} else if (os_strcmp(buf, "ignore_broadcast_ssid") == 0) {
 			bss->ignore_broadcast_ssid = atoi(pos);
+		} else if (os_strcmp(buf, "probe_req_rate_limit") == 0) {
+			bss->probe_req_rate_limit = atoi(pos);
+			if (bss->probe_req_rate_limit < 0) {
+				wpa_printf(MSG_ERROR, "Line %d: invalid "
+					   "probe_req_rate_limit %d",
+					   line, bss->probe_req_rate_limit);
+				errors++;
+			}
+		} else if (os_strcmp(buf, "probe_req_dedup_window") == 0) {
+			bss->probe_req_dedup_window = atoi(pos);
+			if (bss->probe_req_dedup_window < 0) {
+				wpa_printf(MSG_ERROR, "Line %d: invalid "
+					   "probe_req_dedup_window %d",
+					   line, bss->probe_req_dedup_window);
+				errors++;
+			}
 		} else if (os_strcmp(buf, "wep_default_key") == 0) {
 			bss->ssid.wep.idx = atoi(pos);
 			if (bss->ssid.wep.idx > 3) {
@@ -2059,6 +2269,22 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 			conf->ap_table_max_size = atoi(pos);
 		} else if (os_strcmp(buf, "ap_table_expiration_time") == 0) {
 			conf->ap_table_expiration_time = atoi(pos);
+		} else if (os_strcmp(buf, "state_file") == 0) {
+			os_free(conf->state_file);
+			conf->state_file = os_strdup(pos);
+#ifndef CONFIG_STATE_STORE
+			wpa_printf(MSG_INFO, "Line %d: state store not "
+				   "included in the build (CONFIG_STATE_STORE)",
+				   line);
+#endif /* CONFIG_STATE_STORE */
+		} else if (os_strcmp(buf, "state_file_slots") == 0) {
+			conf->state_file_slots = atoi(pos);
+			if (conf->state_file_slots < 1) {
+				wpa_printf(MSG_ERROR, "Line %d: invalid "
+					   "state_file_slots %d", line,
+					   conf->state_file_slots);
+				errors++;
+			}
 		} else if (os_strncmp(buf, "tx_queue_", 9) == 0) {
 			if (hostapd_config_tx_queue(conf, buf, pos)) {
 				wpa_printf(MSG_ERROR, "Line %d: invalid TX "
@@ -2139,6 +2365,22 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 			bss->disable_pmksa_caching = atoi(pos);
 		} else if (os_strcmp(buf, "okc") == 0) {
 			bss->okc = atoi(pos);
+		} else if (os_strcmp(buf, "pmksa_cache_max_mem") == 0) {
+			int val = atoi(pos);
+			if (val < 0) {
+				wpa_printf(MSG_ERROR, "Line %d: invalid "
+					   "pmksa_cache_max_mem %d", line, val);
+				errors++;
+			} else
+				bss->pmksa_cache_max_mem = val;
+		} else if (os_strcmp(buf, "pmksa_cache_file") == 0) {
+			os_free(bss->pmksa_cache_file);
+			bss->pmksa_cache_file = os_strdup(pos);
+			if (!bss->pmksa_cache_file) {
+				wpa_printf(MSG_ERROR, "Line %d: allocation "
+					   "failed", line);
+				errors++;
+			}
 #ifdef CONFIG_WPS
 		} else if (os_strcmp(buf, "wps_state") == 0) {
 			bss->wps_state = atoi(pos);
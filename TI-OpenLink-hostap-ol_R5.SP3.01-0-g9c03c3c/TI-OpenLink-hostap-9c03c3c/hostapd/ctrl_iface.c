@@ -23,6 +23,7 @@
 #include "common/ieee802_11_defs.h"
 #include "drivers/driver.h"
 #include "radius/radius_client.h"
+#include "eap_server/eap_tls_pool.h"
 #include "ap/hostapd.h"
 #include "ap/ap_config.h"
 #include "ap/ieee802_1x.h"
@@ -749,6 +750,249 @@ static int hostapd_ctrl_iface_get(struct hostapd_data *hapd, char *cmd,
 }
 
 
+static int hostapd_ctrl_iface_reload_acl(struct hostapd_data *hapd)
+{
+	struct hostapd_bss_config *conf = hapd->conf;
+	struct sta_info *sta;
+	int res, changed, removed = 0;
+
+	res = hostapd_config_reload_maclists(conf, &changed);
+	if (!changed)
+		return res;
+
+	/* Only stations that the new lists reject need to be disconnected */
+	for (sta = hapd->sta_list; sta; sta = sta->next) {
+		if (!(sta->flags & (WLAN_STA_AUTH | WLAN_STA_ASSOC)))
+			continue;
+		if (hostapd_maclist_found(conf->accept_mac,
+					  conf->num_accept_mac,
+					  conf->accept_mac_hash, sta->addr,
+					  NULL))
+			continue;
+		if (!hostapd_maclist_found(conf->deny_mac, conf->num_deny_mac,
+					   conf->deny_mac_hash, sta->addr,
+					   NULL) &&
+		    conf->macaddr_acl != DENY_UNLESS_ACCEPTED)
+			continue;
+		wpa_printf(MSG_DEBUG, "RELOAD_ACL: Disconnect " MACSTR,
+			   MAC2STR(sta->addr));
+		ap_sta_disconnect(hapd, sta, sta->addr,
+				  WLAN_REASON_PREV_AUTH_NOT_VALID);
+		removed++;
+	}
+
+	wpa_printf(MSG_DEBUG, "RELOAD_ACL: %d accept / %d deny entries; "
+		   "%d station(s) disconnected", conf->num_accept_mac,
+		   conf->num_deny_mac, removed);
+
+	return res;
+}
+
+
+/* Maximum time in milliseconds for a requester to accept the next chunk of a
+ * queued reply before the rest of the reply is dropped */
+#define CTRL_IFACE_CHUNK_TIMEOUT 1000
+/* Interval in microseconds for retrying to send queued reply chunks */
+#define CTRL_IFACE_RETRY_USEC 10000
+/* Maximum amount of reply data queued for one requester */
+#define CTRL_IFACE_MAX_QUEUED (4 * 1024 * 1024)
+
+/*
+ * Reply chunks that the requester has not yet accepted. A UNIX datagram
+ * socket that is not connected is reported writable even when the receive
+ * queue of the requester is full, so the queued chunks are retried from a
+ * timeout instead of waiting for the control interface socket to become
+ * writable.
+ */
+struct hostapd_ctrl_chunk {
+	struct hostapd_ctrl_chunk *next;
+	size_t len;
+	/* followed by len octets of reply data */
+};
+
+struct hostapd_ctrl_reply {
+	struct hostapd_ctrl_reply *next;
+	struct sockaddr_un addr;
+	socklen_t addrlen;
+	struct hostapd_ctrl_chunk *head, *tail;
+	size_t queued;
+	struct os_reltime progress; /* last time a chunk was accepted */
+};
+
+struct hostapd_ctrl_reply_dst {
+	struct hostapd_data *hapd;
+	struct sockaddr_un *addr;
+	socklen_t addrlen;
+};
+
+
+static void hostapd_ctrl_iface_free_reply(struct hostapd_ctrl_reply *reply)
+{
+	struct hostapd_ctrl_chunk *chunk, *prev;
+
+	chunk = reply->head;
+	while (chunk) {
+		prev = chunk;
+		chunk = chunk->next;
+		os_free(prev);
+	}
+	os_free(reply);
+}
+
+
+static void hostapd_ctrl_iface_del_reply(struct hostapd_data *hapd,
+					 struct hostapd_ctrl_reply *reply)
+{
+	struct hostapd_ctrl_reply *pos, *prev = NULL;
+
+	for (pos = hapd->ctrl_replies; pos; prev = pos, pos = pos->next) {
+		if (pos != reply)
+			continue;
+		if (prev)
+			prev->next = pos->next;
+		else
+			hapd->ctrl_replies = pos->next;
+		break;
+	}
+	hostapd_ctrl_iface_free_reply(reply);
+}
+
+
+/*
+ * Returns 0 if all queued chunks were sent, 1 if the requester did not accept
+ * all of them yet, or -1 if the rest of the reply has to be dropped.
+ */
+static int hostapd_ctrl_iface_flush_reply(struct hostapd_data *hapd,
+					  struct hostapd_ctrl_reply *reply,
+					  struct os_reltime *now)
+{
+	struct hostapd_ctrl_chunk *chunk;
+	struct os_reltime diff;
+
+	while ((chunk = reply->head)) {
+		if (sendto(hapd->ctrl_sock, chunk + 1, chunk->len,
+			   MSG_DONTWAIT, (struct sockaddr *) &reply->addr,
+			   reply->addrlen) < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK &&
+			    errno != ENOBUFS) {
+				wpa_printf(MSG_DEBUG, "CTRL_IFACE: Could not "
+					   "send reply chunk: %s",
+					   strerror(errno));
+				return -1;
+			}
+			os_reltime_sub(now, &reply->progress, &diff);
+			if (diff.sec * 1000 + diff.usec / 1000 >=
+			    CTRL_IFACE_CHUNK_TIMEOUT) {
+				wpa_printf(MSG_DEBUG, "CTRL_IFACE: Requester "
+					   "does not receive the reply - drop "
+					   "%lu queued octets",
+					   (unsigned long) reply->queued);
+				return -1;
+			}
+			return 1;
+		}
+		reply->progress = *now;
+		reply->queued -= chunk->len;
+		reply->head = chunk->next;
+		if (reply->head == NULL)
+			reply->tail = NULL;
+		os_free(chunk);
+	}
+
+	return 0;
+}
+
+
+static void hostapd_ctrl_iface_flush_replies(void *eloop_ctx,
+					     void *timeout_ctx)
+{
+	struct hostapd_data *hapd = eloop_ctx;
+	struct hostapd_ctrl_reply *reply, *next;
+	struct os_reltime now;
+
+	os_get_reltime(&now);
+	for (reply = hapd->ctrl_replies; reply; reply = next) {
+		next = reply->next;
+		if (hostapd_ctrl_iface_flush_reply(hapd, reply, &now) != 1)
+			hostapd_ctrl_iface_del_reply(hapd, reply);
+	}
+
+	if (hapd->ctrl_replies)
+		eloop_register_timeout(0, CTRL_IFACE_RETRY_USEC,
+				       hostapd_ctrl_iface_flush_replies, hapd,
+				       NULL);
+}
+
+
+static int hostapd_ctrl_iface_send_chunk(void *ctx, const char *buf,
+					 size_t len)
+{
+	struct hostapd_ctrl_reply_dst *dst = ctx;
+	struct hostapd_data *hapd = dst->hapd;
+	struct hostapd_ctrl_reply *reply;
+	struct hostapd_ctrl_chunk *chunk;
+
+	for (reply = hapd->ctrl_replies; reply; reply = reply->next) {
+		if (reply->addrlen == dst->addrlen &&
+		    os_memcmp(&reply->addr, dst->addr, dst->addrlen) == 0)
+			break;
+	}
+
+	/*
+	 * The requester receives the earlier chunks while the later ones are
+	 * being generated. If its socket queue is full, the rest of the reply
+	 * is queued here instead of waiting for it in the event loop.
+	 */
+	if (reply == NULL) {
+		if (sendto(hapd->ctrl_sock, buf, len, MSG_DONTWAIT,
+			   (struct sockaddr *) dst->addr, dst->addrlen) >= 0)
+			return 0;
+		if (errno != EAGAIN && errno != EWOULDBLOCK &&
+		    errno != ENOBUFS) {
+			wpa_printf(MSG_DEBUG, "CTRL_IFACE: Could not send "
+				   "reply chunk: %s", strerror(errno));
+			return -1;
+		}
+		reply = os_zalloc(sizeof(*reply));
+		if (reply == NULL)
+			return -1;
+		os_memcpy(&reply->addr, dst->addr, dst->addrlen);
+		reply->addrlen = dst->addrlen;
+		os_get_reltime(&reply->progress);
+		reply->next = hapd->ctrl_replies;
+		hapd->ctrl_replies = reply;
+		if (!eloop_is_timeout_registered(
+			    hostapd_ctrl_iface_flush_replies, hapd, NULL))
+			eloop_register_timeout(
+				0, CTRL_IFACE_RETRY_USEC,
+				hostapd_ctrl_iface_flush_replies, hapd, NULL);
+	}
+
+	if (reply->queued + len > CTRL_IFACE_MAX_QUEUED) {
+		wpa_printf(MSG_DEBUG, "CTRL_IFACE: Too much reply data queued "
+			   "for the requester - drop the reply");
+		hostapd_ctrl_iface_del_reply(hapd, reply);
+		return -1;
+	}
+	chunk = os_malloc(sizeof(*chunk) + len);
+	if (chunk == NULL) {
+		hostapd_ctrl_iface_del_reply(hapd, reply);
+		return -1;
+	}
+	chunk->next = NULL;
+	chunk->len = len;
+	os_memcpy(chunk + 1, buf, len);
+	if (reply->tail)
+		reply->tail->next = chunk;
+	else
+		reply->head = chunk;
+	reply->tail = chunk;
+	reply->queued += len;
+
+	return 0;
+}
+
+
 static void hostapd_ctrl_iface_receive(int sock, void *eloop_ctx,
 				       void *sock_ctx)
 {
@@ -761,6 +1005,7 @@ static void hostapd_ctrl_iface_receive(int sock, void *eloop_ctx,
 	const int reply_size = 4096;
 	int reply_len;
 	int level = MSG_DEBUG;
+	int reply_sent = 0;
 
 	res = recvfrom(sock, buf, sizeof(buf) - 1, 0,
 		       (struct sockaddr *) &from, &fromlen);
@@ -789,6 +1034,9 @@ static void hostapd_ctrl_iface_receive(int sock, void *eloop_ctx,
 	} else if (os_strncmp(buf, "RELOG", 5) == 0) {
 		if (wpa_debug_reopen_file() < 0)
 			reply_len = -1;
+	} else if (os_strcmp(buf, "DEBUG_DUMP") == 0) {
+		if (wpa_debug_ring_dump() < 0)
+			reply_len = -1;
 	} else if (os_strcmp(buf, "MIB") == 0) {
 		reply_len = ieee802_11_get_mib(hapd, reply, reply_size);
 		if (reply_len >= 0) {
@@ -818,6 +1066,12 @@ static void hostapd_ctrl_iface_receive(int sock, void *eloop_ctx,
 				reply_len += res;
 		}
 #endif /* CONFIG_NO_RADIUS */
+#ifdef CONFIG_EAP_SERVER_TLS_THREADS
+		if (reply_len >= 0)
+			reply_len += eap_tls_pool_get_mib(
+				hapd->tls_pool, reply + reply_len,
+				reply_size - reply_len);
+#endif /* CONFIG_EAP_SERVER_TLS_THREADS */
 	} else if (os_strcmp(buf, "STA-FIRST") == 0) {
 		reply_len = hostapd_ctrl_iface_sta_first(hapd, reply,
 							 reply_size);
@@ -827,6 +1081,18 @@ static void hostapd_ctrl_iface_receive(int sock, void *eloop_ctx,
 	} else if (os_strncmp(buf, "STA-NEXT ", 9) == 0) {
 		reply_len = hostapd_ctrl_iface_sta_next(hapd, buf + 9, reply,
 							reply_size);
+	} else if (os_strcmp(buf, "ALL_STA") == 0 ||
+		   os_strncmp(buf, "ALL_STA ", 8) == 0) {
+		struct hostapd_ctrl_reply_dst dst;
+		dst.hapd = hapd;
+		dst.addr = &from;
+		dst.addrlen = fromlen;
+		if (hostapd_ctrl_iface_all_sta(hapd, buf[7] ? buf + 8 : NULL,
+					       hostapd_ctrl_iface_send_chunk,
+					       &dst) < 0)
+			reply_len = -1;
+		else
+			reply_sent = 1;
 	} else if (os_strcmp(buf, "ATTACH") == 0) {
 		if (hostapd_ctrl_iface_attach(hapd, &from, fromlen))
 			reply_len = -1;
@@ -901,6 +1167,9 @@ static void hostapd_ctrl_iface_receive(int sock, void *eloop_ctx,
 	} else if (os_strncmp(buf, "GET ", 4) == 0) {
 		reply_len = hostapd_ctrl_iface_get(hapd, buf + 4, reply,
 						   reply_size);
+	} else if (os_strcmp(buf, "RELOAD_ACL") == 0) {
+		if (hostapd_ctrl_iface_reload_acl(hapd) < 0)
+			reply_len = -1;
 	} else {
 		os_memcpy(reply, "UNKNOWN COMMAND\n", 16);
 		reply_len = 16;
@@ -910,7 +1179,9 @@ static void hostapd_ctrl_iface_receive(int sock, void *eloop_ctx,
 		os_memcpy(reply, "FAIL\n", 5);
 		reply_len = 5;
 	}
-	sendto(sock, reply, reply_len, 0, (struct sockaddr *) &from, fromlen);
+	if (!reply_sent)
+		sendto(sock, reply, reply_len, 0, (struct sockaddr *) &from,
+		       fromlen);
 	os_free(reply);
 }
 
@@ -1073,6 +1344,13 @@ fail:
 void hostapd_ctrl_iface_deinit(struct hostapd_data *hapd)
 {
 	struct wpa_ctrl_dst *dst, *prev;
+	struct hostapd_ctrl_reply *reply;
+
+	eloop_cancel_timeout(hostapd_ctrl_iface_flush_replies, hapd, NULL);
+	while ((reply = hapd->ctrl_replies)) {
+		hapd->ctrl_replies = reply->next;
+		hostapd_ctrl_iface_free_reply(reply);
+	}
 
 	if (hapd->ctrl_sock > -1) {
 		char *fname;
@@ -63,7 +63,8 @@ static const char *commands_help =
 "Commands:\n"
 "   mib                  get MIB variables (dot1x, dot11, radius)\n"
 "   sta <addr>           get MIB variables for one station\n"
-"   all_sta              get MIB variables for all stations\n"
+"   all_sta [generation] get MIB variables for all stations (or stations\n"
+"                        changed since the generation of an earlier reply)\n"
 "   new_sta <addr>       add a new station\n"
 "   deauthenticate <addr>  deauthenticate a station\n"
 "   disassociate <addr>  disassociate a station\n"
@@ -86,9 +87,11 @@ static const char *commands_help =
 "   wps_config <SSID> <auth> <encr> <key>  configure AP\n"
 #endif /* CONFIG_WPS */
 "   get_config           show current configuration\n"
+"   reload_acl           reload modified accept/deny MAC address files\n"
 "   help                 show this usage help\n"
 "   interface [ifname]   show interfaces/select interface\n"
 "   level <debug level>  change debug level\n"
+"   debug_dump           write buffered debug messages to the debug log\n"
 "   license              show full hostapd_cli license\n"
 "   quit                 exit hostapd_cli\n";
 
@@ -225,6 +228,13 @@ static int hostapd_cli_cmd_relog(struct wpa_ctrl *ctrl, int argc, char *argv[])
 }
 
 
+static int hostapd_cli_cmd_debug_dump(struct wpa_ctrl *ctrl, int argc,
+				      char *argv[])
+{
+	return wpa_ctrl_command(ctrl, "DEBUG_DUMP");
+}
+
+
 static int hostapd_cli_cmd_mib(struct wpa_ctrl *ctrl, int argc, char *argv[])
 {
 	return wpa_ctrl_command(ctrl, "MIB");
@@ -615,6 +625,13 @@ static int hostapd_cli_cmd_get_config(struct wpa_ctrl *ctrl, int argc,
 }
 
 
+static int hostapd_cli_cmd_reload_acl(struct wpa_ctrl *ctrl, int argc,
+				      char *argv[])
+{
+	return wpa_ctrl_command(ctrl, "RELOAD_ACL");
+}
+
+
 static int wpa_ctrl_command_sta(struct wpa_ctrl *ctrl, char *cmd,
 				char *addr, size_t addr_len)
 {
@@ -651,8 +668,7 @@ static int wpa_ctrl_command_sta(struct wpa_ctrl *ctrl, char *cmd,
 }
 
 
-static int hostapd_cli_cmd_all_sta(struct wpa_ctrl *ctrl, int argc,
-				   char *argv[])
+static int hostapd_cli_all_sta_iter(struct wpa_ctrl *ctrl)
 {
 	char addr[32], cmd[64];
 
@@ -666,6 +682,110 @@ static int hostapd_cli_cmd_all_sta(struct wpa_ctrl *ctrl, int argc,
 }
 
 
+/* Large enough for any ALL_STA reply chunk from hostapd */
+#define ALL_STA_CHUNK_MAX 65536
+
+static int all_sta_last_chunk(const char *buf, size_t len)
+{
+	const char *pos;
+
+	if (len == 0)
+		return 0;
+	pos = buf + len - 1; /* terminating newline */
+	while (pos > buf && pos[-1] != '\n')
+		pos--;
+	return os_strncmp(pos, "END ", 4) == 0;
+}
+
+
+static int hostapd_cli_cmd_all_sta(struct wpa_ctrl *ctrl, int argc,
+				   char *argv[])
+{
+	char cmd[64], *buf;
+	size_t len;
+	struct timeval tv;
+	fd_set rfds;
+	int ret, fd;
+
+	if (argc > 1) {
+		printf("Invalid 'all_sta' command - only one optional "
+		       "argument (generation) is allowed\n");
+		return -1;
+	}
+	if (ctrl_conn == NULL) {
+		printf("Not connected to hostapd - command dropped.\n");
+		return -1;
+	}
+
+	snprintf(cmd, sizeof(cmd), "ALL_STA%s%s", argc ? " " : "",
+		 argc ? argv[0] : "");
+	buf = os_malloc(ALL_STA_CHUNK_MAX + 1);
+	if (buf == NULL)
+		return -1;
+	len = ALL_STA_CHUNK_MAX;
+	ret = wpa_ctrl_request(ctrl, cmd, os_strlen(cmd), buf, &len,
+			       hostapd_cli_msg_cb);
+	if (ret == -2) {
+		printf("'%s' command timed out.\n", cmd);
+		os_free(buf);
+		return -2;
+	} else if (ret < 0) {
+		printf("'%s' command failed.\n", cmd);
+		os_free(buf);
+		return -1;
+	}
+	buf[len] = '\0';
+
+	if (os_strncmp(buf, "UNKNOWN COMMAND", 15) == 0) {
+		/* Older hostapd; request the stations one by one */
+		os_free(buf);
+		if (argc) {
+			printf("hostapd does not support reporting changed "
+			       "stations\n");
+			return -1;
+		}
+		return hostapd_cli_all_sta_iter(ctrl);
+	}
+	if (os_strncmp(buf, "FAIL", 4) == 0) {
+		printf("%s", buf);
+		os_free(buf);
+		return -1;
+	}
+
+	/* The rest of the reply is received as additional chunks */
+	fd = wpa_ctrl_get_fd(ctrl);
+	for (;;) {
+		if (buf[0] == '<')
+			hostapd_cli_msg_cb(buf, len);
+		else {
+			printf("%s", buf);
+			if (all_sta_last_chunk(buf, len))
+				break;
+		}
+
+		tv.tv_sec = 10;
+		tv.tv_usec = 0;
+		FD_ZERO(&rfds);
+		FD_SET(fd, &rfds);
+		if (select(fd + 1, &rfds, NULL, NULL, &tv) <= 0) {
+			printf("'%s' command timed out.\n", cmd);
+			ret = -2;
+			break;
+		}
+		len = ALL_STA_CHUNK_MAX;
+		if (wpa_ctrl_recv(ctrl, buf, &len) < 0) {
+			printf("'%s' command failed.\n", cmd);
+			ret = -1;
+			break;
+		}
+		buf[len] = '\0';
+	}
+
+	os_free(buf);
+	return ret;
+}
+
+
 static int hostapd_cli_cmd_help(struct wpa_ctrl *ctrl, int argc, char *argv[])
 {
 	printf("%s", commands_help);
@@ -803,6 +923,7 @@ static struct hostapd_cli_cmd hostapd_cli_commands[] = {
 	{ "ping", hostapd_cli_cmd_ping },
 	{ "mib", hostapd_cli_cmd_mib },
 	{ "relog", hostapd_cli_cmd_relog },
+	{ "debug_dump", hostapd_cli_cmd_debug_dump },
 	{ "sta", hostapd_cli_cmd_sta },
 	{ "all_sta", hostapd_cli_cmd_all_sta },
 	{ "new_sta", hostapd_cli_cmd_new_sta },
@@ -829,6 +950,7 @@ static struct hostapd_cli_cmd hostapd_cli_commands[] = {
 #endif /* CONFIG_WPS */
 	{ "ess_disassoc", hostapd_cli_cmd_ess_disassoc },
 	{ "get_config", hostapd_cli_cmd_get_config },
+	{ "reload_acl", hostapd_cli_cmd_reload_acl },
 	{ "help", hostapd_cli_cmd_help },
 	{ "interface", hostapd_cli_cmd_interface },
 	{ "level", hostapd_cli_cmd_level },
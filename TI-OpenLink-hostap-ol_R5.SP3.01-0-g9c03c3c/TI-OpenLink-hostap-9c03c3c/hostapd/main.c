@@ -22,6 +22,7 @@
 #include "ap/hostapd.h"
 #include "ap/ap_config.h"
 #include "ap/ap_drv_ops.h"
+#include "ap/state_store.h"
 #include "config_file.h"
 #include "eap_register.h"
 #include "dump_state.h"
@@ -295,6 +296,10 @@ static void hostapd_interface_deinit_free(struct hostapd_iface *iface)
 	hostapd_interface_deinit(iface);
 	if (driver && driver->hapd_deinit && drv_priv)
 		driver->hapd_deinit(drv_priv);
+#ifdef CONFIG_STATE_STORE
+	state_store_close(iface->state_store);
+	iface->state_store = NULL;
+#endif /* CONFIG_STATE_STORE */
 	hostapd_interface_free(iface);
 }
 
@@ -317,6 +322,19 @@ hostapd_interface_init(struct hapd_interfaces *interfaces,
 			iface->bss[0]->conf->logger_stdout_level--;
 	}
 
+#ifdef CONFIG_STATE_STORE
+	/* Restore state from the previous run before the BSSes are set up */
+	if (iface->conf->state_file) {
+		iface->state_store = state_store_open(
+			iface->conf->state_file, iface->conf->state_file_slots,
+			HOSTAPD_STATE_SLOT_SIZE);
+		if (iface->state_store == NULL) {
+			hostapd_interface_deinit_free(iface);
+			return NULL;
+		}
+	}
+#endif /* CONFIG_STATE_STORE */
+
 	if (iface->conf->bss[0].iface[0] != 0 ||
 	    hostapd_drv_none(iface->bss[0])) {
 		if (hostapd_driver_init(iface) ||
@@ -450,7 +468,7 @@ static void hostapd_global_deinit(const char *pid_file)
 
 
 static int hostapd_global_run(struct hapd_interfaces *ifaces, int daemonize,
-			      const char *pid_file)
+			      const char *pid_file, int ring_size)
 {
 #ifdef EAP_SERVER_TNC
 	int tnc = 0;
@@ -476,6 +494,13 @@ static int hostapd_global_run(struct hapd_interfaces *ifaces, int daemonize,
 		return -1;
 	}
 
+	/* The flusher thread is started only after the fork in os_daemonize() */
+	if (ring_size > 0 &&
+	    wpa_debug_ring_init(ring_size * 1024,
+				wpa_debug_level < MSG_DEBUG ?
+				wpa_debug_level : MSG_DEBUG) < 0)
+		wpa_printf(MSG_ERROR, "Could not enable debug ring buffer");
+
 	eloop_run();
 
 	return 0;
@@ -512,6 +537,10 @@ static void usage(void)
 		"   -f   log output to debug file instead of stdout\n"
 #endif /* CONFIG_DEBUG_FILE */
 		"   -t   include timestamps in some debug messages\n"
+#ifdef CONFIG_DEBUG_RING
+		"   -r   buffer debug messages in a ring buffer of the given "
+		"size (kB)\n"
+#endif /* CONFIG_DEBUG_RING */
 		"   -v   show hostapd version\n");
 
 	exit(1);
@@ -536,12 +565,13 @@ int main(int argc, char *argv[])
 	char *pid_file = NULL;
 	const char *log_file = NULL;
 	const char *entropy_file = NULL;
+	int ring_size = 0;
 
 	if (os_program_init())
 		return -1;
 
 	for (;;) {
-		c = getopt(argc, argv, "Bde:f:hKP:tv");
+		c = getopt(argc, argv, "Bde:f:hKP:r:tv");
 		if (c < 0)
 			break;
 		switch (c) {
@@ -569,6 +599,9 @@ int main(int argc, char *argv[])
 			os_free(pid_file);
 			pid_file = os_rel2abs_path(optarg);
 			break;
+		case 'r':
+			ring_size = atoi(optarg);
+			break;
 		case 't':
 			wpa_debug_timestamp++;
 			break;
@@ -611,7 +644,7 @@ int main(int argc, char *argv[])
 			goto out;
 	}
 
-	if (hostapd_global_run(&interfaces, daemonize, pid_file))
+	if (hostapd_global_run(&interfaces, daemonize, pid_file, ring_size))
 		goto out;
 
 	ret = 0;
@@ -625,6 +658,7 @@ int main(int argc, char *argv[])
 	hostapd_global_deinit(pid_file);
 	os_free(pid_file);
 
+	wpa_debug_ring_deinit();
 	if (log_file)
 		wpa_debug_close_file();
 
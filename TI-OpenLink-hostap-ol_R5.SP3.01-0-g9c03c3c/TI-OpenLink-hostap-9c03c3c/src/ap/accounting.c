@@ -18,6 +18,7 @@
 #include "ap_config.h"
 #include "sta_info.h"
 #include "ap_drv_ops.h"
+#include "state_store.h"
 #include "accounting.h"
 
 
@@ -26,6 +27,47 @@
  * input/output octets and updates Acct-{Input,Output}-Gigawords. */
 #define ACCT_DEFAULT_UPDATE_INTERVAL 300
 
+static int accounting_restore_cb(void *ctx, int slot, const u8 *data,
+				 size_t len)
+{
+	struct hostapd_data *hapd = ctx;
+	u32 prev;
+
+	if (len != 4 || hapd->acct_state_slot)
+		return -1;
+	prev = WPA_GET_BE32(data);
+	if (prev >= hapd->acct_session_id_hi)
+		hapd->acct_session_id_hi = prev + 1;
+	hapd->acct_state_slot = slot + 1;
+	return 0;
+}
+
+
+static void accounting_store_session_id(struct hostapd_data *hapd)
+{
+	struct state_store *store = hapd->iface->state_store;
+	u8 buf[4];
+	int slot;
+
+	if (store == NULL)
+		return;
+
+	if (!hapd->acct_state_slot)
+		state_store_for_each(store, STATE_STORE_ACCT, hapd->own_addr,
+				     accounting_restore_cb, hapd);
+	WPA_PUT_BE32(buf, hapd->acct_session_id_hi);
+	if (hapd->acct_state_slot) {
+		state_store_update(store, hapd->acct_state_slot - 1, buf,
+				   sizeof(buf));
+	} else {
+		slot = state_store_add(store, STATE_STORE_ACCT, hapd->own_addr,
+				       0, buf, sizeof(buf));
+		if (slot >= 0)
+			hapd->acct_state_slot = slot + 1;
+	}
+}
+
+
 static void accounting_sta_get_id(struct hostapd_data *hapd,
 				  struct sta_info *sta);
 
@@ -448,6 +490,7 @@ static void accounting_sta_get_id(struct hostapd_data *hapd,
 	sta->acct_session_id_lo = hapd->acct_session_id_lo++;
 	if (hapd->acct_session_id_lo == 0) {
 		hapd->acct_session_id_hi++;
+		accounting_store_session_id(hapd);
 	}
 	sta->acct_session_id_hi = hapd->acct_session_id_hi;
 }
@@ -520,9 +563,13 @@ int accounting_init(struct hostapd_data *hapd)
 	struct os_time now;
 
 	/* Acct-Session-Id should be unique over reboots. If reliable clock is
-	 * not available, this could be replaced with reboot counter, etc. */
+	 * not available, this could be replaced with reboot counter, etc. With
+	 * a state store, the high part of the previous run is used as a lower
+	 * bound, so the ids stay unique even if the clock has gone backwards.
+	 */
 	os_get_time(&now);
 	hapd->acct_session_id_hi = now.sec;
+	accounting_store_session_id(hapd);
 
 	if (radius_client_register(hapd->radius, RADIUS_ACCT,
 				   accounting_receive, hapd))
@@ -7,8 +7,16 @@
  */
 
 #include "utils/includes.h"
+#ifndef CONFIG_NATIVE_WINDOWS
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif /* CONFIG_NATIVE_WINDOWS */
+#ifdef CONFIG_WPA_PSK_THREADS
+#include <pthread.h>
+#endif /* CONFIG_WPA_PSK_THREADS */
 
 #include "utils/common.h"
+#include "crypto/crypto.h"
 #include "crypto/sha1.h"
 #include "radius/radius_client.h"
 #include "common/ieee802_11_defs.h"
@@ -64,6 +72,7 @@ void hostapd_config_defaults_bss(struct hostapd_bss_config *bss)
 
 	bss->radius_server_auth_port = 1812;
 	bss->ap_max_inactivity = AP_MAX_INACTIVITY;
+	bss->radius_acl_cache_size = 1024;
 	bss->eapol_version = EAPOL_VERSION;
 
 	bss->max_listen_interval = 65535;
@@ -145,6 +154,7 @@ struct hostapd_config * hostapd_config_defaults(void)
 	conf->rts_threshold = -1; /* use driver default: 2347 */
 	conf->fragm_threshold = -1; /* user driver default: 2346 */
 	conf->send_probe_response = 1;
+	conf->state_file_slots = 1024;
 
 	conf->wmm_ac_params[0] = ac_be;
 	conf->wmm_ac_params[1] = ac_bk;
@@ -175,6 +185,324 @@ int hostapd_mac_comp_empty(const void *a)
 }
 
 
+#define WPA_PSK_MAX_THREADS 16
+#define WPA_PSK_BATCH 16 /* passphrases per pbkdf2_sha1_batch() call */
+
+struct hostapd_wpa_psk_index {
+	struct hostapd_wpa_psk **hash; /* per-STA PSKs linked with hnext */
+	unsigned int size; /* number of hash buckets (power of two) */
+	unsigned int count; /* number of per-STA PSKs */
+	struct hostapd_wpa_psk *group; /* wildcard PSKs linked with hnext */
+	struct hostapd_wpa_psk *group_tail;
+};
+
+#define WPA_PSK_HASH(idx, a) ((((a)[4] << 8) | (a)[5]) & ((idx)->size - 1))
+
+
+/* Passphrase from wpa_psk_file that needs to be converted into a PSK */
+struct wpa_psk_pending {
+	struct hostapd_wpa_psk *psk;
+	char *passphrase;
+	u8 key[SHA1_MAC_LEN]; /* SHA1(SSID length | SSID | passphrase) */
+	int failed; /* PSK could not be derived */
+};
+
+/* Entry in wpa_psk_cache_file */
+struct wpa_psk_cache_entry {
+	u8 key[SHA1_MAC_LEN];
+	u8 psk[PMK_LEN];
+};
+
+struct wpa_psk_derive_ctx {
+	const struct hostapd_ssid *ssid;
+	struct wpa_psk_pending **pending;
+	size_t num;
+	size_t next;
+#ifdef CONFIG_WPA_PSK_THREADS
+	int threaded;
+	pthread_mutex_t lock;
+#endif /* CONFIG_WPA_PSK_THREADS */
+};
+
+
+static void hostapd_wpa_psk_cache_key(const struct hostapd_ssid *ssid,
+				      const char *passphrase, u8 *key)
+{
+	u8 ssid_len = ssid->ssid_len;
+	const u8 *addr[3];
+	size_t len[3];
+
+	addr[0] = &ssid_len;
+	len[0] = 1;
+	addr[1] = (const u8 *) ssid->ssid;
+	len[1] = ssid->ssid_len;
+	addr[2] = (const u8 *) passphrase;
+	len[2] = os_strlen(passphrase);
+	sha1_vector(3, addr, len, key);
+}
+
+
+static int hostapd_wpa_psk_cache_comp(const void *a, const void *b)
+{
+	const struct wpa_psk_cache_entry *aa = a;
+	const struct wpa_psk_cache_entry *bb = b;
+	return os_memcmp(aa->key, bb->key, SHA1_MAC_LEN);
+}
+
+
+static struct wpa_psk_cache_entry *
+hostapd_wpa_psk_cache_read(const char *fname, size_t *num)
+{
+	FILE *f;
+	char buf[128];
+	struct wpa_psk_cache_entry *cache = NULL, *n;
+	size_t count = 0, alloc = 0;
+
+	*num = 0;
+	f = fopen(fname, "r");
+	if (f == NULL) {
+		wpa_printf(MSG_DEBUG, "PMK cache file '%s' not available",
+			   fname);
+		return NULL;
+	}
+
+	while (fgets(buf, sizeof(buf), f)) {
+		if (buf[0] == '#')
+			continue;
+		if (count == alloc) {
+			alloc = alloc ? 2 * alloc : 64;
+			n = os_realloc(cache, alloc * sizeof(*cache));
+			if (n == NULL)
+				break;
+			cache = n;
+		}
+		/* <SHA1 key in hex> <PSK in hex> */
+		if (hexstr2bin(buf, cache[count].key, SHA1_MAC_LEN) ||
+		    buf[2 * SHA1_MAC_LEN] != ' ' ||
+		    hexstr2bin(buf + 2 * SHA1_MAC_LEN + 1, cache[count].psk,
+			       PMK_LEN))
+			continue;
+		count++;
+	}
+	fclose(f);
+
+	if (count)
+		qsort(cache, count, sizeof(*cache),
+		      hostapd_wpa_psk_cache_comp);
+	*num = count;
+	return cache;
+}
+
+
+static int hostapd_wpa_psk_cache_write(const char *fname,
+				       struct wpa_psk_pending *pending,
+				       size_t num)
+{
+#ifdef CONFIG_NATIVE_WINDOWS
+	return -1;
+#else /* CONFIG_NATIVE_WINDOWS */
+	char *tmp;
+	size_t len, i;
+	int fd;
+	FILE *f;
+	char hex[2 * PMK_LEN + 1];
+
+	len = os_strlen(fname) + 5;
+	tmp = os_malloc(len);
+	if (tmp == NULL)
+		return -1;
+	os_snprintf(tmp, len, "%s.new", fname);
+
+	/* The cache contains PSKs, so do not make it readable for others */
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	f = fd < 0 ? NULL : fdopen(fd, "w");
+	if (f == NULL) {
+		wpa_printf(MSG_INFO, "Could not write PMK cache file '%s'",
+			   tmp);
+		if (fd >= 0)
+			close(fd);
+		os_free(tmp);
+		return -1;
+	}
+
+	fprintf(f, "# PMK cache for wpa_psk_file (generated by hostapd)\n");
+	for (i = 0; i < num; i++) {
+		if (pending[i].failed)
+			continue;
+		wpa_snprintf_hex(hex, sizeof(hex), pending[i].key,
+				 SHA1_MAC_LEN);
+		fprintf(f, "%s ", hex);
+		wpa_snprintf_hex(hex, sizeof(hex), pending[i].psk->psk,
+				 PMK_LEN);
+		fprintf(f, "%s\n", hex);
+	}
+	os_memset(hex, 0, sizeof(hex));
+
+	if (fclose(f) != 0 || rename(tmp, fname) < 0) {
+		wpa_printf(MSG_INFO, "Could not update PMK cache file '%s': "
+			   "%s", fname, strerror(errno));
+		unlink(tmp);
+		os_free(tmp);
+		return -1;
+	}
+	os_free(tmp);
+
+	return 0;
+#endif /* CONFIG_NATIVE_WINDOWS */
+}
+
+
+static void * hostapd_wpa_psk_derive_worker(void *arg)
+{
+	struct wpa_psk_derive_ctx *ctx = arg;
+	const char *pass[WPA_PSK_BATCH];
+	u8 *buf[WPA_PSK_BATCH];
+	size_t i, n, j;
+
+	for (;;) {
+#ifdef CONFIG_WPA_PSK_THREADS
+		if (ctx->threaded)
+			pthread_mutex_lock(&ctx->lock);
+#endif /* CONFIG_WPA_PSK_THREADS */
+		i = ctx->next;
+		n = ctx->num - i;
+		if (n > WPA_PSK_BATCH)
+			n = WPA_PSK_BATCH;
+		ctx->next += n;
+#ifdef CONFIG_WPA_PSK_THREADS
+		if (ctx->threaded)
+			pthread_mutex_unlock(&ctx->lock);
+#endif /* CONFIG_WPA_PSK_THREADS */
+		if (n == 0)
+			break;
+
+		for (j = 0; j < n; j++) {
+			pass[j] = ctx->pending[i + j]->passphrase;
+			buf[j] = ctx->pending[i + j]->psk->psk;
+		}
+		if (pbkdf2_sha1_batch(pass, ctx->ssid->ssid,
+				      ctx->ssid->ssid_len, 4096, buf, PMK_LEN,
+				      n) < 0) {
+			for (j = 0; j < n; j++) {
+				if (pbkdf2_sha1(pass[j], ctx->ssid->ssid,
+						ctx->ssid->ssid_len, 4096,
+						buf[j], PMK_LEN) < 0)
+					ctx->pending[i + j]->failed = 1;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+ * Derive the PSKs for the passphrases that were not found from the cache.
+ * With CONFIG_WPA_PSK_THREADS, the PBKDF2 operations are distributed over
+ * worker threads (one per online CPU); the calling thread takes part in the
+ * work, so this falls back to serial derivation if no threads can be created.
+ */
+static void hostapd_wpa_psk_derive(const struct hostapd_ssid *ssid,
+				   struct wpa_psk_pending **pending,
+				   size_t num)
+{
+	struct wpa_psk_derive_ctx ctx;
+#ifdef CONFIG_WPA_PSK_THREADS
+	pthread_t tid[WPA_PSK_MAX_THREADS - 1];
+	long cpus;
+	int i, started = 0;
+#endif /* CONFIG_WPA_PSK_THREADS */
+
+	os_memset(&ctx, 0, sizeof(ctx));
+	ctx.ssid = ssid;
+	ctx.pending = pending;
+	ctx.num = num;
+
+#ifdef CONFIG_WPA_PSK_THREADS
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cpus > WPA_PSK_MAX_THREADS)
+		cpus = WPA_PSK_MAX_THREADS;
+	if (cpus > (long) num)
+		cpus = num;
+	if (cpus > 1 && pthread_mutex_init(&ctx.lock, NULL) == 0) {
+		ctx.threaded = 1;
+		for (i = 1; i < cpus; i++) {
+			if (pthread_create(&tid[started], NULL,
+					   hostapd_wpa_psk_derive_worker,
+					   &ctx) == 0)
+				started++;
+		}
+		hostapd_wpa_psk_derive_worker(&ctx);
+		for (i = 0; i < started; i++)
+			pthread_join(tid[i], NULL);
+		pthread_mutex_destroy(&ctx.lock);
+		wpa_printf(MSG_DEBUG, "Derived %lu PSK(s) using %d thread(s)",
+			   (unsigned long) num, started + 1);
+		return;
+	}
+#endif /* CONFIG_WPA_PSK_THREADS */
+
+	hostapd_wpa_psk_derive_worker(&ctx);
+}
+
+
+static void hostapd_wpa_psk_resolve(struct hostapd_ssid *ssid,
+				    struct wpa_psk_pending *pending,
+				    size_t num)
+{
+	struct wpa_psk_cache_entry *cache = NULL, *e, key;
+	struct wpa_psk_pending **miss;
+	size_t num_cache = 0, num_miss = 0, num_cached = 0, i;
+
+	if (num == 0)
+		return;
+
+	miss = os_malloc(num * sizeof(*miss));
+
+	if (ssid->wpa_psk_cache_file)
+		cache = hostapd_wpa_psk_cache_read(ssid->wpa_psk_cache_file,
+						   &num_cache);
+
+	for (i = 0; i < num; i++) {
+		hostapd_wpa_psk_cache_key(ssid, pending[i].passphrase,
+					  pending[i].key);
+		e = NULL;
+		if (cache) {
+			os_memcpy(key.key, pending[i].key, SHA1_MAC_LEN);
+			e = bsearch(&key, cache, num_cache, sizeof(*cache),
+				    hostapd_wpa_psk_cache_comp);
+		}
+		if (e) {
+			os_memcpy(pending[i].psk->psk, e->psk, PMK_LEN);
+			num_cached++;
+		} else if (miss)
+			miss[num_miss++] = &pending[i];
+		else if (pbkdf2_sha1(pending[i].passphrase, ssid->ssid,
+				     ssid->ssid_len, 4096, pending[i].psk->psk,
+				     PMK_LEN) < 0)
+			pending[i].failed = 1;
+	}
+
+	if (num_miss)
+		hostapd_wpa_psk_derive(ssid, miss, num_miss);
+
+	wpa_printf(MSG_DEBUG, "WPA PSK file: %lu passphrase(s), %lu from PMK "
+		   "cache", (unsigned long) num, (unsigned long) num_cached);
+
+	/* Rewrite the cache if it is missing entries or has stale ones */
+	if (ssid->wpa_psk_cache_file &&
+	    (num_cached != num || num_cache != num))
+		hostapd_wpa_psk_cache_write(ssid->wpa_psk_cache_file, pending,
+					    num);
+
+	if (cache) {
+		os_memset(cache, 0, num_cache * sizeof(*cache));
+		os_free(cache);
+	}
+	os_free(miss);
+}
+
+
 static int hostapd_config_read_wpa_psk(const char *fname,
 				       struct hostapd_ssid *ssid)
 {
@@ -182,7 +510,9 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 	char buf[128], *pos;
 	int line = 0, ret = 0, len, ok;
 	u8 addr[ETH_ALEN];
-	struct hostapd_wpa_psk *psk;
+	struct hostapd_wpa_psk *psk, **prev;
+	struct wpa_psk_pending *pending = NULL, *n;
+	size_t num_pending = 0, alloc_pending = 0, i;
 
 	if (!fname)
 		return 0;
@@ -242,8 +572,29 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 		if (len == 64 && hexstr2bin(pos, psk->psk, PMK_LEN) == 0)
 			ok = 1;
 		else if (len >= 8 && len < 64) {
-			pbkdf2_sha1(pos, ssid->ssid, ssid->ssid_len,
-				    4096, psk->psk, PMK_LEN);
+			/* Derived after the whole file has been read */
+			if (num_pending == alloc_pending) {
+				alloc_pending = alloc_pending ?
+					2 * alloc_pending : 16;
+				n = os_realloc(pending, alloc_pending *
+					       sizeof(*pending));
+				if (n == NULL) {
+					os_free(psk);
+					ret = -1;
+					break;
+				}
+				pending = n;
+			}
+			os_memset(&pending[num_pending], 0,
+				  sizeof(*pending));
+			pending[num_pending].psk = psk;
+			pending[num_pending].passphrase = os_strdup(pos);
+			if (pending[num_pending].passphrase == NULL) {
+				os_free(psk);
+				ret = -1;
+				break;
+			}
+			num_pending++;
 			ok = 1;
 		}
 		if (!ok) {
@@ -260,10 +611,135 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 
 	fclose(f);
 
+	/*
+	 * Derive the PSKs even on error since the entries are already in the
+	 * list.
+	 */
+	hostapd_wpa_psk_resolve(ssid, pending, num_pending);
+	for (i = 0; i < num_pending; i++) {
+		if (pending[i].failed) {
+			/* Do not leave an all-zero PSK in the list */
+			psk = pending[i].psk;
+			wpa_printf(MSG_ERROR, "Could not derive PSK for " MACSTR
+				   " from '%s' - entry ignored",
+				   MAC2STR(psk->addr), fname);
+			prev = &ssid->wpa_psk;
+			while (*prev && *prev != psk)
+				prev = &(*prev)->next;
+			if (*prev)
+				*prev = psk->next;
+			os_free(psk);
+		}
+		os_memset(pending[i].passphrase, 0,
+			  os_strlen(pending[i].passphrase));
+		os_free(pending[i].passphrase);
+	}
+	os_free(pending);
+
 	return ret;
 }
 
 
+static void hostapd_wpa_psk_index_insert(struct hostapd_wpa_psk_index *idx,
+					 struct hostapd_wpa_psk *psk, int tail)
+{
+	struct hostapd_wpa_psk **pos;
+
+	if (psk->group) {
+		psk->hnext = NULL;
+		if (!tail) {
+			psk->hnext = idx->group;
+			idx->group = psk;
+			if (idx->group_tail == NULL)
+				idx->group_tail = psk;
+		} else if (idx->group_tail) {
+			idx->group_tail->hnext = psk;
+			idx->group_tail = psk;
+		} else
+			idx->group = idx->group_tail = psk;
+		return;
+	}
+
+	pos = &idx->hash[WPA_PSK_HASH(idx, psk->addr)];
+	if (tail) {
+		while (*pos)
+			pos = &(*pos)->hnext;
+	}
+	psk->hnext = *pos;
+	*pos = psk;
+	idx->count++;
+}
+
+
+static void hostapd_wpa_psk_index_free(struct hostapd_wpa_psk_index *idx)
+{
+	if (idx == NULL)
+		return;
+	os_free(idx->hash);
+	os_free(idx);
+}
+
+
+/*
+ * Build a lookup index for the PSK list so that hostapd_get_psk() only needs
+ * to go through the PSKs for the STA address and the wildcard PSKs. The order
+ * of the PSKs in the list is maintained within both of these groups.
+ */
+static int hostapd_wpa_psk_index_build(struct hostapd_ssid *ssid)
+{
+	struct hostapd_wpa_psk_index *idx;
+	struct hostapd_wpa_psk *psk;
+	unsigned int count = 0;
+
+	hostapd_wpa_psk_index_free(ssid->wpa_psk_index);
+	ssid->wpa_psk_index = NULL;
+
+	for (psk = ssid->wpa_psk; psk; psk = psk->next)
+		count++;
+
+	idx = os_zalloc(sizeof(*idx));
+	if (idx == NULL)
+		return -1;
+	idx->size = 16;
+	while (idx->size < count && idx->size < 65536)
+		idx->size <<= 1;
+	idx->hash = os_zalloc(idx->size * sizeof(*idx->hash));
+	if (idx->hash == NULL) {
+		os_free(idx);
+		return -1;
+	}
+
+	for (psk = ssid->wpa_psk; psk; psk = psk->next)
+		hostapd_wpa_psk_index_insert(idx, psk, 1);
+	ssid->wpa_psk_index = idx;
+
+	return 0;
+}
+
+
+/**
+ * hostapd_add_wpa_psk - Add a PSK to the front of the runtime PSK list
+ * @ssid: SSID configuration
+ * @psk: PSK entry (allocated with os_zalloc(); freed with the configuration)
+ */
+void hostapd_add_wpa_psk(struct hostapd_ssid *ssid, struct hostapd_wpa_psk *psk)
+{
+	struct hostapd_wpa_psk_index *idx = ssid->wpa_psk_index;
+
+	psk->next = ssid->wpa_psk;
+	ssid->wpa_psk = psk;
+
+	if (idx == NULL)
+		return;
+	if (!psk->group && idx->count >= 2 * idx->size) {
+		if (hostapd_wpa_psk_index_build(ssid) < 0)
+			wpa_printf(MSG_DEBUG, "Failed to rebuild PSK index");
+		return;
+	}
+	hostapd_wpa_psk_index_insert(idx, psk, 0);
+}
+
+
 static int hostapd_derive_psk(struct hostapd_ssid *ssid)
 {
 	ssid->wpa_psk = os_zalloc(sizeof(struct hostapd_wpa_psk));
@@ -308,6 +784,10 @@ int hostapd_setup_wpa_psk(struct hostapd_bss_config *conf)
 			return -1;
 	}
 
+	if (hostapd_wpa_psk_index_build(ssid) < 0)
+		wpa_printf(MSG_DEBUG, "Could not build PSK index; using "
+			   "linear search");
+
 	return 0;
 }
 
@@ -395,8 +875,10 @@ static void hostapd_config_free_bss(struct hostapd_bss_config *conf)
 		os_free(prev);
 	}
 
+	hostapd_wpa_psk_index_free(conf->ssid.wpa_psk_index);
 	os_free(conf->ssid.wpa_passphrase);
 	os_free(conf->ssid.wpa_psk_file);
+	os_free(conf->ssid.wpa_psk_cache_file);
 	hostapd_config_free_wep(&conf->ssid.wep);
 #ifdef CONFIG_FULL_DYNAMIC_VLAN
 	os_free(conf->ssid.vlan_tagged_interface);
@@ -412,7 +894,11 @@ static void hostapd_config_free_bss(struct hostapd_bss_config *conf)
 	os_free(conf->dump_log_name);
 	os_free(conf->eap_req_id_text);
 	os_free(conf->accept_mac);
+	hostapd_maclist_hash_free(conf->accept_mac_hash);
+	os_free(conf->accept_mac_file.fname);
 	os_free(conf->deny_mac);
+	hostapd_maclist_hash_free(conf->deny_mac_hash);
+	os_free(conf->deny_mac_file.fname);
 	os_free(conf->nas_identifier);
 	hostapd_config_free_radius(conf->radius->auth_servers,
 				   conf->radius->num_auth_servers);
@@ -421,6 +907,7 @@ static void hostapd_config_free_bss(struct hostapd_bss_config *conf)
 	hostapd_config_free_radius_attr(conf->radius_auth_req_attr);
 	hostapd_config_free_radius_attr(conf->radius_acct_req_attr);
 	os_free(conf->rsn_preauth_interfaces);
+	os_free(conf->pmksa_cache_file);
 	os_free(conf->ctrl_interface);
 	os_free(conf->ca_cert);
 	os_free(conf->server_cert);
@@ -524,26 +1011,115 @@ void hostapd_config_free(struct hostapd_config *conf)
 	os_free(conf->bss);
 	os_free(conf->supported_rates);
 	os_free(conf->basic_rates);
+	os_free(conf->state_file);
 
 	os_free(conf);
 }
 
 
+struct mac_acl_hash {
+	unsigned int bits;
+	int *slot; /* index + 1 to the ACL entry or 0 if the slot is free */
+};
+
+
+static unsigned int mac_acl_hash_idx(const struct mac_acl_hash *hash,
+				     const u8 *addr)
+{
+	u32 val = WPA_GET_BE32(addr + 2) ^ (((u32) addr[0] << 8) | addr[1]);
+	return (val * 2654435761U) >> (32 - hash->bits);
+}
+
+
+/**
+ * hostapd_maclist_hash - Build a hash index for a MAC address list
+ * @list: MAC address list
+ * @num_entries: Number of addresses in the list
+ * Returns: Pointer to the hash index or %NULL on failure
+ *
+ * The index refers to the entries in the list by position, so it needs to be
+ * rebuilt whenever the list is modified. The returned index is freed with
+ * hostapd_maclist_hash_free().
+ */
+struct mac_acl_hash * hostapd_maclist_hash(const struct mac_acl_entry *list,
+					   int num_entries)
+{
+	struct mac_acl_hash *hash;
+	unsigned int i, mask;
+	int j;
+
+	hash = os_zalloc(sizeof(*hash));
+	if (hash == NULL)
+		return NULL;
+
+	/* Keep the load factor at or below 0.5 */
+	hash->bits = 4;
+	while ((1U << hash->bits) < 2 * (unsigned int) num_entries &&
+	       hash->bits < 30)
+		hash->bits++;
+	mask = (1U << hash->bits) - 1;
+	hash->slot = os_zalloc((mask + 1) * sizeof(int));
+	if (hash->slot == NULL) {
+		os_free(hash);
+		return NULL;
+	}
+
+	for (j = 0; j < num_entries; j++) {
+		i = mac_acl_hash_idx(hash, list[j].addr);
+		while (hash->slot[i] &&
+		       os_memcmp(list[hash->slot[i] - 1].addr, list[j].addr,
+				 ETH_ALEN) != 0)
+			i = (i + 1) & mask;
+		if (!hash->slot[i])
+			hash->slot[i] = j + 1;
+	}
+
+	return hash;
+}
+
+
+void hostapd_maclist_hash_free(struct mac_acl_hash *hash)
+{
+	if (hash == NULL)
+		return;
+	os_free(hash->slot);
+	os_free(hash);
+}
+
+
 /**
  * hostapd_maclist_found - Find a MAC address from a list
  * @list: MAC address list
  * @num_entries: Number of addresses in the list
+ * @hash: Hash index from hostapd_maclist_hash() or %NULL if not available
  * @addr: Address to search for
  * @vlan_id: Buffer for returning VLAN ID or %NULL if not needed
  * Returns: 1 if address is in the list or 0 if not.
  *
- * Perform a binary search for given MAC address from a pre-sorted list.
+ * Use the hash index if available. Otherwise, perform a binary search for
+ * given MAC address from a pre-sorted list.
  */
 int hostapd_maclist_found(struct mac_acl_entry *list, int num_entries,
-			  const u8 *addr, int *vlan_id)
+			  struct mac_acl_hash *hash, const u8 *addr,
+			  int *vlan_id)
 {
 	int start, end, middle, res;
 
+	if (hash) {
+		unsigned int i, mask = (1U << hash->bits) - 1;
+
+		for (i = mac_acl_hash_idx(hash, addr); hash->slot[i];
+		     i = (i + 1) & mask) {
+			struct mac_acl_entry *e = &list[hash->slot[i] - 1];
+			if (os_memcmp(e->addr, addr, ETH_ALEN) == 0) {
+				if (vlan_id)
+					*vlan_id = e->vlan_id;
+				return 1;
+			}
+		}
+		return 0;
+	}
+
 	start = 0;
 	end = num_entries - 1;
 
@@ -596,8 +1172,29 @@ const u8 * hostapd_get_psk(const struct hostapd_bss_config *conf,
 			   const u8 *addr, const u8 *prev_psk)
 {
 	struct hostapd_wpa_psk *psk;
+	const struct hostapd_wpa_psk_index *idx = conf->ssid.wpa_psk_index;
 	int next_ok = prev_psk == NULL;
 
+	if (idx) {
+		/* Per-STA PSKs are tried before the wildcard PSKs */
+		for (psk = idx->hash[WPA_PSK_HASH(idx, addr)]; psk;
+		     psk = psk->hnext) {
+			if (os_memcmp(psk->addr, addr, ETH_ALEN) != 0)
+				continue;
+			if (next_ok)
+				return psk->psk;
+			if (psk->psk == prev_psk)
+				next_ok = 1;
+		}
+		for (psk = idx->group; psk; psk = psk->hnext) {
+			if (next_ok)
+				return psk->psk;
+			if (psk->psk == prev_psk)
+				next_ok = 1;
+		}
+		return NULL;
+	}
+
 	for (psk = conf->ssid.wpa_psk; psk != NULL; psk = psk->next) {
 		if (next_ok &&
 		    (psk->group || os_memcmp(psk->addr, addr, ETH_ALEN) == 0))
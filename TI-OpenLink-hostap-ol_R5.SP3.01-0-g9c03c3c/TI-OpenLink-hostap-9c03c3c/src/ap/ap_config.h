@@ -24,6 +24,26 @@ struct mac_acl_entry {
 	int vlan_id;
 };
 
+struct mac_acl_hash;
+
+/**
+ * struct mac_acl_file - MAC ACL file information for reloading the list
+ * @fname: File name or %NULL if the list was not read from a single file
+ * @num_files: Number of files the list was read from
+ * @mtime: Modification time of the file when it was last read
+ * @mtime_nsec: Nanoseconds part of the modification time (0 if not known)
+ * @size: Size of the file when it was last read
+ * @ino: Inode number of the file when it was last read
+ */
+struct mac_acl_file {
+	char *fname;
+	int num_files;
+	long mtime;
+	long mtime_nsec;
+	long size;
+	unsigned long ino;
+};
+
 struct hostapd_radius_servers;
 struct ft_remote_r0kh;
 struct ft_remote_r1kh;
@@ -56,8 +76,10 @@ struct hostapd_ssid {
 	secpolicy security_policy;
 
 	struct hostapd_wpa_psk *wpa_psk;
+	struct hostapd_wpa_psk_index *wpa_psk_index;
 	char *wpa_passphrase;
 	char *wpa_psk_file;
+	char *wpa_psk_cache_file;
 
 	struct hostapd_wep_keys wep;
 
@@ -93,6 +115,7 @@ struct hostapd_vlan {
 #define PMK_LEN 32
 struct hostapd_wpa_psk {
 	struct hostapd_wpa_psk *next;
+	struct hostapd_wpa_psk *hnext; /* next in struct hostapd_wpa_psk_index */
 	int group;
 	u8 psk[PMK_LEN];
 	u8 addr[ETH_ALEN];
@@ -209,8 +232,14 @@ struct hostapd_bss_config {
 	} macaddr_acl;
 	struct mac_acl_entry *accept_mac;
 	int num_accept_mac;
+	struct mac_acl_hash *accept_mac_hash;
+	struct mac_acl_file accept_mac_file;
 	struct mac_acl_entry *deny_mac;
 	int num_deny_mac;
+	struct mac_acl_hash *deny_mac_hash;
+	struct mac_acl_file deny_mac_file;
+	int radius_acl_cache_size; /* maximum number of cached RADIUS ACL
+				    * results */
 	int wds_sta;
 	int isolate;
 
@@ -234,6 +263,7 @@ struct hostapd_bss_config {
 	int wpa_pairwise;
 	int wpa_group;
 	int wpa_group_rekey;
+	int wpa_group_rekey_rate;
 	int wpa_strict_rekey;
 	int wpa_gmk_rekey;
 	int wpa_ptk_rekey;
@@ -266,6 +296,9 @@ struct hostapd_bss_config {
 	char *private_key_passwd;
 	int check_crl;
 	char *dh_file;
+	int tls_server_threads;
+	int dh_pool_size;
+	int dh_pool_reuse;
 	u8 *pac_opaque_encr_key;
 	u8 *eap_fast_a_id;
 	size_t eap_fast_a_id_len;
@@ -281,6 +314,7 @@ struct hostapd_bss_config {
 	char *radius_server_clients;
 	int radius_server_auth_port;
 	int radius_server_ipv6;
+	int radius_server_max_sessions;
 
 	char *test_socket; /* UNIX domain socket path for driver_test */
 
@@ -291,6 +325,8 @@ struct hostapd_bss_config {
 
 	int ap_max_inactivity;
 	int ignore_broadcast_ssid;
+	int probe_req_rate_limit; /* Probe Requests/second per STA; 0 = off */
+	int probe_req_dedup_window; /* in milliseconds; 0 = disabled */
 
 	int wmm_enabled;
 	int wmm_uapsd;
@@ -308,6 +344,8 @@ struct hostapd_bss_config {
 
 	int disable_pmksa_caching;
 	int okc; /* Opportunistic Key Caching */
+	size_t pmksa_cache_max_mem; /* bytes; 0 = no limit */
+	char *pmksa_cache_file;
 
 	int wps_state;
 #ifdef CONFIG_WPS
@@ -423,6 +461,9 @@ struct hostapd_config {
 	int ap_table_max_size;
 	int ap_table_expiration_time;
 
+	char *state_file;
+	int state_file_slots;
+
 	char country[3]; /* first two octets: country code as described in
 			  * ISO/IEC 3166-1. Third octet:
 			  * ' ' (ascii 32): all environments
@@ -462,11 +503,17 @@ int hostapd_mac_comp_empty(const void *a);
 struct hostapd_config * hostapd_config_defaults(void);
 void hostapd_config_defaults_bss(struct hostapd_bss_config *bss);
 void hostapd_config_free(struct hostapd_config *conf);
+struct mac_acl_hash * hostapd_maclist_hash(const struct mac_acl_entry *list,
+					   int num_entries);
+void hostapd_maclist_hash_free(struct mac_acl_hash *hash);
 int hostapd_maclist_found(struct mac_acl_entry *list, int num_entries,
-			  const u8 *addr, int *vlan_id);
+			  struct mac_acl_hash *hash, const u8 *addr,
+			  int *vlan_id);
 int hostapd_rate_found(int *list, int rate);
 int hostapd_wep_key_cmp(struct hostapd_wep_keys *a,
 			struct hostapd_wep_keys *b);
+void hostapd_add_wpa_psk(struct hostapd_ssid *ssid,
+			 struct hostapd_wpa_psk *psk);
 const u8 * hostapd_get_psk(const struct hostapd_bss_config *conf,
 			   const u8 *addr, const u8 *prev_psk);
 int hostapd_setup_wpa_psk(struct hostapd_bss_config *conf);
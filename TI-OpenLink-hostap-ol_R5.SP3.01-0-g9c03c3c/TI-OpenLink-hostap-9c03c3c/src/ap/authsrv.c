@@ -10,10 +10,13 @@
 
 #include "utils/common.h"
 #include "crypto/tls.h"
+#include "crypto/dh_pool.h"
 #include "eap_server/eap.h"
 #include "eap_server/eap_sim_db.h"
+#include "eap_server/eap_tls_pool.h"
 #include "eapol_auth/eapol_auth_sm.h"
 #include "radius/radius_server.h"
+#include "wps/wps_defs.h"
 #include "hostapd.h"
 #include "ap_config.h"
 #include "sta_info.h"
@@ -25,9 +28,9 @@
 #endif /* EAP_SERVER_SIM || EAP_SERVER_AKA */
 
 
-#ifdef EAP_SIM_DB
-static int hostapd_sim_db_cb_sta(struct hostapd_data *hapd,
-				 struct sta_info *sta, void *ctx)
+#if defined(EAP_SIM_DB) || defined(CONFIG_EAP_SERVER_TLS_THREADS)
+static int hostapd_eap_pending_cb_sta(struct hostapd_data *hapd,
+				      struct sta_info *sta, void *ctx)
 {
 	if (eapol_auth_eap_pending_cb(sta->eapol_sm, ctx) == 0)
 		return 1;
@@ -35,16 +38,17 @@ static int hostapd_sim_db_cb_sta(struct hostapd_data *hapd,
 }
 
 
-static void hostapd_sim_db_cb(void *ctx, void *session_ctx)
+static void hostapd_eap_pending_cb(void *ctx, void *session_ctx)
 {
 	struct hostapd_data *hapd = ctx;
-	if (ap_for_each_sta(hapd, hostapd_sim_db_cb_sta, session_ctx) == 0) {
+	if (ap_for_each_sta(hapd, hostapd_eap_pending_cb_sta, session_ctx) ==
+	    0) {
 #ifdef RADIUS_SERVER
 		radius_server_eap_pending_cb(hapd->radius_srv, session_ctx);
 #endif /* RADIUS_SERVER */
 	}
 }
-#endif /* EAP_SIM_DB */
+#endif /* EAP_SIM_DB || CONFIG_EAP_SERVER_TLS_THREADS */
 
 
 #ifdef RADIUS_SERVER
@@ -94,6 +98,7 @@ static int hostapd_setup_radius_srv(struct hostapd_data *hapd)
 	srv.auth_port = conf->radius_server_auth_port;
 	srv.conf_ctx = conf;
 	srv.eap_sim_db_priv = hapd->eap_sim_db_priv;
+	srv.tls_pool = hapd->tls_pool;
 	srv.ssl_ctx = hapd->ssl_ctx;
 	srv.msg_ctx = hapd->msg_ctx;
 	srv.pac_opaque_encr_key = conf->pac_opaque_encr_key;
@@ -107,6 +112,7 @@ static int hostapd_setup_radius_srv(struct hostapd_data *hapd)
 	srv.tnc = conf->tnc;
 	srv.wps = hapd->wps;
 	srv.ipv6 = conf->radius_server_ipv6;
+	srv.max_sessions = conf->radius_server_max_sessions;
 	srv.get_eap_user = hostapd_radius_get_eap_user;
 	srv.eap_req_id_text = conf->eap_req_id_text;
 	srv.eap_req_id_text_len = conf->eap_req_id_text_len;
@@ -161,6 +167,20 @@ int authsrv_init(struct hostapd_data *hapd)
 			authsrv_deinit(hapd);
 			return -1;
 		}
+
+#ifdef CONFIG_EAP_SERVER_TLS_THREADS
+		if (hapd->conf->tls_server_threads) {
+			hapd->tls_pool = eap_tls_pool_init(
+				hapd->conf->tls_server_threads,
+				hostapd_eap_pending_cb, hapd);
+			if (hapd->tls_pool == NULL) {
+				wpa_printf(MSG_ERROR, "Failed to start TLS "
+					   "worker threads");
+				authsrv_deinit(hapd);
+				return -1;
+			}
+		}
+#endif /* CONFIG_EAP_SERVER_TLS_THREADS */
 	}
 #endif /* EAP_TLS_FUNCS */
 
@@ -168,7 +188,7 @@ int authsrv_init(struct hostapd_data *hapd)
 	if (hapd->conf->eap_sim_db) {
 		hapd->eap_sim_db_priv =
 			eap_sim_db_init(hapd->conf->eap_sim_db,
-					hostapd_sim_db_cb, hapd);
+					hostapd_eap_pending_cb, hapd);
 		if (hapd->eap_sim_db_priv == NULL) {
 			wpa_printf(MSG_ERROR, "Failed to initialize EAP-SIM "
 				   "database interface");
@@ -178,6 +198,24 @@ int authsrv_init(struct hostapd_data *hapd)
 	}
 #endif /* EAP_SIM_DB */
 
+#ifdef CONFIG_DH_POOL
+	if (hapd->conf->eap_server && hapd->conf->dh_pool_size) {
+		if (dh_pool_init(hapd->conf->dh_pool_size,
+				 hapd->conf->dh_pool_reuse) < 0) {
+			wpa_printf(MSG_ERROR, "Failed to initialize DH key "
+				   "pair pool");
+			authsrv_deinit(hapd);
+			return -1;
+		}
+		hapd->dh_pool = 1;
+#ifdef CONFIG_WPS
+		/* Other groups are added when they are first used */
+		if (hapd->conf->wps_state)
+			dh_pool_add_group(WPS_DH_GROUP);
+#endif /* CONFIG_WPS */
+	}
+#endif /* CONFIG_DH_POOL */
+
 #ifdef RADIUS_SERVER
 	if (hapd->conf->radius_server_clients &&
 	    hostapd_setup_radius_srv(hapd))
@@ -195,6 +233,12 @@ void authsrv_deinit(struct hostapd_data *hapd)
 	hapd->radius_srv = NULL;
 #endif /* RADIUS_SERVER */
 
+#ifdef CONFIG_EAP_SERVER_TLS_THREADS
+	/* Worker threads may still be using TLS connections */
+	eap_tls_pool_deinit(hapd->tls_pool);
+	hapd->tls_pool = NULL;
+#endif /* CONFIG_EAP_SERVER_TLS_THREADS */
+
 #ifdef EAP_TLS_FUNCS
 	if (hapd->ssl_ctx) {
 		tls_deinit(hapd->ssl_ctx);
@@ -208,4 +252,11 @@ void authsrv_deinit(struct hostapd_data *hapd)
 		hapd->eap_sim_db_priv = NULL;
 	}
 #endif /* EAP_SIM_DB */
+
+#ifdef CONFIG_DH_POOL
+	if (hapd->dh_pool) {
+		dh_pool_deinit();
+		hapd->dh_pool = 0;
+	}
+#endif /* CONFIG_DH_POOL */
 }
@@ -319,6 +319,173 @@ static u8 * hostapd_gen_probe_resp(struct hostapd_data *hapd,
 }
 
 
+/*
+ * Early Probe Request filtering: these checks are done before the full
+ * element parsing so that frames that would not be replied to anyway cost as
+ * little as possible.
+ */
+
+#define PROBE_REQ_SRC_TABLE_SIZE 256
+#define PROBE_REQ_SRC_HASH(a) (((a)[4] ^ (a)[5]) & \
+			       (PROBE_REQ_SRC_TABLE_SIZE - 1))
+
+struct hostapd_probe_req_src {
+	u8 addr[ETH_ALEN];
+	u32 ie_hash;
+	struct os_reltime last_seen;
+	struct os_reltime last_refill;
+	unsigned int tokens;
+};
+
+
+static int hostapd_probe_req_not_for_us(struct hostapd_data *hapd,
+					const struct ieee80211_mgmt *mgmt,
+					const u8 *ie, size_t ie_len)
+{
+	const u8 *pos = ie, *end = ie + ie_len;
+
+	if (!(mgmt->da[0] & 0x01) &&
+	    os_memcmp(mgmt->da, hapd->own_addr, ETH_ALEN) != 0)
+		return 1;
+	if (!is_broadcast_ether_addr(mgmt->bssid) &&
+	    os_memcmp(mgmt->bssid, hapd->own_addr, ETH_ALEN) != 0)
+		return 1;
+
+	/* SSID element is normally the first one, so this is a short loop */
+	while (pos + 2 <= end && pos + 2 + pos[1] <= end) {
+		if (pos[0] != WLAN_EID_SSID) {
+			pos += 2 + pos[1];
+			continue;
+		}
+		if (pos[1] == 0)
+			return !!hapd->conf->ignore_broadcast_ssid;
+		if (pos[1] == hapd->conf->ssid.ssid_len &&
+		    os_memcmp(pos + 2, hapd->conf->ssid.ssid, pos[1]) == 0)
+			return 0;
+#ifdef CONFIG_P2P
+		if ((hapd->conf->p2p & P2P_GROUP_OWNER) &&
+		    pos[1] == P2P_WILDCARD_SSID_LEN &&
+		    os_memcmp(pos + 2, P2P_WILDCARD_SSID,
+			      P2P_WILDCARD_SSID_LEN) == 0)
+			return 0;
+#endif /* CONFIG_P2P */
+		return 1;
+	}
+
+	/* Leave reporting of invalid frames to the full parser */
+	return 0;
+}
+
+
+static unsigned int probe_req_ms_since(struct os_reltime *now,
+				       struct os_reltime *t)
+{
+	struct os_reltime diff;
+
+	os_reltime_sub(now, t, &diff);
+	if (diff.sec < 0)
+		return 0;
+	if (diff.sec > 1000000)
+		return 1000000000;
+	return diff.sec * 1000 + diff.usec / 1000;
+}
+
+
+static int hostapd_probe_req_limit(struct hostapd_data *hapd, const u8 *addr,
+				   const u8 *ie, size_t ie_len)
+{
+	struct hostapd_probe_req_src *src;
+	struct os_reltime now;
+	unsigned int rate = hapd->conf->probe_req_rate_limit;
+	unsigned int window = hapd->conf->probe_req_dedup_window;
+	unsigned int ms, add;
+	u32 hash = 5381;
+	size_t i;
+
+	if (rate == 0 && window == 0)
+		return 0;
+
+	if (hapd->probe_req_src == NULL) {
+		hapd->probe_req_src = os_zalloc(PROBE_REQ_SRC_TABLE_SIZE *
+						sizeof(*hapd->probe_req_src));
+		if (hapd->probe_req_src == NULL)
+			return 0;
+	}
+
+	os_get_reltime(&now);
+	src = &hapd->probe_req_src[PROBE_REQ_SRC_HASH(addr)];
+	if (os_memcmp(src->addr, addr, ETH_ALEN) != 0) {
+		/* Take over the slot from the previous source */
+		os_memset(src, 0, sizeof(*src));
+		os_memcpy(src->addr, addr, ETH_ALEN);
+		src->tokens = rate;
+		src->last_refill = now;
+	}
+
+	if (window) {
+		for (i = 0; i < ie_len; i++)
+			hash = hash * 33 + ie[i];
+		if (src->last_seen.sec && hash == src->ie_hash &&
+		    probe_req_ms_since(&now, &src->last_seen) < window) {
+			hapd->probe_req_dedup++;
+			return 1;
+		}
+	}
+
+	if (rate) {
+		/* Token bucket with a depth of one second worth of frames */
+		ms = probe_req_ms_since(&now, &src->last_refill);
+		add = ms >= 1000 ? rate : ms * rate / 1000;
+		if (add) {
+			src->tokens = src->tokens + add > rate ?
+				rate : src->tokens + add;
+			src->last_refill = now;
+		}
+		if (src->tokens == 0) {
+			hapd->probe_req_rate_limited++;
+			return 1;
+		}
+		src->tokens--;
+	}
+
+	src->ie_hash = hash;
+	src->last_seen = now;
+	return 0;
+}
+
+
+static u8 * hostapd_get_probe_resp(struct hostapd_data *hapd,
+				   struct sta_info *sta,
+				   const struct ieee80211_mgmt *req,
+				   int is_p2p, size_t *resp_len)
+{
+	struct ieee80211_mgmt *resp;
+	int idx = !!is_p2p;
+
+	/*
+	 * The Probe Response contents change only through a Beacon update,
+	 * so build the frame once and only patch the per-request fields.
+	 */
+	if (hapd->probe_resp_tmpl[idx] == NULL) {
+		hapd->probe_resp_tmpl[idx] =
+			hostapd_gen_probe_resp(hapd, NULL, NULL, is_p2p,
+					       &hapd->probe_resp_tmpl_len[idx]);
+		if (hapd->probe_resp_tmpl[idx] == NULL)
+			return NULL;
+		hapd->probe_resp_tmpl_rebuilds++;
+	} else
+		hapd->probe_resp_tmpl_hits++;
+
+	resp = (struct ieee80211_mgmt *) hapd->probe_resp_tmpl[idx];
+	os_memcpy(resp->da, req->sa, ETH_ALEN);
+	resp->u.probe_resp.capab_info =
+		host_to_le16(hostapd_own_capab_info(hapd, sta, 1));
+
+	*resp_len = hapd->probe_resp_tmpl_len[idx];
+	return (u8 *) resp;
+}
+
+
 void handle_probe_req(struct hostapd_data *hapd,
 		      const struct ieee80211_mgmt *mgmt, size_t len,
 		      int ssi_signal)
@@ -345,6 +512,14 @@ void handle_probe_req(struct hostapd_data *hapd,
 	if (!hapd->iconf->send_probe_response)
 		return;
 
+	if (hostapd_probe_req_not_for_us(hapd, mgmt, ie, ie_len)) {
+		hapd->probe_req_filtered++;
+		return;
+	}
+
+	if (hostapd_probe_req_limit(hapd, mgmt->sa, ie, ie_len))
+		return;
+
 	if (ieee802_11_parse_elems(ie, ie_len, &elems, 0) == ParseFailed) {
 		wpa_printf(MSG_DEBUG, "Could not parse ProbeReq from " MACSTR,
 			   MAC2STR(mgmt->sa));
@@ -455,7 +630,7 @@ void handle_probe_req(struct hostapd_data *hapd,
 	/* TODO: verify that supp_rates contains at least one matching rate
 	 * with AP configuration */
 
-	resp = hostapd_gen_probe_resp(hapd, sta, mgmt, elems.p2p != NULL,
+	resp = hostapd_get_probe_resp(hapd, sta, mgmt, elems.p2p != NULL,
 				      &resp_len);
 	if (resp == NULL)
 		return;
@@ -469,8 +644,6 @@ void handle_probe_req(struct hostapd_data *hapd,
 	if (hostapd_drv_send_mlme(hapd, resp, resp_len, noack) < 0)
 		perror("handle_probe_req: send");
 
-	os_free(resp);
-
 	wpa_printf(MSG_EXCESSIVE, "STA " MACSTR " sent probe request for %s "
 		   "SSID", MAC2STR(mgmt->sa),
 		   elems.ssid_len == 0 ? "broadcast" : "our");
@@ -515,6 +688,26 @@ static u8 * hostapd_probe_resp_offloads(struct hostapd_data *hapd,
 #endif /* NEED_AP_MLME */
 
 
+/**
+ * hostapd_free_probe_resp_tmpl - Invalidate cached Probe Response frames
+ * @hapd: Pointer to BSS data
+ *
+ * This needs to be called whenever any of the information used to build the
+ * Probe Response frame changes. ieee802_11_set_beacon() takes care of this
+ * for all Beacon updates.
+ */
+void hostapd_free_probe_resp_tmpl(struct hostapd_data *hapd)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		os_free(hapd->probe_resp_tmpl[i]);
+		hapd->probe_resp_tmpl[i] = NULL;
+		hapd->probe_resp_tmpl_len[i] = 0;
+	}
+}
+
+
 void ieee802_11_set_beacon(struct hostapd_data *hapd)
 {
 	struct ieee80211_mgmt *head = NULL;
@@ -529,6 +722,8 @@ void ieee802_11_set_beacon(struct hostapd_data *hapd)
 	u8 *pos, *tailpos;
 #endif /* NEED_AP_MLME */
 
+	hostapd_free_probe_resp_tmpl(hapd);
+
 	hapd->beacon_set_done = 1;
 
 #ifdef NEED_AP_MLME
@@ -104,6 +104,141 @@ int hostapd_ctrl_iface_sta_next(struct hostapd_data *hapd, const char *txtaddr,
 }
 
 
+/* Maximum length of an ALL_STA reply chunk and of a single STA entry in it */
+#define ALL_STA_CHUNK_SIZE 32768
+#define ALL_STA_MAX_STA_LEN 4096
+
+
+struct all_sta_reply {
+	int (*send_chunk)(void *ctx, const char *buf, size_t len);
+	void *ctx;
+	char *buf;
+	size_t len;
+	int failed;
+};
+
+
+static void all_sta_flush(struct all_sta_reply *r)
+{
+	if (r->len == 0 || r->failed)
+		return;
+	if (r->send_chunk(r->ctx, r->buf, r->len) < 0)
+		r->failed = 1;
+	r->len = 0;
+}
+
+
+static void all_sta_printf(struct all_sta_reply *r, const char *fmt, ...)
+{
+	va_list ap;
+	int ret;
+
+	/* Only used for short lines */
+	if (ALL_STA_CHUNK_SIZE - r->len < 100)
+		all_sta_flush(r);
+	va_start(ap, fmt);
+	ret = vsnprintf(r->buf + r->len, ALL_STA_CHUNK_SIZE - r->len, fmt, ap);
+	va_end(ap);
+	if (ret > 0 && (size_t) ret < ALL_STA_CHUNK_SIZE - r->len)
+		r->len += ret;
+}
+
+
+/**
+ * hostapd_ctrl_iface_all_sta - Report all STAs or STAs changed since a report
+ * @hapd: Pointer to BSS data
+ * @txtgen: Generation from the END line of an earlier reply or %NULL to
+ *	report all STAs
+ * @send_chunk: Callback for sending a part of the reply to the requester
+ * @ctx: Context data for send_chunk
+ * Returns: 0 if the reply was sent or queued by send_chunk (or the requester
+ * stopped receiving it) or -1 on failure before anything was sent
+ *
+ * The reply is sent in as many chunks of up to 32 kB as needed; a STA entry
+ * is never split between chunks. The last line of the last chunk is
+ * "END generation=<generation> stations=<number of STA entries>".
+ *
+ * With a generation, only the STAs that have changed since that reply are
+ * reported, preceded by "REMOVED <addr>" lines for the STAs that have been
+ * removed. If the changes can no longer be determined (e.g., too many STAs
+ * have been removed since), the reply starts with "RESET" and includes all
+ * STAs.
+ */
+int hostapd_ctrl_iface_all_sta(struct hostapd_data *hapd, const char *txtgen,
+			       int (*send_chunk)(void *ctx, const char *buf,
+						 size_t len),
+			       void *ctx)
+{
+	struct all_sta_reply r;
+	struct sta_info *sta;
+	u32 id, since = 0;
+	int delta = 0, count = 0;
+	unsigned int i;
+	char *end;
+
+	if (ap_sta_generation_init(hapd) < 0)
+		return -1;
+
+	if (txtgen) {
+		id = strtoul(txtgen, &end, 16);
+		if (*end != '-')
+			return -1;
+		since = strtoul(end + 1, &end, 10);
+		if (*end != '\0' && *end != '\n')
+			return -1;
+		delta = id == hapd->sta_generation_id &&
+			since <= hapd->sta_generation &&
+			since >= hapd->sta_removed_lost;
+	}
+
+	os_memset(&r, 0, sizeof(r));
+	r.send_chunk = send_chunk;
+	r.ctx = ctx;
+	r.buf = os_malloc(ALL_STA_CHUNK_SIZE);
+	if (r.buf == NULL)
+		return -1;
+
+	if (txtgen && !delta) {
+		wpa_printf(MSG_DEBUG, "ALL_STA: Cannot report changes since "
+			   "generation %s - report all STAs", txtgen);
+		all_sta_printf(&r, "RESET\n");
+	}
+
+	if (delta) {
+		/* Oldest removal first */
+		for (i = 0; i < AP_STA_REMOVED_LOG_SIZE; i++) {
+			struct ap_sta_removal *rem;
+			rem = &hapd->sta_removed[(hapd->sta_removed_next + i) %
+						 AP_STA_REMOVED_LOG_SIZE];
+			if (rem->generation > since)
+				all_sta_printf(&r, "REMOVED " MACSTR "\n",
+					       MAC2STR(rem->addr));
+		}
+	}
+
+	for (sta = hapd->sta_list; sta && !r.failed; sta = sta->next) {
+		ap_sta_update_generation(hapd, sta);
+		if (delta && sta->generation <= since)
+			continue;
+		if (ALL_STA_CHUNK_SIZE - r.len < ALL_STA_MAX_STA_LEN)
+			all_sta_flush(&r);
+		r.len += hostapd_ctrl_iface_sta_mib(hapd, sta, r.buf + r.len,
+						    ALL_STA_MAX_STA_LEN);
+		count++;
+	}
+
+	all_sta_printf(&r, "END generation=%08x-%u stations=%d\n",
+		       hapd->sta_generation_id, hapd->sta_generation, count);
+	all_sta_flush(&r);
+	if (r.failed)
+		wpa_printf(MSG_DEBUG, "ALL_STA: Requester stopped receiving "
+			   "the reply");
+
+	os_free(r.buf);
+	return 0;
+}
+
+
 #ifdef CONFIG_P2P_MANAGER
 static int p2p_manager_disconnect(struct hostapd_data *hapd, u16 stype,
 				  u8 minor_reason_code, const u8 *addr)
@@ -10,6 +10,7 @@
 
 #include "utils/common.h"
 #include "utils/eloop.h"
+#include "utils/tick_wheel.h"
 #include "common/ieee802_11_defs.h"
 #include "radius/radius_client.h"
 #include "radius/radius_das.h"
@@ -27,6 +28,7 @@
 #include "wpa_auth.h"
 #include "wps_hostapd.h"
 #include "hw_features.h"
+#include "state_store.h"
 #include "wpa_auth_glue.h"
 #include "ap_drv_ops.h"
 #include "ap_config.h"
@@ -271,9 +273,16 @@ static void hostapd_free_hapd_data(struct hostapd_data *hapd)
 
 	wpabuf_free(hapd->time_adv);
 
+	hostapd_free_probe_resp_tmpl(hapd);
+	os_free(hapd->probe_req_src);
+	hapd->probe_req_src = NULL;
+
 #ifdef CONFIG_INTERWORKING
 	gas_serv_deinit(hapd);
 #endif /* CONFIG_INTERWORKING */
+
+	tick_wheel_deinit(hapd->tick_wheel);
+	hapd->tick_wheel = NULL;
 }
 
 
@@ -746,6 +755,10 @@ static int hostapd_setup_bss(struct hostapd_data *hapd, int first)
 	if (authsrv_init(hapd) < 0)
 		return -1;
 
+	hapd->tick_wheel = tick_wheel_init();
+	if (hapd->tick_wheel == NULL)
+		return -1;
+
 	if (ieee802_1x_init(hapd)) {
 		wpa_printf(MSG_ERROR, "IEEE 802.1X initialization failed.");
 		return -1;
@@ -953,6 +966,9 @@ int hostapd_setup_interface_complete(struct hostapd_iface *iface, int err)
 			return -1;
 	}
 
+	/* All BSSes have restored their records; drop the ones left over */
+	state_store_gc(iface->state_store);
+
 	if (hapd->setup_complete_cb)
 		hapd->setup_complete_cb(hapd->setup_complete_cb_ctx);
 
@@ -1102,9 +1118,7 @@ void hostapd_new_assoc_sta(struct hostapd_data *hapd, struct sta_info *sta,
 		   "for " MACSTR " (%d seconds - ap_max_inactivity)",
 		   __func__, MAC2STR(sta->addr),
 		   hapd->conf->ap_max_inactivity);
-	eloop_cancel_timeout(ap_handle_timer, hapd, sta);
-	eloop_register_timeout(hapd->conf->ap_max_inactivity, 0,
-			       ap_handle_timer, hapd, sta);
+	ap_sta_set_timer(hapd, sta, hapd->conf->ap_max_inactivity);
 }
 
 struct
@@ -13,13 +13,19 @@
 
 struct wpa_driver_ops;
 struct wpa_ctrl_dst;
+struct hostapd_ctrl_reply;
 struct radius_server_data;
+struct eap_tls_pool;
 struct upnp_wps_device_sm;
 struct hostapd_data;
 struct sta_info;
 struct hostap_sta_driver_data;
 struct ieee80211_ht_capabilities;
 struct full_dynamic_vlan;
+struct hostapd_sta_vlan;
+struct hostapd_probe_req_src;
+struct state_store;
+struct tick_wheel;
 enum wps_event;
 union wps_event_data;
 
@@ -65,7 +71,14 @@ struct hostapd_data {
 	struct sta_info *sta_list; /* STA info list head */
 #define STA_HASH_SIZE 256
 #define STA_HASH(sta) (sta[5])
-	struct sta_info *sta_hash[STA_HASH_SIZE];
+	/*
+	 * STA hash table with sta_hash_size (power of two) buckets. This
+	 * starts with STA_HASH_SIZE buckets and is grown as STAs are added.
+	 */
+	struct sta_info **sta_hash;
+	unsigned int sta_hash_size;
+	/* Lists of STAs per VLAN ID */
+	struct hostapd_sta_vlan *sta_vlans;
 
 	/*
 	 * Bitfield for indicating which AIDs are allocated. Only AID values
@@ -75,6 +88,20 @@ struct hostapd_data {
 #define AID_WORDS ((2008 + 31) / 32)
 	u32 sta_aid[AID_WORDS];
 
+	/*
+	 * Station change tracking for the ALL_STA control interface command.
+	 * Generations are assigned to STA entries and to removed STAs (in the
+	 * sta_removed ring) only after the first ALL_STA command.
+	 */
+	u32 sta_generation; /* last assigned generation */
+	u32 sta_generation_id; /* random value identifying this sequence */
+	struct ap_sta_removal *sta_removed;
+	unsigned int sta_removed_next; /* next entry to be used */
+	u32 sta_removed_lost; /* newest generation dropped from the ring */
+
+	/* One second timers of the STAs (EAPOL port timers, inactivity) */
+	struct tick_wheel *tick_wheel;
+
 	const struct wpa_driver_ops *driver;
 	void *drv_priv;
 
@@ -86,11 +113,12 @@ struct hostapd_data {
 
 	struct radius_client_data *radius;
 	u32 acct_session_id_hi, acct_session_id_lo;
+	int acct_state_slot; /* slot in the state store plus one */
 	struct radius_das_data *radius_das;
 
 	struct iapp_data *iapp;
 
-	struct hostapd_cached_radius_acl *acl_cache;
+	struct hostapd_acl_cache *acl_cache;
 	struct hostapd_acl_query_data *acl_queries;
 
 	struct wpa_authenticator *wpa_auth;
@@ -103,9 +131,12 @@ struct hostapd_data {
 
 	int ctrl_sock;
 	struct wpa_ctrl_dst *ctrl_dst;
+	struct hostapd_ctrl_reply *ctrl_replies; /* queued reply chunks */
 
 	void *ssl_ctx;
 	void *eap_sim_db_priv;
+	struct eap_tls_pool *tls_pool;
+	int dh_pool; /* registered as a user of the DH key pair pool */
 	struct radius_server_data *radius_srv;
 
 	int parameter_set_count;
@@ -125,8 +156,23 @@ struct hostapd_data {
 	struct wpabuf *wps_beacon_ie;
 	struct wpabuf *wps_probe_resp_ie;
 
+	/*
+	 * Probe Response frames built on the first Probe Request after a
+	 * Beacon update (index 1 is used for the P2P variant)
+	 */
+	u8 *probe_resp_tmpl[2];
+	size_t probe_resp_tmpl_len[2];
+	unsigned int probe_resp_tmpl_hits;
+	unsigned int probe_resp_tmpl_rebuilds;
+
+	/* Per-source Probe Request rate limiting and duplicate detection */
+	struct hostapd_probe_req_src *probe_req_src;
+	unsigned int probe_req_filtered;
+	unsigned int probe_req_rate_limited;
+	unsigned int probe_req_dedup;
+
 	struct wpabuf *pending_eapol_rx;
-	struct os_time pending_eapol_rx_time;
+	struct os_reltime pending_eapol_rx_time;
 	u8 pending_eapol_rx_src[ETH_ALEN];
 
 #ifdef CONFIG_WPS
@@ -194,6 +240,7 @@ struct hostapd_iface {
 	struct hostapd_config * (*config_read_cb)(const char *config_fname);
 	char *config_fname;
 	struct hostapd_config *conf;
+	struct state_store *state_store;
 
 	size_t num_bss;
 	struct hostapd_data **bss;
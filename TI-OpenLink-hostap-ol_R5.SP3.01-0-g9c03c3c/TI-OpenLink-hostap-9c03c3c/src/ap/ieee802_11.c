@@ -1187,9 +1187,7 @@ static void handle_disassoc(struct hostapd_data *hapd,
 	if (sta->timeout_next == STA_NULLFUNC ||
 	    sta->timeout_next == STA_DISASSOC) {
 		sta->timeout_next = STA_DEAUTH;
-		eloop_cancel_timeout(ap_handle_timer, hapd, sta);
-		eloop_register_timeout(AP_DEAUTH_DELAY, 0, ap_handle_timer,
-				       hapd, sta);
+		ap_sta_set_timer(hapd, sta, AP_DEAUTH_DELAY);
 	}
 
 	mlme_disassociate_indication(
@@ -1624,9 +1622,9 @@ static void handle_assoc_cb(struct hostapd_data *hapd,
 	ieee802_1x_notify_port_enabled(sta->eapol_sm, 1);
 
 	if (hapd->pending_eapol_rx) {
-		struct os_time now, age;
-		os_get_time(&now);
-		os_time_sub(&now, &hapd->pending_eapol_rx_time, &age);
+		struct os_reltime now, age;
+		os_get_reltime(&now);
+		os_reltime_sub(&now, &hapd->pending_eapol_rx_time, &age);
 		if (age.sec == 0 && /*age.usec < 100000 &&*/
 		    os_memcmp(hapd->pending_eapol_rx_src,
 			      mgmt->da, ETH_ALEN) == 0) {
@@ -1750,8 +1748,22 @@ void ieee802_11_mgmt_cb(struct hostapd_data *hapd, const u8 *buf, size_t len,
 
 int ieee802_11_get_mib(struct hostapd_data *hapd, char *buf, size_t buflen)
 {
-	/* TODO */
-	return 0;
+	int ret;
+
+	ret = os_snprintf(buf, buflen,
+			  "probeRespTemplateHits=%u\n"
+			  "probeRespTemplateRebuilds=%u\n"
+			  "probeReqFiltered=%u\n"
+			  "probeReqRateLimited=%u\n"
+			  "probeReqDuplicates=%u\n",
+			  hapd->probe_resp_tmpl_hits,
+			  hapd->probe_resp_tmpl_rebuilds,
+			  hapd->probe_req_filtered,
+			  hapd->probe_req_rate_limited,
+			  hapd->probe_req_dedup);
+	if (ret < 0 || (size_t) ret >= buflen)
+		return 0;
+	return ret;
 }
 
 
@@ -15,6 +15,7 @@
 
 #include "utils/common.h"
 #include "utils/eloop.h"
+#include "utils/list.h"
 #include "crypto/sha1.h"
 #include "radius/radius.h"
 #include "radius/radius_client.h"
@@ -25,13 +26,16 @@
 #include "ieee802_11_auth.h"
 
 #define RADIUS_ACL_TIMEOUT 30
+#define RADIUS_ACL_HASH_SIZE 256
+#define RADIUS_ACL_HASH(addr) ((addr)[4] ^ (addr)[5])
 
 
 struct hostapd_cached_radius_acl {
 	os_time_t timestamp;
 	macaddr addr;
 	int accepted; /* HOSTAPD_ACL_* */
-	struct hostapd_cached_radius_acl *next;
+	struct dl_list list; /* in order of insertion; oldest first */
+	struct hostapd_cached_radius_acl *hnext; /* next entry in hash list */
 	u32 session_timeout;
 	u32 acct_interim_interval;
 	int vlan_id;
@@ -50,16 +54,102 @@ struct hostapd_acl_query_data {
 };
 
 
+/**
+ * struct hostapd_acl_cache - Cache of RADIUS ACL query results
+ *
+ * Entries are kept both in a hash table for lookups and in a list in the
+ * order they were added. Since all entries have the same lifetime, the oldest
+ * entry is always the first one to expire and the first one to be dropped
+ * when the cache is full.
+ */
+struct hostapd_acl_cache {
+	struct dl_list list;
+	struct hostapd_cached_radius_acl *hash[RADIUS_ACL_HASH_SIZE];
+	unsigned int count;
+};
+
+
 #ifndef CONFIG_NO_RADIUS
-static void hostapd_acl_cache_free(struct hostapd_cached_radius_acl *acl_cache)
+static void hostapd_acl_cache_free(struct hostapd_acl_cache *acl_cache)
 {
-	struct hostapd_cached_radius_acl *prev;
+	struct hostapd_cached_radius_acl *entry, *prev;
+
+	if (acl_cache == NULL)
+		return;
+
+	dl_list_for_each_safe(entry, prev, &acl_cache->list,
+			      struct hostapd_cached_radius_acl, list)
+		os_free(entry);
+	os_free(acl_cache);
+}
+
+
+static struct hostapd_cached_radius_acl *
+hostapd_acl_cache_find(struct hostapd_acl_cache *acl_cache, const u8 *addr)
+{
+	struct hostapd_cached_radius_acl *entry;
+
+	if (acl_cache == NULL)
+		return NULL;
 
-	while (acl_cache) {
-		prev = acl_cache;
-		acl_cache = acl_cache->next;
-		os_free(prev);
+	entry = acl_cache->hash[RADIUS_ACL_HASH(addr)];
+	while (entry && os_memcmp(entry->addr, addr, ETH_ALEN) != 0)
+		entry = entry->hnext;
+	return entry;
+}
+
+
+static void hostapd_acl_cache_del(struct hostapd_acl_cache *acl_cache,
+				  struct hostapd_cached_radius_acl *entry)
+{
+	struct hostapd_cached_radius_acl **pos;
+
+	pos = &acl_cache->hash[RADIUS_ACL_HASH(entry->addr)];
+	while (*pos && *pos != entry)
+		pos = &(*pos)->hnext;
+	if (*pos)
+		*pos = entry->hnext;
+	dl_list_del(&entry->list);
+	acl_cache->count--;
+	os_free(entry);
+}
+
+
+static int hostapd_acl_cache_add(struct hostapd_data *hapd,
+				 struct hostapd_cached_radius_acl *entry)
+{
+	struct hostapd_acl_cache *acl_cache = hapd->acl_cache;
+	struct hostapd_cached_radius_acl *old;
+	unsigned int max = hapd->conf->radius_acl_cache_size;
+
+	if (acl_cache == NULL) {
+		acl_cache = os_zalloc(sizeof(*acl_cache));
+		if (acl_cache == NULL)
+			return -1;
+		dl_list_init(&acl_cache->list);
+		hapd->acl_cache = acl_cache;
+	}
+
+	/* Replace an expired or stale result for the same station */
+	old = hostapd_acl_cache_find(acl_cache, entry->addr);
+	if (old)
+		hostapd_acl_cache_del(acl_cache, old);
+
+	while (acl_cache->count >= max && !dl_list_empty(&acl_cache->list)) {
+		old = dl_list_first(&acl_cache->list,
+				    struct hostapd_cached_radius_acl, list);
+		wpa_printf(MSG_DEBUG, "ACL cache full - dropping entry for "
+			   MACSTR, MAC2STR(old->addr));
+		hostapd_drv_set_radius_acl_expire(hapd, old->addr);
+		hostapd_acl_cache_del(acl_cache, old);
 	}
+
+	entry->hnext = acl_cache->hash[RADIUS_ACL_HASH(entry->addr)];
+	acl_cache->hash[RADIUS_ACL_HASH(entry->addr)] = entry;
+	dl_list_add_tail(&acl_cache->list, &entry->list);
+	acl_cache->count++;
+
+	return 0;
 }
 
 
@@ -69,35 +159,27 @@ static int hostapd_acl_cache_get(struct hostapd_data *hapd, const u8 *addr,
 				 u8 *psk, int *has_psk)
 {
 	struct hostapd_cached_radius_acl *entry;
-	struct os_time now;
-
-	os_get_time(&now);
-	entry = hapd->acl_cache;
+	struct os_reltime now;
 
-	while (entry) {
-		if (os_memcmp(entry->addr, addr, ETH_ALEN) == 0) {
-			if (now.sec - entry->timestamp > RADIUS_ACL_TIMEOUT)
-				return -1; /* entry has expired */
-			if (entry->accepted == HOSTAPD_ACL_ACCEPT_TIMEOUT)
-				if (session_timeout)
-					*session_timeout =
-						entry->session_timeout;
-			if (acct_interim_interval)
-				*acct_interim_interval =
-					entry->acct_interim_interval;
-			if (vlan_id)
-				*vlan_id = entry->vlan_id;
-			if (psk)
-				os_memcpy(psk, entry->psk, PMK_LEN);
-			if (has_psk)
-				*has_psk = entry->has_psk;
-			return entry->accepted;
-		}
-
-		entry = entry->next;
-	}
+	os_get_reltime(&now);
+	entry = hostapd_acl_cache_find(hapd->acl_cache, addr);
+	if (entry == NULL)
+		return -1;
 
-	return -1;
+	if (now.sec - entry->timestamp > RADIUS_ACL_TIMEOUT)
+		return -1; /* entry has expired */
+	if (entry->accepted == HOSTAPD_ACL_ACCEPT_TIMEOUT)
+		if (session_timeout)
+			*session_timeout = entry->session_timeout;
+	if (acct_interim_interval)
+		*acct_interim_interval = entry->acct_interim_interval;
+	if (vlan_id)
+		*vlan_id = entry->vlan_id;
+	if (psk)
+		os_memcpy(psk, entry->psk, PMK_LEN);
+	if (has_psk)
+		*has_psk = entry->has_psk;
+	return entry->accepted;
 }
 #endif /* CONFIG_NO_RADIUS */
 
@@ -234,11 +316,13 @@ int hostapd_allowed_address(struct hostapd_data *hapd, const u8 *addr,
 		os_memset(psk, 0, PMK_LEN);
 
 	if (hostapd_maclist_found(hapd->conf->accept_mac,
-				  hapd->conf->num_accept_mac, addr, vlan_id))
+				  hapd->conf->num_accept_mac,
+				  hapd->conf->accept_mac_hash, addr, vlan_id))
 		return HOSTAPD_ACL_ACCEPT;
 
 	if (hostapd_maclist_found(hapd->conf->deny_mac,
-				  hapd->conf->num_deny_mac, addr, vlan_id))
+				  hapd->conf->num_deny_mac,
+				  hapd->conf->deny_mac_hash, addr, vlan_id))
 		return HOSTAPD_ACL_REJECT;
 
 	if (hapd->conf->macaddr_acl == ACCEPT_UNLESS_DENIED)
@@ -251,7 +335,7 @@ int hostapd_allowed_address(struct hostapd_data *hapd, const u8 *addr,
 		return HOSTAPD_ACL_REJECT;
 #else /* CONFIG_NO_RADIUS */
 		struct hostapd_acl_query_data *query;
-		struct os_time t;
+		struct os_reltime t;
 
 		/* Check whether ACL cache has an entry for this station */
 		int res = hostapd_acl_cache_get(hapd, addr, session_timeout,
@@ -282,7 +366,7 @@ int hostapd_allowed_address(struct hostapd_data *hapd, const u8 *addr,
 			wpa_printf(MSG_ERROR, "malloc for query data failed");
 			return HOSTAPD_ACL_REJECT;
 		}
-		os_get_time(&t);
+		os_get_reltime(&t);
 		query->timestamp = t.sec;
 		os_memcpy(query->addr, addr, ETH_ALEN);
 		if (hostapd_radius_acl_query(hapd, addr, query)) {
@@ -317,28 +401,19 @@ int hostapd_allowed_address(struct hostapd_data *hapd, const u8 *addr,
 #ifndef CONFIG_NO_RADIUS
 static void hostapd_acl_expire_cache(struct hostapd_data *hapd, os_time_t now)
 {
-	struct hostapd_cached_radius_acl *prev, *entry, *tmp;
+	struct hostapd_cached_radius_acl *entry, *tmp;
 
-	prev = NULL;
-	entry = hapd->acl_cache;
-
-	while (entry) {
-		if (now - entry->timestamp > RADIUS_ACL_TIMEOUT) {
-			wpa_printf(MSG_DEBUG, "Cached ACL entry for " MACSTR
-				   " has expired.", MAC2STR(entry->addr));
-			if (prev)
-				prev->next = entry->next;
-			else
-				hapd->acl_cache = entry->next;
-			hostapd_drv_set_radius_acl_expire(hapd, entry->addr);
-			tmp = entry;
-			entry = entry->next;
-			os_free(tmp);
-			continue;
-		}
+	if (hapd->acl_cache == NULL)
+		return;
 
-		prev = entry;
-		entry = entry->next;
+	dl_list_for_each_safe(entry, tmp, &hapd->acl_cache->list,
+			      struct hostapd_cached_radius_acl, list) {
+		if (now - entry->timestamp <= RADIUS_ACL_TIMEOUT)
+			break; /* all the following entries are newer */
+		wpa_printf(MSG_DEBUG, "Cached ACL entry for " MACSTR
+			   " has expired.", MAC2STR(entry->addr));
+		hostapd_drv_set_radius_acl_expire(hapd, entry->addr);
+		hostapd_acl_cache_del(hapd->acl_cache, entry);
 	}
 }
 
@@ -380,9 +455,9 @@ static void hostapd_acl_expire_queries(struct hostapd_data *hapd,
 static void hostapd_acl_expire(void *eloop_ctx, void *timeout_ctx)
 {
 	struct hostapd_data *hapd = eloop_ctx;
-	struct os_time now;
+	struct os_reltime now;
 
-	os_get_time(&now);
+	os_get_reltime(&now);
 	hostapd_acl_expire_cache(hapd, now.sec);
 	hostapd_acl_expire_queries(hapd, now.sec);
 
@@ -409,7 +484,7 @@ hostapd_acl_recv_radius(struct radius_msg *msg, struct radius_msg *req,
 	struct hostapd_acl_query_data *query, *prev;
 	struct hostapd_cached_radius_acl *cache;
 	struct radius_hdr *hdr = radius_msg_get_hdr(msg);
-	struct os_time t;
+	struct os_reltime t;
 
 	query = hapd->acl_queries;
 	prev = NULL;
@@ -444,7 +519,7 @@ hostapd_acl_recv_radius(struct radius_msg *msg, struct radius_msg *req,
 		wpa_printf(MSG_DEBUG, "Failed to add ACL cache entry");
 		goto done;
 	}
-	os_get_time(&t);
+	os_get_reltime(&t);
 	cache->timestamp = t.sec;
 	os_memcpy(cache->addr, query->addr, sizeof(cache->addr));
 	if (hdr->code == RADIUS_CODE_ACCESS_ACCEPT) {
@@ -497,8 +572,11 @@ hostapd_acl_recv_radius(struct radius_msg *msg, struct radius_msg *req,
 			cache->accepted = HOSTAPD_ACL_REJECT;
 	} else
 		cache->accepted = HOSTAPD_ACL_REJECT;
-	cache->next = hapd->acl_cache;
-	hapd->acl_cache = cache;
+	if (hostapd_acl_cache_add(hapd, cache) < 0) {
+		wpa_printf(MSG_DEBUG, "Failed to add ACL cache entry");
+		os_free(cache);
+		goto done;
+	}
 
 #ifdef CONFIG_DRIVER_RADIUS_ACL
 	hostapd_drv_set_radius_acl_auth(hapd, query->addr, cache->accepted,
@@ -556,6 +634,7 @@ void hostapd_acl_deinit(struct hostapd_data *hapd)
 	eloop_cancel_timeout(hostapd_acl_expire, hapd, NULL);
 
 	hostapd_acl_cache_free(hapd->acl_cache);
+	hapd->acl_cache = NULL;
 #endif /* CONFIG_NO_RADIUS */
 
 	query = hapd->acl_queries;
@@ -732,7 +732,7 @@ void ieee802_1x_receive(struct hostapd_data *hapd, const u8 *sa, const u8 *buf,
 			wpabuf_free(hapd->pending_eapol_rx);
 			hapd->pending_eapol_rx = wpabuf_alloc_copy(buf, len);
 			if (hapd->pending_eapol_rx) {
-				os_get_time(&hapd->pending_eapol_rx_time);
+				os_get_reltime(&hapd->pending_eapol_rx_time);
 				os_memcpy(hapd->pending_eapol_rx_src, sa,
 					  ETH_ALEN);
 			}
@@ -1787,6 +1787,8 @@ int ieee802_1x_init(struct hostapd_data *hapd)
 	conf.ssl_ctx = hapd->ssl_ctx;
 	conf.msg_ctx = hapd->msg_ctx;
 	conf.eap_sim_db_priv = hapd->eap_sim_db_priv;
+	conf.tls_pool = hapd->tls_pool;
+	conf.tick_wheel = hapd->tick_wheel;
 	conf.eap_req_id_text = hapd->conf->eap_req_id_text;
 	conf.eap_req_id_text_len = hapd->conf->eap_req_id_text_len;
 	conf.pac_opaque_encr_key = hapd->conf->pac_opaque_encr_key;
@@ -2169,6 +2171,70 @@ int ieee802_1x_get_mib_sta(struct hostapd_data *hapd, struct sta_info *sta,
 }
 
 
+/**
+ * ieee802_1x_get_mib_sta_state - Get a summary of the per-STA MIB values
+ * @sta: Pointer to the station
+ * Returns: Value that changes when the values reported by
+ * ieee802_1x_get_mib_sta() change (with high probability)
+ *
+ * dot1xAuthSessionTime is not included since it changes every second.
+ */
+u32 ieee802_1x_get_mib_sta_state(struct sta_info *sta)
+{
+	struct eapol_state_machine *sm = sta->eapol_sm;
+	u32 state;
+	size_t i;
+
+	if (sm == NULL)
+		return 0;
+
+	state = sm->initialize;
+	state = state * 31 + sm->auth_pae_state;
+	state = state * 31 + sm->be_auth_state;
+	state = state * 31 + sm->adminControlledDirections;
+	state = state * 31 + sm->operControlledDirections;
+	state = state * 31 + sm->authPortStatus;
+	state = state * 31 + sm->portControl;
+	state = state * 31 + sm->quietPeriod;
+	state = state * 31 + sm->serverTimeout;
+	state = state * 31 + sm->reAuthPeriod;
+	state = state * 31 + sm->reAuthEnabled;
+	state = state * 31 + sm->keyTxEnabled;
+	state = state * 31 + sm->dot1xAuthEapolFramesRx;
+	state = state * 31 + sm->dot1xAuthEapolFramesTx;
+	state = state * 31 + sm->dot1xAuthEapolStartFramesRx;
+	state = state * 31 + sm->dot1xAuthEapolLogoffFramesRx;
+	state = state * 31 + sm->dot1xAuthEapolRespIdFramesRx;
+	state = state * 31 + sm->dot1xAuthEapolRespFramesRx;
+	state = state * 31 + sm->dot1xAuthEapolReqIdFramesTx;
+	state = state * 31 + sm->dot1xAuthEapolReqFramesTx;
+	state = state * 31 + sm->dot1xAuthInvalidEapolFramesRx;
+	state = state * 31 + sm->dot1xAuthEapLengthErrorFramesRx;
+	state = state * 31 + sm->dot1xAuthLastEapolFrameVersion;
+	state = state * 31 + sm->authEntersConnecting;
+	state = state * 31 + sm->authEapLogoffsWhileConnecting;
+	state = state * 31 + sm->authEntersAuthenticating;
+	state = state * 31 + sm->authAuthSuccessesWhileAuthenticating;
+	state = state * 31 + sm->authAuthTimeoutsWhileAuthenticating;
+	state = state * 31 + sm->authAuthFailWhileAuthenticating;
+	state = state * 31 + sm->authAuthEapStartsWhileAuthenticating;
+	state = state * 31 + sm->authAuthEapLogoffWhileAuthenticating;
+	state = state * 31 + sm->authAuthReauthsWhileAuthenticated;
+	state = state * 31 + sm->authAuthEapStartsWhileAuthenticated;
+	state = state * 31 + sm->authAuthEapLogoffWhileAuthenticated;
+	state = state * 31 + sm->backendResponses;
+	state = state * 31 + sm->backendAccessChallenges;
+	state = state * 31 + sm->backendOtherRequestsToSupplicant;
+	state = state * 31 + sm->backendAuthSuccesses;
+	state = state * 31 + sm->backendAuthFails;
+	for (i = 0; sm->identity && i < sm->identity_len; i++)
+		state = state * 31 + sm->identity[i];
+	state = state * 31 + sta->acct_session_id_lo;
+	state = state * 31 + wpa_auth_sta_key_mgmt(sta->wpa_sm);
+	return state;
+}
+
+
 static void ieee802_1x_finished(struct hostapd_data *hapd,
 				struct sta_info *sta, int success)
 {
@@ -7,25 +7,42 @@
  */
 
 #include "utils/includes.h"
+#ifndef CONFIG_NATIVE_WINDOWS
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif /* CONFIG_NATIVE_WINDOWS */
 
 #include "utils/common.h"
 #include "utils/eloop.h"
+#include "utils/list.h"
+#include "utils/heap.h"
 #include "eapol_auth/eapol_auth_sm.h"
 #include "eapol_auth/eapol_auth_sm_i.h"
 #include "sta_info.h"
 #include "ap_config.h"
+#include "state_store.h"
 #include "pmksa_cache_auth.h"
 
 
 static const int pmksa_cache_max_entries = 1024;
 static const int dot11RSNAConfigPMKLifetime = 43200;
 
+/* Maximum length of an entry in text form, e.g., in pmksa_cache_file */
+#define PMKSA_CACHE_LINE_LEN 8192
+
 struct rsn_pmksa_cache {
-#define PMKID_HASH_SIZE 128
-#define PMKID_HASH(pmkid) (unsigned int) ((pmkid)[0] & 0x7f)
-	struct rsn_pmksa_cache_entry *pmkid[PMKID_HASH_SIZE];
-	struct rsn_pmksa_cache_entry *pmksa;
+#define PMKSA_HASH_SIZE 256
+#define PMKID_HASH(pmkid) (unsigned int) ((pmkid)[0])
+#define SPA_HASH(spa) (unsigned int) ((spa)[4] ^ (spa)[5])
+	struct dl_list pmkid[PMKSA_HASH_SIZE];
+	struct dl_list spa[PMKSA_HASH_SIZE];
+	struct dl_list lru; /* least recently used entry first */
+	struct heap expire;
 	int pmksa_count;
+	size_t mem_used;
+	size_t max_mem; /* 0 = only limit the number of entries */
+	struct state_store *store;
+	u8 addr[ETH_ALEN];
 
 	void (*free_cb)(struct rsn_pmksa_cache_entry *entry, void *ctx);
 	void *ctx;
@@ -33,6 +50,22 @@ struct rsn_pmksa_cache {
 
 
 static void pmksa_cache_set_expiration(struct rsn_pmksa_cache *pmksa);
+static void pmksa_cache_store_entry(struct rsn_pmksa_cache *pmksa,
+				    struct rsn_pmksa_cache_entry *entry);
+
+
+static size_t pmksa_cache_entry_mem(struct rsn_pmksa_cache_entry *entry)
+{
+	size_t len, i;
+
+	len = sizeof(*entry) + entry->identity_len;
+	if (entry->cui)
+		len += wpabuf_len(entry->cui);
+	for (i = 0; i < entry->radius_class.count; i++)
+		len += sizeof(struct radius_attr_data) +
+			entry->radius_class.attr[i].len;
+	return len;
+}
 
 
 static void _pmksa_cache_free_entry(struct rsn_pmksa_cache_entry *entry)
@@ -44,6 +77,7 @@ static void _pmksa_cache_free_entry(struct rsn_pmksa_cache_entry *entry)
 #ifndef CONFIG_NO_RADIUS
 	radius_free_class(&entry->radius_class);
 #endif /* CONFIG_NO_RADIUS */
+	os_memset(entry->pmk, 0, sizeof(entry->pmk));
 	os_free(entry);
 }
 
@@ -51,52 +85,36 @@ static void _pmksa_cache_free_entry(struct rsn_pmksa_cache_entry *entry)
 static void pmksa_cache_free_entry(struct rsn_pmksa_cache *pmksa,
 				   struct rsn_pmksa_cache_entry *entry)
 {
-	struct rsn_pmksa_cache_entry *pos, *prev;
+	int first = heap_first(&pmksa->expire) == &entry->expire;
 
 	pmksa->pmksa_count--;
+	pmksa->mem_used -= pmksa_cache_entry_mem(entry);
 	pmksa->free_cb(entry, pmksa->ctx);
-	pos = pmksa->pmkid[PMKID_HASH(entry->pmkid)];
-	prev = NULL;
-	while (pos) {
-		if (pos == entry) {
-			if (prev != NULL) {
-				prev->hnext = pos->hnext;
-			} else {
-				pmksa->pmkid[PMKID_HASH(entry->pmkid)] =
-					pos->hnext;
-			}
-			break;
-		}
-		prev = pos;
-		pos = pos->hnext;
-	}
-
-	pos = pmksa->pmksa;
-	prev = NULL;
-	while (pos) {
-		if (pos == entry) {
-			if (prev != NULL)
-				prev->next = pos->next;
-			else
-				pmksa->pmksa = pos->next;
-			break;
-		}
-		prev = pos;
-		pos = pos->next;
-	}
+	if (entry->state_slot)
+		state_store_del(pmksa->store, entry->state_slot - 1);
+	dl_list_del(&entry->list);
+	dl_list_del(&entry->hash_pmkid);
+	dl_list_del(&entry->hash_spa);
+	heap_remove(&pmksa->expire, &entry->expire);
 	_pmksa_cache_free_entry(entry);
+
+	if (first)
+		pmksa_cache_set_expiration(pmksa);
 }
 
 
 static void pmksa_cache_expire(void *eloop_ctx, void *timeout_ctx)
 {
 	struct rsn_pmksa_cache *pmksa = eloop_ctx;
+	struct rsn_pmksa_cache_entry *entry;
+	struct heap_node *node;
 	struct os_time now;
 
 	os_get_time(&now);
-	while (pmksa->pmksa && pmksa->pmksa->expiration <= now.sec) {
-		struct rsn_pmksa_cache_entry *entry = pmksa->pmksa;
-		pmksa->pmksa = entry->next;
+	while ((node = heap_first(&pmksa->expire)) && node->key <= now.sec) {
+		entry = heap_entry(node, struct rsn_pmksa_cache_entry, expire);
+		/* Avoid re-arming the timeout for each removed entry */
+		heap_remove(&pmksa->expire, node);
 		wpa_printf(MSG_DEBUG, "RSN: expired PMKSA cache entry for "
 			   MACSTR, MAC2STR(entry->spa));
 		pmksa_cache_free_entry(pmksa, entry);
@@ -110,12 +128,14 @@ static void pmksa_cache_set_expiration(struct rsn_pmksa_cache *pmksa)
 {
 	int sec;
 	struct os_time now;
+	struct heap_node *node;
 
 	eloop_cancel_timeout(pmksa_cache_expire, pmksa, NULL);
-	if (pmksa->pmksa == NULL)
+	node = heap_first(&pmksa->expire);
+	if (node == NULL)
 		return;
 	os_get_time(&now);
-	sec = pmksa->pmksa->expiration - now.sec;
+	sec = node->key - now.sec;
 	if (sec < 0)
 		sec = 0;
 	eloop_register_timeout(sec + 1, 0, pmksa_cache_expire, pmksa, NULL);
@@ -186,34 +206,44 @@ void pmksa_cache_to_eapol_data(struct rsn_pmksa_cache_entry *entry,
 }
 
 
-static void pmksa_cache_link_entry(struct rsn_pmksa_cache *pmksa,
-				   struct rsn_pmksa_cache_entry *entry)
+static int pmksa_cache_link_entry(struct rsn_pmksa_cache *pmksa,
+				  struct rsn_pmksa_cache_entry *entry)
 {
-	struct rsn_pmksa_cache_entry *pos, *prev;
-
-	/* Add the new entry; order by expiration time */
-	pos = pmksa->pmksa;
-	prev = NULL;
-	while (pos) {
-		if (pos->expiration > entry->expiration)
-			break;
-		prev = pos;
-		pos = pos->next;
-	}
-	if (prev == NULL) {
-		entry->next = pmksa->pmksa;
-		pmksa->pmksa = entry;
-	} else {
-		entry->next = prev->next;
-		prev->next = entry;
+	struct rsn_pmksa_cache_entry *old;
+	size_t mem = pmksa_cache_entry_mem(entry);
+
+	/* Remove the least recently used entries to make room for the new
+	 * entry */
+	while (!dl_list_empty(&pmksa->lru) &&
+	       (pmksa->pmksa_count >= pmksa_cache_max_entries ||
+		(pmksa->max_mem && pmksa->mem_used + mem > pmksa->max_mem))) {
+		old = dl_list_first(&pmksa->lru, struct rsn_pmksa_cache_entry,
+				    list);
+		wpa_printf(MSG_DEBUG, "RSN: removed the least recently used "
+			   "PMKSA cache entry (for " MACSTR ") to make room for "
+			   "new one", MAC2STR(old->spa));
+		pmksa_cache_free_entry(pmksa, old);
 	}
-	entry->hnext = pmksa->pmkid[PMKID_HASH(entry->pmkid)];
-	pmksa->pmkid[PMKID_HASH(entry->pmkid)] = entry;
 
+	entry->expire.key = entry->expiration;
+	if (heap_insert(&pmksa->expire, &entry->expire) < 0)
+		return -1;
+	dl_list_add_tail(&pmksa->lru, &entry->list);
+	dl_list_add(&pmksa->pmkid[PMKID_HASH(entry->pmkid)],
+		    &entry->hash_pmkid);
+	dl_list_add(&pmksa->spa[SPA_HASH(entry->spa)], &entry->hash_spa);
 	pmksa->pmksa_count++;
+	pmksa->mem_used += mem;
+
+	if (heap_first(&pmksa->expire) == &entry->expire)
+		pmksa_cache_set_expiration(pmksa);
+	pmksa_cache_store_entry(pmksa, entry);
+
 	wpa_printf(MSG_DEBUG, "RSN: added PMKSA cache entry for " MACSTR,
 		   MAC2STR(entry->spa));
 	wpa_hexdump(MSG_DEBUG, "RSN: added PMKID", entry->pmkid, PMKID_LEN);
+
+	return 0;
 }
 
 
@@ -269,16 +299,11 @@ pmksa_cache_auth_add(struct rsn_pmksa_cache *pmksa,
 	if (pos)
 		pmksa_cache_free_entry(pmksa, pos);
 
-	if (pmksa->pmksa_count >= pmksa_cache_max_entries && pmksa->pmksa) {
-		/* Remove the oldest entry to make room for the new entry */
-		wpa_printf(MSG_DEBUG, "RSN: removed the oldest PMKSA cache "
-			   "entry (for " MACSTR ") to make room for new one",
-			   MAC2STR(pmksa->pmksa->spa));
-		pmksa_cache_free_entry(pmksa, pmksa->pmksa);
+	if (pmksa_cache_link_entry(pmksa, entry) < 0) {
+		_pmksa_cache_free_entry(entry);
+		return NULL;
 	}
 
-	pmksa_cache_link_entry(pmksa, entry);
-
 	return entry;
 }
 
@@ -317,7 +342,10 @@ pmksa_cache_add_okc(struct rsn_pmksa_cache *pmksa,
 	entry->vlan_id = old_entry->vlan_id;
 	entry->opportunistic = 1;
 
-	pmksa_cache_link_entry(pmksa, entry);
+	if (pmksa_cache_link_entry(pmksa, entry) < 0) {
+		_pmksa_cache_free_entry(entry);
+		return NULL;
+	}
 
 	return entry;
 }
@@ -330,24 +358,50 @@ pmksa_cache_add_okc(struct rsn_pmksa_cache *pmksa,
 void pmksa_cache_auth_deinit(struct rsn_pmksa_cache *pmksa)
 {
 	struct rsn_pmksa_cache_entry *entry, *prev;
-	int i;
 
 	if (pmksa == NULL)
 		return;
 
-	entry = pmksa->pmksa;
-	while (entry) {
-		prev = entry;
-		entry = entry->next;
-		_pmksa_cache_free_entry(prev);
-	}
+	heap_deinit(&pmksa->expire);
+	dl_list_for_each_safe(entry, prev, &pmksa->lru,
+			      struct rsn_pmksa_cache_entry, list)
+		_pmksa_cache_free_entry(entry);
 	eloop_cancel_timeout(pmksa_cache_expire, pmksa, NULL);
-	for (i = 0; i < PMKID_HASH_SIZE; i++)
-		pmksa->pmkid[i] = NULL;
 	os_free(pmksa);
 }
 
 
+/**
+ * pmksa_cache_auth_set_max_mem - Set memory budget for PMKSA cache
+ * @pmksa: Pointer to PMKSA cache data from pmksa_cache_auth_init()
+ * @max_mem: Maximum number of bytes used by the entries or 0 for no limit
+ *
+ * Least recently used entries are removed when a new entry would not fit in
+ * the budget. The number of entries is limited regardless of this setting.
+ */
+void pmksa_cache_auth_set_max_mem(struct rsn_pmksa_cache *pmksa,
+				  size_t max_mem)
+{
+	struct rsn_pmksa_cache_entry *entry;
+
+	pmksa->max_mem = max_mem;
+	while (max_mem && pmksa->mem_used > max_mem &&
+	       !dl_list_empty(&pmksa->lru)) {
+		entry = dl_list_first(&pmksa->lru,
+				      struct rsn_pmksa_cache_entry, list);
+		pmksa_cache_free_entry(pmksa, entry);
+	}
+}
+
+
+static void pmksa_cache_touch(struct rsn_pmksa_cache *pmksa,
+			      struct rsn_pmksa_cache_entry *entry)
+{
+	dl_list_del(&entry->list);
+	dl_list_add_tail(&pmksa->lru, &entry->list);
+}
+
+
 /**
  * pmksa_cache_auth_get - Fetch a PMKSA cache entry
  * @pmksa: Pointer to PMKSA cache data from pmksa_cache_auth_init()
@@ -361,19 +415,30 @@ pmksa_cache_auth_get(struct rsn_pmksa_cache *pmksa,
 {
 	struct rsn_pmksa_cache_entry *entry;
 
-	if (pmkid)
-		entry = pmksa->pmkid[PMKID_HASH(pmkid)];
-	else
-		entry = pmksa->pmksa;
-	while (entry) {
-		if ((spa == NULL ||
-		     os_memcmp(entry->spa, spa, ETH_ALEN) == 0) &&
-		    (pmkid == NULL ||
-		     os_memcmp(entry->pmkid, pmkid, PMKID_LEN) == 0))
-			return entry;
-		entry = pmkid ? entry->hnext : entry->next;
+	if (pmkid) {
+		dl_list_for_each(entry, &pmksa->pmkid[PMKID_HASH(pmkid)],
+				 struct rsn_pmksa_cache_entry, hash_pmkid) {
+			if ((spa == NULL ||
+			     os_memcmp(entry->spa, spa, ETH_ALEN) == 0) &&
+			    os_memcmp(entry->pmkid, pmkid, PMKID_LEN) == 0)
+				goto found;
+		}
+	} else if (spa) {
+		dl_list_for_each(entry, &pmksa->spa[SPA_HASH(spa)],
+				 struct rsn_pmksa_cache_entry, hash_spa) {
+			if (os_memcmp(entry->spa, spa, ETH_ALEN) == 0)
+				goto found;
+		}
+	} else if (!dl_list_empty(&pmksa->lru)) {
+		entry = dl_list_first(&pmksa->lru,
+				      struct rsn_pmksa_cache_entry, list);
+		goto found;
 	}
 	return NULL;
+
+found:
+	pmksa_cache_touch(pmksa, entry);
+	return entry;
 }
 
 
@@ -394,15 +459,16 @@ struct rsn_pmksa_cache_entry * pmksa_cache_get_okc(
 	struct rsn_pmksa_cache_entry *entry;
 	u8 new_pmkid[PMKID_LEN];
 
-	entry = pmksa->pmksa;
-	while (entry) {
+	dl_list_for_each(entry, &pmksa->spa[SPA_HASH(spa)],
+			 struct rsn_pmksa_cache_entry, hash_spa) {
 		if (os_memcmp(entry->spa, spa, ETH_ALEN) != 0)
 			continue;
 		rsn_pmkid(entry->pmk, entry->pmk_len, aa, spa, new_pmkid,
 			  wpa_key_mgmt_sha256(entry->akmp));
-		if (os_memcmp(new_pmkid, pmkid, PMKID_LEN) == 0)
+		if (os_memcmp(new_pmkid, pmkid, PMKID_LEN) == 0) {
+			pmksa_cache_touch(pmksa, entry);
 			return entry;
-		entry = entry->next;
+		}
 	}
 	return NULL;
 }
@@ -419,12 +485,449 @@ pmksa_cache_auth_init(void (*free_cb)(struct rsn_pmksa_cache_entry *entry,
 				      void *ctx), void *ctx)
 {
 	struct rsn_pmksa_cache *pmksa;
+	int i;
 
 	pmksa = os_zalloc(sizeof(*pmksa));
 	if (pmksa) {
+		for (i = 0; i < PMKSA_HASH_SIZE; i++) {
+			dl_list_init(&pmksa->pmkid[i]);
+			dl_list_init(&pmksa->spa[i]);
+		}
+		dl_list_init(&pmksa->lru);
+		heap_init(&pmksa->expire);
 		pmksa->free_cb = free_cb;
 		pmksa->ctx = ctx;
 	}
 
 	return pmksa;
 }
+
+
+static int pmksa_cache_text_hex(char *pos, char *end, const char *name,
+				const u8 *data, size_t len)
+{
+	int ret;
+
+	ret = os_snprintf(pos, end - pos, " %s=", name);
+	if (ret < 0 || ret >= end - pos || (size_t) (end - pos - ret) <= 2 * len)
+		return -1;
+	return ret + wpa_snprintf_hex(pos + ret, end - pos - ret, data, len);
+}
+
+
+/* Text form of an entry: space separated name=value pairs on one line */
+static int pmksa_cache_entry_text(struct rsn_pmksa_cache_entry *entry,
+				  char *buf, size_t buflen)
+{
+	char *pos = buf, *end = buf + buflen;
+	size_t i;
+	int ret;
+
+	ret = os_snprintf(pos, end - pos, "spa=" MACSTR, MAC2STR(entry->spa));
+	if (ret < 0 || ret >= end - pos)
+		return -1;
+	pos += ret;
+	ret = pmksa_cache_text_hex(pos, end, "pmkid", entry->pmkid, PMKID_LEN);
+	if (ret < 0)
+		return -1;
+	pos += ret;
+	ret = pmksa_cache_text_hex(pos, end, "pmk", entry->pmk, entry->pmk_len);
+	if (ret < 0)
+		return -1;
+	pos += ret;
+	ret = os_snprintf(pos, end - pos, " akmp=%d expiration=%ld vlan_id=%d "
+			  "eap_type=%u opportunistic=%d", entry->akmp,
+			  (long) entry->expiration, entry->vlan_id,
+			  entry->eap_type_authsrv, entry->opportunistic);
+	if (ret < 0 || ret >= end - pos)
+		return -1;
+	pos += ret;
+	if (entry->identity) {
+		ret = pmksa_cache_text_hex(pos, end, "identity",
+					   entry->identity,
+					   entry->identity_len);
+		if (ret < 0)
+			return -1;
+		pos += ret;
+	}
+	if (entry->cui) {
+		ret = pmksa_cache_text_hex(pos, end, "cui",
+					   wpabuf_head(entry->cui),
+					   wpabuf_len(entry->cui));
+		if (ret < 0)
+			return -1;
+		pos += ret;
+	}
+	for (i = 0; i < entry->radius_class.count; i++) {
+		ret = pmksa_cache_text_hex(pos, end, "class",
+					   entry->radius_class.attr[i].data,
+					   entry->radius_class.attr[i].len);
+		if (ret < 0)
+			return -1;
+		pos += ret;
+	}
+
+	return pos - buf;
+}
+
+
+static int pmksa_cache_parse_hex(const char *val, u8 **buf, size_t *len)
+{
+	size_t hlen = os_strlen(val);
+
+	if (hlen == 0 || hlen & 1)
+		return -1;
+	*buf = os_malloc(hlen / 2);
+	if (*buf == NULL)
+		return -1;
+	if (hexstr2bin(val, *buf, hlen / 2)) {
+		os_free(*buf);
+		*buf = NULL;
+		return -1;
+	}
+	*len = hlen / 2;
+	return 0;
+}
+
+
+static int pmksa_cache_parse_entry(struct rsn_pmksa_cache_entry *entry,
+				   char *pos)
+{
+	char *name, *val, *end;
+	u8 *data;
+	size_t len;
+	int ret = 0, fields = 0;
+
+	while (*pos && ret == 0) {
+		while (*pos == ' ')
+			pos++;
+		if (*pos == '\0')
+			break;
+		name = pos;
+		end = os_strchr(pos, ' ');
+		if (end) {
+			*end = '\0';
+			pos = end + 1;
+		} else
+			pos += os_strlen(pos);
+		val = os_strchr(name, '=');
+		if (val == NULL)
+			return -1;
+		*val++ = '\0';
+
+		if (os_strcmp(name, "spa") == 0) {
+			ret = hwaddr_aton(val, entry->spa);
+			fields++;
+		} else if (os_strcmp(name, "pmkid") == 0) {
+			ret = hexstr2bin(val, entry->pmkid, PMKID_LEN);
+			fields++;
+		} else if (os_strcmp(name, "pmk") == 0) {
+			entry->pmk_len = os_strlen(val) / 2;
+			if (entry->pmk_len == 0 || entry->pmk_len > PMK_LEN)
+				return -1;
+			ret = hexstr2bin(val, entry->pmk, entry->pmk_len);
+			fields++;
+		} else if (os_strcmp(name, "akmp") == 0) {
+			entry->akmp = atoi(val);
+		} else if (os_strcmp(name, "expiration") == 0) {
+			entry->expiration = strtol(val, NULL, 10);
+			fields++;
+		} else if (os_strcmp(name, "vlan_id") == 0) {
+			entry->vlan_id = atoi(val);
+		} else if (os_strcmp(name, "eap_type") == 0) {
+			entry->eap_type_authsrv = atoi(val);
+		} else if (os_strcmp(name, "opportunistic") == 0) {
+			entry->opportunistic = atoi(val);
+		} else if (os_strcmp(name, "identity") == 0) {
+			if (entry->identity)
+				return -1;
+			ret = pmksa_cache_parse_hex(val, &entry->identity,
+						    &entry->identity_len);
+		} else if (os_strcmp(name, "cui") == 0) {
+			if (entry->cui ||
+			    pmksa_cache_parse_hex(val, &data, &len) < 0)
+				return -1;
+			entry->cui = wpabuf_alloc_ext_data(data, len);
+			if (entry->cui == NULL) {
+				os_free(data);
+				return -1;
+			}
+#ifndef CONFIG_NO_RADIUS
+		} else if (os_strcmp(name, "class") == 0) {
+			struct radius_attr_data *attr;
+			if (pmksa_cache_parse_hex(val, &data, &len) < 0)
+				return -1;
+			attr = os_realloc(entry->radius_class.attr,
+					  (entry->radius_class.count + 1) *
+					  sizeof(*attr));
+			if (attr == NULL) {
+				os_free(data);
+				return -1;
+			}
+			entry->radius_class.attr = attr;
+			attr[entry->radius_class.count].data = data;
+			attr[entry->radius_class.count].len = len;
+			entry->radius_class.count++;
+#endif /* CONFIG_NO_RADIUS */
+		}
+	}
+
+	/* spa, pmkid, pmk, and expiration are mandatory */
+	if (ret || fields != 4)
+		return -1;
+	return 0;
+}
+
+
+/**
+ * pmksa_cache_auth_write - Write PMKSA cache entries into a file
+ * @pmksa: Pointer to PMKSA cache data from pmksa_cache_auth_init()
+ * @fname: File name for the snapshot
+ * Returns: 0 on success, -1 on failure
+ *
+ * The file is written in least recently used first order so that reading it
+ * back with pmksa_cache_auth_read() restores the LRU order. The file contains
+ * PMKs and is created readable only by the owner.
+ */
+int pmksa_cache_auth_write(struct rsn_pmksa_cache *pmksa, const char *fname)
+{
+#ifdef CONFIG_NATIVE_WINDOWS
+	return -1;
+#else /* CONFIG_NATIVE_WINDOWS */
+	struct rsn_pmksa_cache_entry *entry;
+	char *tmp, *buf;
+	size_t len;
+	int fd;
+	FILE *f;
+
+	buf = os_malloc(PMKSA_CACHE_LINE_LEN);
+	if (buf == NULL)
+		return -1;
+	len = os_strlen(fname) + 5;
+	tmp = os_malloc(len);
+	if (tmp == NULL) {
+		os_free(buf);
+		return -1;
+	}
+	os_snprintf(tmp, len, "%s.new", fname);
+
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	f = fd < 0 ? NULL : fdopen(fd, "w");
+	if (f == NULL) {
+		wpa_printf(MSG_INFO, "Could not write PMKSA cache file '%s'",
+			   tmp);
+		if (fd >= 0)
+			close(fd);
+		os_free(tmp);
+		os_free(buf);
+		return -1;
+	}
+
+	fprintf(f, "# PMKSA cache (generated by hostapd)\n");
+	dl_list_for_each(entry, &pmksa->lru, struct rsn_pmksa_cache_entry,
+			 list) {
+		if (pmksa_cache_entry_text(entry, buf, PMKSA_CACHE_LINE_LEN) >
+		    0)
+			fprintf(f, "%s\n", buf);
+	}
+	os_memset(buf, 0, PMKSA_CACHE_LINE_LEN);
+	os_free(buf);
+
+	if (fclose(f) != 0 || rename(tmp, fname) < 0) {
+		wpa_printf(MSG_INFO, "Could not update PMKSA cache file '%s': "
+			   "%s", fname, strerror(errno));
+		unlink(tmp);
+		os_free(tmp);
+		return -1;
+	}
+	os_free(tmp);
+
+	wpa_printf(MSG_DEBUG, "RSN: Wrote %d PMKSA cache entries to '%s'",
+		   pmksa->pmksa_count, fname);
+
+	return 0;
+#endif /* CONFIG_NATIVE_WINDOWS */
+}
+
+
+/**
+ * pmksa_cache_auth_read - Add PMKSA cache entries from a file
+ * @pmksa: Pointer to PMKSA cache data from pmksa_cache_auth_init()
+ * @fname: File name of a snapshot from pmksa_cache_auth_write()
+ * Returns: Number of entries added or -1 if the file could not be read
+ *
+ * Entries that have already expired and lines that cannot be parsed are
+ * skipped.
+ */
+int pmksa_cache_auth_read(struct rsn_pmksa_cache *pmksa, const char *fname)
+{
+#ifdef CONFIG_NATIVE_WINDOWS
+	return -1;
+#else /* CONFIG_NATIVE_WINDOWS */
+	FILE *f;
+	char *buf, *pos;
+	const size_t buflen = PMKSA_CACHE_LINE_LEN;
+	struct rsn_pmksa_cache_entry *entry;
+	struct os_time now;
+	int line = 0, added = 0, skip = 0;
+
+	f = fopen(fname, "r");
+	if (f == NULL) {
+		wpa_printf(MSG_DEBUG, "PMKSA cache file '%s' not available",
+			   fname);
+		return -1;
+	}
+	buf = os_malloc(buflen);
+	if (buf == NULL) {
+		fclose(f);
+		return -1;
+	}
+
+	os_get_time(&now);
+	while (fgets(buf, buflen, f)) {
+		pos = os_strchr(buf, '\n');
+		if (pos == NULL) {
+			/* Too long line; ignore the rest of it */
+			skip = 1;
+			continue;
+		}
+		line++;
+		if (skip) {
+			skip = 0;
+			continue;
+		}
+		*pos = '\0';
+		if (buf[0] == '#' || buf[0] == '\0')
+			continue;
+
+		entry = os_zalloc(sizeof(*entry));
+		if (entry == NULL)
+			break;
+		if (pmksa_cache_parse_entry(entry, buf) < 0) {
+			wpa_printf(MSG_DEBUG, "RSN: Invalid PMKSA cache entry "
+				   "on line %d in '%s'", line, fname);
+			_pmksa_cache_free_entry(entry);
+			continue;
+		}
+		if (entry->expiration <= now.sec ||
+		    pmksa_cache_auth_get(pmksa, entry->spa, entry->pmkid) ||
+		    pmksa_cache_link_entry(pmksa, entry) < 0) {
+			_pmksa_cache_free_entry(entry);
+			continue;
+		}
+		added++;
+	}
+
+	os_memset(buf, 0, buflen);
+	os_free(buf);
+	fclose(f);
+
+	wpa_printf(MSG_DEBUG, "RSN: Added %d PMKSA cache entries from '%s'",
+		   added, fname);
+
+	return added;
+#endif /* CONFIG_NATIVE_WINDOWS */
+}
+
+
+static void pmksa_cache_store_entry(struct rsn_pmksa_cache *pmksa,
+				    struct rsn_pmksa_cache_entry *entry)
+{
+	size_t max_len = state_store_max_len(pmksa->store);
+	char *buf;
+	int len, slot;
+
+	if (pmksa->store == NULL || entry->state_slot)
+		return;
+
+	buf = os_malloc(max_len + 1);
+	if (buf == NULL)
+		return;
+	len = pmksa_cache_entry_text(entry, buf, max_len + 1);
+	if (len < 0) {
+		wpa_printf(MSG_DEBUG, "RSN: PMKSA cache entry for " MACSTR
+			   " does not fit in the state store",
+			   MAC2STR(entry->spa));
+		slot = -1;
+	} else
+		slot = state_store_add(pmksa->store, STATE_STORE_PMKSA,
+				       pmksa->addr, entry->expiration, buf,
+				       len);
+	os_memset(buf, 0, max_len + 1);
+	os_free(buf);
+	if (slot >= 0)
+		entry->state_slot = slot + 1;
+}
+
+
+static int pmksa_cache_restore_cb(void *ctx, int slot, const u8 *data,
+				  size_t len)
+{
+	struct rsn_pmksa_cache *pmksa = ctx;
+	struct rsn_pmksa_cache_entry *entry;
+	struct os_time now;
+	char *buf;
+	int ret;
+
+	buf = os_malloc(len + 1);
+	entry = os_zalloc(sizeof(*entry));
+	if (buf == NULL || entry == NULL) {
+		os_free(buf);
+		os_free(entry);
+		return 0;
+	}
+	os_memcpy(buf, data, len);
+	buf[len] = '\0';
+	ret = pmksa_cache_parse_entry(entry, buf);
+	os_memset(buf, 0, len + 1);
+	os_free(buf);
+
+	os_get_time(&now);
+	if (ret < 0 || entry->expiration <= now.sec ||
+	    pmksa_cache_auth_get(pmksa, entry->spa, entry->pmkid)) {
+		_pmksa_cache_free_entry(entry);
+		return -1;
+	}
+
+	entry->state_slot = slot + 1;
+	if (pmksa_cache_link_entry(pmksa, entry) < 0) {
+		_pmksa_cache_free_entry(entry);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/**
+ * pmksa_cache_auth_set_store - Keep PMKSA cache in a persistent state store
+ * @pmksa: Pointer to PMKSA cache data from pmksa_cache_auth_init()
+ * @store: State store or %NULL
+ * @addr: Authenticator address for identifying the entries in the store
+ *
+ * Entries for @addr are restored from the store. After this, added entries are
+ * written into the store and removed entries are deleted from it. Entries that
+ * are still in the cache when it is deinitialized remain in the store.
+ */
+void pmksa_cache_auth_set_store(struct rsn_pmksa_cache *pmksa,
+				struct state_store *store, const u8 *addr)
+{
+	struct rsn_pmksa_cache_entry *entry;
+	int count;
+
+	if (pmksa->store || store == NULL)
+		return;
+
+	os_memcpy(pmksa->addr, addr, ETH_ALEN);
+	pmksa->store = store;
+	count = state_store_for_each(store, STATE_STORE_PMKSA, addr,
+				     pmksa_cache_restore_cb, pmksa);
+	if (count)
+		wpa_printf(MSG_DEBUG, "RSN: Restored %d PMKSA cache entries",
+			   count);
+
+	/* Store entries that were not loaded from the state store */
+	dl_list_for_each(entry, &pmksa->lru, struct rsn_pmksa_cache_entry,
+			 list)
+		pmksa_cache_store_entry(pmksa, entry);
+}
@@ -9,13 +9,18 @@
 #ifndef PMKSA_CACHE_H
 #define PMKSA_CACHE_H
 
+#include "utils/list.h"
+#include "utils/heap.h"
 #include "radius/radius.h"
 
 /**
  * struct rsn_pmksa_cache_entry - PMKSA cache entry
  */
 struct rsn_pmksa_cache_entry {
-	struct rsn_pmksa_cache_entry *next, *hnext;
+	struct dl_list list; /* LRU order; least recently used first */
+	struct dl_list hash_pmkid;
+	struct dl_list hash_spa;
+	struct heap_node expire; /* key = expiration */
 	u8 pmkid[PMKID_LEN];
 	u8 pmk[PMK_LEN];
 	size_t pmk_len;
@@ -30,14 +35,18 @@ struct rsn_pmksa_cache_entry {
 	u8 eap_type_authsrv;
 	int vlan_id;
 	int opportunistic;
+	int state_slot; /* slot in the state store plus one; 0 = not stored */
 };
 
 struct rsn_pmksa_cache;
+struct state_store;
 
 struct rsn_pmksa_cache *
 pmksa_cache_auth_init(void (*free_cb)(struct rsn_pmksa_cache_entry *entry,
 				      void *ctx), void *ctx);
 void pmksa_cache_auth_deinit(struct rsn_pmksa_cache *pmksa);
+void pmksa_cache_auth_set_max_mem(struct rsn_pmksa_cache *pmksa,
+				  size_t max_mem);
 struct rsn_pmksa_cache_entry *
 pmksa_cache_auth_get(struct rsn_pmksa_cache *pmksa,
 		     const u8 *spa, const u8 *pmkid);
@@ -55,5 +64,9 @@ pmksa_cache_add_okc(struct rsn_pmksa_cache *pmksa,
 		    const u8 *aa, const u8 *pmkid);
 void pmksa_cache_to_eapol_data(struct rsn_pmksa_cache_entry *entry,
 			       struct eapol_state_machine *eapol);
+int pmksa_cache_auth_write(struct rsn_pmksa_cache *pmksa, const char *fname);
+int pmksa_cache_auth_read(struct rsn_pmksa_cache *pmksa, const char *fname);
+void pmksa_cache_auth_set_store(struct rsn_pmksa_cache *pmksa,
+				struct state_store *store, const u8 *addr);
 
 #endif /* PMKSA_CACHE_H */
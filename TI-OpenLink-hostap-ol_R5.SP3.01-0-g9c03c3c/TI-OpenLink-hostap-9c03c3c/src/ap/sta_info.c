@@ -10,6 +10,7 @@
 
 #include "utils/common.h"
 #include "utils/eloop.h"
+#include "utils/tick_wheel.h"
 #include "common/ieee802_11_defs.h"
 #include "common/wpa_ctrl.h"
 #include "radius/radius.h"
@@ -41,6 +42,14 @@ static void ap_sa_query_timer(void *eloop_ctx, void *timeout_ctx);
 #endif /* CONFIG_IEEE80211W */
 static int ap_sta_remove(struct hostapd_data *hapd, struct sta_info *sta);
 
+/* Upper limit for the number of STA hash table buckets */
+#define STA_HASH_MAX_SIZE 65536
+
+/* Matches STA_HASH() as long as the table has STA_HASH_SIZE buckets */
+#define STA_HASH_IDX(hapd, a) \
+	((((unsigned int) (a)[4] << 8) | (a)[5]) & ((hapd)->sta_hash_size - 1))
+
+
 int ap_for_each_sta(struct hostapd_data *hapd,
 		    int (*cb)(struct hostapd_data *hapd, struct sta_info *sta,
 			      void *ctx),
@@ -57,41 +66,202 @@ int ap_for_each_sta(struct hostapd_data *hapd,
 }
 
 
+static struct hostapd_sta_vlan * ap_sta_vlan_get(struct hostapd_data *hapd,
+						int vlan_id)
+{
+	struct hostapd_sta_vlan *v;
+
+	for (v = hapd->sta_vlans; v; v = v->next) {
+		if (v->vlan_id == vlan_id)
+			return v;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * ap_for_each_sta_vlan - Iterate over STAs bound to a VLAN
+ * @hapd: Pointer to BSS data
+ * @vlan_id: VLAN ID (0 = STAs not bound to any VLAN)
+ * @cb: Callback function; iteration stops if this returns non-zero
+ * @ctx: Context pointer for the callback
+ * Returns: 1 if the iteration was stopped by the callback, 0 otherwise
+ *
+ * Unlike ap_for_each_sta(), this only goes through the STAs that are bound
+ * to the specified VLAN ID.
+ */
+int ap_for_each_sta_vlan(struct hostapd_data *hapd, int vlan_id,
+			 int (*cb)(struct hostapd_data *hapd,
+				   struct sta_info *sta, void *ctx),
+			 void *ctx)
+{
+	struct hostapd_sta_vlan *v;
+	struct sta_info *sta;
+
+	v = ap_sta_vlan_get(hapd, vlan_id);
+	if (v == NULL)
+		return 0;
+
+	for (sta = v->sta_list; sta; sta = sta->vlan_next) {
+		if (cb(hapd, sta, ctx))
+			return 1;
+	}
+
+	return 0;
+}
+
+
 struct sta_info * ap_get_sta(struct hostapd_data *hapd, const u8 *sta)
 {
 	struct sta_info *s;
 
-	s = hapd->sta_hash[STA_HASH(sta)];
+	if (hapd->sta_hash == NULL)
+		return NULL;
+
+	s = hapd->sta_hash[STA_HASH_IDX(hapd, sta)];
 	while (s != NULL && os_memcmp(s->addr, sta, 6) != 0)
 		s = s->hnext;
 	return s;
 }
 
 
-static void ap_sta_list_del(struct hostapd_data *hapd, struct sta_info *sta)
+static void ap_sta_vlan_del(struct hostapd_data *hapd, struct sta_info *sta)
 {
-	struct sta_info *tmp;
+	struct hostapd_sta_vlan *v = sta->vlan_list, *prev;
 
-	if (hapd->sta_list == sta) {
-		hapd->sta_list = sta->next;
+	if (v == NULL)
+		return;
+
+	if (sta->vlan_prev)
+		sta->vlan_prev->vlan_next = sta->vlan_next;
+	else
+		v->sta_list = sta->vlan_next;
+	if (sta->vlan_next)
+		sta->vlan_next->vlan_prev = sta->vlan_prev;
+	sta->vlan_list = NULL;
+	sta->vlan_next = sta->vlan_prev = NULL;
+
+	if (--v->num_sta > 0)
 		return;
+
+	if (hapd->sta_vlans == v) {
+		hapd->sta_vlans = v->next;
+	} else {
+		for (prev = hapd->sta_vlans; prev->next != v; prev = prev->next)
+			;
+		prev->next = v->next;
+	}
+	os_free(v);
+}
+
+
+/**
+ * ap_sta_vlan_update - Update per-VLAN STA list membership
+ * @hapd: Pointer to BSS data
+ * @sta: Pointer to STA data
+ * Returns: 0 on success, -1 on failure
+ *
+ * This needs to be called whenever the VLAN binding of the STA (sta->vlan_id)
+ * has been changed. On failure, the STA is left in the list of its previous
+ * VLAN.
+ */
+int ap_sta_vlan_update(struct hostapd_data *hapd, struct sta_info *sta)
+{
+	struct hostapd_sta_vlan *v;
+
+	if (sta->vlan_list && sta->vlan_list->vlan_id == sta->vlan_id)
+		return 0;
+
+	v = ap_sta_vlan_get(hapd, sta->vlan_id);
+	if (v == NULL) {
+		v = os_zalloc(sizeof(*v));
+		if (v == NULL) {
+			wpa_printf(MSG_ERROR, "Failed to allocate STA list for "
+				   "VLAN %d (STA " MACSTR ")", sta->vlan_id,
+				   MAC2STR(sta->addr));
+			return -1;
+		}
+		v->vlan_id = sta->vlan_id;
+		v->next = hapd->sta_vlans;
+		hapd->sta_vlans = v;
 	}
 
-	tmp = hapd->sta_list;
-	while (tmp != NULL && tmp->next != sta)
-		tmp = tmp->next;
-	if (tmp == NULL) {
+	ap_sta_vlan_del(hapd, sta);
+
+	sta->vlan_list = v;
+	sta->vlan_next = v->sta_list;
+	if (v->sta_list)
+		v->sta_list->vlan_prev = sta;
+	v->sta_list = sta;
+	v->num_sta++;
+
+	return 0;
+}
+
+
+static void ap_sta_list_del(struct hostapd_data *hapd, struct sta_info *sta)
+{
+	if (sta->prev)
+		sta->prev->next = sta->next;
+	else if (hapd->sta_list == sta)
+		hapd->sta_list = sta->next;
+	else {
 		wpa_printf(MSG_DEBUG, "Could not remove STA " MACSTR " from "
 			   "list.", MAC2STR(sta->addr));
-	} else
-		tmp->next = sta->next;
+		return;
+	}
+	if (sta->next)
+		sta->next->prev = sta->prev;
+	sta->next = sta->prev = NULL;
 }
 
 
-void ap_sta_hash_add(struct hostapd_data *hapd, struct sta_info *sta)
+static int ap_sta_hash_resize(struct hostapd_data *hapd, unsigned int size)
 {
-	sta->hnext = hapd->sta_hash[STA_HASH(sta->addr)];
-	hapd->sta_hash[STA_HASH(sta->addr)] = sta;
+	struct sta_info **old = hapd->sta_hash, *s, *n;
+	unsigned int old_size = hapd->sta_hash_size, i;
+
+	hapd->sta_hash = os_zalloc(size * sizeof(struct sta_info *));
+	if (hapd->sta_hash == NULL) {
+		hapd->sta_hash = old;
+		return -1;
+	}
+	hapd->sta_hash_size = size;
+
+	for (i = 0; old && i < old_size; i++) {
+		for (s = old[i]; s; s = n) {
+			n = s->hnext;
+			s->hnext = hapd->sta_hash[STA_HASH_IDX(hapd, s->addr)];
+			hapd->sta_hash[STA_HASH_IDX(hapd, s->addr)] = s;
+		}
+	}
+	os_free(old);
+
+	if (old)
+		wpa_printf(MSG_DEBUG, "AP: Resized STA hash table to %u "
+			   "buckets (%d STAs)", size, hapd->num_sta);
+	return 0;
+}
+
+
+int ap_sta_hash_add(struct hostapd_data *hapd, struct sta_info *sta)
+{
+	if (hapd->sta_hash == NULL &&
+	    ap_sta_hash_resize(hapd, STA_HASH_SIZE) < 0)
+		return -1;
+
+	/*
+	 * Keep the chains short with large number of STAs. Failure to grow
+	 * the table is not fatal since the old table remains valid.
+	 */
+	if ((unsigned int) hapd->num_sta > 2 * hapd->sta_hash_size &&
+	    hapd->sta_hash_size < STA_HASH_MAX_SIZE)
+		ap_sta_hash_resize(hapd, 2 * hapd->sta_hash_size);
+
+	sta->hnext = hapd->sta_hash[STA_HASH_IDX(hapd, sta->addr)];
+	hapd->sta_hash[STA_HASH_IDX(hapd, sta->addr)] = sta;
+	return 0;
 }
 
 
@@ -99,10 +269,12 @@ static void ap_sta_hash_del(struct hostapd_data *hapd, struct sta_info *sta)
 {
 	struct sta_info *s;
 
-	s = hapd->sta_hash[STA_HASH(sta->addr)];
+	if (hapd->sta_hash == NULL)
+		return;
+	s = hapd->sta_hash[STA_HASH_IDX(hapd, sta->addr)];
 	if (s == NULL) return;
 	if (os_memcmp(s->addr, sta->addr, 6) == 0) {
-		hapd->sta_hash[STA_HASH(sta->addr)] = s->hnext;
+		hapd->sta_hash[STA_HASH_IDX(hapd, sta->addr)] = s->hnext;
 		return;
 	}
 
@@ -132,8 +304,20 @@ void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta)
 	if (!(sta->flags & WLAN_STA_PREAUTH))
 		hostapd_drv_sta_remove(hapd, sta->addr);
 
+	if (sta->generation && hapd->sta_removed) {
+		struct ap_sta_removal *r;
+		r = &hapd->sta_removed[hapd->sta_removed_next];
+		if (r->generation)
+			hapd->sta_removed_lost = r->generation;
+		os_memcpy(r->addr, sta->addr, ETH_ALEN);
+		r->generation = ++hapd->sta_generation;
+		hapd->sta_removed_next = (hapd->sta_removed_next + 1) %
+			AP_STA_REMOVED_LOG_SIZE;
+	}
+
 	ap_sta_hash_del(hapd, sta);
 	ap_sta_list_del(hapd, sta);
+	ap_sta_vlan_del(hapd, sta);
 
 	if (sta->aid > 0)
 		hapd->sta_aid[(sta->aid - 1) / 32] &=
@@ -197,7 +381,7 @@ void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta)
 
 	wpa_printf(MSG_DEBUG, "%s: cancel ap_handle_timer for " MACSTR,
 		   __func__, MAC2STR(sta->addr));
-	eloop_cancel_timeout(ap_handle_timer, hapd, sta);
+	tick_wheel_del(&sta->timer);
 	eloop_cancel_timeout(ap_handle_session_timer, hapd, sta);
 	eloop_cancel_timeout(ap_sta_deauth_cb_timeout, hapd, sta);
 	eloop_cancel_timeout(ap_sta_disassoc_cb_timeout, hapd, sta);
@@ -257,6 +441,15 @@ void hostapd_free_stas(struct hostapd_data *hapd)
 			   MAC2STR(prev->addr));
 		ap_free_sta(hapd, prev);
 	}
+
+	os_free(hapd->sta_hash);
+	hapd->sta_hash = NULL;
+	hapd->sta_hash_size = 0;
+
+	/* Delta reports from before this cannot be continued */
+	os_free(hapd->sta_removed);
+	hapd->sta_removed = NULL;
+	hapd->sta_removed_lost = hapd->sta_generation;
 }
 
 
@@ -344,8 +537,7 @@ void ap_handle_timer(void *eloop_ctx, void *timeout_ctx)
 		wpa_printf(MSG_DEBUG, "%s: register ap_handle_timer timeout "
 			   "for " MACSTR " (%lu seconds)",
 			   __func__, MAC2STR(sta->addr), next_time);
-		eloop_register_timeout(next_time, 0, ap_handle_timer, hapd,
-				       sta);
+		ap_sta_set_timer(hapd, sta, next_time);
 		return;
 	}
 
@@ -380,8 +572,7 @@ void ap_handle_timer(void *eloop_ctx, void *timeout_ctx)
 		wpa_printf(MSG_DEBUG, "%s: register ap_handle_timer timeout "
 			   "for " MACSTR " (%d seconds - AP_DISASSOC_DELAY)",
 			   __func__, MAC2STR(sta->addr), AP_DISASSOC_DELAY);
-		eloop_register_timeout(AP_DISASSOC_DELAY, 0, ap_handle_timer,
-				       hapd, sta);
+		ap_sta_set_timer(hapd, sta, AP_DISASSOC_DELAY);
 		break;
 	case STA_DISASSOC:
 		ap_sta_set_authorized(hapd, sta, 0);
@@ -399,8 +590,7 @@ void ap_handle_timer(void *eloop_ctx, void *timeout_ctx)
 		wpa_printf(MSG_DEBUG, "%s: register ap_handle_timer timeout "
 			   "for " MACSTR " (%d seconds - AP_DEAUTH_DELAY)",
 			   __func__, MAC2STR(sta->addr), AP_DEAUTH_DELAY);
-		eloop_register_timeout(AP_DEAUTH_DELAY, 0, ap_handle_timer,
-				       hapd, sta);
+		ap_sta_set_timer(hapd, sta, AP_DEAUTH_DELAY);
 		mlme_disassociate_indication(
 			hapd, sta, WLAN_REASON_DISASSOC_DUE_TO_INACTIVITY);
 		break;
@@ -421,6 +611,20 @@ void ap_handle_timer(void *eloop_ctx, void *timeout_ctx)
 }
 
 
+/**
+ * ap_sta_set_timer - (Re)start the per STA timer
+ * @hapd: Pointer to BSS data
+ * @sta: Pointer to STA info
+ * @secs: Number of seconds until ap_handle_timer() is called
+ */
+void ap_sta_set_timer(struct hostapd_data *hapd, struct sta_info *sta,
+		      unsigned int secs)
+{
+	tick_wheel_add(hapd->tick_wheel, &sta->timer, secs, ap_handle_timer,
+		       hapd, sta);
+}
+
+
 static void ap_handle_session_timer(void *eloop_ctx, void *timeout_ctx)
 {
 	struct hostapd_data *hapd = eloop_ctx;
@@ -489,19 +693,29 @@ struct sta_info * ap_sta_add(struct hostapd_data *hapd, const u8 *addr)
 		return NULL;
 	}
 	sta->acct_interim_interval = hapd->conf->acct_interim_interval;
+	os_memcpy(sta->addr, addr, ETH_ALEN);
+	if (ap_sta_hash_add(hapd, sta) < 0) {
+		wpa_printf(MSG_ERROR, "Failed to add STA to hash table");
+		os_free(sta);
+		return NULL;
+	}
+	if (ap_sta_vlan_update(hapd, sta) < 0) {
+		ap_sta_hash_del(hapd, sta);
+		os_free(sta);
+		return NULL;
+	}
 
 	/* initialize STA info data */
 	wpa_printf(MSG_DEBUG, "%s: register ap_handle_timer timeout "
 		   "for " MACSTR " (%d seconds - ap_max_inactivity)",
 		   __func__, MAC2STR(addr),
 		   hapd->conf->ap_max_inactivity);
-	eloop_register_timeout(hapd->conf->ap_max_inactivity, 0,
-			       ap_handle_timer, hapd, sta);
-	os_memcpy(sta->addr, addr, ETH_ALEN);
+	ap_sta_set_timer(hapd, sta, hapd->conf->ap_max_inactivity);
 	sta->next = hapd->sta_list;
+	if (hapd->sta_list)
+		hapd->sta_list->prev = sta;
 	hapd->sta_list = sta;
 	hapd->num_sta++;
-	ap_sta_hash_add(hapd, sta);
 	sta->ssid = &hapd->conf->ssid;
 	ap_sta_remove_in_other_bss(hapd, sta);
 
@@ -573,9 +787,7 @@ void ap_sta_disassociate(struct hostapd_data *hapd, struct sta_info *sta,
 		   "AP_MAX_INACTIVITY_AFTER_DISASSOC)",
 		   __func__, MAC2STR(sta->addr),
 		   AP_MAX_INACTIVITY_AFTER_DISASSOC);
-	eloop_cancel_timeout(ap_handle_timer, hapd, sta);
-	eloop_register_timeout(AP_MAX_INACTIVITY_AFTER_DISASSOC, 0,
-			       ap_handle_timer, hapd, sta);
+	ap_sta_set_timer(hapd, sta, AP_MAX_INACTIVITY_AFTER_DISASSOC);
 	accounting_sta_stop(hapd, sta);
 	ieee802_1x_free_station(sta);
 
@@ -612,9 +824,7 @@ void ap_sta_deauthenticate(struct hostapd_data *hapd, struct sta_info *sta,
 		   "AP_MAX_INACTIVITY_AFTER_DEAUTH)",
 		   __func__, MAC2STR(sta->addr),
 		   AP_MAX_INACTIVITY_AFTER_DEAUTH);
-	eloop_cancel_timeout(ap_handle_timer, hapd, sta);
-	eloop_register_timeout(AP_MAX_INACTIVITY_AFTER_DEAUTH, 0,
-			       ap_handle_timer, hapd, sta);
+	ap_sta_set_timer(hapd, sta, AP_MAX_INACTIVITY_AFTER_DEAUTH);
 	accounting_sta_stop(hapd, sta);
 	ieee802_1x_free_station(sta);
 
@@ -657,7 +867,20 @@ int ap_sta_bind_vlan(struct hostapd_data *hapd, struct sta_info *sta,
 	 * duplicate dynamic vlan entries.
 	 */
 	if (sta->vlan_id == old_vlanid)
-		return 0;
+		return ap_sta_vlan_update(hapd, sta);
+
+	if (sta->ssid->dynamic_vlan == DYNAMIC_VLAN_DISABLED)
+		sta->vlan_id = 0;
+
+	/*
+	 * Move the STA to the list of the new VLAN before any VLAN references
+	 * are changed so that an allocation failure leaves the old binding
+	 * intact; the caller rejects the STA in that case.
+	 */
+	if (ap_sta_vlan_update(hapd, sta) < 0) {
+		sta->vlan_id = old_vlanid;
+		return -1;
+	}
 
 	/*
 	 * During 1x reauth, if the vlan id changes, then remove the old id and
@@ -670,9 +893,7 @@ int ap_sta_bind_vlan(struct hostapd_data *hapd, struct sta_info *sta,
 	if (sta->ssid->vlan[0])
 		iface = sta->ssid->vlan;
 
-	if (sta->ssid->dynamic_vlan == DYNAMIC_VLAN_DISABLED)
-		sta->vlan_id = 0;
-	else if (sta->vlan_id > 0) {
+	if (sta->vlan_id > 0) {
 		vlan = hapd->conf->vlan;
 		while (vlan) {
 			if (vlan->vlan_id == sta->vlan_id ||
@@ -764,9 +985,9 @@ int ap_sta_bind_vlan(struct hostapd_data *hapd, struct sta_info *sta,
 int ap_check_sa_query_timeout(struct hostapd_data *hapd, struct sta_info *sta)
 {
 	u32 tu;
-	struct os_time now, passed;
-	os_get_time(&now);
-	os_time_sub(&now, &sta->sa_query_start, &passed);
+	struct os_reltime now, passed;
+	os_get_reltime(&now);
+	os_reltime_sub(&now, &sta->sa_query_start, &passed);
 	tu = (passed.sec * 1000000 + passed.usec) / 1024;
 	if (hapd->conf->assoc_sa_query_max_timeout < tu) {
 		hostapd_logger(hapd, sta->addr,
@@ -802,7 +1023,7 @@ static void ap_sa_query_timer(void *eloop_ctx, void *timeout_ctx)
 		return;
 	if (sta->sa_query_count == 0) {
 		/* Starting a new SA Query procedure */
-		os_get_time(&sta->sa_query_start);
+		os_get_reltime(&sta->sa_query_start);
 	}
 	trans_id = nbuf + sta->sa_query_count * WLAN_SA_QUERY_TR_ID_LEN;
 	sta->sa_query_trans_id = nbuf;
@@ -932,9 +1153,7 @@ void ap_sta_disconnect(struct hostapd_data *hapd, struct sta_info *sta,
 		   "AP_MAX_INACTIVITY_AFTER_DEAUTH)",
 		   __func__, MAC2STR(sta->addr),
 		   AP_MAX_INACTIVITY_AFTER_DEAUTH);
-	eloop_cancel_timeout(ap_handle_timer, hapd, sta);
-	eloop_register_timeout(AP_MAX_INACTIVITY_AFTER_DEAUTH, 0,
-			       ap_handle_timer, hapd, sta);
+	ap_sta_set_timer(hapd, sta, AP_MAX_INACTIVITY_AFTER_DEAUTH);
 	sta->timeout_next = STA_REMOVE;
 
 	sta->deauth_reason = reason;
@@ -991,3 +1210,61 @@ void ap_sta_cancel_priority(struct hostapd_data *hapd, struct sta_info *sta)
 	if (!--hapd->num_priorities)
 		hostapd_drv_cancel_priority(hapd);
 }
+
+
+/**
+ * ap_sta_generation_init - Start tracking STA changes for ALL_STA
+ * @hapd: Pointer to BSS data
+ * Returns: 0 on success, -1 on failure
+ *
+ * Until this is called, STA changes and removals are not recorded, so there
+ * is no cost for BSSes whose STAs are not monitored.
+ */
+int ap_sta_generation_init(struct hostapd_data *hapd)
+{
+	if (hapd->sta_removed)
+		return 0;
+
+	hapd->sta_removed = os_zalloc(AP_STA_REMOVED_LOG_SIZE *
+				      sizeof(struct ap_sta_removal));
+	if (hapd->sta_removed == NULL)
+		return -1;
+	hapd->sta_removed_next = 0;
+	if (hapd->sta_generation_id == 0 &&
+	    os_get_random((u8 *) &hapd->sta_generation_id,
+			  sizeof(hapd->sta_generation_id)) < 0) {
+		struct os_time now;
+		os_get_time(&now);
+		hapd->sta_generation_id = now.sec ^ now.usec;
+	}
+	return 0;
+}
+
+
+/**
+ * ap_sta_update_generation - Assign a new generation to a changed STA
+ * @hapd: Pointer to BSS data
+ * @sta: Pointer to the STA
+ *
+ * Changes are found by comparing a summary of the values reported with the
+ * STA MIB to the one stored when the STA was last reported, so the STA
+ * entry does not need to be marked by every code path that modifies it.
+ */
+void ap_sta_update_generation(struct hostapd_data *hapd, struct sta_info *sta)
+{
+	u32 state;
+
+	state = sta->flags & ~(WLAN_STA_PS | WLAN_STA_TIM |
+			       WLAN_STA_PENDING_POLL);
+	state = state * 31 + sta->aid;
+	state = state * 31 + sta->capability;
+	state = state * 31 + sta->listen_interval;
+	state = state * 31 + sta->vlan_id;
+	state = state * 31 + wpa_get_mib_sta_state(sta->wpa_sm);
+	state = state * 31 + ieee802_1x_get_mib_sta_state(sta);
+
+	if (sta->generation && sta->state_hash == state)
+		return;
+	sta->state_hash = state;
+	sta->generation = ++hapd->sta_generation;
+}
@@ -9,6 +9,8 @@
 #ifndef STA_INFO_H
 #define STA_INFO_H
 
+#include "utils/tick_wheel.h"
+
 /* STA flags */
 #define WLAN_STA_AUTH BIT(0)
 #define WLAN_STA_ASSOC BIT(1)
@@ -39,7 +41,11 @@
 
 struct sta_info {
 	struct sta_info *next; /* next entry in sta list */
+	struct sta_info *prev; /* previous entry in sta list */
 	struct sta_info *hnext; /* next entry in hash table list */
+	struct hostapd_sta_vlan *vlan_list; /* per-VLAN list of this STA */
+	struct sta_info *vlan_next; /* next entry in per-VLAN list */
+	struct sta_info *vlan_prev; /* previous entry in per-VLAN list */
 	u8 addr[6];
 	u16 aid; /* STA's unique AID (1 .. 2007) or 0 if not yet assigned */
 	u32 flags; /* Bitfield of WLAN_STA_* */
@@ -64,6 +70,7 @@ struct sta_info {
 	enum {
 		STA_NULLFUNC = 0, STA_DISASSOC, STA_DEAUTH, STA_REMOVE
 	} timeout_next;
+	struct tick_wheel_entry timer; /* ap_handle_timer() */
 
 	u16 deauth_reason;
 	u16 disassoc_reason;
@@ -106,7 +113,7 @@ struct sta_info {
 	u8 *sa_query_trans_id; /* buffer of WLAN_SA_QUERY_TR_ID_LEN *
 				* sa_query_count octets of pending SA Query
 				* transaction identifiers */
-	struct os_time sa_query_start;
+	struct os_reltime sa_query_start;
 #endif /* CONFIG_IEEE80211W */
 
 #ifdef CONFIG_INTERWORKING
@@ -117,6 +124,22 @@ struct sta_info {
 
 	struct wpabuf *wps_ie; /* WPS IE from (Re)Association Request */
 	struct wpabuf *p2p_ie; /* P2P IE from (Re)Association Request */
+
+	u32 generation; /* ALL_STA generation of the last reported change or 0
+			 * if the STA has not yet been reported */
+	u32 state_hash; /* summary of the state reported with generation */
+};
+
+
+/* Number of removed STAs remembered for ALL_STA delta reports */
+#define AP_STA_REMOVED_LOG_SIZE 128
+
+/**
+ * struct ap_sta_removal - Removed STA entry for ALL_STA delta reports
+ */
+struct ap_sta_removal {
+	u8 addr[ETH_ALEN];
+	u32 generation; /* 0 = unused entry */
 };
 
 
@@ -136,17 +159,35 @@ struct sta_info {
 #define AP_MAX_INACTIVITY_AFTER_DEAUTH (1 * 5)
 
 
+/**
+ * struct hostapd_sta_vlan - List of STAs bound to a VLAN ID
+ */
+struct hostapd_sta_vlan {
+	struct hostapd_sta_vlan *next;
+	int vlan_id;
+	int num_sta;
+	struct sta_info *sta_list;
+};
+
+
 struct hostapd_data;
 
 int ap_for_each_sta(struct hostapd_data *hapd,
 		    int (*cb)(struct hostapd_data *hapd, struct sta_info *sta,
 			      void *ctx),
 		    void *ctx);
+int ap_for_each_sta_vlan(struct hostapd_data *hapd, int vlan_id,
+			 int (*cb)(struct hostapd_data *hapd,
+				   struct sta_info *sta, void *ctx),
+			 void *ctx);
 struct sta_info * ap_get_sta(struct hostapd_data *hapd, const u8 *sta);
-void ap_sta_hash_add(struct hostapd_data *hapd, struct sta_info *sta);
+int ap_sta_hash_add(struct hostapd_data *hapd, struct sta_info *sta);
+int ap_sta_vlan_update(struct hostapd_data *hapd, struct sta_info *sta);
 void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta);
 void hostapd_free_stas(struct hostapd_data *hapd);
 void ap_handle_timer(void *eloop_ctx, void *timeout_ctx);
+void ap_sta_set_timer(struct hostapd_data *hapd, struct sta_info *sta,
+		      unsigned int secs);
 void ap_sta_session_timeout(struct hostapd_data *hapd, struct sta_info *sta,
 			    u32 session_timeout);
 void ap_sta_no_session_timeout(struct hostapd_data *hapd,
@@ -179,5 +220,7 @@ void ap_sta_deauth_cb(struct hostapd_data *hapd, struct sta_info *sta);
 void ap_sta_disassoc_cb(struct hostapd_data *hapd, struct sta_info *sta);
 void ap_sta_set_priority(struct hostapd_data *hapd, struct sta_info *sta);
 void ap_sta_cancel_priority(struct hostapd_data *hapd, struct sta_info *sta);
+int ap_sta_generation_init(struct hostapd_data *hapd);
+void ap_sta_update_generation(struct hostapd_data *hapd, struct sta_info *sta);
 
 #endif /* STA_INFO_H */
@@ -0,0 +1,406 @@
+/*
+ * hostapd / Persistent state store
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * State that allows stations to resume their security associations after
+ * hostapd has been restarted (PMKSA cache entries, FT key holder keys, and
+ * the Acct-Session-Id epoch) is kept in a file that is memory mapped into the
+ * process. The file consists of a header and fixed size slots; each record is
+ * written into its slot when it is created and the slot is released when the
+ * record is removed, so the file is up to date even if hostapd is killed
+ * without a chance to clean up.
+ *
+ * Records that are not claimed by any BSS once the interface has been set up
+ * (e.g., for a BSSID that is no longer configured) are released with
+ * state_store_gc(). Expired records are released when the store is opened;
+ * while hostapd is running, the owner of a record releases it when the entry
+ * it belongs to expires or is removed.
+ */
+
+#include "utils/includes.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "utils/common.h"
+#include "state_store.h"
+
+
+#define STATE_STORE_MAGIC 0x48415053 /* "HAPS" */
+#define STATE_STORE_VERSION 1
+
+struct state_store_hdr {
+	u32 magic;
+	u32 version;
+	u32 slots;
+	u32 slot_size;
+};
+
+struct state_store_record {
+	u32 type; /* enum state_store_type; written last */
+	u32 len;
+	u32 expires; /* os_get_time() seconds or 0 if the record does not
+		      * expire */
+	u8 addr[ETH_ALEN]; /* BSSID of the owner of the record */
+	u8 pad[2];
+	/* followed by len octets of data */
+};
+
+struct state_store {
+	int fd;
+	u8 *map;
+	size_t map_len;
+	unsigned int slots;
+	unsigned int slot_size;
+	unsigned int *free_slots;
+	unsigned int num_free;
+	u8 *claimed; /* per slot: record is owned by a BSS in this process */
+	int full_reported;
+};
+
+
+static struct state_store_record *
+state_store_record(struct state_store *store, unsigned int slot)
+{
+	return (struct state_store_record *)
+		(store->map + sizeof(struct state_store_hdr) +
+		 (size_t) slot * store->slot_size);
+}
+
+
+static int state_store_map(struct state_store *store, const char *fname)
+{
+	struct state_store_hdr *hdr;
+	struct stat st;
+	int init = 0;
+
+	store->fd = open(fname, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+	if (store->fd < 0) {
+		wpa_printf(MSG_ERROR, "State store: Could not open '%s': %s",
+			   fname, strerror(errno));
+		return -1;
+	}
+
+	if (fstat(store->fd, &st) < 0)
+		return -1;
+	if ((size_t) st.st_size != store->map_len)
+		init = 1;
+
+	if (init &&
+	    (ftruncate(store->fd, 0) < 0 ||
+	     ftruncate(store->fd, store->map_len) < 0)) {
+		wpa_printf(MSG_ERROR, "State store: Could not resize '%s': %s",
+			   fname, strerror(errno));
+		return -1;
+	}
+
+	store->map = mmap(NULL, store->map_len, PROT_READ | PROT_WRITE,
+			  MAP_SHARED, store->fd, 0);
+	if (store->map == MAP_FAILED) {
+		store->map = NULL;
+		wpa_printf(MSG_ERROR, "State store: Could not map '%s': %s",
+			   fname, strerror(errno));
+		return -1;
+	}
+
+	hdr = (struct state_store_hdr *) store->map;
+	if (!init &&
+	    (hdr->magic != STATE_STORE_MAGIC ||
+	     hdr->version != STATE_STORE_VERSION ||
+	     hdr->slots != store->slots ||
+	     hdr->slot_size != store->slot_size)) {
+		wpa_printf(MSG_INFO, "State store: '%s' does not match the "
+			   "configuration - discard old state", fname);
+		os_memset(store->map, 0, store->map_len);
+		init = 1;
+	}
+	if (init) {
+		hdr->magic = STATE_STORE_MAGIC;
+		hdr->version = STATE_STORE_VERSION;
+		hdr->slots = store->slots;
+		hdr->slot_size = store->slot_size;
+	}
+
+	return 0;
+}
+
+
+/**
+ * state_store_open - Open (and create if needed) a persistent state store
+ * @fname: File name for the store
+ * @slots: Maximum number of records
+ * @slot_size: Size of a record slot in octets (including a 20 octet header)
+ * Returns: Pointer to the store or %NULL on failure
+ *
+ * Expired records and records in an unused slot are released; the remaining
+ * ones are available through state_store_for_each(). If the file was created
+ * with a different number or size of slots, the old state is discarded.
+ */
+struct state_store * state_store_open(const char *fname, unsigned int slots,
+				      unsigned int slot_size)
+{
+	struct state_store *store;
+	struct state_store_record *rec;
+	struct os_time now;
+	unsigned int i, count = 0;
+
+	slot_size = (slot_size + 15) & ~15;
+	if (slots == 0 || slot_size <= sizeof(*rec))
+		return NULL;
+
+	store = os_zalloc(sizeof(*store));
+	if (store == NULL)
+		return NULL;
+	store->fd = -1;
+	store->slots = slots;
+	store->slot_size = slot_size;
+	store->map_len = sizeof(struct state_store_hdr) +
+		(size_t) slots * slot_size;
+	store->free_slots = os_malloc(slots * sizeof(unsigned int));
+	store->claimed = os_zalloc(slots);
+	if (store->free_slots == NULL || store->claimed == NULL ||
+	    state_store_map(store, fname) < 0) {
+		state_store_close(store);
+		return NULL;
+	}
+
+	os_get_time(&now);
+	/* Push free slots in reverse order to use the lowest ones first */
+	for (i = slots; i > 0; i--) {
+		rec = state_store_record(store, i - 1);
+		if (rec->type == STATE_STORE_FREE)
+			goto free_slot;
+		if (rec->type > STATE_STORE_ACCT ||
+		    rec->len > slot_size - sizeof(*rec) ||
+		    (rec->expires && (os_time_t) rec->expires <= now.sec)) {
+			rec->type = STATE_STORE_FREE;
+			goto free_slot;
+		}
+		count++;
+		continue;
+	free_slot:
+		store->free_slots[store->num_free++] = i - 1;
+	}
+
+	wpa_printf(MSG_DEBUG, "State store: %u record(s) in '%s' (%u slots)",
+		   count, fname, slots);
+
+	return store;
+}
+
+
+/**
+ * state_store_close - Close a persistent state store
+ * @store: Store from state_store_open() or %NULL
+ *
+ * The records remain in the file for the next state_store_open().
+ */
+void state_store_close(struct state_store *store)
+{
+	if (store == NULL)
+		return;
+	if (store->map) {
+		msync(store->map, store->map_len, MS_SYNC);
+		munmap(store->map, store->map_len);
+	}
+	if (store->fd >= 0)
+		close(store->fd);
+	os_free(store->free_slots);
+	os_free(store->claimed);
+	os_free(store);
+}
+
+
+/**
+ * state_store_max_len - Maximum length of record data
+ * @store: Store from state_store_open() or %NULL
+ * Returns: Maximum length of the data in a record in octets
+ */
+size_t state_store_max_len(struct state_store *store)
+{
+	if (store == NULL)
+		return 0;
+	return store->slot_size - sizeof(struct state_store_record);
+}
+
+
+static void state_store_free_slot(struct state_store *store,
+				  unsigned int slot)
+{
+	state_store_record(store, slot)->type = STATE_STORE_FREE;
+	store->claimed[slot] = 0;
+	store->free_slots[store->num_free++] = slot;
+	store->full_reported = 0;
+}
+
+
+/**
+ * state_store_add - Add a record into the state store
+ * @store: Store from state_store_open() or %NULL
+ * @type: Record type
+ * @addr: BSSID of the owner of the record
+ * @expires: Expiration time (os_get_time() seconds) or 0 for no expiration
+ * @data: Record data
+ * @len: Length of the data (at most state_store_max_len())
+ * Returns: Slot number for the record or -1 if it could not be stored
+ */
+int state_store_add(struct state_store *store, enum state_store_type type,
+		    const u8 *addr, os_time_t expires, const void *data,
+		    size_t len)
+{
+	struct state_store_record *rec;
+	unsigned int slot;
+
+	if (store == NULL || len > state_store_max_len(store))
+		return -1;
+	if (store->num_free == 0) {
+		if (!store->full_reported)
+			wpa_printf(MSG_WARNING, "State store: All %u slots in "
+				   "use - new state is not saved over a "
+				   "restart", store->slots);
+		store->full_reported = 1;
+		return -1;
+	}
+
+	slot = store->free_slots[--store->num_free];
+	store->claimed[slot] = 1;
+	rec = state_store_record(store, slot);
+	rec->len = len;
+	rec->expires = expires;
+	os_memcpy(rec->addr, addr, ETH_ALEN);
+	os_memcpy(rec + 1, data, len);
+	/* Mark the slot used only after the data is in place */
+	rec->type = type;
+
+	return slot;
+}
+
+
+/**
+ * state_store_update - Replace the data of a record
+ * @store: Store from state_store_open() or %NULL
+ * @slot: Slot number from state_store_add() or state_store_for_each()
+ * @data: New record data
+ * @len: Length of the data (at most state_store_max_len())
+ * Returns: 0 on success, -1 on failure
+ */
+int state_store_update(struct state_store *store, int slot,
+		       const void *data, size_t len)
+{
+	struct state_store_record *rec;
+
+	if (store == NULL || slot < 0 || (unsigned int) slot >= store->slots ||
+	    len > state_store_max_len(store))
+		return -1;
+	rec = state_store_record(store, slot);
+	os_memcpy(rec + 1, data, len);
+	rec->len = len;
+	return 0;
+}
+
+
+/**
+ * state_store_del - Remove a record from the state store
+ * @store: Store from state_store_open() or %NULL
+ * @slot: Slot number from state_store_add() or state_store_for_each()
+ */
+void state_store_del(struct state_store *store, int slot)
+{
+	struct state_store_record *rec;
+
+	if (store == NULL || slot < 0 || (unsigned int) slot >= store->slots)
+		return;
+	rec = state_store_record(store, slot);
+	if (rec->type == STATE_STORE_FREE)
+		return;
+	state_store_free_slot(store, slot);
+}
+
+
+/**
+ * state_store_expires - Expiration time of a record
+ * @store: Store from state_store_open() or %NULL
+ * @slot: Slot number from state_store_add() or state_store_for_each()
+ * Returns: Expiration time (os_get_time() seconds) or 0 if the record does not
+ * expire
+ */
+os_time_t state_store_expires(struct state_store *store, int slot)
+{
+	if (store == NULL || slot < 0 || (unsigned int) slot >= store->slots)
+		return 0;
+	return state_store_record(store, slot)->expires;
+}
+
+
+/**
+ * state_store_for_each - Iterate over stored records
+ * @store: Store from state_store_open() or %NULL
+ * @type: Record type
+ * @addr: BSSID of the owner of the records
+ * @cb: Callback function; a negative return value removes the record
+ * @ctx: Context pointer for the callback
+ * Returns: Number of records that were kept
+ *
+ * This is used to restore state when a BSS is started. The callback is
+ * expected to take ownership of the slot number for the records it keeps.
+ */
+int state_store_for_each(struct state_store *store,
+			 enum state_store_type type, const u8 *addr,
+			 int (*cb)(void *ctx, int slot, const u8 *data,
+				   size_t len),
+			 void *ctx)
+{
+	struct state_store_record *rec;
+	unsigned int i;
+	int count = 0;
+
+	if (store == NULL)
+		return 0;
+
+	for (i = 0; i < store->slots; i++) {
+		rec = state_store_record(store, i);
+		if (rec->type != (u32) type ||
+		    os_memcmp(rec->addr, addr, ETH_ALEN) != 0)
+			continue;
+		if (cb(ctx, i, (const u8 *) (rec + 1), rec->len) < 0)
+			state_store_del(store, i);
+		else {
+			store->claimed[i] = 1;
+			count++;
+		}
+	}
+
+	return count;
+}
+
+
+/**
+ * state_store_gc - Release records that were not claimed
+ * @store: Store from state_store_open() or %NULL
+ *
+ * This is called once all BSSes using the store have been set up and have
+ * restored their state with state_store_for_each(). Records that no BSS kept,
+ * e.g., ones for a BSSID that is no longer in the configuration, are removed.
+ */
+void state_store_gc(struct state_store *store)
+{
+	unsigned int i, count = 0;
+
+	if (store == NULL)
+		return;
+
+	for (i = 0; i < store->slots; i++) {
+		if (state_store_record(store, i)->type == STATE_STORE_FREE ||
+		    store->claimed[i])
+			continue;
+		state_store_free_slot(store, i);
+		count++;
+	}
+
+	if (count)
+		wpa_printf(MSG_DEBUG, "State store: Removed %u unclaimed "
+			   "record(s)", count);
+}
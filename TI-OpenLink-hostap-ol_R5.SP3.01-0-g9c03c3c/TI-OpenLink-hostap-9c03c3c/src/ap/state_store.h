@@ -0,0 +1,93 @@
+/*
+ * hostapd / Persistent state store
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef STATE_STORE_H
+#define STATE_STORE_H
+
+/* Record slot size used by hostapd; fits a PMKSA cache entry with identity
+ * and a few RADIUS Class attributes */
+#define HOSTAPD_STATE_SLOT_SIZE 1024
+
+enum state_store_type {
+	STATE_STORE_FREE = 0,
+	STATE_STORE_PMKSA = 1,
+	STATE_STORE_FT_R0 = 2,
+	STATE_STORE_FT_R1 = 3,
+	STATE_STORE_ACCT = 4
+};
+
+struct state_store;
+
+#ifdef CONFIG_STATE_STORE
+
+struct state_store * state_store_open(const char *fname, unsigned int slots,
+				      unsigned int slot_size);
+void state_store_close(struct state_store *store);
+size_t state_store_max_len(struct state_store *store);
+int state_store_add(struct state_store *store, enum state_store_type type,
+		    const u8 *addr, os_time_t expires, const void *data,
+		    size_t len);
+int state_store_update(struct state_store *store, int slot,
+		       const void *data, size_t len);
+void state_store_del(struct state_store *store, int slot);
+os_time_t state_store_expires(struct state_store *store, int slot);
+int state_store_for_each(struct state_store *store,
+			 enum state_store_type type, const u8 *addr,
+			 int (*cb)(void *ctx, int slot, const u8 *data,
+				   size_t len),
+			 void *ctx);
+void state_store_gc(struct state_store *store);
+
+#else /* CONFIG_STATE_STORE */
+
+static inline size_t state_store_max_len(struct state_store *store)
+{
+	return 0;
+}
+
+static inline int state_store_add(struct state_store *store,
+				  enum state_store_type type, const u8 *addr,
+				  os_time_t expires, const void *data,
+				  size_t len)
+{
+	return -1;
+}
+
+static inline int state_store_update(struct state_store *store, int slot,
+				     const void *data, size_t len)
+{
+	return -1;
+}
+
+static inline void state_store_del(struct state_store *store, int slot)
+{
+}
+
+static inline os_time_t state_store_expires(struct state_store *store,
+					    int slot)
+{
+	return 0;
+}
+
+static inline int
+state_store_for_each(struct state_store *store, enum state_store_type type,
+		     const u8 *addr,
+		     int (*cb)(void *ctx, int slot, const u8 *data,
+			       size_t len),
+		     void *ctx)
+{
+	return 0;
+}
+
+static inline void state_store_gc(struct state_store *store)
+{
+}
+
+#endif /* CONFIG_STATE_STORE */
+
+#endif /* STATE_STORE_H */
@@ -41,6 +41,8 @@ static int wpa_gtk_update(struct wpa_authenticator *wpa_auth,
 			  struct wpa_group *group);
 static int wpa_group_config_group_keys(struct wpa_authenticator *wpa_auth,
 				       struct wpa_group *group);
+static void wpa_group_rekey_pace(void *eloop_ctx, void *timeout_ctx);
+static void wpa_group_clear_rekey_kde(struct wpa_group *group);
 
 static const u32 dot11RSNAConfigGroupUpdateCount = 4;
 static const u32 dot11RSNAConfigPairwiseUpdateCount = 4;
@@ -140,6 +142,18 @@ int wpa_auth_for_each_sta(struct wpa_authenticator *wpa_auth,
 }
 
 
+int wpa_auth_for_each_sta_vlan(struct wpa_authenticator *wpa_auth, int vlan_id,
+			       int (*cb)(struct wpa_state_machine *sm,
+					 void *ctx),
+			       void *cb_ctx)
+{
+	if (wpa_auth->cb.for_each_sta_vlan == NULL)
+		return wpa_auth_for_each_sta(wpa_auth, cb, cb_ctx);
+	return wpa_auth->cb.for_each_sta_vlan(wpa_auth->cb.ctx, vlan_id, cb,
+					      cb_ctx);
+}
+
+
 int wpa_auth_for_each_auth(struct wpa_authenticator *wpa_auth,
 			   int (*cb)(struct wpa_authenticator *a, void *ctx),
 			   void *cb_ctx)
@@ -338,6 +352,7 @@ static struct wpa_group * wpa_group_init(struct wpa_authenticator *wpa_auth,
 
 	group->GTKAuthenticator = TRUE;
 	group->vlan_id = vlan_id;
+	dl_list_init(&group->gkey_queue);
 
 	wpa_group_set_key_len(group, wpa_auth->conf.wpa_group);
 
@@ -416,6 +431,11 @@ struct wpa_authenticator * wpa_init(const u8 *addr,
 		os_free(wpa_auth);
 		return NULL;
 	}
+	pmksa_cache_auth_set_max_mem(wpa_auth->pmksa,
+				     wpa_auth->conf.pmksa_cache_max_mem);
+	if (wpa_auth->conf.pmksa_cache_file)
+		pmksa_cache_auth_read(wpa_auth->pmksa,
+				      wpa_auth->conf.pmksa_cache_file);
 
 #ifdef CONFIG_IEEE80211R
 	wpa_auth->ft_pmk_cache = wpa_ft_pmk_cache_init();
@@ -465,12 +485,16 @@ void wpa_deinit(struct wpa_authenticator *wpa_auth)
 
 	eloop_cancel_timeout(wpa_rekey_gmk, wpa_auth, NULL);
 	eloop_cancel_timeout(wpa_rekey_gtk, wpa_auth, NULL);
+	eloop_cancel_timeout(wpa_group_rekey_pace, wpa_auth, ELOOP_ALL_CTX);
 
 #ifdef CONFIG_PEERKEY
 	while (wpa_auth->stsl_negotiations)
 		wpa_stsl_remove(wpa_auth, wpa_auth->stsl_negotiations);
 #endif /* CONFIG_PEERKEY */
 
+	if (wpa_auth->conf.pmksa_cache_file)
+		pmksa_cache_auth_write(wpa_auth->pmksa,
+				       wpa_auth->conf.pmksa_cache_file);
 	pmksa_cache_auth_deinit(wpa_auth->pmksa);
 
 #ifdef CONFIG_IEEE80211R
@@ -484,6 +508,7 @@ void wpa_deinit(struct wpa_authenticator *wpa_auth)
 	while (group) {
 		prev = group;
 		group = group->next;
+		wpa_group_clear_rekey_kde(prev);
 		os_free(prev);
 	}
 
@@ -504,6 +529,8 @@ int wpa_reconfig(struct wpa_authenticator *wpa_auth,
 		return 0;
 
 	os_memcpy(&wpa_auth->conf, conf, sizeof(*conf));
+	pmksa_cache_auth_set_max_mem(wpa_auth->pmksa,
+				     wpa_auth->conf.pmksa_cache_max_mem);
 	if (wpa_auth_gen_wpa_ie(wpa_auth)) {
 		wpa_printf(MSG_ERROR, "Could not generate WPA IE.");
 		return -1;
@@ -524,6 +551,27 @@ int wpa_reconfig(struct wpa_authenticator *wpa_auth,
 }
 
 
+/**
+ * wpa_auth_set_state_store - Keep key caches in a persistent state store
+ * @wpa_auth: Pointer to WPA authenticator data from wpa_init()
+ * @store: State store or %NULL
+ *
+ * PMKSA cache entries and FT PMK-R0/R1 keys from the previous run are restored
+ * and the caches are written into the store as they change, so stations can
+ * use PMKSA caching and FT over a restart of the authenticator.
+ */
+void wpa_auth_set_state_store(struct wpa_authenticator *wpa_auth,
+			      struct state_store *store)
+{
+	if (wpa_auth == NULL || store == NULL)
+		return;
+	pmksa_cache_auth_set_store(wpa_auth->pmksa, store, wpa_auth->addr);
+#ifdef CONFIG_IEEE80211R
+	wpa_ft_set_state_store(wpa_auth, store);
+#endif /* CONFIG_IEEE80211R */
+}
+
+
 struct wpa_state_machine *
 wpa_auth_sta_init(struct wpa_authenticator *wpa_auth, const u8 *addr)
 {
@@ -593,6 +641,8 @@ static void wpa_free_sta_sm(struct wpa_state_machine *sm)
 		sm->group->GKeyDoneStations--;
 		sm->GUpdateStationKeys = FALSE;
 	}
+	if (sm->gkey_queued)
+		dl_list_del(&sm->gkey_list);
 #ifdef CONFIG_IEEE80211R
 	os_free(sm->assoc_resp_ftie);
 #endif /* CONFIG_IEEE80211R */
@@ -619,7 +669,7 @@ void wpa_auth_sta_deinit(struct wpa_state_machine *sm)
 	eloop_cancel_timeout(wpa_send_eapol_timeout, sm->wpa_auth, sm);
 	sm->pending_1_of_4_timeout = 0;
 	eloop_cancel_timeout(wpa_sm_call_step, sm, NULL);
-	eloop_cancel_timeout(wpa_rekey_ptk, sm->wpa_auth, sm);
+	tick_wheel_del(&sm->ptk_rekey_timer);
 	if (sm->in_step_loop) {
 		/* Must not free state machine while wpa_sm_step() is running.
 		 * Freeing will be completed in the end of wpa_sm_step(). */
@@ -1445,7 +1495,7 @@ void wpa_remove_ptk(struct wpa_state_machine *sm)
 	os_memset(&sm->PTK, 0, sizeof(sm->PTK));
 	wpa_auth_set_key(sm->wpa_auth, 0, WPA_ALG_NONE, sm->addr, 0, NULL, 0);
 	sm->pairwise_set = FALSE;
-	eloop_cancel_timeout(wpa_rekey_ptk, sm->wpa_auth, sm);
+	tick_wheel_del(&sm->ptk_rekey_timer);
 }
 
 
@@ -2089,10 +2139,10 @@ SM_STATE(WPA_PTK, PTKINITDONE)
 		sm->pairwise_set = TRUE;
 
 		if (sm->wpa_auth->conf.wpa_ptk_rekey) {
-			eloop_cancel_timeout(wpa_rekey_ptk, sm->wpa_auth, sm);
-			eloop_register_timeout(sm->wpa_auth->conf.
-					       wpa_ptk_rekey, 0, wpa_rekey_ptk,
-					       sm->wpa_auth, sm);
+			tick_wheel_add(sm->wpa_auth->conf.tick_wheel,
+				       &sm->ptk_rekey_timer,
+				       sm->wpa_auth->conf.wpa_ptk_rekey,
+				       wpa_rekey_ptk, sm->wpa_auth, sm);
 		}
 
 		if (wpa_key_mgmt_wpa_psk(sm->wpa_key_mgmt)) {
@@ -2238,6 +2288,68 @@ SM_STEP(WPA_PTK)
 }
 
 
+static unsigned int wpa_ms_since(struct os_reltime *start)
+{
+	struct os_reltime now, diff;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	if (diff.sec < 0)
+		return 0;
+	return diff.sec * 1000 + diff.usec / 1000;
+}
+
+
+/*
+ * The Key Data of group key msg 1/2 is the same for all STAs of the group
+ * until the new GTK is taken into use in SETKEYSDONE (the RSC and IPN are
+ * zero), so it is built once per rekey for each Key Data variant.
+ */
+static const u8 * wpa_group_rekey_kde(struct wpa_state_machine *sm,
+				      size_t *len)
+{
+	struct wpa_group *gsm = sm->group;
+	int igtk = ieee80211w_kde_len(sm) > 0;
+	u8 *kde, *pos, hdr[2];
+	size_t kde_len;
+
+	if (gsm->rekey_kde[igtk] == NULL) {
+		kde_len = 2 + RSN_SELECTOR_LEN + 2 + gsm->GTK_len +
+			ieee80211w_kde_len(sm);
+		kde = os_malloc(kde_len);
+		if (kde == NULL)
+			return NULL;
+
+		pos = kde;
+		hdr[0] = gsm->GN & 0x03;
+		hdr[1] = 0;
+		pos = wpa_add_kde(pos, RSN_KEY_DATA_GROUPKEY, hdr, 2,
+				  gsm->GTK[gsm->GN - 1], gsm->GTK_len);
+		pos = ieee80211w_kde_add(sm, pos);
+		gsm->rekey_kde[igtk] = kde;
+		gsm->rekey_kde_len[igtk] = pos - kde;
+	}
+
+	*len = gsm->rekey_kde_len[igtk];
+	return gsm->rekey_kde[igtk];
+}
+
+
+static void wpa_group_clear_rekey_kde(struct wpa_group *group)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		if (group->rekey_kde[i] == NULL)
+			continue;
+		os_memset(group->rekey_kde[i], 0, group->rekey_kde_len[i]);
+		os_free(group->rekey_kde[i]);
+		group->rekey_kde[i] = NULL;
+		group->rekey_kde_len[i] = 0;
+	}
+}
+
+
 SM_STATE(WPA_PTK_GROUP, IDLE)
 {
 	SM_ENTRY_MA(WPA_PTK_GROUP, IDLE, wpa_ptk_group);
@@ -2254,7 +2366,8 @@ SM_STATE(WPA_PTK_GROUP, REKEYNEGOTIATING)
 {
 	u8 rsc[WPA_KEY_RSC_LEN];
 	struct wpa_group *gsm = sm->group;
-	u8 *kde, *pos, hdr[2];
+	const u8 *kde;
+	u8 *kde_buf = NULL, *pos, hdr[2];
 	size_t kde_len;
 
 	SM_ENTRY_MA(WPA_PTK_GROUP, REKEYNEGOTIATING, wpa_ptk_group);
@@ -2265,6 +2378,8 @@ SM_STATE(WPA_PTK_GROUP, REKEYNEGOTIATING)
 		 * immediately following this. */
 		return;
 	}
+	if (sm->GTimeoutCtr == 1)
+		os_get_reltime(&sm->gkey_start);
 
 	if (sm->wpa == WPA_VERSION_WPA)
 		sm->PInitAKeys = FALSE;
@@ -2276,40 +2391,54 @@ SM_STATE(WPA_PTK_GROUP, REKEYNEGOTIATING)
 	wpa_auth_logger(sm->wpa_auth, sm->addr, LOGGER_DEBUG,
 			"sending 1/2 msg of Group Key Handshake");
 
-	if (sm->wpa == WPA_VERSION_WPA2) {
+	if (sm->wpa == WPA_VERSION_WPA2 &&
+	    gsm->wpa_group_state == WPA_GROUP_SETKEYS) {
+		kde = wpa_group_rekey_kde(sm, &kde_len);
+		if (kde == NULL)
+			return;
+	} else if (sm->wpa == WPA_VERSION_WPA2) {
 		kde_len = 2 + RSN_SELECTOR_LEN + 2 + gsm->GTK_len +
 			ieee80211w_kde_len(sm);
-		kde = os_malloc(kde_len);
-		if (kde == NULL)
+		kde_buf = os_malloc(kde_len);
+		if (kde_buf == NULL)
 			return;
 
-		pos = kde;
+		pos = kde_buf;
 		hdr[0] = gsm->GN & 0x03;
 		hdr[1] = 0;
 		pos = wpa_add_kde(pos, RSN_KEY_DATA_GROUPKEY, hdr, 2,
 				  gsm->GTK[gsm->GN - 1], gsm->GTK_len);
 		pos = ieee80211w_kde_add(sm, pos);
+		kde = kde_buf;
+		kde_len = pos - kde_buf;
 	} else {
 		kde = gsm->GTK[gsm->GN - 1];
-		pos = kde + gsm->GTK_len;
+		kde_len = gsm->GTK_len;
 	}
 
 	wpa_send_eapol(sm->wpa_auth, sm,
 		       WPA_KEY_INFO_SECURE | WPA_KEY_INFO_MIC |
 		       WPA_KEY_INFO_ACK |
 		       (!sm->Pair ? WPA_KEY_INFO_INSTALL : 0),
-		       rsc, gsm->GNonce, kde, pos - kde, gsm->GN, 1);
-	if (sm->wpa == WPA_VERSION_WPA2)
-		os_free(kde);
+		       rsc, gsm->GNonce, kde, kde_len, gsm->GN, 1);
+	os_free(kde_buf);
 }
 
 
 SM_STATE(WPA_PTK_GROUP, REKEYESTABLISHED)
 {
+	struct wpa_group *gsm = sm->group;
+
 	SM_ENTRY_MA(WPA_PTK_GROUP, REKEYESTABLISHED, wpa_ptk_group);
 	sm->EAPOLKeyReceived = FALSE;
-	if (sm->GUpdateStationKeys)
-		sm->group->GKeyDoneStations--;
+	sm->gkey_latency = wpa_ms_since(&sm->gkey_start);
+	if (sm->GUpdateStationKeys) {
+		gsm->GKeyDoneStations--;
+		gsm->rekey_done++;
+		gsm->rekey_latency_sum += sm->gkey_latency;
+		if (sm->gkey_latency > gsm->rekey_latency_max)
+			gsm->rekey_latency_max = sm->gkey_latency;
+	}
 	sm->GUpdateStationKeys = FALSE;
 	sm->GTimeoutCtr = 0;
 	/* FIX: MLME.SetProtection.Request(TA, Tx_Rx) */
@@ -2323,8 +2452,10 @@ SM_STATE(WPA_PTK_GROUP, REKEYESTABLISHED)
 SM_STATE(WPA_PTK_GROUP, KEYERROR)
 {
 	SM_ENTRY_MA(WPA_PTK_GROUP, KEYERROR, wpa_ptk_group);
-	if (sm->GUpdateStationKeys)
+	if (sm->GUpdateStationKeys) {
 		sm->group->GKeyDoneStations--;
+		sm->group->rekey_failed++;
+	}
 	sm->GUpdateStationKeys = FALSE;
 	sm->Disconnect = TRUE;
 }
@@ -2337,7 +2468,7 @@ SM_STEP(WPA_PTK_GROUP)
 		sm->PtkGroupInit = FALSE;
 	} else switch (sm->wpa_ptk_group_state) {
 	case WPA_PTK_GROUP_IDLE:
-		if (sm->GUpdateStationKeys ||
+		if ((sm->GUpdateStationKeys && !sm->gkey_queued) ||
 		    (sm->wpa == WPA_VERSION_WPA && sm->PInitAKeys))
 			SM_ENTER(WPA_PTK_GROUP, REKEYNEGOTIATING);
 		break;
@@ -2366,6 +2497,7 @@ static int wpa_gtk_update(struct wpa_authenticator *wpa_auth,
 {
 	int ret = 0;
 
+	wpa_group_clear_rekey_kde(group);
 	os_memcpy(group->GNonce, group->Counter, WPA_NONCE_LEN);
 	inc_byte_array(group->Counter, WPA_NONCE_LEN);
 	if (wpa_gmk_to_gtk(group->GMK, "Group key expansion",
@@ -2416,6 +2548,11 @@ static void wpa_group_gtk_init(struct wpa_authenticator *wpa_auth,
 
 static int wpa_group_update_sta(struct wpa_state_machine *sm, void *ctx)
 {
+	struct wpa_group *group = ctx;
+
+	if (sm->group != group)
+		return 0; /* STA uses the group of another VLAN */
+
 	if (sm->wpa_ptk_state != WPA_PTK_PTKINITDONE) {
 		wpa_auth_logger(sm->wpa_auth, sm->addr, LOGGER_DEBUG,
 				"Not in PTKINITDONE; skip Group Key update");
@@ -2435,12 +2572,62 @@ static int wpa_group_update_sta(struct wpa_state_machine *sm, void *ctx)
 
 	sm->group->GKeyDoneStations++;
 	sm->GUpdateStationKeys = TRUE;
+	sm->group->rekey_stations++;
+
+	if (sm->wpa_auth->conf.wpa_group_rekey_rate > 0) {
+		/* Handshake is started from wpa_group_rekey_pace() */
+		if (!sm->gkey_queued) {
+			dl_list_add_tail(&sm->group->gkey_queue,
+					 &sm->gkey_list);
+			sm->gkey_queued = 1;
+		}
+		return 0;
+	}
 
 	wpa_sm_step(sm);
 	return 0;
 }
 
 
+static void wpa_group_rekey_pace(void *eloop_ctx, void *timeout_ctx)
+{
+	struct wpa_authenticator *wpa_auth = eloop_ctx;
+	struct wpa_group *group = timeout_ctx;
+	struct wpa_state_machine *sm;
+	int rate = wpa_auth->conf.wpa_group_rekey_rate;
+	int batch, started = 0;
+	unsigned int usec;
+
+	/*
+	 * Start up to rate / 10 handshakes every 100 ms (or one handshake at
+	 * a time with lower rates). Configuration may have been changed to
+	 * not use pacing, in which case all the remaining STAs are started.
+	 */
+	batch = rate > 10 ? rate / 10 : 1;
+	while (!dl_list_empty(&group->gkey_queue) &&
+	       (rate <= 0 || started < batch)) {
+		sm = dl_list_first(&group->gkey_queue, struct wpa_state_machine,
+				   gkey_list);
+		dl_list_del(&sm->gkey_list);
+		sm->gkey_queued = 0;
+		if (!sm->GUpdateStationKeys)
+			continue; /* group key update was cancelled */
+		started++;
+		wpa_sm_step(sm);
+	}
+
+	wpa_printf(MSG_MSGDUMP, "WPA: Started %d group key handshake(s) "
+		   "(VLAN-ID %d); %u queued", started, group->vlan_id,
+		   dl_list_len(&group->gkey_queue));
+
+	if (!dl_list_empty(&group->gkey_queue)) {
+		usec = 1000000 / rate * batch;
+		eloop_register_timeout(usec / 1000000, usec % 1000000,
+				       wpa_group_rekey_pace, wpa_auth, group);
+	}
+}
+
+
 static void wpa_group_setkeys(struct wpa_authenticator *wpa_auth,
 			      struct wpa_group *group)
 {
@@ -2470,9 +2657,22 @@ static void wpa_group_setkeys(struct wpa_authenticator *wpa_auth,
 			   group->GKeyDoneStations);
 		group->GKeyDoneStations = 0;
 	}
-	wpa_auth_for_each_sta(wpa_auth, wpa_group_update_sta, NULL);
+	os_get_reltime(&group->rekey_start);
+	group->rekey_stations = 0;
+	group->rekey_done = 0;
+	group->rekey_failed = 0;
+	group->rekey_latency_sum = 0;
+	group->rekey_latency_max = 0;
+	group->rekey_duration = 0;
+	wpa_auth_for_each_sta_vlan(wpa_auth, group->vlan_id,
+				   wpa_group_update_sta, group);
 	wpa_printf(MSG_DEBUG, "wpa_group_setkeys: GKeyDoneStations=%d",
 		   group->GKeyDoneStations);
+
+	eloop_cancel_timeout(wpa_group_rekey_pace, wpa_auth, group);
+	if (!dl_list_empty(&group->gkey_queue))
+		eloop_register_timeout(0, 0, wpa_group_rekey_pace, wpa_auth,
+				       group);
 }
 
 
@@ -2505,8 +2705,18 @@ static int wpa_group_setkeysdone(struct wpa_authenticator *wpa_auth,
 {
 	wpa_printf(MSG_DEBUG, "WPA: group state machine entering state "
 		   "SETKEYSDONE (VLAN-ID %d)", group->vlan_id);
+	if (group->wpa_group_state == WPA_GROUP_SETKEYS) {
+		group->rekey_duration = wpa_ms_since(&group->rekey_start);
+		wpa_printf(MSG_DEBUG, "WPA: GTK rekey done in %u ms: %u/%u "
+			   "STAs completed (%u failed), average %u ms, max "
+			   "%u ms", group->rekey_duration, group->rekey_done,
+			   group->rekey_stations, group->rekey_failed,
+			   group->rekey_done ? group->rekey_latency_sum /
+			   group->rekey_done : 0, group->rekey_latency_max);
+	}
 	group->changed = TRUE;
 	group->wpa_group_state = WPA_GROUP_SETKEYSDONE;
+	wpa_group_clear_rekey_kde(group);
 
 	if (wpa_group_config_group_keys(wpa_auth, group) < 0)
 		return -1;
@@ -2647,6 +2857,10 @@ int wpa_get_mib(struct wpa_authenticator *wpa_auth, char *buf, size_t buflen)
 {
 	int len = 0, ret;
 	char pmkid_txt[PMKID_LEN * 2 + 1];
+	struct wpa_group *group;
+	unsigned int stations = 0, done = 0, failed = 0, pending = 0;
+	unsigned int queued = 0, rekey_time = 0, latency_sum = 0;
+	unsigned int latency_max = 0, t;
 #ifdef CONFIG_RSN_PREAUTH
 	const int preauth = 1;
 #else /* CONFIG_RSN_PREAUTH */
@@ -2728,6 +2942,38 @@ int wpa_get_mib(struct wpa_authenticator *wpa_auth, char *buf, size_t buflen)
 		return len;
 	len += ret;
 
+	/* Progress of the current (or last) GTK rekey over all VLAN groups */
+	for (group = wpa_auth->group; group; group = group->next) {
+		stations += group->rekey_stations;
+		done += group->rekey_done;
+		failed += group->rekey_failed;
+		queued += dl_list_len(&group->gkey_queue);
+		if (group->wpa_group_state == WPA_GROUP_SETKEYS) {
+			pending += group->GKeyDoneStations;
+			t = wpa_ms_since(&group->rekey_start);
+		} else
+			t = group->rekey_duration;
+		if (t > rekey_time)
+			rekey_time = t;
+		latency_sum += group->rekey_latency_sum;
+		if (group->rekey_latency_max > latency_max)
+			latency_max = group->rekey_latency_max;
+	}
+	ret = os_snprintf(buf + len, buflen - len,
+			  "hostapdWPAGroupRekeyStations=%u\n"
+			  "hostapdWPAGroupRekeyCompleted=%u\n"
+			  "hostapdWPAGroupRekeyFailed=%u\n"
+			  "hostapdWPAGroupRekeyPending=%u\n"
+			  "hostapdWPAGroupRekeyQueued=%u\n"
+			  "hostapdWPAGroupRekeyTime=%u\n"
+			  "hostapdWPAGroupRekeyAvgLatency=%u\n"
+			  "hostapdWPAGroupRekeyMaxLatency=%u\n",
+			  stations, done, failed, pending, queued, rekey_time,
+			  done ? latency_sum / done : 0, latency_max);
+	if (ret < 0 || (size_t) ret >= buflen - len)
+		return len;
+	len += ret;
+
 	return len;
 }
 
@@ -2792,9 +3038,11 @@ int wpa_get_mib_sta(struct wpa_state_machine *sm, char *buf, size_t buflen)
 	/* Private MIB */
 	ret = os_snprintf(buf + len, buflen - len,
 			  "hostapdWPAPTKState=%d\n"
-			  "hostapdWPAPTKGroupState=%d\n",
+			  "hostapdWPAPTKGroupState=%d\n"
+			  "hostapdWPAGroupKeyLatency=%u\n",
 			  sm->wpa_ptk_state,
-			  sm->wpa_ptk_group_state);
+			  sm->wpa_ptk_group_state,
+			  sm->gkey_latency);
 	if (ret < 0 || (size_t) ret >= buflen - len)
 		return len;
 	len += ret;
@@ -2803,6 +3051,30 @@ int wpa_get_mib_sta(struct wpa_state_machine *sm, char *buf, size_t buflen)
 }
 
 
+/**
+ * wpa_get_mib_sta_state - Get a summary of the per-STA MIB values
+ * @sm: Pointer to WPA state machine data from wpa_auth_sta_init() or %NULL
+ * Returns: Value that changes when the values reported by wpa_get_mib_sta()
+ * change (with high probability)
+ */
+u32 wpa_get_mib_sta_state(struct wpa_state_machine *sm)
+{
+	u32 state;
+
+	if (sm == NULL)
+		return 0;
+
+	state = sm->wpa;
+	state = state * 31 + sm->pairwise;
+	state = state * 31 + sm->dot11RSNAStatsTKIPLocalMICFailures;
+	state = state * 31 + sm->dot11RSNAStatsTKIPRemoteMICFailures;
+	state = state * 31 + sm->wpa_ptk_state;
+	state = state * 31 + sm->wpa_ptk_group_state;
+	state = state * 31 + sm->gkey_latency;
+	return state;
+}
+
+
 void wpa_auth_countermeasures_start(struct wpa_authenticator *wpa_auth)
 {
 	if (wpa_auth)
@@ -2927,7 +3199,7 @@ wpa_auth_add_group(struct wpa_authenticator *wpa_auth, int vlan_id)
 
 int wpa_auth_sta_set_vlan(struct wpa_state_machine *sm, int vlan_id)
 {
-	struct wpa_group *group;
+	struct wpa_group *group, *old;
 
 	if (sm == NULL || sm->wpa_auth == NULL)
 		return 0;
@@ -2951,7 +3223,27 @@ int wpa_auth_sta_set_vlan(struct wpa_state_machine *sm, int vlan_id)
 	wpa_printf(MSG_DEBUG, "WPA: Moving STA " MACSTR " to use group state "
 		   "machine for VLAN ID %d", MAC2STR(sm->addr), vlan_id);
 
+	if (sm->gkey_queued) {
+		dl_list_del(&sm->gkey_list);
+		sm->gkey_queued = 0;
+	}
+	old = sm->group;
 	sm->group = group;
+	if (sm->GUpdateStationKeys) {
+		/*
+		 * The pending group key update is for the GTK of the old
+		 * group; cancel it so that the rekey of the old group can
+		 * complete without this STA.
+		 */
+		old->GKeyDoneStations--;
+		old->rekey_stations--;
+		sm->GUpdateStationKeys = FALSE;
+		sm->PtkGroupInit = TRUE;
+		do {
+			old->changed = FALSE;
+			wpa_group_sm_step(sm->wpa_auth, old);
+		} while (old->changed);
+	}
 	return 0;
 }
 
@@ -103,6 +103,8 @@ struct wpa_authenticator;
 struct wpa_state_machine;
 struct rsn_pmksa_cache_entry;
 struct eapol_state_machine;
+struct state_store;
+struct tick_wheel;
 
 
 struct ft_remote_r0kh {
@@ -128,6 +130,7 @@ struct wpa_auth_config {
 	int wpa_pairwise;
 	int wpa_group;
 	int wpa_group_rekey;
+	int wpa_group_rekey_rate; /* STAs/second or 0 = all at once */
 	int wpa_strict_rekey;
 	int wpa_gmk_rekey;
 	int wpa_ptk_rekey;
@@ -139,7 +142,10 @@ struct wpa_auth_config {
 	int wmm_uapsd;
 	int disable_pmksa_caching;
 	int okc;
+	size_t pmksa_cache_max_mem;
+	const char *pmksa_cache_file;
 	int tx_status;
+	struct tick_wheel *tick_wheel; /* for PTK rekeying or %NULL for eloop */
 #ifdef CONFIG_IEEE80211W
 	enum mfp_options ieee80211w;
 #endif /* CONFIG_IEEE80211W */
@@ -188,6 +194,9 @@ struct wpa_auth_callbacks {
 			  size_t data_len, int encrypt);
 	int (*for_each_sta)(void *ctx, int (*cb)(struct wpa_state_machine *sm,
 						 void *ctx), void *cb_ctx);
+	int (*for_each_sta_vlan)(void *ctx, int vlan_id,
+				 int (*cb)(struct wpa_state_machine *sm,
+					   void *ctx), void *cb_ctx);
 	int (*for_each_auth)(void *ctx, int (*cb)(struct wpa_authenticator *a,
 						  void *ctx), void *cb_ctx);
 	int (*send_ether)(void *ctx, const u8 *dst, u16 proto, const u8 *data,
@@ -206,6 +215,8 @@ int wpa_init_keys(struct wpa_authenticator *wpa_auth);
 void wpa_deinit(struct wpa_authenticator *wpa_auth);
 int wpa_reconfig(struct wpa_authenticator *wpa_auth,
 		 struct wpa_auth_config *conf);
+void wpa_auth_set_state_store(struct wpa_authenticator *wpa_auth,
+			      struct state_store *store);
 
 enum {
 	WPA_IE_OK, WPA_INVALID_IE, WPA_INVALID_GROUP, WPA_INVALID_PAIRWISE,
@@ -238,6 +249,7 @@ void wpa_auth_sm_notify(struct wpa_state_machine *sm);
 void wpa_gtk_rekey(struct wpa_authenticator *wpa_auth);
 int wpa_get_mib(struct wpa_authenticator *wpa_auth, char *buf, size_t buflen);
 int wpa_get_mib_sta(struct wpa_state_machine *sm, char *buf, size_t buflen);
+u32 wpa_get_mib_sta_state(struct wpa_state_machine *sm);
 void wpa_auth_countermeasures_start(struct wpa_authenticator *wpa_auth);
 int wpa_auth_pairwise_set(struct wpa_state_machine *sm);
 int wpa_auth_get_pairwise(struct wpa_state_machine *sm);
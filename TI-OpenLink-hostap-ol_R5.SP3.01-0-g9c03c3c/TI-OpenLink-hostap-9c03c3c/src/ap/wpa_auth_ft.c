@@ -9,6 +9,7 @@
 #include "utils/includes.h"
 
 #include "utils/common.h"
+#include "utils/eloop.h"
 #include "common/ieee802_11_defs.h"
 #include "common/ieee802_11_common.h"
 #include "crypto/aes_wrap.h"
@@ -16,6 +17,7 @@
 #include "ap_config.h"
 #include "ieee802_11.h"
 #include "wmm.h"
+#include "state_store.h"
 #include "wpa_auth.h"
 #include "wpa_auth_i.h"
 
@@ -127,8 +129,10 @@ struct wpa_ft_pmk_r0_sa {
 	u8 pmk_r0_name[WPA_PMK_NAME_LEN];
 	u8 spa[ETH_ALEN];
 	int pairwise; /* Pairwise cipher suite, WPA_CIPHER_* */
-	/* TODO: expiration, identity, radius_class, EAP type, VLAN ID */
+	/* TODO: identity, radius_class, EAP type, VLAN ID */
+	os_time_t expiration; /* 0 = does not expire */
 	int pmk_r1_pushed;
+	int state_slot; /* slot in the state store plus one; 0 = not stored */
 };
 
 struct wpa_ft_pmk_r1_sa {
@@ -137,14 +141,21 @@ struct wpa_ft_pmk_r1_sa {
 	u8 pmk_r1_name[WPA_PMK_NAME_LEN];
 	u8 spa[ETH_ALEN];
 	int pairwise; /* Pairwise cipher suite, WPA_CIPHER_* */
-	/* TODO: expiration, identity, radius_class, EAP type, VLAN ID */
+	/* TODO: identity, radius_class, EAP type, VLAN ID */
+	os_time_t expiration; /* 0 = does not expire */
+	int state_slot; /* slot in the state store plus one; 0 = not stored */
 };
 
 struct wpa_ft_pmk_cache {
 	struct wpa_ft_pmk_r0_sa *pmk_r0;
 	struct wpa_ft_pmk_r1_sa *pmk_r1;
+	struct state_store *store;
 };
 
+/* PMK-R0/R1 in the state store: SPA | PMKName | PMK | pairwise (LE32) |
+ * pmk_r1_pushed */
+#define FT_STATE_LEN (ETH_ALEN + WPA_PMK_NAME_LEN + PMK_LEN + 4 + 1)
+
 struct wpa_ft_pmk_cache * wpa_ft_pmk_cache_init(void)
 {
 	struct wpa_ft_pmk_cache *cache;
@@ -155,11 +166,17 @@ struct wpa_ft_pmk_cache * wpa_ft_pmk_cache_init(void)
 }
 
 
+static void wpa_ft_pmk_cache_expire(void *eloop_ctx, void *timeout_ctx);
+
+
 void wpa_ft_pmk_cache_deinit(struct wpa_ft_pmk_cache *cache)
 {
 	struct wpa_ft_pmk_r0_sa *r0, *r0prev;
 	struct wpa_ft_pmk_r1_sa *r1, *r1prev;
 
+	eloop_cancel_timeout(wpa_ft_pmk_cache_expire, cache, NULL);
+
+	/* Stored records are left in place to be restored after a restart */
 	r0 = cache->pmk_r0;
 	while (r0) {
 		r0prev = r0;
@@ -180,14 +197,250 @@ void wpa_ft_pmk_cache_deinit(struct wpa_ft_pmk_cache *cache)
 }
 
 
+/* Remove the entries for the STA (if spa is set) and the expired entries */
+static void wpa_ft_remove_pmk_r0(struct wpa_ft_pmk_cache *cache,
+				 const u8 *spa, os_time_t now)
+{
+	struct wpa_ft_pmk_r0_sa *r0, *prev = NULL, *tmp;
+
+	r0 = cache->pmk_r0;
+	while (r0) {
+		if ((spa && os_memcmp(r0->spa, spa, ETH_ALEN) == 0) ||
+		    (r0->expiration && r0->expiration <= now)) {
+			tmp = r0;
+			r0 = r0->next;
+			if (prev)
+				prev->next = r0;
+			else
+				cache->pmk_r0 = r0;
+			if (tmp->state_slot)
+				state_store_del(cache->store,
+						tmp->state_slot - 1);
+			os_memset(tmp->pmk_r0, 0, PMK_LEN);
+			os_free(tmp);
+			continue;
+		}
+		prev = r0;
+		r0 = r0->next;
+	}
+}
+
+
+static void wpa_ft_remove_pmk_r1(struct wpa_ft_pmk_cache *cache,
+				 const u8 *spa, os_time_t now)
+{
+	struct wpa_ft_pmk_r1_sa *r1, *prev = NULL, *tmp;
+
+	r1 = cache->pmk_r1;
+	while (r1) {
+		if ((spa && os_memcmp(r1->spa, spa, ETH_ALEN) == 0) ||
+		    (r1->expiration && r1->expiration <= now)) {
+			tmp = r1;
+			r1 = r1->next;
+			if (prev)
+				prev->next = r1;
+			else
+				cache->pmk_r1 = r1;
+			if (tmp->state_slot)
+				state_store_del(cache->store,
+						tmp->state_slot - 1);
+			os_memset(tmp->pmk_r1, 0, PMK_LEN);
+			os_free(tmp);
+			continue;
+		}
+		prev = r1;
+		r1 = r1->next;
+	}
+}
+
+
+static void wpa_ft_pmk_cache_set_expiration(struct wpa_ft_pmk_cache *cache)
+{
+	struct wpa_ft_pmk_r0_sa *r0;
+	struct wpa_ft_pmk_r1_sa *r1;
+	struct os_time now;
+	os_time_t first = 0;
+	int sec;
+
+	eloop_cancel_timeout(wpa_ft_pmk_cache_expire, cache, NULL);
+
+	for (r0 = cache->pmk_r0; r0; r0 = r0->next) {
+		if (r0->expiration && (!first || r0->expiration < first))
+			first = r0->expiration;
+	}
+	for (r1 = cache->pmk_r1; r1; r1 = r1->next) {
+		if (r1->expiration && (!first || r1->expiration < first))
+			first = r1->expiration;
+	}
+	if (!first)
+		return;
+
+	os_get_time(&now);
+	sec = first - now.sec;
+	if (sec < 0)
+		sec = 0;
+	eloop_register_timeout(sec + 1, 0, wpa_ft_pmk_cache_expire, cache,
+			       NULL);
+}
+
+
+static void wpa_ft_pmk_cache_expire(void *eloop_ctx, void *timeout_ctx)
+{
+	struct wpa_ft_pmk_cache *cache = eloop_ctx;
+	struct os_time now;
+
+	os_get_time(&now);
+	wpa_ft_remove_pmk_r0(cache, NULL, now.sec);
+	wpa_ft_remove_pmk_r1(cache, NULL, now.sec);
+	wpa_ft_pmk_cache_set_expiration(cache);
+}
+
+
+static os_time_t wpa_ft_expiration(struct wpa_authenticator *wpa_auth,
+				   struct os_time *now)
+{
+	if (!wpa_auth->conf.r0_key_lifetime)
+		return 0;
+	return now->sec + wpa_auth->conf.r0_key_lifetime * 60;
+}
+
+
+static void wpa_ft_state_data(u8 *buf, const u8 *spa, const u8 *pmk_name,
+			      const u8 *pmk, int pairwise, int pushed)
+{
+	os_memcpy(buf, spa, ETH_ALEN);
+	buf += ETH_ALEN;
+	os_memcpy(buf, pmk_name, WPA_PMK_NAME_LEN);
+	buf += WPA_PMK_NAME_LEN;
+	os_memcpy(buf, pmk, PMK_LEN);
+	buf += PMK_LEN;
+	WPA_PUT_LE32(buf, pairwise);
+	buf += 4;
+	*buf = pushed;
+}
+
+
+static void wpa_ft_state_add(struct wpa_authenticator *wpa_auth,
+			     enum state_store_type type, const u8 *spa,
+			     const u8 *pmk_name, const u8 *pmk, int pairwise,
+			     os_time_t expires, int *state_slot)
+{
+	struct state_store *store = wpa_auth->ft_pmk_cache->store;
+	u8 buf[FT_STATE_LEN];
+	int slot;
+
+	if (store == NULL)
+		return;
+
+	wpa_ft_state_data(buf, spa, pmk_name, pmk, pairwise, 0);
+	slot = state_store_add(store, type, wpa_auth->addr, expires, buf,
+			       sizeof(buf));
+	os_memset(buf, 0, sizeof(buf));
+	if (slot >= 0)
+		*state_slot = slot + 1;
+}
+
+
+static int wpa_ft_restore_pmk_r0(void *ctx, int slot, const u8 *data,
+				 size_t len)
+{
+	struct wpa_ft_pmk_cache *cache = ctx;
+	struct wpa_ft_pmk_r0_sa *r0;
+
+	if (len != FT_STATE_LEN)
+		return -1;
+	r0 = os_zalloc(sizeof(*r0));
+	if (r0 == NULL)
+		return 0;
+	os_memcpy(r0->spa, data, ETH_ALEN);
+	data += ETH_ALEN;
+	os_memcpy(r0->pmk_r0_name, data, WPA_PMK_NAME_LEN);
+	data += WPA_PMK_NAME_LEN;
+	os_memcpy(r0->pmk_r0, data, PMK_LEN);
+	data += PMK_LEN;
+	r0->pairwise = WPA_GET_LE32(data);
+	data += 4;
+	r0->pmk_r1_pushed = *data;
+	r0->expiration = state_store_expires(cache->store, slot);
+	r0->state_slot = slot + 1;
+
+	r0->next = cache->pmk_r0;
+	cache->pmk_r0 = r0;
+
+	return 0;
+}
+
+
+static int wpa_ft_restore_pmk_r1(void *ctx, int slot, const u8 *data,
+				 size_t len)
+{
+	struct wpa_ft_pmk_cache *cache = ctx;
+	struct wpa_ft_pmk_r1_sa *r1;
+
+	if (len != FT_STATE_LEN)
+		return -1;
+	r1 = os_zalloc(sizeof(*r1));
+	if (r1 == NULL)
+		return 0;
+	os_memcpy(r1->spa, data, ETH_ALEN);
+	data += ETH_ALEN;
+	os_memcpy(r1->pmk_r1_name, data, WPA_PMK_NAME_LEN);
+	data += WPA_PMK_NAME_LEN;
+	os_memcpy(r1->pmk_r1, data, PMK_LEN);
+	data += PMK_LEN;
+	r1->pairwise = WPA_GET_LE32(data);
+	r1->expiration = state_store_expires(cache->store, slot);
+	r1->state_slot = slot + 1;
+
+	r1->next = cache->pmk_r1;
+	cache->pmk_r1 = r1;
+
+	return 0;
+}
+
+
+/**
+ * wpa_ft_set_state_store - Keep FT PMK-R0/R1 cache in a state store
+ * @wpa_auth: Pointer to WPA authenticator data from wpa_init()
+ * @store: State store or %NULL
+ *
+ * PMK-R0 and PMK-R1 keys stored for this authenticator are restored from the
+ * store and new keys are written into it. The records expire from the store
+ * based on r0_key_lifetime.
+ */
+void wpa_ft_set_state_store(struct wpa_authenticator *wpa_auth,
+			    struct state_store *store)
+{
+	struct wpa_ft_pmk_cache *cache = wpa_auth->ft_pmk_cache;
+	int r0, r1;
+
+	if (cache->store || store == NULL)
+		return;
+
+	/* Set before restoring so that the callbacks can use it */
+	cache->store = store;
+	r0 = state_store_for_each(store, STATE_STORE_FT_R0, wpa_auth->addr,
+				  wpa_ft_restore_pmk_r0, cache);
+	r1 = state_store_for_each(store, STATE_STORE_FT_R1, wpa_auth->addr,
+				  wpa_ft_restore_pmk_r1, cache);
+	if (r0 || r1)
+		wpa_printf(MSG_DEBUG, "FT: Restored %d PMK-R0 and %d PMK-R1 "
+			   "key(s)", r0, r1);
+	wpa_ft_pmk_cache_set_expiration(cache);
+}
+
+
 static int wpa_ft_store_pmk_r0(struct wpa_authenticator *wpa_auth,
 			       const u8 *spa, const u8 *pmk_r0,
 			       const u8 *pmk_r0_name, int pairwise)
 {
 	struct wpa_ft_pmk_cache *cache = wpa_auth->ft_pmk_cache;
 	struct wpa_ft_pmk_r0_sa *r0;
+	struct os_time now;
 
-	/* TODO: add expiration and limit on number of entries in cache */
+	/* A new PMK-R0 for the STA replaces the old one */
+	os_get_time(&now);
+	wpa_ft_remove_pmk_r0(cache, spa, now.sec);
 
 	r0 = os_zalloc(sizeof(*r0));
 	if (r0 == NULL)
@@ -197,10 +450,15 @@ static int wpa_ft_store_pmk_r0(struct wpa_authenticator *wpa_auth,
 	os_memcpy(r0->pmk_r0_name, pmk_r0_name, WPA_PMK_NAME_LEN);
 	os_memcpy(r0->spa, spa, ETH_ALEN);
 	r0->pairwise = pairwise;
+	r0->expiration = wpa_ft_expiration(wpa_auth, &now);
 
 	r0->next = cache->pmk_r0;
 	cache->pmk_r0 = r0;
 
+	wpa_ft_state_add(wpa_auth, STATE_STORE_FT_R0, spa, pmk_r0_name, pmk_r0,
+			 pairwise, r0->expiration, &r0->state_slot);
+	wpa_ft_pmk_cache_set_expiration(cache);
+
 	return 0;
 }
 
@@ -236,8 +494,11 @@ static int wpa_ft_store_pmk_r1(struct wpa_authenticator *wpa_auth,
 {
 	struct wpa_ft_pmk_cache *cache = wpa_auth->ft_pmk_cache;
 	struct wpa_ft_pmk_r1_sa *r1;
+	struct os_time now;
 
-	/* TODO: add expiration and limit on number of entries in cache */
+	/* A new PMK-R1 for the STA replaces the old one */
+	os_get_time(&now);
+	wpa_ft_remove_pmk_r1(cache, spa, now.sec);
 
 	r1 = os_zalloc(sizeof(*r1));
 	if (r1 == NULL)
@@ -247,10 +508,15 @@ static int wpa_ft_store_pmk_r1(struct wpa_authenticator *wpa_auth,
 	os_memcpy(r1->pmk_r1_name, pmk_r1_name, WPA_PMK_NAME_LEN);
 	os_memcpy(r1->spa, spa, ETH_ALEN);
 	r1->pairwise = pairwise;
+	r1->expiration = wpa_ft_expiration(wpa_auth, &now);
 
 	r1->next = cache->pmk_r1;
 	cache->pmk_r1 = r1;
 
+	wpa_ft_state_add(wpa_auth, STATE_STORE_FT_R1, spa, pmk_r1_name, pmk_r1,
+			 pairwise, r1->expiration, &r1->state_slot);
+	wpa_ft_pmk_cache_set_expiration(cache);
+
 	return 0;
 }
 
@@ -1599,6 +1865,14 @@ void wpa_ft_push_pmk_r1(struct wpa_authenticator *wpa_auth, const u8 *addr)
 	if (r0 == NULL || r0->pmk_r1_pushed)
 		return;
 	r0->pmk_r1_pushed = 1;
+	if (r0->state_slot) {
+		u8 buf[FT_STATE_LEN];
+		wpa_ft_state_data(buf, r0->spa, r0->pmk_r0_name, r0->pmk_r0,
+				  r0->pairwise, 1);
+		state_store_update(wpa_auth->ft_pmk_cache->store,
+				   r0->state_slot - 1, buf, sizeof(buf));
+		os_memset(buf, 0, sizeof(buf));
+	}
 
 	wpa_printf(MSG_DEBUG, "FT: Deriving and pushing PMK-R1 keys to R1KHs "
 		   "for STA " MACSTR, MAC2STR(addr));
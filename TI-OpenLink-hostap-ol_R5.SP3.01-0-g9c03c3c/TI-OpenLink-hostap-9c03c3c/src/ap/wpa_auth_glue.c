@@ -35,6 +35,7 @@ static void hostapd_wpa_auth_conf(struct hostapd_bss_config *conf,
 	wconf->wpa_pairwise = conf->wpa_pairwise;
 	wconf->wpa_group = conf->wpa_group;
 	wconf->wpa_group_rekey = conf->wpa_group_rekey;
+	wconf->wpa_group_rekey_rate = conf->wpa_group_rekey_rate;
 	wconf->wpa_strict_rekey = conf->wpa_strict_rekey;
 	wconf->wpa_gmk_rekey = conf->wpa_gmk_rekey;
 	wconf->wpa_ptk_rekey = conf->wpa_ptk_rekey;
@@ -46,6 +47,8 @@ static void hostapd_wpa_auth_conf(struct hostapd_bss_config *conf,
 	wconf->wmm_uapsd = conf->wmm_uapsd;
 	wconf->disable_pmksa_caching = conf->disable_pmksa_caching;
 	wconf->okc = conf->okc;
+	wconf->pmksa_cache_max_mem = conf->pmksa_cache_max_mem;
+	wconf->pmksa_cache_file = conf->pmksa_cache_file;
 #ifdef CONFIG_IEEE80211W
 	wconf->ieee80211w = conf->ieee80211w;
 #endif /* CONFIG_IEEE80211W */
@@ -270,6 +273,34 @@ static int hostapd_wpa_auth_for_each_sta(
 }
 
 
+struct wpa_auth_sta_iter_data {
+	int (*cb)(struct wpa_state_machine *sm, void *ctx);
+	void *cb_ctx;
+};
+
+static int hostapd_wpa_auth_sta_iter(struct hostapd_data *hapd,
+				     struct sta_info *sta, void *ctx)
+{
+	struct wpa_auth_sta_iter_data *data = ctx;
+
+	return sta->wpa_sm && data->cb(sta->wpa_sm, data->cb_ctx);
+}
+
+
+static int hostapd_wpa_auth_for_each_sta_vlan(
+	void *ctx, int vlan_id,
+	int (*cb)(struct wpa_state_machine *sm, void *ctx), void *cb_ctx)
+{
+	struct hostapd_data *hapd = ctx;
+	struct wpa_auth_sta_iter_data data;
+
+	data.cb = cb;
+	data.cb_ctx = cb_ctx;
+	return ap_for_each_sta_vlan(hapd, vlan_id, hostapd_wpa_auth_sta_iter,
+				    &data);
+}
+
+
 struct wpa_auth_iface_iter_data {
 	int (*cb)(struct wpa_authenticator *sm, void *ctx);
 	void *cb_ctx;
@@ -471,6 +502,13 @@ int hostapd_setup_wpa(struct hostapd_data *hapd)
 	hostapd_wpa_auth_conf(hapd->conf, &_conf);
 	if (hapd->iface->drv_flags & WPA_DRIVER_FLAGS_EAPOL_TX_STATUS)
 		_conf.tx_status = 1;
+	_conf.tick_wheel = hapd->tick_wheel;
+	if (hapd->iface->state_store && _conf.pmksa_cache_file) {
+		/* The state store keeps the PMKSA cache over restarts */
+		wpa_printf(MSG_INFO, "RSN: Ignore pmksa_cache_file since "
+			   "state_file is used");
+		_conf.pmksa_cache_file = NULL;
+	}
 	os_memset(&cb, 0, sizeof(cb));
 	cb.ctx = hapd;
 	cb.logger = hostapd_wpa_auth_logger;
@@ -484,6 +522,7 @@ int hostapd_setup_wpa(struct hostapd_data *hapd)
 	cb.get_seqnum = hostapd_wpa_auth_get_seqnum;
 	cb.send_eapol = hostapd_wpa_auth_send_eapol;
 	cb.for_each_sta = hostapd_wpa_auth_for_each_sta;
+	cb.for_each_sta_vlan = hostapd_wpa_auth_for_each_sta_vlan;
 	cb.for_each_auth = hostapd_wpa_auth_for_each_auth;
 	cb.send_ether = hostapd_wpa_auth_send_ether;
 #ifdef CONFIG_IEEE80211R
@@ -495,6 +534,7 @@ int hostapd_setup_wpa(struct hostapd_data *hapd)
 		wpa_printf(MSG_ERROR, "WPA initialization failed.");
 		return -1;
 	}
+	wpa_auth_set_state_store(hapd->wpa_auth, hapd->iface->state_store);
 
 	if (hostapd_set_privacy(hapd, 1)) {
 		wpa_printf(MSG_ERROR, "Could not set PrivacyInvoked "
@@ -540,6 +580,9 @@ void hostapd_reconfig_wpa(struct hostapd_data *hapd)
 {
 	struct wpa_auth_config wpa_auth_conf;
 	hostapd_wpa_auth_conf(hapd->conf, &wpa_auth_conf);
+	wpa_auth_conf.tick_wheel = hapd->tick_wheel;
+	if (hapd->iface->state_store)
+		wpa_auth_conf.pmksa_cache_file = NULL;
 	wpa_reconfig(hapd->wpa_auth, &wpa_auth_conf);
 }
 
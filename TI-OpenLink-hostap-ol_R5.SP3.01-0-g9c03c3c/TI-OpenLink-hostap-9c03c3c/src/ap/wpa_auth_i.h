@@ -9,6 +9,8 @@
 #ifndef WPA_AUTH_I_H
 #define WPA_AUTH_I_H
 
+#include "utils/tick_wheel.h"
+
 /* max(dot11RSNAConfigGroupUpdateCount,dot11RSNAConfigPairwiseUpdateCount) */
 #define RSNA_MAX_EAPOL_RETRIES 4
 
@@ -119,6 +121,12 @@ struct wpa_state_machine {
 #endif /* CONFIG_IEEE80211R */
 
 	int pending_1_of_4_timeout;
+	struct tick_wheel_entry ptk_rekey_timer;
+
+	struct dl_list gkey_list; /* entry in wpa_group::gkey_queue */
+	int gkey_queued; /* waiting for paced group key handshake start */
+	struct os_reltime gkey_start; /* first group key msg 1/2 sent */
+	unsigned int gkey_latency; /* ms, last completed group key handshake */
 };
 
 
@@ -150,6 +158,24 @@ struct wpa_group {
 	u8 IGTK[2][WPA_IGTK_LEN];
 	int GN_igtk, GM_igtk;
 #endif /* CONFIG_IEEE80211W */
+
+	/* STAs waiting for their group key handshake when rekeying is paced */
+	struct dl_list gkey_queue;
+	/*
+	 * RSN Key Data for group key msg 1/2 while in SETKEYS; shared by all
+	 * STAs without ([0]) and with ([1]) the IGTK KDE
+	 */
+	u8 *rekey_kde[2];
+	size_t rekey_kde_len[2];
+
+	/* Progress of the current (or last) GTK rekey */
+	struct os_reltime rekey_start;
+	unsigned int rekey_stations;
+	unsigned int rekey_done;
+	unsigned int rekey_failed;
+	unsigned int rekey_latency_sum; /* ms */
+	unsigned int rekey_latency_max; /* ms */
+	unsigned int rekey_duration; /* ms, last completed rekey */
 };
 
 
@@ -199,6 +225,10 @@ void __wpa_send_eapol(struct wpa_authenticator *wpa_auth,
 int wpa_auth_for_each_sta(struct wpa_authenticator *wpa_auth,
 			  int (*cb)(struct wpa_state_machine *sm, void *ctx),
 			  void *cb_ctx);
+int wpa_auth_for_each_sta_vlan(struct wpa_authenticator *wpa_auth, int vlan_id,
+			       int (*cb)(struct wpa_state_machine *sm,
+					 void *ctx),
+			       void *cb_ctx);
 int wpa_auth_for_each_auth(struct wpa_authenticator *wpa_auth,
 			   int (*cb)(struct wpa_authenticator *a, void *ctx),
 			   void *cb_ctx);
@@ -225,6 +255,8 @@ int wpa_auth_derive_ptk_ft(struct wpa_state_machine *sm, const u8 *pmk,
 			   struct wpa_ptk *ptk, size_t ptk_len);
 struct wpa_ft_pmk_cache * wpa_ft_pmk_cache_init(void);
 void wpa_ft_pmk_cache_deinit(struct wpa_ft_pmk_cache *cache);
+void wpa_ft_set_state_store(struct wpa_authenticator *wpa_auth,
+			    struct state_store *store);
 void wpa_ft_install_ptk(struct wpa_state_machine *sm);
 #endif /* CONFIG_IEEE80211R */
 
@@ -108,8 +108,7 @@ static int hostapd_wps_new_psk_cb(void *ctx, const u8 *mac_addr, const u8 *psk,
 	os_memcpy(p->addr, mac_addr, ETH_ALEN);
 	os_memcpy(p->psk, psk, PMK_LEN);
 
-	p->next = ssid->wpa_psk;
-	ssid->wpa_psk = p;
+	hostapd_add_wpa_psk(ssid, p);
 
 	if (ssid->wpa_psk_file) {
 		FILE *f;
@@ -683,6 +682,7 @@ static void hostapd_wps_clear_ies(struct hostapd_data *hapd)
 
 	wpabuf_free(hapd->wps_probe_resp_ie);
 	hapd->wps_probe_resp_ie = NULL;
+	hostapd_free_probe_resp_tmpl(hapd);
 
 	hostapd_set_ap_wps_ie(hapd);
 }
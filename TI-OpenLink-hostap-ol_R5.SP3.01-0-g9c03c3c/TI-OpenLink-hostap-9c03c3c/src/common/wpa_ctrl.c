@@ -359,14 +359,13 @@ int wpa_ctrl_request(struct wpa_ctrl *ctrl, const char *cmd, size_t cmd_len,
 #endif /* CTRL_IFACE_SOCKET */
 
 
-static int wpa_ctrl_attach_helper(struct wpa_ctrl *ctrl, int attach)
+static int wpa_ctrl_attach_helper(struct wpa_ctrl *ctrl, const char *cmd)
 {
 	char buf[10];
 	int ret;
 	size_t len = 10;
 
-	ret = wpa_ctrl_request(ctrl, attach ? "ATTACH" : "DETACH", 6,
-			       buf, &len, NULL);
+	ret = wpa_ctrl_request(ctrl, cmd, os_strlen(cmd), buf, &len, NULL);
 	if (ret < 0)
 		return ret;
 	if (len == 3 && os_memcmp(buf, "OK\n", 3) == 0)
@@ -377,13 +376,19 @@ static int wpa_ctrl_attach_helper(struct wpa_ctrl *ctrl, int attach)
 
 int wpa_ctrl_attach(struct wpa_ctrl *ctrl)
 {
-	return wpa_ctrl_attach_helper(ctrl, 1);
+	return wpa_ctrl_attach_helper(ctrl, "ATTACH");
+}
+
+
+int wpa_ctrl_attach_batch(struct wpa_ctrl *ctrl)
+{
+	return wpa_ctrl_attach_helper(ctrl, "ATTACH BATCH");
 }
 
 
 int wpa_ctrl_detach(struct wpa_ctrl *ctrl)
 {
-	return wpa_ctrl_attach_helper(ctrl, 0);
+	return wpa_ctrl_attach_helper(ctrl, "DETACH");
 }
 
 
@@ -234,6 +234,22 @@ int wpa_ctrl_request(struct wpa_ctrl *ctrl, const char *cmd, size_t cmd_len,
 int wpa_ctrl_attach(struct wpa_ctrl *ctrl);
 
 
+/* Maximum length of a message with batched events */
+#define WPA_CTRL_BATCH_MAX 4096
+
+/**
+ * wpa_ctrl_attach_batch - Register as an event monitor with batched delivery
+ * @ctrl: Control interface data from wpa_ctrl_open()
+ * Returns: 0 on success, -1 on failure (e.g., not supported), -2 on timeout
+ *
+ * This is like wpa_ctrl_attach(), but a message received with wpa_ctrl_recv()
+ * may contain multiple events separated with a newline character, each
+ * starting with the "<level>" prefix. The messages are at most
+ * %WPA_CTRL_BATCH_MAX octets unless a single event is longer than that.
+ */
+int wpa_ctrl_attach_batch(struct wpa_ctrl *ctrl);
+
+
 /**
  * wpa_ctrl_detach - Unregister event monitor from the control interface
  * @ctrl: Control interface data from wpa_ctrl_open()
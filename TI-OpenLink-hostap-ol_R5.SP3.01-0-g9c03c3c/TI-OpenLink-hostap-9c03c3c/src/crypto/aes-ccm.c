@@ -0,0 +1,238 @@
+/*
+ * Counter with CBC-MAC (CCM) with AES
+ *
+ * Copyright (c) 2010, Jouni Malinen <j@w1.fi>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "aes.h"
+#include "aes_wrap.h"
+
+/* Only L=2 is supported, i.e., 13 octet nonce and up to 64 kB of data */
+#define CCM_L 2
+#define CCM_NONCE_LEN (15 - CCM_L)
+
+/* Number of counter blocks encrypted with a single aes_encrypt_blocks() */
+#define CCM_CTR_BLOCKS 8
+
+
+static void xor_aes_block(u8 *dst, const u8 *src)
+{
+	int i;
+
+	/* src may point to unaligned frame data */
+	for (i = 0; i < AES_BLOCK_SIZE; i++)
+		dst[i] ^= src[i];
+}
+
+
+static void aes_ccm_auth_start(void *aes, size_t M, const u8 *nonce,
+			       const u8 *aad, size_t aad_len, size_t plain_len,
+			       u8 *x)
+{
+	u8 b[AES_BLOCK_SIZE];
+	size_t i, pos;
+
+	/* B_0: Flags | Nonce N | l(m) */
+	b[0] = aad_len ? 0x40 : 0 /* Adata */;
+	b[0] |= ((M - 2) / 2) /* M' */ << 3;
+	b[0] |= CCM_L - 1 /* L' */;
+	os_memcpy(&b[1], nonce, CCM_NONCE_LEN);
+	WPA_PUT_BE16(&b[AES_BLOCK_SIZE - CCM_L], plain_len);
+	aes_encrypt(aes, b, x); /* X_1 = E(K, B_0) */
+
+	if (aad_len == 0)
+		return;
+
+	/* B_1..B_n: l(a) | a | zero padding */
+	os_memset(b, 0, AES_BLOCK_SIZE);
+	WPA_PUT_BE16(b, aad_len);
+	pos = 2;
+	for (i = 0; i < aad_len; i++) {
+		b[pos++] = aad[i];
+		if (pos == AES_BLOCK_SIZE) {
+			xor_aes_block(x, b);
+			aes_encrypt(aes, x, x);
+			os_memset(b, 0, AES_BLOCK_SIZE);
+			pos = 0;
+		}
+	}
+	if (pos) {
+		xor_aes_block(x, b);
+		aes_encrypt(aes, x, x);
+	}
+}
+
+
+static void aes_ccm_auth(void *aes, const u8 *data, size_t len, u8 *x)
+{
+	size_t last = len % AES_BLOCK_SIZE;
+	size_t i;
+
+	for (i = 0; i < len / AES_BLOCK_SIZE; i++) {
+		/* X_i+1 = E(K, X_i XOR B_i) */
+		xor_aes_block(x, data);
+		data += AES_BLOCK_SIZE;
+		aes_encrypt(aes, x, x);
+	}
+	if (last) {
+		/* XOR zero-padded last block */
+		for (i = 0; i < last; i++)
+			x[i] ^= *data++;
+		aes_encrypt(aes, x, x);
+	}
+}
+
+
+static void aes_ccm_encr_start(const u8 *nonce, u8 *a)
+{
+	/* A_i = Flags | Nonce N | Counter i */
+	a[0] = CCM_L - 1; /* Flags = L' */
+	os_memcpy(&a[1], nonce, CCM_NONCE_LEN);
+}
+
+
+static void aes_ccm_encr(void *aes, const u8 *in, size_t len, u8 *out, u8 *a)
+{
+	u8 ctrs[CCM_CTR_BLOCKS * AES_BLOCK_SIZE];
+	u8 buf[CCM_CTR_BLOCKS * AES_BLOCK_SIZE];
+	size_t i, n, blen, ctr = 1;
+
+	/* crypt = msg XOR (S_1 | S_2 | ... | S_n) */
+	while (len > 0) {
+		n = (len + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+		if (n > CCM_CTR_BLOCKS)
+			n = CCM_CTR_BLOCKS;
+		for (i = 0; i < n; i++) {
+			WPA_PUT_BE16(&a[AES_BLOCK_SIZE - CCM_L], ctr);
+			ctr++;
+			os_memcpy(&ctrs[i * AES_BLOCK_SIZE], a, AES_BLOCK_SIZE);
+		}
+		/* S_i = E(K, A_i) */
+		aes_encrypt_blocks(aes, ctrs, buf, n);
+
+		blen = len < n * AES_BLOCK_SIZE ? len : n * AES_BLOCK_SIZE;
+		for (i = 0; i < blen; i++)
+			out[i] = in[i] ^ buf[i];
+		in += blen;
+		out += blen;
+		len -= blen;
+	}
+
+	os_memset(buf, 0, sizeof(buf));
+}
+
+
+static void aes_ccm_encr_auth(void *aes, size_t M, u8 *x, u8 *a, u8 *auth)
+{
+	size_t i;
+	u8 tmp[AES_BLOCK_SIZE];
+
+	/* U = T XOR S_0; S_0 = E(K, A_0) */
+	WPA_PUT_BE16(&a[AES_BLOCK_SIZE - CCM_L], 0);
+	aes_encrypt(aes, a, tmp);
+	for (i = 0; i < M; i++)
+		auth[i] = x[i] ^ tmp[i];
+}
+
+
+static void * aes_ccm_init(const u8 *key, size_t key_len, size_t M,
+			   size_t data_len, size_t aad_len)
+{
+	if (M < 4 || M > AES_BLOCK_SIZE || (M & 1) || data_len > 0xffff ||
+	    aad_len >= 0xff00)
+		return NULL;
+	return aes_encrypt_init(key, key_len);
+}
+
+
+/**
+ * aes_ccm_ae - AES-CCM authenticated encryption
+ * @key: Key for encryption
+ * @key_len: Length of the key in bytes
+ * @nonce: Nonce (13 bytes)
+ * @M: Length of the authentication field in bytes (4..16, even)
+ * @plain: Plaintext
+ * @plain_len: Length of the plaintext in bytes (at most 65535)
+ * @aad: Additional authenticated data
+ * @aad_len: Length of the additional authenticated data in bytes
+ * @crypt: Buffer for the ciphertext (@plain_len bytes)
+ * @auth: Buffer for the encrypted authentication field (@M bytes)
+ * Returns: 0 on success, -1 on failure
+ *
+ * The CTR part of the operation is done in runs of several blocks so that
+ * the AES implementation can process them in parallel.
+ */
+int aes_ccm_ae(const u8 *key, size_t key_len, const u8 *nonce, size_t M,
+	       const u8 *plain, size_t plain_len, const u8 *aad,
+	       size_t aad_len, u8 *crypt, u8 *auth)
+{
+	void *aes;
+	u8 x[AES_BLOCK_SIZE], a[AES_BLOCK_SIZE];
+
+	aes = aes_ccm_init(key, key_len, M, plain_len, aad_len);
+	if (aes == NULL)
+		return -1;
+
+	aes_ccm_auth_start(aes, M, nonce, aad, aad_len, plain_len, x);
+	aes_ccm_auth(aes, plain, plain_len, x);
+
+	/* Encryption */
+	aes_ccm_encr_start(nonce, a);
+	aes_ccm_encr(aes, plain, plain_len, crypt, a);
+	aes_ccm_encr_auth(aes, M, x, a, auth);
+
+	aes_encrypt_deinit(aes);
+
+	return 0;
+}
+
+
+/**
+ * aes_ccm_ad - AES-CCM authenticated decryption
+ * @key: Key for decryption
+ * @key_len: Length of the key in bytes
+ * @nonce: Nonce (13 bytes)
+ * @M: Length of the authentication field in bytes (4..16, even)
+ * @crypt: Ciphertext
+ * @crypt_len: Length of the ciphertext in bytes (at most 65535)
+ * @aad: Additional authenticated data
+ * @aad_len: Length of the additional authenticated data in bytes
+ * @auth: Encrypted authentication field (@M bytes)
+ * @plain: Buffer for the plaintext (@crypt_len bytes)
+ * Returns: 0 on success, -1 on failure (including authentication failure)
+ */
+int aes_ccm_ad(const u8 *key, size_t key_len, const u8 *nonce, size_t M,
+	       const u8 *crypt, size_t crypt_len, const u8 *aad,
+	       size_t aad_len, const u8 *auth, u8 *plain)
+{
+	void *aes;
+	u8 x[AES_BLOCK_SIZE], a[AES_BLOCK_SIZE];
+	u8 t[AES_BLOCK_SIZE];
+
+	aes = aes_ccm_init(key, key_len, M, crypt_len, aad_len);
+	if (aes == NULL)
+		return -1;
+
+	/* Decryption */
+	aes_ccm_encr_start(nonce, a);
+	aes_ccm_encr(aes, crypt, crypt_len, plain, a);
+
+	aes_ccm_auth_start(aes, M, nonce, aad, aad_len, crypt_len, x);
+	aes_ccm_auth(aes, plain, crypt_len, x);
+	aes_ccm_encr_auth(aes, M, x, a, t);
+
+	aes_encrypt_deinit(aes);
+
+	if (os_memcmp(t, auth, M) != 0) {
+		os_memset(plain, 0, crypt_len);
+		return -1;
+	}
+
+	return 0;
+}
@@ -13,6 +13,9 @@
 #include "aes.h"
 #include "aes_wrap.h"
 
+/* Number of counter blocks encrypted with a single aes_encrypt_blocks() */
+#define AES_CTR_BLOCKS 8
+
 /**
  * aes_128_ctr_encrypt - AES-128 CTR mode encryption
  * @key: Key for encryption (16 bytes)
@@ -25,10 +28,12 @@ int aes_128_ctr_encrypt(const u8 *key, const u8 *nonce,
 			u8 *data, size_t data_len)
 {
 	void *ctx;
-	size_t j, len, left = data_len;
+	size_t j, n, len, left = data_len;
 	int i;
 	u8 *pos = data;
-	u8 counter[AES_BLOCK_SIZE], buf[AES_BLOCK_SIZE];
+	u8 counter[AES_BLOCK_SIZE];
+	u8 ctrs[AES_CTR_BLOCKS * AES_BLOCK_SIZE];
+	u8 buf[AES_CTR_BLOCKS * AES_BLOCK_SIZE];
 
 	ctx = aes_encrypt_init(key, 16);
 	if (ctx == NULL)
@@ -36,20 +41,29 @@ int aes_128_ctr_encrypt(const u8 *key, const u8 *nonce,
 	os_memcpy(counter, nonce, AES_BLOCK_SIZE);
 
 	while (left > 0) {
-		aes_encrypt(ctx, counter, buf);
+		/* Build a run of counter blocks so that the cipher can work on
+		 * several independent blocks at a time */
+		n = (left + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+		if (n > AES_CTR_BLOCKS)
+			n = AES_CTR_BLOCKS;
+		for (j = 0; j < n; j++) {
+			os_memcpy(&ctrs[j * AES_BLOCK_SIZE], counter,
+				  AES_BLOCK_SIZE);
+			for (i = AES_BLOCK_SIZE - 1; i >= 0; i--) {
+				counter[i]++;
+				if (counter[i])
+					break;
+			}
+		}
+		aes_encrypt_blocks(ctx, ctrs, buf, n);
 
-		len = (left < AES_BLOCK_SIZE) ? left : AES_BLOCK_SIZE;
+		len = (left < n * AES_BLOCK_SIZE) ? left : n * AES_BLOCK_SIZE;
 		for (j = 0; j < len; j++)
 			pos[j] ^= buf[j];
 		pos += len;
 		left -= len;
-
-		for (i = AES_BLOCK_SIZE - 1; i >= 0; i--) {
-			counter[i]++;
-			if (counter[i])
-				break;
-		}
 	}
 	aes_encrypt_deinit(ctx);
+	os_memset(buf, 0, sizeof(buf));
 	return 0;
 }
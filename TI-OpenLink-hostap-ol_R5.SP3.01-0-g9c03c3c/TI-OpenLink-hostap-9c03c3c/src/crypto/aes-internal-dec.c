@@ -21,6 +21,8 @@
 #include "crypto.h"
 #include "aes_i.h"
 
+#ifndef AES_CONSTANT_TIME
+
 /**
  * Expand the cipher key into the decryption key schedule.
  *
@@ -53,18 +55,6 @@ static void rijndaelKeySetupDec(u32 rk[/*44*/], const u8 cipherKey[])
 	}
 }
 
-void * aes_decrypt_init(const u8 *key, size_t len)
-{
-	u32 *rk;
-	if (len != 16)
-		return NULL;
-	rk = os_malloc(AES_PRIV_SIZE);
-	if (rk == NULL)
-		return NULL;
-	rijndaelKeySetupDec(rk, key);
-	return rk;
-}
-
 static void rijndaelDecrypt(const u32 rk[/*44*/], const u8 ct[16], u8 pt[16])
 {
 	u32 s0, s1, s2, s3, t0, t1, t2, t3;
@@ -132,9 +122,48 @@ d##3 = TD0(s##3) ^ TD1(s##2) ^ TD2(s##1) ^ TD3(s##0) ^ rk[4 * i + 3]
 	PUTU32(pt + 12, s3);
 }
 
+#endif /* AES_CONSTANT_TIME */
+
+
+void * aes_decrypt_init(const u8 *key, size_t len)
+{
+	struct aes_internal_ctx *ctx;
+	if (len != 16)
+		return NULL;
+	ctx = os_malloc(AES_PRIV_SIZE);
+	if (ctx == NULL)
+		return NULL;
+#ifdef AES_NI
+	ctx->ni = aes_ni_available();
+	if (ctx->ni) {
+		aes_ni_key_setup_dec(ctx->rk, key);
+		return ctx;
+	}
+#endif /* AES_NI */
+#ifdef AES_CONSTANT_TIME
+	aes_ct_key_setup(ctx->rk, key);
+#else /* AES_CONSTANT_TIME */
+	rijndaelKeySetupDec(ctx->rk, key);
+#endif /* AES_CONSTANT_TIME */
+	return ctx;
+}
+
+
 void aes_decrypt(void *ctx, const u8 *crypt, u8 *plain)
 {
-	rijndaelDecrypt(ctx, crypt, plain);
+	struct aes_internal_ctx *aes = ctx;
+
+#ifdef AES_NI
+	if (aes->ni) {
+		aes_ni_decrypt(aes->rk, crypt, plain, 1);
+		return;
+	}
+#endif /* AES_NI */
+#ifdef AES_CONSTANT_TIME
+	aes_ct_decrypt(aes->rk, crypt, plain, 1);
+#else /* AES_CONSTANT_TIME */
+	rijndaelDecrypt(aes->rk, crypt, plain);
+#endif /* AES_CONSTANT_TIME */
 }
 
 
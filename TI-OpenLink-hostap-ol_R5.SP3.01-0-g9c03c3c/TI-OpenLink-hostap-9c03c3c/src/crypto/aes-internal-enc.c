@@ -21,6 +21,8 @@
 #include "crypto.h"
 #include "aes_i.h"
 
+#ifndef AES_CONSTANT_TIME
+
 static void rijndaelEncrypt(const u32 rk[/*44*/], const u8 pt[16], u8 ct[16])
 {
 	u32 s0, s1, s2, s3, t0, t1, t2, t3;
@@ -88,23 +90,58 @@ d##3 = TE0(s##3) ^ TE1(s##0) ^ TE2(s##1) ^ TE3(s##2) ^ rk[4 * i + 3]
 	PUTU32(ct + 12, s3);
 }
 
+#endif /* AES_CONSTANT_TIME */
+
 
 void * aes_encrypt_init(const u8 *key, size_t len)
 {
-	u32 *rk;
+	struct aes_internal_ctx *ctx;
 	if (len != 16)
 		return NULL;
-	rk = os_malloc(AES_PRIV_SIZE);
-	if (rk == NULL)
+	ctx = os_malloc(AES_PRIV_SIZE);
+	if (ctx == NULL)
 		return NULL;
-	rijndaelKeySetupEnc(rk, key);
-	return rk;
+#ifdef AES_NI
+	ctx->ni = aes_ni_available();
+	if (ctx->ni) {
+		aes_ni_key_setup_enc(ctx->rk, key);
+		return ctx;
+	}
+#endif /* AES_NI */
+#ifdef AES_CONSTANT_TIME
+	aes_ct_key_setup(ctx->rk, key);
+#else /* AES_CONSTANT_TIME */
+	rijndaelKeySetupEnc(ctx->rk, key);
+#endif /* AES_CONSTANT_TIME */
+	return ctx;
 }
 
 
 void aes_encrypt(void *ctx, const u8 *plain, u8 *crypt)
 {
-	rijndaelEncrypt(ctx, plain, crypt);
+	aes_encrypt_blocks(ctx, plain, crypt, 1);
+}
+
+
+void aes_encrypt_blocks(void *ctx, const u8 *plain, u8 *crypt, size_t num)
+{
+	struct aes_internal_ctx *aes = ctx;
+
+#ifdef AES_NI
+	if (aes->ni) {
+		aes_ni_encrypt(aes->rk, plain, crypt, num);
+		return;
+	}
+#endif /* AES_NI */
+#ifdef AES_CONSTANT_TIME
+	aes_ct_encrypt(aes->rk, plain, crypt, num);
+#else /* AES_CONSTANT_TIME */
+	while (num--) {
+		rijndaelEncrypt(aes->rk, plain, crypt);
+		plain += AES_BLOCK_SIZE;
+		crypt += AES_BLOCK_SIZE;
+	}
+#endif /* AES_CONSTANT_TIME */
 }
 
 
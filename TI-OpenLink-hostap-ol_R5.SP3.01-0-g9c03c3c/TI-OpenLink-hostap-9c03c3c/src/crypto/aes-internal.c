@@ -62,6 +62,8 @@ Td3[x] = Si[x].[09, 0d, 0b, 0e];
 Td4[x] = Si[x].[01, 01, 01, 01];
 */
 
+#ifndef AES_CONSTANT_TIME
+
 const u32 Te0[256] = {
     0xc66363a5U, 0xf87c7c84U, 0xee777799U, 0xf67b7b8dU,
     0xfff2f20dU, 0xd66b6bbdU, 0xde6f6fb1U, 0x91c5c554U,
@@ -797,3 +799,704 @@ void rijndaelKeySetupEnc(u32 rk[/*44*/], const u8 cipherKey[])
 		rk += 4;
 	}
 }
+
+#endif /* AES_CONSTANT_TIME */
+
+
+#ifdef AES_CONSTANT_TIME
+
+/*
+ * Bitsliced AES following the design of the aes_ct implementation in BearSSL
+ * by Thomas Pornin. Two blocks are processed in parallel: after the ortho()
+ * transform, q[i] holds bit i of every byte of both blocks. The S-box is the
+ * Boyar-Peralta circuit, so there are no secret dependent memory accesses or
+ * branches anywhere in the cipher or key schedule.
+ */
+
+static void aes_ct_sbox(u32 *q)
+{
+	u32 x0, x1, x2, x3, x4, x5, x6, x7;
+	u32 y1, y2, y3, y4, y5, y6, y7, y8, y9;
+	u32 y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+	u32 y20, y21;
+	u32 z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+	u32 z10, z11, z12, z13, z14, z15, z16, z17;
+	u32 t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+	u32 t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+	u32 t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+	u32 t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+	u32 t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+	u32 t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+	u32 t60, t61, t62, t63, t64, t65, t66, t67;
+	u32 s0, s1, s2, s3, s4, s5, s6, s7;
+
+	x0 = q[7];
+	x1 = q[6];
+	x2 = q[5];
+	x3 = q[4];
+	x4 = q[3];
+	x5 = q[2];
+	x6 = q[1];
+	x7 = q[0];
+
+	/* Top linear transformation */
+	y14 = x3 ^ x5;
+	y13 = x0 ^ x6;
+	y9 = x0 ^ x3;
+	y8 = x0 ^ x5;
+	t0 = x1 ^ x2;
+	y1 = t0 ^ x7;
+	y4 = y1 ^ x3;
+	y12 = y13 ^ y14;
+	y2 = y1 ^ x0;
+	y5 = y1 ^ x6;
+	y3 = y5 ^ y8;
+	t1 = x4 ^ y12;
+	y15 = t1 ^ x5;
+	y20 = t1 ^ x1;
+	y6 = y15 ^ x7;
+	y10 = y15 ^ t0;
+	y11 = y20 ^ y9;
+	y7 = x7 ^ y11;
+	y17 = y10 ^ y11;
+	y19 = y10 ^ y8;
+	y16 = t0 ^ y11;
+	y21 = y13 ^ y16;
+	y18 = x0 ^ y16;
+
+	/* Non-linear section */
+	t2 = y12 & y15;
+	t3 = y3 & y6;
+	t4 = t3 ^ t2;
+	t5 = y4 & x7;
+	t6 = t5 ^ t2;
+	t7 = y13 & y16;
+	t8 = y5 & y1;
+	t9 = t8 ^ t7;
+	t10 = y2 & y7;
+	t11 = t10 ^ t7;
+	t12 = y9 & y11;
+	t13 = y14 & y17;
+	t14 = t13 ^ t12;
+	t15 = y8 & y10;
+	t16 = t15 ^ t12;
+	t17 = t4 ^ t14;
+	t18 = t6 ^ t16;
+	t19 = t9 ^ t14;
+	t20 = t11 ^ t16;
+	t21 = t17 ^ y20;
+	t22 = t18 ^ y19;
+	t23 = t19 ^ y21;
+	t24 = t20 ^ y18;
+
+	t25 = t21 ^ t22;
+	t26 = t21 & t23;
+	t27 = t24 ^ t26;
+	t28 = t25 & t27;
+	t29 = t28 ^ t22;
+	t30 = t23 ^ t24;
+	t31 = t22 ^ t26;
+	t32 = t31 & t30;
+	t33 = t32 ^ t24;
+	t34 = t23 ^ t33;
+	t35 = t27 ^ t33;
+	t36 = t24 & t35;
+	t37 = t36 ^ t34;
+	t38 = t27 ^ t36;
+	t39 = t29 & t38;
+	t40 = t25 ^ t39;
+
+	t41 = t40 ^ t37;
+	t42 = t29 ^ t33;
+	t43 = t29 ^ t40;
+	t44 = t33 ^ t37;
+	t45 = t42 ^ t41;
+	z0 = t44 & y15;
+	z1 = t37 & y6;
+	z2 = t33 & x7;
+	z3 = t43 & y16;
+	z4 = t40 & y1;
+	z5 = t29 & y7;
+	z6 = t42 & y11;
+	z7 = t45 & y17;
+	z8 = t41 & y10;
+	z9 = t44 & y12;
+	z10 = t37 & y3;
+	z11 = t33 & y4;
+	z12 = t43 & y13;
+	z13 = t40 & y5;
+	z14 = t29 & y2;
+	z15 = t42 & y9;
+	z16 = t45 & y14;
+	z17 = t41 & y8;
+
+	/* Bottom linear transformation */
+	t46 = z15 ^ z16;
+	t47 = z10 ^ z11;
+	t48 = z5 ^ z13;
+	t49 = z9 ^ z10;
+	t50 = z2 ^ z12;
+	t51 = z2 ^ z5;
+	t52 = z7 ^ z8;
+	t53 = z0 ^ z3;
+	t54 = z6 ^ z7;
+	t55 = z16 ^ z17;
+	t56 = z12 ^ t48;
+	t57 = t50 ^ t53;
+	t58 = z4 ^ t46;
+	t59 = z3 ^ t54;
+	t60 = t46 ^ t57;
+	t61 = z14 ^ t57;
+	t62 = t52 ^ t58;
+	t63 = t49 ^ t58;
+	t64 = z4 ^ t59;
+	t65 = t61 ^ t62;
+	t66 = z1 ^ t63;
+	s0 = t59 ^ t63;
+	s6 = t56 ^ ~t62;
+	s7 = t48 ^ ~t60;
+	t67 = t64 ^ t65;
+	s3 = t53 ^ t66;
+	s4 = t51 ^ t66;
+	s5 = t47 ^ t65;
+	s1 = t64 ^ ~s3;
+	s2 = t55 ^ ~t67;
+
+	q[7] = s0;
+	q[6] = s1;
+	q[5] = s2;
+	q[4] = s3;
+	q[3] = s4;
+	q[2] = s5;
+	q[1] = s6;
+	q[0] = s7;
+}
+
+
+/* Inverse affine transform of the S-box followed by the 0x63 constant */
+static void aes_ct_inv_affine(u32 *q)
+{
+	u32 q0, q1, q2, q3, q4, q5, q6, q7;
+
+	q0 = ~q[0];
+	q1 = ~q[1];
+	q2 = q[2];
+	q3 = q[3];
+	q4 = q[4];
+	q5 = ~q[5];
+	q6 = ~q[6];
+	q7 = q[7];
+	q[7] = q1 ^ q4 ^ q6;
+	q[6] = q0 ^ q3 ^ q5;
+	q[5] = q7 ^ q2 ^ q4;
+	q[4] = q6 ^ q1 ^ q3;
+	q[3] = q5 ^ q0 ^ q2;
+	q[2] = q4 ^ q7 ^ q1;
+	q[1] = q3 ^ q6 ^ q0;
+	q[0] = q2 ^ q5 ^ q7;
+}
+
+
+static void aes_ct_inv_sbox(u32 *q)
+{
+	/*
+	 * S(x) = A(I(x)) ^ 0x63 where I() is the GF(2^8) inversion, so the
+	 * inverse S-box can use the same circuit:
+	 * iS(x) = B(S(B(x ^ 0x63)) ^ 0x63) where B() is the inverse of A().
+	 */
+	aes_ct_inv_affine(q);
+	aes_ct_sbox(q);
+	aes_ct_inv_affine(q);
+}
+
+
+#define AES_CT_SWAPN(cl, ch, s, x, y) do { \
+	u32 a = (x), b = (y); \
+	(x) = (a & (u32) (cl)) | ((b & (u32) (cl)) << (s)); \
+	(y) = ((a & (u32) (ch)) >> (s)) | (b & (u32) (ch)); \
+} while (0)
+
+#define AES_CT_SWAP2(x, y) AES_CT_SWAPN(0x55555555, 0xAAAAAAAA, 1, x, y)
+#define AES_CT_SWAP4(x, y) AES_CT_SWAPN(0x33333333, 0xCCCCCCCC, 2, x, y)
+#define AES_CT_SWAP8(x, y) AES_CT_SWAPN(0x0F0F0F0F, 0xF0F0F0F0, 4, x, y)
+
+/* Convert between the byte and the bitsliced representation (involution) */
+static void aes_ct_ortho(u32 *q)
+{
+	AES_CT_SWAP2(q[0], q[1]);
+	AES_CT_SWAP2(q[2], q[3]);
+	AES_CT_SWAP2(q[4], q[5]);
+	AES_CT_SWAP2(q[6], q[7]);
+
+	AES_CT_SWAP4(q[0], q[2]);
+	AES_CT_SWAP4(q[1], q[3]);
+	AES_CT_SWAP4(q[4], q[6]);
+	AES_CT_SWAP4(q[5], q[7]);
+
+	AES_CT_SWAP8(q[0], q[4]);
+	AES_CT_SWAP8(q[1], q[5]);
+	AES_CT_SWAP8(q[2], q[6]);
+	AES_CT_SWAP8(q[3], q[7]);
+}
+
+
+static u32 aes_ct_sub_word(u32 x)
+{
+	u32 q[8];
+	int i;
+
+	for (i = 0; i < 8; i++)
+		q[i] = x;
+	aes_ct_ortho(q);
+	aes_ct_sbox(q);
+	aes_ct_ortho(q);
+	return q[0];
+}
+
+
+/**
+ * aes_ct_key_setup - Expand an AES-128 key for the bitsliced implementation
+ * @rk: Buffer for the 88 word bitsliced key schedule
+ * @key: 128-bit key
+ *
+ * The same key schedule is used for both encryption and decryption.
+ */
+void aes_ct_key_setup(u32 rk[/*88*/], const u8 key[])
+{
+	static const u8 rcon[10] = {
+		0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36
+	};
+	u32 w[44], q[8], tmp;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		w[i] = WPA_GET_LE32(key + 4 * i);
+	for (i = 4; i < 44; i++) {
+		tmp = w[i - 1];
+		if ((i & 3) == 0) {
+			tmp = (tmp << 24) | (tmp >> 8);
+			tmp = aes_ct_sub_word(tmp) ^ rcon[i / 4 - 1];
+		}
+		w[i] = w[i - 4] ^ tmp;
+	}
+
+	/* Round keys are applied to both blocks, so duplicate them before
+	 * converting to the bitsliced representation. */
+	for (i = 0; i < 11; i++) {
+		q[0] = q[1] = w[4 * i];
+		q[2] = q[3] = w[4 * i + 1];
+		q[4] = q[5] = w[4 * i + 2];
+		q[6] = q[7] = w[4 * i + 3];
+		aes_ct_ortho(q);
+		os_memcpy(&rk[8 * i], q, sizeof(q));
+	}
+
+	os_memset(w, 0, sizeof(w));
+	os_memset(q, 0, sizeof(q));
+}
+
+
+static void aes_ct_add_round_key(u32 *q, const u32 *rk)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		q[i] ^= rk[i];
+}
+
+
+static void aes_ct_shift_rows(u32 *q)
+{
+	int i;
+	u32 x;
+
+	for (i = 0; i < 8; i++) {
+		x = q[i];
+		q[i] = (x & 0x000000FF) |
+			((x & 0x0000FC00) >> 2) | ((x & 0x00000300) << 6) |
+			((x & 0x00F00000) >> 4) | ((x & 0x000F0000) << 4) |
+			((x & 0xC0000000) >> 6) | ((x & 0x3F000000) << 2);
+	}
+}
+
+
+static void aes_ct_inv_shift_rows(u32 *q)
+{
+	int i;
+	u32 x;
+
+	for (i = 0; i < 8; i++) {
+		x = q[i];
+		q[i] = (x & 0x000000FF) |
+			((x & 0x00003F00) << 2) | ((x & 0x0000C000) >> 6) |
+			((x & 0x000F0000) << 4) | ((x & 0x00F00000) >> 4) |
+			((x & 0x03000000) << 6) | ((x & 0xFC000000) >> 2);
+	}
+}
+
+
+static inline u32 aes_ct_rotr16(u32 x)
+{
+	return (x << 16) | (x >> 16);
+}
+
+
+static void aes_ct_mix_columns(u32 *q)
+{
+	u32 q0, q1, q2, q3, q4, q5, q6, q7;
+	u32 r0, r1, r2, r3, r4, r5, r6, r7;
+
+	q0 = q[0];
+	q1 = q[1];
+	q2 = q[2];
+	q3 = q[3];
+	q4 = q[4];
+	q5 = q[5];
+	q6 = q[6];
+	q7 = q[7];
+	r0 = (q0 >> 8) | (q0 << 24);
+	r1 = (q1 >> 8) | (q1 << 24);
+	r2 = (q2 >> 8) | (q2 << 24);
+	r3 = (q3 >> 8) | (q3 << 24);
+	r4 = (q4 >> 8) | (q4 << 24);
+	r5 = (q5 >> 8) | (q5 << 24);
+	r6 = (q6 >> 8) | (q6 << 24);
+	r7 = (q7 >> 8) | (q7 << 24);
+
+	q[0] = q7 ^ r7 ^ r0 ^ aes_ct_rotr16(q0 ^ r0);
+	q[1] = q0 ^ r0 ^ q7 ^ r7 ^ r1 ^ aes_ct_rotr16(q1 ^ r1);
+	q[2] = q1 ^ r1 ^ r2 ^ aes_ct_rotr16(q2 ^ r2);
+	q[3] = q2 ^ r2 ^ q7 ^ r7 ^ r3 ^ aes_ct_rotr16(q3 ^ r3);
+	q[4] = q3 ^ r3 ^ q7 ^ r7 ^ r4 ^ aes_ct_rotr16(q4 ^ r4);
+	q[5] = q4 ^ r4 ^ r5 ^ aes_ct_rotr16(q5 ^ r5);
+	q[6] = q5 ^ r5 ^ r6 ^ aes_ct_rotr16(q6 ^ r6);
+	q[7] = q6 ^ r6 ^ r7 ^ aes_ct_rotr16(q7 ^ r7);
+}
+
+
+static void aes_ct_inv_mix_columns(u32 *q)
+{
+	u32 q0, q1, q2, q3, q4, q5, q6, q7;
+	u32 r0, r1, r2, r3, r4, r5, r6, r7;
+
+	q0 = q[0];
+	q1 = q[1];
+	q2 = q[2];
+	q3 = q[3];
+	q4 = q[4];
+	q5 = q[5];
+	q6 = q[6];
+	q7 = q[7];
+	r0 = (q0 >> 8) | (q0 << 24);
+	r1 = (q1 >> 8) | (q1 << 24);
+	r2 = (q2 >> 8) | (q2 << 24);
+	r3 = (q3 >> 8) | (q3 << 24);
+	r4 = (q4 >> 8) | (q4 << 24);
+	r5 = (q5 >> 8) | (q5 << 24);
+	r6 = (q6 >> 8) | (q6 << 24);
+	r7 = (q7 >> 8) | (q7 << 24);
+
+	q[0] = q5 ^ q6 ^ q7 ^ r0 ^ r5 ^ r7 ^
+		aes_ct_rotr16(q0 ^ q5 ^ q6 ^ r0 ^ r5);
+	q[1] = q0 ^ q5 ^ r0 ^ r1 ^ r5 ^ r6 ^ r7 ^
+		aes_ct_rotr16(q1 ^ q5 ^ q7 ^ r1 ^ r5 ^ r6);
+	q[2] = q0 ^ q1 ^ q6 ^ r1 ^ r2 ^ r6 ^ r7 ^
+		aes_ct_rotr16(q0 ^ q2 ^ q6 ^ r2 ^ r6 ^ r7);
+	q[3] = q0 ^ q1 ^ q2 ^ q5 ^ q6 ^ r0 ^ r2 ^ r3 ^ r5 ^
+		aes_ct_rotr16(q0 ^ q1 ^ q3 ^ q5 ^ q6 ^ q7 ^ r0 ^ r3 ^ r5 ^
+			      r7);
+	q[4] = q1 ^ q2 ^ q3 ^ q5 ^ r1 ^ r3 ^ r4 ^ r5 ^ r6 ^ r7 ^
+		aes_ct_rotr16(q1 ^ q2 ^ q4 ^ q5 ^ q7 ^ r1 ^ r4 ^ r5 ^ r6);
+	q[5] = q2 ^ q3 ^ q4 ^ q6 ^ r2 ^ r4 ^ r5 ^ r6 ^ r7 ^
+		aes_ct_rotr16(q2 ^ q3 ^ q5 ^ q6 ^ r2 ^ r5 ^ r6 ^ r7);
+	q[6] = q3 ^ q4 ^ q5 ^ q7 ^ r3 ^ r5 ^ r6 ^ r7 ^
+		aes_ct_rotr16(q3 ^ q4 ^ q6 ^ q7 ^ r3 ^ r6 ^ r7);
+	q[7] = q4 ^ q5 ^ q6 ^ r4 ^ r6 ^ r7 ^
+		aes_ct_rotr16(q4 ^ q5 ^ q7 ^ r4 ^ r7);
+}
+
+
+static void aes_ct_load(u32 *q, const u8 *in, size_t num)
+{
+	q[0] = WPA_GET_LE32(in);
+	q[2] = WPA_GET_LE32(in + 4);
+	q[4] = WPA_GET_LE32(in + 8);
+	q[6] = WPA_GET_LE32(in + 12);
+	if (num > 1) {
+		q[1] = WPA_GET_LE32(in + 16);
+		q[3] = WPA_GET_LE32(in + 20);
+		q[5] = WPA_GET_LE32(in + 24);
+		q[7] = WPA_GET_LE32(in + 28);
+	} else
+		q[1] = q[3] = q[5] = q[7] = 0;
+	aes_ct_ortho(q);
+}
+
+
+static void aes_ct_store(u32 *q, u8 *out, size_t num)
+{
+	aes_ct_ortho(q);
+	WPA_PUT_LE32(out, q[0]);
+	WPA_PUT_LE32(out + 4, q[2]);
+	WPA_PUT_LE32(out + 8, q[4]);
+	WPA_PUT_LE32(out + 12, q[6]);
+	if (num > 1) {
+		WPA_PUT_LE32(out + 16, q[1]);
+		WPA_PUT_LE32(out + 20, q[3]);
+		WPA_PUT_LE32(out + 24, q[5]);
+		WPA_PUT_LE32(out + 28, q[7]);
+	}
+}
+
+
+/**
+ * aes_ct_encrypt - Encrypt blocks with the bitsliced implementation
+ * @rk: Key schedule from aes_ct_key_setup()
+ * @in: Input blocks
+ * @out: Output blocks; may be the same buffer as @in
+ * @num: Number of 16-byte blocks
+ */
+void aes_ct_encrypt(const u32 rk[/*88*/], const u8 *in, u8 *out, size_t num)
+{
+	u32 q[8];
+	int r;
+
+	while (num > 0) {
+		aes_ct_load(q, in, num);
+		aes_ct_add_round_key(q, rk);
+		for (r = 1; r < 10; r++) {
+			aes_ct_sbox(q);
+			aes_ct_shift_rows(q);
+			aes_ct_mix_columns(q);
+			aes_ct_add_round_key(q, rk + 8 * r);
+		}
+		aes_ct_sbox(q);
+		aes_ct_shift_rows(q);
+		aes_ct_add_round_key(q, rk + 80);
+		aes_ct_store(q, out, num);
+
+		if (num == 1)
+			break;
+		in += 2 * AES_BLOCK_SIZE;
+		out += 2 * AES_BLOCK_SIZE;
+		num -= 2;
+	}
+}
+
+
+/**
+ * aes_ct_decrypt - Decrypt blocks with the bitsliced implementation
+ * @rk: Key schedule from aes_ct_key_setup()
+ * @in: Input blocks
+ * @out: Output blocks; may be the same buffer as @in
+ * @num: Number of 16-byte blocks
+ */
+void aes_ct_decrypt(const u32 rk[/*88*/], const u8 *in, u8 *out, size_t num)
+{
+	u32 q[8];
+	int r;
+
+	while (num > 0) {
+		aes_ct_load(q, in, num);
+		aes_ct_add_round_key(q, rk + 80);
+		for (r = 9; r > 0; r--) {
+			aes_ct_inv_shift_rows(q);
+			aes_ct_inv_sbox(q);
+			aes_ct_add_round_key(q, rk + 8 * r);
+			aes_ct_inv_mix_columns(q);
+		}
+		aes_ct_inv_shift_rows(q);
+		aes_ct_inv_sbox(q);
+		aes_ct_add_round_key(q, rk);
+		aes_ct_store(q, out, num);
+
+		if (num == 1)
+			break;
+		in += 2 * AES_BLOCK_SIZE;
+		out += 2 * AES_BLOCK_SIZE;
+		num -= 2;
+	}
+}
+
+#endif /* AES_CONSTANT_TIME */
+
+
+#ifdef AES_NI
+
+#include <cpuid.h>
+#include <wmmintrin.h>
+
+#define AES_NI_TARGET __attribute__((target("aes,sse2")))
+
+/**
+ * aes_ni_available - Check whether the CPU supports AES-NI instructions
+ * Returns: 1 if AES-NI can be used, 0 if not
+ */
+int aes_ni_available(void)
+{
+	static int ni = -1;
+	unsigned int eax, ebx, ecx, edx;
+
+	if (ni < 0)
+		ni = __get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+			(ecx & bit_AES);
+	return ni;
+}
+
+
+static AES_NI_TARGET __m128i aes_ni_key_exp(__m128i key, __m128i gen)
+{
+	gen = _mm_shuffle_epi32(gen, 0xff);
+	key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+	key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+	key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+	return _mm_xor_si128(key, gen);
+}
+
+#define AES_NI_KEY_EXP(k, i, rcon) \
+	k[i] = aes_ni_key_exp(k[i - 1], \
+			      _mm_aeskeygenassist_si128(k[i - 1], rcon))
+
+
+/**
+ * aes_ni_key_setup_enc - Expand an AES-128 key for AES-NI encryption
+ * @rk: Buffer for the 44 word key schedule
+ * @key: 128-bit key
+ */
+AES_NI_TARGET void aes_ni_key_setup_enc(u32 rk[/*44*/], const u8 key[])
+{
+	__m128i k[11];
+	int i;
+
+	k[0] = _mm_loadu_si128((const __m128i *) key);
+	AES_NI_KEY_EXP(k, 1, 0x01);
+	AES_NI_KEY_EXP(k, 2, 0x02);
+	AES_NI_KEY_EXP(k, 3, 0x04);
+	AES_NI_KEY_EXP(k, 4, 0x08);
+	AES_NI_KEY_EXP(k, 5, 0x10);
+	AES_NI_KEY_EXP(k, 6, 0x20);
+	AES_NI_KEY_EXP(k, 7, 0x40);
+	AES_NI_KEY_EXP(k, 8, 0x80);
+	AES_NI_KEY_EXP(k, 9, 0x1b);
+	AES_NI_KEY_EXP(k, 10, 0x36);
+
+	for (i = 0; i < 11; i++)
+		_mm_storeu_si128((__m128i *) &rk[4 * i], k[i]);
+}
+
+
+/**
+ * aes_ni_key_setup_dec - Expand an AES-128 key for AES-NI decryption
+ * @rk: Buffer for the 44 word key schedule
+ * @key: 128-bit key
+ */
+AES_NI_TARGET void aes_ni_key_setup_dec(u32 rk[/*44*/], const u8 key[])
+{
+	__m128i k[11];
+	int i;
+
+	aes_ni_key_setup_enc(rk, key);
+	for (i = 0; i < 11; i++)
+		k[i] = _mm_loadu_si128((const __m128i *) &rk[4 * i]);
+
+	/* Equivalent inverse cipher: reverse order, InvMixColumns applied to
+	 * all but the first and the last round key */
+	_mm_storeu_si128((__m128i *) &rk[0], k[10]);
+	for (i = 1; i < 10; i++)
+		_mm_storeu_si128((__m128i *) &rk[4 * i],
+				 _mm_aesimc_si128(k[10 - i]));
+	_mm_storeu_si128((__m128i *) &rk[40], k[0]);
+}
+
+
+#define AES_NI_LOAD_KEYS(k, rk) do { \
+	int _i; \
+	for (_i = 0; _i < 11; _i++) \
+		k[_i] = _mm_loadu_si128((const __m128i *) &(rk)[4 * _i]); \
+} while (0)
+
+
+/**
+ * aes_ni_encrypt - Encrypt blocks with AES-NI
+ * @rk: Key schedule from aes_ni_key_setup_enc()
+ * @in: Input blocks
+ * @out: Output blocks; may be the same buffer as @in
+ * @num: Number of 16-byte blocks
+ */
+AES_NI_TARGET void aes_ni_encrypt(const u32 rk[/*44*/], const u8 *in, u8 *out,
+				  size_t num)
+{
+	__m128i k[11], b0, b1, b2, b3;
+	int r;
+
+	AES_NI_LOAD_KEYS(k, rk);
+
+	/* Interleave four independent blocks to hide the AESENC latency */
+	while (num >= 4) {
+		b0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) in), k[0]);
+		b1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) in + 1),
+				   k[0]);
+		b2 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) in + 2),
+				   k[0]);
+		b3 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) in + 3),
+				   k[0]);
+		for (r = 1; r < 10; r++) {
+			b0 = _mm_aesenc_si128(b0, k[r]);
+			b1 = _mm_aesenc_si128(b1, k[r]);
+			b2 = _mm_aesenc_si128(b2, k[r]);
+			b3 = _mm_aesenc_si128(b3, k[r]);
+		}
+		_mm_storeu_si128((__m128i *) out,
+				 _mm_aesenclast_si128(b0, k[10]));
+		_mm_storeu_si128((__m128i *) out + 1,
+				 _mm_aesenclast_si128(b1, k[10]));
+		_mm_storeu_si128((__m128i *) out + 2,
+				 _mm_aesenclast_si128(b2, k[10]));
+		_mm_storeu_si128((__m128i *) out + 3,
+				 _mm_aesenclast_si128(b3, k[10]));
+		in += 4 * AES_BLOCK_SIZE;
+		out += 4 * AES_BLOCK_SIZE;
+		num -= 4;
+	}
+
+	while (num > 0) {
+		b0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) in), k[0]);
+		for (r = 1; r < 10; r++)
+			b0 = _mm_aesenc_si128(b0, k[r]);
+		_mm_storeu_si128((__m128i *) out,
+				 _mm_aesenclast_si128(b0, k[10]));
+		in += AES_BLOCK_SIZE;
+		out += AES_BLOCK_SIZE;
+		num--;
+	}
+}
+
+
+/**
+ * aes_ni_decrypt - Decrypt blocks with AES-NI
+ * @rk: Key schedule from aes_ni_key_setup_dec()
+ * @in: Input blocks
+ * @out: Output blocks; may be the same buffer as @in
+ * @num: Number of 16-byte blocks
+ */
+AES_NI_TARGET void aes_ni_decrypt(const u32 rk[/*44*/], const u8 *in, u8 *out,
+				  size_t num)
+{
+	__m128i k[11], b0;
+	int r;
+
+	AES_NI_LOAD_KEYS(k, rk);
+
+	while (num > 0) {
+		b0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) in), k[0]);
+		for (r = 1; r < 10; r++)
+			b0 = _mm_aesdec_si128(b0, k[r]);
+		_mm_storeu_si128((__m128i *) out,
+				 _mm_aesdeclast_si128(b0, k[10]));
+		in += AES_BLOCK_SIZE;
+		out += AES_BLOCK_SIZE;
+		num--;
+	}
+}
+
+#endif /* AES_NI */
@@ -14,6 +14,23 @@
 /* #define FULL_UNROLL */
 #define AES_SMALL_TABLES
 
+/*
+ * Use the bitsliced implementation that does not have any secret dependent
+ * table lookups or branches. Undefine to use the faster, but cache-timing
+ * sensitive, T-table implementation on CPUs without AES instructions.
+ */
+#define AES_CONSTANT_TIME
+
+/*
+ * AES-NI instructions are used when the CPU reports support for them. The
+ * compiler needs to support per-function target options for this.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && \
+	(__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && \
+	(defined(__x86_64__) || defined(__i386__)) && !defined(CONFIG_NO_AES_NI)
+#define AES_NI
+#endif
+
 extern const u32 Te0[256];
 extern const u32 Te1[256];
 extern const u32 Te2[256];
@@ -109,8 +126,33 @@ static inline u32 rotr(u32 val, int bits)
 (ct)[2] = (u8)((st) >>  8); (ct)[3] = (u8)(st); }
 #endif
 
-#define AES_PRIV_SIZE (4 * 44)
-
+struct aes_internal_ctx {
+	/*
+	 * Round keys in the format used by the selected implementation:
+	 * 44 words for T-tables and AES-NI, 88 words for bitsliced AES
+	 */
+	u32 rk[88];
+#ifdef AES_NI
+	int ni;
+#endif /* AES_NI */
+};
+
+#define AES_PRIV_SIZE (sizeof(struct aes_internal_ctx))
+
+#ifdef AES_CONSTANT_TIME
+void aes_ct_key_setup(u32 rk[/*88*/], const u8 key[]);
+void aes_ct_encrypt(const u32 rk[/*88*/], const u8 *in, u8 *out, size_t num);
+void aes_ct_decrypt(const u32 rk[/*88*/], const u8 *in, u8 *out, size_t num);
+#else /* AES_CONSTANT_TIME */
 void rijndaelKeySetupEnc(u32 rk[/*44*/], const u8 cipherKey[]);
+#endif /* AES_CONSTANT_TIME */
+
+#ifdef AES_NI
+int aes_ni_available(void);
+void aes_ni_key_setup_enc(u32 rk[/*44*/], const u8 key[]);
+void aes_ni_key_setup_dec(u32 rk[/*44*/], const u8 key[]);
+void aes_ni_encrypt(const u32 rk[/*44*/], const u8 *in, u8 *out, size_t num);
+void aes_ni_decrypt(const u32 rk[/*44*/], const u8 *in, u8 *out, size_t num);
+#endif /* AES_NI */
 
 #endif /* AES_I_H */
@@ -303,6 +303,16 @@ void aes_encrypt(void *ctx, const u8 *plain, u8 *crypt)
 }
 
 
+void aes_encrypt_blocks(void *ctx, const u8 *plain, u8 *crypt, size_t num)
+{
+	while (num--) {
+		aes_encrypt(ctx, plain, crypt);
+		plain += 16;
+		crypt += 16;
+	}
+}
+
+
 void aes_encrypt_deinit(void *ctx)
 {
 	struct aes_context *akey = ctx;
@@ -146,6 +146,11 @@ void aes_encrypt(void *ctx, const u8 *plain, u8 *crypt)
 }
 
 
+void aes_encrypt_blocks(void *ctx, const u8 *plain, u8 *crypt, size_t num)
+{
+}
+
+
 void aes_encrypt_deinit(void *ctx)
 {
 }
@@ -222,6 +222,16 @@ void aes_encrypt(void *ctx, const u8 *plain, u8 *crypt)
 }
 
 
+void aes_encrypt_blocks(void *ctx, const u8 *plain, u8 *crypt, size_t num)
+{
+	while (num--) {
+		AES_encrypt(plain, crypt, ctx);
+		plain += 16;
+		crypt += 16;
+	}
+}
+
+
 void aes_encrypt_deinit(void *ctx)
 {
 	os_free(ctx);
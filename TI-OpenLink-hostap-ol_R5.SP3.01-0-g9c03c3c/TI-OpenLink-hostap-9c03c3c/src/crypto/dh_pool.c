@@ -0,0 +1,274 @@
+/*
+ * Pool of pre-generated Diffie-Hellman key pairs
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Generating a DH key pair is a full size modular exponentiation (1536 bits
+ * for WPS) on the critical path of WPS M1/M2 and EAP-IKEv2. This pool keeps
+ * key pairs ready for each DH group that has been used and refills them one
+ * key pair at a time from an eloop timeout, so that the main loop is not
+ * blocked for long while the pool is being filled.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "utils/eloop.h"
+#include "utils/list.h"
+#include "dh_groups.h"
+#include "dh_pool.h"
+
+
+/* Delay between generating two key pairs while refilling */
+#define DH_POOL_REFILL_USEC 10000
+
+struct dh_pool_key {
+	struct wpabuf *priv;
+	struct wpabuf *pub;
+	unsigned int used;
+};
+
+struct dh_pool_group {
+	struct dl_list list;
+	const struct dh_group *dh;
+	struct dh_pool_key *keys; /* dh_pool_size entries; num_keys valid */
+	unsigned int num_keys;
+	unsigned int hits;
+	unsigned int misses;
+};
+
+static struct dl_list dh_pool_groups = { &dh_pool_groups, &dh_pool_groups };
+static unsigned int dh_pool_refcount;
+static unsigned int dh_pool_size;
+static unsigned int dh_pool_reuse;
+
+
+static void dh_pool_refill(void *eloop_ctx, void *timeout_ctx);
+
+
+static void dh_pool_schedule(void)
+{
+	if (!eloop_is_timeout_registered(dh_pool_refill, NULL, NULL))
+		eloop_register_timeout(0, DH_POOL_REFILL_USEC, dh_pool_refill,
+				       NULL, NULL);
+}
+
+
+static void dh_pool_refill(void *eloop_ctx, void *timeout_ctx)
+{
+	struct dh_pool_group *g, *fill = NULL;
+	struct dh_pool_key *key;
+
+	/* Generate one key pair for the group with the fewest ready ones */
+	dl_list_for_each(g, &dh_pool_groups, struct dh_pool_group, list) {
+		if (g->num_keys < dh_pool_size &&
+		    (fill == NULL || g->num_keys < fill->num_keys))
+			fill = g;
+	}
+	if (fill == NULL)
+		return;
+
+	key = &fill->keys[fill->num_keys];
+	key->priv = NULL;
+	key->pub = dh_init(fill->dh, &key->priv);
+	if (key->pub == NULL) {
+		wpabuf_free(key->priv);
+		key->priv = NULL;
+		wpa_printf(MSG_INFO, "DH pool: Failed to generate key pair for "
+			   "group %d", fill->dh->id);
+		return;
+	}
+	key->used = 0;
+	fill->num_keys++;
+
+	dl_list_for_each(g, &dh_pool_groups, struct dh_pool_group, list) {
+		if (g->num_keys < dh_pool_size) {
+			dh_pool_schedule();
+			break;
+		}
+	}
+}
+
+
+static struct dh_pool_group * dh_pool_get_group(int group)
+{
+	struct dh_pool_group *g;
+
+	dl_list_for_each(g, &dh_pool_groups, struct dh_pool_group, list) {
+		if (g->dh->id == group)
+			return g;
+	}
+	return NULL;
+}
+
+
+/**
+ * dh_pool_init - Enable the DH key pair pool
+ * @size: Number of key pairs to keep ready for each DH group
+ * @reuse: Number of exchanges a key pair may be used for (1 = only once)
+ * Returns: 0 on success, -1 on failure
+ *
+ * The pool is reference counted; each successful call must be matched with a
+ * call to dh_pool_deinit(). The largest size and the smallest reuse value
+ * requested by the users is used.
+ */
+int dh_pool_init(unsigned int size, unsigned int reuse)
+{
+	struct dh_pool_group *g;
+	struct dh_pool_key *keys;
+
+	if (size == 0)
+		return -1;
+	if (reuse == 0)
+		reuse = 1;
+
+	if (size > dh_pool_size) {
+		dl_list_for_each(g, &dh_pool_groups, struct dh_pool_group,
+				 list) {
+			keys = os_realloc(g->keys, size * sizeof(*keys));
+			if (keys == NULL)
+				return -1;
+			g->keys = keys;
+		}
+		dh_pool_size = size;
+	}
+	if (dh_pool_refcount == 0 || reuse < dh_pool_reuse)
+		dh_pool_reuse = reuse;
+	dh_pool_refcount++;
+
+	if (!dl_list_empty(&dh_pool_groups))
+		dh_pool_schedule();
+
+	return 0;
+}
+
+
+/**
+ * dh_pool_deinit - Release the DH key pair pool
+ *
+ * The pre-generated key pairs are freed when the last user of the pool has
+ * called this function.
+ */
+void dh_pool_deinit(void)
+{
+	struct dh_pool_group *g, *prev;
+	unsigned int i;
+
+	if (dh_pool_refcount == 0 || --dh_pool_refcount > 0)
+		return;
+
+	eloop_cancel_timeout(dh_pool_refill, NULL, NULL);
+	dl_list_for_each_safe(g, prev, &dh_pool_groups, struct dh_pool_group,
+			      list) {
+		wpa_printf(MSG_DEBUG, "DH pool: group %d: %u hits %u misses",
+			   g->dh->id, g->hits, g->misses);
+		for (i = 0; i < g->num_keys; i++) {
+			wpabuf_free(g->keys[i].priv);
+			wpabuf_free(g->keys[i].pub);
+		}
+		dl_list_del(&g->list);
+		os_free(g->keys);
+		os_free(g);
+	}
+	dh_pool_size = 0;
+	dh_pool_reuse = 0;
+}
+
+
+/**
+ * dh_pool_add_group - Start keeping key pairs ready for a DH group
+ * @group: DH group id
+ * Returns: 0 on success, -1 on failure
+ *
+ * Groups are also added automatically on the first dh_pool_get() call for
+ * them; this function can be used to fill the pool before that.
+ */
+int dh_pool_add_group(int group)
+{
+	struct dh_pool_group *g;
+	const struct dh_group *dh;
+
+	if (dh_pool_refcount == 0)
+		return -1;
+	if (dh_pool_get_group(group))
+		return 0;
+
+	dh = dh_groups_get(group);
+	if (dh == NULL)
+		return -1;
+
+	g = os_zalloc(sizeof(*g));
+	if (g == NULL)
+		return -1;
+	g->keys = os_zalloc(dh_pool_size * sizeof(struct dh_pool_key));
+	if (g->keys == NULL) {
+		os_free(g);
+		return -1;
+	}
+	g->dh = dh;
+	dl_list_add_tail(&dh_pool_groups, &g->list);
+	wpa_printf(MSG_DEBUG, "DH pool: Keeping %u key pair(s) ready for "
+		   "group %d", dh_pool_size, group);
+	dh_pool_schedule();
+
+	return 0;
+}
+
+
+/**
+ * dh_pool_get - Get a pre-generated Diffie-Hellman key pair
+ * @group: DH group id
+ * @priv: Pointer for returning Diffie-Hellman private key
+ * Returns: Diffie-Hellman public value or %NULL if no key pair is ready
+ *
+ * The return values match those of dh_init(). If this returns %NULL, the
+ * caller is expected to generate a new key pair with dh_init().
+ */
+struct wpabuf * dh_pool_get(int group, struct wpabuf **priv)
+{
+	struct dh_pool_group *g;
+	struct dh_pool_key *key;
+	struct wpabuf *pub;
+
+	if (dh_pool_refcount == 0)
+		return NULL;
+
+	g = dh_pool_get_group(group);
+	if (g == NULL) {
+		dh_pool_add_group(group);
+		return NULL;
+	}
+	if (g->num_keys == 0) {
+		g->misses++;
+		dh_pool_schedule();
+		return NULL;
+	}
+
+	key = &g->keys[g->num_keys - 1];
+	wpabuf_free(*priv);
+	*priv = wpabuf_dup(key->priv);
+	pub = wpabuf_dup(key->pub);
+	if (*priv == NULL || pub == NULL) {
+		wpabuf_free(*priv);
+		*priv = NULL;
+		wpabuf_free(pub);
+		return NULL;
+	}
+
+	g->hits++;
+	/* Reusing a key pair gives up forward secrecy between the exchanges
+	 * sharing it; this is only done if explicitly configured */
+	key->used++;
+	if (key->used >= dh_pool_reuse) {
+		wpabuf_free(key->priv);
+		wpabuf_free(key->pub);
+		g->num_keys--;
+		dh_pool_schedule();
+	}
+	wpa_printf(MSG_DEBUG, "DH pool: Using pre-generated key pair for group "
+		   "%d (%u ready)", group, g->num_keys);
+
+	return pub;
+}
@@ -0,0 +1,28 @@
+/*
+ * Pool of pre-generated Diffie-Hellman key pairs
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef DH_POOL_H
+#define DH_POOL_H
+
+#ifdef CONFIG_DH_POOL
+
+int dh_pool_init(unsigned int size, unsigned int reuse);
+void dh_pool_deinit(void);
+int dh_pool_add_group(int group);
+struct wpabuf * dh_pool_get(int group, struct wpabuf **priv);
+
+#else /* CONFIG_DH_POOL */
+
+static inline struct wpabuf * dh_pool_get(int group, struct wpabuf **priv)
+{
+	return NULL;
+}
+
+#endif /* CONFIG_DH_POOL */
+
+#endif /* DH_POOL_H */
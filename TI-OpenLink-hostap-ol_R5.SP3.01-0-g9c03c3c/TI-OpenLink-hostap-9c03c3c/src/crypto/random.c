@@ -26,6 +26,9 @@
 #ifdef __linux__
 #include <fcntl.h>
 #endif /* __linux__ */
+#ifdef CONFIG_TLS_THREADS
+#include <pthread.h>
+#endif /* CONFIG_TLS_THREADS */
 
 #include "utils/common.h"
 #include "utils/eloop.h"
@@ -59,6 +62,19 @@ static int random_entropy_file_read = 0;
 static unsigned int entropy = 0;
 static unsigned int total_collected = 0;
 
+#ifdef CONFIG_TLS_THREADS
+/*
+ * TLS handshake worker threads use random_get_bytes(), so the pool state needs
+ * to be protected against concurrent use with the main thread.
+ */
+static pthread_mutex_t random_lock = PTHREAD_MUTEX_INITIALIZER;
+#define RANDOM_LOCK() pthread_mutex_lock(&random_lock)
+#define RANDOM_UNLOCK() pthread_mutex_unlock(&random_lock)
+#else /* CONFIG_TLS_THREADS */
+#define RANDOM_LOCK() do { } while (0)
+#define RANDOM_UNLOCK() do { } while (0)
+#endif /* CONFIG_TLS_THREADS */
+
 
 static void random_write_entropy(void);
 
@@ -127,12 +143,14 @@ void random_add_randomness(const void *buf, size_t len)
 	struct os_time t;
 	static unsigned int count = 0;
 
+	RANDOM_LOCK();
 	count++;
 	if (entropy > MIN_COLLECT_ENTROPY && (count & 0x3ff) != 0) {
 		/*
 		 * No need to add more entropy at this point, so save CPU and
 		 * skip the update.
 		 */
+		RANDOM_UNLOCK();
 		return;
 	}
 	wpa_printf(MSG_EXCESSIVE, "Add randomness: count=%u entropy=%u",
@@ -147,6 +165,7 @@ void random_add_randomness(const void *buf, size_t len)
 			(const u8 *) pool, sizeof(pool));
 	entropy++;
 	total_collected++;
+	RANDOM_UNLOCK();
 }
 
 
@@ -156,6 +175,7 @@ int random_get_bytes(void *buf, size_t len)
 	u8 *bytes = buf;
 	size_t left;
 
+	RANDOM_LOCK();
 	wpa_printf(MSG_MSGDUMP, "Get randomness: len=%u entropy=%u",
 		   (unsigned int) len, entropy);
 
@@ -183,6 +203,7 @@ int random_get_bytes(void *buf, size_t len)
 		entropy = 0;
 	else
 		entropy -= len;
+	RANDOM_UNLOCK();
 
 	return ret;
 }
@@ -219,6 +240,7 @@ int random_pool_ready(void)
 		return -1;
 	}
 
+	RANDOM_LOCK();
 	res = read(fd, dummy_key + dummy_key_avail,
 		   sizeof(dummy_key) - dummy_key_avail);
 	if (res < 0) {
@@ -230,6 +252,7 @@ int random_pool_ready(void)
 		   "/dev/random", (unsigned) res,
 		   (unsigned) (sizeof(dummy_key) - dummy_key_avail));
 	dummy_key_avail += res;
+	RANDOM_UNLOCK();
 	close(fd);
 
 	if (dummy_key_avail == sizeof(dummy_key)) {
@@ -290,9 +313,11 @@ static void random_read_fd(int sock, void *eloop_ctx, void *sock_ctx)
 		return;
 	}
 
+	RANDOM_LOCK();
 	res = read(sock, dummy_key + dummy_key_avail,
 		   sizeof(dummy_key) - dummy_key_avail);
 	if (res < 0) {
+		RANDOM_UNLOCK();
 		wpa_printf(MSG_ERROR, "random: Cannot read from /dev/random: "
 			   "%s", strerror(errno));
 		return;
@@ -302,6 +327,7 @@ static void random_read_fd(int sock, void *eloop_ctx, void *sock_ctx)
 		   (unsigned) res,
 		   (unsigned) (sizeof(dummy_key) - dummy_key_avail));
 	dummy_key_avail += res;
+	RANDOM_UNLOCK();
 
 	if (dummy_key_avail == sizeof(dummy_key)) {
 		random_close_fd();
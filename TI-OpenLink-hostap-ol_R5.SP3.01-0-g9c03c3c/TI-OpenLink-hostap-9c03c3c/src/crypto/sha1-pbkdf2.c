@@ -9,23 +9,215 @@
 #include "includes.h"
 
 #include "common.h"
+#include "crypto.h"
 #include "sha1.h"
 
-static int pbkdf2_sha1_f(const char *passphrase, const char *ssid,
-			 size_t ssid_len, int iterations, unsigned int count,
-			 u8 *digest)
+/*
+ * Each PBKDF2 iteration is HMAC-SHA1 over the previous 20-octet result. With
+ * the inner and outer HMAC states precomputed from the key, an iteration is
+ * exactly two SHA1 block operations on a fixed message layout. The iterations
+ * are run here with a SHA1 block function that works on multiple independent
+ * chains at once (one chain per vector lane) when the compiler supports
+ * vector types. The same code is used with 32-bit words for a single chain.
+ */
+
+#if defined(__GNUC__) && \
+	(defined(__SSE2__) || defined(__ARM_NEON) || defined(__ARM_NEON__))
+/* Run up to eight PBKDF2 chains in parallel */
+#define PBKDF2_SHA1_LANES 8
+typedef u32 pbkdf2_sha1_vec __attribute__ ((vector_size(4 * PBKDF2_SHA1_LANES)));
+#define PBKDF2_SHA1_INLINE inline __attribute__ ((always_inline))
+#if defined(__x86_64__) && defined(__GLIBC__) && __GNUC__ >= 6
+/* Use AVX2 (one 256-bit register per word) if the CPU supports it; SSE2
+ * (two 128-bit registers per word) otherwise. target_clones needs ifunc
+ * support, which is available with glibc, but not, e.g., with musl. */
+#define PBKDF2_SHA1_TARGETS __attribute__ ((target_clones("avx2", "default")))
+#else
+#define PBKDF2_SHA1_TARGETS
+#endif
+#else
+#define PBKDF2_SHA1_INLINE
+#endif
+
+
+/* State of one PBKDF2 chain (F() for one output block) */
+struct pbkdf2_sha1_chain {
+	u32 istate[5]; /* SHA1 state after the HMAC inner key block */
+	u32 ostate[5]; /* SHA1 state after the HMAC outer key block */
+	u32 u[5]; /* U_i */
+	u32 acc[5]; /* U_1 xor U_2 xor ... U_i */
+};
+
+
+#define PBKDF2_SHA1_ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+/* SHA1 block function for type T (u32 or a vector of u32); modifies w */
+#define PBKDF2_SHA1_COMPRESS(name, T)					\
+static PBKDF2_SHA1_INLINE void name(T *st, T *w)			\
+{									\
+	T a = st[0], b = st[1], c = st[2], d = st[3], e = st[4], t;	\
+	int i;								\
+									\
+	for (i = 0; i < 80; i++) {					\
+		if (i >= 16) {						\
+			t = w[(i + 13) & 15] ^ w[(i + 8) & 15] ^	\
+				w[(i + 2) & 15] ^ w[i & 15];		\
+			w[i & 15] = PBKDF2_SHA1_ROL(t, 1);		\
+		}							\
+		if (i < 20)						\
+			t = ((b & c) | (~b & d)) + 0x5a827999;		\
+		else if (i < 40)					\
+			t = (b ^ c ^ d) + 0x6ed9eba1;			\
+		else if (i < 60)					\
+			t = ((b & c) | (b & d) | (c & d)) + 0x8f1bbcdc;	\
+		else							\
+			t = (b ^ c ^ d) + 0xca62c1d6;			\
+		t += PBKDF2_SHA1_ROL(a, 5) + e + w[i & 15];		\
+		e = d;							\
+		d = c;							\
+		c = PBKDF2_SHA1_ROL(b, 30);				\
+		b = a;							\
+		a = t;							\
+	}								\
+									\
+	st[0] += a;							\
+	st[1] += b;							\
+	st[2] += c;							\
+	st[3] += d;							\
+	st[4] += e;							\
+}
+
+/*
+ * Run iterations 2..iterations for the chains in the lanes of T. The message
+ * for both HMAC block operations is a 20-octet digest followed by SHA1
+ * padding for a total length of 64 + 20 octets.
+ */
+#define PBKDF2_SHA1_ITERATE(name, compress, T)				\
+static PBKDF2_SHA1_INLINE void name(const T *istate, const T *ostate,	\
+				    T *u, T *acc, int iterations)	\
+{									\
+	T w[16], s[5];							\
+	int i, j;							\
+									\
+	for (i = 1; i < iterations; i++) {				\
+		for (j = 0; j < 5; j++) {				\
+			w[j] = u[j];					\
+			s[j] = istate[j];				\
+		}							\
+		w[5] = (T) { 0 } + 0x80000000;				\
+		for (j = 6; j < 15; j++)				\
+			w[j] = (T) { 0 };				\
+		w[15] = (T) { 0 } + (64 + SHA1_MAC_LEN) * 8;		\
+		compress(s, w);						\
+									\
+		for (j = 0; j < 5; j++) {				\
+			w[j] = s[j];					\
+			s[j] = ostate[j];				\
+		}							\
+		w[5] = (T) { 0 } + 0x80000000;				\
+		for (j = 6; j < 15; j++)				\
+			w[j] = (T) { 0 };				\
+		w[15] = (T) { 0 } + (64 + SHA1_MAC_LEN) * 8;		\
+		compress(s, w);						\
+									\
+		for (j = 0; j < 5; j++) {				\
+			u[j] = s[j];					\
+			acc[j] ^= s[j];					\
+		}							\
+	}								\
+}
+
+PBKDF2_SHA1_COMPRESS(pbkdf2_sha1_compress, u32)
+PBKDF2_SHA1_ITERATE(pbkdf2_sha1_iterate, pbkdf2_sha1_compress, u32)
+
+#ifdef PBKDF2_SHA1_LANES
+PBKDF2_SHA1_COMPRESS(pbkdf2_sha1_compress_mb, pbkdf2_sha1_vec)
+PBKDF2_SHA1_ITERATE(pbkdf2_sha1_iterate_mb, pbkdf2_sha1_compress_mb,
+		    pbkdf2_sha1_vec)
+
+
+/* Run up to PBKDF2_SHA1_LANES chains; unused lanes repeat the first chain */
+static PBKDF2_SHA1_TARGETS void
+pbkdf2_sha1_run_mb(struct pbkdf2_sha1_chain *c, size_t num, int iterations)
+{
+	pbkdf2_sha1_vec istate[5], ostate[5], u[5], acc[5];
+	size_t i, l;
+	int j;
+
+	for (l = 0; l < PBKDF2_SHA1_LANES; l++) {
+		i = l < num ? l : 0;
+		for (j = 0; j < 5; j++) {
+			istate[j][l] = c[i].istate[j];
+			ostate[j][l] = c[i].ostate[j];
+			u[j][l] = c[i].u[j];
+			acc[j][l] = c[i].acc[j];
+		}
+	}
+
+	pbkdf2_sha1_iterate_mb(istate, ostate, u, acc, iterations);
+
+	for (l = 0; l < num; l++) {
+		for (j = 0; j < 5; j++)
+			c[l].acc[j] = acc[j][l];
+	}
+}
+#endif /* PBKDF2_SHA1_LANES */
+
+
+static void pbkdf2_sha1_run(struct pbkdf2_sha1_chain *c, size_t num,
+			    int iterations)
+{
+	size_t n;
+
+#ifdef PBKDF2_SHA1_LANES
+	while (num > 1) {
+		n = num > PBKDF2_SHA1_LANES ? PBKDF2_SHA1_LANES : num;
+		pbkdf2_sha1_run_mb(c, n, iterations);
+		c += n;
+		num -= n;
+	}
+#endif /* PBKDF2_SHA1_LANES */
+
+	for (n = 0; n < num; n++)
+		pbkdf2_sha1_iterate(c[n].istate, c[n].ostate, c[n].u, c[n].acc,
+				    iterations);
+}
+
+
+static void pbkdf2_sha1_key_state(const u8 *key, size_t key_len, u8 pad,
+				  u32 *state)
+{
+	u32 w[16];
+	u8 k[64];
+	int i;
+
+	os_memset(k, 0, sizeof(k));
+	os_memcpy(k, key, key_len);
+	for (i = 0; i < 16; i++)
+		w[i] = WPA_GET_BE32(&k[4 * i]) ^ (0x01010101U * pad);
+
+	state[0] = 0x67452301;
+	state[1] = 0xEFCDAB89;
+	state[2] = 0x98BADCFE;
+	state[3] = 0x10325476;
+	state[4] = 0xC3D2E1F0;
+	pbkdf2_sha1_compress(state, w);
+
+	os_memset(k, 0, sizeof(k));
+	os_memset(w, 0, sizeof(w));
+}
+
+
+static int pbkdf2_sha1_init(struct pbkdf2_sha1_chain *c,
+			    const char *passphrase, const char *ssid,
+			    size_t ssid_len, unsigned int count)
 {
-	unsigned char tmp[SHA1_MAC_LEN], tmp2[SHA1_MAC_LEN];
-	int i, j;
-	unsigned char count_buf[4];
+	const u8 *key = (const u8 *) passphrase;
+	size_t key_len = os_strlen(passphrase);
+	u8 tk[SHA1_MAC_LEN], tmp[SHA1_MAC_LEN], count_buf[4];
 	const u8 *addr[2];
 	size_t len[2];
-	size_t passphrase_len = os_strlen(passphrase);
-
-	addr[0] = (u8 *) ssid;
-	len[0] = ssid_len;
-	addr[1] = count_buf;
-	len[1] = 4;
+	int j;
 
 	/* F(P, S, c, i) = U1 xor U2 xor ... Uc
 	 * U1 = PRF(P, S || i)
@@ -33,28 +225,97 @@ static int pbkdf2_sha1_f(const char *passphrase, const char *ssid,
 	 * Uc = PRF(P, Uc-1)
 	 */
 
-	count_buf[0] = (count >> 24) & 0xff;
-	count_buf[1] = (count >> 16) & 0xff;
-	count_buf[2] = (count >> 8) & 0xff;
-	count_buf[3] = count & 0xff;
-	if (hmac_sha1_vector((u8 *) passphrase, passphrase_len, 2, addr, len,
-			     tmp))
+	addr[0] = (u8 *) ssid;
+	len[0] = ssid_len;
+	addr[1] = count_buf;
+	len[1] = 4;
+	WPA_PUT_BE32(count_buf, count);
+	if (hmac_sha1_vector(key, key_len, 2, addr, len, tmp))
 		return -1;
-	os_memcpy(digest, tmp, SHA1_MAC_LEN);
 
-	for (i = 1; i < iterations; i++) {
-		if (hmac_sha1((u8 *) passphrase, passphrase_len, tmp,
-			      SHA1_MAC_LEN, tmp2))
+	/* HMAC uses the hash of the key if it is longer than the block */
+	if (key_len > 64) {
+		if (sha1_vector(1, &key, &key_len, tk))
 			return -1;
-		os_memcpy(tmp, tmp2, SHA1_MAC_LEN);
-		for (j = 0; j < SHA1_MAC_LEN; j++)
-			digest[j] ^= tmp2[j];
+		key = tk;
+		key_len = SHA1_MAC_LEN;
 	}
+	pbkdf2_sha1_key_state(key, key_len, 0x36, c->istate);
+	pbkdf2_sha1_key_state(key, key_len, 0x5c, c->ostate);
+
+	for (j = 0; j < 5; j++)
+		c->u[j] = c->acc[j] = WPA_GET_BE32(&tmp[4 * j]);
 
+	os_memset(tk, 0, sizeof(tk));
+	os_memset(tmp, 0, sizeof(tmp));
 	return 0;
 }
 
 
+/**
+ * pbkdf2_sha1_batch - PBKDF2 for multiple passphrases with the same salt
+ * @passphrase: Array of num ASCII passphrases
+ * @ssid: SSID
+ * @ssid_len: SSID length in bytes
+ * @iterations: Number of iterations to run
+ * @buf: Array of num buffers for the generated keys
+ * @buflen: Length of each buffer in bytes
+ * @num: Number of passphrases
+ * Returns: 0 on success, -1 of failure
+ *
+ * This is equivalent to calling pbkdf2_sha1() for each passphrase, but the
+ * independent PBKDF2 chains (one for each 20 octets of output for each
+ * passphrase) are processed in parallel when vector instructions are
+ * available.
+ */
+int pbkdf2_sha1_batch(const char *passphrase[], const char *ssid,
+		      size_t ssid_len, int iterations, u8 *buf[],
+		      size_t buflen, size_t num)
+{
+	struct pbkdf2_sha1_chain *c;
+	size_t blocks, i, b, n, plen;
+	u8 digest[SHA1_MAC_LEN];
+	int j, ret = 0;
+
+	if (num == 0 || buflen == 0)
+		return 0;
+
+	blocks = (buflen + SHA1_MAC_LEN - 1) / SHA1_MAC_LEN;
+	c = os_malloc(num * blocks * sizeof(*c));
+	if (c == NULL)
+		return -1;
+
+	for (i = 0, n = 0; i < num; i++) {
+		for (b = 0; b < blocks; b++, n++) {
+			if (pbkdf2_sha1_init(&c[n], passphrase[i], ssid,
+					     ssid_len, b + 1)) {
+				ret = -1;
+				goto out;
+			}
+		}
+	}
+
+	pbkdf2_sha1_run(c, n, iterations);
+
+	for (i = 0, n = 0; i < num; i++) {
+		for (b = 0; b < blocks; b++, n++) {
+			for (j = 0; j < 5; j++)
+				WPA_PUT_BE32(&digest[4 * j], c[n].acc[j]);
+			plen = buflen - b * SHA1_MAC_LEN;
+			if (plen > SHA1_MAC_LEN)
+				plen = SHA1_MAC_LEN;
+			os_memcpy(buf[i] + b * SHA1_MAC_LEN, digest, plen);
+		}
+	}
+	os_memset(digest, 0, sizeof(digest));
+
+out:
+	os_memset(c, 0, num * blocks * sizeof(*c));
+	os_free(c);
+	return ret;
+}
+
+
 /**
  * pbkdf2_sha1 - SHA1-based key derivation function (PBKDF2) for IEEE 802.11i
  * @passphrase: ASCII passphrase
@@ -72,21 +333,6 @@ static int pbkdf2_sha1_f(const char *passphrase, const char *ssid,
 int pbkdf2_sha1(const char *passphrase, const char *ssid, size_t ssid_len,
 		int iterations, u8 *buf, size_t buflen)
 {
-	unsigned int count = 0;
-	unsigned char *pos = buf;
-	size_t left = buflen, plen;
-	unsigned char digest[SHA1_MAC_LEN];
-
-	while (left > 0) {
-		count++;
-		if (pbkdf2_sha1_f(passphrase, ssid, ssid_len, iterations,
-				  count, digest))
-			return -1;
-		plen = left > SHA1_MAC_LEN ? SHA1_MAC_LEN : left;
-		os_memcpy(pos, digest, plen);
-		pos += plen;
-		left -= plen;
-	}
-
-	return 0;
+	return pbkdf2_sha1_batch(&passphrase, ssid, ssid_len, iterations,
+				 &buf, buflen, 1);
 }
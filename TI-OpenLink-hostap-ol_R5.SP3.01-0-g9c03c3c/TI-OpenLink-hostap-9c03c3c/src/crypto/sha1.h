@@ -24,4 +24,7 @@ int __must_check tls_prf_sha1_md5(const u8 *secret, size_t secret_len,
 				  size_t seed_len, u8 *out, size_t outlen);
 int pbkdf2_sha1(const char *passphrase, const char *ssid, size_t ssid_len,
 		int iterations, u8 *buf, size_t buflen);
+int pbkdf2_sha1_batch(const char *passphrase[], const char *ssid,
+		      size_t ssid_len, int iterations, u8 *buf[],
+		      size_t buflen, size_t num);
 #endif /* SHA1_H */
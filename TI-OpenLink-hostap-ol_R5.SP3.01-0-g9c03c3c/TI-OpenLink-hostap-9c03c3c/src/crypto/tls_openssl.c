@@ -51,6 +51,60 @@
 
 static int tls_openssl_ref_count = 0;
 
+#if defined(CONFIG_TLS_THREADS) && OPENSSL_VERSION_NUMBER < 0x10100000L
+#include <pthread.h>
+#define TLS_OPENSSL_LOCKS
+
+/* OpenSSL versions before 1.1.0 need locking callbacks to be thread safe */
+static pthread_mutex_t *tls_openssl_locks = NULL;
+
+
+static void tls_openssl_locking_cb(int mode, int n, const char *file,
+				   int line)
+{
+	if (mode & CRYPTO_LOCK)
+		pthread_mutex_lock(&tls_openssl_locks[n]);
+	else
+		pthread_mutex_unlock(&tls_openssl_locks[n]);
+}
+
+
+static unsigned long tls_openssl_thread_id_cb(void)
+{
+	return (unsigned long) pthread_self();
+}
+
+
+static int tls_openssl_locks_init(void)
+{
+	int i, num = CRYPTO_num_locks();
+
+	tls_openssl_locks = os_zalloc(num * sizeof(pthread_mutex_t));
+	if (tls_openssl_locks == NULL)
+		return -1;
+	for (i = 0; i < num; i++)
+		pthread_mutex_init(&tls_openssl_locks[i], NULL);
+	CRYPTO_set_id_callback(tls_openssl_thread_id_cb);
+	CRYPTO_set_locking_callback(tls_openssl_locking_cb);
+	return 0;
+}
+
+
+static void tls_openssl_locks_deinit(void)
+{
+	int i, num = CRYPTO_num_locks();
+
+	if (tls_openssl_locks == NULL)
+		return;
+	CRYPTO_set_locking_callback(NULL);
+	CRYPTO_set_id_callback(NULL);
+	for (i = 0; i < num; i++)
+		pthread_mutex_destroy(&tls_openssl_locks[i]);
+	os_free(tls_openssl_locks);
+	tls_openssl_locks = NULL;
+}
+#endif /* CONFIG_TLS_THREADS && OPENSSL_VERSION_NUMBER < 0x10100000L */
+
 struct tls_global {
 	void (*event_cb)(void *ctx, enum tls_event ev,
 			 union tls_event_data *data);
@@ -723,6 +777,13 @@ void * tls_init(const struct tls_config *conf)
 		}
 #endif /* OPENSSL_FIPS */
 #endif /* CONFIG_FIPS */
+#ifdef TLS_OPENSSL_LOCKS
+		if (tls_openssl_locks_init() < 0) {
+			os_free(tls_global);
+			tls_global = NULL;
+			return NULL;
+		}
+#endif /* TLS_OPENSSL_LOCKS */
 		SSL_load_error_strings();
 		SSL_library_init();
 #if (OPENSSL_VERSION_NUMBER >= 0x0090800fL) && !defined(OPENSSL_NO_SHA256)
@@ -788,6 +849,9 @@ void tls_deinit(void *ssl_ctx)
 		ERR_remove_state(0);
 		ERR_free_strings();
 		EVP_cleanup();
+#ifdef TLS_OPENSSL_LOCKS
+		tls_openssl_locks_deinit();
+#endif /* TLS_OPENSSL_LOCKS */
 		os_free(tls_global);
 		tls_global = NULL;
 	}
@@ -1426,6 +1426,25 @@ struct wpa_driver_ops {
 	 */
 	 struct wpa_scan_results * (*get_scan_results2)(void *priv);
 
+	/**
+	 * get_scan_results_cb - Stream the latest scan results
+	 * @priv: private driver interface data
+	 * @cb: Callback function to call for each BSS
+	 * @ctx: Context pointer for the callback
+	 * Returns: Number of BSSes reported on success, -1 on failure
+	 *
+	 * This optional function reports the scan results one BSS at a time
+	 * as they are received from the driver instead of building the full
+	 * struct wpa_scan_results array. The entry passed to the callback is
+	 * only valid during the call. Entries with the same BSSID,SSID pair
+	 * may be reported more than once (e.g., if seen on multiple channels)
+	 * and the caller is responsible for filtering these.
+	 */
+	int (*get_scan_results_cb)(void *priv,
+				   void (*cb)(void *ctx,
+					      struct wpa_scan_res *res),
+				   void *ctx);
+
 	/**
 	 * set_country - Set country
 	 * @priv: Private driver interface data
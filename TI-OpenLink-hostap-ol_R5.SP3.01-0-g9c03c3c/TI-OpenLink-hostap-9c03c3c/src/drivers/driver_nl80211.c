@@ -31,6 +31,9 @@
 #include "common/ieee802_11_defs.h"
 #include "common/ieee802_11_common.h"
 #include "l2_packet/l2_packet.h"
+#ifdef CONFIG_PACKET_MMAP
+#include "l2_packet/packet_ring.h"
+#endif /* CONFIG_PACKET_MMAP */
 #include "netlink.h"
 #include "linux_ioctl.h"
 #include "radiotap.h"
@@ -245,6 +248,9 @@ struct wpa_driver_nl80211_data {
 	int monitor_sock;
 	int monitor_ifidx;
 	int monitor_refcount;
+#ifdef CONFIG_PACKET_MMAP
+	struct packet_ring *monitor_ring;
+#endif /* CONFIG_PACKET_MMAP */
 
 	unsigned int disabled_11b_rates:1;
 	unsigned int pending_remain_on_chan:1;
@@ -379,11 +385,29 @@ static int is_p2p_interface(enum nl80211_iftype nlmode)
 }
 
 
+#define NL80211_SURVEY_MAX_FREQS 64
+
+struct nl80211_survey_noise {
+	unsigned int num;
+	int freq[NL80211_SURVEY_MAX_FREQS];
+	s8 noise[NL80211_SURVEY_MAX_FREQS];
+};
+
 struct nl80211_bss_info_arg {
 	struct wpa_driver_nl80211_data *drv;
 	struct wpa_scan_results *res;
+	size_t res_alloc;
 	unsigned int assoc_freq;
 	u8 assoc_bssid[ETH_ALEN];
+
+	/* Streaming mode: report each BSS through cb instead of res */
+	void (*cb)(void *ctx, struct wpa_scan_res *res);
+	void *cb_ctx;
+	const struct nl80211_survey_noise *noise;
+	u8 *buf;
+	size_t buf_len;
+	int count;
+	u8 auth_bssid[ETH_ALEN];
 };
 
 static int bss_info_handler(struct nl_msg *msg, void *arg);
@@ -1806,9 +1830,7 @@ static int get_noise_for_scan_results(struct nl_msg *msg, void *arg)
 		[NL80211_SURVEY_INFO_FREQUENCY] = { .type = NLA_U32 },
 		[NL80211_SURVEY_INFO_NOISE] = { .type = NLA_U8 },
 	};
-	struct wpa_scan_results *scan_results = arg;
-	struct wpa_scan_res *scan_res;
-	size_t i;
+	struct nl80211_survey_noise *survey = arg;
 
 	nla_parse(tb, NL80211_ATTR_MAX, genlmsg_attrdata(gnlh, 0),
 		  genlmsg_attrlen(gnlh, 0), NULL);
@@ -1832,30 +1854,44 @@ static int get_noise_for_scan_results(struct nl_msg *msg, void *arg)
 	if (!sinfo[NL80211_SURVEY_INFO_FREQUENCY])
 		return NL_SKIP;
 
-	for (i = 0; i < scan_results->num; ++i) {
-		scan_res = scan_results->res[i];
-		if (!scan_res)
-			continue;
-		if ((int) nla_get_u32(sinfo[NL80211_SURVEY_INFO_FREQUENCY]) !=
-		    scan_res->freq)
-			continue;
-		if (!(scan_res->flags & WPA_SCAN_NOISE_INVALID))
-			continue;
-		scan_res->noise = (s8)
-			nla_get_u8(sinfo[NL80211_SURVEY_INFO_NOISE]);
-		scan_res->flags &= ~WPA_SCAN_NOISE_INVALID;
-	}
+	if (survey->num == NL80211_SURVEY_MAX_FREQS)
+		return NL_SKIP;
+
+	survey->freq[survey->num] =
+		nla_get_u32(sinfo[NL80211_SURVEY_INFO_FREQUENCY]);
+	survey->noise[survey->num] =
+		(s8) nla_get_u8(sinfo[NL80211_SURVEY_INFO_NOISE]);
+	survey->num++;
 
 	return NL_SKIP;
 }
 
 
-static int nl80211_get_noise_for_scan_results(
-	struct wpa_driver_nl80211_data *drv,
-	struct wpa_scan_results *scan_res)
+static void nl80211_set_scan_res_noise(
+	const struct nl80211_survey_noise *survey, struct wpa_scan_res *r)
+{
+	unsigned int i;
+
+	if (!(r->flags & WPA_SCAN_NOISE_INVALID))
+		return;
+
+	for (i = 0; i < survey->num; i++) {
+		if (survey->freq[i] == r->freq) {
+			r->noise = survey->noise[i];
+			r->flags &= ~WPA_SCAN_NOISE_INVALID;
+			return;
+		}
+	}
+}
+
+
+static int nl80211_get_survey_noise(struct wpa_driver_nl80211_data *drv,
+				    struct nl80211_survey_noise *survey)
 {
 	struct nl_msg *msg;
 
+	os_memset(survey, 0, sizeof(*survey));
+
 	msg = nlmsg_alloc();
 	if (!msg)
 		return -ENOMEM;
@@ -1865,13 +1901,34 @@ static int nl80211_get_noise_for_scan_results(
 	NLA_PUT_U32(msg, NL80211_ATTR_IFINDEX, drv->ifindex);
 
 	return send_and_recv_msgs(drv, msg, get_noise_for_scan_results,
-				  scan_res);
+				  survey);
  nla_put_failure:
 	nlmsg_free(msg);
 	return -ENOBUFS;
 }
 
 
+static int nl80211_get_noise_for_scan_results(
+	struct wpa_driver_nl80211_data *drv,
+	struct wpa_scan_results *scan_res)
+{
+	struct nl80211_survey_noise survey;
+	size_t i;
+	int ret;
+
+	ret = nl80211_get_survey_noise(drv, &survey);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < scan_res->num; i++) {
+		if (scan_res->res[i])
+			nl80211_set_scan_res_noise(&survey, scan_res->res[i]);
+	}
+
+	return 0;
+}
+
+
 static void nl80211_cqm_event(struct wpa_driver_nl80211_data *drv,
 			      struct nlattr *tb[])
 {
@@ -3929,6 +3986,7 @@ static int bss_info_handler(struct nl_msg *msg, void *arg)
 	struct wpa_scan_results *res = _arg->res;
 	struct wpa_scan_res **tmp;
 	struct wpa_scan_res *r;
+	size_t len;
 	const u8 *ie, *beacon_ie;
 	size_t ie_len, beacon_ie_len;
 	u8 *pos;
@@ -3959,7 +4017,7 @@ static int bss_info_handler(struct nl_msg *msg, void *arg)
 				   MACSTR, MAC2STR(_arg->assoc_bssid));
 		}
 	}
-	if (!res)
+	if (!res && !_arg->cb)
 		return NL_SKIP;
 	if (bss[NL80211_BSS_INFORMATION_ELEMENTS]) {
 		ie = nla_data(bss[NL80211_BSS_INFORMATION_ELEMENTS]);
@@ -3980,9 +4038,27 @@ static int bss_info_handler(struct nl_msg *msg, void *arg)
 				  ie ? ie_len : beacon_ie_len))
 		return NL_SKIP;
 
-	r = os_zalloc(sizeof(*r) + ie_len + beacon_ie_len);
-	if (r == NULL)
-		return NL_SKIP;
+	len = sizeof(*r) + ie_len + beacon_ie_len;
+	if (_arg->cb) {
+		/*
+		 * Build the entry in a buffer that is reused for all BSSes
+		 * in the dump since the callback does not keep a reference
+		 * to it.
+		 */
+		if (len > _arg->buf_len) {
+			u8 *nbuf = os_realloc(_arg->buf, len);
+			if (nbuf == NULL)
+				return NL_SKIP;
+			_arg->buf = nbuf;
+			_arg->buf_len = len;
+		}
+		r = (struct wpa_scan_res *) _arg->buf;
+		os_memset(r, 0, sizeof(*r));
+	} else {
+		r = os_zalloc(len);
+		if (r == NULL)
+			return NL_SKIP;
+	}
 	if (bss[NL80211_BSS_BSSID])
 		os_memcpy(r->bssid, nla_data(bss[NL80211_BSS_BSSID]),
 			  ETH_ALEN);
@@ -4031,6 +4107,16 @@ static int bss_info_handler(struct nl_msg *msg, void *arg)
 		}
 	}
 
+	if (_arg->cb) {
+		if (_arg->noise)
+			nl80211_set_scan_res_noise(_arg->noise, r);
+		if (r->flags & WPA_SCAN_AUTHENTICATED)
+			os_memcpy(_arg->auth_bssid, r->bssid, ETH_ALEN);
+		_arg->cb(_arg->cb_ctx, r);
+		_arg->count++;
+		return NL_SKIP;
+	}
+
 	/*
 	 * cfg80211 maintains separate BSS table entries for APs if the same
 	 * BSSID,SSID pair is seen on multiple channels. wpa_supplicant does
@@ -4063,14 +4149,17 @@ static int bss_info_handler(struct nl_msg *msg, void *arg)
 		return NL_SKIP;
 	}
 
-	tmp = os_realloc(res->res,
-			 (res->num + 1) * sizeof(struct wpa_scan_res *));
-	if (tmp == NULL) {
-		os_free(r);
-		return NL_SKIP;
+	if (res->num == _arg->res_alloc) {
+		size_t alloc = _arg->res_alloc ? _arg->res_alloc * 2 : 32;
+		tmp = os_realloc(res->res, alloc * sizeof(struct wpa_scan_res *));
+		if (tmp == NULL) {
+			os_free(r);
+			return NL_SKIP;
+		}
+		res->res = tmp;
+		_arg->res_alloc = alloc;
 	}
-	tmp[res->num++] = r;
-	res->res = tmp;
+	res->res[res->num++] = r;
 
 	return NL_SKIP;
 }
@@ -4089,57 +4178,61 @@ static void clear_state_mismatch(struct wpa_driver_nl80211_data *drv,
 }
 
 
-static void wpa_driver_nl80211_check_bss_status(
-	struct wpa_driver_nl80211_data *drv, struct wpa_scan_results *res)
+static void nl80211_check_bss_status(struct wpa_driver_nl80211_data *drv,
+				     const u8 *bssid, unsigned int flags)
 {
-	size_t i;
-
-	for (i = 0; i < res->num; i++) {
-		struct wpa_scan_res *r = res->res[i];
-		if (r->flags & WPA_SCAN_AUTHENTICATED) {
-			wpa_printf(MSG_DEBUG, "nl80211: Scan results "
-				   "indicates BSS status with " MACSTR
-				   " as authenticated",
-				   MAC2STR(r->bssid));
-			if (is_sta_interface(drv->nlmode) &&
-			    os_memcmp(r->bssid, drv->bssid, ETH_ALEN) != 0 &&
-			    os_memcmp(r->bssid, drv->auth_bssid, ETH_ALEN) !=
-			    0) {
-				wpa_printf(MSG_DEBUG, "nl80211: Unknown BSSID"
-					   " in local state (auth=" MACSTR
-					   " assoc=" MACSTR ")",
-					   MAC2STR(drv->auth_bssid),
-					   MAC2STR(drv->bssid));
-				clear_state_mismatch(drv, r->bssid);
-			}
+	if (flags & WPA_SCAN_AUTHENTICATED) {
+		wpa_printf(MSG_DEBUG, "nl80211: Scan results "
+			   "indicates BSS status with " MACSTR
+			   " as authenticated",
+			   MAC2STR(bssid));
+		if (is_sta_interface(drv->nlmode) &&
+		    os_memcmp(bssid, drv->bssid, ETH_ALEN) != 0 &&
+		    os_memcmp(bssid, drv->auth_bssid, ETH_ALEN) != 0) {
+			wpa_printf(MSG_DEBUG, "nl80211: Unknown BSSID"
+				   " in local state (auth=" MACSTR
+				   " assoc=" MACSTR ")",
+				   MAC2STR(drv->auth_bssid),
+				   MAC2STR(drv->bssid));
+			clear_state_mismatch(drv, bssid);
 		}
+	}
 
-		if (r->flags & WPA_SCAN_ASSOCIATED) {
-			wpa_printf(MSG_DEBUG, "nl80211: Scan results "
-				   "indicate BSS status with " MACSTR
-				   " as associated",
-				   MAC2STR(r->bssid));
-			if (is_sta_interface(drv->nlmode) &&
-			    !drv->associated) {
-				wpa_printf(MSG_DEBUG, "nl80211: Local state "
-					   "(not associated) does not match "
-					   "with BSS state");
-				clear_state_mismatch(drv, r->bssid);
-			} else if (is_sta_interface(drv->nlmode) &&
-				   os_memcmp(drv->bssid, r->bssid, ETH_ALEN) !=
-				   0) {
-				wpa_printf(MSG_DEBUG, "nl80211: Local state "
-					   "(associated with " MACSTR ") does "
-					   "not match with BSS state",
-					   MAC2STR(drv->bssid));
-				clear_state_mismatch(drv, r->bssid);
-				clear_state_mismatch(drv, drv->bssid);
-			}
+	if (flags & WPA_SCAN_ASSOCIATED) {
+		wpa_printf(MSG_DEBUG, "nl80211: Scan results "
+			   "indicate BSS status with " MACSTR
+			   " as associated",
+			   MAC2STR(bssid));
+		if (is_sta_interface(drv->nlmode) &&
+		    !drv->associated) {
+			wpa_printf(MSG_DEBUG, "nl80211: Local state "
+				   "(not associated) does not match "
+				   "with BSS state");
+			clear_state_mismatch(drv, bssid);
+		} else if (is_sta_interface(drv->nlmode) &&
+			   os_memcmp(drv->bssid, bssid, ETH_ALEN) != 0) {
+			wpa_printf(MSG_DEBUG, "nl80211: Local state "
+				   "(associated with " MACSTR ") does "
+				   "not match with BSS state",
+				   MAC2STR(drv->bssid));
+			clear_state_mismatch(drv, bssid);
+			clear_state_mismatch(drv, drv->bssid);
 		}
 	}
 }
 
 
+static void wpa_driver_nl80211_check_bss_status(
+	struct wpa_driver_nl80211_data *drv, struct wpa_scan_results *res)
+{
+	size_t i;
+
+	for (i = 0; i < res->num; i++)
+		nl80211_check_bss_status(drv, res->res[i]->bssid,
+					 res->res[i]->flags);
+}
+
+
 static struct wpa_scan_results *
 nl80211_get_scan_results(struct wpa_driver_nl80211_data *drv)
 {
@@ -4158,6 +4251,7 @@ nl80211_get_scan_results(struct wpa_driver_nl80211_data *drv)
 	nl80211_cmd(drv, msg, NLM_F_DUMP, NL80211_CMD_GET_SCAN);
 	NLA_PUT_U32(msg, NL80211_ATTR_IFINDEX, drv->ifindex);
 
+	os_memset(&arg, 0, sizeof(arg));
 	arg.drv = drv;
 	arg.res = res;
 	ret = send_and_recv_msgs(drv, msg, bss_info_handler, &arg);
@@ -4196,6 +4290,64 @@ wpa_driver_nl80211_get_scan_results(void *priv)
 }
 
 
+/**
+ * wpa_driver_nl80211_get_scan_results_cb - Stream the latest scan results
+ * @priv: Pointer to private nl80211 data from wpa_driver_nl80211_init()
+ * @cb: Callback function to call for each BSS
+ * @ctx: Context pointer for the callback
+ * Returns: Number of BSSes reported on success, -1 on failure
+ */
+static int wpa_driver_nl80211_get_scan_results_cb(
+	void *priv, void (*cb)(void *ctx, struct wpa_scan_res *res), void *ctx)
+{
+	struct i802_bss *bss = priv;
+	struct wpa_driver_nl80211_data *drv = bss->drv;
+	struct nl80211_survey_noise survey;
+	struct nl80211_bss_info_arg arg;
+	struct nl_msg *msg;
+	int ret;
+
+	/*
+	 * Fetch the noise information first so that it can be filled into
+	 * each entry before it is reported.
+	 */
+	nl80211_get_survey_noise(drv, &survey);
+
+	msg = nlmsg_alloc();
+	if (!msg)
+		return -1;
+
+	nl80211_cmd(drv, msg, NLM_F_DUMP, NL80211_CMD_GET_SCAN);
+	NLA_PUT_U32(msg, NL80211_ATTR_IFINDEX, drv->ifindex);
+
+	os_memset(&arg, 0, sizeof(arg));
+	arg.drv = drv;
+	arg.cb = cb;
+	arg.cb_ctx = ctx;
+	arg.noise = &survey;
+	ret = send_and_recv_msgs(drv, msg, bss_info_handler, &arg);
+	os_free(arg.buf);
+	if (ret == 0) {
+		wpa_printf(MSG_DEBUG, "nl80211: Reported scan results (%d "
+			   "BSSes)", arg.count);
+		if (!is_zero_ether_addr(arg.auth_bssid))
+			nl80211_check_bss_status(drv, arg.auth_bssid,
+						 WPA_SCAN_AUTHENTICATED);
+		if (!is_zero_ether_addr(arg.assoc_bssid))
+			nl80211_check_bss_status(drv, arg.assoc_bssid,
+						 WPA_SCAN_ASSOCIATED);
+		return arg.count;
+	}
+	wpa_printf(MSG_DEBUG, "nl80211: Scan result fetch failed: ret=%d "
+		   "(%s)", ret, strerror(-ret));
+	return -1;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return -1;
+}
+
+
 static void nl80211_dump_scan(struct wpa_driver_nl80211_data *drv)
 {
 	struct wpa_scan_results *res;
@@ -5307,6 +5459,12 @@ static int wpa_driver_nl80211_send_mntr(struct wpa_driver_nl80211_data *drv,
 		txflags |= IEEE80211_RADIOTAP_F_TX_NOACK;
 	*(le16 *) &rtap_hdr[12] = host_to_le16(txflags);
 
+#ifdef CONFIG_PACKET_MMAP
+	if (packet_ring_send(drv->monitor_ring, rtap_hdr, sizeof(rtap_hdr),
+			     data, len) == 0)
+		return 0;
+#endif /* CONFIG_PACKET_MMAP */
+
 	res = sendmsg(drv->monitor_sock, &msg, 0);
 	if (res < 0) {
 		wpa_printf(MSG_INFO, "nl80211: sendmsg: %s", strerror(errno));
@@ -5989,22 +6147,14 @@ static void handle_frame(struct wpa_driver_nl80211_data *drv,
 }
 
 
-static void handle_monitor_read(int sock, void *eloop_ctx, void *sock_ctx)
+static void handle_monitor_frame(struct wpa_driver_nl80211_data *drv,
+				 u8 *buf, int len)
 {
-	struct wpa_driver_nl80211_data *drv = eloop_ctx;
-	int len;
-	unsigned char buf[3000];
 	struct ieee80211_radiotap_iterator iter;
 	int ret;
 	int datarate = 0, ssi_signal = 0;
 	int injected = 0, failed = 0, rxflags = 0;
 
-	len = recv(sock, buf, sizeof(buf), 0);
-	if (len < 0) {
-		perror("recv");
-		return;
-	}
-
 	if (ieee80211_radiotap_iterator_init(&iter, (void*)buf, len)) {
 		printf("received invalid radiotap frame\n");
 		return;
@@ -6057,6 +6207,46 @@ static void handle_monitor_read(int sock, void *eloop_ctx, void *sock_ctx)
 }
 
 
+static void handle_monitor_read(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct wpa_driver_nl80211_data *drv = eloop_ctx;
+	int len;
+	unsigned char buf[3000];
+
+	len = recv(sock, buf, sizeof(buf), 0);
+	if (len < 0) {
+		perror("recv");
+		return;
+	}
+
+	handle_monitor_frame(drv, buf, len);
+}
+
+
+#ifdef CONFIG_PACKET_MMAP
+
+/* Frames in the monitor socket rings */
+#define MONITOR_RX_RING_FRAMES 256
+#define MONITOR_TX_RING_FRAMES 64
+
+static void handle_monitor_ring_frame(void *ctx, const u8 *buf, size_t len,
+				      const struct sockaddr_ll *ll)
+{
+	/* The frame is in a writable ring entry */
+	handle_monitor_frame(ctx, (u8 *) buf, len);
+}
+
+
+static void handle_monitor_ring(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct wpa_driver_nl80211_data *drv = eloop_ctx;
+
+	packet_ring_rx(drv->monitor_ring, handle_monitor_ring_frame, drv);
+}
+
+#endif /* CONFIG_PACKET_MMAP */
+
+
 /*
  * we post-process the filter code later and rewrite
  * this to the offset to the last instruction
@@ -6224,6 +6414,10 @@ static void nl80211_remove_monitor_interface(
 		close(drv->monitor_sock);
 		drv->monitor_sock = -1;
 	}
+#ifdef CONFIG_PACKET_MMAP
+	packet_ring_deinit(drv->monitor_ring);
+	drv->monitor_ring = NULL;
+#endif /* CONFIG_PACKET_MMAP */
 }
 
 
@@ -6305,6 +6499,22 @@ nl80211_create_monitor_interface(struct wpa_driver_nl80211_data *drv)
 		goto error;
 	}
 
+#ifdef CONFIG_PACKET_MMAP
+	drv->monitor_ring = packet_ring_init(drv->monitor_sock,
+					     MONITOR_RX_RING_FRAMES,
+					     MONITOR_TX_RING_FRAMES);
+	if (drv->monitor_ring) {
+		if (eloop_register_read_sock(drv->monitor_sock,
+					     handle_monitor_ring, drv, NULL)) {
+			printf("Could not register monitor read socket\n");
+			goto error;
+		}
+		return 0;
+	}
+	wpa_printf(MSG_DEBUG, "nl80211: Could not set up monitor socket "
+		   "rings; use recv()/sendmsg()");
+#endif /* CONFIG_PACKET_MMAP */
+
 	if (eloop_register_read_sock(drv->monitor_sock, handle_monitor_read,
 				     drv, NULL)) {
 		printf("Could not register monitor read socket\n");
@@ -9891,6 +10101,7 @@ const struct wpa_driver_ops wpa_driver_nl80211_ops = {
 	.sched_scan = wpa_driver_nl80211_sched_scan,
 	.stop_sched_scan = wpa_driver_nl80211_stop_sched_scan,
 	.get_scan_results2 = wpa_driver_nl80211_get_scan_results,
+	.get_scan_results_cb = wpa_driver_nl80211_get_scan_results_cb,
 	.deauthenticate = wpa_driver_nl80211_deauthenticate,
 	.disassociate = wpa_driver_nl80211_disassociate,
 	.authenticate = wpa_driver_nl80211_authenticate,
@@ -152,6 +152,7 @@ struct eap_sm {
 	int init_phase2;
 	void *ssl_ctx;
 	void *eap_sim_db_priv;
+	void *tls_pool;
 	Boolean backend_auth;
 	Boolean update_user;
 	int eap_server;
@@ -1233,6 +1233,7 @@ struct eap_sm * eap_server_sm_init(void *eapol_ctx,
 	sm->ssl_ctx = conf->ssl_ctx;
 	sm->msg_ctx = conf->msg_ctx;
 	sm->eap_sim_db_priv = conf->eap_sim_db_priv;
+	sm->tls_pool = conf->tls_pool;
 	sm->backend_auth = conf->backend_auth;
 	sm->eap_server = conf->eap_server;
 	if (conf->pac_opaque_encr_key) {
@@ -1447,6 +1447,9 @@ static int eap_fast_process_phase1(struct eap_sm *sm,
 		return -1;
 	}
 
+	if (eap_server_tls_phase1_pending(&data->ssl))
+		return 1;
+
 	if (!tls_connection_established(sm->ssl_ctx, data->ssl.conn) ||
 	    wpabuf_len(data->ssl.tls_out) > 0)
 		return 1;
@@ -1249,6 +1249,8 @@ static void eap_peap_process_msg(struct eap_sm *sm, void *priv,
 			eap_peap_state(data, FAILURE);
 			break;
 		}
+		if (eap_server_tls_phase1_pending(&data->ssl))
+			break;
 
 		if (data->peap_version >= 2 &&
 		    tls_connection_established(sm->ssl_ctx, data->ssl.conn)) {
@@ -13,6 +13,7 @@
 #include "crypto/tls.h"
 #include "eap_i.h"
 #include "eap_tls_common.h"
+#include "eap_tls_pool.h"
 
 
 static void eap_server_tls_free_in_buf(struct eap_ssl_data *data);
@@ -53,6 +54,12 @@ int eap_server_tls_ssl_init(struct eap_sm *sm, struct eap_ssl_data *data,
 
 void eap_server_tls_ssl_deinit(struct eap_sm *sm, struct eap_ssl_data *data)
 {
+	if (data->job && eap_tls_job_cancel(data->job)) {
+		/* Worker thread is still using the connection; it will be
+		 * freed once the handshake step has been completed */
+		data->conn = NULL;
+	}
+	data->job = NULL;
 	tls_connection_deinit(sm->ssl_ctx, data->conn);
 	eap_server_tls_free_in_buf(data);
 	wpabuf_free(data->tls_out);
@@ -244,9 +251,26 @@ int eap_server_tls_phase1(struct eap_sm *sm, struct eap_ssl_data *data)
 		WPA_ASSERT(data->tls_out == NULL);
 	}
 
-	data->tls_out = tls_connection_server_handshake(sm->ssl_ctx,
-							data->conn,
-							data->tls_in, NULL);
+	if (data->job == NULL && sm->tls_pool && !data->phase2) {
+		data->job = eap_tls_pool_handshake(sm->tls_pool, sm->ssl_ctx,
+						   data->conn, data->tls_in,
+						   sm);
+		if (data->job) {
+			/* Continue once the worker thread has completed */
+			sm->method_pending = METHOD_PENDING_WAIT;
+			return 1;
+		}
+	}
+
+	if (data->job) {
+		data->tls_out = eap_tls_job_finish(data->job);
+		data->job = NULL;
+	} else {
+		data->tls_out = tls_connection_server_handshake(sm->ssl_ctx,
+								data->conn,
+								data->tls_in,
+								NULL);
+	}
 	if (data->tls_out == NULL) {
 		wpa_printf(MSG_INFO, "SSL: TLS processing failed");
 		return -1;
@@ -262,6 +286,18 @@ int eap_server_tls_phase1(struct eap_sm *sm, struct eap_ssl_data *data)
 }
 
 
+/**
+ * eap_server_tls_phase1_pending - Whether a handshake step is in progress
+ * @data: TLS data for the EAP method
+ * Returns: 1 if eap_server_tls_phase1() queued the handshake step to a worker
+ * thread and the TLS connection cannot be used yet, 0 if not
+ */
+int eap_server_tls_phase1_pending(struct eap_ssl_data *data)
+{
+	return data->job && !eap_tls_job_done(data->job);
+}
+
+
 static int eap_server_tls_reassemble(struct eap_ssl_data *data, u8 flags,
 				     const u8 **pos, size_t *left)
 {
@@ -367,6 +403,20 @@ int eap_server_tls_process(struct eap_sm *sm, struct eap_ssl_data *data,
 	wpa_printf(MSG_DEBUG, "SSL: Received packet(len=%lu) - Flags 0x%02x",
 		   (unsigned long) wpabuf_len(respData), flags);
 
+	if (data->job) {
+		/*
+		 * Pending processing of this message: the reassembled TLS
+		 * message was already given to the worker thread.
+		 */
+		if (!eap_tls_job_done(data->job)) {
+			sm->method_pending = METHOD_PENDING_WAIT;
+			return 0;
+		}
+		if (proc_msg)
+			proc_msg(sm, priv, respData);
+		goto alerts;
+	}
+
 	if (proc_version &&
 	    proc_version(sm, priv, flags & EAP_TLS_VERSION_MASK) < 0)
 		return -1;
@@ -381,6 +431,9 @@ int eap_server_tls_process(struct eap_sm *sm, struct eap_ssl_data *data,
 	if (proc_msg)
 		proc_msg(sm, priv, respData);
 
+alerts:
+	if (eap_server_tls_phase1_pending(data))
+		goto done;
 	if (tls_connection_get_write_alerts(sm->ssl_ctx, data->conn) > 1) {
 		wpa_printf(MSG_INFO, "SSL: Locally detected fatal error in "
 			   "TLS processing");
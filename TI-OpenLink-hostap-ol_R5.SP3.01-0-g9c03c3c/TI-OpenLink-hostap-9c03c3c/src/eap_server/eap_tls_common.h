@@ -50,6 +50,13 @@ struct eap_ssl_data {
 
 	enum { MSG, FRAG_ACK, WAIT_FRAG_ACK } state;
 	struct wpabuf tmpbuf;
+
+	/**
+	 * job - Handshake step in progress in a worker thread or %NULL
+	 *
+	 * conn must not be used while the job is in progress.
+	 */
+	struct eap_tls_job *job;
 };
 
 
@@ -72,6 +79,7 @@ struct wpabuf * eap_server_tls_build_msg(struct eap_ssl_data *data,
 					 int eap_type, int version, u8 id);
 struct wpabuf * eap_server_tls_build_ack(u8 id, int eap_type, int version);
 int eap_server_tls_phase1(struct eap_sm *sm, struct eap_ssl_data *data);
+int eap_server_tls_phase1_pending(struct eap_ssl_data *data);
 struct wpabuf * eap_server_tls_encrypt(struct eap_sm *sm,
 				       struct eap_ssl_data *data,
 				       const struct wpabuf *plain);
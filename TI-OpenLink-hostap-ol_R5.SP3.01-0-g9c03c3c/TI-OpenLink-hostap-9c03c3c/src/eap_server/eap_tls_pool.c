@@ -0,0 +1,442 @@
+/*
+ * hostapd / EAP-TLS/PEAP/TTLS/FAST server handshake worker threads
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * The TLS server handshake steps include the expensive public key operations
+ * (RSA decryption/signing and Diffie-Hellman). This module runs them in a
+ * pool of worker threads so that a slow handshake does not block the event
+ * loop. Completed jobs are reported back to the event loop through a pipe
+ * and the EAP method continues through the EAP server pending processing
+ * mechanism (eap_sm_pending_cb()).
+ *
+ * Only the worker thread that runs a job accesses the TLS connection while
+ * the job is in progress. The EAP method must not use the connection until
+ * eap_tls_job_done() reports completion.
+ */
+
+#include "includes.h"
+#include <fcntl.h>
+#include <pthread.h>
+
+#include "common.h"
+#include "eloop.h"
+#include "list.h"
+#include "crypto/tls.h"
+#include "eap_tls_pool.h"
+
+
+#define EAP_TLS_POOL_MAX_THREADS 32
+
+struct eap_tls_job {
+	struct dl_list list;
+	struct eap_tls_pool *pool;
+	void *tls_ctx;
+	struct tls_connection *conn;
+	struct wpabuf *in_data;
+	struct wpabuf *out_data;
+	void *session_ctx;
+	enum { JOB_QUEUED, JOB_RUNNING, JOB_DONE } state;
+	int cancelled;
+	int completed; /* only accessed from the eloop thread */
+};
+
+struct eap_tls_pool {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct dl_list queue; /* struct eap_tls_job::list */
+	struct dl_list done; /* struct eap_tls_job::list */
+	int stop;
+
+	pthread_t *threads;
+	int num_threads;
+	int pipe_fd[2];
+
+	void (*complete_cb)(void *ctx, void *session_ctx);
+	void *ctx;
+
+	/* Statistics; updated only from the eloop thread */
+	unsigned int queued;
+	unsigned int peak_queued;
+	u32 submitted;
+	u32 completed;
+	u32 cancelled;
+};
+
+
+static void * eap_tls_pool_worker(void *arg)
+{
+	struct eap_tls_pool *pool = arg;
+	struct eap_tls_job *job;
+	struct wpabuf *out;
+	char c = 0;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while (!pool->stop && dl_list_empty(&pool->queue))
+			pthread_cond_wait(&pool->cond, &pool->lock);
+		if (pool->stop)
+			break;
+		job = dl_list_first(&pool->queue, struct eap_tls_job, list);
+		dl_list_del(&job->list);
+		job->state = JOB_RUNNING;
+		pthread_mutex_unlock(&pool->lock);
+
+		out = tls_connection_server_handshake(job->tls_ctx, job->conn,
+						      job->in_data, NULL);
+
+		pthread_mutex_lock(&pool->lock);
+		job->out_data = out;
+		job->state = JOB_DONE;
+		dl_list_add_tail(&pool->done, &job->list);
+		/* A full pipe means that a notification is already pending */
+		if (write(pool->pipe_fd[1], &c, 1) < 0 && errno != EAGAIN)
+			wpa_printf(MSG_ERROR, "EAP-TLS pool: write: %s",
+				   strerror(errno));
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+
+static void eap_tls_job_free(struct eap_tls_job *job)
+{
+	wpabuf_free(job->in_data);
+	wpabuf_free(job->out_data);
+	os_free(job);
+}
+
+
+static void eap_tls_pool_receive(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct eap_tls_pool *pool = eloop_ctx;
+	struct eap_tls_job *job;
+	struct dl_list done;
+	char buf[64];
+
+	while (read(sock, buf, sizeof(buf)) > 0)
+		;
+
+	dl_list_init(&done);
+	pthread_mutex_lock(&pool->lock);
+	while ((job = dl_list_first(&pool->done, struct eap_tls_job, list))) {
+		dl_list_del(&job->list);
+		dl_list_add_tail(&done, &job->list);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	while ((job = dl_list_first(&done, struct eap_tls_job, list))) {
+		dl_list_del(&job->list);
+		pool->queued--;
+		if (job->cancelled) {
+			/* The EAP method is gone; release the connection that
+			 * was left for the worker thread */
+			tls_connection_deinit(job->tls_ctx, job->conn);
+			eap_tls_job_free(job);
+			continue;
+		}
+		pool->completed++;
+		job->completed = 1;
+		wpa_printf(MSG_DEBUG, "EAP-TLS pool: Handshake step for "
+			   "session %p completed", job->session_ctx);
+		pool->complete_cb(pool->ctx, job->session_ctx);
+	}
+}
+
+
+static int eap_tls_pool_cpus(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n > 0)
+		return n;
+#endif /* _SC_NPROCESSORS_ONLN */
+	return 1;
+}
+
+
+/**
+ * eap_tls_pool_init - Start TLS handshake worker threads
+ * @threads: Number of worker threads or -1 to use one per online CPU
+ * @complete_cb: Callback function for reporting completed handshake steps
+ * @ctx: Context pointer for complete_cb
+ * Returns: Pointer to the pool or %NULL on failure
+ *
+ * complete_cb is called from the eloop thread with the session_ctx that was
+ * given to eap_tls_pool_handshake(). It is expected to call
+ * eap_sm_pending_cb() for the matching EAP server state machine.
+ */
+struct eap_tls_pool *
+eap_tls_pool_init(int threads,
+		  void (*complete_cb)(void *ctx, void *session_ctx),
+		  void *ctx)
+{
+	struct eap_tls_pool *pool;
+	int i;
+
+	if (threads < 0)
+		threads = eap_tls_pool_cpus();
+	if (threads < 1)
+		return NULL;
+	if (threads > EAP_TLS_POOL_MAX_THREADS)
+		threads = EAP_TLS_POOL_MAX_THREADS;
+
+	pool = os_zalloc(sizeof(*pool));
+	if (pool == NULL)
+		return NULL;
+	pool->threads = os_zalloc(threads * sizeof(pthread_t));
+	if (pool->threads == NULL) {
+		os_free(pool);
+		return NULL;
+	}
+	dl_list_init(&pool->queue);
+	dl_list_init(&pool->done);
+	pool->complete_cb = complete_cb;
+	pool->ctx = ctx;
+
+	if (pipe(pool->pipe_fd) < 0) {
+		wpa_printf(MSG_ERROR, "EAP-TLS pool: pipe: %s",
+			   strerror(errno));
+		os_free(pool->threads);
+		os_free(pool);
+		return NULL;
+	}
+	for (i = 0; i < 2; i++) {
+		fcntl(pool->pipe_fd[i], F_SETFL, O_NONBLOCK);
+		fcntl(pool->pipe_fd[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	if (pthread_mutex_init(&pool->lock, NULL) != 0 ||
+	    pthread_cond_init(&pool->cond, NULL) != 0) {
+		close(pool->pipe_fd[0]);
+		close(pool->pipe_fd[1]);
+		os_free(pool->threads);
+		os_free(pool);
+		return NULL;
+	}
+
+	if (eloop_register_read_sock(pool->pipe_fd[0], eap_tls_pool_receive,
+				     pool, NULL) < 0) {
+		eap_tls_pool_deinit(pool);
+		return NULL;
+	}
+
+	for (i = 0; i < threads; i++) {
+		if (pthread_create(&pool->threads[i], NULL,
+				   eap_tls_pool_worker, pool) != 0) {
+			wpa_printf(MSG_ERROR, "EAP-TLS pool: Failed to start "
+				   "worker thread");
+			break;
+		}
+		pool->num_threads++;
+	}
+	if (pool->num_threads == 0) {
+		eap_tls_pool_deinit(pool);
+		return NULL;
+	}
+
+	wpa_printf(MSG_DEBUG, "EAP-TLS pool: Started %d worker thread(s)",
+		   pool->num_threads);
+
+	return pool;
+}
+
+
+/**
+ * eap_tls_pool_deinit - Stop TLS handshake worker threads
+ * @pool: Pointer from eap_tls_pool_init()
+ *
+ * Pending jobs are marked completed; those not yet run fail. This needs to be
+ * called before the TLS context is deinitialized.
+ */
+void eap_tls_pool_deinit(struct eap_tls_pool *pool)
+{
+	struct eap_tls_job *job;
+	int i;
+
+	if (pool == NULL)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+	for (i = 0; i < pool->num_threads; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	eloop_unregister_read_sock(pool->pipe_fd[0]);
+	close(pool->pipe_fd[0]);
+	close(pool->pipe_fd[1]);
+
+	while ((job = dl_list_first(&pool->done, struct eap_tls_job, list)) ||
+	       (job = dl_list_first(&pool->queue, struct eap_tls_job,
+				    list))) {
+		dl_list_del(&job->list);
+		if (job->cancelled) {
+			tls_connection_deinit(job->tls_ctx, job->conn);
+			eap_tls_job_free(job);
+			continue;
+		}
+		job->pool = NULL;
+		job->state = JOB_DONE;
+		job->completed = 1;
+	}
+
+	pthread_cond_destroy(&pool->cond);
+	pthread_mutex_destroy(&pool->lock);
+	os_free(pool->threads);
+	os_free(pool);
+}
+
+
+/**
+ * eap_tls_pool_handshake - Queue a TLS server handshake step
+ * @pool: Pointer from eap_tls_pool_init()
+ * @tls_ctx: TLS context from tls_init()
+ * @conn: Connection context data from tls_connection_init()
+ * @in_data: Input data from the TLS peer
+ * @session_ctx: Context pointer to be given to the completion callback
+ * Returns: Pointer to the job or %NULL on failure
+ *
+ * This queues tls_connection_server_handshake() to be run in a worker thread.
+ * The caller must not use conn until eap_tls_job_done() returns 1. The
+ * output is fetched with eap_tls_job_finish() which also frees the job.
+ */
+struct eap_tls_job * eap_tls_pool_handshake(struct eap_tls_pool *pool,
+					    void *tls_ctx,
+					    struct tls_connection *conn,
+					    const struct wpabuf *in_data,
+					    void *session_ctx)
+{
+	struct eap_tls_job *job;
+
+	job = os_zalloc(sizeof(*job));
+	if (job == NULL)
+		return NULL;
+	if (in_data) {
+		job->in_data = wpabuf_dup(in_data);
+		if (job->in_data == NULL) {
+			os_free(job);
+			return NULL;
+		}
+	}
+	job->pool = pool;
+	job->tls_ctx = tls_ctx;
+	job->conn = conn;
+	job->session_ctx = session_ctx;
+	job->state = JOB_QUEUED;
+
+	pthread_mutex_lock(&pool->lock);
+	dl_list_add_tail(&pool->queue, &job->list);
+	pthread_cond_signal(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	pool->submitted++;
+	pool->queued++;
+	if (pool->queued > pool->peak_queued)
+		pool->peak_queued = pool->queued;
+	wpa_printf(MSG_DEBUG, "EAP-TLS pool: Queued handshake step for "
+		   "session %p (%u in progress)", session_ctx, pool->queued);
+
+	return job;
+}
+
+
+/**
+ * eap_tls_job_done - Check whether a queued handshake step is completed
+ * @job: Pointer from eap_tls_pool_handshake()
+ * Returns: 1 if the output is available, 0 if the job is still in progress
+ */
+int eap_tls_job_done(struct eap_tls_job *job)
+{
+	return job->completed;
+}
+
+
+/**
+ * eap_tls_job_finish - Fetch the output of a completed handshake step
+ * @job: Pointer from eap_tls_pool_handshake(); freed by this function
+ * Returns: Output of tls_connection_server_handshake() (may be %NULL)
+ */
+struct wpabuf * eap_tls_job_finish(struct eap_tls_job *job)
+{
+	struct wpabuf *out;
+
+	if (!job->completed) {
+		/* Should not happen; the connection may still be in use */
+		wpa_printf(MSG_ERROR, "EAP-TLS pool: Job not yet completed");
+		return NULL;
+	}
+
+	out = job->out_data;
+	job->out_data = NULL;
+	eap_tls_job_free(job);
+	return out;
+}
+
+
+/**
+ * eap_tls_job_cancel - Cancel a queued handshake step
+ * @job: Pointer from eap_tls_pool_handshake()
+ * Returns: 1 if the pool took over the TLS connection, 0 if not
+ *
+ * If a worker thread is still processing the job, the TLS connection cannot
+ * be freed by the caller. In that case, the pool releases it with
+ * tls_connection_deinit() once the worker has completed and this function
+ * returns 1. Otherwise, the caller remains responsible for the connection.
+ */
+int eap_tls_job_cancel(struct eap_tls_job *job)
+{
+	struct eap_tls_pool *pool = job->pool;
+
+	if (pool && !job->completed) {
+		pthread_mutex_lock(&pool->lock);
+		if (job->state != JOB_QUEUED) {
+			/* Running or waiting for the completion to be
+			 * processed in eap_tls_pool_receive() */
+			job->cancelled = 1;
+			pthread_mutex_unlock(&pool->lock);
+			pool->cancelled++;
+			return 1;
+		}
+		dl_list_del(&job->list);
+		pthread_mutex_unlock(&pool->lock);
+		pool->queued--;
+		pool->cancelled++;
+	}
+
+	eap_tls_job_free(job);
+	return 0;
+}
+
+
+/**
+ * eap_tls_pool_get_mib - Get TLS handshake worker pool statistics
+ * @pool: Pointer from eap_tls_pool_init()
+ * @buf: Buffer for the text
+ * @buflen: Length of the buffer
+ * Returns: Number of bytes written to the buffer
+ */
+int eap_tls_pool_get_mib(struct eap_tls_pool *pool, char *buf, size_t buflen)
+{
+	int ret;
+
+	if (pool == NULL)
+		return 0;
+
+	ret = os_snprintf(buf, buflen,
+			  "tlsPoolThreads=%d\n"
+			  "tlsPoolInProgress=%u\n"
+			  "tlsPoolPeakInProgress=%u\n"
+			  "tlsPoolSubmitted=%u\n"
+			  "tlsPoolCompleted=%u\n"
+			  "tlsPoolCancelled=%u\n",
+			  pool->num_threads, pool->queued, pool->peak_queued,
+			  pool->submitted, pool->completed, pool->cancelled);
+	if (ret < 0 || (size_t) ret >= buflen)
+		return 0;
+	return ret;
+}
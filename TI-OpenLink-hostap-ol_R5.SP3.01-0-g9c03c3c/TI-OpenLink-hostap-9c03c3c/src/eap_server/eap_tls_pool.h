@@ -0,0 +1,61 @@
+/*
+ * hostapd / EAP-TLS/PEAP/TTLS/FAST server handshake worker threads
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef EAP_TLS_POOL_H
+#define EAP_TLS_POOL_H
+
+struct eap_tls_pool;
+struct eap_tls_job;
+struct tls_connection;
+
+#ifdef CONFIG_EAP_SERVER_TLS_THREADS
+
+struct eap_tls_pool *
+eap_tls_pool_init(int threads,
+		  void (*complete_cb)(void *ctx, void *session_ctx),
+		  void *ctx);
+void eap_tls_pool_deinit(struct eap_tls_pool *pool);
+struct eap_tls_job * eap_tls_pool_handshake(struct eap_tls_pool *pool,
+					    void *tls_ctx,
+					    struct tls_connection *conn,
+					    const struct wpabuf *in_data,
+					    void *session_ctx);
+int eap_tls_job_done(struct eap_tls_job *job);
+struct wpabuf * eap_tls_job_finish(struct eap_tls_job *job);
+int eap_tls_job_cancel(struct eap_tls_job *job);
+int eap_tls_pool_get_mib(struct eap_tls_pool *pool, char *buf,
+			 size_t buflen);
+
+#else /* CONFIG_EAP_SERVER_TLS_THREADS */
+
+static inline struct eap_tls_job *
+eap_tls_pool_handshake(struct eap_tls_pool *pool, void *tls_ctx,
+		       struct tls_connection *conn,
+		       const struct wpabuf *in_data, void *session_ctx)
+{
+	return NULL;
+}
+
+static inline int eap_tls_job_done(struct eap_tls_job *job)
+{
+	return 1;
+}
+
+static inline struct wpabuf * eap_tls_job_finish(struct eap_tls_job *job)
+{
+	return NULL;
+}
+
+static inline int eap_tls_job_cancel(struct eap_tls_job *job)
+{
+	return 0;
+}
+
+#endif /* CONFIG_EAP_SERVER_TLS_THREADS */
+
+#endif /* EAP_TLS_POOL_H */
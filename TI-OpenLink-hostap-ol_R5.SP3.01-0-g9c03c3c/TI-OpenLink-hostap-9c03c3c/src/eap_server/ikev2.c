@@ -10,6 +10,7 @@
 
 #include "common.h"
 #include "crypto/dh_groups.h"
+#include "crypto/dh_pool.h"
 #include "crypto/random.h"
 #include "ikev2.h"
 
@@ -971,7 +972,9 @@ static int ikev2_build_kei(struct ikev2_initiator_data *data,
 	wpa_printf(MSG_DEBUG, "IKEV2: Adding KEi payload");
 
 	data->dh = dh_groups_get(data->proposal.dh);
-	pv = dh_init(data->dh, &data->i_dh_private);
+	pv = dh_pool_get(data->proposal.dh, &data->i_dh_private);
+	if (pv == NULL)
+		pv = dh_init(data->dh, &data->i_dh_private);
 	if (pv == NULL) {
 		wpa_printf(MSG_DEBUG, "IKEV2: Failed to initialize DH");
 		return -1;
@@ -142,7 +142,7 @@ static void eapol_auth_tx_req(struct eapol_state_machine *sm)
  * @timeout_ctx: Not used
  *
  * This statemachine is implemented as a function that will be called
- * once a second as a registered event loop timeout.
+ * once a second from the shared timer wheel.
  */
 static void eapol_port_timers_tick(void *eloop_ctx, void *timeout_ctx)
 {
@@ -186,7 +186,8 @@ static void eapol_port_timers_tick(void *eloop_ctx, void *timeout_ctx)
 
 	eapol_sm_step_run(state);
 
-	eloop_register_timeout(1, 0, eapol_port_timers_tick, eloop_ctx, state);
+	tick_wheel_add(state->eapol->conf.tick_wheel, &state->port_timers, 1,
+		       eapol_port_timers_tick, eloop_ctx, state);
 }
 
 
@@ -813,6 +814,7 @@ eapol_auth_alloc(struct eapol_authenticator *eapol, const u8 *addr,
 	eap_conf.ssl_ctx = eapol->conf.ssl_ctx;
 	eap_conf.msg_ctx = eapol->conf.msg_ctx;
 	eap_conf.eap_sim_db_priv = eapol->conf.eap_sim_db_priv;
+	eap_conf.tls_pool = eapol->conf.tls_pool;
 	eap_conf.pac_opaque_encr_key = eapol->conf.pac_opaque_encr_key;
 	eap_conf.eap_fast_a_id = eapol->conf.eap_fast_a_id;
 	eap_conf.eap_fast_a_id_len = eapol->conf.eap_fast_a_id_len;
@@ -847,7 +849,7 @@ void eapol_auth_free(struct eapol_state_machine *sm)
 	if (sm == NULL)
 		return;
 
-	eloop_cancel_timeout(eapol_port_timers_tick, NULL, sm);
+	tick_wheel_del(&sm->port_timers);
 	eloop_cancel_timeout(eapol_sm_step_cb, sm, NULL);
 	if (sm->eap)
 		eap_server_sm_deinit(sm->eap);
@@ -979,8 +981,8 @@ static void eapol_auth_initialize(struct eapol_state_machine *sm)
 	sm->initializing = FALSE;
 
 	/* Start one second tick for port timers state machine */
-	eloop_cancel_timeout(eapol_port_timers_tick, NULL, sm);
-	eloop_register_timeout(1, 0, eapol_port_timers_tick, NULL, sm);
+	tick_wheel_add(sm->eapol->conf.tick_wheel, &sm->port_timers, 1,
+		       eapol_port_timers_tick, NULL, sm);
 }
 
 
@@ -1032,9 +1034,11 @@ static int eapol_auth_conf_clone(struct eapol_auth_config *dst,
 	dst->ssl_ctx = src->ssl_ctx;
 	dst->msg_ctx = src->msg_ctx;
 	dst->eap_sim_db_priv = src->eap_sim_db_priv;
+	dst->tls_pool = src->tls_pool;
 	os_free(dst->eap_req_id_text);
 	dst->pwd_group = src->pwd_group;
 	dst->pbc_in_m1 = src->pbc_in_m1;
+	dst->tick_wheel = src->tick_wheel;
 	if (src->eap_req_id_text) {
 		dst->eap_req_id_text = os_malloc(src->eap_req_id_text_len);
 		if (dst->eap_req_id_text == NULL)
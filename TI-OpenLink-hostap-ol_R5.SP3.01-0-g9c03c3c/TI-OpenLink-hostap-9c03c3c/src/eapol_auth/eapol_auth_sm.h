@@ -14,6 +14,8 @@
 #define EAPOL_SM_USES_WPA BIT(2)
 #define EAPOL_SM_FROM_PMKSA_CACHE BIT(3)
 
+struct tick_wheel;
+
 struct eapol_auth_config {
 	int eap_reauth_period;
 	int wpa;
@@ -22,6 +24,7 @@ struct eapol_auth_config {
 	void *ssl_ctx;
 	void *msg_ctx;
 	void *eap_sim_db_priv;
+	void *tls_pool;
 	char *eap_req_id_text; /* a copy of this will be allocated */
 	size_t eap_req_id_text_len;
 	u8 *pac_opaque_encr_key;
@@ -38,6 +41,9 @@ struct eapol_auth_config {
 	u16 pwd_group;
 	int pbc_in_m1;
 
+	/* Shared wheel for the port timers or %NULL to use eloop timeouts */
+	struct tick_wheel *tick_wheel;
+
 	/* Opaque context pointer to owner data for callback functions */
 	void *ctx;
 };
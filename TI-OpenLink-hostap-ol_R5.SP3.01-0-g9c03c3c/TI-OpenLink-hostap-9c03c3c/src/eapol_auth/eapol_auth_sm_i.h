@@ -11,6 +11,7 @@
 
 #include "common/defs.h"
 #include "radius/radius.h"
+#include "utils/tick_wheel.h"
 
 /* IEEE Std 802.1X-2004, Ch. 8.2 */
 
@@ -41,6 +42,7 @@ struct eapol_state_machine {
 	int aWhile;
 	int quietWhile;
 	int reAuthWhen;
+	struct tick_wheel_entry port_timers;
 
 	/* global variables */
 	Boolean authAbort;
@@ -14,6 +14,11 @@
 #include "common.h"
 #include "eloop.h"
 #include "l2_packet.h"
+#ifdef CONFIG_PACKET_MMAP
+#include "packet_ring.h"
+
+#define L2_PACKET_RX_RING_FRAMES 64
+#endif /* CONFIG_PACKET_MMAP */
 
 
 struct l2_packet_data {
@@ -26,6 +31,9 @@ struct l2_packet_data {
 	void *rx_callback_ctx;
 	int l2_hdr; /* whether to include layer 2 (Ethernet) header data
 		     * buffers */
+#ifdef CONFIG_PACKET_MMAP
+	struct packet_ring *ring;
+#endif /* CONFIG_PACKET_MMAP */
 };
 
 
@@ -88,6 +96,27 @@ static void l2_packet_receive(int sock, void *eloop_ctx, void *sock_ctx)
 }
 
 
+#ifdef CONFIG_PACKET_MMAP
+
+static void l2_packet_ring_frame(void *ctx, const u8 *buf, size_t len,
+				 const struct sockaddr_ll *ll)
+{
+	struct l2_packet_data *l2 = ctx;
+
+	l2->rx_callback(l2->rx_callback_ctx, ll->sll_addr, buf, len);
+}
+
+
+static void l2_packet_ring_receive(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct l2_packet_data *l2 = eloop_ctx;
+
+	packet_ring_rx(l2->ring, l2_packet_ring_frame, l2);
+}
+
+#endif /* CONFIG_PACKET_MMAP */
+
+
 struct l2_packet_data * l2_packet_init(
 	const char *ifname, const u8 *own_addr, unsigned short protocol,
 	void (*rx_callback)(void *ctx, const u8 *src_addr,
@@ -146,6 +175,16 @@ struct l2_packet_data * l2_packet_init(
 	}
 	os_memcpy(l2->own_addr, ifr.ifr_hwaddr.sa_data, ETH_ALEN);
 
+#ifdef CONFIG_PACKET_MMAP
+	l2->ring = packet_ring_init(l2->fd, L2_PACKET_RX_RING_FRAMES, 0);
+	if (l2->ring) {
+		eloop_register_read_sock(l2->fd, l2_packet_ring_receive, l2,
+					 NULL);
+		return l2;
+	}
+	wpa_printf(MSG_DEBUG, "%s: Could not set up RX ring for %s; use "
+		   "recvfrom()", __func__, l2->ifname);
+#endif /* CONFIG_PACKET_MMAP */
 	eloop_register_read_sock(l2->fd, l2_packet_receive, l2, NULL);
 
 	return l2;
@@ -161,6 +200,9 @@ void l2_packet_deinit(struct l2_packet_data *l2)
 		eloop_unregister_read_sock(l2->fd);
 		close(l2->fd);
 	}
+#ifdef CONFIG_PACKET_MMAP
+	packet_ring_deinit(l2->ring);
+#endif /* CONFIG_PACKET_MMAP */
 		
 	os_free(l2);
 }
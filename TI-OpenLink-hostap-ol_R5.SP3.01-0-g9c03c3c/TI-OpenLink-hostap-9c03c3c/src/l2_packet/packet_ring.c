@@ -0,0 +1,309 @@
+/*
+ * Memory mapped RX/TX rings for Linux packet sockets
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * With PACKET_RX_RING, the kernel writes received frames directly into a ring
+ * that is shared with user space, so all frames that are ready when the socket
+ * becomes readable are processed without a recv() call for each frame. With
+ * PACKET_TX_RING, frames are written into the ring and a single send() call
+ * transmits all queued frames. Frames that are queued from an RX callback are
+ * sent together when the RX batch has been processed.
+ */
+
+#include "includes.h"
+#include <sys/mman.h>
+#include <linux/if_packet.h>
+
+#include "common.h"
+#include "eloop.h"
+#include "packet_ring.h"
+
+
+/* Large enough for any IEEE 802.11 frame with radiotap header */
+#define PACKET_RING_FRAME_SIZE 4096
+
+/* Offset of the frame data in TX ring entries */
+#define PACKET_RING_TX_DATA \
+	(TPACKET_ALIGN(sizeof(struct tpacket2_hdr)))
+
+struct packet_ring {
+	int sock;
+	u8 *map;
+	size_t map_len;
+	unsigned int frame_size;
+
+	u8 *rx;
+	unsigned int rx_frames;
+	unsigned int rx_head;
+
+	u8 *tx;
+	unsigned int tx_frames;
+	unsigned int tx_head;
+
+	int in_rx;
+	int tx_pending;
+	int deinit_pending;
+};
+
+
+static int packet_ring_setup(int sock, int type, unsigned int *frames,
+			     unsigned int block_size, unsigned int frame_size)
+{
+	struct tpacket_req req;
+	unsigned int per_block = block_size / frame_size;
+
+	os_memset(&req, 0, sizeof(req));
+	req.tp_block_size = block_size;
+	req.tp_block_nr = (*frames + per_block - 1) / per_block;
+	req.tp_frame_size = frame_size;
+	req.tp_frame_nr = req.tp_block_nr * per_block;
+	if (setsockopt(sock, SOL_PACKET, type, &req, sizeof(req)) < 0) {
+		wpa_printf(MSG_DEBUG, "packet_ring: setsockopt(%s): %s",
+			   type == PACKET_RX_RING ? "PACKET_RX_RING" :
+			   "PACKET_TX_RING", strerror(errno));
+		return -1;
+	}
+	*frames = req.tp_frame_nr;
+	return 0;
+}
+
+
+/**
+ * packet_ring_init - Set up memory mapped rings for a packet socket
+ * @sock: PF_PACKET socket that is already bound to an interface
+ * @rx_frames: Minimum number of frames in the RX ring
+ * @tx_frames: Minimum number of frames in the TX ring or 0 for no TX ring
+ * Returns: Pointer to the ring data or %NULL if the rings could not be set up
+ *
+ * After this, received frames are only available through packet_ring_rx().
+ * If the TX ring cannot be set up, only the RX ring is used and
+ * packet_ring_send() always returns -1 so that the caller falls back to
+ * send(). On failure, the socket can be used as before.
+ */
+struct packet_ring * packet_ring_init(int sock, unsigned int rx_frames,
+				      unsigned int tx_frames)
+{
+	struct packet_ring *ring;
+	int version = TPACKET_V2;
+	unsigned int block_size;
+	u8 buf[1];
+
+	ring = os_zalloc(sizeof(*ring));
+	if (ring == NULL)
+		return NULL;
+	ring->sock = sock;
+	ring->frame_size = PACKET_RING_FRAME_SIZE;
+	block_size = getpagesize();
+	if (block_size < ring->frame_size)
+		block_size = ring->frame_size;
+
+	if (setsockopt(sock, SOL_PACKET, PACKET_VERSION, &version,
+		       sizeof(version)) < 0) {
+		wpa_printf(MSG_DEBUG, "packet_ring: setsockopt(PACKET_VERSION):"
+			   " %s", strerror(errno));
+		os_free(ring);
+		return NULL;
+	}
+
+	ring->rx_frames = rx_frames;
+	if (packet_ring_setup(sock, PACKET_RX_RING, &ring->rx_frames,
+			      block_size, ring->frame_size) < 0) {
+		os_free(ring);
+		return NULL;
+	}
+	ring->tx_frames = tx_frames;
+	if (tx_frames &&
+	    packet_ring_setup(sock, PACKET_TX_RING, &ring->tx_frames,
+			      block_size, ring->frame_size) < 0)
+		ring->tx_frames = 0;
+
+	/* The RX ring is followed by the TX ring in the same mapping */
+	ring->map_len = (size_t) (ring->rx_frames + ring->tx_frames) *
+		ring->frame_size;
+	ring->map = mmap(NULL, ring->map_len, PROT_READ | PROT_WRITE,
+			 MAP_SHARED, sock, 0);
+	if (ring->map == MAP_FAILED) {
+		wpa_printf(MSG_DEBUG, "packet_ring: mmap: %s",
+			   strerror(errno));
+		os_free(ring);
+		return NULL;
+	}
+	ring->rx = ring->map;
+	if (ring->tx_frames)
+		ring->tx = ring->map + ring->rx_frames * ring->frame_size;
+
+	/*
+	 * Frames that were queued on the socket before the RX ring was set up
+	 * would keep the socket readable, so drop them.
+	 */
+	while (recv(sock, buf, sizeof(buf), MSG_DONTWAIT | MSG_TRUNC) >= 0)
+		;
+
+	wpa_printf(MSG_DEBUG, "packet_ring: %u RX and %u TX frames of %u "
+		   "bytes for socket %d", ring->rx_frames, ring->tx_frames,
+		   ring->frame_size, sock);
+
+	return ring;
+}
+
+
+static void packet_ring_tx_kick_timeout(void *eloop_ctx, void *timeout_ctx);
+
+static void packet_ring_tx_kick(struct packet_ring *ring)
+{
+	ring->tx_pending = 0;
+	if (send(ring->sock, NULL, 0, MSG_DONTWAIT) >= 0)
+		return;
+	if (errno == EAGAIN || errno == ENOBUFS) {
+		/* The frames that were not sent stay in the ring */
+		eloop_cancel_timeout(packet_ring_tx_kick_timeout, ring, NULL);
+		eloop_register_timeout(0, 10000, packet_ring_tx_kick_timeout,
+				       ring, NULL);
+		return;
+	}
+	wpa_printf(MSG_INFO, "packet_ring: send: %s", strerror(errno));
+}
+
+
+static void packet_ring_tx_kick_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	packet_ring_tx_kick(eloop_ctx);
+}
+
+
+static void packet_ring_free(struct packet_ring *ring)
+{
+	eloop_cancel_timeout(packet_ring_tx_kick_timeout, ring, NULL);
+	munmap(ring->map, ring->map_len);
+	os_free(ring);
+}
+
+
+/**
+ * packet_ring_deinit - Release the rings
+ * @ring: Pointer to the ring data from packet_ring_init() or %NULL
+ *
+ * This may be called from the packet_ring_rx() callback. The socket is not
+ * closed.
+ */
+void packet_ring_deinit(struct packet_ring *ring)
+{
+	if (ring == NULL)
+		return;
+	if (ring->in_rx) {
+		/* Completed in packet_ring_rx() */
+		ring->deinit_pending = 1;
+		return;
+	}
+	packet_ring_free(ring);
+}
+
+
+/**
+ * packet_ring_rx - Process all received frames
+ * @ring: Pointer to the ring data from packet_ring_init()
+ * @cb: Function to call for each frame
+ * @ctx: Context data for the callback
+ * Returns: Number of processed frames
+ *
+ * This is called when the socket is readable. Frames that the callback sends
+ * with packet_ring_send() are transmitted after the last frame has been
+ * processed. If the callback deinitializes the ring, the remaining frames are
+ * not processed.
+ */
+int packet_ring_rx(struct packet_ring *ring, packet_ring_rx_cb cb, void *ctx)
+{
+	struct tpacket2_hdr *hdr;
+	const struct sockaddr_ll *ll;
+	int count = 0;
+
+	ring->in_rx = 1;
+	for (;;) {
+		hdr = (struct tpacket2_hdr *)
+			(ring->rx + ring->rx_head * ring->frame_size);
+		if (!(hdr->tp_status & TP_STATUS_USER))
+			break;
+		__sync_synchronize();
+
+		if (hdr->tp_snaplen < hdr->tp_len) {
+			wpa_printf(MSG_DEBUG, "packet_ring: Drop truncated "
+				   "frame (len=%u)", hdr->tp_len);
+		} else {
+			ll = (const struct sockaddr_ll *)
+				((u8 *) hdr +
+				 TPACKET_ALIGN(sizeof(struct tpacket2_hdr)));
+			cb(ctx, (u8 *) hdr + hdr->tp_mac, hdr->tp_snaplen, ll);
+		}
+
+		__sync_synchronize();
+		hdr->tp_status = TP_STATUS_KERNEL;
+		ring->rx_head = (ring->rx_head + 1) % ring->rx_frames;
+		count++;
+		if (ring->deinit_pending)
+			break;
+	}
+	ring->in_rx = 0;
+
+	if (ring->deinit_pending) {
+		packet_ring_free(ring);
+		return count;
+	}
+	if (ring->tx_pending)
+		packet_ring_tx_kick(ring);
+
+	return count;
+}
+
+
+/**
+ * packet_ring_send - Transmit a frame through the TX ring
+ * @ring: Pointer to the ring data from packet_ring_init() or %NULL
+ * @hdr: Beginning of the frame (e.g., radiotap header) or %NULL
+ * @hdr_len: Length of hdr
+ * @data: Rest of the frame
+ * @data_len: Length of data
+ * Returns: 0 on success, -1 if the frame was not queued (no TX ring, ring
+ * full, or frame too long); the caller is expected to use send() instead
+ *
+ * Frames are sent in the order they are queued. Frames that are queued from a
+ * packet_ring_rx() callback are sent when the RX batch has been processed.
+ */
+int packet_ring_send(struct packet_ring *ring, const u8 *hdr, size_t hdr_len,
+		     const u8 *data, size_t data_len)
+{
+	struct tpacket2_hdr *ph;
+	u8 *pos;
+
+	if (ring == NULL || ring->tx == NULL ||
+	    hdr_len + data_len > ring->frame_size - PACKET_RING_TX_DATA)
+		return -1;
+
+	ph = (struct tpacket2_hdr *)
+		(ring->tx + ring->tx_head * ring->frame_size);
+	if (ph->tp_status == TP_STATUS_WRONG_FORMAT) {
+		wpa_printf(MSG_DEBUG, "packet_ring: Frame rejected by kernel");
+		ph->tp_status = TP_STATUS_AVAILABLE;
+	}
+	if (ph->tp_status != TP_STATUS_AVAILABLE)
+		return -1;
+	__sync_synchronize();
+
+	pos = (u8 *) ph + PACKET_RING_TX_DATA;
+	if (hdr_len)
+		os_memcpy(pos, hdr, hdr_len);
+	os_memcpy(pos + hdr_len, data, data_len);
+	ph->tp_len = hdr_len + data_len;
+	__sync_synchronize();
+	ph->tp_status = TP_STATUS_SEND_REQUEST;
+	ring->tx_head = (ring->tx_head + 1) % ring->tx_frames;
+
+	if (ring->in_rx)
+		ring->tx_pending = 1;
+	else
+		packet_ring_tx_kick(ring);
+
+	return 0;
+}
@@ -0,0 +1,25 @@
+/*
+ * Memory mapped RX/TX rings for Linux packet sockets
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef PACKET_RING_H
+#define PACKET_RING_H
+
+struct packet_ring;
+struct sockaddr_ll;
+
+typedef void (*packet_ring_rx_cb)(void *ctx, const u8 *buf, size_t len,
+				  const struct sockaddr_ll *ll);
+
+struct packet_ring * packet_ring_init(int sock, unsigned int rx_frames,
+				      unsigned int tx_frames);
+void packet_ring_deinit(struct packet_ring *ring);
+int packet_ring_rx(struct packet_ring *ring, packet_ring_rx_cb cb, void *ctx);
+int packet_ring_send(struct packet_ring *ring, const u8 *hdr, size_t hdr_len,
+		     const u8 *data, size_t data_len);
+
+#endif /* PACKET_RING_H */
@@ -50,6 +50,14 @@ static void p2p_scan_timeout(void *eloop_ctx, void *timeout_ctx);
 
 #define P2P_PEER_EXPIRATION_INTERVAL (P2P_PEER_EXPIRATION_AGE / 2)
 
+#define P2P_DEV_HASH(addr) \
+	(((addr)[4] ^ (addr)[5]) & (P2P_DEV_HASH_SIZE - 1))
+
+/**
+ * P2P_PROBE_IE_CACHE_LEN - Maximum length of cached Probe Request IEs
+ */
+#define P2P_PROBE_IE_CACHE_LEN 512
+
 #ifdef ANDROID_P2P
 int p2p_connection_in_progress(struct p2p_data *p2p)
 {
@@ -76,16 +84,35 @@ int p2p_connection_in_progress(struct p2p_data *p2p)
 }
 #endif
 
+/**
+ * p2p_device_seen - Update the time a peer was last seen
+ * @p2p: P2P module context from p2p_init()
+ * @dev: Peer entry
+ * @ts: Time the peer was seen or %NULL for the current time
+ */
+static void p2p_device_seen(struct p2p_data *p2p, struct p2p_device *dev,
+			    struct os_reltime *ts)
+{
+	if (ts)
+		dev->last_seen = *ts;
+	else
+		os_get_reltime(&dev->last_seen);
+	dev->expire.key = dev->last_seen.sec;
+	heap_update(&p2p->expire, &dev->expire);
+}
+
+
 static void p2p_expire_peers(struct p2p_data *p2p)
 {
-	struct p2p_device *dev, *n;
-	struct os_time now;
+	struct p2p_device *dev;
+	struct heap_node *node;
+	struct os_reltime now;
 	size_t i;
 
-	os_get_time(&now);
-	dl_list_for_each_safe(dev, n, &p2p->devices, struct p2p_device, list) {
-		if (dev->last_seen.sec + P2P_PEER_EXPIRATION_AGE >= now.sec)
-			continue;
+	os_get_reltime(&now);
+	while ((node = heap_first(&p2p->expire)) &&
+	       node->key + P2P_PEER_EXPIRATION_AGE < now.sec) {
+		dev = heap_entry(node, struct p2p_device, expire);
 
 		if (p2p->cfg->go_connected &&
 		    p2p->cfg->go_connected(p2p->cfg->cb_ctx,
@@ -94,7 +121,7 @@ static void p2p_expire_peers(struct p2p_data *p2p)
 			 * We are connected as a client to a group in which the
 			 * peer is the GO, so do not expire the peer entry.
 			 */
-			os_get_time(&dev->last_seen);
+			p2p_device_seen(p2p, dev, NULL);
 			continue;
 		}
 
@@ -108,7 +135,7 @@ static void p2p_expire_peers(struct p2p_data *p2p)
 			 * The peer is connected as a client in a group where
 			 * we are the GO, so do not expire the peer entry.
 			 */
-			os_get_time(&dev->last_seen);
+			p2p_device_seen(p2p, dev, NULL);
 			continue;
 		}
 
@@ -116,7 +143,7 @@ static void p2p_expire_peers(struct p2p_data *p2p)
 		/* If Connection is in progress, don't expire the peer
 		*/
 		if (p2p_connection_in_progress(p2p))
-			continue;
+			break;
 #endif
 
 		wpa_msg(p2p->cfg->msg_ctx, MSG_ERROR, "P2P: Expiring old peer "
@@ -363,7 +390,8 @@ static void p2p_device_clear_reported(struct p2p_data *p2p)
 struct p2p_device * p2p_get_device(struct p2p_data *p2p, const u8 *addr)
 {
 	struct p2p_device *dev;
-	dl_list_for_each(dev, &p2p->devices, struct p2p_device, list) {
+	dl_list_for_each(dev, &p2p->dev_hash[P2P_DEV_HASH(addr)],
+			 struct p2p_device, hash_dev) {
 		if (os_memcmp(dev->info.p2p_device_addr, addr, ETH_ALEN) == 0)
 			return dev;
 	}
@@ -381,7 +409,8 @@ struct p2p_device * p2p_get_device_interface(struct p2p_data *p2p,
 					     const u8 *addr)
 {
 	struct p2p_device *dev;
-	dl_list_for_each(dev, &p2p->devices, struct p2p_device, list) {
+	dl_list_for_each(dev, &p2p->iface_hash[P2P_DEV_HASH(addr)],
+			 struct p2p_device, hash_iface) {
 		if (os_memcmp(dev->interface_addr, addr, ETH_ALEN) == 0)
 			return dev;
 	}
@@ -389,6 +418,19 @@ struct p2p_device * p2p_get_device_interface(struct p2p_data *p2p,
 }
 
 
+static void p2p_device_set_interface_addr(struct p2p_data *p2p,
+					  struct p2p_device *dev,
+					  const u8 *addr)
+{
+	if (dev->hash_iface.next)
+		dl_list_del(&dev->hash_iface);
+	os_memcpy(dev->interface_addr, addr, ETH_ALEN);
+	if (!is_zero_ether_addr(addr))
+		dl_list_add(&p2p->iface_hash[P2P_DEV_HASH(addr)],
+			    &dev->hash_iface);
+}
+
+
 /**
  * p2p_create_device - Create a peer entry
  * @p2p: P2P module context from p2p_init()
@@ -401,20 +443,16 @@ struct p2p_device * p2p_get_device_interface(struct p2p_data *p2p,
 static struct p2p_device * p2p_create_device(struct p2p_data *p2p,
 					     const u8 *addr)
 {
-	struct p2p_device *dev, *oldest = NULL;
-	size_t count = 0;
+	struct p2p_device *dev, *oldest;
+	struct heap_node *node;
 
 	dev = p2p_get_device(p2p, addr);
 	if (dev)
 		return dev;
 
-	dl_list_for_each(dev, &p2p->devices, struct p2p_device, list) {
-		count++;
-		if (oldest == NULL ||
-		    os_time_before(&dev->last_seen, &oldest->last_seen))
-			oldest = dev;
-	}
-	if (count + 1 > p2p->cfg->max_peers && oldest) {
+	node = heap_first(&p2p->expire);
+	if (p2p->expire.count + 1 > p2p->cfg->max_peers && node) {
+		oldest = heap_entry(node, struct p2p_device, expire);
 		wpa_msg(p2p->cfg->msg_ctx, MSG_DEBUG,
 			"P2P: Remove oldest peer entry to make room for a new "
 			"peer");
@@ -430,8 +468,13 @@ static struct p2p_device * p2p_create_device(struct p2p_data *p2p,
 	dev = os_zalloc(sizeof(*dev));
 	if (dev == NULL)
 		return NULL;
+	if (heap_insert(&p2p->expire, &dev->expire) < 0) {
+		os_free(dev);
+		return NULL;
+	}
 	dl_list_add(&p2p->devices, &dev->list);
 	os_memcpy(dev->info.p2p_device_addr, addr, ETH_ALEN);
+	dl_list_add(&p2p->dev_hash[P2P_DEV_HASH(addr)], &dev->hash_dev);
 
 	return dev;
 }
@@ -519,9 +562,9 @@ static int p2p_add_group_clients(struct p2p_data *p2p, const u8 *go_dev_addr,
 			dev->flags |= P2P_DEV_REPORTED | P2P_DEV_REPORTED_ONCE;
 		}
 
-		os_memcpy(dev->interface_addr, cli->p2p_interface_addr,
-			  ETH_ALEN);
-		os_get_time(&dev->last_seen);
+		p2p_device_set_interface_addr(p2p, dev,
+					      cli->p2p_interface_addr);
+		p2p_device_seen(p2p, dev, NULL);
 		os_memcpy(dev->member_in_go_dev, go_dev_addr, ETH_ALEN);
 		os_memcpy(dev->member_in_go_iface, go_interface_addr,
 			  ETH_ALEN);
@@ -632,7 +675,7 @@ int p2p_add_device(struct p2p_data *p2p, const u8 *addr, int freq,
 	struct p2p_message msg;
 	const u8 *p2p_dev_addr;
 	int i, changed = 0;
-	struct os_time time_now, time_tmp_age, entry_ts;
+	struct os_reltime time_now, time_tmp_age, entry_ts;
 	enum p2p_go_state old_state;
 
 	os_memset(&msg, 0, sizeof(msg));
@@ -669,10 +712,10 @@ int p2p_add_device(struct p2p_data *p2p, const u8 *addr, int freq,
 		return -1;
 	}
 
-	os_get_time(&time_now);
+	os_get_reltime(&time_now);
 	time_tmp_age.sec = age_ms / 1000;
 	time_tmp_age.usec = (age_ms % 1000) * 1000;
-	os_time_sub(&time_now, &time_tmp_age, &entry_ts);
+	os_reltime_sub(&time_now, &time_tmp_age, &entry_ts);
 
 	/*
 	 * Update the device entry only if the new peer
@@ -680,15 +723,15 @@ int p2p_add_device(struct p2p_data *p2p, const u8 *addr, int freq,
 	 */
 
 	if (dev->last_seen.usec > 0 &&
-	    os_time_before(&entry_ts, &dev->last_seen))
+	    os_reltime_before(&entry_ts, &dev->last_seen))
 		return -1;
 
-	os_memcpy(&dev->last_seen, &entry_ts, sizeof(struct os_time));
+	p2p_device_seen(p2p, dev, &entry_ts);
 
 	dev->flags &= ~(P2P_DEV_PROBE_REQ_ONLY | P2P_DEV_GROUP_CLIENT_ONLY);
 
 	if (os_memcmp(addr, p2p_dev_addr, ETH_ALEN) != 0)
-		os_memcpy(dev->interface_addr, addr, ETH_ALEN);
+		p2p_device_set_interface_addr(p2p, dev, addr);
 	if (msg.ssid &&
 	    (msg.ssid[1] != P2P_WILDCARD_SSID_LEN ||
 	     os_memcmp(msg.ssid + 2, P2P_WILDCARD_SSID, P2P_WILDCARD_SSID_LEN)
@@ -782,10 +825,28 @@ int p2p_add_device(struct p2p_data *p2p, const u8 *addr, int freq,
 }
 
 
+static void p2p_device_clear_probe_cache(struct p2p_device *dev)
+{
+	if (dev->probe_msg) {
+		p2p_parse_free(dev->probe_msg);
+		os_free(dev->probe_msg);
+		dev->probe_msg = NULL;
+	}
+	os_free(dev->probe_ies);
+	dev->probe_ies = NULL;
+	dev->probe_ies_len = 0;
+}
+
+
 static void p2p_device_free(struct p2p_data *p2p, struct p2p_device *dev)
 {
 	int i;
 
+	dl_list_del(&dev->hash_dev);
+	if (dev->hash_iface.next)
+		dl_list_del(&dev->hash_iface);
+	heap_remove(&p2p->expire, &dev->expire);
+
 	if (p2p->go_neg_peer == dev) {
 		/*
 		 * If GO Negotiation is in progress, report that it has failed.
@@ -810,6 +871,7 @@ static void p2p_device_free(struct p2p_data *p2p, struct p2p_device *dev)
 		dev->info.wps_vendor_ext[i] = NULL;
 	}
 
+	p2p_device_clear_probe_cache(dev);
 	os_free(dev);
 }
 
@@ -1427,7 +1489,7 @@ int p2p_authorize(struct p2p_data *p2p, const u8 *peer_addr,
 void p2p_add_dev_info(struct p2p_data *p2p, const u8 *addr,
 		      struct p2p_device *dev, struct p2p_message *msg)
 {
-	os_get_time(&dev->last_seen);
+	p2p_device_seen(p2p, dev, NULL);
 
 	p2p_copy_wps_info(dev, 0, msg);
 
@@ -1739,59 +1801,98 @@ static void p2p_invite_start(void *eloop_ctx, void *timeout_ctx)
 }
 
 
+/**
+ * p2p_parse_probe_req - Parse Probe Request IEs
+ * @p2p: P2P module context from p2p_init()
+ * @addr: Source address of the frame
+ * @ie: IEs from the frame
+ * @ie_len: Length of ie buffer in octets
+ * @tmp: Buffer for the parsed IEs if they are not cached
+ * Returns: Parsed IEs or %NULL if they could not be parsed
+ *
+ * If the frame is from a known peer, the IEs and the parse result are stored
+ * in the peer entry and a frame with identical IEs is not parsed again. The
+ * caller must call p2p_parse_free() if the returned pointer is @tmp.
+ */
+static struct p2p_message * p2p_parse_probe_req(struct p2p_data *p2p,
+						const u8 *addr, const u8 *ie,
+						size_t ie_len,
+						struct p2p_message *tmp)
+{
+	struct p2p_device *dev;
+
+	dev = p2p_get_device(p2p, addr);
+	if (dev && dev->probe_msg && dev->probe_ies_len == ie_len &&
+	    os_memcmp(dev->probe_ies, ie, ie_len) == 0)
+		return dev->probe_msg;
+
+	if (dev)
+		p2p_device_clear_probe_cache(dev);
+	if (dev && ie_len <= P2P_PROBE_IE_CACHE_LEN) {
+		dev->probe_ies = os_malloc(ie_len);
+		dev->probe_msg = os_zalloc(sizeof(*dev->probe_msg));
+		if (dev->probe_ies && dev->probe_msg) {
+			os_memcpy(dev->probe_ies, ie, ie_len);
+			dev->probe_ies_len = ie_len;
+			/* The parsed IEs point to the stored copy */
+			if (p2p_parse_ies(dev->probe_ies, ie_len,
+					  dev->probe_msg) == 0)
+				return dev->probe_msg;
+			p2p_device_clear_probe_cache(dev);
+			return NULL;
+		}
+		p2p_device_clear_probe_cache(dev);
+	}
+
+	os_memset(tmp, 0, sizeof(*tmp));
+	if (p2p_parse_ies(ie, ie_len, tmp) < 0)
+		return NULL;
+	return tmp;
+}
+
+
 static void p2p_add_dev_from_probe_req(struct p2p_data *p2p, const u8 *addr,
-				       const u8 *ie, size_t ie_len)
+				       struct p2p_message *msg)
 {
-	struct p2p_message msg;
 	struct p2p_device *dev;
 
-	os_memset(&msg, 0, sizeof(msg));
-	if (p2p_parse_ies(ie, ie_len, &msg) < 0 || msg.p2p_attributes == NULL)
-	{
-		p2p_parse_free(&msg);
+	if (msg == NULL || msg->p2p_attributes == NULL)
 		return; /* not a P2P probe */
-	}
 
-	if (msg.ssid == NULL || msg.ssid[1] != P2P_WILDCARD_SSID_LEN ||
-	    os_memcmp(msg.ssid + 2, P2P_WILDCARD_SSID, P2P_WILDCARD_SSID_LEN)
+	if (msg->ssid == NULL || msg->ssid[1] != P2P_WILDCARD_SSID_LEN ||
+	    os_memcmp(msg->ssid + 2, P2P_WILDCARD_SSID, P2P_WILDCARD_SSID_LEN)
 	    != 0) {
 		/* The Probe Request is not part of P2P Device Discovery. It is
 		 * not known whether the source address of the frame is the P2P
 		 * Device Address or P2P Interface Address. Do not add a new
 		 * peer entry based on this frames.
 		 */
-		p2p_parse_free(&msg);
 		return;
 	}
 
 	dev = p2p_get_device(p2p, addr);
 	if (dev) {
-		if (dev->country[0] == 0 && msg.listen_channel)
-			os_memcpy(dev->country, msg.listen_channel, 3);
-		os_get_time(&dev->last_seen);
-		p2p_parse_free(&msg);
+		if (dev->country[0] == 0 && msg->listen_channel)
+			os_memcpy(dev->country, msg->listen_channel, 3);
+		p2p_device_seen(p2p, dev, NULL);
 		return; /* already known */
 	}
 
 	dev = p2p_create_device(p2p, addr);
-	if (dev == NULL) {
-		p2p_parse_free(&msg);
+	if (dev == NULL)
 		return;
-	}
 
-	os_get_time(&dev->last_seen);
+	p2p_device_seen(p2p, dev, NULL);
 	dev->flags |= P2P_DEV_PROBE_REQ_ONLY;
 
-	if (msg.listen_channel) {
-		os_memcpy(dev->country, msg.listen_channel, 3);
+	if (msg->listen_channel) {
+		os_memcpy(dev->country, msg->listen_channel, 3);
 		dev->listen_freq = p2p_channel_to_freq(dev->country,
-						       msg.listen_channel[3],
-						       msg.listen_channel[4]);
+						       msg->listen_channel[3],
+						       msg->listen_channel[4]);
 	}
 
-	p2p_copy_wps_info(dev, 1, &msg);
-
-	p2p_parse_free(&msg);
+	p2p_copy_wps_info(dev, 1, msg);
 
 	wpa_msg(p2p->cfg->msg_ctx, MSG_DEBUG,
 		"P2P: Created device entry based on Probe Req: " MACSTR
@@ -1810,7 +1911,7 @@ struct p2p_device * p2p_add_dev_from_go_neg_req(struct p2p_data *p2p,
 
 	dev = p2p_get_device(p2p, addr);
 	if (dev) {
-		os_get_time(&dev->last_seen);
+		p2p_device_seen(p2p, dev, NULL);
 		return dev; /* already known */
 	}
 
@@ -1950,12 +2051,12 @@ static int supp_rates_11b_only(struct ieee802_11_elems *elems)
 
 static enum p2p_probe_req_status
 p2p_reply_probe(struct p2p_data *p2p, const u8 *addr, const u8 *dst,
-		const u8 *bssid, const u8 *ie, size_t ie_len)
+		const u8 *bssid, const u8 *ie, size_t ie_len,
+		struct p2p_message *msg)
 {
 	struct ieee802_11_elems elems;
 	struct wpabuf *buf;
 	struct ieee80211_mgmt *resp;
-	struct p2p_message msg;
 	struct wpabuf *ies;
 
 	if (!p2p->in_listen || !p2p->drv_in_listen) {
@@ -1998,27 +2099,23 @@ p2p_reply_probe(struct p2p_data *p2p, const u8 *addr, const u8 *dst,
 		return P2P_PREQ_NOT_P2P;
 	}
 
-	os_memset(&msg, 0, sizeof(msg));
-	if (p2p_parse_ies(ie, ie_len, &msg) < 0) {
+	if (msg == NULL) {
 		/* Could not parse P2P attributes */
 		return P2P_PREQ_NOT_P2P;
 	}
 
-	if (msg.device_id &&
-	    os_memcmp(msg.device_id, p2p->cfg->dev_addr, ETH_ALEN) != 0) {
+	if (msg->device_id &&
+	    os_memcmp(msg->device_id, p2p->cfg->dev_addr, ETH_ALEN) != 0) {
 		/* Device ID did not match */
-		p2p_parse_free(&msg);
 		return P2P_PREQ_NOT_PROCESSED;
 	}
 
 	/* Check Requested Device Type match */
-	if (msg.wps_attributes &&
-	    !p2p_match_dev_type(p2p, msg.wps_attributes)) {
+	if (msg->wps_attributes &&
+	    !p2p_match_dev_type(p2p, msg->wps_attributes)) {
 		/* No match with Requested Device Type */
-		p2p_parse_free(&msg);
 		return P2P_PREQ_NOT_PROCESSED;
 	}
-	p2p_parse_free(&msg);
 
 	if (!p2p->cfg->send_probe_resp) {
 		/* Response generated elsewhere */
@@ -2094,10 +2191,13 @@ p2p_probe_req_rx(struct p2p_data *p2p, const u8 *addr, const u8 *dst,
 		 const u8 *bssid, const u8 *ie, size_t ie_len)
 {
 	enum p2p_probe_req_status res;
+	struct p2p_message tmp, *msg;
 
-	p2p_add_dev_from_probe_req(p2p, addr, ie, ie_len);
-
-	res = p2p_reply_probe(p2p, addr, dst, bssid, ie, ie_len);
+	msg = p2p_parse_probe_req(p2p, addr, ie, ie_len, &tmp);
+	p2p_add_dev_from_probe_req(p2p, addr, msg);
+	res = p2p_reply_probe(p2p, addr, dst, bssid, ie, ie_len, msg);
+	if (msg == &tmp)
+		p2p_parse_free(&tmp);
 
 	if ((p2p->state == P2P_CONNECT || p2p->state == P2P_CONNECT_LISTEN) &&
 	    p2p->go_neg_peer &&
@@ -2326,6 +2426,7 @@ void p2p_group_formation_failed(struct p2p_data *p2p)
 struct p2p_data * p2p_init(const struct p2p_config *cfg)
 {
 	struct p2p_data *p2p;
+	int i;
 
 	if (cfg->max_peers < 1)
 		return NULL;
@@ -2378,6 +2479,11 @@ struct p2p_data * p2p_init(const struct p2p_config *cfg)
 	p2p->dev_capab |= P2P_DEV_CAPAB_CLIENT_DISCOVERABILITY;
 
 	dl_list_init(&p2p->devices);
+	for (i = 0; i < P2P_DEV_HASH_SIZE; i++) {
+		dl_list_init(&p2p->dev_hash[i]);
+		dl_list_init(&p2p->iface_hash[i]);
+	}
+	heap_init(&p2p->expire);
 
 	eloop_register_timeout(P2P_PEER_EXPIRATION_INTERVAL, 0,
 			       p2p_expiration_timeout, p2p, NULL);
@@ -2395,6 +2501,7 @@ void p2p_deinit(struct p2p_data *p2p)
 	eloop_cancel_timeout(p2p_ext_listen_timeout, p2p, NULL);
 	eloop_cancel_timeout(p2p_scan_timeout, p2p, NULL);
 	p2p_flush(p2p);
+	heap_deinit(&p2p->expire);
 	p2p_free_req_dev_types(p2p);
 	os_free(p2p->cfg->dev_name);
 	os_free(p2p->cfg->manufacturer);
@@ -3392,7 +3499,7 @@ int p2p_get_peer_info_txt(const struct p2p_peer_info *info,
 	struct p2p_device *dev;
 	int res;
 	char *pos, *end;
-	struct os_time now;
+	struct os_reltime now;
 
 	if (info == NULL)
 		return -1;
@@ -3403,7 +3510,7 @@ int p2p_get_peer_info_txt(const struct p2p_peer_info *info,
 	pos = buf;
 	end = buf + buflen;
 
-	os_get_time(&now);
+	os_get_reltime(&now);
 	res = os_snprintf(pos, end - pos,
 			  "age=%d\n"
 			  "listen_freq=%d\n"
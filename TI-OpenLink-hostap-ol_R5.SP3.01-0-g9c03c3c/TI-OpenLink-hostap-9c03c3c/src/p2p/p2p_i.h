@@ -10,6 +10,7 @@
 #define P2P_I_H
 
 #include "utils/list.h"
+#include "utils/heap.h"
 #include "p2p.h"
 
 enum p2p_go_state {
@@ -23,7 +24,11 @@ enum p2p_go_state {
  */
 struct p2p_device {
 	struct dl_list list;
-	struct os_time last_seen;
+	struct dl_list hash_dev; /* p2p_data::dev_hash */
+	/* p2p_data::iface_hash; not in a list if interface_addr is not set */
+	struct dl_list hash_iface;
+	struct heap_node expire; /* p2p_data::expire; key = last_seen.sec */
+	struct os_reltime last_seen;
 	int listen_freq;
 	enum p2p_wps_method wps_method;
 
@@ -103,6 +108,15 @@ struct p2p_device {
 
 	u8 go_timeout;
 	u8 client_timeout;
+
+	/*
+	 * IEs from the last Probe Request frame of the peer and the parsed
+	 * version of them. A peer repeats the same Probe Request frame during
+	 * a find, so the frame needs to be parsed only once.
+	 */
+	u8 *probe_ies;
+	size_t probe_ies_len;
+	struct p2p_message *probe_msg;
 };
 
 struct p2p_sd_query {
@@ -224,6 +238,25 @@ struct p2p_data {
 	 */
 	struct dl_list devices;
 
+#define P2P_DEV_HASH_SIZE 64
+	/**
+	 * dev_hash - Peers hashed by P2P Device Address
+	 */
+	struct dl_list dev_hash[P2P_DEV_HASH_SIZE];
+
+	/**
+	 * iface_hash - Peers hashed by P2P Interface Address
+	 */
+	struct dl_list iface_hash[P2P_DEV_HASH_SIZE];
+
+	/**
+	 * expire - Peers ordered by the time they were last seen
+	 *
+	 * This is used to expire old peer entries and to find the oldest
+	 * entry when the maximum number of peers has been reached.
+	 */
+	struct heap expire;
+
 #ifdef ANDROID_P2P
 	/**
 	 * sd_dev_list - device pointer to be serviced next
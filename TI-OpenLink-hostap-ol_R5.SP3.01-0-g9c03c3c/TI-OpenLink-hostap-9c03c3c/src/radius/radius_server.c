@@ -10,6 +10,7 @@
 #include <net/if.h>
 
 #include "common.h"
+#include "list.h"
 #include "radius.h"
 #include "eloop.h"
 #include "eap_server/eap.h"
@@ -21,10 +22,23 @@
 #define RADIUS_SESSION_TIMEOUT 60
 
 /**
- * RADIUS_MAX_SESSION - Maximum number of active sessions
+ * RADIUS_SESSION_REMOVE_TIMEOUT - Time to keep completed sessions in seconds
+ *
+ * Completed sessions are kept for a while to be able to reply to
+ * retransmitted requests.
+ */
+#define RADIUS_SESSION_REMOVE_TIMEOUT 10
+
+/**
+ * RADIUS_MAX_SESSION - Default maximum number of active sessions
  */
 #define RADIUS_MAX_SESSION 100
 
+/**
+ * RADIUS_SESS_HASH_MAX - Maximum number of session hash table buckets
+ */
+#define RADIUS_SESS_HASH_MAX 65536
+
 /**
  * RADIUS_MAX_MSG_LEN - Maximum message length for incoming RADIUS messages
  */
@@ -55,7 +69,10 @@ struct radius_server_counters {
  * struct radius_session - Internal RADIUS server data for a session
  */
 struct radius_session {
-	struct radius_session *next;
+	struct radius_session *hnext; /* next entry in sess_hash bucket */
+	struct dl_list list; /* sess_active or sess_completed */
+	struct dl_list pending_list; /* sess_pending when last_msg is set */
+	struct os_time expire;
 	struct radius_client *client;
 	struct radius_server_data *server;
 	unsigned int sess_id;
@@ -85,7 +102,6 @@ struct radius_client {
 #endif /* CONFIG_IPV6 */
 	char *shared_secret;
 	int shared_secret_len;
-	struct radius_session *sessions;
 	struct radius_server_counters counters;
 };
 
@@ -120,6 +136,61 @@ struct radius_server_data {
 	 */
 	int num_sess;
 
+	/**
+	 * max_sessions - Maximum number of active sessions
+	 */
+	int max_sessions;
+
+	/**
+	 * sess_hash - Hash table of sessions indexed by session id (State)
+	 */
+	struct radius_session **sess_hash;
+
+	/**
+	 * sess_hash_size - Number of buckets in sess_hash (power of two)
+	 */
+	unsigned int sess_hash_size;
+
+	/**
+	 * sess_active - Sessions in progress in the order of expiration
+	 *
+	 * All sessions use the same timeout, so adding new sessions to the
+	 * tail keeps the list sorted and only the head needs to be checked
+	 * when expiring sessions.
+	 */
+	struct dl_list sess_active;
+
+	/**
+	 * sess_completed - Completed sessions in the order of expiration
+	 */
+	struct dl_list sess_completed;
+
+	/**
+	 * sess_pending - Sessions waiting for a pending EAP operation
+	 */
+	struct dl_list sess_pending;
+
+	/**
+	 * sess_expire_next - Time of the registered expiration timeout
+	 */
+	struct os_time sess_expire_next;
+
+	/**
+	 * sess_expire_set - Whether the expiration timeout is registered
+	 */
+	int sess_expire_set;
+
+	/**
+	 * sess_counters - Session table statistics
+	 */
+	struct {
+		u32 created;
+		u32 completed;
+		u32 timed_out;
+		u32 no_room;
+		u32 peak;
+	} sess_counters;
+
 	/**
 	 * eap_sim_db_priv - EAP-SIM/AKA database context
 	 *
@@ -128,6 +199,11 @@ struct radius_server_data {
 	 */
 	void *eap_sim_db_priv;
 
+	/**
+	 * tls_pool - TLS handshake worker pool from eap_tls_pool_init()
+	 */
+	void *tls_pool;
+
 	/**
 	 * ssl_ctx - TLS context
 	 *
@@ -305,9 +381,7 @@ wpa_hexdump(MSG_MSGDUMP, "RADIUS SRV: " args)
 wpa_hexdump_ascii(MSG_MSGDUMP, "RADIUS SRV: " args)
 
 
-static void radius_server_session_timeout(void *eloop_ctx, void *timeout_ctx);
-static void radius_server_session_remove_timeout(void *eloop_ctx,
-						 void *timeout_ctx);
+static void radius_server_session_expire(void *eloop_ctx, void *timeout_ctx);
 
 
 static struct radius_client *
@@ -349,27 +423,76 @@ radius_server_get_client(struct radius_server_data *data, struct in_addr *addr,
 }
 
 
+#define RADIUS_SESS_HASH(data, id) ((id) & ((data)->sess_hash_size - 1))
+
 static struct radius_session *
-radius_server_get_session(struct radius_client *client, unsigned int sess_id)
+radius_server_get_session(struct radius_server_data *data,
+			  struct radius_client *client, unsigned int sess_id)
 {
-	struct radius_session *sess = client->sessions;
+	struct radius_session *sess;
 
-	while (sess) {
-		if (sess->sess_id == sess_id) {
-			break;
-		}
-		sess = sess->next;
-	}
+	sess = data->sess_hash[RADIUS_SESS_HASH(data, sess_id)];
+	while (sess && sess->sess_id != sess_id)
+		sess = sess->hnext;
+
+	/* Do not allow a client to refer to sessions of other clients */
+	if (sess && client && sess->client != client)
+		return NULL;
 
 	return sess;
 }
 
 
+static void radius_server_session_expire_set(struct radius_server_data *data,
+					     struct os_time *expire)
+{
+	struct os_time now, diff;
+
+	if (data->sess_expire_set &&
+	    !os_time_before(expire, &data->sess_expire_next))
+		return;
+
+	eloop_cancel_timeout(radius_server_session_expire, data, NULL);
+	os_get_time(&now);
+	if (os_time_before(&now, expire))
+		os_time_sub(expire, &now, &diff);
+	else
+		diff.sec = diff.usec = 0;
+	eloop_register_timeout(diff.sec, diff.usec,
+			       radius_server_session_expire, data, NULL);
+	data->sess_expire_next = *expire;
+	data->sess_expire_set = 1;
+}
+
+
+static void radius_server_session_queue(struct radius_server_data *data,
+					struct radius_session *sess,
+					struct dl_list *list, int timeout)
+{
+	if (sess->list.next)
+		dl_list_del(&sess->list);
+	os_get_time(&sess->expire);
+	sess->expire.sec += timeout;
+	dl_list_add_tail(list, &sess->list);
+	radius_server_session_expire_set(data, &sess->expire);
+}
+
+
 static void radius_server_session_free(struct radius_server_data *data,
 				       struct radius_session *sess)
 {
-	eloop_cancel_timeout(radius_server_session_timeout, data, sess);
-	eloop_cancel_timeout(radius_server_session_remove_timeout, data, sess);
+	struct radius_session **pos;
+
+	pos = &data->sess_hash[RADIUS_SESS_HASH(data, sess->sess_id)];
+	while (*pos && *pos != sess)
+		pos = &(*pos)->hnext;
+	if (*pos)
+		*pos = sess->hnext;
+	if (sess->list.next)
+		dl_list_del(&sess->list);
+	if (sess->pending_list.next)
+		dl_list_del(&sess->pending_list);
+
 	eap_server_sm_deinit(sess->eap);
 	radius_msg_free(sess->last_msg);
 	os_free(sess->last_from_addr);
@@ -379,49 +502,43 @@ static void radius_server_session_free(struct radius_server_data *data,
 }
 
 
-static void radius_server_session_remove(struct radius_server_data *data,
-					 struct radius_session *sess)
-{
-	struct radius_client *client = sess->client;
-	struct radius_session *session, *prev;
-
-	eloop_cancel_timeout(radius_server_session_remove_timeout, data, sess);
-
-	prev = NULL;
-	session = client->sessions;
-	while (session) {
-		if (session == sess) {
-			if (prev == NULL) {
-				client->sessions = sess->next;
-			} else {
-				prev->next = sess->next;
-			}
-			radius_server_session_free(data, sess);
-			break;
-		}
-		prev = session;
-		session = session->next;
-	}
-}
-
-
-static void radius_server_session_remove_timeout(void *eloop_ctx,
-						 void *timeout_ctx)
+static void radius_server_session_expire(void *eloop_ctx, void *timeout_ctx)
 {
 	struct radius_server_data *data = eloop_ctx;
-	struct radius_session *sess = timeout_ctx;
-	RADIUS_DEBUG("Removing completed session 0x%x", sess->sess_id);
-	radius_server_session_remove(data, sess);
-}
+	struct radius_session *sess, *next = NULL;
+	struct os_time now;
+
+	data->sess_expire_set = 0;
+	os_get_time(&now);
 
+	while ((sess = dl_list_first(&data->sess_completed,
+				     struct radius_session, list))) {
+		if (os_time_before(&now, &sess->expire))
+			break;
+		RADIUS_DEBUG("Removing completed session 0x%x", sess->sess_id);
+		data->sess_counters.completed++;
+		radius_server_session_free(data, sess);
+	}
 
-static void radius_server_session_timeout(void *eloop_ctx, void *timeout_ctx)
-{
-	struct radius_server_data *data = eloop_ctx;
-	struct radius_session *sess = timeout_ctx;
+	while ((sess = dl_list_first(&data->sess_active,
+				     struct radius_session, list))) {
+		if (os_time_before(&now, &sess->expire))
+			break;
+		RADIUS_DEBUG("Timing out authentication session 0x%x",
+			     sess->sess_id);
+		data->sess_counters.timed_out++;
+		radius_server_session_free(data, sess);
+	}
 
-	RADIUS_DEBUG("Timing out authentication session 0x%x", sess->sess_id);
-	radius_server_session_remove(data, sess);
+	/* Both lists are sorted, so only the heads need to be considered */
+	next = dl_list_first(&data->sess_completed, struct radius_session,
+			     list);
+	sess = dl_list_first(&data->sess_active, struct radius_session, list);
+	if (next == NULL ||
+	    (sess && os_time_before(&sess->expire, &next->expire)))
+		next = sess;
+	if (next)
+		radius_server_session_expire_set(data, &next->expire);
 }
 
 
@@ -430,10 +547,12 @@ radius_server_new_session(struct radius_server_data *data,
 			  struct radius_client *client)
 {
 	struct radius_session *sess;
+	unsigned int hash;
 
-	if (data->num_sess >= RADIUS_MAX_SESSION) {
+	if (data->num_sess >= data->max_sessions) {
 		RADIUS_DEBUG("Maximum number of existing session - no room "
 			     "for a new session");
+		data->sess_counters.no_room++;
 		return NULL;
 	}
 
@@ -443,12 +562,19 @@ radius_server_new_session(struct radius_server_data *data,
 
 	sess->server = data;
 	sess->client = client;
-	sess->sess_id = data->next_sess_id++;
-	sess->next = client->sessions;
-	client->sessions = sess;
-	eloop_register_timeout(RADIUS_SESSION_TIMEOUT, 0,
-			       radius_server_session_timeout, data, sess);
+	/* Skip identifiers still in use after a wrap around */
+	do {
+		sess->sess_id = data->next_sess_id++;
+	} while (radius_server_get_session(data, NULL, sess->sess_id));
+	hash = RADIUS_SESS_HASH(data, sess->sess_id);
+	sess->hnext = data->sess_hash[hash];
+	data->sess_hash[hash] = sess;
+	radius_server_session_queue(data, sess, &data->sess_active,
+				    RADIUS_SESSION_TIMEOUT);
 	data->num_sess++;
+	data->sess_counters.created++;
+	if ((u32) data->num_sess > data->sess_counters.peak)
+		data->sess_counters.peak = data->num_sess;
 	return sess;
 }
 
@@ -498,6 +624,7 @@ radius_server_get_new_session(struct radius_server_data *data,
 	eap_conf.ssl_ctx = data->ssl_ctx;
 	eap_conf.msg_ctx = data->msg_ctx;
 	eap_conf.eap_sim_db_priv = data->eap_sim_db_priv;
+	eap_conf.tls_pool = data->tls_pool;
 	eap_conf.backend_auth = TRUE;
 	eap_conf.eap_server = 1;
 	eap_conf.pac_opaque_encr_key = data->pac_opaque_encr_key;
@@ -706,7 +833,7 @@ static int radius_server_request(struct radius_server_data *data,
 		state_included = res >= 0;
 		if (res == sizeof(statebuf)) {
 			state = WPA_GET_BE32(statebuf);
-			sess = radius_server_get_session(client, state);
+			sess = radius_server_get_session(data, client, state);
 		} else {
 			sess = NULL;
 		}
@@ -796,6 +923,9 @@ static int radius_server_request(struct radius_server_data *data,
 		sess->last_from_addr = os_strdup(from_addr);
 		sess->last_fromlen = fromlen;
 		os_memcpy(&sess->last_from, from, fromlen);
+		if (sess->pending_list.next == NULL)
+			dl_list_add_tail(&data->sess_pending,
+					 &sess->pending_list);
 		return -2;
 	} else {
 		RADIUS_DEBUG("No EAP data from the state machine - ignore this"
@@ -855,11 +985,8 @@ static int radius_server_request(struct radius_server_data *data,
 	if (is_complete) {
 		RADIUS_DEBUG("Removing completed session 0x%x after timeout",
 			     sess->sess_id);
-		eloop_cancel_timeout(radius_server_session_remove_timeout,
-				     data, sess);
-		eloop_register_timeout(10, 0,
-				       radius_server_session_remove_timeout,
-				       data, sess);
+		radius_server_session_queue(data, sess, &data->sess_completed,
+					    RADIUS_SESSION_REMOVE_TIMEOUT);
 	}
 
 	return 0;
@@ -1044,22 +1171,20 @@ static int radius_server_open_socket6(int port)
 #endif /* CONFIG_IPV6 */
 
 
-static void radius_server_free_sessions(struct radius_server_data *data,
-					struct radius_session *sessions)
+static void radius_server_free_sessions(struct radius_server_data *data)
 {
-	struct radius_session *session, *prev;
+	struct radius_session *sess;
 
-	session = sessions;
-	while (session) {
-		prev = session;
-		session = session->next;
-		radius_server_session_free(data, prev);
-	}
+	while ((sess = dl_list_first(&data->sess_active, struct radius_session,
+				     list)))
+		radius_server_session_free(data, sess);
+	while ((sess = dl_list_first(&data->sess_completed,
+				     struct radius_session, list)))
+		radius_server_session_free(data, sess);
 }
 
 
-static void radius_server_free_clients(struct radius_server_data *data,
-				       struct radius_client *clients)
+static void radius_server_free_clients(struct radius_client *clients)
 {
 	struct radius_client *client, *prev;
 
@@ -1068,7 +1193,6 @@ static void radius_server_free_clients(struct radius_server_data *data,
 		prev = client;
 		client = client->next;
 
-		radius_server_free_sessions(data, prev->sessions);
 		os_free(prev->shared_secret);
 		os_free(prev);
 	}
@@ -1218,7 +1342,7 @@ radius_server_read_clients(const char *client_file, int ipv6)
 
 	if (failed) {
 		RADIUS_ERROR("Invalid line %d in '%s'", line, client_file);
-		radius_server_free_clients(NULL, clients);
+		radius_server_free_clients(clients);
 		clients = NULL;
 	}
 
@@ -1255,9 +1379,26 @@ radius_server_init(struct radius_server_conf *conf)
 	if (data == NULL)
 		return NULL;
 
+	dl_list_init(&data->sess_active);
+	dl_list_init(&data->sess_completed);
+	dl_list_init(&data->sess_pending);
+	data->max_sessions = conf->max_sessions > 0 ? conf->max_sessions :
+		RADIUS_MAX_SESSION;
+	data->sess_hash_size = 16;
+	while (data->sess_hash_size < (unsigned int) data->max_sessions &&
+	       data->sess_hash_size < RADIUS_SESS_HASH_MAX)
+		data->sess_hash_size <<= 1;
+	data->sess_hash = os_zalloc(data->sess_hash_size *
+				    sizeof(struct radius_session *));
+	if (data->sess_hash == NULL) {
+		os_free(data);
+		return NULL;
+	}
+
 	os_get_time(&data->start_time);
 	data->conf_ctx = conf->conf_ctx;
 	data->eap_sim_db_priv = conf->eap_sim_db_priv;
+	data->tls_pool = conf->tls_pool;
 	data->ssl_ctx = conf->ssl_ctx;
 	data->msg_ctx = conf->msg_ctx;
 	data->ipv6 = conf->ipv6;
@@ -1343,7 +1484,12 @@ void radius_server_deinit(struct radius_server_data *data)
 		close(data->auth_sock);
 	}
 
-	radius_server_free_clients(data, data->clients);
+	if (data->sess_hash) {
+		radius_server_free_sessions(data);
+		os_free(data->sess_hash);
+	}
+	eloop_cancel_timeout(radius_server_session_expire, data, NULL);
+	radius_server_free_clients(data->clients);
 
 	os_free(data->pac_opaque_encr_key);
 	os_free(data->eap_fast_a_id);
@@ -1423,6 +1569,29 @@ int radius_server_get_mib(struct radius_server_data *data, char *buf,
 	}
 	pos += ret;
 
+	ret = os_snprintf(pos, end - pos,
+			  "radiusAuthServActiveSessions=%d\n"
+			  "radiusAuthServMaxSessions=%d\n"
+			  "radiusAuthServPeakSessions=%u\n"
+			  "radiusAuthServTotalSessions=%u\n"
+			  "radiusAuthServCompletedSessions=%u\n"
+			  "radiusAuthServTimedOutSessions=%u\n"
+			  "radiusAuthServNoRoomSessions=%u\n"
+			  "radiusAuthServSessionHashSize=%u\n",
+			  data->num_sess,
+			  data->max_sessions,
+			  data->sess_counters.peak,
+			  data->sess_counters.created,
+			  data->sess_counters.completed,
+			  data->sess_counters.timed_out,
+			  data->sess_counters.no_room,
+			  data->sess_hash_size);
+	if (ret < 0 || ret >= end - pos) {
+		*pos = '\0';
+		return pos - buf;
+	}
+	pos += ret;
+
 	for (cli = data->clients, idx = 0; cli; cli = cli->next, idx++) {
 		char abuf[50], mbuf[50];
 #ifdef CONFIG_IPV6
@@ -1512,24 +1681,19 @@ static struct eapol_callbacks radius_server_eapol_cb =
  */
 void radius_server_eap_pending_cb(struct radius_server_data *data, void *ctx)
 {
-	struct radius_client *cli;
 	struct radius_session *s, *sess = NULL;
 	struct radius_msg *msg;
 
 	if (data == NULL)
 		return;
 
-	for (cli = data->clients; cli; cli = cli->next) {
-		for (s = cli->sessions; s; s = s->next) {
-			if (s->eap == ctx && s->last_msg) {
-				sess = s;
-				break;
-			}
-			if (sess)
-				break;
-		}
-		if (sess)
+	/* Only the sessions with a stored request are on the pending list */
+	dl_list_for_each(s, &data->sess_pending, struct radius_session,
+			 pending_list) {
+		if (s->eap == ctx && s->last_msg) {
+			sess = s;
 			break;
+		}
 	}
 
 	if (sess == NULL) {
@@ -1539,10 +1703,11 @@ void radius_server_eap_pending_cb(struct radius_server_data *data, void *ctx)
 
 	msg = sess->last_msg;
 	sess->last_msg = NULL;
+	dl_list_del(&sess->pending_list);
 	eap_sm_pending_cb(sess->eap);
 	if (radius_server_request(data, msg,
 				  (struct sockaddr *) &sess->last_from,
-				  sess->last_fromlen, cli,
+				  sess->last_fromlen, sess->client,
 				  sess->last_from_addr,
 				  sess->last_from_port, sess) == -2)
 		return; /* msg was stored with the session */
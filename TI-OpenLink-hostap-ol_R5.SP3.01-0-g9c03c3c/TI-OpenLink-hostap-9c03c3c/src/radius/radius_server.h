@@ -49,6 +49,15 @@ struct radius_server_conf {
 	 */
 	void *eap_sim_db_priv;
 
+	/**
+	 * tls_pool - TLS handshake worker pool from eap_tls_pool_init()
+	 *
+	 * This is passed to the EAP server implementation for running the
+	 * TLS handshake steps in worker threads. %NULL to process them in
+	 * the eloop thread.
+	 */
+	void *tls_pool;
+
 	/**
 	 * ssl_ctx - TLS context
 	 *
@@ -157,6 +166,15 @@ struct radius_server_conf {
 	 */
 	int ipv6;
 
+	/**
+	 * max_sessions - Maximum number of concurrent sessions
+	 *
+	 * New sessions are rejected when this many authentication sessions
+	 * are in progress or waiting for removal after completion. Zero
+	 * selects the default limit (100).
+	 */
+	int max_sessions;
+
 	/**
 	 * get_eap_user - Callback for fetching EAP user information
 	 * @ctx: Context data from conf_ctx
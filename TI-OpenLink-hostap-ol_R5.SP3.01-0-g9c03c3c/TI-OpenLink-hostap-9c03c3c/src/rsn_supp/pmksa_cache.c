@@ -10,6 +10,8 @@
 
 #include "common.h"
 #include "eloop.h"
+#include "list.h"
+#include "heap.h"
 #include "eapol_supp/eapol_supp_sm.h"
 #include "wpa.h"
 #include "wpa_i.h"
@@ -20,7 +22,13 @@
 static const int pmksa_cache_max_entries = 32;
 
 struct rsn_pmksa_cache {
-	struct rsn_pmksa_cache_entry *pmksa; /* PMKSA cache */
+#define PMKSA_HASH_SIZE 32
+#define PMKID_HASH(pmkid) (unsigned int) ((pmkid)[0] & (PMKSA_HASH_SIZE - 1))
+#define AA_HASH(aa) (unsigned int) ((aa)[5] & (PMKSA_HASH_SIZE - 1))
+	struct dl_list pmkid[PMKSA_HASH_SIZE];
+	struct dl_list aa[PMKSA_HASH_SIZE];
+	struct dl_list lru; /* least recently used entry first */
+	struct heap expire;
 	int pmksa_count; /* number of entries in PMKSA cache */
 	struct wpa_sm *sm; /* TODO: get rid of this reference(?) */
 
@@ -43,6 +51,10 @@ static void pmksa_cache_free_entry(struct rsn_pmksa_cache *pmksa,
 				   struct rsn_pmksa_cache_entry *entry,
 				   int replace)
 {
+	dl_list_del(&entry->list);
+	dl_list_del(&entry->hash_pmkid);
+	dl_list_del(&entry->hash_aa);
+	heap_remove(&pmksa->expire, &entry->expire);
 	wpa_sm_remove_pmkid(pmksa->sm, entry->aa, entry->pmkid);
 	pmksa->pmksa_count--;
 	pmksa->free_cb(entry, pmksa->ctx, replace);
@@ -53,12 +65,13 @@ static void pmksa_cache_free_entry(struct rsn_pmksa_cache *pmksa,
 static void pmksa_cache_expire(void *eloop_ctx, void *timeout_ctx)
 {
 	struct rsn_pmksa_cache *pmksa = eloop_ctx;
-	struct os_time now;
+	struct rsn_pmksa_cache_entry *entry;
+	struct heap_node *node;
+	struct os_reltime now;
 
-	os_get_time(&now);
-	while (pmksa->pmksa && pmksa->pmksa->expiration <= now.sec) {
-		struct rsn_pmksa_cache_entry *entry = pmksa->pmksa;
-		pmksa->pmksa = entry->next;
+	os_get_reltime(&now);
+	while ((node = heap_first(&pmksa->expire)) && node->key <= now.sec) {
+		entry = heap_entry(node, struct rsn_pmksa_cache_entry, expire);
 		wpa_printf(MSG_DEBUG, "RSN: expired PMKSA cache entry for "
 			   MACSTR, MAC2STR(entry->aa));
 		pmksa_cache_free_entry(pmksa, entry, 0);
@@ -80,14 +93,16 @@ static void pmksa_cache_set_expiration(struct rsn_pmksa_cache *pmksa)
 {
 	int sec;
 	struct rsn_pmksa_cache_entry *entry;
-	struct os_time now;
+	struct heap_node *node;
+	struct os_reltime now;
 
 	eloop_cancel_timeout(pmksa_cache_expire, pmksa, NULL);
 	eloop_cancel_timeout(pmksa_cache_reauth, pmksa, NULL);
-	if (pmksa->pmksa == NULL)
+	node = heap_first(&pmksa->expire);
+	if (node == NULL)
 		return;
-	os_get_time(&now);
-	sec = pmksa->pmksa->expiration - now.sec;
+	os_get_reltime(&now);
+	sec = node->key - now.sec;
 	if (sec < 0)
 		sec = 0;
 	eloop_register_timeout(sec + 1, 0, pmksa_cache_expire, pmksa, NULL);
@@ -95,7 +110,7 @@ static void pmksa_cache_set_expiration(struct rsn_pmksa_cache *pmksa)
 	entry = pmksa->sm->cur_pmksa ? pmksa->sm->cur_pmksa :
 		pmksa_cache_get(pmksa, pmksa->sm->bssid, NULL, NULL);
 	if (entry) {
-		sec = pmksa->pmksa->reauth_time - now.sec;
+		sec = entry->reauth_time - now.sec;
 		if (sec < 0)
 			sec = 0;
 		eloop_register_timeout(sec, 0, pmksa_cache_reauth, pmksa,
@@ -104,6 +119,14 @@ static void pmksa_cache_set_expiration(struct rsn_pmksa_cache *pmksa)
 }
 
 
+static void pmksa_cache_touch(struct rsn_pmksa_cache *pmksa,
+			      struct rsn_pmksa_cache_entry *entry)
+{
+	dl_list_del(&entry->list);
+	dl_list_add_tail(&pmksa->lru, &entry->list);
+}
+
+
 /**
  * pmksa_cache_add - Add a PMKSA cache entry
  * @pmksa: Pointer to PMKSA cache data from pmksa_cache_init()
@@ -124,8 +147,8 @@ struct rsn_pmksa_cache_entry *
 pmksa_cache_add(struct rsn_pmksa_cache *pmksa, const u8 *pmk, size_t pmk_len,
 		const u8 *aa, const u8 *spa, void *network_ctx, int akmp)
 {
-	struct rsn_pmksa_cache_entry *entry, *pos, *prev;
-	struct os_time now;
+	struct rsn_pmksa_cache_entry *entry, *pos;
+	struct os_reltime now;
 
 	if (pmk_len > PMK_LEN)
 		return NULL;
@@ -137,7 +160,7 @@ pmksa_cache_add(struct rsn_pmksa_cache *pmksa, const u8 *pmk, size_t pmk_len,
 	entry->pmk_len = pmk_len;
 	rsn_pmkid(pmk, pmk_len, aa, spa, entry->pmkid,
 		  wpa_key_mgmt_sha256(akmp));
-	os_get_time(&now);
+	os_get_reltime(&now);
 	entry->expiration = now.sec + pmksa->sm->dot11RSNAConfigPMKLifetime;
 	entry->reauth_time = now.sec + pmksa->sm->dot11RSNAConfigPMKLifetime *
 		pmksa->sm->dot11RSNAConfigPMKReauthThreshold / 100;
@@ -147,9 +170,8 @@ pmksa_cache_add(struct rsn_pmksa_cache *pmksa, const u8 *pmk, size_t pmk_len,
 
 	/* Replace an old entry for the same Authenticator (if found) with the
 	 * new entry */
-	pos = pmksa->pmksa;
-	prev = NULL;
-	while (pos) {
+	dl_list_for_each(pos, &pmksa->aa[AA_HASH(aa)],
+			 struct rsn_pmksa_cache_entry, hash_aa) {
 		if (os_memcmp(aa, pos->aa, ETH_ALEN) == 0) {
 			if (pos->pmk_len == pmk_len &&
 			    os_memcmp(pos->pmk, pmk, pmk_len) == 0 &&
@@ -158,12 +180,9 @@ pmksa_cache_add(struct rsn_pmksa_cache *pmksa, const u8 *pmk, size_t pmk_len,
 				wpa_printf(MSG_DEBUG, "WPA: reusing previous "
 					   "PMKSA entry");
 				os_free(entry);
+				pmksa_cache_touch(pmksa, pos);
 				return pos;
 			}
-			if (prev == NULL)
-				pmksa->pmksa = pos->next;
-			else
-				prev->next = pos->next;
 			if (pos == pmksa->sm->cur_pmksa) {
 				/* We are about to replace the current PMKSA
 				 * cache entry. This happens when the PMKSA
@@ -190,38 +209,34 @@ pmksa_cache_add(struct rsn_pmksa_cache *pmksa, const u8 *pmk, size_t pmk_len,
 			pmksa_cache_flush(pmksa, network_ctx);
 			break;
 		}
-		prev = pos;
-		pos = pos->next;
 	}
 
-	if (pmksa->pmksa_count >= pmksa_cache_max_entries && pmksa->pmksa) {
-		/* Remove the oldest entry to make room for the new entry */
-		pos = pmksa->pmksa;
-		pmksa->pmksa = pos->next;
-		wpa_printf(MSG_DEBUG, "RSN: removed the oldest PMKSA cache "
-			   "entry (for " MACSTR ") to make room for new one",
-			   MAC2STR(pos->aa));
+	if (pmksa->pmksa_count >= pmksa_cache_max_entries) {
+		/* Remove the least recently used entry to make room for the
+		 * new entry; prefer keeping the one currently in use */
+		pos = dl_list_first(&pmksa->lru, struct rsn_pmksa_cache_entry,
+				    list);
+		if (pos == pmksa->sm->cur_pmksa && pmksa->pmksa_count > 1)
+			pos = dl_list_entry(pos->list.next,
+					    struct rsn_pmksa_cache_entry, list);
+		wpa_printf(MSG_DEBUG, "RSN: removed the least recently used "
+			   "PMKSA cache entry (for " MACSTR ") to make room for "
+			   "new one", MAC2STR(pos->aa));
 		pmksa_cache_free_entry(pmksa, pos, 0);
 	}
 
-	/* Add the new entry; order by expiration time */
-	pos = pmksa->pmksa;
-	prev = NULL;
-	while (pos) {
-		if (pos->expiration > entry->expiration)
-			break;
-		prev = pos;
-		pos = pos->next;
-	}
-	if (prev == NULL) {
-		entry->next = pmksa->pmksa;
-		pmksa->pmksa = entry;
-		pmksa_cache_set_expiration(pmksa);
-	} else {
-		entry->next = prev->next;
-		prev->next = entry;
+	entry->expire.key = entry->expiration;
+	if (heap_insert(&pmksa->expire, &entry->expire) < 0) {
+		os_free(entry);
+		return NULL;
 	}
+	dl_list_add_tail(&pmksa->lru, &entry->list);
+	dl_list_add(&pmksa->pmkid[PMKID_HASH(entry->pmkid)],
+		    &entry->hash_pmkid);
+	dl_list_add(&pmksa->aa[AA_HASH(entry->aa)], &entry->hash_aa);
 	pmksa->pmksa_count++;
+	if (heap_first(&pmksa->expire) == &entry->expire)
+		pmksa_cache_set_expiration(pmksa);
 	wpa_printf(MSG_DEBUG, "RSN: Added PMKSA cache entry for " MACSTR
 		   " network_ctx=%p", MAC2STR(entry->aa), network_ctx);
 	wpa_sm_add_pmkid(pmksa->sm, entry->aa, entry->pmkid);
@@ -237,25 +252,16 @@ pmksa_cache_add(struct rsn_pmksa_cache *pmksa, const u8 *pmk, size_t pmk_len,
  */
 void pmksa_cache_flush(struct rsn_pmksa_cache *pmksa, void *network_ctx)
 {
-	struct rsn_pmksa_cache_entry *entry, *prev = NULL, *tmp;
+	struct rsn_pmksa_cache_entry *entry, *tmp;
 	int removed = 0;
 
-	entry = pmksa->pmksa;
-	while (entry) {
+	dl_list_for_each_safe(entry, tmp, &pmksa->lru,
+			      struct rsn_pmksa_cache_entry, list) {
 		if (entry->network_ctx == network_ctx || network_ctx == NULL) {
 			wpa_printf(MSG_DEBUG, "RSN: Flush PMKSA cache entry "
 				   "for " MACSTR, MAC2STR(entry->aa));
-			if (prev)
-				prev->next = entry->next;
-			else
-				pmksa->pmksa = entry->next;
-			tmp = entry;
-			entry = entry->next;
-			pmksa_cache_free_entry(pmksa, tmp, 0);
+			pmksa_cache_free_entry(pmksa, entry, 0);
 			removed++;
-		} else {
-			prev = entry;
-			entry = entry->next;
 		}
 	}
 	if (removed)
@@ -274,13 +280,10 @@ void pmksa_cache_deinit(struct rsn_pmksa_cache *pmksa)
 	if (pmksa == NULL)
 		return;
 
-	entry = pmksa->pmksa;
-	pmksa->pmksa = NULL;
-	while (entry) {
-		prev = entry;
-		entry = entry->next;
-		os_free(prev);
-	}
+	heap_deinit(&pmksa->expire);
+	dl_list_for_each_safe(entry, prev, &pmksa->lru,
+			      struct rsn_pmksa_cache_entry, list)
+		os_free(entry);
 	pmksa_cache_set_expiration(pmksa);
 	os_free(pmksa);
 }
@@ -298,16 +301,39 @@ struct rsn_pmksa_cache_entry * pmksa_cache_get(struct rsn_pmksa_cache *pmksa,
 					       const u8 *aa, const u8 *pmkid,
 					       const void *network_ctx)
 {
-	struct rsn_pmksa_cache_entry *entry = pmksa->pmksa;
-	while (entry) {
-		if ((aa == NULL || os_memcmp(entry->aa, aa, ETH_ALEN) == 0) &&
-		    (pmkid == NULL ||
-		     os_memcmp(entry->pmkid, pmkid, PMKID_LEN) == 0) &&
-		    (network_ctx == NULL || network_ctx == entry->network_ctx))
-			return entry;
-		entry = entry->next;
+	struct rsn_pmksa_cache_entry *entry;
+
+	if (pmkid) {
+		dl_list_for_each(entry, &pmksa->pmkid[PMKID_HASH(pmkid)],
+				 struct rsn_pmksa_cache_entry, hash_pmkid) {
+			if ((aa == NULL ||
+			     os_memcmp(entry->aa, aa, ETH_ALEN) == 0) &&
+			    os_memcmp(entry->pmkid, pmkid, PMKID_LEN) == 0 &&
+			    (network_ctx == NULL ||
+			     network_ctx == entry->network_ctx))
+				goto found;
+		}
+	} else if (aa) {
+		dl_list_for_each(entry, &pmksa->aa[AA_HASH(aa)],
+				 struct rsn_pmksa_cache_entry, hash_aa) {
+			if (os_memcmp(entry->aa, aa, ETH_ALEN) == 0 &&
+			    (network_ctx == NULL ||
+			     network_ctx == entry->network_ctx))
+				goto found;
+		}
+	} else {
+		dl_list_for_each(entry, &pmksa->lru,
+				 struct rsn_pmksa_cache_entry, list) {
+			if (network_ctx == NULL ||
+			    network_ctx == entry->network_ctx)
+				goto found;
+		}
 	}
 	return NULL;
+
+found:
+	pmksa_cache_touch(pmksa, entry);
+	return entry;
 }
 
 
@@ -324,8 +350,10 @@ pmksa_cache_clone_entry(struct rsn_pmksa_cache *pmksa,
 	if (new_entry == NULL)
 		return NULL;
 
-	/* TODO: reorder entries based on expiration time? */
 	new_entry->expiration = old_entry->expiration;
+	new_entry->expire.key = new_entry->expiration;
+	heap_update(&pmksa->expire, &new_entry->expire);
+	pmksa_cache_set_expiration(pmksa);
 	new_entry->opportunistic = 1;
 
 	return new_entry;
@@ -347,12 +375,14 @@ struct rsn_pmksa_cache_entry *
 pmksa_cache_get_opportunistic(struct rsn_pmksa_cache *pmksa, void *network_ctx,
 			      const u8 *aa)
 {
-	struct rsn_pmksa_cache_entry *entry = pmksa->pmksa;
+	struct rsn_pmksa_cache_entry *entry;
 
 	wpa_printf(MSG_DEBUG, "RSN: Consider " MACSTR " for OKC", MAC2STR(aa));
 	if (network_ctx == NULL)
 		return NULL;
-	while (entry) {
+	/* Most recently used entry first */
+	dl_list_for_each_reverse(entry, &pmksa->lru,
+				 struct rsn_pmksa_cache_entry, list) {
 		if (entry->network_ctx == network_ctx) {
 			entry = pmksa_cache_clone_entry(pmksa, entry, aa);
 			if (entry) {
@@ -362,7 +392,6 @@ pmksa_cache_get_opportunistic(struct rsn_pmksa_cache *pmksa, void *network_ctx,
 			}
 			return entry;
 		}
-		entry = entry->next;
 	}
 	return NULL;
 }
@@ -452,9 +481,9 @@ int pmksa_cache_list(struct rsn_pmksa_cache *pmksa, char *buf, size_t len)
 	int i, ret;
 	char *pos = buf;
 	struct rsn_pmksa_cache_entry *entry;
-	struct os_time now;
+	struct os_reltime now;
 
-	os_get_time(&now);
+	os_get_reltime(&now);
 	ret = os_snprintf(pos, buf + len - pos,
 			  "Index / AA / PMKID / expiration (in seconds) / "
 			  "opportunistic\n");
@@ -462,8 +491,8 @@ int pmksa_cache_list(struct rsn_pmksa_cache *pmksa, char *buf, size_t len)
 		return pos - buf;
 	pos += ret;
 	i = 0;
-	entry = pmksa->pmksa;
-	while (entry) {
+	dl_list_for_each(entry, &pmksa->lru, struct rsn_pmksa_cache_entry,
+			 list) {
 		i++;
 		ret = os_snprintf(pos, buf + len - pos, "%d " MACSTR " ",
 				  i, MAC2STR(entry->aa));
@@ -478,7 +507,6 @@ int pmksa_cache_list(struct rsn_pmksa_cache *pmksa, char *buf, size_t len)
 		if (ret < 0 || ret >= buf + len - pos)
 			return pos - buf;
 		pos += ret;
-		entry = entry->next;
 	}
 	return pos - buf;
 }
@@ -497,9 +525,16 @@ pmksa_cache_init(void (*free_cb)(struct rsn_pmksa_cache_entry *entry,
 		 void *ctx, struct wpa_sm *sm)
 {
 	struct rsn_pmksa_cache *pmksa;
+	int i;
 
 	pmksa = os_zalloc(sizeof(*pmksa));
 	if (pmksa) {
+		for (i = 0; i < PMKSA_HASH_SIZE; i++) {
+			dl_list_init(&pmksa->pmkid[i]);
+			dl_list_init(&pmksa->aa[i]);
+		}
+		dl_list_init(&pmksa->lru);
+		heap_init(&pmksa->expire);
 		pmksa->free_cb = free_cb;
 		pmksa->ctx = ctx;
 		pmksa->sm = sm;
@@ -9,11 +9,17 @@
 #ifndef PMKSA_CACHE_H
 #define PMKSA_CACHE_H
 
+#include "utils/list.h"
+#include "utils/heap.h"
+
 /**
  * struct rsn_pmksa_cache_entry - PMKSA cache entry
  */
 struct rsn_pmksa_cache_entry {
-	struct rsn_pmksa_cache_entry *next;
+	struct dl_list list; /* LRU order; least recently used first */
+	struct dl_list hash_pmkid;
+	struct dl_list hash_aa;
+	struct heap_node expire; /* key = expiration */
 	u8 pmkid[PMKID_LEN];
 	u8 pmk[PMK_LEN];
 	size_t pmk_len;
@@ -7,6 +7,9 @@
  */
 
 #include "includes.h"
+#ifdef CONFIG_TLS_THREADS
+#include <pthread.h>
+#endif /* CONFIG_TLS_THREADS */
 
 #include "common.h"
 #include "bignum.h"
@@ -18,6 +21,95 @@
 #endif /* CONFIG_INTERNAL_LIBTOMMATH */
 
 
+#ifdef BN_MP_EXPTMOD_COMB_C
+
+/*
+ * Fixed-base tables are only built for short bases (DH generators) with long
+ * moduli; RSA and DH shared secret derivation use a different base each time.
+ * Entries are never replaced, so a table can be used without holding the lock
+ * once it has been looked up.
+ */
+#define BIGNUM_COMB_CACHE_SIZE 4
+#define BIGNUM_COMB_MAX_BASE_BITS 64
+#define BIGNUM_COMB_MIN_MOD_BITS 768
+
+struct bignum_comb_entry {
+	mp_int base;
+	mp_int modulus;
+	mp_comb *comb; /* NULL if the table could not be built */
+};
+
+static struct bignum_comb_entry comb_cache[BIGNUM_COMB_CACHE_SIZE];
+static int comb_cache_used;
+
+#ifdef CONFIG_TLS_THREADS
+/* DH may be computed in TLS handshake worker threads */
+static pthread_mutex_t comb_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+#define COMB_CACHE_LOCK() pthread_mutex_lock(&comb_cache_lock)
+#define COMB_CACHE_UNLOCK() pthread_mutex_unlock(&comb_cache_lock)
+#else /* CONFIG_TLS_THREADS */
+#define COMB_CACHE_LOCK() do { } while (0)
+#define COMB_CACHE_UNLOCK() do { } while (0)
+#endif /* CONFIG_TLS_THREADS */
+
+
+static mp_comb * bignum_comb_get(mp_int *base, mp_int *modulus)
+{
+	struct bignum_comb_entry *e;
+	mp_comb *comb;
+	int i, bits;
+
+	if (mp_count_bits(base) > BIGNUM_COMB_MAX_BASE_BITS)
+		return NULL;
+	bits = mp_count_bits(modulus);
+	if (bits < BIGNUM_COMB_MIN_MOD_BITS)
+		return NULL;
+
+	COMB_CACHE_LOCK();
+	for (i = 0; i < comb_cache_used; i++) {
+		e = &comb_cache[i];
+		if (mp_cmp(&e->base, base) == MP_EQ &&
+		    mp_cmp(&e->modulus, modulus) == MP_EQ) {
+			COMB_CACHE_UNLOCK();
+			return e->comb;
+		}
+	}
+
+	if (comb_cache_used == BIGNUM_COMB_CACHE_SIZE) {
+		COMB_CACHE_UNLOCK();
+		return NULL;
+	}
+
+	e = &comb_cache[comb_cache_used];
+	if (mp_init_copy(&e->base, base) != MP_OKAY) {
+		COMB_CACHE_UNLOCK();
+		return NULL;
+	}
+	if (mp_init_copy(&e->modulus, modulus) != MP_OKAY) {
+		mp_clear(&e->base);
+		COMB_CACHE_UNLOCK();
+		return NULL;
+	}
+
+	/* Exponents longer than the modulus fall back to mp_exptmod() */
+	comb = os_zalloc(sizeof(*comb));
+	if (comb && mp_comb_init(comb, base, modulus, bits) != MP_OKAY) {
+		os_free(comb);
+		comb = NULL;
+	}
+	e->comb = comb;
+	comb_cache_used++;
+	COMB_CACHE_UNLOCK();
+
+	wpa_printf(MSG_DEBUG, "BIGNUM: %s fixed-base table for %d-bit modulus",
+		   comb ? "Precomputed" : "Could not build", bits);
+
+	return comb;
+}
+
+#endif /* BN_MP_EXPTMOD_COMB_C */
+
+
 /*
  * The current version is just a wrapper for LibTomMath library, so
  * struct bignum is just typecast to mp_int.
@@ -215,6 +307,13 @@ int bignum_mulmod(const struct bignum *a, const struct bignum *b,
 int bignum_exptmod(const struct bignum *a, const struct bignum *b,
 		   const struct bignum *c, struct bignum *d)
 {
+#ifdef BN_MP_EXPTMOD_COMB_C
+	mp_comb *comb = bignum_comb_get((mp_int *) a, (mp_int *) c);
+	if (comb && mp_exptmod_comb(comb, (mp_int *) b, (mp_int *) d) ==
+	    MP_OKAY)
+		return 0;
+#endif /* BN_MP_EXPTMOD_COMB_C */
+
 	if (mp_exptmod((mp_int *) a, (mp_int *) b, (mp_int *) c, (mp_int *) d)
 	    != MP_OKAY) {
 		wpa_printf(MSG_DEBUG, "BIGNUM: %s failed", __func__);
@@ -222,3 +321,29 @@ int bignum_exptmod(const struct bignum *a, const struct bignum *b,
 	}
 	return 0;
 }
+
+
+/**
+ * bignum_global_deinit - Free cached bignum precomputation
+ *
+ * With the fast internal LibTomMath, bignum_exptmod() keeps fixed-base tables
+ * for DH generators. This function frees them; it must not be called while
+ * other threads may be using bignum functions.
+ */
+void bignum_global_deinit(void)
+{
+#ifdef BN_MP_EXPTMOD_COMB_C
+	int i;
+
+	for (i = 0; i < comb_cache_used; i++) {
+		mp_clear(&comb_cache[i].base);
+		mp_clear(&comb_cache[i].modulus);
+		if (comb_cache[i].comb) {
+			mp_comb_clear(comb_cache[i].comb);
+			os_free(comb_cache[i].comb);
+		}
+	}
+	os_memset(comb_cache, 0, sizeof(comb_cache));
+	comb_cache_used = 0;
+#endif /* BN_MP_EXPTMOD_COMB_C */
+}
@@ -28,5 +28,6 @@ int bignum_mulmod(const struct bignum *a, const struct bignum *b,
 		  const struct bignum *c, struct bignum *d);
 int bignum_exptmod(const struct bignum *a, const struct bignum *b,
 		   const struct bignum *c, struct bignum *d);
+void bignum_global_deinit(void);
 
 #endif /* BIGNUM_H */
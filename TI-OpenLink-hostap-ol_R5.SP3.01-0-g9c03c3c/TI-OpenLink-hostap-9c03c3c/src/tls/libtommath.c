@@ -42,6 +42,11 @@
 /* Include faster sqr at the cost of about 0.5 kB in code */
 #define BN_FAST_S_MP_SQR_C
 
+/* Include fixed-base comb exptmod (used for DH generators) at the cost of
+ * about 1 kB in code; each precomputed table takes 64 values of the modulus
+ * size */
+#define BN_MP_EXPTMOD_COMB_C
+
 #else /* LTM_FAST */
 
 #define BN_MP_DIV_SMALL
@@ -105,7 +110,9 @@ typedef u64 mp_word;
 typedef int           mp_err;
 
 /* define this to use lower memory usage routines (exptmods mostly) */
+#ifndef LTM_FAST
 #define MP_LOW_MEM
+#endif /* LTM_FAST */
 
 /* default precision */
 #ifndef MP_PREC
@@ -3387,3 +3394,169 @@ mp_mul_d (mp_int * a, mp_digit b, mp_int * c)
   return MP_OKAY;
 }
 #endif
+
+
+#ifdef BN_MP_EXPTMOD_COMB_C
+/* fixed-base exponentiation with a precomputed comb, HAC pp.625, Algorithm 14.117
+ *
+ * The exponent is split into MP_COMB_TEETH rows of "span" bits each and the
+ * products of G**(2**(i*span)) for all 2**MP_COMB_TEETH row combinations are
+ * stored in Montgomery form.  An exponentiation then only needs "span"
+ * squarings and at most "span" multiplications, i.e., roughly a third of the
+ * work of the sliding window in mp_exptmod_fast() for a full size exponent.
+ * This pays off when the same base is used with many exponents (DH generator).
+ */
+#define MP_COMB_TEETH 6
+#define MP_COMB_SIZE  (1 << MP_COMB_TEETH)
+
+typedef struct {
+  mp_int   P, T[MP_COMB_SIZE];
+  mp_digit mp;
+  int      span;
+} mp_comb;
+
+static void mp_comb_clear (mp_comb * C)
+{
+  int x;
+
+  mp_clear (&C->P);
+  for (x = 0; x < MP_COMB_SIZE; x++) {
+    mp_clear (&C->T[x]);
+  }
+}
+
+
+/* build the comb for base G modulo odd P for exponents of up to "bits" bits */
+static int mp_comb_init (mp_comb * C, mp_int * G, mp_int * P, int bits)
+{
+  int     err, x, y;
+
+  /* the comba Montgomery reduction is used for everything */
+  if (mp_iseven (P) == MP_YES || bits < 1 ||
+      (P->used * 2 + 1) >= MP_WARRAY ||
+      P->used >= (1 << ((CHAR_BIT * sizeof (mp_word)) - (2 * DIGIT_BIT)))) {
+    return MP_VAL;
+  }
+
+  if ((err = mp_init_copy (&C->P, P)) != MP_OKAY) {
+    return err;
+  }
+  for (x = 0; x < MP_COMB_SIZE; x++) {
+    if ((err = mp_init_size (&C->T[x], P->used * 2 + 1)) != MP_OKAY) {
+      for (y = 0; y < x; y++) {
+        mp_clear (&C->T[y]);
+      }
+      mp_clear (&C->P);
+      return err;
+    }
+  }
+
+  C->span = (bits + MP_COMB_TEETH - 1) / MP_COMB_TEETH;
+  if ((err = mp_montgomery_setup (P, &C->mp)) != MP_OKAY) {
+    goto LBL_ERR;
+  }
+
+  /* T[0] = R mod P is one in Montgomery form, T[1] = G * R mod P */
+  if ((err = mp_montgomery_calc_normalization (&C->T[0], P)) != MP_OKAY) {
+    goto LBL_ERR;
+  }
+  if ((err = mp_mulmod (G, &C->T[0], P, &C->T[1])) != MP_OKAY) {
+    goto LBL_ERR;
+  }
+
+  /* T[2**x] = T[2**(x-1)]**(2**span) */
+  for (x = 1; x < MP_COMB_TEETH; x++) {
+    if ((err = mp_copy (&C->T[1 << (x - 1)], &C->T[1 << x])) != MP_OKAY) {
+      goto LBL_ERR;
+    }
+    for (y = 0; y < C->span; y++) {
+      if ((err = mp_sqr (&C->T[1 << x], &C->T[1 << x])) != MP_OKAY) {
+        goto LBL_ERR;
+      }
+      if ((err = fast_mp_montgomery_reduce (&C->T[1 << x], P, C->mp)) != MP_OKAY) {
+        goto LBL_ERR;
+      }
+    }
+  }
+
+  /* the other entries are products of the lowest set bit and the rest */
+  for (x = 3; x < MP_COMB_SIZE; x++) {
+    if ((x & (x - 1)) == 0) {
+      continue;
+    }
+    if ((err = mp_mul (&C->T[x & (x - 1)], &C->T[x & -x], &C->T[x])) != MP_OKAY) {
+      goto LBL_ERR;
+    }
+    if ((err = fast_mp_montgomery_reduce (&C->T[x], P, C->mp)) != MP_OKAY) {
+      goto LBL_ERR;
+    }
+  }
+
+  return MP_OKAY;
+
+LBL_ERR:
+  mp_comb_clear (C);
+  return err;
+}
+
+
+/* computes Y == G**X mod P using the comb from mp_comb_init() */
+static int mp_exptmod_comb (mp_comb * C, mp_int * X, mp_int * Y)
+{
+  mp_int  res;
+  int     err, x, k, idx, bit;
+
+  if (X->sign == MP_NEG || mp_count_bits (X) > C->span * MP_COMB_TEETH) {
+    return MP_VAL;
+  }
+
+  if ((err = mp_init_size (&res, C->P.used * 2 + 1)) != MP_OKAY) {
+    return err;
+  }
+  if ((err = mp_copy (&C->T[0], &res)) != MP_OKAY) {
+    goto LBL_RES;
+  }
+
+  for (k = C->span - 1; k >= 0; k--) {
+    if (k != C->span - 1) {
+      if ((err = mp_sqr (&res, &res)) != MP_OKAY) {
+        goto LBL_RES;
+      }
+      if ((err = fast_mp_montgomery_reduce (&res, &C->P, C->mp)) != MP_OKAY) {
+        goto LBL_RES;
+      }
+    }
+
+    /* gather bit k of each row */
+    idx = 0;
+    for (x = 0; x < MP_COMB_TEETH; x++) {
+      bit = x * C->span + k;
+      if (bit / DIGIT_BIT < X->used &&
+          ((X->dp[bit / DIGIT_BIT] >> ((mp_digit) (bit % DIGIT_BIT))) & 1)) {
+        idx |= 1 << x;
+      }
+    }
+    if (idx == 0) {
+      continue;
+    }
+
+    if ((err = mp_mul (&res, &C->T[idx], &res)) != MP_OKAY) {
+      goto LBL_RES;
+    }
+    if ((err = fast_mp_montgomery_reduce (&res, &C->P, C->mp)) != MP_OKAY) {
+      goto LBL_RES;
+    }
+  }
+
+  /* get out of Montgomery form */
+  if ((err = fast_mp_montgomery_reduce (&res, &C->P, C->mp)) != MP_OKAY) {
+    goto LBL_RES;
+  }
+
+  mp_exch (&res, Y);
+  err = MP_OKAY;
+LBL_RES:
+  mp_clear (&res);
+  return err;
+}
+#endif
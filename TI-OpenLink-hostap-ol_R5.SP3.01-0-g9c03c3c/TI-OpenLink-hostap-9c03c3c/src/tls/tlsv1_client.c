@@ -11,6 +11,7 @@
 #include "common.h"
 #include "crypto/sha1.h"
 #include "crypto/tls.h"
+#include "bignum.h"
 #include "tlsv1_common.h"
 #include "tlsv1_record.h"
 #include "tlsv1_client.h"
@@ -430,6 +431,7 @@ int tlsv1_client_global_init(void)
  */
 void tlsv1_client_global_deinit(void)
 {
+	bignum_global_deinit();
 	crypto_global_deinit();
 }
 
@@ -11,6 +11,7 @@
 #include "common.h"
 #include "crypto/sha1.h"
 #include "crypto/tls.h"
+#include "bignum.h"
 #include "tlsv1_common.h"
 #include "tlsv1_record.h"
 #include "tlsv1_server.h"
@@ -329,6 +330,7 @@ int tlsv1_server_global_init(void)
  */
 void tlsv1_server_global_deinit(void)
 {
+	bignum_global_deinit();
 	crypto_global_deinit();
 }
 
@@ -1,5 +1,5 @@
 /*
- * Event loop based on select() loop
+ * Event loop based on select(), poll(), or epoll() loop
  * Copyright (c) 2002-2009, Jouni Malinen <j@w1.fi>
  *
  * This software may be distributed under the terms of the BSD license.
@@ -11,13 +11,23 @@
 #include "common.h"
 #include "trace.h"
 #include "list.h"
+#include "heap.h"
 #include "eloop.h"
 
+#if defined(CONFIG_ELOOP_POLL) && defined(CONFIG_ELOOP_EPOLL)
+#error Do not define both of poll and epoll
+#endif
+
 #ifdef CONFIG_ELOOP_POLL
 #include <assert.h>
 #include <poll.h>
 #endif /* CONFIG_ELOOP_POLL */
 
+#ifdef CONFIG_ELOOP_EPOLL
+#include <sys/epoll.h>
+#include <poll.h>
+#endif /* CONFIG_ELOOP_EPOLL */
+
 
 struct eloop_sock {
 	int sock;
@@ -30,8 +40,10 @@ struct eloop_sock {
 };
 
 struct eloop_timeout {
-	struct dl_list list;
-	struct os_time time;
+	struct dl_list hash_list;
+	struct heap_node node;
+	unsigned int seq;
+	struct os_reltime time;
 	void *eloop_data;
 	void *user_data;
 	eloop_timeout_handler handler;
@@ -50,9 +62,20 @@ struct eloop_signal {
 struct eloop_sock_table {
 	int count;
 	struct eloop_sock *table;
+	eloop_event_type type;
 	int changed;
 };
 
+#ifdef CONFIG_ELOOP_EPOLL
+struct eloop_epoll_fd {
+	u32 events; /* EPOLL* mask currently registered for the fd */
+	struct eloop_sock sock[3]; /* indexed by eloop_event_type */
+};
+#endif /* CONFIG_ELOOP_EPOLL */
+
+/* Initial number of timeout hash buckets; must be a power of two */
+#define ELOOP_TIMEOUT_HASH_SIZE 64
+
 struct eloop_data {
 	int max_sock;
 
@@ -63,11 +86,26 @@ struct eloop_data {
 	struct pollfd *pollfds;
 	struct pollfd **pollfds_map;
 #endif /* CONFIG_ELOOP_POLL */
+#ifdef CONFIG_ELOOP_EPOLL
+	int epollfd;
+	int max_fd; /* number of fd_table entries currently allocated */
+	struct eloop_epoll_fd *fd_table;
+	int epoll_max_event_num;
+	struct epoll_event *epoll_events;
+#endif /* CONFIG_ELOOP_EPOLL */
 	struct eloop_sock_table readers;
 	struct eloop_sock_table writers;
 	struct eloop_sock_table exceptions;
 
-	struct dl_list timeout;
+	/*
+	 * Registered timeouts are kept in a binary min-heap ordered by expiry
+	 * time (ties broken by registration order) and in a hash table keyed
+	 * by (handler, eloop_data, user_data) for fast cancellation.
+	 */
+	struct heap timeouts;
+	struct dl_list *timeout_hash;
+	unsigned int timeout_hash_size;
+	unsigned int timeout_seq;
 
 	int signal_count;
 	struct eloop_signal *signals;
@@ -124,10 +162,48 @@ static void eloop_trace_sock_remove_ref(struct eloop_sock_table *table)
 #endif /* WPA_TRACE */
 
 
+static int eloop_timeout_before(const struct heap_node *a,
+				const struct heap_node *b)
+{
+	struct eloop_timeout *ta, *tb;
+
+	ta = heap_entry(a, struct eloop_timeout, node);
+	tb = heap_entry(b, struct eloop_timeout, node);
+	if (os_reltime_before(&ta->time, &tb->time))
+		return 1;
+	if (os_reltime_before(&tb->time, &ta->time))
+		return 0;
+	/* Same expiry time: preserve registration order */
+	return (int) (ta->seq - tb->seq) < 0;
+}
+
+
 int eloop_init(void)
 {
+	unsigned int i;
+
 	os_memset(&eloop, 0, sizeof(eloop));
-	dl_list_init(&eloop.timeout);
+	heap_init_cmp(&eloop.timeouts, eloop_timeout_before);
+	eloop.timeout_hash = os_malloc(ELOOP_TIMEOUT_HASH_SIZE *
+				       sizeof(struct dl_list));
+	if (eloop.timeout_hash == NULL)
+		return -1;
+	eloop.timeout_hash_size = ELOOP_TIMEOUT_HASH_SIZE;
+	for (i = 0; i < eloop.timeout_hash_size; i++)
+		dl_list_init(&eloop.timeout_hash[i]);
+#ifdef CONFIG_ELOOP_EPOLL
+	eloop.epollfd = epoll_create(1);
+	if (eloop.epollfd < 0) {
+		wpa_printf(MSG_ERROR, "%s: epoll_create failed: %s",
+			   __func__, strerror(errno));
+		os_free(eloop.timeout_hash);
+		eloop.timeout_hash = NULL;
+		return -1;
+	}
+#endif /* CONFIG_ELOOP_EPOLL */
+	eloop.readers.type = EVENT_TYPE_READ;
+	eloop.writers.type = EVENT_TYPE_WRITE;
+	eloop.exceptions.type = EVENT_TYPE_EXCEPTION;
 #ifdef WPA_TRACE
 	signal(SIGSEGV, eloop_sigsegv_handler);
 #endif /* WPA_TRACE */
@@ -135,6 +211,69 @@ int eloop_init(void)
 }
 
 
+#ifdef CONFIG_ELOOP_EPOLL
+
+static int eloop_epoll_update(int sock)
+{
+	struct eloop_epoll_fd *fd = &eloop.fd_table[sock];
+	struct epoll_event ev;
+	u32 events = 0;
+	int op, ret;
+
+	if (fd->sock[EVENT_TYPE_READ].handler)
+		events |= EPOLLIN;
+	if (fd->sock[EVENT_TYPE_WRITE].handler)
+		events |= EPOLLOUT;
+	/*
+	 * EPOLLERR and EPOLLHUP are always reported. Set EPOLLIN for a socket
+	 * that was registered only for exception handling to match the
+	 * behavior of the poll() variant.
+	 */
+	if (fd->sock[EVENT_TYPE_EXCEPTION].handler && events == 0)
+		events |= EPOLLIN;
+
+	if (events == fd->events)
+		return 0;
+
+	if (events == 0)
+		op = EPOLL_CTL_DEL;
+	else if (fd->events == 0)
+		op = EPOLL_CTL_ADD;
+	else
+		op = EPOLL_CTL_MOD;
+
+	os_memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.fd = sock;
+	ret = epoll_ctl(eloop.epollfd, op, sock, &ev);
+	if (ret < 0 && op == EPOLL_CTL_MOD && errno == ENOENT) {
+		/*
+		 * The fd was closed while it was still registered, so close()
+		 * removed it from the epoll set, and the number has now been
+		 * reused for a new socket.
+		 */
+		op = EPOLL_CTL_ADD;
+		ret = epoll_ctl(eloop.epollfd, op, sock, &ev);
+	}
+	if (ret < 0 && op == EPOLL_CTL_DEL) {
+		/* The fd is not in the epoll set anymore in any case */
+		fd->events = 0;
+		if (errno == ENOENT || errno == EBADF)
+			return 0; /* closed before being unregistered */
+	}
+	if (ret < 0) {
+		wpa_printf(MSG_ERROR, "%s: epoll_ctl(%d) for fd %d failed: %s",
+			   __func__, op, sock, strerror(errno));
+		return -1;
+	}
+	fd->events = events;
+
+	return 0;
+}
+
+#endif /* CONFIG_ELOOP_EPOLL */
+
+
 static int eloop_sock_table_add_sock(struct eloop_sock_table *table,
                                      int sock, eloop_sock_handler handler,
                                      void *eloop_data, void *user_data)
@@ -173,6 +312,35 @@ static int eloop_sock_table_add_sock(struct eloop_sock_table *table,
 		eloop.pollfds = n;
 	}
 #endif /* CONFIG_ELOOP_POLL */
+#ifdef CONFIG_ELOOP_EPOLL
+	if (sock < 0)
+		return -1;
+	if (new_max_sock >= eloop.max_fd) {
+		struct eloop_epoll_fd *nfd;
+		int nmax = new_max_sock + 50;
+		nfd = os_realloc(eloop.fd_table,
+				 sizeof(struct eloop_epoll_fd) * nmax);
+		if (nfd == NULL)
+			return -1;
+		os_memset(&nfd[eloop.max_fd], 0,
+			  sizeof(struct eloop_epoll_fd) *
+			  (nmax - eloop.max_fd));
+		eloop.max_fd = nmax;
+		eloop.fd_table = nfd;
+	}
+
+	if (eloop.count + 1 > eloop.epoll_max_event_num) {
+		struct epoll_event *n;
+		int nmax = eloop.count + 1 + 50;
+		n = os_realloc(eloop.epoll_events,
+			       sizeof(struct epoll_event) * nmax);
+		if (n == NULL)
+			return -1;
+
+		eloop.epoll_max_event_num = nmax;
+		eloop.epoll_events = n;
+	}
+#endif /* CONFIG_ELOOP_EPOLL */
 
 	eloop_trace_sock_remove_ref(table);
 	tmp = (struct eloop_sock *)
@@ -186,8 +354,17 @@ static int eloop_sock_table_add_sock(struct eloop_sock_table *table,
 	tmp[table->count].user_data = user_data;
 	tmp[table->count].handler = handler;
 	wpa_trace_record(&tmp[table->count]);
-	table->count++;
 	table->table = tmp;
+#ifdef CONFIG_ELOOP_EPOLL
+	eloop.fd_table[sock].sock[table->type] = tmp[table->count];
+	if (eloop_epoll_update(sock) < 0) {
+		os_memset(&eloop.fd_table[sock].sock[table->type], 0,
+			  sizeof(struct eloop_sock));
+		eloop_trace_sock_add_ref(table);
+		return -1;
+	}
+#endif /* CONFIG_ELOOP_EPOLL */
+	table->count++;
 	eloop.max_sock = new_max_sock;
 	eloop.count++;
 	table->changed = 1;
@@ -221,6 +398,13 @@ static void eloop_sock_table_remove_sock(struct eloop_sock_table *table,
 	eloop.count--;
 	table->changed = 1;
 	eloop_trace_sock_add_ref(table);
+#ifdef CONFIG_ELOOP_EPOLL
+	if (sock < eloop.max_fd) {
+		os_memset(&eloop.fd_table[sock].sock[table->type], 0,
+			  sizeof(struct eloop_sock));
+		eloop_epoll_update(sock);
+	}
+#endif /* CONFIG_ELOOP_EPOLL */
 }
 
 
@@ -362,6 +546,46 @@ static void eloop_sock_table_dispatch(struct eloop_sock_table *readers,
 					max_pollfd_map, POLLERR | POLLHUP);
 }
 
+#elif defined(CONFIG_ELOOP_EPOLL)
+
+static int eloop_epoll_call(int sock, eloop_event_type type)
+{
+	struct eloop_sock *s = &eloop.fd_table[sock].sock[type];
+
+	if (s->handler == NULL)
+		return 0;
+	s->handler(sock, s->eloop_data, s->user_data);
+
+	/* fd_table may have been modified or reallocated by the handler */
+	return eloop.readers.changed || eloop.writers.changed ||
+		eloop.exceptions.changed;
+}
+
+
+static void eloop_sock_table_dispatch(struct epoll_event *events, int nfds)
+{
+	int i, sock;
+
+	eloop.readers.changed = 0;
+	eloop.writers.changed = 0;
+	eloop.exceptions.changed = 0;
+
+	for (i = 0; i < nfds; i++) {
+		sock = events[i].data.fd;
+		if (sock < 0 || sock >= eloop.max_fd)
+			continue;
+		if ((events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) &&
+		    eloop_epoll_call(sock, EVENT_TYPE_READ))
+			break;
+		if ((events[i].events & EPOLLOUT) &&
+		    eloop_epoll_call(sock, EVENT_TYPE_WRITE))
+			break;
+		if ((events[i].events & (EPOLLERR | EPOLLHUP)) &&
+		    eloop_epoll_call(sock, EVENT_TYPE_EXCEPTION))
+			break;
+	}
+}
+
 #else /* CONFIG_ELOOP_POLL */
 
 static void eloop_sock_table_set_fds(struct eloop_sock_table *table,
@@ -474,17 +698,75 @@ void eloop_unregister_sock(int sock, eloop_event_type type)
 }
 
 
+static unsigned int eloop_timeout_hash(eloop_timeout_handler handler,
+				       void *eloop_data, void *user_data)
+{
+	unsigned long h;
+
+	h = (unsigned long) handler;
+	h ^= (unsigned long) eloop_data * 31;
+	h ^= (unsigned long) user_data * 131;
+	h ^= h >> 16;
+	h ^= h >> 8;
+	return (unsigned int) h;
+}
+
+
+static struct dl_list * eloop_timeout_bucket(eloop_timeout_handler handler,
+					     void *eloop_data, void *user_data)
+{
+	unsigned int h = eloop_timeout_hash(handler, eloop_data, user_data);
+	return &eloop.timeout_hash[h & (eloop.timeout_hash_size - 1)];
+}
+
+
+static void eloop_timeout_hash_resize(void)
+{
+	struct dl_list *nhash;
+	unsigned int nsize, i;
+
+	nsize = eloop.timeout_hash_size * 2;
+	nhash = os_malloc(nsize * sizeof(struct dl_list));
+	if (nhash == NULL)
+		return; /* keep using the old table with longer chains */
+	for (i = 0; i < nsize; i++)
+		dl_list_init(&nhash[i]);
+
+	for (i = 0; i < eloop.timeouts.count; i++) {
+		struct eloop_timeout *t = heap_entry(eloop.timeouts.nodes[i],
+						     struct eloop_timeout, node);
+		unsigned int h = eloop_timeout_hash(t->handler, t->eloop_data,
+						    t->user_data);
+		dl_list_add(&nhash[h & (nsize - 1)], &t->hash_list);
+	}
+
+	os_free(eloop.timeout_hash);
+	eloop.timeout_hash = nhash;
+	eloop.timeout_hash_size = nsize;
+}
+
+
+static struct eloop_timeout * eloop_first_timeout(void)
+{
+	struct heap_node *node = heap_first(&eloop.timeouts);
+
+	if (node == NULL)
+		return NULL;
+	return heap_entry(node, struct eloop_timeout, node);
+}
+
+
 int eloop_register_timeout(unsigned int secs, unsigned int usecs,
 			   eloop_timeout_handler handler,
 			   void *eloop_data, void *user_data)
 {
-	struct eloop_timeout *timeout, *tmp;
+	struct eloop_timeout *timeout;
 	os_time_t now_sec;
 
 	timeout = os_zalloc(sizeof(*timeout));
 	if (timeout == NULL)
 		return -1;
-	if (os_get_time(&timeout->time) < 0) {
+	if (os_get_reltime(&timeout->time) < 0) {
 		os_free(timeout);
 		return -1;
 	}
@@ -508,51 +790,101 @@ int eloop_register_timeout(unsigned int secs, unsigned int usecs,
 	timeout->eloop_data = eloop_data;
 	timeout->user_data = user_data;
 	timeout->handler = handler;
+	timeout->seq = eloop.timeout_seq++;
+
+	if (eloop.timeouts.count >= 2 * eloop.timeout_hash_size)
+		eloop_timeout_hash_resize();
+	if (heap_insert(&eloop.timeouts, &timeout->node) < 0) {
+		os_free(timeout);
+		return -1;
+	}
 	wpa_trace_add_ref(timeout, eloop, eloop_data);
 	wpa_trace_add_ref(timeout, user, user_data);
 	wpa_trace_record(timeout);
 
-	/* Maintain timeouts in order of increasing time */
-	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
-		if (os_time_before(&timeout->time, &tmp->time)) {
-			dl_list_add(tmp->list.prev, &timeout->list);
-			return 0;
-		}
-	}
-	dl_list_add_tail(&eloop.timeout, &timeout->list);
+	dl_list_add(eloop_timeout_bucket(handler, eloop_data, user_data),
+		    &timeout->hash_list);
 
 	return 0;
 }
 
 
-static void eloop_remove_timeout(struct eloop_timeout *timeout)
+static void eloop_free_timeout(struct eloop_timeout *timeout)
 {
-	dl_list_del(&timeout->list);
+	dl_list_del(&timeout->hash_list);
 	wpa_trace_remove_ref(timeout, eloop, timeout->eloop_data);
 	wpa_trace_remove_ref(timeout, user, timeout->user_data);
 	os_free(timeout);
 }
 
 
+static void eloop_remove_timeout(struct eloop_timeout *timeout)
+{
+	heap_remove(&eloop.timeouts, &timeout->node);
+	eloop_free_timeout(timeout);
+}
+
+
+static int eloop_timeout_match(struct eloop_timeout *timeout,
+			       eloop_timeout_handler handler,
+			       void *eloop_data, void *user_data)
+{
+	return timeout->handler == handler &&
+		(timeout->eloop_data == eloop_data ||
+		 eloop_data == ELOOP_ALL_CTX) &&
+		(timeout->user_data == user_data ||
+		 user_data == ELOOP_ALL_CTX);
+}
+
+
+struct eloop_timeout_match_ctx {
+	eloop_timeout_handler handler;
+	void *eloop_data;
+	void *user_data;
+};
+
+
+static int eloop_timeout_remove_match(struct heap_node *node, void *ctx)
+{
+	struct eloop_timeout_match_ctx *m = ctx;
+	struct eloop_timeout *timeout;
+
+	timeout = heap_entry(node, struct eloop_timeout, node);
+	if (!eloop_timeout_match(timeout, m->handler, m->eloop_data,
+				 m->user_data))
+		return 0;
+	eloop_free_timeout(timeout);
+	return 1;
+}
+
+
 int eloop_cancel_timeout(eloop_timeout_handler handler,
 			 void *eloop_data, void *user_data)
 {
 	struct eloop_timeout *timeout, *prev;
+	struct eloop_timeout_match_ctx m;
 	int removed = 0;
 
-	dl_list_for_each_safe(timeout, prev, &eloop.timeout,
-			      struct eloop_timeout, list) {
-		if (timeout->handler == handler &&
-		    (timeout->eloop_data == eloop_data ||
-		     eloop_data == ELOOP_ALL_CTX) &&
-		    (timeout->user_data == user_data ||
-		     user_data == ELOOP_ALL_CTX)) {
-			eloop_remove_timeout(timeout);
-			removed++;
+	if (eloop_data != ELOOP_ALL_CTX && user_data != ELOOP_ALL_CTX) {
+		struct dl_list *bucket;
+		bucket = eloop_timeout_bucket(handler, eloop_data, user_data);
+		dl_list_for_each_safe(timeout, prev, bucket,
+				      struct eloop_timeout, hash_list) {
+			if (eloop_timeout_match(timeout, handler, eloop_data,
+						user_data)) {
+				eloop_remove_timeout(timeout);
+				removed++;
+			}
 		}
+		return removed;
 	}
 
-	return removed;
+	/* Wildcard match cannot use the hash index, so go through all entries */
+	m.handler = handler;
+	m.eloop_data = eloop_data;
+	m.user_data = user_data;
+	return heap_remove_match(&eloop.timeouts, eloop_timeout_remove_match,
+				 &m);
 }
 
 
@@ -560,8 +892,10 @@ int eloop_is_timeout_registered(eloop_timeout_handler handler,
 				void *eloop_data, void *user_data)
 {
 	struct eloop_timeout *tmp;
+	struct dl_list *bucket;
 
-	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
+	bucket = eloop_timeout_bucket(handler, eloop_data, user_data);
+	dl_list_for_each(tmp, bucket, struct eloop_timeout, hash_list) {
 		if (tmp->handler == handler &&
 		    tmp->eloop_data == eloop_data &&
 		    tmp->user_data == user_data)
@@ -684,35 +1018,39 @@ void eloop_run(void)
 #ifdef CONFIG_ELOOP_POLL
 	int num_poll_fds;
 	int timeout_ms = 0;
+#elif defined(CONFIG_ELOOP_EPOLL)
+	int timeout_ms = 0;
 #else /* CONFIG_ELOOP_POLL */
 	fd_set *rfds, *wfds, *efds;
 	struct timeval _tv;
 #endif /* CONFIG_ELOOP_POLL */
 	int res;
-	struct os_time tv, now;
+	struct os_reltime tv, now;
 
-#ifndef CONFIG_ELOOP_POLL
+#if !defined(CONFIG_ELOOP_POLL) && !defined(CONFIG_ELOOP_EPOLL)
 	rfds = os_malloc(sizeof(*rfds));
 	wfds = os_malloc(sizeof(*wfds));
 	efds = os_malloc(sizeof(*efds));
 	if (rfds == NULL || wfds == NULL || efds == NULL)
 		goto out;
-#endif /* CONFIG_ELOOP_POLL */
+#endif /* !CONFIG_ELOOP_POLL && !CONFIG_ELOOP_EPOLL */
 
 	while (!eloop.terminate &&
-	       (!dl_list_empty(&eloop.timeout) || eloop.readers.count > 0 ||
+	       (eloop.timeouts.count > 0 || eloop.readers.count > 0 ||
 		eloop.writers.count > 0 || eloop.exceptions.count > 0)) {
 		struct eloop_timeout *timeout;
-		timeout = dl_list_first(&eloop.timeout, struct eloop_timeout,
-					list);
+		timeout = eloop_first_timeout();
 		if (timeout) {
-			os_get_time(&now);
-			if (os_time_before(&now, &timeout->time))
-				os_time_sub(&timeout->time, &now, &tv);
+			os_reltime_cache(0);
+			os_get_reltime(&now);
+			if (os_reltime_before(&now, &timeout->time))
+				os_reltime_sub(&timeout->time, &now, &tv);
 			else
 				tv.sec = tv.usec = 0;
 #ifdef CONFIG_ELOOP_POLL
 			timeout_ms = tv.sec * 1000 + tv.usec / 1000;
+#elif defined(CONFIG_ELOOP_EPOLL)
+			timeout_ms = tv.sec * 1000 + (tv.usec + 999) / 1000;
 #else /* CONFIG_ELOOP_POLL */
 			_tv.tv_sec = tv.sec;
 			_tv.tv_usec = tv.usec;
@@ -731,6 +1069,21 @@ void eloop_run(void)
 			perror("poll");
 			goto out;
 		}
+#elif defined(CONFIG_ELOOP_EPOLL)
+		if (eloop.count == 0) {
+			/* Nothing to wait for on epollfd; just sleep */
+			res = 0;
+			if (timeout_ms > 0)
+				poll(NULL, 0, timeout_ms);
+		} else {
+			res = epoll_wait(eloop.epollfd, eloop.epoll_events,
+					 eloop.count,
+					 timeout ? timeout_ms : -1);
+		}
+		if (res < 0 && errno != EINTR && errno != 0) {
+			perror("epoll_wait");
+			goto out;
+		}
 #else /* CONFIG_ELOOP_POLL */
 		eloop_sock_table_set_fds(&eloop.readers, rfds);
 		eloop_sock_table_set_fds(&eloop.writers, wfds);
@@ -742,14 +1095,20 @@ void eloop_run(void)
 			goto out;
 		}
 #endif /* CONFIG_ELOOP_POLL */
+
+		/*
+		 * Everything that is processed in this iteration sees the time
+		 * at which the wait ended; timeouts registered by the handlers
+		 * are relative to that.
+		 */
+		os_reltime_cache(1);
 		eloop_process_pending_signals();
 
 		/* check if some registered timeouts have occurred */
-		timeout = dl_list_first(&eloop.timeout, struct eloop_timeout,
-					list);
+		timeout = eloop_first_timeout();
 		if (timeout) {
-			os_get_time(&now);
-			if (!os_time_before(&now, &timeout->time)) {
+			os_get_reltime(&now);
+			if (!os_reltime_before(&now, &timeout->time)) {
 				void *eloop_data = timeout->eloop_data;
 				void *user_data = timeout->user_data;
 				eloop_timeout_handler handler =
@@ -767,6 +1126,8 @@ void eloop_run(void)
 		eloop_sock_table_dispatch(&eloop.readers, &eloop.writers,
 					  &eloop.exceptions, eloop.pollfds_map,
 					  eloop.max_pollfd_map);
+#elif defined(CONFIG_ELOOP_EPOLL)
+		eloop_sock_table_dispatch(eloop.epoll_events, res);
 #else /* CONFIG_ELOOP_POLL */
 		eloop_sock_table_dispatch(&eloop.readers, rfds);
 		eloop_sock_table_dispatch(&eloop.writers, wfds);
@@ -775,11 +1136,12 @@ void eloop_run(void)
 	}
 
 out:
-#ifndef CONFIG_ELOOP_POLL
+	os_reltime_cache(0);
+#if !defined(CONFIG_ELOOP_POLL) && !defined(CONFIG_ELOOP_EPOLL)
 	os_free(rfds);
 	os_free(wfds);
 	os_free(efds);
-#endif /* CONFIG_ELOOP_POLL */
+#endif /* !CONFIG_ELOOP_POLL && !CONFIG_ELOOP_EPOLL */
 	return;
 }
 
@@ -792,13 +1154,13 @@ void eloop_terminate(void)
 
 void eloop_destroy(void)
 {
-	struct eloop_timeout *timeout, *prev;
-	struct os_time now;
+	struct eloop_timeout *timeout;
+	struct os_reltime now;
 
-	os_get_time(&now);
-	dl_list_for_each_safe(timeout, prev, &eloop.timeout,
-			      struct eloop_timeout, list) {
+	os_get_reltime(&now);
+	while ((timeout = eloop_first_timeout())) {
 		int sec, usec;
+		heap_remove(&eloop.timeouts, &timeout->node);
 		sec = timeout->time.sec - now.sec;
 		usec = timeout->time.usec - now.usec;
 		if (timeout->time.usec < now.usec) {
@@ -812,8 +1174,11 @@ void eloop_destroy(void)
 		wpa_trace_dump_funcname("eloop unregistered timeout handler",
 					timeout->handler);
 		wpa_trace_dump("eloop timeout", timeout);
-		eloop_remove_timeout(timeout);
+		eloop_free_timeout(timeout);
 	}
+	heap_deinit(&eloop.timeouts);
+	os_free(eloop.timeout_hash);
+	eloop.timeout_hash = NULL;
 	eloop_sock_table_destroy(&eloop.readers);
 	eloop_sock_table_destroy(&eloop.writers);
 	eloop_sock_table_destroy(&eloop.exceptions);
@@ -823,6 +1188,11 @@ void eloop_destroy(void)
 	os_free(eloop.pollfds);
 	os_free(eloop.pollfds_map);
 #endif /* CONFIG_ELOOP_POLL */
+#ifdef CONFIG_ELOOP_EPOLL
+	os_free(eloop.fd_table);
+	os_free(eloop.epoll_events);
+	close(eloop.epollfd);
+#endif /* CONFIG_ELOOP_EPOLL */
 }
 
 
@@ -834,7 +1204,7 @@ int eloop_terminated(void)
 
 void eloop_wait_for_read_sock(int sock)
 {
-#ifdef CONFIG_ELOOP_POLL
+#if defined(CONFIG_ELOOP_POLL) || defined(CONFIG_ELOOP_EPOLL)
 	struct pollfd pfd;
 
 	if (sock < 0)
@@ -845,7 +1215,7 @@ void eloop_wait_for_read_sock(int sock)
 	pfd.events = POLLIN;
 
 	poll(&pfd, 1, -1);
-#else /* CONFIG_ELOOP_POLL */
+#else /* CONFIG_ELOOP_POLL || CONFIG_ELOOP_EPOLL */
 	fd_set rfds;
 
 	if (sock < 0)
@@ -854,5 +1224,5 @@ void eloop_wait_for_read_sock(int sock)
 	FD_ZERO(&rfds);
 	FD_SET(sock, &rfds);
 	select(sock + 1, &rfds, NULL, NULL, NULL);
-#endif /* CONFIG_ELOOP_POLL */
+#endif /* CONFIG_ELOOP_POLL || CONFIG_ELOOP_EPOLL */
 }
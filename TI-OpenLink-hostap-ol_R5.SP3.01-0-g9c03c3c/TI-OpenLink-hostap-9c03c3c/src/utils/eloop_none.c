@@ -20,7 +20,7 @@ struct eloop_sock {
 };
 
 struct eloop_timeout {
-	struct os_time time;
+	struct os_reltime time;
 	void *eloop_data;
 	void *user_data;
 	void (*handler)(void *eloop_ctx, void *sock_ctx);
@@ -118,7 +118,7 @@ int eloop_register_timeout(unsigned int secs, unsigned int usecs,
 	timeout = (struct eloop_timeout *) malloc(sizeof(*timeout));
 	if (timeout == NULL)
 		return -1;
-	os_get_time(&timeout->time);
+	os_get_reltime(&timeout->time);
 	timeout->time.sec += secs;
 	timeout->time.usec += usecs;
 	while (timeout->time.usec >= 1000000) {
@@ -138,7 +138,7 @@ int eloop_register_timeout(unsigned int secs, unsigned int usecs,
 	prev = NULL;
 	tmp = eloop.timeout;
 	while (tmp != NULL) {
-		if (os_time_before(&timeout->time, &tmp->time))
+		if (os_reltime_before(&timeout->time, &tmp->time))
 			break;
 		prev = tmp;
 		tmp = tmp->next;
@@ -305,14 +305,14 @@ int eloop_register_signal_reconfig(void (*handler)(int sig, void *eloop_ctx,
 void eloop_run(void)
 {
 	int i;
-	struct os_time tv, now;
+	struct os_reltime tv, now;
 
 	while (!eloop.terminate &&
 		(eloop.timeout || eloop.reader_count > 0)) {
 		if (eloop.timeout) {
-			os_get_time(&now);
-			if (os_time_before(&now, &eloop.timeout->time))
-				os_time_sub(&eloop.timeout->time, &now, &tv);
+			os_get_reltime(&now);
+			if (os_reltime_before(&now, &eloop.timeout->time))
+				os_reltime_sub(&eloop.timeout->time, &now, &tv);
 			else
 				tv.sec = tv.usec = 0;
 		}
@@ -329,8 +329,8 @@ void eloop_run(void)
 		if (eloop.timeout) {
 			struct eloop_timeout *tmp;
 
-			os_get_time(&now);
-			if (!os_time_before(&now, &eloop.timeout->time)) {
+			os_get_reltime(&now);
+			if (!os_reltime_before(&now, &eloop.timeout->time)) {
 				tmp = eloop.timeout;
 				eloop.timeout = eloop.timeout->next;
 				tmp->handler(tmp->eloop_data,
@@ -29,7 +29,7 @@ struct eloop_event {
 };
 
 struct eloop_timeout {
-	struct os_time time;
+	struct os_reltime time;
 	void *eloop_data;
 	void *user_data;
 	eloop_timeout_handler handler;
@@ -242,7 +242,7 @@ int eloop_register_timeout(unsigned int secs, unsigned int usecs,
 	timeout = os_malloc(sizeof(*timeout));
 	if (timeout == NULL)
 		return -1;
-	os_get_time(&timeout->time);
+	os_get_reltime(&timeout->time);
 	now_sec = timeout->time.sec;
 	timeout->time.sec += secs;
 	if (timeout->time.sec < now_sec) {
@@ -273,7 +273,7 @@ int eloop_register_timeout(unsigned int secs, unsigned int usecs,
 	prev = NULL;
 	tmp = eloop.timeout;
 	while (tmp != NULL) {
-		if (os_time_before(&timeout->time, &tmp->time))
+		if (os_reltime_before(&timeout->time, &tmp->time))
 			break;
 		prev = tmp;
 		tmp = tmp->next;
@@ -457,7 +457,7 @@ int eloop_register_signal_reconfig(eloop_signal_handler handler,
 
 void eloop_run(void)
 {
-	struct os_time tv, now;
+	struct os_reltime tv, now;
 	DWORD count, ret, timeout, err;
 	size_t i;
 
@@ -466,9 +466,9 @@ void eloop_run(void)
 		eloop.event_count > 0)) {
 		tv.sec = tv.usec = 0;
 		if (eloop.timeout) {
-			os_get_time(&now);
-			if (os_time_before(&now, &eloop.timeout->time))
-				os_time_sub(&eloop.timeout->time, &now, &tv);
+			os_get_reltime(&now);
+			if (os_reltime_before(&now, &eloop.timeout->time))
+				os_reltime_sub(&eloop.timeout->time, &now, &tv);
 		}
 
 		count = 0;
@@ -507,8 +507,8 @@ void eloop_run(void)
 		if (eloop.timeout) {
 			struct eloop_timeout *tmp;
 
-			os_get_time(&now);
-			if (!os_time_before(&now, &eloop.timeout->time)) {
+			os_get_reltime(&now);
+			if (!os_reltime_before(&now, &eloop.timeout->time)) {
 				tmp = eloop.timeout;
 				eloop.timeout = eloop.timeout->next;
 				tmp->handler(tmp->eloop_data,
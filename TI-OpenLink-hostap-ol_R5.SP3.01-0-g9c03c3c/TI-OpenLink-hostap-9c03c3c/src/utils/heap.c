@@ -0,0 +1,186 @@
+/*
+ * Binary min-heap
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * The heap stores pointers to struct heap_node that is embedded in the
+ * caller's data structure (similarly to struct dl_list). Each node records its
+ * own position so that it can be removed or re-sorted in O(log n) time.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "heap.h"
+
+
+static void heap_set(struct heap *heap, unsigned int idx,
+		     struct heap_node *node)
+{
+	heap->nodes[idx] = node;
+	node->pos = idx + 1;
+}
+
+
+static int heap_before(struct heap *heap, const struct heap_node *a,
+		       const struct heap_node *b)
+{
+	if (heap->before)
+		return heap->before(a, b);
+	return a->key < b->key;
+}
+
+
+static void heap_up(struct heap *heap, unsigned int idx)
+{
+	struct heap_node *node = heap->nodes[idx];
+
+	while (idx > 0) {
+		unsigned int parent = (idx - 1) / 2;
+		if (!heap_before(heap, node, heap->nodes[parent]))
+			break;
+		heap_set(heap, idx, heap->nodes[parent]);
+		idx = parent;
+	}
+	heap_set(heap, idx, node);
+}
+
+
+static void heap_down(struct heap *heap, unsigned int idx)
+{
+	struct heap_node *node = heap->nodes[idx];
+
+	for (;;) {
+		unsigned int child = 2 * idx + 1;
+		if (child >= heap->count)
+			break;
+		if (child + 1 < heap->count &&
+		    heap_before(heap, heap->nodes[child + 1],
+				heap->nodes[child]))
+			child++;
+		if (!heap_before(heap, heap->nodes[child], node))
+			break;
+		heap_set(heap, idx, heap->nodes[child]);
+		idx = child;
+	}
+	heap_set(heap, idx, node);
+}
+
+
+/**
+ * heap_deinit - Free memory used by the heap
+ * @heap: Heap from heap_init()
+ *
+ * The nodes themselves are owned by the caller and are not freed.
+ */
+void heap_deinit(struct heap *heap)
+{
+	unsigned int i;
+
+	for (i = 0; i < heap->count; i++)
+		heap->nodes[i]->pos = 0;
+	os_free(heap->nodes);
+	heap->nodes = NULL;
+	heap->count = 0;
+	heap->alloc = 0;
+}
+
+
+/**
+ * heap_insert - Add a node to the heap
+ * @heap: Heap from heap_init()
+ * @node: Node that is not currently in a heap; node->key must be set
+ * Returns: 0 on success, -1 on failure
+ */
+int heap_insert(struct heap *heap, struct heap_node *node)
+{
+	if (heap->count == heap->alloc) {
+		struct heap_node **nodes;
+		unsigned int alloc = heap->alloc ? heap->alloc * 2 : 16;
+		nodes = os_realloc(heap->nodes, alloc * sizeof(*nodes));
+		if (nodes == NULL)
+			return -1;
+		heap->nodes = nodes;
+		heap->alloc = alloc;
+	}
+
+	heap_set(heap, heap->count++, node);
+	heap_up(heap, heap->count - 1);
+	return 0;
+}
+
+
+/**
+ * heap_remove - Remove a node from the heap
+ * @heap: Heap from heap_init()
+ * @node: Node to remove; nothing is done if the node is not in a heap
+ */
+void heap_remove(struct heap *heap, struct heap_node *node)
+{
+	unsigned int idx;
+	struct heap_node *last;
+
+	if (!heap_in_heap(node))
+		return;
+	idx = node->pos - 1;
+	node->pos = 0;
+	last = heap->nodes[--heap->count];
+	if (idx == heap->count)
+		return;
+	heap_set(heap, idx, last);
+	heap_up(heap, idx);
+	heap_down(heap, last->pos - 1);
+}
+
+
+/**
+ * heap_update - Restore heap order after the key of a node was changed
+ * @heap: Heap from heap_init()
+ * @node: Node in the heap
+ */
+void heap_update(struct heap *heap, struct heap_node *node)
+{
+	if (!heap_in_heap(node))
+		return;
+	heap_up(heap, node->pos - 1);
+	heap_down(heap, node->pos - 1);
+}
+
+
+/**
+ * heap_remove_match - Remove all nodes for which a callback returns 1
+ * @heap: Heap from heap_init()
+ * @match: Callback; the node is already out of the heap when this is called,
+ *	so the callback may free a node for which it returns 1
+ * @ctx: Context pointer for the callback
+ * Returns: Number of removed nodes
+ *
+ * This goes through the heap once and restores the heap order afterwards, so
+ * it is faster than calling heap_remove() for each node when many nodes may
+ * match.
+ */
+unsigned int heap_remove_match(struct heap *heap,
+			       int (*match)(struct heap_node *node, void *ctx),
+			       void *ctx)
+{
+	unsigned int i, j, removed;
+
+	for (i = 0, j = 0; i < heap->count; i++) {
+		struct heap_node *node = heap->nodes[i];
+		node->pos = 0;
+		if (match(node, ctx))
+			continue;
+		heap_set(heap, j++, node);
+	}
+	removed = heap->count - j;
+	heap->count = j;
+
+	if (removed) {
+		for (i = heap->count / 2; i > 0; i--)
+			heap_down(heap, i - 1);
+	}
+
+	return removed;
+}
@@ -0,0 +1,84 @@
+/*
+ * Binary min-heap
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef HEAP_H
+#define HEAP_H
+
+/**
+ * struct heap_node - Heap node embedded in the stored item
+ * @key: Sort key (e.g., expiration time); smallest key is on top unless the
+ *	heap was initialized with heap_init_cmp()
+ * @pos: Index in the heap array plus one; 0 if the node is not in a heap
+ *
+ * Nodes with equal keys are not kept in insertion order.
+ */
+struct heap_node {
+	os_time_t key;
+	unsigned int pos;
+};
+
+/**
+ * struct heap - Binary min-heap of struct heap_node pointers
+ * @nodes: Nodes in heap order; nodes[0] is on top
+ * @count: Number of nodes in the heap
+ * @alloc: Number of entries allocated for nodes
+ * @before: Ordering function or %NULL to compare the keys
+ */
+struct heap {
+	struct heap_node **nodes;
+	unsigned int count;
+	unsigned int alloc;
+	int (*before)(const struct heap_node *a, const struct heap_node *b);
+};
+
+#define heap_entry(node, type, member) \
+	((type *) ((char *) (node) - offsetof(type, member)))
+
+static inline void heap_init(struct heap *heap)
+{
+	heap->nodes = NULL;
+	heap->count = 0;
+	heap->alloc = 0;
+	heap->before = NULL;
+}
+
+/**
+ * heap_init_cmp - Initialize a heap with a custom ordering
+ * @heap: Heap to initialize
+ * @before: Returns 1 if node a is to be above node b in the heap
+ *
+ * This can be used when the order of the nodes cannot be described with a
+ * single key, e.g., to add a tie-breaker for equal keys.
+ */
+static inline void heap_init_cmp(struct heap *heap,
+				 int (*before)(const struct heap_node *a,
+					       const struct heap_node *b))
+{
+	heap_init(heap);
+	heap->before = before;
+}
+
+static inline struct heap_node * heap_first(struct heap *heap)
+{
+	return heap->count ? heap->nodes[0] : NULL;
+}
+
+static inline int heap_in_heap(const struct heap_node *node)
+{
+	return node->pos != 0;
+}
+
+void heap_deinit(struct heap *heap);
+int heap_insert(struct heap *heap, struct heap_node *node);
+void heap_remove(struct heap *heap, struct heap_node *node);
+void heap_update(struct heap *heap, struct heap_node *node);
+unsigned int heap_remove_match(struct heap *heap,
+			       int (*match)(struct heap_node *node, void *ctx),
+			       void *ctx);
+
+#endif /* HEAP_H */
@@ -46,6 +46,85 @@ int os_get_time(struct os_time *t);
 	} \
 } while (0)
 
+struct os_reltime {
+	os_time_t sec;
+	os_time_t usec;
+};
+
+/**
+ * os_get_reltime - Get relative time (sec, usec)
+ * @t: Pointer to buffer for the time
+ * Returns: 0 on success, -1 on failure
+ *
+ * The relative time is taken from a monotonic clock where available, so it
+ * does not jump when the wall clock is changed. It is only meaningful when
+ * compared with other relative times and is to be used for timeouts and for
+ * measuring durations; use os_get_time() for time stamps that are shown or
+ * stored. While eloop_run() is processing an event, this returns the time at
+ * which the event was noticed (see os_reltime_cache()).
+ */
+int os_get_reltime(struct os_reltime *t);
+
+/**
+ * os_reltime_cache - Control the cached relative time
+ * @enable: 1 to read the clock and return that time from os_get_reltime()
+ *	until the next call; 0 to read the clock on each os_get_reltime() call
+ *
+ * This is used by eloop_run() once for each event loop iteration so that
+ * the handlers called for the same event do not all need to read the clock.
+ */
+void os_reltime_cache(int enable);
+
+
+/* Helper functions for handling struct os_reltime */
+
+static inline int os_reltime_before(struct os_reltime *a,
+				    struct os_reltime *b)
+{
+	return (a->sec < b->sec) ||
+	       (a->sec == b->sec && a->usec < b->usec);
+}
+
+
+static inline void os_reltime_sub(struct os_reltime *a, struct os_reltime *b,
+				  struct os_reltime *res)
+{
+	res->sec = a->sec - b->sec;
+	res->usec = a->usec - b->usec;
+	if (res->usec < 0) {
+		res->sec--;
+		res->usec += 1000000;
+	}
+}
+
+
+static inline void os_reltime_age(struct os_reltime *start,
+				  struct os_reltime *age)
+{
+	struct os_reltime now;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, age);
+}
+
+
+static inline int os_reltime_expired(struct os_reltime *now,
+				     struct os_reltime *ts,
+				     os_time_t timeout_secs)
+{
+	struct os_reltime age;
+
+	os_reltime_sub(now, ts, &age);
+	return (age.sec > timeout_secs) ||
+	       (age.sec == timeout_secs && age.usec > 0);
+}
+
+
+static inline int os_reltime_initialized(struct os_reltime *t)
+{
+	return t->sec != 0 || t->usec != 0;
+}
+
 /**
  * os_mktime - Convert broken-down time into seconds since 1970-01-01
  * @year: Four digit year
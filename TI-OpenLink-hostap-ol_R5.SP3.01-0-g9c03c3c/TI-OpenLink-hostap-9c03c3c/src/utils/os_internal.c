@@ -41,6 +41,24 @@ int os_get_time(struct os_time *t)
 }
 
 
+int os_get_reltime(struct os_reltime *t)
+{
+	/* No monotonic clock; use the wall clock */
+	struct os_time tm;
+	int res;
+
+	res = os_get_time(&tm);
+	t->sec = tm.sec;
+	t->usec = tm.usec;
+	return res;
+}
+
+
+void os_reltime_cache(int enable)
+{
+}
+
+
 int os_mktime(int year, int month, int day, int hour, int min, int sec,
 	      os_time_t *t)
 {
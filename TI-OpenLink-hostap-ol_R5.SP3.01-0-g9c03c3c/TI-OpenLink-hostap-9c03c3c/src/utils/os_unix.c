@@ -60,6 +60,62 @@ int os_get_time(struct os_time *t)
 }
 
 
+static struct os_reltime reltime_cached;
+static int reltime_cache;
+
+static int os_read_reltime(struct os_reltime *t)
+{
+	struct os_time tm;
+	int res;
+#ifdef CLOCK_MONOTONIC
+#ifdef CLOCK_BOOTTIME
+	/* Unlike CLOCK_MONOTONIC, this keeps running while suspended */
+	static clockid_t clock_id = CLOCK_BOOTTIME;
+#else /* CLOCK_BOOTTIME */
+	static clockid_t clock_id = CLOCK_MONOTONIC;
+#endif /* CLOCK_BOOTTIME */
+	struct timespec ts;
+
+	res = clock_gettime(clock_id, &ts);
+#ifdef CLOCK_BOOTTIME
+	if (res < 0 && errno == EINVAL && clock_id == CLOCK_BOOTTIME) {
+		/* Kernels before 2.6.39 do not have CLOCK_BOOTTIME */
+		clock_id = CLOCK_MONOTONIC;
+		res = clock_gettime(clock_id, &ts);
+	}
+#endif /* CLOCK_BOOTTIME */
+	if (res == 0) {
+		t->sec = ts.tv_sec;
+		t->usec = ts.tv_nsec / 1000;
+		return 0;
+	}
+#endif /* CLOCK_MONOTONIC */
+
+	res = os_get_time(&tm);
+	t->sec = tm.sec;
+	t->usec = tm.usec;
+	return res;
+}
+
+
+int os_get_reltime(struct os_reltime *t)
+{
+	if (reltime_cache) {
+		*t = reltime_cached;
+		return 0;
+	}
+	return os_read_reltime(t);
+}
+
+
+void os_reltime_cache(int enable)
+{
+	reltime_cache = 0;
+	if (enable && os_read_reltime(&reltime_cached) == 0)
+		reltime_cache = 1;
+}
+
+
 int os_mktime(int year, int month, int day, int hour, int min, int sec,
 	      os_time_t *t)
 {
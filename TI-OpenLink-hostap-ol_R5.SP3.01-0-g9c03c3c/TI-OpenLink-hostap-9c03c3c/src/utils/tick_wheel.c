@@ -0,0 +1,176 @@
+/*
+ * Shared one second timer wheel
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Per-station timers with one second granularity (EAPOL port timers, STA
+ * inactivity, PTK rekeying) are kept on a wheel of one second slots that is
+ * advanced by a single eloop timeout. Adding and removing a timer takes
+ * constant time and each tick only looks at the timers in one slot, so the
+ * cost of a tick is proportional to the number of expiring timers instead of
+ * the number of stations. Timers further away than the number of slots stay
+ * in their slot for more than one round.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "eloop.h"
+#include "tick_wheel.h"
+
+
+#define TICK_WHEEL_SLOTS 256
+
+struct tick_wheel {
+	struct dl_list slots[TICK_WHEEL_SLOTS];
+	unsigned int now; /* number of the last processed tick */
+	unsigned int count; /* number of timers on the wheel */
+	int in_tick;
+	int running;
+};
+
+
+static void tick_wheel_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	struct tick_wheel *wheel = eloop_ctx;
+	struct tick_wheel_entry *entry, *tmp;
+	struct dl_list *slot, expired;
+
+	wheel->now++;
+	slot = &wheel->slots[wheel->now % TICK_WHEEL_SLOTS];
+	dl_list_init(&expired);
+	dl_list_for_each_safe(entry, tmp, slot, struct tick_wheel_entry, list) {
+		if ((int) (entry->expires - wheel->now) <= 0) {
+			dl_list_del(&entry->list);
+			dl_list_add_tail(&expired, &entry->list);
+		}
+	}
+
+	/*
+	 * The handlers may add and remove timers, including the ones that are
+	 * still on the expired list.
+	 */
+	wheel->in_tick = 1;
+	while (!dl_list_empty(&expired)) {
+		entry = dl_list_first(&expired, struct tick_wheel_entry, list);
+		dl_list_del(&entry->list);
+		wheel->count--;
+		entry->handler(entry->eloop_ctx, entry->user_ctx);
+	}
+	wheel->in_tick = 0;
+
+	if (wheel->count)
+		eloop_register_timeout(1, 0, tick_wheel_timeout, wheel, NULL);
+	else
+		wheel->running = 0;
+}
+
+
+/**
+ * tick_wheel_init - Allocate a timer wheel
+ * Returns: Pointer to the wheel or %NULL on failure
+ */
+struct tick_wheel * tick_wheel_init(void)
+{
+	struct tick_wheel *wheel;
+	int i;
+
+	wheel = os_zalloc(sizeof(*wheel));
+	if (wheel == NULL)
+		return NULL;
+	for (i = 0; i < TICK_WHEEL_SLOTS; i++)
+		dl_list_init(&wheel->slots[i]);
+	return wheel;
+}
+
+
+/**
+ * tick_wheel_deinit - Free a timer wheel
+ * @wheel: Wheel from tick_wheel_init() or %NULL
+ *
+ * Timers that are still on the wheel are removed from it without calling
+ * their handlers.
+ */
+void tick_wheel_deinit(struct tick_wheel *wheel)
+{
+	struct tick_wheel_entry *entry, *tmp;
+	int i;
+
+	if (wheel == NULL)
+		return;
+	eloop_cancel_timeout(tick_wheel_timeout, wheel, NULL);
+	for (i = 0; i < TICK_WHEEL_SLOTS; i++) {
+		dl_list_for_each_safe(entry, tmp, &wheel->slots[i],
+				      struct tick_wheel_entry, list)
+			dl_list_del(&entry->list);
+	}
+	os_free(wheel);
+}
+
+
+/**
+ * tick_wheel_add - Start or restart a timer
+ * @wheel: Wheel from tick_wheel_init() or %NULL to use a separate eloop timeout
+ * @entry: Timer
+ * @secs: Number of seconds until the timer expires
+ * @handler: Function to call when the timer expires
+ * @eloop_ctx: First argument for the handler
+ * @user_ctx: Second argument for the handler
+ *
+ * If the timer was already running, it is first stopped. A timer expires on
+ * a wheel tick, so it may expire up to one second after the requested time.
+ * Timers that are added from a handler are relative to the tick that is being
+ * processed, so a handler that adds its own timer back with @secs = 1 gets
+ * called on every tick.
+ */
+void tick_wheel_add(struct tick_wheel *wheel, struct tick_wheel_entry *entry,
+		    unsigned int secs, tick_wheel_handler handler,
+		    void *eloop_ctx, void *user_ctx)
+{
+	tick_wheel_del(entry);
+	entry->wheel = wheel;
+	entry->handler = handler;
+	entry->eloop_ctx = eloop_ctx;
+	entry->user_ctx = user_ctx;
+
+	if (wheel == NULL) {
+		entry->eloop = 1;
+		eloop_register_timeout(secs, 0, handler, eloop_ctx, user_ctx);
+		return;
+	}
+
+	if (!wheel->in_tick && wheel->running)
+		secs++; /* the next tick may be less than a second away */
+	if (secs == 0)
+		secs = 1;
+	entry->expires = wheel->now + secs;
+	dl_list_add_tail(&wheel->slots[entry->expires % TICK_WHEEL_SLOTS],
+			 &entry->list);
+	wheel->count++;
+
+	if (!wheel->running) {
+		wheel->running = 1;
+		eloop_register_timeout(1, 0, tick_wheel_timeout, wheel, NULL);
+	}
+}
+
+
+/**
+ * tick_wheel_del - Stop a timer
+ * @entry: Timer
+ *
+ * Nothing is done if the timer is not running.
+ */
+void tick_wheel_del(struct tick_wheel_entry *entry)
+{
+	if (entry->list.next) {
+		dl_list_del(&entry->list);
+		entry->wheel->count--;
+	} else if (entry->eloop) {
+		eloop_cancel_timeout(entry->handler, entry->eloop_ctx,
+				     entry->user_ctx);
+	}
+	entry->eloop = 0;
+}
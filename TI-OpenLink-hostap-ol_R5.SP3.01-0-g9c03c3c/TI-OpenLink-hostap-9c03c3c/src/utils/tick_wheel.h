@@ -0,0 +1,46 @@
+/*
+ * Shared one second timer wheel
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef TICK_WHEEL_H
+#define TICK_WHEEL_H
+
+#include "list.h"
+
+struct tick_wheel;
+
+typedef void (*tick_wheel_handler)(void *eloop_ctx, void *user_ctx);
+
+/**
+ * struct tick_wheel_entry - Timer embedded in the data structure it is for
+ * @list: Entry in a wheel slot; %NULL when the timer is not on a wheel
+ * @wheel: Wheel the timer was last added to or %NULL if it was registered
+ *	as a separate eloop timeout
+ * @expires: Wheel tick on which the timer expires
+ * @eloop: Whether the timer was registered as a separate eloop timeout
+ *
+ * The entry must be zeroed before its first use (e.g., by allocating the
+ * containing structure with os_zalloc()).
+ */
+struct tick_wheel_entry {
+	struct dl_list list;
+	struct tick_wheel *wheel;
+	unsigned int expires;
+	int eloop;
+	tick_wheel_handler handler;
+	void *eloop_ctx;
+	void *user_ctx;
+};
+
+struct tick_wheel * tick_wheel_init(void);
+void tick_wheel_deinit(struct tick_wheel *wheel);
+void tick_wheel_add(struct tick_wheel *wheel, struct tick_wheel_entry *entry,
+		    unsigned int secs, tick_wheel_handler handler,
+		    void *eloop_ctx, void *user_ctx);
+void tick_wheel_del(struct tick_wheel_entry *entry);
+
+#endif /* TICK_WHEEL_H */
@@ -190,6 +190,733 @@ void wpa_debug_close_linux_tracing(void)
 #endif /* CONFIG_DEBUG_LINUX_TRACING */
 
 
+#ifdef CONFIG_DEBUG_RING
+
+#ifdef CONFIG_ANDROID_LOG
+#error CONFIG_DEBUG_RING cannot be used with CONFIG_ANDROID_LOG
+#endif /* CONFIG_ANDROID_LOG */
+
+#include <pthread.h>
+
+/*
+ * Debug messages can be recorded into an in-memory ring buffer instead of
+ * being written out by the thread that generates them. Writers do not take a
+ * lock: space is reserved by advancing the head of the ring with
+ * compare-and-swap, the record is copied in, and it is committed by writing
+ * its length last. A separate thread writes the committed records out in
+ * batches and is the only one that releases space in the ring.
+ *
+ * Timestamps and hexdump data are stored in binary form and formatted by the
+ * flusher thread. Messages down to the level given to wpa_debug_ring_init()
+ * are recorded even if they are below the current debug level; up to half of
+ * the ring is kept as history that can be written out with
+ * wpa_debug_ring_dump(). If the ring is full, new messages are dropped and
+ * counted.
+ *
+ * A message that does not fit in a ring record (one eighth of the ring) is
+ * written out by the caller once the records before it have been written;
+ * only a truncated copy of it is kept in the ring for wpa_debug_ring_dump().
+ */
+
+#define WPA_DEBUG_RING_MIN_SIZE 16384
+#define WPA_DEBUG_RING_MAX_SIZE (64 * 1024 * 1024)
+#define WPA_DEBUG_RING_ALIGN 8
+#define WPA_DEBUG_RING_TEXT_LEN 2048
+#define WPA_DEBUG_RING_TITLE_LEN 255
+#define WPA_DEBUG_RING_BATCH 16384
+#define WPA_DEBUG_RING_BUSY_MS 10
+#define WPA_DEBUG_RING_IDLE_MS 1000
+
+enum wpa_debug_ring_type {
+	WPA_DEBUG_RING_TEXT,
+	WPA_DEBUG_RING_HEXDUMP,
+	WPA_DEBUG_RING_HEXDUMP_ASCII
+};
+
+#define WPA_DEBUG_RING_NULL BIT(0) /* hexdump of a NULL buffer */
+#define WPA_DEBUG_RING_REMOVED BIT(1) /* hexdump of hidden key data */
+#define WPA_DEBUG_RING_WRITTEN BIT(2) /* already written out by the caller */
+
+struct wpa_debug_ring_rec {
+	u32 len; /* length of the record with padding; written last */
+	u32 data_len; /* octets of message text or hexdump data in the record */
+	u32 orig_len; /* length of the hexdump data before truncation */
+	u32 usec;
+	os_time_t sec;
+	u16 title_len;
+	u8 type; /* enum wpa_debug_ring_type */
+	u8 level;
+	u8 flags;
+	/* followed by title_len octets of hexdump title and data_len octets of
+	 * data */
+};
+
+struct wpa_debug_ring {
+	u8 *buf;
+	unsigned long size; /* power of two */
+	size_t max_rec;
+	int level;
+
+	/* Updated by writers without holding the lock */
+	volatile unsigned long head;
+	volatile unsigned int dropped;
+	volatile int idle;
+
+	/* Updated only by the flusher thread */
+	volatile unsigned long tail;
+	unsigned long flushed;
+	unsigned int dropped_total;
+	u8 *rec_buf;
+	char *out;
+	size_t out_len;
+	size_t out_size;
+
+	pthread_t thread;
+	pthread_mutex_t lock; /* also protects out_file */
+	pthread_cond_t cond;
+	pthread_cond_t dump_cond;
+	int dump_req;
+	int stop;
+};
+
+static struct wpa_debug_ring *wpa_debug_ring = NULL;
+
+
+static void ring_copy_in(struct wpa_debug_ring *r, unsigned long pos,
+			 const void *data, size_t len)
+{
+	size_t off = pos & (r->size - 1);
+	size_t first = r->size - off;
+
+	if (first > len)
+		first = len;
+	os_memcpy(r->buf + off, data, first);
+	os_memcpy(r->buf, (const u8 *) data + first, len - first);
+}
+
+
+static void ring_copy_out(struct wpa_debug_ring *r, unsigned long pos,
+			  void *data, size_t len)
+{
+	size_t off = pos & (r->size - 1);
+	size_t first = r->size - off;
+
+	if (first > len)
+		first = len;
+	os_memcpy(data, r->buf + off, first);
+	os_memcpy((u8 *) data + first, r->buf, len - first);
+}
+
+
+static void ring_clear(struct wpa_debug_ring *r, unsigned long pos,
+		       size_t len)
+{
+	size_t off = pos & (r->size - 1);
+	size_t first = r->size - off;
+
+	if (first > len)
+		first = len;
+	os_memset(r->buf + off, 0, first);
+	os_memset(r->buf, 0, len - first);
+}
+
+
+static u32 ring_committed(struct wpa_debug_ring *r, unsigned long pos)
+{
+	/* Records are aligned, so the length field does not wrap around */
+	return *(volatile u32 *) (r->buf + (pos & (r->size - 1)));
+}
+
+
+static void ring_put(struct wpa_debug_ring *r,
+		     const struct wpa_debug_ring_rec *rec, const char *title,
+		     const void *data)
+{
+	unsigned long head, tail, pos;
+	size_t len;
+
+	len = (sizeof(*rec) + rec->title_len + rec->data_len +
+	       WPA_DEBUG_RING_ALIGN - 1) & ~(WPA_DEBUG_RING_ALIGN - 1);
+
+	do {
+		head = r->head;
+		tail = r->tail;
+		if (head + len - tail > r->size) {
+			__sync_fetch_and_add(&r->dropped, 1);
+			return;
+		}
+	} while (!__sync_bool_compare_and_swap(&r->head, head, head + len));
+
+	pos = head + sizeof(*rec);
+	ring_copy_in(r, head, rec, sizeof(*rec));
+	if (rec->title_len)
+		ring_copy_in(r, pos, title, rec->title_len);
+	if (rec->data_len)
+		ring_copy_in(r, pos + rec->title_len, data, rec->data_len);
+
+	/* Commit the record and wake up the flusher thread if it is idle */
+	__sync_synchronize();
+	*(volatile u32 *) (r->buf + (head & (r->size - 1))) = len;
+	__sync_synchronize();
+	if (r->idle && __sync_bool_compare_and_swap(&r->idle, 1, 0)) {
+		pthread_mutex_lock(&r->lock);
+		pthread_cond_signal(&r->cond);
+		pthread_mutex_unlock(&r->lock);
+	} else if (head - tail <= r->size / 2 &&
+		   head + len - tail > r->size / 2 &&
+		   pthread_mutex_trylock(&r->lock) == 0) {
+		/* Do not wait for the next batch when the ring is filling up;
+		 * if the lock is taken, the flusher thread is already busy */
+		pthread_cond_signal(&r->cond);
+		pthread_mutex_unlock(&r->lock);
+	}
+}
+
+
+static void ring_emit(struct wpa_debug_ring *r,
+		      const struct wpa_debug_ring_rec *rec, const char *title,
+		      const u8 *data);
+static void ring_write_out(struct wpa_debug_ring *r);
+static void ring_flush(struct wpa_debug_ring *r);
+
+
+static void wpa_debug_ring_put(struct wpa_debug_ring *r, int type, int level,
+			       int flags, const char *title, const void *data,
+			       size_t data_len, size_t orig_len)
+{
+	struct wpa_debug_ring_rec rec;
+	struct os_time now;
+	size_t title_len = 0;
+
+	if (title) {
+		title_len = os_strlen(title);
+		if (title_len > WPA_DEBUG_RING_TITLE_LEN)
+			title_len = WPA_DEBUG_RING_TITLE_LEN;
+	}
+
+	os_get_time(&now);
+	os_memset(&rec, 0, sizeof(rec));
+	rec.data_len = data_len;
+	rec.orig_len = orig_len;
+	rec.sec = now.sec;
+	rec.usec = now.usec;
+	rec.title_len = title_len;
+	rec.type = type;
+	rec.level = level;
+	rec.flags = flags;
+
+	if (sizeof(rec) + title_len + data_len <= r->max_rec) {
+		ring_put(r, &rec, title, data);
+		return;
+	}
+
+	/* Keep the start of the message for wpa_debug_ring_dump() */
+	rec.data_len = r->max_rec - sizeof(rec) - title_len;
+	if (level < wpa_debug_level) {
+		ring_put(r, &rec, title, data);
+		return;
+	}
+	rec.flags |= WPA_DEBUG_RING_WRITTEN;
+	ring_put(r, &rec, title, data);
+
+	/*
+	 * Write the full message out here instead; the flusher thread does
+	 * all of its work with the lock held, so the records before this one
+	 * can be written out first to keep the output in order.
+	 */
+	rec.data_len = data_len;
+	rec.flags = flags;
+	pthread_mutex_lock(&r->lock);
+	ring_flush(r);
+	ring_emit(r, &rec, title, data);
+	ring_write_out(r);
+	pthread_mutex_unlock(&r->lock);
+}
+
+
+static int wpa_debug_ring_wanted(struct wpa_debug_ring *r, int level)
+{
+	return level >= r->level || level >= wpa_debug_level;
+}
+
+
+static void wpa_debug_ring_vprintf(struct wpa_debug_ring *r, int level,
+				   const char *fmt, va_list ap)
+{
+	char buf[WPA_DEBUG_RING_TEXT_LEN], *text = buf;
+	va_list aq;
+	int len;
+
+	va_copy(aq, ap);
+	len = vsnprintf(buf, sizeof(buf), fmt, aq);
+	va_end(aq);
+	if (len < 0)
+		return;
+	if (len >= (int) sizeof(buf)) {
+		text = os_malloc(len + 1);
+		if (text)
+			vsnprintf(text, len + 1, fmt, ap);
+		else {
+			text = buf;
+			len = sizeof(buf) - 1;
+		}
+	}
+	wpa_debug_ring_put(r, WPA_DEBUG_RING_TEXT, level, 0, NULL, text, len,
+			   len);
+	if (text != buf)
+		os_free(text);
+}
+
+
+static void wpa_debug_ring_hexdump(struct wpa_debug_ring *r, int type,
+				   int level, const char *title, const u8 *buf,
+				   size_t len, int show)
+{
+	if (buf == NULL)
+		wpa_debug_ring_put(r, type, level, WPA_DEBUG_RING_NULL, title,
+				   NULL, 0, len);
+	else if (!show)
+		wpa_debug_ring_put(r, type, level, WPA_DEBUG_RING_REMOVED,
+				   title, NULL, 0, len);
+	else
+		wpa_debug_ring_put(r, type, level, 0, title, buf, len, len);
+}
+
+
+static char * ring_hex(char *pos, const u8 *data, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		*pos++ = ' ';
+		*pos++ = hex[data[i] >> 4];
+		*pos++ = hex[data[i] & 0x0f];
+	}
+	return pos;
+}
+
+
+static char * ring_hexdump_ascii(char *pos, const u8 *data, size_t len)
+{
+	const size_t line_len = 16;
+	size_t i, llen;
+
+	while (len) {
+		llen = len > line_len ? line_len : len;
+		*pos++ = '\n';
+		os_memset(pos, ' ', 4);
+		pos = ring_hex(pos + 4, data, llen);
+		os_memset(pos, ' ', (line_len - llen) * 3 + 3);
+		pos += (line_len - llen) * 3 + 3;
+		for (i = 0; i < llen; i++)
+			*pos++ = isprint(data[i]) ? data[i] : '_';
+		os_memset(pos, ' ', line_len - llen);
+		pos += line_len - llen;
+		data += llen;
+		len -= llen;
+	}
+	return pos;
+}
+
+
+/* Format a record into the output buffer without the terminating newline */
+static int ring_format(struct wpa_debug_ring *r,
+		       const struct wpa_debug_ring_rec *rec, const char *title,
+		       const u8 *data, int timestamp, int multiline)
+{
+	size_t need;
+	char *pos, *n;
+	int ascii;
+
+	need = 64 + rec->title_len + 6 * rec->data_len;
+	if (r->out_size - r->out_len < need) {
+		n = os_realloc(r->out, r->out_len + need);
+		if (n == NULL)
+			return -1;
+		r->out = n;
+		r->out_size = r->out_len + need;
+	}
+	pos = r->out + r->out_len;
+
+	if (timestamp)
+		pos += os_snprintf(pos, 32, "%ld.%06u: ", (long) rec->sec,
+				   (unsigned int) rec->usec);
+
+	if (rec->type == WPA_DEBUG_RING_TEXT) {
+		os_memcpy(pos, data, rec->data_len);
+		r->out_len = pos + rec->data_len - r->out;
+		return 0;
+	}
+
+	ascii = multiline && rec->type == WPA_DEBUG_RING_HEXDUMP_ASCII;
+	os_memcpy(pos, title, rec->title_len);
+	pos += rec->title_len;
+	pos += os_snprintf(pos, 40, " - hexdump%s(len=%lu):",
+			   ascii ? "_ascii" : "",
+			   (unsigned long) rec->orig_len);
+	if (rec->flags & WPA_DEBUG_RING_REMOVED) {
+		os_memcpy(pos, " [REMOVED]", 10);
+		pos += 10;
+	} else if (rec->flags & WPA_DEBUG_RING_NULL) {
+		os_memcpy(pos, " [NULL]", 7);
+		pos += 7;
+	} else if (ascii) {
+		pos = ring_hexdump_ascii(pos, data, rec->data_len);
+		if (rec->data_len < rec->orig_len) {
+			os_memcpy(pos, "\n     ...", 9);
+			pos += 9;
+		}
+	} else {
+		pos = ring_hex(pos, data, rec->data_len);
+		if (rec->data_len < rec->orig_len) {
+			os_memcpy(pos, " ...", 4);
+			pos += 4;
+		}
+	}
+	r->out_len = pos - r->out;
+	return 0;
+}
+
+
+static void ring_write_out(struct wpa_debug_ring *r)
+{
+	FILE *f = stdout;
+
+	if (r->out_len == 0)
+		return;
+#ifdef CONFIG_DEBUG_FILE
+	if (out_file)
+		f = out_file;
+#endif /* CONFIG_DEBUG_FILE */
+	fwrite(r->out, 1, r->out_len, f);
+	fflush(f);
+	r->out_len = 0;
+}
+
+
+static void ring_emit(struct wpa_debug_ring *r,
+		      const struct wpa_debug_ring_rec *rec, const char *title,
+		      const u8 *data)
+{
+#ifdef CONFIG_DEBUG_SYSLOG
+	if (wpa_debug_syslog) {
+		if (ring_format(r, rec, title, data, 0, 0) == 0) {
+			r->out[r->out_len] = '\0';
+			syslog(syslog_priority(rec->level), "%s", r->out);
+		}
+		r->out_len = 0;
+		return;
+	}
+#endif /* CONFIG_DEBUG_SYSLOG */
+	if (ring_format(r, rec, title, data, wpa_debug_timestamp, 1) < 0)
+		return;
+	r->out[r->out_len++] = '\n';
+	if (r->out_len >= WPA_DEBUG_RING_BATCH)
+		ring_write_out(r);
+}
+
+
+static void ring_emit_text(struct wpa_debug_ring *r, int level,
+			   const char *fmt, ...)
+{
+	struct wpa_debug_ring_rec rec;
+	struct os_time now;
+	char buf[128];
+	va_list ap;
+	int len;
+
+	va_start(ap, fmt);
+	len = vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	if (len < 0 || len >= (int) sizeof(buf))
+		return;
+
+	os_get_time(&now);
+	os_memset(&rec, 0, sizeof(rec));
+	rec.data_len = rec.orig_len = len;
+	rec.sec = now.sec;
+	rec.usec = now.usec;
+	rec.type = WPA_DEBUG_RING_TEXT;
+	rec.level = level;
+	ring_emit(r, &rec, NULL, (const u8 *) buf);
+}
+
+
+static u8 * ring_read(struct wpa_debug_ring *r, unsigned long pos,
+		      struct wpa_debug_ring_rec *rec)
+{
+	u32 len;
+
+	len = ring_committed(r, pos);
+	if (len == 0)
+		return NULL;
+	__sync_synchronize();
+	ring_copy_out(r, pos, rec, sizeof(*rec));
+	rec->len = len;
+	ring_copy_out(r, pos + sizeof(*rec), r->rec_buf,
+		      rec->title_len + rec->data_len);
+	return r->rec_buf;
+}
+
+
+static void ring_flush(struct wpa_debug_ring *r)
+{
+	struct wpa_debug_ring_rec rec;
+	unsigned long tail;
+	unsigned int dropped;
+	u8 *payload;
+
+	dropped = __sync_fetch_and_and(&r->dropped, 0);
+	if (dropped) {
+		r->dropped_total += dropped;
+		ring_emit_text(r, MSG_WARNING, "wpa_debug: %u message(s) "
+			       "dropped - ring buffer full", dropped);
+	}
+
+	while (r->flushed != r->head) {
+		payload = ring_read(r, r->flushed, &rec);
+		if (payload == NULL)
+			break; /* not yet committed */
+		if (rec.level >= wpa_debug_level &&
+		    !(rec.flags & WPA_DEBUG_RING_WRITTEN))
+			ring_emit(r, &rec, (const char *) payload,
+				  payload + rec.title_len);
+		r->flushed += rec.len;
+	}
+	ring_write_out(r);
+
+	/*
+	 * Release written records so that at least half of the ring is free;
+	 * the rest is kept for wpa_debug_ring_dump(). The released space is
+	 * cleared so that a record is not seen as committed before it has been
+	 * written.
+	 */
+	tail = r->tail;
+	while (tail != r->flushed && r->head - tail > r->size / 2) {
+		rec.len = ring_committed(r, tail);
+		ring_clear(r, tail, rec.len);
+		tail += rec.len;
+	}
+	if (tail != r->tail) {
+		__sync_synchronize();
+		r->tail = tail;
+	}
+}
+
+
+static void ring_dump(struct wpa_debug_ring *r)
+{
+	struct wpa_debug_ring_rec rec;
+	unsigned long pos;
+	unsigned int count = 0;
+	u8 *payload;
+
+	ring_emit_text(r, MSG_INFO, "wpa_debug: Dump of the debug ring buffer "
+		       "(%u message(s) dropped)", r->dropped_total);
+	for (pos = r->tail; pos != r->flushed; pos += rec.len) {
+		payload = ring_read(r, pos, &rec);
+		if (payload == NULL)
+			break;
+		ring_emit(r, &rec, (const char *) payload,
+			  payload + rec.title_len);
+		count++;
+	}
+	ring_emit_text(r, MSG_INFO, "wpa_debug: End of the debug ring buffer "
+		       "dump (%u message(s))", count);
+	ring_write_out(r);
+}
+
+
+static void ring_wait(struct wpa_debug_ring *r, int ms)
+{
+	struct timeval tv;
+	struct timespec ts;
+
+	gettimeofday(&tv, NULL);
+	ts.tv_sec = tv.tv_sec + ms / 1000;
+	ts.tv_nsec = (tv.tv_usec + (ms % 1000) * 1000) * 1000L;
+	if (ts.tv_nsec >= 1000000000L) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+	pthread_cond_timedwait(&r->cond, &r->lock, &ts);
+}
+
+
+static void * wpa_debug_ring_thread(void *arg)
+{
+	struct wpa_debug_ring *r = arg;
+	unsigned long start;
+
+	pthread_mutex_lock(&r->lock);
+	for (;;) {
+		start = r->flushed;
+		ring_flush(r);
+		if (r->dump_req) {
+			ring_dump(r);
+			r->dump_req = 0;
+			pthread_cond_broadcast(&r->dump_cond);
+		}
+		if (r->stop)
+			break;
+		if (r->flushed != start) {
+			/* Let more messages accumulate for the next batch */
+			ring_wait(r, WPA_DEBUG_RING_BUSY_MS);
+			continue;
+		}
+
+		r->idle = 1;
+		__sync_synchronize();
+		if (r->flushed == r->head || !ring_committed(r, r->flushed))
+			ring_wait(r, r->flushed == r->head ?
+				  WPA_DEBUG_RING_IDLE_MS :
+				  WPA_DEBUG_RING_BUSY_MS);
+		r->idle = 0;
+	}
+	pthread_mutex_unlock(&r->lock);
+
+	return NULL;
+}
+
+
+static void wpa_debug_ring_free(struct wpa_debug_ring *r)
+{
+	os_free(r->out);
+	os_free(r->rec_buf);
+	os_free(r->buf);
+	os_free(r);
+}
+
+
+/**
+ * wpa_debug_ring_init - Start writing debug messages through a ring buffer
+ * @size: Size of the ring buffer in octets
+ * @level: Lowest priority level (MSG_*) of messages to record
+ * Returns: 0 on success, -1 on failure
+ *
+ * Messages at or above @level are recorded even if they are below the debug
+ * level that is used for output, so that they can be written out with
+ * wpa_debug_ring_dump().
+ */
+int wpa_debug_ring_init(size_t size, int level)
+{
+	struct wpa_debug_ring *r;
+	unsigned long rsize = WPA_DEBUG_RING_MIN_SIZE;
+
+	if (wpa_debug_ring)
+		return -1;
+	while (rsize < size && rsize < WPA_DEBUG_RING_MAX_SIZE)
+		rsize <<= 1;
+
+	r = os_zalloc(sizeof(*r));
+	if (r == NULL)
+		return -1;
+	r->size = rsize;
+	r->max_rec = rsize / 8;
+	r->level = level;
+	r->buf = os_zalloc(rsize);
+	r->rec_buf = os_malloc(r->max_rec);
+	if (r->buf == NULL || r->rec_buf == NULL) {
+		wpa_debug_ring_free(r);
+		return -1;
+	}
+
+	pthread_mutex_init(&r->lock, NULL);
+	pthread_cond_init(&r->cond, NULL);
+	pthread_cond_init(&r->dump_cond, NULL);
+	if (pthread_create(&r->thread, NULL, wpa_debug_ring_thread, r)) {
+		wpa_printf(MSG_ERROR, "wpa_debug: Could not create thread: %s",
+			   strerror(errno));
+		pthread_cond_destroy(&r->dump_cond);
+		pthread_cond_destroy(&r->cond);
+		pthread_mutex_destroy(&r->lock);
+		wpa_debug_ring_free(r);
+		return -1;
+	}
+
+	wpa_debug_ring = r;
+	wpa_printf(MSG_DEBUG, "wpa_debug: Using a %lu octet ring buffer for "
+		   "debug messages", rsize);
+
+	return 0;
+}
+
+
+/**
+ * wpa_debug_ring_deinit - Write out buffered debug messages and stop
+ *
+ * This must not be called while other threads may still generate debug
+ * messages.
+ */
+void wpa_debug_ring_deinit(void)
+{
+	struct wpa_debug_ring *r = wpa_debug_ring;
+
+	if (r == NULL)
+		return;
+
+	pthread_mutex_lock(&r->lock);
+	r->stop = 1;
+	pthread_cond_signal(&r->cond);
+	pthread_mutex_unlock(&r->lock);
+	pthread_join(r->thread, NULL);
+	wpa_debug_ring = NULL;
+
+	pthread_cond_destroy(&r->dump_cond);
+	pthread_cond_destroy(&r->cond);
+	pthread_mutex_destroy(&r->lock);
+	wpa_debug_ring_free(r);
+}
+
+
+/**
+ * wpa_debug_ring_dump - Write out the messages held in the ring buffer
+ * Returns: 0 on success, -1 if the ring buffer is not in use
+ *
+ * All recorded messages that are still in the ring buffer are written to the
+ * debug output regardless of the current debug level. This function returns
+ * once the messages have been written.
+ */
+int wpa_debug_ring_dump(void)
+{
+	struct wpa_debug_ring *r = wpa_debug_ring;
+
+	if (r == NULL)
+		return -1;
+
+	pthread_mutex_lock(&r->lock);
+	r->dump_req = 1;
+	pthread_cond_signal(&r->cond);
+	while (r->dump_req)
+		pthread_cond_wait(&r->dump_cond, &r->lock);
+	pthread_mutex_unlock(&r->lock);
+
+	return 0;
+}
+
+
+static void wpa_debug_ring_lock(void)
+{
+	if (wpa_debug_ring)
+		pthread_mutex_lock(&wpa_debug_ring->lock);
+}
+
+
+static void wpa_debug_ring_unlock(void)
+{
+	if (wpa_debug_ring)
+		pthread_mutex_unlock(&wpa_debug_ring->lock);
+}
+
+#else /* CONFIG_DEBUG_RING */
+
+#define wpa_debug_ring_lock() do { } while (0)
+#define wpa_debug_ring_unlock() do { } while (0)
+
+#endif /* CONFIG_DEBUG_RING */
+
+
 /**
  * wpa_printf - conditional printf
  * @level: priority level (MSG_*) of the message
@@ -206,6 +933,12 @@ void wpa_printf(int level, const char *fmt, ...)
 	va_list ap;
 
 	va_start(ap, fmt);
+#ifdef CONFIG_DEBUG_RING
+	if (wpa_debug_ring) {
+		if (wpa_debug_ring_wanted(wpa_debug_ring, level))
+			wpa_debug_ring_vprintf(wpa_debug_ring, level, fmt, ap);
+	} else
+#endif /* CONFIG_DEBUG_RING */
 	if (level >= wpa_debug_level) {
 #ifdef CONFIG_ANDROID_LOG
 		__android_log_vprint(wpa_to_android_level(level),
@@ -271,6 +1004,15 @@ static void _wpa_hexdump(int level, const char *title, const u8 *buf,
 	}
 #endif /* CONFIG_DEBUG_LINUX_TRACING */
 
+#ifdef CONFIG_DEBUG_RING
+	if (wpa_debug_ring) {
+		if (wpa_debug_ring_wanted(wpa_debug_ring, level))
+			wpa_debug_ring_hexdump(wpa_debug_ring,
+					       WPA_DEBUG_RING_HEXDUMP, level,
+					       title, buf, len, show);
+		return;
+	}
+#endif /* CONFIG_DEBUG_RING */
 	if (level < wpa_debug_level)
 		return;
 #ifdef CONFIG_ANDROID_LOG
@@ -413,6 +1155,15 @@ static void _wpa_hexdump_ascii(int level, const char *title, const u8 *buf,
 	}
 #endif /* CONFIG_DEBUG_LINUX_TRACING */
 
+#ifdef CONFIG_DEBUG_RING
+	if (wpa_debug_ring) {
+		if (wpa_debug_ring_wanted(wpa_debug_ring, level))
+			wpa_debug_ring_hexdump(wpa_debug_ring,
+					       WPA_DEBUG_RING_HEXDUMP_ASCII,
+					       level, title, buf, len, show);
+		return;
+	}
+#endif /* CONFIG_DEBUG_RING */
 	if (level < wpa_debug_level)
 		return;
 #ifdef CONFIG_ANDROID_LOG
@@ -536,6 +1287,8 @@ int wpa_debug_reopen_file(void)
 int wpa_debug_open_file(const char *path)
 {
 #ifdef CONFIG_DEBUG_FILE
+	FILE *f;
+
 	if (!path)
 		return 0;
 
@@ -545,15 +1298,18 @@ int wpa_debug_open_file(const char *path)
 		last_path = os_strdup(path);
 	}
 
-	out_file = fopen(path, "a");
-	if (out_file == NULL) {
+	f = fopen(path, "a");
+	if (f == NULL) {
 		wpa_printf(MSG_ERROR, "wpa_debug_open_file: Failed to open "
 			   "output file, using standard output");
 		return -1;
 	}
 #ifndef _WIN32
-	setvbuf(out_file, NULL, _IOLBF, 0);
+	setvbuf(f, NULL, _IOLBF, 0);
 #endif /* _WIN32 */
+	wpa_debug_ring_lock();
+	out_file = f;
+	wpa_debug_ring_unlock();
 #endif /* CONFIG_DEBUG_FILE */
 	return 0;
 }
@@ -562,10 +1318,15 @@ int wpa_debug_open_file(const char *path)
 void wpa_debug_close_file(void)
 {
 #ifdef CONFIG_DEBUG_FILE
+	FILE *f;
+
 	if (!out_file)
 		return;
-	fclose(out_file);
+	wpa_debug_ring_lock();
+	f = out_file;
 	out_file = NULL;
+	wpa_debug_ring_unlock();
+	fclose(f);
 	os_free(last_path);
 	last_path = NULL;
 #endif /* CONFIG_DEBUG_FILE */
@@ -273,6 +273,30 @@ static inline void wpa_debug_close_linux_tracing(void)
 
 #endif /* CONFIG_DEBUG_LINUX_TRACING */
 
+#if defined(CONFIG_DEBUG_RING) && !defined(CONFIG_NO_STDOUT_DEBUG)
+
+int wpa_debug_ring_init(size_t size, int level);
+void wpa_debug_ring_deinit(void);
+int wpa_debug_ring_dump(void);
+
+#else /* CONFIG_DEBUG_RING && !CONFIG_NO_STDOUT_DEBUG */
+
+static inline int wpa_debug_ring_init(size_t size, int level)
+{
+	return -1;
+}
+
+static inline void wpa_debug_ring_deinit(void)
+{
+}
+
+static inline int wpa_debug_ring_dump(void)
+{
+	return -1;
+}
+
+#endif /* CONFIG_DEBUG_RING && !CONFIG_NO_STDOUT_DEBUG */
+
 
 #ifdef EAPOL_TEST
 #define WPA_ASSERT(a)						       \
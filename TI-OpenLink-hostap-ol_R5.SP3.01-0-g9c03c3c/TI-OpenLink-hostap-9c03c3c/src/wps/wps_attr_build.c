@@ -12,6 +12,7 @@
 #include "crypto/aes_wrap.h"
 #include "crypto/crypto.h"
 #include "crypto/dh_group5.h"
+#include "crypto/dh_pool.h"
 #include "crypto/sha256.h"
 #include "crypto/random.h"
 #include "common/ieee802_11_defs.h"
@@ -39,10 +40,17 @@ int wps_build_public_key(struct wps_data *wps, struct wpabuf *msg)
 		wps->dh_ctx = dh5_init_fixed(wps->dh_privkey, pubkey);
 #endif /* CONFIG_WPS_NFC */
 	} else {
-		wpa_printf(MSG_DEBUG, "WPS: Generate new DH keys");
 		wps->dh_privkey = NULL;
 		dh5_free(wps->dh_ctx);
-		wps->dh_ctx = dh5_init(&wps->dh_privkey, &pubkey);
+		pubkey = dh_pool_get(WPS_DH_GROUP, &wps->dh_privkey);
+		if (pubkey) {
+			wpa_printf(MSG_DEBUG, "WPS: Using pre-generated DH "
+				   "keys");
+			wps->dh_ctx = dh5_init_fixed(wps->dh_privkey, pubkey);
+		} else {
+			wpa_printf(MSG_DEBUG, "WPS: Generate new DH keys");
+			wps->dh_ctx = dh5_init(&wps->dh_privkey, &pubkey);
+		}
 		pubkey = wpabuf_zeropad(pubkey, 192);
 	}
 	if (wps->dh_ctx == NULL || wps->dh_privkey == NULL || pubkey == NULL) {
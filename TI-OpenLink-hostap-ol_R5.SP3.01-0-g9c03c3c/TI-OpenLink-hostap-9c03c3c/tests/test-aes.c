@@ -11,43 +11,313 @@
 #include "common.h"
 #include "crypto/crypto.h"
 #include "crypto/aes_wrap.h"
+#include "crypto/aes_i.h"
 
 #define BLOCK_SIZE 16
 
-static void test_aes_perf(void)
+static int test_aes_block(void)
 {
-#if 0 /* this did not seem to work with new compiler?! */
-#ifdef __i386__
-#define rdtscll(val) \
-     __asm__ __volatile__("rdtsc" : "=A" (val))
-	const int num_iters = 10;
-	int i;
-	unsigned int start, end;
-	u8 key[16], pt[16], ct[16];
+	/* FIPS-197, Appendix C.1 */
+	u8 key[] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+		     0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f };
+	u8 plain[] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+		       0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+	u8 cipher[] = { 0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+			0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a };
+	u8 buf[BLOCK_SIZE];
 	void *ctx;
+	int ret = 0;
+
+	ctx = aes_encrypt_init(key, sizeof(key));
+	if (ctx == NULL)
+		return 1;
+	aes_encrypt(ctx, plain, buf);
+	aes_encrypt_deinit(ctx);
+	if (memcmp(buf, cipher, BLOCK_SIZE) != 0) {
+		printf("AES-128 encryption failed\n");
+		ret++;
+	}
 
-	printf("keySetupEnc:");
-	for (i = 0; i < num_iters; i++) {
-		rdtscll(start);
-		ctx = aes_encrypt_init(key, 16);
-		rdtscll(end);
-		aes_encrypt_deinit(ctx);
-		printf(" %d", end - start);
+	ctx = aes_decrypt_init(key, sizeof(key));
+	if (ctx == NULL)
+		return 1;
+	aes_decrypt(ctx, cipher, buf);
+	aes_decrypt_deinit(ctx);
+	if (memcmp(buf, plain, BLOCK_SIZE) != 0) {
+		printf("AES-128 decryption failed\n");
+		ret++;
+	}
+
+#ifdef AES_CONSTANT_TIME
+	{
+		u32 rk[88];
+
+		aes_ct_key_setup(rk, key);
+		aes_ct_encrypt(rk, plain, buf, 1);
+		if (memcmp(buf, cipher, BLOCK_SIZE) != 0) {
+			printf("AES-128 bitsliced encryption failed\n");
+			ret++;
+		}
+		aes_ct_decrypt(rk, cipher, buf, 1);
+		if (memcmp(buf, plain, BLOCK_SIZE) != 0) {
+			printf("AES-128 bitsliced decryption failed\n");
+			ret++;
+		}
 	}
-	printf("\n");
-
-	printf("Encrypt:");
-	ctx = aes_encrypt_init(key, 16);
-	for (i = 0; i < num_iters; i++) {
-		rdtscll(start);
-		aes_encrypt(ctx, pt, ct);
-		rdtscll(end);
-		printf(" %d", end - start);
+#endif /* AES_CONSTANT_TIME */
+
+	return ret;
+}
+
+
+#define MAX_BLOCKS 17
+
+static int test_aes_blocks(void)
+{
+	u8 key[16], in[MAX_BLOCKS * BLOCK_SIZE], out[MAX_BLOCKS * BLOCK_SIZE];
+	u8 ref[MAX_BLOCKS * BLOCK_SIZE];
+	void *ectx, *dctx;
+	size_t i, num;
+	int k, ret = 0;
+
+	for (k = 0; k < 20; k++) {
+		for (i = 0; i < sizeof(key); i++)
+			key[i] = k * 37 + i * 11;
+		for (i = 0; i < sizeof(in); i++)
+			in[i] = k + i * 7;
+
+		ectx = aes_encrypt_init(key, sizeof(key));
+		dctx = aes_decrypt_init(key, sizeof(key));
+		if (ectx == NULL || dctx == NULL)
+			return 1;
+
+		for (i = 0; i < MAX_BLOCKS; i++)
+			aes_encrypt(ectx, in + i * BLOCK_SIZE,
+				    ref + i * BLOCK_SIZE);
+
+		for (num = 1; num <= MAX_BLOCKS; num++) {
+			/* Odd counts leave parallel lanes unused */
+			aes_encrypt_blocks(ectx, in, out, num);
+			if (memcmp(out, ref, num * BLOCK_SIZE) != 0) {
+				printf("AES multi-block encryption of %d "
+				       "blocks failed\n", (int) num);
+				ret++;
+			}
+		}
+
+		/* In-place operation */
+		memcpy(out, in, sizeof(in));
+		aes_encrypt_blocks(ectx, out, out, MAX_BLOCKS);
+		if (memcmp(out, ref, sizeof(ref)) != 0) {
+			printf("AES in-place multi-block encryption failed\n");
+			ret++;
+		}
+
+		for (i = 0; i < MAX_BLOCKS; i++)
+			aes_decrypt(dctx, ref + i * BLOCK_SIZE,
+				    out + i * BLOCK_SIZE);
+		if (memcmp(out, in, sizeof(in)) != 0) {
+			printf("AES decryption of %d failed\n", k);
+			ret++;
+		}
+
+#ifdef AES_CONSTANT_TIME
+		{
+			/* Compare the bitsliced fallback against whichever
+			 * implementation was selected at runtime */
+			u32 rk[88];
+
+			aes_ct_key_setup(rk, key);
+			aes_ct_encrypt(rk, in, out, MAX_BLOCKS);
+			if (memcmp(out, ref, sizeof(ref)) != 0) {
+				printf("AES bitsliced encryption of %d "
+				       "failed\n", k);
+				ret++;
+			}
+			aes_ct_decrypt(rk, out, out, MAX_BLOCKS);
+			if (memcmp(out, in, sizeof(in)) != 0) {
+				printf("AES bitsliced decryption of %d "
+				       "failed\n", k);
+				ret++;
+			}
+		}
+#endif /* AES_CONSTANT_TIME */
+
+		aes_encrypt_deinit(ectx);
+		aes_decrypt_deinit(dctx);
 	}
+
+	return ret;
+}
+
+
+static int test_ctr(void)
+{
+	/* NIST SP 800-38A, F.5.1 CTR-AES128.Encrypt */
+	u8 key[] = { 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+		     0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c };
+	u8 counter[] = { 0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+			 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff };
+	u8 plain[] = {
+		0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+		0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+		0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+		0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+		0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+		0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+		0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+		0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+	};
+	u8 cipher[] = {
+		0x87, 0x4d, 0x61, 0x91, 0xb6, 0x20, 0xe3, 0x26,
+		0x1b, 0xef, 0x68, 0x64, 0x99, 0x0d, 0xb6, 0xce,
+		0x98, 0x06, 0xf6, 0x6b, 0x79, 0x70, 0xfd, 0xff,
+		0x86, 0x17, 0x18, 0x7b, 0xb9, 0xff, 0xfd, 0xff,
+		0x5a, 0xe4, 0xdf, 0x3e, 0xdb, 0xd5, 0xd3, 0x5e,
+		0x5b, 0x4f, 0x09, 0x02, 0x0d, 0xb0, 0x3e, 0xab,
+		0x1e, 0x03, 0x1d, 0xda, 0x2f, 0xbe, 0x03, 0xd1,
+		0x79, 0x21, 0x70, 0xa0, 0xf3, 0x00, 0x9c, 0xee
+	};
+	u8 buf[sizeof(plain)];
+	size_t len;
+	int ret = 0;
+
+	/* Also cover a partial last block */
+	for (len = sizeof(plain) - 5; len <= sizeof(plain); len += 5) {
+		memcpy(buf, plain, len);
+		if (aes_128_ctr_encrypt(key, counter, buf, len) ||
+		    memcmp(buf, cipher, len) != 0) {
+			printf("AES-128 CTR mode encryption (len=%d) failed\n",
+			       (int) len);
+			ret++;
+		}
+	}
+
+	return ret;
+}
+
+
+static int test_ccm(void)
+{
+	/* RFC 3610, Packet Vector #1 */
+	u8 key[] = { 0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+		     0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf };
+	u8 nonce[] = { 0x00, 0x00, 0x00, 0x03, 0x02, 0x01, 0x00, 0xa0,
+		       0xa1, 0xa2, 0xa3, 0xa4, 0xa5 };
+	u8 aad[] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 };
+	u8 plain[] = { 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+		       0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+		       0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e };
+	u8 cipher[] = { 0x58, 0x8c, 0x97, 0x9a, 0x61, 0xc6, 0x63, 0xd2,
+			0xf0, 0x66, 0xd0, 0xc2, 0xc0, 0xf9, 0x89, 0x80,
+			0x6d, 0x5f, 0x6b, 0x61, 0xda, 0xc3, 0x84 };
+	u8 tag[] = { 0x17, 0xe8, 0xd1, 0x2c, 0xfd, 0xf9, 0x26, 0xe0 };
+	u8 buf[sizeof(plain)], auth[sizeof(tag)];
+	int ret = 0;
+
+	if (aes_ccm_ae(key, sizeof(key), nonce, sizeof(tag), plain,
+		       sizeof(plain), aad, sizeof(aad), buf, auth) ||
+	    memcmp(buf, cipher, sizeof(cipher)) != 0 ||
+	    memcmp(auth, tag, sizeof(tag)) != 0) {
+		printf("AES-CCM encryption failed\n");
+		ret++;
+	}
+
+	if (aes_ccm_ad(key, sizeof(key), nonce, sizeof(tag), cipher,
+		       sizeof(cipher), aad, sizeof(aad), tag, buf) ||
+	    memcmp(buf, plain, sizeof(plain)) != 0) {
+		printf("AES-CCM decryption failed\n");
+		ret++;
+	}
+
+	cipher[3] ^= 0x01;
+	if (aes_ccm_ad(key, sizeof(key), nonce, sizeof(tag), cipher,
+		       sizeof(cipher), aad, sizeof(aad), tag, buf) == 0) {
+		printf("AES-CCM decryption accepted modified cipher text\n");
+		ret++;
+	}
+
+	return ret;
+}
+
+
+#define PERF_LEN 1500
+#define PERF_ROUNDS 2000
+
+static void perf_result(const char *title, struct os_time *start,
+			size_t bytes)
+{
+	struct os_time now, diff;
+	double usec;
+
+	os_get_time(&now);
+	os_time_sub(&now, start, &diff);
+	usec = diff.sec * 1000000.0 + diff.usec;
+	printf("%-32s %8.1f MB/s\n", title, usec > 0 ? bytes / usec : 0.0);
+}
+
+
+static void test_aes_perf(void)
+{
+	u8 key[16], data[PERF_LEN], out[PERF_LEN + 8], nonce[13];
+	struct os_time start;
+	void *ctx;
+	size_t i, nblocks = PERF_LEN / BLOCK_SIZE;
+	int r;
+
+	memset(key, 0x5a, sizeof(key));
+	memset(data, 0xa5, sizeof(data));
+	memset(nonce, 0x01, sizeof(nonce));
+
+	ctx = aes_encrypt_init(key, sizeof(key));
+	if (ctx == NULL)
+		return;
+
+	os_get_time(&start);
+	for (r = 0; r < PERF_ROUNDS; r++) {
+		for (i = 0; i < nblocks; i++)
+			aes_encrypt(ctx, data + i * BLOCK_SIZE,
+				    out + i * BLOCK_SIZE);
+	}
+	perf_result("AES-128 aes_encrypt()", &start,
+		    PERF_ROUNDS * nblocks * BLOCK_SIZE);
+
+	os_get_time(&start);
+	for (r = 0; r < PERF_ROUNDS; r++)
+		aes_encrypt_blocks(ctx, data, out, nblocks);
+	perf_result("AES-128 aes_encrypt_blocks()", &start,
+		    PERF_ROUNDS * nblocks * BLOCK_SIZE);
+
 	aes_encrypt_deinit(ctx);
-	printf("\n");
-#endif /* __i386__ */
-#endif
+
+#ifdef AES_CONSTANT_TIME
+	{
+		u32 rk[88];
+
+		aes_ct_key_setup(rk, key);
+		os_get_time(&start);
+		for (r = 0; r < PERF_ROUNDS; r++)
+			aes_ct_encrypt(rk, data, out, nblocks);
+		perf_result("AES-128 bitsliced", &start,
+			    PERF_ROUNDS * nblocks * BLOCK_SIZE);
+	}
+#endif /* AES_CONSTANT_TIME */
+
+	os_get_time(&start);
+	for (r = 0; r < PERF_ROUNDS; r++) {
+		if (aes_128_ctr_encrypt(key, out, data, PERF_LEN))
+			break;
+	}
+	perf_result("AES-128 CTR", &start, PERF_ROUNDS * PERF_LEN);
+
+	os_get_time(&start);
+	for (r = 0; r < PERF_ROUNDS; r++) {
+		if (aes_ccm_ae(key, sizeof(key), nonce, 8, data, PERF_LEN,
+			       nonce, sizeof(nonce), out, out + PERF_LEN))
+			break;
+	}
+	perf_result("AES-128 CCM (1500 octets)", &start,
+		    PERF_ROUNDS * PERF_LEN);
 }
 
 
@@ -262,7 +532,8 @@ int main(int argc, char *argv[])
 		printf("\n");
 	}
 
-	test_aes_perf();
+	ret += test_aes_block();
+	ret += test_aes_blocks();
 
 	for (i = 0; i < sizeof(test_vectors) / sizeof(test_vectors[0]); i++) {
 		tv = &test_vectors[i];
@@ -295,6 +566,12 @@ int main(int argc, char *argv[])
 
 	ret += test_cbc();
 
+	ret += test_ctr();
+
+	ret += test_ccm();
+
+	test_aes_perf();
+
 	if (ret)
 		printf("FAILED!\n");
 
@@ -0,0 +1,387 @@
+/*
+ * Test program and benchmark for the wpa_supplicant BSS table
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * wpa_supplicant/bss.c is linked in with stubs for the notification and scan
+ * helper functions it uses. The table is filled from synthetic scan results
+ * and checked through the lookup functions after each update. The time used
+ * for processing a full scan is reported for a small and a large table; the
+ * cost per scan result must not grow with the number of BSSes.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "eloop.h"
+#include "common/ieee802_11_defs.h"
+#include "drivers/driver.h"
+#include "wpa_supplicant_i.h"
+#include "config.h"
+#include "bss.h"
+
+
+#define TEST_IE_LEN (2 + 8 + 2 + 4)
+
+static int added, removed;
+
+
+void wpas_notify_bss_added(struct wpa_supplicant *wpa_s, u8 bssid[],
+			   unsigned int id)
+{
+	added++;
+}
+
+
+void wpas_notify_bss_removed(struct wpa_supplicant *wpa_s, u8 bssid[],
+			     unsigned int id)
+{
+	removed++;
+}
+
+
+void wpas_notify_bss_freq_changed(struct wpa_supplicant *wpa_s,
+				  unsigned int id)
+{
+}
+
+
+void wpas_notify_bss_signal_changed(struct wpa_supplicant *wpa_s,
+				    unsigned int id)
+{
+}
+
+
+void wpas_notify_bss_privacy_changed(struct wpa_supplicant *wpa_s,
+				     unsigned int id)
+{
+}
+
+
+void wpas_notify_bss_mode_changed(struct wpa_supplicant *wpa_s,
+				  unsigned int id)
+{
+}
+
+
+void wpas_notify_bss_wpaie_changed(struct wpa_supplicant *wpa_s,
+				   unsigned int id)
+{
+}
+
+
+void wpas_notify_bss_rsnie_changed(struct wpa_supplicant *wpa_s,
+				   unsigned int id)
+{
+}
+
+
+void wpas_notify_bss_wps_changed(struct wpa_supplicant *wpa_s,
+				 unsigned int id)
+{
+}
+
+
+void wpas_notify_bss_ies_changed(struct wpa_supplicant *wpa_s,
+				 unsigned int id)
+{
+}
+
+
+void wpas_notify_bss_rates_changed(struct wpa_supplicant *wpa_s,
+				   unsigned int id)
+{
+}
+
+
+int wpa_supplicant_filter_bssid_match(struct wpa_supplicant *wpa_s,
+				      const u8 *bssid)
+{
+	return 1;
+}
+
+
+const u8 * wpa_scan_get_ie(const struct wpa_scan_res *res, u8 ie)
+{
+	const u8 *end, *pos;
+
+	pos = (const u8 *) (res + 1);
+	end = pos + res->ie_len;
+
+	while (pos + 1 < end) {
+		if (pos + 2 + pos[1] > end)
+			break;
+		if (pos[0] == ie)
+			return pos;
+		pos += 2 + pos[1];
+	}
+
+	return NULL;
+}
+
+
+const u8 * wpa_scan_get_vendor_ie(const struct wpa_scan_res *res,
+				  u32 vendor_type)
+{
+	return NULL;
+}
+
+
+struct wpabuf * wpa_scan_get_vendor_ie_multi(const struct wpa_scan_res *res,
+					     u32 vendor_type)
+{
+	return NULL;
+}
+
+
+static void make_res(struct wpa_scan_res *res, int i, int level)
+{
+	u8 *pos = (u8 *) (res + 1);
+
+	os_memset(res, 0, sizeof(*res));
+	res->bssid[0] = 0x02;
+	WPA_PUT_BE32(&res->bssid[2], i);
+	res->freq = 2412 + 5 * (i % 13);
+	res->level = level;
+	res->ie_len = TEST_IE_LEN;
+
+	*pos++ = WLAN_EID_SSID;
+	*pos++ = 8;
+	os_memcpy(pos, "ssid", 4);
+	pos += 4;
+	*pos++ = '0' + i / 1000 % 10;
+	*pos++ = '0' + i / 100 % 10;
+	*pos++ = '0' + i / 10 % 10;
+	*pos++ = '0' + i % 10;
+	*pos++ = WLAN_EID_SUPP_RATES;
+	*pos++ = 4;
+	*pos++ = 0x82;
+	*pos++ = 0x84;
+	*pos++ = 0x8b;
+	*pos++ = 0x96;
+}
+
+
+/* Report BSSes first..last-1 in a scan; in reverse order if step < 0 */
+static void scan(struct wpa_supplicant *wpa_s, struct wpa_scan_res *res,
+		 int first, int last, int step, int level)
+{
+	int i;
+
+	wpa_bss_update_start(wpa_s);
+	for (i = step > 0 ? first : last - 1; i >= first && i < last;
+	     i += step) {
+		make_res(res, i, level);
+		wpa_bss_update_scan_res(wpa_s, res);
+	}
+	wpa_bss_update_end(wpa_s, NULL, 1);
+}
+
+
+static int check_table(struct wpa_supplicant *wpa_s, struct wpa_scan_res *res,
+		       int first, int last, int total, int level)
+{
+	struct wpa_bss *bss;
+	const u8 *ssid;
+	int i;
+
+	if ((int) wpa_s->num_bss != last - first ||
+	    (int) dl_list_len(&wpa_s->bss) != last - first) {
+		printf("%u BSSes in the table, expected %d - FAILED!\n",
+		       (unsigned int) wpa_s->num_bss, last - first);
+		return 1;
+	}
+
+	for (i = 0; i < total; i++) {
+		make_res(res, i, level);
+		ssid = wpa_scan_get_ie(res, WLAN_EID_SSID);
+		bss = wpa_bss_get_bssid(wpa_s, res->bssid);
+		if ((bss != NULL) != (i >= first && i < last)) {
+			printf("BSS %d %s - FAILED!\n", i,
+			       bss ? "not expired" : "not found");
+			return 1;
+		}
+		if (bss == NULL)
+			continue;
+		if (bss->level != level ||
+		    wpa_bss_get(wpa_s, res->bssid, ssid + 2, ssid[1]) != bss ||
+		    wpa_bss_get_id(wpa_s, bss->id) != bss) {
+			printf("BSS %d lookup mismatch - FAILED!\n", i);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+static int test_table(struct wpa_supplicant *wpa_s, struct wpa_scan_res *res,
+		      int count)
+{
+	struct wpa_bss *bss, *prev;
+	unsigned int id;
+	u8 bssid[ETH_ALEN];
+	int ret = 0;
+
+	added = removed = 0;
+
+	scan(wpa_s, res, 0, count, 1, -50);
+	ret += check_table(wpa_s, res, 0, count, count, -50);
+	if (added != count) {
+		printf("%d BSSes added, expected %d - FAILED!\n", added,
+		       count);
+		ret++;
+	}
+
+	/* Updated entries are kept in update order */
+	scan(wpa_s, res, 0, count, -1, -60);
+	ret += check_table(wpa_s, res, 0, count, count, -60);
+	prev = NULL;
+	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
+		if (prev && WPA_GET_BE32(&prev->bssid[2]) <
+		    WPA_GET_BE32(&bss->bssid[2])) {
+			printf("BSS list not in update order - FAILED!\n");
+			ret++;
+			break;
+		}
+		prev = bss;
+	}
+
+	/* Entries missing from bss_expiration_scan_count scans are removed */
+	scan(wpa_s, res, count / 2, count, 1, -70);
+	if ((int) wpa_s->last_scan_res_used != count - count / 2 ||
+	    wpa_s->last_scan_res[0] !=
+	    wpa_bss_get_bssid(wpa_s, wpa_s->last_scan_res[0]->bssid)) {
+		printf("BSSes from the last scan not listed - FAILED!\n");
+		ret++;
+	}
+	if ((int) wpa_s->num_bss != count) {
+		printf("BSS expired after one scan - FAILED!\n");
+		ret++;
+	}
+	scan(wpa_s, res, count / 2, count, 1, -70);
+	ret += check_table(wpa_s, res, count / 2, count, count, -70);
+	if (added != count || removed != count / 2) {
+		printf("%d added %d removed - FAILED!\n", added, removed);
+		ret++;
+	}
+
+	/*
+	 * With two SSIDs for one BSSID, wpa_bss_get_bssid() returns the entry
+	 * that was updated last.
+	 */
+	make_res(res, count - 1, -70);
+	os_memcpy(bssid, res->bssid, ETH_ALEN);
+	id = wpa_bss_get_bssid(wpa_s, bssid)->id;
+	wpa_bss_update_start(wpa_s);
+	((u8 *) (res + 1))[2] = 'S';
+	wpa_bss_update_scan_res(wpa_s, res);
+	bss = wpa_bss_get_bssid(wpa_s, bssid);
+	if (bss == NULL || bss->id == id || bss->ssid[0] != 'S') {
+		printf("New SSID for BSSID not returned - FAILED!\n");
+		ret++;
+	}
+	make_res(res, count - 1, -70);
+	wpa_bss_update_scan_res(wpa_s, res);
+	wpa_bss_update_scan_res(wpa_s, res);
+	wpa_bss_update_end(wpa_s, NULL, 0);
+	bss = wpa_bss_get_bssid(wpa_s, bssid);
+	if (bss == NULL || bss->id != id) {
+		printf("Updated SSID for BSSID not returned - FAILED!\n");
+		ret++;
+	}
+
+	if (wpa_s->last_scan_res_used != 2) {
+		printf("BSS listed twice for one scan - FAILED!\n");
+		ret++;
+	}
+
+	wpa_bss_flush(wpa_s);
+	if (wpa_s->num_bss != 0 || wpa_bss_get_id(wpa_s, id)) {
+		printf("BSS table not empty after flush - FAILED!\n");
+		ret++;
+	}
+
+	if (ret == 0)
+		printf("BSS table with %d entries - OK\n", count);
+	return ret;
+}
+
+
+static double bench(struct wpa_supplicant *wpa_s, struct wpa_scan_res *res,
+		    int count, int scans)
+{
+	struct os_time start, now, diff;
+	double usec;
+	int i;
+
+	scan(wpa_s, res, 0, count, 1, -50);
+	/*
+	 * The order of the results changes between scans, so the entry for a
+	 * result is not found at the beginning of the BSS list.
+	 */
+	os_get_time(&start);
+	for (i = 0; i < scans; i++)
+		scan(wpa_s, res, 0, count, i % 2 ? 1 : -1, -50 - i % 2);
+	os_get_time(&now);
+	wpa_bss_flush(wpa_s);
+
+	os_time_sub(&now, &start, &diff);
+	usec = diff.sec * 1000000.0 + diff.usec;
+	printf("%6d BSSes %4d scans %10.0f us %8.3f us/result\n", count, scans,
+	       usec, usec / ((double) count * scans));
+	return usec / ((double) count * scans);
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct wpa_supplicant *wpa_s;
+	struct wpa_config *conf;
+	struct wpa_scan_res *res;
+	double small, large;
+	int ret, count = 5000;
+
+	if (argc > 1)
+		count = atoi(argv[1]);
+	if (count < 200)
+		count = 200;
+
+	if (eloop_init() < 0) {
+		printf("Failed to initialize eloop\n");
+		return -1;
+	}
+
+	wpa_s = os_zalloc(sizeof(*wpa_s));
+	conf = os_zalloc(sizeof(*conf));
+	res = os_zalloc(sizeof(*res) + TEST_IE_LEN);
+	if (wpa_s == NULL || conf == NULL || res == NULL)
+		return -1;
+	conf->bss_max_count = count;
+	conf->bss_expiration_scan_count = 2;
+	wpa_s->conf = conf;
+	wpa_bss_init(wpa_s);
+
+	ret = test_table(wpa_s, res, count);
+
+	if (ret == 0) {
+		small = bench(wpa_s, res, 200, 100);
+		large = bench(wpa_s, res, count, 4);
+		/* The old list based table was linear per result */
+		if (large > 8 * small) {
+			printf("Cost per result grew %.1f times - FAILED!\n",
+			       large / small);
+			ret++;
+		}
+	}
+
+	wpa_bss_deinit(wpa_s);
+	eloop_destroy();
+	os_free(res);
+	os_free(conf);
+	os_free(wpa_s);
+
+	return ret;
+}
@@ -0,0 +1,332 @@
+/*
+ * Test program and microbenchmark for the debug message ring buffer
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "includes.h"
+#include <pthread.h>
+
+#include "common.h"
+
+extern int wpa_debug_level;
+extern int wpa_debug_show_keys;
+extern int wpa_debug_timestamp;
+
+#define NUM_THREADS 4
+#define THREAD_MSGS 20000
+
+static char log_name[] = "/tmp/test-debug-ring.XXXXXX";
+
+
+static char * read_log(size_t *len)
+{
+	char *buf, *nbuf;
+
+	buf = os_readfile(log_name, len);
+	nbuf = buf ? os_realloc(buf, *len + 1) : NULL;
+	if (nbuf == NULL) {
+		printf("Could not read %s\n", log_name);
+		exit(1);
+	}
+	nbuf[*len] = '\0';
+	return nbuf;
+}
+
+
+static void reset_log(void)
+{
+	FILE *f = fopen(log_name, "w");
+	if (f)
+		fclose(f);
+}
+
+
+static void log_sequence(void)
+{
+	u8 data[100];
+	static u8 large[10000];
+	static char text[3000];
+	size_t i;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i * 7;
+	for (i = 0; i < sizeof(large); i++)
+		large[i] = i * 13;
+	os_memset(text, 'x', sizeof(text) - 1);
+
+	wpa_printf(MSG_INFO, "text %d %s", 1, "message");
+	wpa_printf(MSG_DEBUG, "below debug level");
+	wpa_hexdump(MSG_INFO, "hexdump", data, 20);
+	wpa_hexdump(MSG_INFO, "empty", data, 0);
+	wpa_hexdump(MSG_INFO, "null", NULL, 5);
+	wpa_hexdump_key(MSG_INFO, "key", data, 16);
+	wpa_hexdump_ascii(MSG_INFO, "ascii", (const u8 *) "Hello, world!\n"
+			  "0123456789abcdefghij", 35);
+	wpa_hexdump_ascii(MSG_WARNING, "ascii binary", data, sizeof(data));
+	wpa_hexdump_ascii(MSG_INFO, "ascii null", NULL, 3);
+	wpa_hexdump_ascii_key(MSG_INFO, "ascii key", data, 8);
+	wpa_hexdump(MSG_MSGDUMP, "not shown", data, 8);
+	/* Longer than a ring record (one eighth of the 64 kB ring) */
+	wpa_hexdump(MSG_INFO, "large", large, sizeof(large));
+	wpa_hexdump_ascii(MSG_INFO, "large ascii", large, sizeof(large));
+	wpa_printf(MSG_INFO, "long text %s end", text);
+	wpa_printf(MSG_ERROR, "last");
+}
+
+
+static int test_format(void)
+{
+	char *direct, *ring;
+	size_t direct_len, ring_len;
+	int ret = 0;
+
+	wpa_debug_level = MSG_INFO;
+	wpa_debug_show_keys = 0;
+
+	reset_log();
+	wpa_debug_open_file(log_name);
+	log_sequence();
+	wpa_debug_close_file();
+	direct = read_log(&direct_len);
+
+	reset_log();
+	wpa_debug_open_file(log_name);
+	if (wpa_debug_ring_init(65536, MSG_INFO) < 0) {
+		printf("wpa_debug_ring_init failed\n");
+		exit(1);
+	}
+	log_sequence();
+	wpa_debug_ring_deinit();
+	wpa_debug_close_file();
+	ring = read_log(&ring_len);
+
+	/* Skip the message about the ring buffer being started */
+	if (ring_len < direct_len ||
+	    os_memcmp(ring + ring_len - direct_len, direct, direct_len) != 0) {
+		printf("Ring buffer output does not match direct output\n"
+		       "--- direct ---\n%.*s--- ring ---\n%.*s",
+		       (int) direct_len, direct, (int) ring_len, ring);
+		ret = -1;
+	}
+
+	os_free(direct);
+	os_free(ring);
+	return ret;
+}
+
+
+static int test_dump(void)
+{
+	char *buf;
+	size_t len;
+	int ret = 0;
+
+	wpa_debug_level = MSG_INFO;
+	reset_log();
+	wpa_debug_open_file(log_name);
+	wpa_debug_ring_init(65536, MSG_DEBUG);
+	wpa_printf(MSG_DEBUG, "history message");
+	wpa_printf(MSG_MSGDUMP, "too verbose for the ring");
+	wpa_printf(MSG_INFO, "normal message");
+
+	if (wpa_debug_ring_dump() < 0) {
+		printf("wpa_debug_ring_dump failed\n");
+		ret = -1;
+	}
+	buf = read_log(&len);
+	if (!os_strstr(buf, "normal message") ||
+	    !os_strstr(buf, "history message") ||
+	    os_strstr(buf, "too verbose") ||
+	    !os_strstr(buf, "End of the debug ring buffer dump")) {
+		printf("Unexpected dump output:\n%s", buf);
+		ret = -1;
+	}
+	/* The history message must be written only as part of the dump */
+	if (os_strstr(buf, "history message") <
+	    os_strstr(buf, "Dump of the debug ring buffer")) {
+		printf("Message below debug level was written out\n");
+		ret = -1;
+	}
+	os_free(buf);
+
+	wpa_debug_ring_deinit();
+	wpa_debug_close_file();
+	if (wpa_debug_ring_dump() == 0) {
+		printf("wpa_debug_ring_dump succeeded without ring buffer\n");
+		ret = -1;
+	}
+
+	return ret;
+}
+
+
+static void * log_thread(void *arg)
+{
+	long id = (long) arg;
+	u8 data[32];
+	int i;
+
+	os_memset(data, id, sizeof(data));
+	for (i = 0; i < THREAD_MSGS; i++) {
+		if (i % 16 == 0)
+			wpa_hexdump(MSG_INFO, "thread data", data,
+				    sizeof(data));
+		else
+			wpa_printf(MSG_INFO, "thread %ld msg %d", id, i);
+	}
+	return NULL;
+}
+
+
+static int test_threads(void)
+{
+	pthread_t threads[NUM_THREADS];
+	int last[NUM_THREADS], count = 0, errors = 0, dropped = 0;
+	char *buf, *pos, *end;
+	size_t len;
+	long i;
+	int t, m;
+
+	wpa_debug_level = MSG_INFO;
+	reset_log();
+	wpa_debug_open_file(log_name);
+	wpa_debug_ring_init(1024 * 1024, MSG_INFO);
+	for (i = 0; i < NUM_THREADS; i++)
+		pthread_create(&threads[i], NULL, log_thread, (void *) i);
+	for (i = 0; i < NUM_THREADS; i++)
+		pthread_join(threads[i], NULL);
+	wpa_debug_ring_deinit();
+	wpa_debug_close_file();
+
+	for (i = 0; i < NUM_THREADS; i++)
+		last[i] = -1;
+	buf = read_log(&len);
+	end = buf + len;
+	for (pos = buf; pos < end; pos = os_strchr(pos, '\n') + 1) {
+		if (sscanf(pos, "thread %d msg %d", &t, &m) == 2) {
+			if (t < 0 || t >= NUM_THREADS || m <= last[t])
+				errors++;
+			else
+				last[t] = m;
+			count++;
+		} else if (os_strncmp(pos, "wpa_debug: ", 11) == 0 &&
+			   os_strstr(pos, "dropped")) {
+			dropped += atoi(pos + 11);
+		}
+		if (os_strchr(pos, '\n') == NULL)
+			break;
+	}
+	os_free(buf);
+
+	printf("threads: %d messages, %d dropped\n", count, dropped);
+	if (errors) {
+		printf("%d message(s) out of order\n", errors);
+		return -1;
+	}
+	if (NUM_THREADS * (THREAD_MSGS - THREAD_MSGS / 16) - count > dropped) {
+		printf("Messages lost without being reported\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static void bench_time(const char *title, struct os_time *start, int count)
+{
+	struct os_time now, diff;
+	double usec;
+
+	os_get_time(&now);
+	os_time_sub(&now, start, &diff);
+	usec = diff.sec * 1000000.0 + diff.usec;
+	printf("%-30s %8d ops %10.0f us %8.3f us/op\n", title, count, usec,
+	       count ? usec / count : 0.0);
+}
+
+
+static void bench_log(int count)
+{
+	u8 data[64];
+	int i;
+
+	os_memset(data, 0x5a, sizeof(data));
+	for (i = 0; i < count; i++) {
+		wpa_printf(MSG_DEBUG, "benchmark message %d for " MACSTR, i,
+			   MAC2STR(data));
+		wpa_hexdump(MSG_MSGDUMP, "benchmark data", data, sizeof(data));
+	}
+}
+
+
+static void bench(void)
+{
+	struct os_time start;
+	const int count = 20000;
+
+	wpa_debug_level = MSG_EXCESSIVE;
+	wpa_debug_timestamp = 1;
+
+	reset_log();
+	wpa_debug_open_file(log_name);
+	os_get_time(&start);
+	bench_log(count);
+	bench_time("direct", &start, count);
+	wpa_debug_close_file();
+
+	reset_log();
+	wpa_debug_open_file(log_name);
+	wpa_debug_ring_init(4 * 1024 * 1024, MSG_EXCESSIVE);
+	os_get_time(&start);
+	bench_log(count);
+	bench_time("ring buffer (caller)", &start, count);
+	wpa_debug_ring_deinit();
+	bench_time("ring buffer (written out)", &start, count);
+	wpa_debug_close_file();
+
+	/* Recorded only for wpa_debug_ring_dump() */
+	wpa_debug_level = MSG_INFO;
+	reset_log();
+	wpa_debug_open_file(log_name);
+	wpa_debug_ring_init(4 * 1024 * 1024, MSG_EXCESSIVE);
+	os_get_time(&start);
+	bench_log(count);
+	bench_time("ring buffer (history only)", &start, count);
+	wpa_debug_ring_deinit();
+	wpa_debug_close_file();
+
+	wpa_debug_timestamp = 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int fd, ret = 0;
+
+	fd = mkstemp(log_name);
+	if (fd < 0) {
+		perror("mkstemp");
+		return 1;
+	}
+	close(fd);
+
+	if (test_format() < 0)
+		ret = 1;
+	if (test_dump() < 0)
+		ret = 1;
+	if (test_threads() < 0)
+		ret = 1;
+	if (ret == 0)
+		bench();
+
+	unlink(log_name);
+
+	if (ret)
+		printf("FAILED\n");
+	else
+		printf("debug ring tests passed\n");
+	return ret;
+}
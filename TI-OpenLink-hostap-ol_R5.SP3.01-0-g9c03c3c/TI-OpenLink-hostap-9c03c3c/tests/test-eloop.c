@@ -0,0 +1,348 @@
+/*
+ * Test program and microbenchmark for eloop timeouts and sockets
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "eloop.h"
+
+
+struct test_timer {
+	int id;
+	int fired;
+};
+
+static int num_timers = 10000;
+static int fired_count;
+static int last_id;
+static int order_errors;
+static int sock_reads;
+static struct os_reltime reltime_first;
+static int reltime_errors;
+
+
+static void bench_time(const char *title, struct os_time *start, int count)
+{
+	struct os_time now, diff;
+	double usec;
+
+	os_get_time(&now);
+	os_time_sub(&now, start, &diff);
+	usec = diff.sec * 1000000.0 + diff.usec;
+	printf("%-30s %8d ops %10.0f us %8.3f us/op\n", title, count, usec,
+	       count ? usec / count : 0.0);
+}
+
+
+static void test_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	struct test_timer *t = timeout_ctx;
+
+	t->fired++;
+	fired_count++;
+	/* Equal expiry times must be processed in registration order */
+	if (t->id < last_id)
+		order_errors++;
+	last_id = t->id;
+}
+
+
+static void test_never(void *eloop_ctx, void *timeout_ctx)
+{
+	order_errors++;
+}
+
+
+static void test_terminate(void *eloop_ctx, void *timeout_ctx)
+{
+	eloop_terminate();
+}
+
+
+static void test_sock_read(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	char buf[16];
+
+	if (read(sock, buf, sizeof(buf)) > 0)
+		sock_reads++;
+	eloop_unregister_read_sock(sock);
+	/*
+	 * Let eloop_run() return once there is nothing left to wait for;
+	 * eloop_terminate() would also stop the following eloop_run() calls.
+	 */
+	eloop_cancel_timeout(test_terminate, NULL, NULL);
+}
+
+
+static int test_sockets(void)
+{
+	int fds[2];
+
+	if (pipe(fds) < 0) {
+		perror("pipe");
+		return 1;
+	}
+	if (eloop_register_read_sock(fds[0], test_sock_read, NULL, NULL) < 0 ||
+	    write(fds[1], "x", 1) != 1) {
+		printf("Socket registration - FAILED!\n");
+		return 1;
+	}
+
+	sock_reads = 0;
+	eloop_run();
+	close(fds[0]);
+	close(fds[1]);
+
+	if (sock_reads != 1) {
+		printf("Socket dispatch - FAILED!\n");
+		return 1;
+	}
+	printf("Socket dispatch - OK\n");
+	return 0;
+}
+
+
+/*
+ * A socket that is closed before it is unregistered must not prevent a new
+ * socket that gets the same fd number from being polled.
+ */
+static int test_reused_sock(void)
+{
+	int fds[2], old;
+
+	if (pipe(fds) < 0) {
+		perror("pipe");
+		return 1;
+	}
+	eloop_register_read_sock(fds[0], test_sock_read, NULL, NULL);
+	old = fds[0];
+	close(fds[0]);
+	close(fds[1]);
+	eloop_unregister_read_sock(old);
+
+	if (pipe(fds) < 0) {
+		perror("pipe");
+		return 1;
+	}
+	if (fds[0] != old) {
+		printf("Reused socket - SKIPPED (fd %d != %d)\n", fds[0], old);
+		close(fds[0]);
+		close(fds[1]);
+		return 0;
+	}
+	if (eloop_register_read_sock(fds[0], test_sock_read, NULL, NULL) < 0 ||
+	    write(fds[1], "x", 1) != 1) {
+		printf("Reused socket registration - FAILED!\n");
+		return 1;
+	}
+	/* Do not wait forever if the socket is not polled */
+	eloop_register_timeout(1, 0, test_terminate, NULL, NULL);
+
+	sock_reads = 0;
+	eloop_run();
+	eloop_unregister_read_sock(fds[0]);
+	close(fds[0]);
+	close(fds[1]);
+
+	if (sock_reads != 1) {
+		printf("Reused socket dispatch - FAILED!\n");
+		return 1;
+	}
+	printf("Reused socket dispatch - OK\n");
+	return 0;
+}
+
+
+static void test_reltime_second(void *eloop_ctx, void *timeout_ctx)
+{
+	struct os_reltime now, diff;
+
+	/* The cached time was updated for this iteration */
+	os_get_reltime(&now);
+	os_reltime_sub(&now, &reltime_first, &diff);
+	if (diff.sec == 0 && diff.usec < 20000)
+		reltime_errors++;
+}
+
+
+static void test_reltime_first(void *eloop_ctx, void *timeout_ctx)
+{
+	struct os_reltime now;
+
+	/* Within one iteration, the time does not change */
+	os_get_reltime(&reltime_first);
+	os_sleep(0, 20000);
+	os_get_reltime(&now);
+	if (now.sec != reltime_first.sec || now.usec != reltime_first.usec)
+		reltime_errors++;
+	eloop_register_timeout(0, 0, test_reltime_second, NULL, NULL);
+}
+
+
+static int test_reltime(int count)
+{
+	struct os_reltime a, b;
+	struct os_time t, start;
+	int i;
+
+	/* Outside eloop_run(), the clock is read on each call */
+	reltime_errors = 0;
+	os_get_reltime(&a);
+	os_sleep(0, 10000);
+	os_get_reltime(&b);
+	if (!os_reltime_before(&a, &b))
+		reltime_errors++;
+
+	eloop_register_timeout(0, 0, test_reltime_first, NULL, NULL);
+	eloop_run();
+
+	os_get_reltime(&a);
+	os_sleep(0, 10000);
+	os_get_reltime(&b);
+	if (!os_reltime_before(&a, &b))
+		reltime_errors++;
+
+	if (reltime_errors) {
+		printf("Relative time - FAILED!\n");
+		return 1;
+	}
+	printf("Relative time - OK\n");
+
+	os_get_time(&start);
+	for (i = 0; i < count; i++)
+		os_get_time(&t);
+	bench_time("os_get_time", &start, count);
+	os_get_time(&start);
+	for (i = 0; i < count; i++)
+		os_get_reltime(&a);
+	bench_time("os_get_reltime", &start, count);
+	os_reltime_cache(1);
+	os_get_time(&start);
+	for (i = 0; i < count; i++)
+		os_get_reltime(&a);
+	bench_time("os_get_reltime (cached)", &start, count);
+	os_reltime_cache(0);
+
+	return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct test_timer *timers;
+	struct os_time start;
+	int i, removed, ret = 0;
+
+	if (argc > 1)
+		num_timers = atoi(argv[1]);
+	if (num_timers < 2)
+		num_timers = 2;
+
+	if (eloop_init() < 0) {
+		printf("Failed to initialize eloop\n");
+		return -1;
+	}
+
+	timers = os_zalloc(num_timers * sizeof(*timers));
+	if (timers == NULL)
+		return -1;
+
+	/* Long timeouts that are all cancelled before eloop_run() */
+	os_get_time(&start);
+	for (i = 0; i < num_timers; i++) {
+		timers[i].id = i;
+		eloop_register_timeout(3600 + i % 100, 0, test_never, NULL,
+				       &timers[i]);
+	}
+	bench_time("register", &start, num_timers);
+
+	os_get_time(&start);
+	for (i = 0; i < num_timers; i++) {
+		if (!eloop_is_timeout_registered(test_never, NULL,
+						 &timers[i])) {
+			printf("Timeout %d not registered - FAILED!\n", i);
+			ret++;
+			break;
+		}
+	}
+	bench_time("is_timeout_registered", &start, num_timers);
+
+	os_get_time(&start);
+	removed = 0;
+	for (i = 0; i < num_timers; i += 2)
+		removed += eloop_cancel_timeout(test_never, NULL, &timers[i]);
+	bench_time("cancel (exact match)", &start, (num_timers + 1) / 2);
+
+	os_get_time(&start);
+	removed += eloop_cancel_timeout(test_never, ELOOP_ALL_CTX,
+					ELOOP_ALL_CTX);
+	bench_time("cancel (wildcard)", &start, 1);
+
+	if (removed != num_timers) {
+		printf("Cancelled %d/%d timeouts - FAILED!\n", removed,
+		       num_timers);
+		ret++;
+	}
+
+	/* Immediate timeouts that are dispatched through eloop_run() */
+	fired_count = 0;
+	last_id = -1;
+	for (i = 0; i < num_timers; i++)
+		eloop_register_timeout(0, 0, test_timeout, NULL, &timers[i]);
+	os_get_time(&start);
+	eloop_run();
+	bench_time("dispatch", &start, fired_count);
+
+	if (fired_count != num_timers) {
+		printf("Dispatched %d/%d timeouts - FAILED!\n", fired_count,
+		       num_timers);
+		ret++;
+	}
+	if (order_errors) {
+		printf("%d ordering errors - FAILED!\n", order_errors);
+		ret++;
+	}
+
+	/* Cancelling with an in-between entry keeps the heap consistent */
+	fired_count = 0;
+	last_id = -1;
+	for (i = 0; i < num_timers; i++)
+		eloop_register_timeout(0, 0, test_timeout, NULL, &timers[i]);
+	for (i = 1; i < num_timers; i += 3)
+		eloop_cancel_timeout(test_timeout, NULL, &timers[i]);
+	eloop_run();
+	if (order_errors || fired_count != num_timers - (num_timers + 1) / 3) {
+		printf("Timeout ordering after cancel - FAILED!\n");
+		ret++;
+	} else
+		printf("Timeout ordering - OK\n");
+
+	/* Wildcard cancel that leaves other entries in the heap */
+	fired_count = 0;
+	last_id = -1;
+	for (i = 0; i < num_timers; i++) {
+		eloop_register_timeout(0, 0, test_timeout, NULL, &timers[i]);
+		eloop_register_timeout(0, 0, test_never, NULL, &timers[i]);
+	}
+	eloop_cancel_timeout(test_never, ELOOP_ALL_CTX, ELOOP_ALL_CTX);
+	eloop_run();
+	if (order_errors || fired_count != num_timers) {
+		printf("Timeout ordering after wildcard cancel - FAILED!\n");
+		ret++;
+	} else
+		printf("Timeout ordering after wildcard cancel - OK\n");
+
+	ret += test_sockets();
+	ret += test_reused_sock();
+	ret += test_reltime(num_timers * 10);
+
+	eloop_destroy();
+	os_free(timers);
+
+	return ret;
+}
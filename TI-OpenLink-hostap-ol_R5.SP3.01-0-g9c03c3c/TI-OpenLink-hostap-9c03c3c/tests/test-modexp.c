@@ -0,0 +1,211 @@
+/*
+ * Test program and benchmark for modular exponentiation
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "crypto/crypto.h"
+#include "crypto/dh_groups.h"
+#include "tls/bignum.h"
+
+
+#define MAX_LEN 256
+
+static int num_ops = 50;
+
+
+static void bench_time(const char *title, struct os_time *start, int count)
+{
+	struct os_time now, diff;
+	double usec;
+
+	os_get_time(&now);
+	os_time_sub(&now, start, &diff);
+	usec = diff.sec * 1000000.0 + diff.usec;
+	printf("%-30s %8d ops %10.0f us %8.1f us/op\n", title, count, usec,
+	       count ? usec / count : 0.0);
+}
+
+
+static void fill(u8 *buf, size_t len, unsigned int seed)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		seed = seed * 1103515245 + 12345;
+		buf[i] = seed >> 16;
+	}
+}
+
+
+/* Left-to-right binary exponentiation with bignum_mulmod() as the reference */
+static int ref_mod_exp(const u8 *base, size_t base_len,
+		       const u8 *power, size_t power_len,
+		       const u8 *modulus, size_t modulus_len,
+		       u8 *result, size_t *result_len)
+{
+	struct bignum *b, *m, *r;
+	size_t i;
+	int bit, ret = -1;
+	u8 one = 1;
+
+	b = bignum_init();
+	m = bignum_init();
+	r = bignum_init();
+	if (b == NULL || m == NULL || r == NULL ||
+	    bignum_set_unsigned_bin(b, base, base_len) < 0 ||
+	    bignum_set_unsigned_bin(m, modulus, modulus_len) < 0 ||
+	    bignum_set_unsigned_bin(r, &one, 1) < 0)
+		goto fail;
+
+	for (i = 0; i < power_len; i++) {
+		for (bit = 7; bit >= 0; bit--) {
+			if (bignum_mulmod(r, r, m, r) < 0)
+				goto fail;
+			if ((power[i] & BIT(bit)) &&
+			    bignum_mulmod(r, b, m, r) < 0)
+				goto fail;
+		}
+	}
+
+	ret = bignum_get_unsigned_bin(r, result, result_len);
+fail:
+	bignum_deinit(b);
+	bignum_deinit(m);
+	bignum_deinit(r);
+	return ret;
+}
+
+
+static int test_mod_exp(const char *title, const u8 *base, size_t base_len,
+			const u8 *power, size_t power_len,
+			const struct dh_group *dh)
+{
+	u8 res[MAX_LEN], ref[MAX_LEN];
+	size_t res_len = sizeof(res), ref_len = sizeof(ref);
+
+	if (crypto_mod_exp(base, base_len, power, power_len, dh->prime,
+			   dh->prime_len, res, &res_len) < 0 ||
+	    ref_mod_exp(base, base_len, power, power_len, dh->prime,
+			dh->prime_len, ref, &ref_len) < 0) {
+		printf("%s - modexp failed\n", title);
+		return 1;
+	}
+
+	if (res_len != ref_len || os_memcmp(res, ref, res_len) != 0) {
+		printf("%s (exponent %lu octets) - FAILED!\n", title,
+		       (unsigned long) power_len);
+		return 1;
+	}
+
+	return 0;
+}
+
+
+static int test_group(int id)
+{
+	const struct dh_group *dh = dh_groups_get(id);
+	u8 base[MAX_LEN], power[MAX_LEN + 8];
+	size_t lens[] = { 0, 1, 2, 20, 32, 100, 0, 0, 0 };
+	int i, ret = 0;
+
+	if (dh == NULL) {
+		printf("DH group %d not available - skipped\n", id);
+		return 0;
+	}
+	/* Full size exponent, one octet short of it, and a longer one to
+	 * cover the fallback from the fixed-base table */
+	lens[6] = dh->prime_len;
+	lens[7] = dh->prime_len - 1;
+	lens[8] = dh->prime_len + 8;
+
+	fill(base, dh->prime_len, id);
+	base[0] &= 0x7f;
+
+	for (i = 0; i < (int) (sizeof(lens) / sizeof(lens[0])); i++) {
+		fill(power, lens[i], id * 100 + i);
+		/* Generator, i.e., the fixed-base path */
+		ret += test_mod_exp("generator", dh->generator,
+				    dh->generator_len, power, lens[i], dh);
+		/* Small base that is not the generator */
+		ret += test_mod_exp("small base", base, 2, power, lens[i], dh);
+		/* Variable base, i.e., the sliding window path */
+		ret += test_mod_exp("variable base", base, dh->prime_len,
+				    power, lens[i], dh);
+	}
+
+	printf("DH group %d modexp - %s\n", id, ret ? "FAILED!" : "OK");
+	return ret;
+}
+
+
+static void bench(int id, int num)
+{
+	const struct dh_group *dh = dh_groups_get(id);
+	u8 base[MAX_LEN], power[MAX_LEN], res[MAX_LEN];
+	size_t res_len;
+	struct os_time start;
+	char title[40];
+	int i;
+
+	if (dh == NULL)
+		return;
+
+	fill(base, dh->prime_len, id);
+	base[0] &= 0x7f;
+	fill(power, dh->prime_len, id + 1);
+
+	/* Build the fixed-base table before timing */
+	res_len = sizeof(res);
+	if (crypto_mod_exp(dh->generator, dh->generator_len, power,
+			   dh->prime_len, dh->prime, dh->prime_len, res,
+			   &res_len) < 0)
+		return;
+
+	os_snprintf(title, sizeof(title), "group %d g^x (fixed base)", id);
+	os_get_time(&start);
+	for (i = 0; i < num; i++) {
+		power[0] = i;
+		res_len = sizeof(res);
+		if (crypto_mod_exp(dh->generator, dh->generator_len, power,
+				   dh->prime_len, dh->prime, dh->prime_len,
+				   res, &res_len) < 0)
+			break;
+	}
+	bench_time(title, &start, num);
+
+	os_snprintf(title, sizeof(title), "group %d y^x (variable base)", id);
+	os_get_time(&start);
+	for (i = 0; i < num; i++) {
+		power[0] = i;
+		res_len = sizeof(res);
+		if (crypto_mod_exp(base, dh->prime_len, power, dh->prime_len,
+				   dh->prime, dh->prime_len, res, &res_len) < 0)
+			break;
+	}
+	bench_time(title, &start, num);
+}
+
+
+int main(int argc, char *argv[])
+{
+	int ret = 0;
+
+	if (argc > 1)
+		num_ops = atoi(argv[1]);
+	if (num_ops < 1)
+		num_ops = 1;
+
+	ret += test_group(5);
+
+	bench(5, num_ops);
+
+	bignum_global_deinit();
+
+	return ret;
+}
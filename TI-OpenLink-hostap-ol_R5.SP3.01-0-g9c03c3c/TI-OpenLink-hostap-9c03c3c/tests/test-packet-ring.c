@@ -0,0 +1,246 @@
+/*
+ * Test program and benchmark for the memory mapped packet socket rings
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Frames are sent in bursts on the loopback interface to an echo socket that
+ * returns each frame with a different ethertype. The echo socket is run
+ * first with recv()/send() and then with the RX/TX rings and the time spent
+ * on the echo side is reported for both. This needs CAP_NET_RAW; the test is
+ * skipped if a packet socket cannot be opened.
+ */
+
+#include "includes.h"
+#include <poll.h>
+#include <net/if.h>
+#include <linux/if_packet.h>
+
+#include "common.h"
+#include "eloop.h"
+#include "l2_packet/packet_ring.h"
+
+
+#define ETH_P_TEST_REQ 0x88b5
+#define ETH_P_TEST_REPLY 0x88b6
+#define TEST_FRAME_LEN 128
+#define TEST_BURST 32
+
+struct echo {
+	int sock;
+	struct packet_ring *ring;
+	int count;
+	int errors;
+};
+
+
+static int open_sock(int ifindex, u16 proto)
+{
+	struct sockaddr_ll ll;
+	int sock;
+
+	sock = socket(PF_PACKET, SOCK_RAW, htons(proto));
+	if (sock < 0)
+		return -1;
+	os_memset(&ll, 0, sizeof(ll));
+	ll.sll_family = PF_PACKET;
+	ll.sll_ifindex = ifindex;
+	ll.sll_protocol = htons(proto);
+	if (bind(sock, (struct sockaddr *) &ll, sizeof(ll)) < 0) {
+		perror("bind");
+		close(sock);
+		return -1;
+	}
+	return sock;
+}
+
+
+static int wait_readable(int sock)
+{
+	struct pollfd pfd;
+
+	pfd.fd = sock;
+	pfd.events = POLLIN;
+	return poll(&pfd, 1, 1000) == 1 ? 0 : -1;
+}
+
+
+static void make_reply(u8 *buf)
+{
+	WPA_PUT_BE16(buf + 12, ETH_P_TEST_REPLY);
+}
+
+
+static void echo_plain(struct echo *e)
+{
+	u8 buf[2000];
+	int len;
+
+	while ((len = recv(e->sock, buf, sizeof(buf), MSG_DONTWAIT)) >= 0) {
+		e->count++;
+		make_reply(buf);
+		if (send(e->sock, buf, len, 0) < 0)
+			e->errors++;
+	}
+}
+
+
+static void echo_ring_frame(void *ctx, const u8 *buf, size_t len,
+			    const struct sockaddr_ll *ll)
+{
+	struct echo *e = ctx;
+	u8 reply[2000];
+
+	e->count++;
+	if (len > sizeof(reply)) {
+		e->errors++;
+		return;
+	}
+	os_memcpy(reply, buf, len);
+	make_reply(reply);
+	if (packet_ring_send(e->ring, NULL, 0, reply, len) < 0 &&
+	    send(e->sock, reply, len, 0) < 0)
+		e->errors++;
+}
+
+
+static void echo_ring(struct echo *e)
+{
+	packet_ring_rx(e->ring, echo_ring_frame, e);
+}
+
+
+static double usec_since(struct os_time *start)
+{
+	struct os_time now, diff;
+
+	os_get_time(&now);
+	os_time_sub(&now, start, &diff);
+	return diff.sec * 1000000.0 + diff.usec;
+}
+
+
+static int run(const char *title, int ifindex, int use_ring, int count)
+{
+	struct echo e;
+	int sock, sent, i, n, len, ret = -1;
+	u8 buf[2000];
+	u32 seq = 0;
+	double usec = 0;
+	struct os_time start;
+
+	os_memset(&e, 0, sizeof(e));
+	sock = open_sock(ifindex, ETH_P_TEST_REPLY);
+	e.sock = open_sock(ifindex, ETH_P_TEST_REQ);
+	if (sock < 0 || e.sock < 0) {
+		printf("%s: could not open sockets - FAILED!\n", title);
+		goto done;
+	}
+	if (use_ring) {
+		e.ring = packet_ring_init(e.sock, 64, 64);
+		if (e.ring == NULL) {
+			printf("%s: rings not supported - SKIPPED\n", title);
+			ret = 0;
+			goto done;
+		}
+	}
+
+	os_memset(buf, 0, sizeof(buf));
+	WPA_PUT_BE16(buf + 12, ETH_P_TEST_REQ);
+	for (sent = 0; sent < count; sent += n) {
+		n = count - sent < TEST_BURST ? count - sent : TEST_BURST;
+		for (i = 0; i < n; i++) {
+			WPA_PUT_BE32(buf + 14, sent + i);
+			if (send(sock, buf, TEST_FRAME_LEN, 0) < 0) {
+				perror("send");
+				goto done;
+			}
+		}
+
+		while (e.count < sent + n) {
+			if (wait_readable(e.sock) < 0) {
+				printf("%s: lost request - FAILED!\n", title);
+				goto done;
+			}
+			os_get_time(&start);
+			if (use_ring)
+				echo_ring(&e);
+			else
+				echo_plain(&e);
+			usec += usec_since(&start);
+		}
+
+		for (i = 0; i < n; i++) {
+			if (wait_readable(sock) < 0) {
+				printf("%s: lost reply - FAILED!\n", title);
+				goto done;
+			}
+			len = recv(sock, buf, sizeof(buf), 0);
+			if (len != TEST_FRAME_LEN ||
+			    WPA_GET_BE16(buf + 12) != ETH_P_TEST_REPLY ||
+			    WPA_GET_BE32(buf + 14) != seq) {
+				printf("%s: unexpected reply %u - FAILED!\n",
+				       title, seq);
+				goto done;
+			}
+			seq++;
+		}
+		WPA_PUT_BE16(buf + 12, ETH_P_TEST_REQ);
+	}
+
+	if (e.errors) {
+		printf("%s: %d send errors - FAILED!\n", title, e.errors);
+		goto done;
+	}
+	printf("%-10s %8d frames %10.0f us %8.3f us/frame\n", title, count,
+	       usec, count ? usec / count : 0.0);
+	ret = 0;
+
+done:
+	packet_ring_deinit(e.ring);
+	if (e.sock >= 0)
+		close(e.sock);
+	if (sock >= 0)
+		close(sock);
+	return ret;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int count = 10000, ifindex, sock;
+	const char *ifname = "lo";
+
+	if (argc > 1)
+		count = atoi(argv[1]);
+	if (argc > 2)
+		ifname = argv[2];
+
+	ifindex = if_nametoindex(ifname);
+	if (ifindex == 0) {
+		printf("Interface %s not found - SKIPPED\n", ifname);
+		return 0;
+	}
+	sock = socket(PF_PACKET, SOCK_RAW, 0);
+	if (sock < 0) {
+		printf("Packet socket: %s - SKIPPED\n", strerror(errno));
+		return 0;
+	}
+	close(sock);
+
+	if (eloop_init() < 0) {
+		printf("Failed to initialize eloop\n");
+		return -1;
+	}
+
+	if (run("recv/send", ifindex, 0, count) < 0 ||
+	    run("rings", ifindex, 1, count) < 0) {
+		eloop_destroy();
+		return -1;
+	}
+
+	eloop_destroy();
+
+	return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * Test program and benchmark for batched PBKDF2-SHA1
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "crypto/sha1.h"
+
+
+#define PSK_LEN 32
+
+static int num_psk = 32;
+
+
+static void bench_time(const char *title, struct os_time *start, int count)
+{
+	struct os_time now, diff;
+	double usec;
+
+	os_get_time(&now);
+	os_time_sub(&now, start, &diff);
+	usec = diff.sec * 1000000.0 + diff.usec;
+	printf("%-30s %8d ops %10.0f us %8.1f us/op\n", title, count, usec,
+	       count ? usec / count : 0.0);
+}
+
+
+/* Straightforward PBKDF2 with HMAC-SHA1 as the reference */
+static void ref_pbkdf2_sha1(const char *passphrase, const char *ssid,
+			    size_t ssid_len, int iterations, u8 *buf,
+			    size_t buflen)
+{
+	unsigned int count = 0;
+	u8 tmp[SHA1_MAC_LEN], tmp2[SHA1_MAC_LEN], digest[SHA1_MAC_LEN];
+	u8 count_buf[4];
+	const u8 *addr[2];
+	size_t len[2], plen, plen_total = os_strlen(passphrase);
+	int i, j;
+
+	addr[0] = (const u8 *) ssid;
+	len[0] = ssid_len;
+	addr[1] = count_buf;
+	len[1] = 4;
+
+	while (buflen > 0) {
+		count++;
+		WPA_PUT_BE32(count_buf, count);
+		hmac_sha1_vector((const u8 *) passphrase, plen_total, 2, addr,
+				 len, tmp);
+		os_memcpy(digest, tmp, SHA1_MAC_LEN);
+		for (i = 1; i < iterations; i++) {
+			hmac_sha1((const u8 *) passphrase, plen_total, tmp,
+				  SHA1_MAC_LEN, tmp2);
+			os_memcpy(tmp, tmp2, SHA1_MAC_LEN);
+			for (j = 0; j < SHA1_MAC_LEN; j++)
+				digest[j] ^= tmp2[j];
+		}
+		plen = buflen > SHA1_MAC_LEN ? SHA1_MAC_LEN : buflen;
+		os_memcpy(buf, digest, plen);
+		buf += plen;
+		buflen -= plen;
+	}
+}
+
+
+static int test_batch(int num, size_t buflen, int iterations)
+{
+	char **pass;
+	u8 **buf, ref[64];
+	int i, j, ret = 0;
+
+	pass = os_zalloc(num * sizeof(char *));
+	buf = os_zalloc(num * sizeof(u8 *));
+	if (pass == NULL || buf == NULL)
+		return 1;
+
+	for (i = 0; i < num; i++) {
+		/* Cover passphrase lengths from 8 to 100 characters; longer
+		 * than 64 means the HMAC key is hashed first */
+		int len = 8 + (i * 13) % 93;
+		pass[i] = os_malloc(len + 1);
+		buf[i] = os_malloc(buflen);
+		if (pass[i] == NULL || buf[i] == NULL)
+			return 1;
+		for (j = 0; j < len; j++)
+			pass[i][j] = 'a' + (i + j * 7) % 26;
+		pass[i][len] = '\0';
+	}
+
+	if (pbkdf2_sha1_batch((const char **) pass, "test network", 12,
+			      iterations, buf, buflen, num) < 0) {
+		printf("pbkdf2_sha1_batch() failed\n");
+		ret++;
+	}
+
+	for (i = 0; i < num && !ret; i++) {
+		ref_pbkdf2_sha1(pass[i], "test network", 12, iterations, ref,
+				buflen);
+		if (os_memcmp(ref, buf[i], buflen) != 0) {
+			printf("Batch entry %d (len=%lu) mismatch\n", i,
+			       (unsigned long) os_strlen(pass[i]));
+			ret++;
+		}
+	}
+
+	for (i = 0; i < num; i++) {
+		os_free(pass[i]);
+		os_free(buf[i]);
+	}
+	os_free(pass);
+	os_free(buf);
+
+	printf("Batch of %d, %lu octets, %d iterations - %s\n", num,
+	       (unsigned long) buflen, iterations, ret ? "FAILED!" : "OK");
+	return ret;
+}
+
+
+static void bench(int num)
+{
+	char **pass;
+	u8 **buf, psk[PSK_LEN];
+	struct os_time start;
+	int i;
+
+	pass = os_zalloc(num * sizeof(char *));
+	buf = os_zalloc(num * sizeof(u8 *));
+	if (pass == NULL || buf == NULL)
+		return;
+	for (i = 0; i < num; i++) {
+		pass[i] = os_malloc(32);
+		buf[i] = os_malloc(PSK_LEN);
+		if (pass[i] == NULL || buf[i] == NULL)
+			return;
+		os_snprintf(pass[i], 32, "passphrase-%d", i);
+	}
+
+	os_get_time(&start);
+	for (i = 0; i < num; i++)
+		ref_pbkdf2_sha1(pass[i], "bench", 5, 4096, psk, PSK_LEN);
+	bench_time("PSK (HMAC-SHA1 reference)", &start, num);
+
+	os_get_time(&start);
+	for (i = 0; i < num; i++)
+		pbkdf2_sha1(pass[i], "bench", 5, 4096, psk, PSK_LEN);
+	bench_time("PSK (pbkdf2_sha1)", &start, num);
+
+	os_get_time(&start);
+	pbkdf2_sha1_batch((const char **) pass, "bench", 5, 4096, buf,
+			  PSK_LEN, num);
+	bench_time("PSK (pbkdf2_sha1_batch)", &start, num);
+
+	for (i = 0; i < num; i++) {
+		os_free(pass[i]);
+		os_free(buf[i]);
+	}
+	os_free(pass);
+	os_free(buf);
+}
+
+
+int main(int argc, char *argv[])
+{
+	int ret = 0;
+
+	if (argc > 1)
+		num_psk = atoi(argv[1]);
+	if (num_psk < 1)
+		num_psk = 1;
+
+	/* Odd sizes leave some of the parallel lanes unused */
+	ret += test_batch(1, PSK_LEN, 4096);
+	ret += test_batch(3, 25, 100);
+	ret += test_batch(17, PSK_LEN, 1000);
+	ret += test_batch(9, 64, 2);
+	ret += test_batch(5, 16, 1);
+
+	bench(num_psk);
+
+	return ret;
+}
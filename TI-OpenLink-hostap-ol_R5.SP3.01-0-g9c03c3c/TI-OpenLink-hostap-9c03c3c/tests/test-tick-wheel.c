@@ -0,0 +1,222 @@
+/*
+ * Test program and microbenchmark for the shared one second timer wheel
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "eloop.h"
+#include "tick_wheel.h"
+
+
+#define LAST_TICK 4
+
+struct test_timer {
+	struct tick_wheel_entry entry;
+	int fired; /* tick on which the handler was called */
+};
+
+static struct tick_wheel *wheel;
+static struct test_timer periodic, once, removed, readded, rounds;
+static struct test_timer first, second;
+static int ticks;
+static int errors;
+
+
+static void bench_time(const char *title, struct os_time *start, int count)
+{
+	struct os_time now, diff;
+	double usec;
+
+	os_get_time(&now);
+	os_time_sub(&now, start, &diff);
+	usec = diff.sec * 1000000.0 + diff.usec;
+	printf("%-30s %8d ops %10.0f us %8.3f us/op\n", title, count, usec,
+	       count ? usec / count : 0.0);
+}
+
+
+static void test_fired(void *eloop_ctx, void *timeout_ctx)
+{
+	struct test_timer *t = timeout_ctx;
+
+	if (t->fired) {
+		printf("Timer fired twice\n");
+		errors++;
+	}
+	t->fired = ticks + 1;
+}
+
+
+static void test_first(void *eloop_ctx, void *timeout_ctx)
+{
+	test_fired(eloop_ctx, timeout_ctx);
+	/* The other timer expires on the same tick */
+	tick_wheel_del(&second.entry);
+}
+
+
+static void test_periodic(void *eloop_ctx, void *timeout_ctx)
+{
+	ticks++;
+	if (ticks == 1) {
+		/* Relative to this tick */
+		tick_wheel_add(wheel, &readded.entry, 3, test_fired, NULL,
+			       &readded);
+		/* Same slot as tick 2, but one round later */
+		tick_wheel_add(wheel, &rounds.entry, 256 + 1, test_fired, NULL,
+			       &rounds);
+	}
+	if (ticks == LAST_TICK) {
+		eloop_terminate();
+		return;
+	}
+	tick_wheel_add(wheel, &periodic.entry, 1, test_periodic, NULL, NULL);
+}
+
+
+static int check_fired(const char *name, struct test_timer *t, int min,
+		       int max)
+{
+	if (t->fired < min || t->fired > max) {
+		printf("%s: fired on tick %d (expected %d..%d) - FAILED!\n",
+		       name, t->fired, min, max);
+		return 1;
+	}
+	return 0;
+}
+
+
+static int test_ticks(void)
+{
+	int ret = 0;
+
+	wheel = tick_wheel_init();
+	if (wheel == NULL)
+		return 1;
+
+	/* The first timer starts the wheel, so the others are one tick late */
+	tick_wheel_add(wheel, &periodic.entry, 1, test_periodic, NULL, NULL);
+	tick_wheel_add(wheel, &once.entry, 2, test_fired, NULL, &once);
+	tick_wheel_add(wheel, &removed.entry, 1, test_fired, NULL, &removed);
+	tick_wheel_add(wheel, &readded.entry, 1, test_fired, NULL, &readded);
+	tick_wheel_add(wheel, &first.entry, 1, test_first, NULL, &first);
+	tick_wheel_add(wheel, &second.entry, 1, test_fired, NULL, &second);
+	tick_wheel_del(&removed.entry);
+
+	eloop_run();
+
+	ret += check_fired("periodic", &periodic, 0, 0);
+	ret += check_fired("once", &once, 3, 3);
+	ret += check_fired("removed", &removed, 0, 0);
+	ret += check_fired("readded", &readded, 4, 4);
+	ret += check_fired("rounds", &rounds, 0, 0);
+	ret += check_fired("first", &first, 2, 2);
+	ret += check_fired("second", &second, 0, 0);
+	if (ticks != LAST_TICK) {
+		printf("%d ticks - FAILED!\n", ticks);
+		ret++;
+	}
+
+	/* Timers that are left on the wheel must be safe to remove */
+	tick_wheel_deinit(wheel);
+	tick_wheel_del(&rounds.entry);
+	wheel = NULL;
+
+	/* Without a wheel, separate eloop timeouts are used */
+	tick_wheel_add(NULL, &once.entry, 10, test_fired, NULL, &once);
+	if (!eloop_is_timeout_registered(test_fired, NULL, &once)) {
+		printf("eloop timeout not registered - FAILED!\n");
+		ret++;
+	}
+	tick_wheel_del(&once.entry);
+	if (eloop_is_timeout_registered(test_fired, NULL, &once)) {
+		printf("eloop timeout not cancelled - FAILED!\n");
+		ret++;
+	}
+
+	if (ret == 0 && errors == 0)
+		printf("Timer wheel ticks - OK\n");
+	return ret + errors;
+}
+
+
+static void test_never(void *eloop_ctx, void *timeout_ctx)
+{
+	errors++;
+}
+
+
+static void bench(int count)
+{
+	struct test_timer *timers;
+	struct os_time start;
+	int i;
+
+	timers = os_zalloc(count * sizeof(*timers));
+	wheel = tick_wheel_init();
+	if (timers == NULL || wheel == NULL) {
+		os_free(timers);
+		tick_wheel_deinit(wheel);
+		return;
+	}
+
+	for (i = 0; i < count; i++)
+		eloop_register_timeout(1 + i % 300, 0, test_never, NULL,
+				       &timers[i]);
+	/* Restart each timer as is done for the per-STA timers */
+	os_get_time(&start);
+	for (i = 0; i < count; i++) {
+		eloop_cancel_timeout(test_never, NULL, &timers[i]);
+		eloop_register_timeout(1 + i % 300, 0, test_never, NULL,
+				       &timers[i]);
+	}
+	bench_time("eloop restart", &start, count);
+	os_get_time(&start);
+	for (i = 0; i < count; i++)
+		eloop_cancel_timeout(test_never, NULL, &timers[i]);
+	bench_time("eloop cancel", &start, count);
+
+	for (i = 0; i < count; i++)
+		tick_wheel_add(wheel, &timers[i].entry, 1 + i % 300,
+			       test_never, NULL, &timers[i]);
+	os_get_time(&start);
+	for (i = 0; i < count; i++)
+		tick_wheel_add(wheel, &timers[i].entry, 1 + i % 300,
+			       test_never, NULL, &timers[i]);
+	bench_time("tick wheel restart", &start, count);
+	os_get_time(&start);
+	for (i = 0; i < count; i++)
+		tick_wheel_del(&timers[i].entry);
+	bench_time("tick wheel del", &start, count);
+
+	tick_wheel_deinit(wheel);
+	wheel = NULL;
+	os_free(timers);
+}
+
+
+int main(int argc, char *argv[])
+{
+	int ret, count = 10000;
+
+	if (argc > 1)
+		count = atoi(argv[1]);
+
+	if (eloop_init() < 0) {
+		printf("Failed to initialize eloop\n");
+		return -1;
+	}
+
+	ret = test_ticks();
+	if (ret == 0)
+		bench(count);
+
+	eloop_destroy();
+
+	return ret;
+}
@@ -0,0 +1,437 @@
+/*
+ * Test program for paced GTK rekeying in the WPA authenticator
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * src/ap/wpa_auth.c is linked in with stubs for the PMKSA cache functions it
+ * uses. The STAs are set up as if the 4-way handshake had been completed and
+ * each one replies to the group key msg 1/2 with a valid msg 2/2 shortly after
+ * it has been sent. A GTK rekey is requested with an EAPOL-Key Request frame
+ * and the number of group key handshakes in progress at a time, the rekey
+ * duration, and the completion counters of the group are checked once the
+ * rekey has completed.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "eloop.h"
+#include "common/defs.h"
+#include "common/eapol_common.h"
+#include "common/wpa_common.h"
+#include "ap/wpa_auth.h"
+#include "ap/pmksa_cache_auth.h"
+#include "ap/wpa_auth_i.h"
+
+
+#define NUM_STA 40
+#define REPLY_USEC 20000
+
+struct test_sta {
+	struct wpa_state_machine *sm;
+	int vlan_id;
+	int pending; /* msg 1/2 sent; msg 2/2 not yet received */
+	int moved;
+	u8 replay_counter[WPA_REPLAY_COUNTER_LEN];
+};
+
+static struct wpa_authenticator *auth;
+static struct test_sta stas[NUM_STA];
+static int in_flight, max_in_flight, handshakes;
+static int timed_out;
+static u8 req_counter;
+
+
+struct rsn_pmksa_cache *
+pmksa_cache_auth_init(void (*free_cb)(struct rsn_pmksa_cache_entry *entry,
+				      void *ctx), void *ctx)
+{
+	/* Only checked for NULL; never dereferenced */
+	return (struct rsn_pmksa_cache *) &auth;
+}
+
+
+void pmksa_cache_auth_deinit(struct rsn_pmksa_cache *pmksa)
+{
+}
+
+
+void pmksa_cache_auth_set_max_mem(struct rsn_pmksa_cache *pmksa,
+				  size_t max_mem)
+{
+}
+
+
+struct rsn_pmksa_cache_entry *
+pmksa_cache_auth_get(struct rsn_pmksa_cache *pmksa,
+		     const u8 *spa, const u8 *pmkid)
+{
+	return NULL;
+}
+
+
+struct rsn_pmksa_cache_entry * pmksa_cache_get_okc(
+	struct rsn_pmksa_cache *pmksa, const u8 *spa, const u8 *aa,
+	const u8 *pmkid)
+{
+	return NULL;
+}
+
+
+struct rsn_pmksa_cache_entry *
+pmksa_cache_auth_add(struct rsn_pmksa_cache *pmksa,
+		     const u8 *pmk, size_t pmk_len,
+		     const u8 *aa, const u8 *spa, int session_timeout,
+		     struct eapol_state_machine *eapol, int akmp)
+{
+	return NULL;
+}
+
+
+struct rsn_pmksa_cache_entry *
+pmksa_cache_add_okc(struct rsn_pmksa_cache *pmksa,
+		    const struct rsn_pmksa_cache_entry *old_entry,
+		    const u8 *aa, const u8 *pmkid)
+{
+	return NULL;
+}
+
+
+int pmksa_cache_auth_write(struct rsn_pmksa_cache *pmksa, const char *fname)
+{
+	return -1;
+}
+
+
+int pmksa_cache_auth_read(struct rsn_pmksa_cache *pmksa, const char *fname)
+{
+	return -1;
+}
+
+
+void pmksa_cache_auth_set_store(struct rsn_pmksa_cache *pmksa,
+				struct state_store *store, const u8 *addr)
+{
+}
+
+
+static struct test_sta * get_sta(const u8 *addr)
+{
+	int i;
+
+	for (i = 0; i < NUM_STA; i++) {
+		if (stas[i].sm && os_memcmp(stas[i].sm->addr, addr, ETH_ALEN)
+		    == 0)
+			return &stas[i];
+	}
+	return NULL;
+}
+
+
+static int rekey_done(void)
+{
+	struct wpa_group *group;
+
+	for (group = auth->group; group; group = group->next) {
+		if (group->wpa_group_state != WPA_GROUP_SETKEYSDONE)
+			return 0;
+	}
+	return 1;
+}
+
+
+static void test_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	timed_out = 1;
+	eloop_terminate();
+}
+
+
+static void send_key(struct test_sta *sta, u16 key_info, const u8 *counter)
+{
+	u8 buf[sizeof(struct ieee802_1x_hdr) + sizeof(struct wpa_eapol_key)];
+	struct ieee802_1x_hdr *hdr = (struct ieee802_1x_hdr *) buf;
+	struct wpa_eapol_key *key = (struct wpa_eapol_key *) (hdr + 1);
+
+	os_memset(buf, 0, sizeof(buf));
+	hdr->version = EAPOL_VERSION;
+	hdr->type = IEEE802_1X_TYPE_EAPOL_KEY;
+	hdr->length = host_to_be16(sizeof(*key));
+	key->type = EAPOL_KEY_TYPE_RSN;
+	key_info |= WPA_KEY_INFO_TYPE_HMAC_SHA1_AES | WPA_KEY_INFO_MIC |
+		WPA_KEY_INFO_SECURE;
+	WPA_PUT_BE16(key->key_info, key_info);
+	os_memcpy(key->replay_counter, counter, WPA_REPLAY_COUNTER_LEN);
+	wpa_eapol_key_mic(sta->sm->PTK.kck, WPA_KEY_INFO_TYPE_HMAC_SHA1_AES,
+			  buf, sizeof(buf), key->key_mic);
+	wpa_receive(auth, sta->sm, buf, sizeof(buf));
+}
+
+
+static void test_reply(void *eloop_ctx, void *timeout_ctx)
+{
+	struct test_sta *sta = timeout_ctx;
+
+	if (!sta->pending)
+		return;
+	sta->pending = 0;
+	in_flight--;
+	/* EAPOL-Key msg 2/2 of the Group Key Handshake */
+	send_key(sta, 0, sta->replay_counter);
+	if (rekey_done())
+		eloop_cancel_timeout(test_timeout, NULL, NULL);
+}
+
+
+static void test_move(void *eloop_ctx, void *timeout_ctx)
+{
+	struct test_sta *sta = timeout_ctx;
+
+	if (sta->pending) {
+		sta->pending = 0;
+		in_flight--;
+	}
+	sta->moved = 1;
+	sta->vlan_id = 1;
+	wpa_auth_sta_set_vlan(sta->sm, 1);
+	if (rekey_done())
+		eloop_cancel_timeout(test_timeout, NULL, NULL);
+}
+
+
+static int test_send_eapol(void *ctx, const u8 *addr, const u8 *data,
+			   size_t data_len, int encrypt)
+{
+	const struct ieee802_1x_hdr *hdr;
+	const struct wpa_eapol_key *key;
+	struct test_sta *sta;
+	int *move = ctx;
+
+	sta = get_sta(addr);
+	if (sta == NULL || data_len < sizeof(*hdr) + sizeof(*key))
+		return -1;
+	hdr = (const struct ieee802_1x_hdr *) data;
+	key = (const struct wpa_eapol_key *) (hdr + 1);
+	if (WPA_GET_BE16(key->key_info) & WPA_KEY_INFO_KEY_TYPE)
+		return 0;
+
+	os_memcpy(sta->replay_counter, key->replay_counter,
+		  WPA_REPLAY_COUNTER_LEN);
+	if (sta->pending)
+		return 0; /* retransmitted msg 1/2 */
+	sta->pending = 1;
+	handshakes++;
+	in_flight++;
+	if (in_flight > max_in_flight)
+		max_in_flight = in_flight;
+
+	if (*move && handshakes == 1) {
+		/*
+		 * Move this STA (handshake in progress) and the last STA
+		 * (still queued) to another VLAN before they reply.
+		 */
+		eloop_register_timeout(0, 0, test_move, NULL, sta);
+		eloop_register_timeout(0, 0, test_move, NULL,
+				       &stas[NUM_STA - 1]);
+		return 0;
+	}
+
+	eloop_register_timeout(0, REPLY_USEC, test_reply, NULL, sta);
+	return 0;
+}
+
+
+static int test_set_key(void *ctx, int vlan_id, enum wpa_alg alg,
+			const u8 *addr, int idx, u8 *key, size_t key_len)
+{
+	return 0;
+}
+
+
+static int test_get_seqnum(void *ctx, const u8 *addr, int idx, u8 *seq)
+{
+	os_memset(seq, 0, WPA_KEY_RSC_LEN);
+	return 0;
+}
+
+
+static int test_for_each_sta_vlan(void *ctx, int vlan_id,
+				  int (*cb)(struct wpa_state_machine *sm,
+					    void *ctx), void *cb_ctx)
+{
+	int i;
+
+	for (i = 0; i < NUM_STA; i++) {
+		if (stas[i].sm && stas[i].vlan_id == vlan_id &&
+		    cb(stas[i].sm, cb_ctx))
+			return 1;
+	}
+	return 0;
+}
+
+
+static int test_for_each_sta(void *ctx,
+			     int (*cb)(struct wpa_state_machine *sm,
+				       void *ctx), void *cb_ctx)
+{
+	int i;
+
+	for (i = 0; i < NUM_STA; i++) {
+		if (stas[i].sm && cb(stas[i].sm, cb_ctx))
+			return 1;
+	}
+	return 0;
+}
+
+
+static int test_rekey(const char *title, int rate, int move)
+{
+	struct wpa_auth_config conf;
+	struct wpa_auth_callbacks cb;
+	struct wpa_state_machine *sm;
+	struct wpa_group *group;
+	u8 addr[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	u8 counter[WPA_REPLAY_COUNTER_LEN];
+	int i, batch, moved = move ? 2 : 0, ret = 0;
+
+	os_memset(&conf, 0, sizeof(conf));
+	conf.wpa = WPA_PROTO_RSN;
+	conf.wpa_key_mgmt = WPA_KEY_MGMT_PSK;
+	conf.wpa_pairwise = WPA_CIPHER_CCMP;
+	conf.rsn_pairwise = WPA_CIPHER_CCMP;
+	conf.wpa_group = WPA_CIPHER_CCMP;
+	conf.eapol_version = EAPOL_VERSION;
+	conf.wpa_group_rekey_rate = rate;
+
+	os_memset(&cb, 0, sizeof(cb));
+	cb.ctx = &move;
+	cb.send_eapol = test_send_eapol;
+	cb.set_key = test_set_key;
+	cb.get_seqnum = test_get_seqnum;
+	cb.for_each_sta = test_for_each_sta;
+	cb.for_each_sta_vlan = test_for_each_sta_vlan;
+
+	auth = wpa_init(addr, &conf, &cb);
+	if (auth == NULL || wpa_init_keys(auth) < 0) {
+		printf("%s: WPA authenticator initialization - FAILED!\n",
+		       title);
+		return 1;
+	}
+
+	os_memset(stas, 0, sizeof(stas));
+	for (i = 0; i < NUM_STA; i++) {
+		addr[5] = i + 1;
+		sm = wpa_auth_sta_init(auth, addr);
+		if (sm == NULL)
+			return 1;
+		/* As if the 4-way handshake had been completed */
+		sm->wpa = WPA_VERSION_WPA2;
+		sm->wpa_key_mgmt = WPA_KEY_MGMT_PSK;
+		sm->pairwise = WPA_CIPHER_CCMP;
+		sm->started = 1;
+		sm->Pair = TRUE;
+		sm->PTK_valid = TRUE;
+		sm->has_GTK = TRUE;
+		sm->wpa_ptk_state = WPA_PTK_PTKINITDONE;
+		sm->wpa_ptk_group_state = WPA_PTK_GROUP_IDLE;
+		stas[i].sm = sm;
+	}
+
+	in_flight = max_in_flight = handshakes = 0;
+	timed_out = 0;
+	eloop_register_timeout(10, 0, test_timeout, NULL, NULL);
+
+	/* EAPOL-Key Request for GTK rekeying */
+	os_memset(counter, 0, sizeof(counter));
+	counter[WPA_REPLAY_COUNTER_LEN - 1] = ++req_counter;
+	send_key(&stas[0], WPA_KEY_INFO_REQUEST, counter);
+	eloop_run();
+
+	group = auth->group;
+	batch = rate > 10 ? rate / 10 : 1;
+	if (timed_out || !rekey_done()) {
+		printf("%s: GTK rekey did not complete (GKeyDoneStations=%d) "
+		       "- FAILED!\n", title, group->GKeyDoneStations);
+		ret++;
+	}
+	if (group->GKeyDoneStations != 0 ||
+	    group->rekey_stations != (unsigned int) (NUM_STA - moved) ||
+	    group->rekey_done != (unsigned int) (NUM_STA - moved) ||
+	    group->rekey_failed != 0 || !dl_list_empty(&group->gkey_queue)) {
+		printf("%s: %d pending, %u/%u STAs completed (%u failed) - "
+		       "FAILED!\n", title, group->GKeyDoneStations,
+		       group->rekey_done, group->rekey_stations,
+		       group->rekey_failed);
+		ret++;
+	}
+	for (i = 0; i < NUM_STA; i++) {
+		if (stas[i].sm->GUpdateStationKeys || stas[i].sm->gkey_queued ||
+		    stas[i].pending) {
+			printf("%s: STA %d still has a group key update "
+			       "pending - FAILED!\n", title, i);
+			ret++;
+			break;
+		}
+		if (stas[i].moved &&
+		    stas[i].sm->group->vlan_id != stas[i].vlan_id) {
+			printf("%s: STA %d not moved - FAILED!\n", title, i);
+			ret++;
+			break;
+		}
+	}
+
+	if (rate > 0) {
+		/* Handshakes are started in batches every 100 ms */
+		if (max_in_flight > batch) {
+			printf("%s: %d handshakes in progress at a time (rate "
+			       "%d/s) - FAILED!\n", title, max_in_flight, rate);
+			ret++;
+		}
+		if (group->rekey_duration <
+		    (unsigned int) ((NUM_STA + batch - 1) / batch - 1) * 100) {
+			printf("%s: rekey completed in %u ms - FAILED!\n",
+			       title, group->rekey_duration);
+			ret++;
+		}
+	} else if (max_in_flight != NUM_STA) {
+		printf("%s: %d/%d handshakes started at once - FAILED!\n",
+		       title, max_in_flight, NUM_STA);
+		ret++;
+	}
+
+	if (ret == 0)
+		printf("%s: %u STAs in %u ms, at most %d at a time - OK\n",
+		       title, group->rekey_done, group->rekey_duration,
+		       max_in_flight);
+
+	eloop_cancel_timeout(test_timeout, NULL, NULL);
+	eloop_cancel_timeout(test_reply, NULL, ELOOP_ALL_CTX);
+	eloop_cancel_timeout(test_move, NULL, ELOOP_ALL_CTX);
+	for (i = 0; i < NUM_STA; i++)
+		wpa_auth_sta_deinit(stas[i].sm);
+	wpa_deinit(auth);
+	auth = NULL;
+
+	return ret;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int ret = 0;
+
+	if (eloop_init() < 0) {
+		printf("Failed to initialize eloop\n");
+		return -1;
+	}
+
+	ret += test_rekey("All at once", 0, 0);
+	ret += test_rekey("Paced", 50, 0);
+	ret += test_rekey("Paced with VLAN change", 50, 1);
+
+	eloop_destroy();
+
+	return ret;
+}
@@ -0,0 +1,419 @@
+/*
+ * Capture file ingest benchmark for wlantest
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * A synthetic capture with CCMP protected Data frames from a number of BSSes
+ * and STAs is written into a temporary file and read back with the memory
+ * mapped reader. The frames are decrypted both in the main thread and through
+ * the decryption worker threads, and the results are verified.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "common/defs.h"
+#include "common/ieee802_11_defs.h"
+#include "wlantest.h"
+
+
+#define NUM_BSS 8
+#define NUM_STA 16 /* per BSS */
+#define PAYLOAD_LEN 1500
+#define READ_AHEAD 1024
+
+static u8 bench_tk[NUM_BSS][NUM_STA][16];
+
+
+static void bench_time(const char *title, struct os_time *start, int count,
+		       unsigned long long bytes)
+{
+	struct os_time now, diff;
+	double usec;
+
+	os_get_time(&now);
+	os_time_sub(&now, start, &diff);
+	usec = diff.sec * 1000000.0 + diff.usec;
+	if (usec < 1)
+		usec = 1;
+	printf("%-30s %8d frames %10.0f us %10.0f frames/s %8.1f MB/s\n",
+	       title, count, usec, count * 1000000.0 / usec, bytes / usec);
+}
+
+
+static void fill(u8 *buf, size_t len, unsigned int seed)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		seed = seed * 1103515245 + 12345;
+		buf[i] = seed >> 16;
+	}
+}
+
+
+static void put_u32(FILE *f, u32 val, int be)
+{
+	u8 buf[4];
+
+	if (be)
+		WPA_PUT_BE32(buf, val);
+	else
+		WPA_PUT_LE32(buf, val);
+	fwrite(buf, 4, 1, f);
+}
+
+
+static void put_u16(FILE *f, u16 val, int be)
+{
+	u8 buf[2];
+
+	if (be)
+		WPA_PUT_BE16(buf, val);
+	else
+		WPA_PUT_LE16(buf, val);
+	fwrite(buf, 2, 1, f);
+}
+
+
+/* Frame number i is from/to STA (i % NUM_STA) in BSS (i / NUM_STA % NUM_BSS) */
+static u8 * bench_frame(int i, size_t *len)
+{
+	u8 frame[24 + PAYLOAD_LEN], pn[6];
+	struct ieee80211_hdr *hdr = (struct ieee80211_hdr *) frame;
+	int bss = i / NUM_STA % NUM_BSS, sta = i % NUM_STA;
+	u8 bssid[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	u8 addr[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x01, 0x00, 0x00 };
+	int to_ds = (i / (NUM_STA * NUM_BSS)) & 1;
+
+	bssid[5] = bss;
+	addr[4] = bss;
+	addr[5] = sta;
+
+	os_memset(frame, 0, 24);
+	hdr->frame_control = host_to_le16((WLAN_FC_TYPE_DATA << 2) |
+					  (WLAN_FC_STYPE_DATA << 4) |
+					  (to_ds ? WLAN_FC_TODS :
+					   WLAN_FC_FROMDS));
+	os_memcpy(hdr->addr1, to_ds ? bssid : addr, ETH_ALEN);
+	os_memcpy(hdr->addr2, to_ds ? addr : bssid, ETH_ALEN);
+	os_memcpy(hdr->addr3, bssid, ETH_ALEN);
+	hdr->seq_ctrl = host_to_le16((i & 0xfff) << 4);
+	fill(frame + 24, PAYLOAD_LEN, i);
+
+	os_memset(pn, 0, sizeof(pn));
+	WPA_PUT_BE32(pn + 2, i + 1);
+	return ccmp_encrypt(bench_tk[bss][sta], frame, sizeof(frame), 24, NULL,
+			    pn, 0, len);
+}
+
+
+static const u8 * bench_tk_frame(const struct ieee80211_hdr *hdr)
+{
+	u16 fc = le_to_host16(hdr->frame_control);
+	const u8 *addr = (fc & WLAN_FC_TODS) ? hdr->addr2 : hdr->addr1;
+
+	return bench_tk[addr[4] % NUM_BSS][addr[5] % NUM_STA];
+}
+
+
+static int bench_write(const char *fname, int num, int ng, int be)
+{
+	FILE *f;
+	u8 *frame;
+	size_t len, pad;
+	int i;
+
+	f = fopen(fname, "wb");
+	if (f == NULL)
+		return -1;
+
+	if (ng) {
+		/* Section Header Block */
+		put_u32(f, 0x0a0d0d0a, be);
+		put_u32(f, 28, be);
+		put_u32(f, 0x1a2b3c4d, be);
+		put_u16(f, 1, be);
+		put_u16(f, 0, be);
+		put_u32(f, 0xffffffff, be);
+		put_u32(f, 0xffffffff, be);
+		put_u32(f, 28, be);
+		/* Interface Description Block with if_tsresol = 10^-9 */
+		put_u32(f, 1, be);
+		put_u32(f, 32, be);
+		put_u16(f, LINKTYPE_IEEE802_11, be);
+		put_u16(f, 0, be);
+		put_u32(f, 65535, be);
+		put_u16(f, 9, be);
+		put_u16(f, 1, be);
+		put_u32(f, 0x09000000, 1); /* value 9 and padding */
+		put_u32(f, 0, be);
+		put_u32(f, 32, be);
+	} else {
+		put_u32(f, 0xa1b2c3d4, be);
+		put_u16(f, 2, be);
+		put_u16(f, 4, be);
+		put_u32(f, 0, be);
+		put_u32(f, 0, be);
+		put_u32(f, 65535, be);
+		put_u32(f, LINKTYPE_IEEE802_11, be);
+	}
+
+	for (i = 0; i < num; i++) {
+		frame = bench_frame(i, &len);
+		if (frame == NULL)
+			break;
+		if (ng) {
+			u64 ts = (u64) (1000 + i) * 1000000000 + i * 1000;
+			pad = (4 - (len & 3)) & 3;
+			put_u32(f, 6, be);
+			put_u32(f, 32 + len + pad, be);
+			put_u32(f, 0, be);
+			put_u32(f, ts >> 32, be);
+			put_u32(f, ts & 0xffffffff, be);
+			put_u32(f, len, be);
+			put_u32(f, len, be);
+			fwrite(frame, len, 1, f);
+			fwrite("\0\0\0", pad, 1, f);
+			put_u32(f, 32 + len + pad, be);
+		} else {
+			put_u32(f, 1000 + i, be);
+			put_u32(f, i, be);
+			put_u32(f, len, be);
+			put_u32(f, len, be);
+			fwrite(frame, len, 1, f);
+		}
+		os_free(frame);
+	}
+
+	fclose(f);
+	return i == num ? 0 : -1;
+}
+
+
+static int bench_verify(int i, const u8 *decrypted, size_t len)
+{
+	u8 expect[PAYLOAD_LEN];
+
+	if (decrypted == NULL || len != PAYLOAD_LEN) {
+		printf("frame %d: decryption failed\n", i);
+		return -1;
+	}
+	fill(expect, PAYLOAD_LEN, i);
+	if (os_memcmp(decrypted, expect, PAYLOAD_LEN) != 0) {
+		printf("frame %d: decrypted data mismatch\n", i);
+		return -1;
+	}
+	return 0;
+}
+
+
+static int test_formats(const char *pcap_file, const char *tmp, int num)
+{
+	struct pcap_mmap *p, *q;
+	struct pcap_mmap_frame a, b;
+	int i, be, ret = 0;
+
+	for (be = 0; be <= 1; be++) {
+		if (bench_write(tmp, num, 1, be) < 0)
+			return -1;
+		p = pcap_mmap_open(pcap_file);
+		q = pcap_mmap_open(tmp);
+		if (p == NULL || q == NULL) {
+			pcap_mmap_close(p);
+			pcap_mmap_close(q);
+			return -1;
+		}
+		for (i = 0; i < num; i++) {
+			if (pcap_mmap_next(p, &a) != 1 ||
+			    pcap_mmap_next(q, &b) != 1 ||
+			    a.caplen != b.caplen || a.len != b.len ||
+			    a.linktype != b.linktype ||
+			    a.ts.tv_sec != b.ts.tv_sec ||
+			    a.ts.tv_usec != b.ts.tv_usec ||
+			    os_memcmp(a.data, b.data, a.caplen) != 0) {
+				printf("pcapng (%s endian) frame %d does not "
+				       "match pcap\n", be ? "big" : "little",
+				       i);
+				ret = -1;
+				break;
+			}
+		}
+		if (ret == 0 && pcap_mmap_next(q, &b) != 0) {
+			printf("pcapng: extra data at the end\n");
+			ret = -1;
+		}
+		pcap_mmap_close(p);
+		pcap_mmap_close(q);
+		if (ret)
+			break;
+	}
+
+	printf("pcap/pcapng reader - %s\n", ret ? "FAILED!" : "OK");
+	return ret;
+}
+
+
+static int bench_inline(const char *fname, int num)
+{
+	struct pcap_mmap *p;
+	struct pcap_mmap_frame f;
+	struct os_time start;
+	unsigned long long bytes = 0;
+	const struct ieee80211_hdr *hdr;
+	u8 *decrypted;
+	size_t len;
+	int i = 0, ret = 0;
+
+	p = pcap_mmap_open(fname);
+	if (p == NULL)
+		return -1;
+	os_get_time(&start);
+	while (pcap_mmap_next(p, &f) == 1)
+		bytes += f.caplen;
+	bench_time("mmap read", &start, num, bytes);
+	pcap_mmap_close(p);
+
+	p = pcap_mmap_open(fname);
+	if (p == NULL)
+		return -1;
+	os_get_time(&start);
+	while (pcap_mmap_next(p, &f) == 1) {
+		hdr = (const struct ieee80211_hdr *) f.data;
+		decrypted = ccmp_decrypt(bench_tk_frame(hdr), hdr, f.data + 24,
+					 f.caplen - 24, &len);
+		if (bench_verify(i, decrypted, len) < 0)
+			ret = -1;
+		os_free(decrypted);
+		i++;
+	}
+	bench_time("mmap read + decrypt", &start, i, bytes);
+	pcap_mmap_close(p);
+
+	return ret;
+}
+
+
+static int bench_pool(const char *fname, int num, int threads)
+{
+	struct pcap_mmap *p;
+	struct pcap_mmap_frame *frames;
+	struct decrypt_job *jobs, *job;
+	struct decrypt_pool *pool;
+	struct os_time start;
+	unsigned long long bytes = 0;
+	unsigned int head = 0, queued = 0, idx;
+	int i = 0, res = 1, ret = 0;
+	char title[40];
+
+	p = pcap_mmap_open(fname);
+	pool = decrypt_pool_init(threads);
+	frames = os_zalloc(READ_AHEAD * sizeof(*frames));
+	jobs = os_zalloc(READ_AHEAD * sizeof(*jobs));
+	if (p == NULL || pool == NULL || frames == NULL || jobs == NULL) {
+		ret = -1;
+		goto out;
+	}
+
+	os_get_time(&start);
+	for (;;) {
+		while (res > 0 && queued < READ_AHEAD) {
+			idx = (head + queued) % READ_AHEAD;
+			res = pcap_mmap_next(p, &frames[idx]);
+			if (res <= 0)
+				break;
+			job = &jobs[idx];
+			job->hdr = (const struct ieee80211_hdr *)
+				frames[idx].data;
+			job->data = frames[idx].data + 24;
+			job->data_len = frames[idx].caplen - 24;
+			job->bssid = le_to_host16(job->hdr->frame_control) &
+				WLAN_FC_TODS ? job->hdr->addr1 :
+				job->hdr->addr2;
+			decrypt_job_key(job, WPA_CIPHER_CCMP,
+					bench_tk_frame(job->hdr));
+			decrypt_pool_submit(pool, job);
+			bytes += frames[idx].caplen;
+			queued++;
+		}
+		if (queued == 0)
+			break;
+
+		job = &jobs[head];
+		decrypt_pool_wait(pool, job);
+		if (bench_verify(i, job->decrypted, job->decrypted_len) < 0)
+			ret = -1;
+		os_free(job->decrypted);
+		job->decrypted = NULL;
+		head = (head + 1) % READ_AHEAD;
+		queued--;
+		i++;
+	}
+	os_snprintf(title, sizeof(title), "mmap read + %d decrypt thread%s",
+		    threads, threads == 1 ? "" : "s");
+	bench_time(title, &start, i, bytes);
+	if (i != num)
+		ret = -1;
+
+out:
+	decrypt_pool_deinit(pool);
+	pcap_mmap_close(p);
+	os_free(frames);
+	os_free(jobs);
+	return ret;
+}
+
+
+int main(int argc, char *argv[])
+{
+	char fname[] = "/tmp/bench_pcap.XXXXXX";
+	char tmp[sizeof(fname) + 3];
+	int num = 20000, threads = 4, fd, ret = 0, i;
+
+	if (argc > 1)
+		num = atoi(argv[1]);
+	if (argc > 2)
+		threads = atoi(argv[2]);
+	if (num < 1)
+		num = 1;
+	if (threads < 1)
+		threads = 1;
+
+	if (os_program_init())
+		return -1;
+
+	fill(&bench_tk[0][0][0], sizeof(bench_tk), 1);
+
+	fd = mkstemp(fname);
+	if (fd < 0) {
+		perror("mkstemp");
+		return -1;
+	}
+	close(fd);
+	os_snprintf(tmp, sizeof(tmp), "%s.ng", fname);
+
+	if (bench_write(fname, num, 0, 0) < 0) {
+		printf("Failed to write '%s'\n", fname);
+		ret = -1;
+		goto out;
+	}
+
+	if (test_formats(fname, tmp, num < 100 ? num : 100) < 0)
+		ret = -1;
+	if (bench_inline(fname, num) < 0)
+		ret = -1;
+	for (i = 1; i <= threads; i *= 2) {
+		if (bench_pool(fname, num, i) < 0)
+			ret = -1;
+	}
+	if (ret)
+		printf("Decryption results - FAILED!\n");
+
+out:
+	unlink(fname);
+	unlink(tmp);
+	os_program_deinit();
+	return ret;
+}
@@ -20,12 +20,11 @@ struct wlantest_bss * bss_find(struct wlantest *wt, const u8 *bssid)
 {
 	struct wlantest_bss *bss;
 
-	dl_list_for_each(bss, &wt->bss, struct wlantest_bss, list) {
-		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) == 0)
-			return bss;
-	}
+	bss = wt->bss_hash[WLANTEST_HASH(bssid)];
+	while (bss && os_memcmp(bss->bssid, bssid, ETH_ALEN) != 0)
+		bss = bss->hnext;
 
-	return NULL;
+	return bss;
 }
 
 
@@ -48,6 +47,8 @@ struct wlantest_bss * bss_get(struct wlantest *wt, const u8 *bssid)
 	dl_list_init(&bss->tdls);
 	os_memcpy(bss->bssid, bssid, ETH_ALEN);
 	dl_list_add(&wt->bss, &bss->list);
+	bss->hnext = wt->bss_hash[WLANTEST_HASH(bssid)];
+	wt->bss_hash[WLANTEST_HASH(bssid)] = bss;
 	wpa_printf(MSG_DEBUG, "Discovered new BSS - " MACSTR,
 		   MAC2STR(bss->bssid));
 	return bss;
@@ -68,11 +69,19 @@ void tdls_deinit(struct wlantest_tdls *tdls)
 }
 
 
-void bss_deinit(struct wlantest_bss *bss)
+void bss_deinit(struct wlantest *wt, struct wlantest_bss *bss)
 {
 	struct wlantest_sta *sta, *n;
 	struct wlantest_pmk *pmk, *np;
 	struct wlantest_tdls *tdls, *nt;
+	struct wlantest_bss **pos;
+
+	pos = &wt->bss_hash[WLANTEST_HASH(bss->bssid)];
+	while (*pos && *pos != bss)
+		pos = &(*pos)->hnext;
+	if (*pos)
+		*pos = bss->hnext;
+
 	dl_list_for_each_safe(sta, n, &bss->sta, struct wlantest_sta, list)
 		sta_deinit(sta);
 	dl_list_for_each_safe(pmk, np, &bss->pmk, struct wlantest_pmk, list)
@@ -293,5 +302,5 @@ void bss_flush(struct wlantest *wt)
 {
 	struct wlantest_bss *bss, *n;
 	dl_list_for_each_safe(bss, n, &wt->bss, struct wlantest_bss, list)
-		bss_deinit(bss);
+		bss_deinit(wt, bss);
 }
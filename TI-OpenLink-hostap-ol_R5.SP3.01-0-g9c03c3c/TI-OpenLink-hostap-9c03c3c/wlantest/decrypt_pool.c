@@ -0,0 +1,294 @@
+/*
+ * Decryption of captured frames in worker threads
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * When a capture file is read, frames are looked at before they are
+ * processed. If the key for a protected Data frame is already known, the frame
+ * is decrypted in a worker thread while the preceding frames are processed.
+ * All state is still updated only from the main thread in capture order; the
+ * result of the early decryption is used only if the key that would be used
+ * when the frame is processed is the same that the worker thread used.
+ *
+ * Each BSS is handled by a single worker thread, so the frames of a STA are
+ * decrypted in the order they were captured.
+ */
+
+#include "utils/includes.h"
+#include <pthread.h>
+
+#include "utils/common.h"
+#include "common/defs.h"
+#include "wlantest.h"
+
+
+#define DECRYPT_POOL_MAX_THREADS 32
+
+struct decrypt_worker {
+	struct decrypt_pool *pool;
+	pthread_t thread;
+	pthread_cond_t cond;
+	struct decrypt_job *head;
+	struct decrypt_job *tail;
+};
+
+struct decrypt_pool {
+	pthread_mutex_t lock;
+	pthread_cond_t done_cond;
+	int waiting;
+	int stop;
+	struct decrypt_worker *workers;
+	int num_workers;
+
+	/* Statistics; updated only from the main thread */
+	unsigned int submitted;
+	unsigned int waited;
+};
+
+
+static size_t decrypt_key_len(int cipher)
+{
+	/* TKIP uses the Michael MIC keys that follow the temporal key */
+	return cipher == WPA_CIPHER_TKIP ? 32 : 16;
+}
+
+
+static void * decrypt_pool_worker(void *arg)
+{
+	struct decrypt_worker *w = arg;
+	struct decrypt_pool *pool = w->pool;
+	struct decrypt_job *job;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while (!pool->stop && w->head == NULL)
+			pthread_cond_wait(&w->cond, &pool->lock);
+		if (pool->stop)
+			break;
+		job = w->head;
+		w->head = job->next;
+		if (w->head == NULL)
+			w->tail = NULL;
+		pthread_mutex_unlock(&pool->lock);
+
+		if (job->cipher == WPA_CIPHER_TKIP)
+			job->decrypted = tkip_try_decrypt(job->tk, job->hdr,
+							  job->data,
+							  job->data_len,
+							  &job->decrypted_len);
+		else
+			job->decrypted = ccmp_try_decrypt(job->tk, job->hdr,
+							  job->data,
+							  job->data_len,
+							  &job->decrypted_len);
+
+		pthread_mutex_lock(&pool->lock);
+		job->done = 1;
+		if (pool->waiting)
+			pthread_cond_broadcast(&pool->done_cond);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+
+static int decrypt_pool_cpus(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n > 0)
+		return n;
+#endif /* _SC_NPROCESSORS_ONLN */
+	return 1;
+}
+
+
+/**
+ * decrypt_pool_init - Start decryption worker threads
+ * @threads: Number of worker threads or -1 to use one per online CPU
+ * Returns: Pointer to the pool or %NULL on failure
+ */
+struct decrypt_pool * decrypt_pool_init(int threads)
+{
+	struct decrypt_pool *pool;
+	int i;
+
+	if (threads < 0)
+		threads = decrypt_pool_cpus();
+	if (threads < 1)
+		return NULL;
+	if (threads > DECRYPT_POOL_MAX_THREADS)
+		threads = DECRYPT_POOL_MAX_THREADS;
+
+	pool = os_zalloc(sizeof(*pool));
+	if (pool == NULL)
+		return NULL;
+	pool->workers = os_zalloc(threads * sizeof(struct decrypt_worker));
+	if (pool->workers == NULL) {
+		os_free(pool);
+		return NULL;
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->done_cond, NULL);
+
+	for (i = 0; i < threads; i++) {
+		struct decrypt_worker *w = &pool->workers[i];
+		w->pool = pool;
+		pthread_cond_init(&w->cond, NULL);
+		if (pthread_create(&w->thread, NULL, decrypt_pool_worker, w))
+		{
+			wpa_printf(MSG_ERROR, "Decrypt pool: Could not create "
+				   "thread: %s", strerror(errno));
+			pthread_cond_destroy(&w->cond);
+			break;
+		}
+		pool->num_workers++;
+	}
+	if (pool->num_workers == 0) {
+		decrypt_pool_deinit(pool);
+		return NULL;
+	}
+
+	wpa_printf(MSG_DEBUG, "Decrypt pool: Started %d worker thread(s)",
+		   pool->num_workers);
+
+	return pool;
+}
+
+
+/**
+ * decrypt_pool_deinit - Stop decryption worker threads
+ * @pool: Pool from decrypt_pool_init() or %NULL
+ *
+ * Jobs that have not been completed are dropped; the caller is responsible
+ * for freeing the decrypted data of the completed ones.
+ */
+void decrypt_pool_deinit(struct decrypt_pool *pool)
+{
+	int i;
+
+	if (pool == NULL)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	for (i = 0; i < pool->num_workers; i++)
+		pthread_cond_signal(&pool->workers[i].cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i = 0; i < pool->num_workers; i++) {
+		pthread_join(pool->workers[i].thread, NULL);
+		pthread_cond_destroy(&pool->workers[i].cond);
+	}
+
+	wpa_printf(MSG_DEBUG, "Decrypt pool: %u frame(s) decrypted in worker "
+		   "threads; waited for %u", pool->submitted, pool->waited);
+
+	pthread_cond_destroy(&pool->done_cond);
+	pthread_mutex_destroy(&pool->lock);
+	os_free(pool->workers);
+	os_free(pool);
+}
+
+
+/**
+ * decrypt_pool_submit - Queue a frame for decryption
+ * @pool: Pool from decrypt_pool_init()
+ * @job: Frame and key information from rx_data_decrypt_job()
+ *
+ * The job and the frame data it points to must remain valid until
+ * decrypt_pool_wait() has returned for the job.
+ */
+void decrypt_pool_submit(struct decrypt_pool *pool, struct decrypt_job *job)
+{
+	struct decrypt_worker *w;
+
+	w = &pool->workers[WLANTEST_HASH(job->bssid) % pool->num_workers];
+	job->next = NULL;
+	job->decrypted = NULL;
+	job->done = 0;
+	job->queued = 1;
+	pool->submitted++;
+
+	pthread_mutex_lock(&pool->lock);
+	if (w->tail)
+		w->tail->next = job;
+	else {
+		w->head = job;
+		pthread_cond_signal(&w->cond);
+	}
+	w->tail = job;
+	pthread_mutex_unlock(&pool->lock);
+}
+
+
+/**
+ * decrypt_pool_wait - Wait for a queued frame to be decrypted
+ * @pool: Pool from decrypt_pool_init()
+ * @job: Job from decrypt_pool_submit()
+ */
+void decrypt_pool_wait(struct decrypt_pool *pool, struct decrypt_job *job)
+{
+	pthread_mutex_lock(&pool->lock);
+	if (!job->done) {
+		pool->waited++;
+		pool->waiting = 1;
+		while (!job->done)
+			pthread_cond_wait(&pool->done_cond, &pool->lock);
+		pool->waiting = 0;
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+
+/**
+ * wlantest_decrypt - Decrypt a received CCMP or TKIP frame
+ * @wt: wlantest context
+ * @cipher: WPA_CIPHER_CCMP or WPA_CIPHER_TKIP
+ * @tk: Temporal key (followed by the Michael MIC keys for TKIP)
+ * @hdr: IEEE 802.11 header of the frame
+ * @data: Frame body starting with the CCMP/TKIP header
+ * @data_len: Length of the frame body
+ * @decrypted_len: Buffer for returning the length of the decrypted data
+ * Returns: Decrypted data (to be freed with os_free()) or %NULL on failure
+ *
+ * If the frame was already decrypted in a worker thread with the same key,
+ * that result is returned. Failures are always reported from here by
+ * decrypting the frame again.
+ */
+u8 * wlantest_decrypt(struct wlantest *wt, int cipher, const u8 *tk,
+		      const struct ieee80211_hdr *hdr, const u8 *data,
+		      size_t data_len, size_t *decrypted_len)
+{
+	struct decrypt_job *job = wt->decrypt_job;
+	u8 *decrypted;
+
+	if (job && job->decrypted && job->hdr == hdr && job->data == data &&
+	    job->data_len == data_len && job->cipher == cipher &&
+	    os_memcmp(job->tk, tk, decrypt_key_len(cipher)) == 0) {
+		decrypted = job->decrypted;
+		job->decrypted = NULL;
+		*decrypted_len = job->decrypted_len;
+		return decrypted;
+	}
+
+	if (cipher == WPA_CIPHER_TKIP)
+		return tkip_decrypt(tk, hdr, data, data_len, decrypted_len);
+	return ccmp_decrypt(tk, hdr, data, data_len, decrypted_len);
+}
+
+
+/**
+ * decrypt_job_key - Set the key for a decryption job
+ * @job: Job to be submitted with decrypt_pool_submit()
+ * @cipher: WPA_CIPHER_CCMP or WPA_CIPHER_TKIP
+ * @tk: Temporal key (followed by the Michael MIC keys for TKIP)
+ */
+void decrypt_job_key(struct decrypt_job *job, int cipher, const u8 *tk)
+{
+	job->cipher = cipher;
+	os_memcpy(job->tk, tk, decrypt_key_len(cipher));
+}
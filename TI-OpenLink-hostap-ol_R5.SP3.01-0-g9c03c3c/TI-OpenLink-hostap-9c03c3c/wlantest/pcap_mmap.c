@@ -0,0 +1,372 @@
+/*
+ * Memory mapped pcap/pcapng capture file reader
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Large capture files are read by mapping them into memory and parsing the
+ * records in place, so the frames are not copied and the data pointers remain
+ * valid until the file is closed. This allows frames to be looked at ahead of
+ * the frame that is being processed.
+ */
+
+#include "utils/includes.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "utils/common.h"
+#include "wlantest.h"
+
+
+#define PCAP_MAGIC_USEC 0xa1b2c3d4
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+#define PCAP_HDR_LEN 24
+#define PCAP_REC_HDR_LEN 16
+
+#define PCAPNG_BLOCK_SHB 0x0a0d0d0a
+#define PCAPNG_BLOCK_IDB 0x00000001
+#define PCAPNG_BLOCK_PB 0x00000002 /* obsolete Packet Block */
+#define PCAPNG_BLOCK_SPB 0x00000003
+#define PCAPNG_BLOCK_EPB 0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1a2b3c4d
+#define PCAPNG_OPT_IF_TSRESOL 9
+
+#define PCAP_MMAP_MAX_IFACES 16
+
+struct pcap_mmap_iface {
+	int linktype;
+	u32 snaplen;
+	u64 ts_units; /* timestamp units per second */
+};
+
+struct pcap_mmap {
+	int fd;
+	u8 *map;
+	size_t map_len;
+	size_t pos;
+	int swap; /* file was written with the other byte order */
+	int ng;
+	struct pcap_mmap_iface iface[PCAP_MMAP_MAX_IFACES];
+	unsigned int num_iface;
+};
+
+
+static u32 pcap_u32(struct pcap_mmap *p, const u8 *pos)
+{
+	return p->swap ? WPA_GET_BE32(pos) : WPA_GET_LE32(pos);
+}
+
+
+static u16 pcap_u16(struct pcap_mmap *p, const u8 *pos)
+{
+	return p->swap ? WPA_GET_BE16(pos) : WPA_GET_LE16(pos);
+}
+
+
+static void pcap_mmap_ts(struct timeval *tv, u64 ts, u64 units)
+{
+	u64 rem;
+
+	if (units == 0)
+		units = 1000000;
+	tv->tv_sec = ts / units;
+	rem = ts % units;
+	if (units <= 1000000000)
+		tv->tv_usec = rem * 1000000 / units;
+	else
+		tv->tv_usec = rem / (units / 1000000);
+}
+
+
+static int pcap_mmap_hdr(struct pcap_mmap *p)
+{
+	u32 magic;
+
+	magic = WPA_GET_LE32(p->map);
+	if (magic == PCAPNG_BLOCK_SHB)
+		return 0; /* Byte order is found from the SHB body */
+	if (magic != PCAP_MAGIC_USEC && magic != PCAP_MAGIC_NSEC) {
+		magic = WPA_GET_BE32(p->map);
+		if (magic != PCAP_MAGIC_USEC && magic != PCAP_MAGIC_NSEC)
+			return -1;
+		p->swap = 1;
+	}
+	if (p->map_len < PCAP_HDR_LEN)
+		return -1;
+
+	p->iface[0].linktype = pcap_u32(p, p->map + 20);
+	p->iface[0].snaplen = pcap_u32(p, p->map + 16);
+	p->iface[0].ts_units = magic == PCAP_MAGIC_NSEC ? 1000000000 : 1000000;
+	p->num_iface = 1;
+	p->pos = PCAP_HDR_LEN;
+	return 1;
+}
+
+
+/**
+ * pcap_mmap_open - Open a capture file for memory mapped reading
+ * @fname: Capture file name
+ * Returns: Pointer to the reader or %NULL if the file could not be mapped or
+ * is not in a supported format (pcap or pcapng)
+ */
+struct pcap_mmap * pcap_mmap_open(const char *fname)
+{
+	struct pcap_mmap *p;
+	struct stat st;
+
+	p = os_zalloc(sizeof(*p));
+	if (p == NULL)
+		return NULL;
+	p->fd = open(fname, O_RDONLY);
+	if (p->fd < 0 || fstat(p->fd, &st) < 0 || st.st_size < 12 ||
+	    (off_t) (size_t) st.st_size != st.st_size) {
+		pcap_mmap_close(p);
+		return NULL;
+	}
+	p->map_len = st.st_size;
+	p->map = mmap(NULL, p->map_len, PROT_READ, MAP_PRIVATE, p->fd, 0);
+	if (p->map == MAP_FAILED) {
+		wpa_printf(MSG_DEBUG, "pcap: Could not map '%s': %s", fname,
+			   strerror(errno));
+		p->map = NULL;
+		pcap_mmap_close(p);
+		return NULL;
+	}
+#ifdef MADV_SEQUENTIAL
+	madvise(p->map, p->map_len, MADV_SEQUENTIAL);
+#endif /* MADV_SEQUENTIAL */
+
+	switch (pcap_mmap_hdr(p)) {
+	case 0:
+		p->ng = 1;
+		break;
+	case 1:
+		break;
+	default:
+		wpa_printf(MSG_DEBUG, "pcap: '%s' is not in pcap or pcapng "
+			   "format", fname);
+		pcap_mmap_close(p);
+		return NULL;
+	}
+
+	return p;
+}
+
+
+/**
+ * pcap_mmap_close - Close a capture file
+ * @p: Reader from pcap_mmap_open() or %NULL
+ *
+ * Frame data pointers from pcap_mmap_next() are not valid after this call.
+ */
+void pcap_mmap_close(struct pcap_mmap *p)
+{
+	if (p == NULL)
+		return;
+	if (p->map)
+		munmap(p->map, p->map_len);
+	if (p->fd >= 0)
+		close(p->fd);
+	os_free(p);
+}
+
+
+static int pcap_mmap_next_pcap(struct pcap_mmap *p,
+			       struct pcap_mmap_frame *frame)
+{
+	const u8 *rec;
+	u32 caplen;
+
+	if (p->pos == p->map_len)
+		return 0;
+	if (p->map_len - p->pos < PCAP_REC_HDR_LEN)
+		goto truncated;
+	rec = p->map + p->pos;
+	caplen = pcap_u32(p, rec + 8);
+	if (caplen > p->map_len - p->pos - PCAP_REC_HDR_LEN)
+		goto truncated;
+
+	pcap_mmap_ts(&frame->ts,
+		     (u64) pcap_u32(p, rec) * p->iface[0].ts_units +
+		     pcap_u32(p, rec + 4), p->iface[0].ts_units);
+	frame->data = rec + PCAP_REC_HDR_LEN;
+	frame->caplen = caplen;
+	frame->len = pcap_u32(p, rec + 12);
+	frame->linktype = p->iface[0].linktype;
+	p->pos += PCAP_REC_HDR_LEN + caplen;
+	return 1;
+
+truncated:
+	wpa_printf(MSG_INFO, "pcap: Truncated record at offset %lu",
+		   (unsigned long) p->pos);
+	return -1;
+}
+
+
+static void pcapng_idb(struct pcap_mmap *p, const u8 *body, size_t len)
+{
+	struct pcap_mmap_iface *iface;
+	const u8 *pos, *end;
+	u16 code, olen;
+	u8 res;
+
+	if (p->num_iface >= PCAP_MMAP_MAX_IFACES) {
+		/* Frames on the extra interfaces are skipped */
+		p->num_iface++;
+		return;
+	}
+	iface = &p->iface[p->num_iface++];
+	os_memset(iface, 0, sizeof(*iface));
+	if (len < 8)
+		return;
+	iface->linktype = pcap_u16(p, body);
+	iface->snaplen = pcap_u32(p, body + 4);
+	iface->ts_units = 1000000;
+
+	pos = body + 8;
+	end = body + len;
+	while (end - pos >= 4) {
+		code = pcap_u16(p, pos);
+		olen = pcap_u16(p, pos + 2);
+		pos += 4;
+		if (code == 0 || olen > end - pos)
+			break;
+		if (code == PCAPNG_OPT_IF_TSRESOL && olen >= 1) {
+			res = pos[0];
+			if (res & 0x80) {
+				res &= 0x7f;
+				if (res < 64)
+					iface->ts_units = 1ULL << res;
+			} else if (res <= 19) {
+				iface->ts_units = 1;
+				while (res--)
+					iface->ts_units *= 10;
+			}
+		}
+		pos += (olen + 3) & ~3;
+	}
+}
+
+
+static int pcap_mmap_next_ng(struct pcap_mmap *p,
+			     struct pcap_mmap_frame *frame)
+{
+	const u8 *block, *body;
+	u32 type, block_len, ifidx, caplen;
+	size_t body_len, start;
+
+	for (;;) {
+		start = p->pos;
+		if (p->pos == p->map_len)
+			return 0;
+		if (p->map_len - p->pos < 12)
+			goto truncated;
+		block = p->map + p->pos;
+		type = pcap_u32(p, block);
+		if (type == PCAPNG_BLOCK_SHB) {
+			/* New section; it may use a different byte order */
+			if (WPA_GET_LE32(block + 8) == PCAPNG_BYTE_ORDER_MAGIC)
+				p->swap = 0;
+			else if (WPA_GET_BE32(block + 8) ==
+				 PCAPNG_BYTE_ORDER_MAGIC)
+				p->swap = 1;
+			else
+				goto invalid;
+			p->num_iface = 0;
+		}
+		block_len = pcap_u32(p, block + 4);
+		if (block_len < 12 || (block_len & 3))
+			goto invalid;
+		if (block_len > p->map_len - p->pos)
+			goto truncated;
+		body = block + 8;
+		body_len = block_len - 12;
+		p->pos += block_len;
+
+		switch (type) {
+		case PCAPNG_BLOCK_IDB:
+			pcapng_idb(p, body, body_len);
+			continue;
+		case PCAPNG_BLOCK_EPB:
+			if (body_len < 20)
+				goto invalid;
+			ifidx = pcap_u32(p, body);
+			caplen = pcap_u32(p, body + 12);
+			if (caplen > body_len - 20)
+				goto invalid;
+			if (ifidx >= p->num_iface ||
+			    ifidx >= PCAP_MMAP_MAX_IFACES)
+				continue;
+			frame->len = pcap_u32(p, body + 16);
+			frame->data = body + 20;
+			break;
+		case PCAPNG_BLOCK_PB:
+			if (body_len < 20)
+				goto invalid;
+			ifidx = pcap_u16(p, body);
+			caplen = pcap_u32(p, body + 12);
+			if (caplen > body_len - 20)
+				goto invalid;
+			if (ifidx >= p->num_iface ||
+			    ifidx >= PCAP_MMAP_MAX_IFACES)
+				continue;
+			frame->len = pcap_u32(p, body + 16);
+			frame->data = body + 20;
+			break;
+		case PCAPNG_BLOCK_SPB:
+			if (body_len < 4)
+				goto invalid;
+			ifidx = 0;
+			if (p->num_iface == 0)
+				continue;
+			frame->len = pcap_u32(p, body);
+			caplen = frame->len;
+			if (p->iface[0].snaplen && caplen > p->iface[0].snaplen)
+				caplen = p->iface[0].snaplen;
+			if (caplen > body_len - 4)
+				caplen = body_len - 4;
+			frame->data = body + 4;
+			frame->ts.tv_sec = 0;
+			frame->ts.tv_usec = 0;
+			frame->caplen = caplen;
+			frame->linktype = p->iface[0].linktype;
+			return 1;
+		default:
+			continue;
+		}
+
+		pcap_mmap_ts(&frame->ts,
+			     ((u64) pcap_u32(p, body + 4) << 32) |
+			     pcap_u32(p, body + 8),
+			     p->iface[ifidx].ts_units);
+		frame->caplen = caplen;
+		frame->linktype = p->iface[ifidx].linktype;
+		return 1;
+	}
+
+truncated:
+	wpa_printf(MSG_INFO, "pcapng: Truncated block at offset %lu",
+		   (unsigned long) start);
+	return -1;
+invalid:
+	wpa_printf(MSG_INFO, "pcapng: Invalid block at offset %lu",
+		   (unsigned long) start);
+	return -1;
+}
+
+
+/**
+ * pcap_mmap_next - Get the next frame from a capture file
+ * @p: Reader from pcap_mmap_open()
+ * @frame: Buffer for returning the frame
+ * Returns: 1 if a frame was returned, 0 at the end of the file, or -1 if the
+ * file is truncated or invalid
+ */
+int pcap_mmap_next(struct pcap_mmap *p, struct pcap_mmap_frame *frame)
+{
+	if (p->ng)
+		return pcap_mmap_next_ng(p, frame);
+	return pcap_mmap_next_pcap(p, frame);
+}
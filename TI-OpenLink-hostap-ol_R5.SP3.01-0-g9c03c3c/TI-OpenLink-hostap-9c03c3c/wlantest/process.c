@@ -266,57 +266,84 @@ static int check_fcs(const u8 *frame, size_t frame_len, const u8 *fcs)
 }
 
 
-void wlantest_process(struct wlantest *wt, const u8 *data, size_t len)
+struct radiotap_info {
+	size_t hdrlen;
+	int rxflags;
+	int txflags;
+	int failed;
+	int fcs;
+};
+
+
+static int radiotap_parse(const u8 *data, size_t len,
+			  struct radiotap_info *info, int report)
 {
 	struct ieee80211_radiotap_iterator iter;
 	int ret;
-	int rxflags = 0, txflags = 0, failed = 0, fcs = 0;
-	const u8 *frame, *fcspos;
-	size_t frame_len;
 
-	wpa_hexdump(MSG_EXCESSIVE, "Process data", data, len);
+	os_memset(info, 0, sizeof(*info));
 
 	if (ieee80211_radiotap_iterator_init(&iter, (void *) data, len)) {
-		wpa_printf(MSG_INFO, "Invalid radiotap frame");
-		return;
+		if (report)
+			wpa_printf(MSG_INFO, "Invalid radiotap frame");
+		return -1;
 	}
 
 	for (;;) {
 		ret = ieee80211_radiotap_iterator_next(&iter);
-		wpa_printf(MSG_EXCESSIVE, "radiotap iter: %d "
-			   "this_arg_index=%d", ret, iter.this_arg_index);
+		if (report)
+			wpa_printf(MSG_EXCESSIVE, "radiotap iter: %d "
+				   "this_arg_index=%d", ret,
+				   iter.this_arg_index);
 		if (ret == -ENOENT)
 			break;
 		if (ret) {
-			wpa_printf(MSG_INFO, "Invalid radiotap header: %d",
-				   ret);
-			return;
+			if (report)
+				wpa_printf(MSG_INFO, "Invalid radiotap header: "
+					   "%d", ret);
+			return -1;
 		}
 		switch (iter.this_arg_index) {
 		case IEEE80211_RADIOTAP_FLAGS:
 			if (*iter.this_arg & IEEE80211_RADIOTAP_F_FCS)
-				fcs = 1;
+				info->fcs = 1;
 			break;
 		case IEEE80211_RADIOTAP_RX_FLAGS:
-			rxflags = 1;
+			info->rxflags = 1;
 			break;
 		case IEEE80211_RADIOTAP_TX_FLAGS:
-			txflags = 1;
-			failed = le_to_host16((*(u16 *) iter.this_arg)) &
+			info->txflags = 1;
+			info->failed = le_to_host16((*(u16 *) iter.this_arg)) &
 				IEEE80211_RADIOTAP_F_TX_FAIL;
 			break;
 
 		}
 	}
 
-	if (iter.max_length == 8) {
+	info->hdrlen = iter.max_length;
+	return 0;
+}
+
+
+void wlantest_process(struct wlantest *wt, const u8 *data, size_t len)
+{
+	struct radiotap_info info;
+	const u8 *frame, *fcspos;
+	size_t frame_len;
+
+	wpa_hexdump(MSG_EXCESSIVE, "Process data", data, len);
+
+	if (radiotap_parse(data, len, &info, 1) < 0)
+		return;
+
+	if (info.hdrlen == 8) {
 		wpa_printf(MSG_DEBUG, "Skip frame inserted by wlantest");
 		return;
 	}
-	frame = data + iter.max_length;
-	frame_len = len - iter.max_length;
+	frame = data + info.hdrlen;
+	frame_len = len - info.hdrlen;
 
-	if (fcs && frame_len >= 4) {
+	if (info.fcs && frame_len >= 4) {
 		frame_len -= 4;
 		fcspos = frame + frame_len;
 		if (check_fcs(frame, frame_len, fcspos) < 0) {
@@ -327,12 +354,12 @@ void wlantest_process(struct wlantest *wt, const u8 *data, size_t len)
 		}
 	}
 
-	if (rxflags && txflags)
+	if (info.rxflags && info.txflags)
 		return;
-	if (!txflags)
+	if (!info.txflags)
 		rx_frame(wt, frame, frame_len);
 	else
-		tx_status(wt, frame, frame_len, !failed);
+		tx_status(wt, frame, frame_len, !info.failed);
 }
 
 
@@ -379,3 +406,52 @@ void wlantest_process_80211(struct wlantest *wt, const u8 *data, size_t len)
 	wpa_hexdump(MSG_EXCESSIVE, "Process data", data, len);
 	rx_frame(wt, data, len);
 }
+
+
+/**
+ * wlantest_radiotap_frame - Locate the received frame in a radiotap capture
+ * @data: Captured data starting with a radiotap header
+ * @len: Length of the captured data
+ * @frame_len: Buffer for returning the length of the frame (without FCS)
+ * Returns: Pointer to the IEEE 802.11 frame or %NULL if wlantest_process()
+ * would not process the data as a received frame
+ *
+ * This is used to look at frames before wlantest_process() is called for
+ * them; the FCS is not verified here.
+ */
+const u8 * wlantest_radiotap_frame(const u8 *data, size_t len,
+				   size_t *frame_len)
+{
+	struct radiotap_info info;
+
+	if (radiotap_parse(data, len, &info, 0) < 0 || info.hdrlen == 8 ||
+	    info.txflags)
+		return NULL;
+	*frame_len = len - info.hdrlen;
+	if (info.fcs && *frame_len >= 4)
+		*frame_len -= 4;
+	return data + info.hdrlen;
+}
+
+
+/**
+ * wlantest_prism_frame - Locate the received frame in a Prism capture
+ * @data: Captured data starting with a Prism header
+ * @len: Length of the captured data
+ * @frame_len: Buffer for returning the length of the frame (without FCS)
+ * Returns: Pointer to the IEEE 802.11 frame or %NULL on failure
+ */
+const u8 * wlantest_prism_frame(const u8 *data, size_t len, size_t *frame_len)
+{
+	u32 hdrlen;
+
+	if (len < 8)
+		return NULL;
+	hdrlen = WPA_GET_LE32(data + 4);
+	if (len < hdrlen)
+		return NULL;
+	*frame_len = len - hdrlen;
+	if (*frame_len >= 4)
+		*frame_len -= 4;
+	return data + hdrlen;
+}
@@ -13,6 +13,142 @@
 #include "wlantest.h"
 
 
+extern int wpa_debug_level;
+
+/* Number of frames looked at ahead of the frame that is being processed */
+#define READ_AHEAD 1024
+
+struct cap_frame {
+	struct pcap_mmap_frame frame;
+	struct decrypt_job job;
+};
+
+
+static void cap_frame_prepare(struct wlantest *wt, struct cap_frame *f)
+{
+	const u8 *frame;
+	size_t len;
+
+	f->job.queued = 0;
+	f->job.decrypted = NULL;
+	if (wt->decrypt_pool == NULL || f->frame.caplen < f->frame.len)
+		return;
+
+	switch (f->frame.linktype) {
+	case LINKTYPE_IEEE802_11_RADIOTAP:
+		frame = wlantest_radiotap_frame(f->frame.data, f->frame.caplen,
+						&len);
+		break;
+	case LINKTYPE_PRISM_HEADER:
+		frame = wlantest_prism_frame(f->frame.data, f->frame.caplen,
+					     &len);
+		break;
+	case LINKTYPE_IEEE802_11:
+		frame = f->frame.data;
+		len = f->frame.caplen;
+		break;
+	default:
+		return;
+	}
+
+	if (frame && rx_data_decrypt_job(wt, frame, len, &f->job) == 0)
+		decrypt_pool_submit(wt->decrypt_pool, &f->job);
+}
+
+
+static int cap_frame_process(struct wlantest *wt, struct cap_frame *f)
+{
+	const struct pcap_mmap_frame *frame = &f->frame;
+
+	wpa_printf(MSG_EXCESSIVE, "pcap hdr: ts=%d.%06d len=%u/%u",
+		   (int) frame->ts.tv_sec, (int) frame->ts.tv_usec,
+		   (unsigned int) frame->caplen, (unsigned int) frame->len);
+	write_pcap_frame(wt, &frame->ts, frame->data, frame->caplen,
+			 frame->len);
+	if (frame->caplen < frame->len) {
+		wpa_printf(MSG_DEBUG, "pcap: Dropped incomplete frame "
+			   "(%u/%u captured)",
+			   (unsigned int) frame->caplen,
+			   (unsigned int) frame->len);
+		return 0;
+	}
+
+	if (f->job.queued) {
+		decrypt_pool_wait(wt->decrypt_pool, &f->job);
+		wt->decrypt_job = &f->job;
+	}
+	switch (frame->linktype) {
+	case LINKTYPE_IEEE802_11_RADIOTAP:
+		wlantest_process(wt, frame->data, frame->caplen);
+		break;
+	case LINKTYPE_PRISM_HEADER:
+		wlantest_process_prism(wt, frame->data, frame->caplen);
+		break;
+	case LINKTYPE_IEEE802_11:
+		wlantest_process_80211(wt, frame->data, frame->caplen);
+		break;
+	default:
+		wpa_printf(MSG_DEBUG, "pcap: Skipped frame with unsupported "
+			   "link type %d", frame->linktype);
+		return 0;
+	}
+	wt->decrypt_job = NULL;
+	os_free(f->job.decrypted);
+	f->job.decrypted = NULL;
+
+	return 1;
+}
+
+
+static int read_cap_file_mmap(struct wlantest *wt, struct pcap_mmap *p,
+			      const char *fname)
+{
+	struct cap_frame *ring;
+	unsigned int head = 0, queued = 0, count = 0;
+	struct cap_frame *f;
+	int res = 1;
+
+	ring = os_zalloc(READ_AHEAD * sizeof(struct cap_frame));
+	if (ring == NULL)
+		return -1;
+
+	if (wt->decrypt_threads && wpa_debug_level <= MSG_EXCESSIVE)
+		wpa_printf(MSG_INFO, "Decrypting frames in the main thread to "
+			   "keep the debug log in order");
+	else if (wt->decrypt_threads)
+		wt->decrypt_pool = decrypt_pool_init(wt->decrypt_threads);
+
+	for (;;) {
+		/*
+		 * Queue the following frames for decryption with the keys
+		 * that are known now before processing the next frame.
+		 */
+		while (res > 0 && queued < READ_AHEAD) {
+			f = &ring[(head + queued) % READ_AHEAD];
+			res = pcap_mmap_next(p, &f->frame);
+			if (res <= 0)
+				break;
+			cap_frame_prepare(wt, f);
+			queued++;
+		}
+		if (queued == 0)
+			break;
+
+		count += cap_frame_process(wt, &ring[head]);
+		head = (head + 1) % READ_AHEAD;
+		queued--;
+	}
+
+	decrypt_pool_deinit(wt->decrypt_pool);
+	wt->decrypt_pool = NULL;
+	os_free(ring);
+
+	wpa_printf(MSG_DEBUG, "Read %s: %u packets", fname, count);
+
+	return 0;
+}
+
+
 int read_cap_file(struct wlantest *wt, const char *fname)
 {
 	char errbuf[PCAP_ERRBUF_SIZE];
@@ -22,6 +158,14 @@ int read_cap_file(struct wlantest *wt, const char *fname)
 	const u_char *data;
 	int res;
 	int dlt;
+	struct pcap_mmap *p;
+
+	p = pcap_mmap_open(fname);
+	if (p) {
+		res = read_cap_file_mmap(wt, p, fname);
+		pcap_mmap_close(p);
+		return res;
+	}
 
 	pcap = pcap_open_offline(fname, errbuf);
 	if (pcap == NULL) {
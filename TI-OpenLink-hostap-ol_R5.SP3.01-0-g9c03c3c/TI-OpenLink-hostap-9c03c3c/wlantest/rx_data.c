@@ -170,13 +170,15 @@ static void rx_data_bss_prot_group(struct wlantest *wt,
 
 skip_replay_det:
 	if (bss->group_cipher == WPA_CIPHER_TKIP)
-		decrypted = tkip_decrypt(bss->gtk[keyid], hdr, data, len,
-					 &dlen);
+		decrypted = wlantest_decrypt(wt, WPA_CIPHER_TKIP,
+					     bss->gtk[keyid], hdr, data, len,
+					     &dlen);
 	else if (bss->group_cipher == WPA_CIPHER_WEP40)
 		decrypted = wep_decrypt(wt, hdr, data, len, &dlen);
 	else
-		decrypted = ccmp_decrypt(bss->gtk[keyid], hdr, data, len,
-					 &dlen);
+		decrypted = wlantest_decrypt(wt, WPA_CIPHER_CCMP,
+					     bss->gtk[keyid], hdr, data, len,
+					     &dlen);
 	if (decrypted) {
 		rx_data_process(wt, bss->bssid, NULL, dst, src, decrypted,
 				dlen, 1, NULL);
@@ -326,11 +328,15 @@ skip_replay_det:
 	if (tk)
 		decrypted = ccmp_decrypt(tk, hdr, data, len, &dlen);
 	else if (sta->pairwise_cipher == WPA_CIPHER_TKIP)
-		decrypted = tkip_decrypt(sta->ptk.tk1, hdr, data, len, &dlen);
+		decrypted = wlantest_decrypt(wt, WPA_CIPHER_TKIP,
+					     sta->ptk.tk1, hdr, data, len,
+					     &dlen);
 	else if (sta->pairwise_cipher == WPA_CIPHER_WEP40)
 		decrypted = wep_decrypt(wt, hdr, data, len, &dlen);
 	else
-		decrypted = ccmp_decrypt(sta->ptk.tk1, hdr, data, len, &dlen);
+		decrypted = wlantest_decrypt(wt, WPA_CIPHER_CCMP,
+					     sta->ptk.tk1, hdr, data, len,
+					     &dlen);
 	if (decrypted) {
 		u16 fc = le_to_host16(hdr->frame_control);
 		const u8 *peer_addr = NULL;
@@ -527,3 +533,77 @@ void rx_data(struct wlantest *wt, const u8 *data, size_t len)
 		break;
 	}
 }
+
+
+/**
+ * rx_data_decrypt_job - Check whether a frame can be decrypted in advance
+ * @wt: wlantest context
+ * @data: IEEE 802.11 frame
+ * @len: Length of the frame
+ * @job: Buffer for the frame and key information
+ * Returns: 0 if the job was filled in for decrypt_pool_submit(), -1 if not
+ *
+ * This selects the key in the same way as the protected Data frame processing
+ * above, but without updating any state. TDLS and WEP frames are left to be
+ * decrypted when they are processed.
+ */
+int rx_data_decrypt_job(struct wlantest *wt, const u8 *data, size_t len,
+			struct decrypt_job *job)
+{
+	const struct ieee80211_hdr *hdr;
+	struct wlantest_bss *bss;
+	struct wlantest_sta *sta;
+	u16 fc;
+	size_t hdrlen;
+	int keyid;
+
+	if (len < 24)
+		return -1;
+	hdr = (const struct ieee80211_hdr *) data;
+	fc = le_to_host16(hdr->frame_control);
+	if (WLAN_FC_GET_TYPE(fc) != WLAN_FC_TYPE_DATA ||
+	    !(fc & WLAN_FC_ISWEP) ||
+	    (fc & (WLAN_FC_TODS | WLAN_FC_FROMDS)) ==
+	    (WLAN_FC_TODS | WLAN_FC_FROMDS))
+		return -1;
+	hdrlen = 24;
+	if (WLAN_FC_GET_STYPE(fc) & 0x08)
+		hdrlen += 2;
+	if (len < hdrlen + 4)
+		return -1;
+
+	job->hdr = hdr;
+	job->data = data + hdrlen;
+	job->data_len = len - hdrlen;
+
+	if (hdr->addr1[0] & 0x01) {
+		bss = bss_find(wt, hdr->addr2);
+		if (bss == NULL || bss->group_cipher == WPA_CIPHER_WEP40)
+			return -1;
+		keyid = job->data[3] >> 6;
+		if (bss->gtk_len[keyid] == 0)
+			return -1;
+		job->bssid = bss->bssid;
+		decrypt_job_key(job, bss->group_cipher == WPA_CIPHER_TKIP ?
+				WPA_CIPHER_TKIP : WPA_CIPHER_CCMP,
+				bss->gtk[keyid]);
+		return 0;
+	}
+
+	if (fc & WLAN_FC_TODS) {
+		bss = bss_find(wt, hdr->addr1);
+		sta = bss ? sta_find(bss, hdr->addr2) : NULL;
+	} else if (fc & WLAN_FC_FROMDS) {
+		bss = bss_find(wt, hdr->addr2);
+		sta = bss ? sta_find(bss, hdr->addr1) : NULL;
+	} else
+		return -1;
+	if (sta == NULL || !sta->ptk_set ||
+	    sta->pairwise_cipher == WPA_CIPHER_WEP40)
+		return -1;
+
+	job->bssid = bss->bssid;
+	decrypt_job_key(job, sta->pairwise_cipher == WPA_CIPHER_TKIP ?
+			WPA_CIPHER_TKIP : WPA_CIPHER_CCMP, sta->ptk.tk1);
+	return 0;
+}
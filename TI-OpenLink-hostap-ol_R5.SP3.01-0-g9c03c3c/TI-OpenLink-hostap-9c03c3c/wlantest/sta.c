@@ -19,12 +19,11 @@ struct wlantest_sta * sta_find(struct wlantest_bss *bss, const u8 *addr)
 {
 	struct wlantest_sta *sta;
 
-	dl_list_for_each(sta, &bss->sta, struct wlantest_sta, list) {
-		if (os_memcmp(sta->addr, addr, ETH_ALEN) == 0)
-			return sta;
-	}
+	sta = bss->sta_hash[WLANTEST_HASH(addr)];
+	while (sta && os_memcmp(sta->addr, addr, ETH_ALEN) != 0)
+		sta = sta->hnext;
 
-	return NULL;
+	return sta;
 }
 
 
@@ -47,6 +46,8 @@ struct wlantest_sta * sta_get(struct wlantest_bss *bss, const u8 *addr)
 	sta->bss = bss;
 	os_memcpy(sta->addr, addr, ETH_ALEN);
 	dl_list_add(&bss->sta, &sta->list);
+	sta->hnext = bss->sta_hash[WLANTEST_HASH(addr)];
+	bss->sta_hash[WLANTEST_HASH(addr)] = sta;
 	wpa_printf(MSG_DEBUG, "Discovered new STA " MACSTR " in BSS " MACSTR,
 		   MAC2STR(sta->addr), MAC2STR(bss->bssid));
 	return sta;
@@ -55,6 +56,13 @@ struct wlantest_sta * sta_get(struct wlantest_bss *bss, const u8 *addr)
 
 void sta_deinit(struct wlantest_sta *sta)
 {
+	struct wlantest_sta **pos;
+
+	pos = &sta->bss->sta_hash[WLANTEST_HASH(sta->addr)];
+	while (*pos && *pos != sta)
+		pos = &(*pos)->hnext;
+	if (*pos)
+		*pos = sta->hnext;
 	dl_list_del(&sta->list);
 	os_free(sta->assocreq_ies);
 	os_free(sta);
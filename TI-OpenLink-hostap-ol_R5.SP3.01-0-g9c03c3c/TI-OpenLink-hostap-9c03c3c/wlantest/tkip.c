@@ -288,8 +288,9 @@ static void michael_mic_hdr(const struct ieee80211_hdr *hdr11, u8 *hdr)
 }
 
 
-u8 * tkip_decrypt(const u8 *tk, const struct ieee80211_hdr *hdr,
-		  const u8 *data, size_t data_len, size_t *decrypted_len)
+static u8 * tkip_decrypt_frame(const u8 *tk, const struct ieee80211_hdr *hdr,
+				const u8 *data, size_t data_len,
+				size_t *decrypted_len, int report)
 {
 	u16 iv16;
 	u32 iv32;
@@ -326,10 +327,12 @@ u8 * tkip_decrypt(const u8 *tk, const struct ieee80211_hdr *hdr,
 	icv = crc32(plain, plain_len - 4);
 	rx_icv = WPA_GET_LE32(plain + plain_len - 4);
 	if (icv != rx_icv) {
-		wpa_printf(MSG_INFO, "TKIP ICV mismatch in frame from " MACSTR,
-			   MAC2STR(hdr->addr2));
-		wpa_printf(MSG_DEBUG, "TKIP calculated ICV %08x  received ICV "
-			   "%08x", icv, rx_icv);
+		if (report) {
+			wpa_printf(MSG_INFO, "TKIP ICV mismatch in frame from "
+				   MACSTR, MAC2STR(hdr->addr2));
+			wpa_printf(MSG_DEBUG, "TKIP calculated ICV %08x  "
+				   "received ICV %08x", icv, rx_icv);
+		}
 		os_free(plain);
 		return NULL;
 	}
@@ -338,8 +341,10 @@ u8 * tkip_decrypt(const u8 *tk, const struct ieee80211_hdr *hdr,
 	/* TODO: MSDU reassembly */
 
 	if (plain_len < 8) {
-		wpa_printf(MSG_INFO, "TKIP: Not enough room for Michael MIC "
-			   "in a frame from " MACSTR, MAC2STR(hdr->addr2));
+		if (report)
+			wpa_printf(MSG_INFO, "TKIP: Not enough room for "
+				   "Michael MIC in a frame from " MACSTR,
+				   MAC2STR(hdr->addr2));
 		os_free(plain);
 		return NULL;
 	}
@@ -348,11 +353,13 @@ u8 * tkip_decrypt(const u8 *tk, const struct ieee80211_hdr *hdr,
 	mic_key = tk + ((fc & WLAN_FC_FROMDS) ? 16 : 24);
 	michael_mic(mic_key, michael_hdr, plain, plain_len - 8, mic);
 	if (os_memcmp(mic, plain + plain_len - 8, 8) != 0) {
-		wpa_printf(MSG_INFO, "TKIP: Michael MIC mismatch in a frame "
-			   "from " MACSTR, MAC2STR(hdr->addr2));
-		wpa_hexdump(MSG_DEBUG, "TKIP: Calculated MIC", mic, 8);
-		wpa_hexdump(MSG_DEBUG, "TKIP: Received MIC",
-			    plain + plain_len - 8, 8);
+		if (report) {
+			wpa_printf(MSG_INFO, "TKIP: Michael MIC mismatch in a "
+				   "frame from " MACSTR, MAC2STR(hdr->addr2));
+			wpa_hexdump(MSG_DEBUG, "TKIP: Calculated MIC", mic, 8);
+			wpa_hexdump(MSG_DEBUG, "TKIP: Received MIC",
+				    plain + plain_len - 8, 8);
+		}
 		os_free(plain);
 		return NULL;
 	}
@@ -362,6 +369,21 @@ u8 * tkip_decrypt(const u8 *tk, const struct ieee80211_hdr *hdr,
 }
 
 
+u8 * tkip_decrypt(const u8 *tk, const struct ieee80211_hdr *hdr,
+		  const u8 *data, size_t data_len, size_t *decrypted_len)
+{
+	return tkip_decrypt_frame(tk, hdr, data, data_len, decrypted_len, 1);
+}
+
+
+/* Same as tkip_decrypt(), but failures are not reported */
+u8 * tkip_try_decrypt(const u8 *tk, const struct ieee80211_hdr *hdr,
+		      const u8 *data, size_t data_len, size_t *decrypted_len)
+{
+	return tkip_decrypt_frame(tk, hdr, data, data_len, decrypted_len, 0);
+}
+
+
 void tkip_get_pn(u8 *pn, const u8 *data)
 {
 	pn[0] = data[7]; /* PN5 */
@@ -29,7 +29,8 @@ static void usage(void)
 	       "[-p<passphrase>]\n"
 		"         [-I<wired ifname>] [-R<wired pcap file>] "
 	       "[-P<RADIUS shared secret>]\n"
-		"         [-w<write pcap file>] [-f<MSK/PMK file>]\n");
+		"         [-w<write pcap file>] [-f<MSK/PMK file>] "
+	       "[-t<decrypt threads>]\n");
 }
 
 
@@ -53,6 +54,7 @@ static void wlantest_init(struct wlantest *wt)
 	os_memset(wt, 0, sizeof(*wt));
 	wt->monitor_sock = -1;
 	wt->ctrl_sock = -1;
+	wt->decrypt_threads = -1;
 	for (i = 0; i < MAX_CTRL_CONNECTIONS; i++)
 		wt->ctrl_socks[i] = -1;
 	dl_list_init(&wt->passphrase);
@@ -208,7 +210,7 @@ int main(int argc, char *argv[])
 	wlantest_init(&wt);
 
 	for (;;) {
-		c = getopt(argc, argv, "cdf:hi:I:p:P:qr:R:w:W:");
+		c = getopt(argc, argv, "cdf:hi:I:p:P:qr:R:t:w:W:");
 		if (c < 0)
 			break;
 		switch (c) {
@@ -247,6 +249,9 @@ int main(int argc, char *argv[])
 		case 'R':
 			read_wired_file = optarg;
 			break;
+		case 't':
+			wt.decrypt_threads = atoi(optarg);
+			break;
 		case 'w':
 			write_file = optarg;
 			break;
@@ -17,9 +17,14 @@ struct ieee802_11_elems;
 struct radius_msg;
 struct ieee80211_hdr;
 struct wlantest_bss;
+struct decrypt_pool;
+struct pcap_mmap;
 
 #define MAX_RADIUS_SECRET_LEN 128
 
+#define WLANTEST_HASH_SIZE 256
+#define WLANTEST_HASH(a) (a[5])
+
 struct wlantest_radius_secret {
 	struct dl_list list;
 	char secret[MAX_RADIUS_SECRET_LEN];
@@ -46,6 +51,7 @@ struct wlantest_wep {
 
 struct wlantest_sta {
 	struct dl_list list;
+	struct wlantest_sta *hnext; /* next entry in hash table list */
 	struct wlantest_bss *bss;
 	u8 addr[ETH_ALEN];
 	enum {
@@ -110,6 +116,7 @@ struct wlantest_tdls {
 
 struct wlantest_bss {
 	struct dl_list list;
+	struct wlantest_bss *hnext; /* next entry in hash table list */
 	u8 bssid[ETH_ALEN];
 	u16 capab_info;
 	u16 prev_capab_info;
@@ -126,6 +133,7 @@ struct wlantest_bss {
 	int key_mgmt;
 	int rsn_capab;
 	struct dl_list sta; /* struct wlantest_sta */
+	struct wlantest_sta *sta_hash[WLANTEST_HASH_SIZE];
 	struct dl_list pmk; /* struct wlantest_pmk */
 	u8 gtk[4][32];
 	size_t gtk_len[4];
@@ -158,6 +166,7 @@ struct wlantest {
 
 	struct dl_list passphrase; /* struct wlantest_passphrase */
 	struct dl_list bss; /* struct wlantest_bss */
+	struct wlantest_bss *bss_hash[WLANTEST_HASH_SIZE];
 	struct dl_list secret; /* struct wlantest_radius_secret */
 	struct dl_list radius; /* struct wlantest_radius */
 	struct dl_list pmk; /* struct wlantest_pmk */
@@ -175,20 +184,61 @@ struct wlantest {
 	u8 last_hdr[30];
 	size_t last_len;
 	int last_mgmt_valid;
+
+	int decrypt_threads; /* -1 = one per CPU, 0 = decrypt inline */
+	struct decrypt_pool *decrypt_pool;
+	/* Frame that is being processed if it was decrypted in advance */
+	struct decrypt_job *decrypt_job;
+};
+
+/* Link-layer header types used in capture files */
+#define LINKTYPE_IEEE802_11 105
+#define LINKTYPE_PRISM_HEADER 119
+#define LINKTYPE_IEEE802_11_RADIOTAP 127
+
+struct pcap_mmap_frame {
+	struct timeval ts;
+	const u8 *data;
+	size_t caplen;
+	size_t len;
+	int linktype;
+};
+
+struct decrypt_job {
+	struct decrypt_job *next;
+	const struct ieee80211_hdr *hdr;
+	const u8 *data;
+	size_t data_len;
+	const u8 *bssid; /* frames of a BSS are decrypted in order */
+	int cipher; /* WPA_CIPHER_CCMP or WPA_CIPHER_TKIP */
+	u8 tk[32];
+	u8 *decrypted;
+	size_t decrypted_len;
+	int queued;
+	int done;
 };
 
 int add_wep(struct wlantest *wt, const char *key);
 int read_cap_file(struct wlantest *wt, const char *fname);
 int read_wired_cap_file(struct wlantest *wt, const char *fname);
+struct pcap_mmap * pcap_mmap_open(const char *fname);
+void pcap_mmap_close(struct pcap_mmap *p);
+int pcap_mmap_next(struct pcap_mmap *p, struct pcap_mmap_frame *frame);
 int write_pcap_init(struct wlantest *wt, const char *fname);
 void write_pcap_deinit(struct wlantest *wt);
 void write_pcap_captured(struct wlantest *wt, const u8 *buf, size_t len);
+void write_pcap_frame(struct wlantest *wt, const struct timeval *ts,
+		      const u8 *buf, size_t caplen, size_t len);
 void write_pcap_decrypted(struct wlantest *wt, const u8 *buf1, size_t len1,
 			  const u8 *buf2, size_t len2);
 void wlantest_process(struct wlantest *wt, const u8 *data, size_t len);
 void wlantest_process_prism(struct wlantest *wt, const u8 *data, size_t len);
 void wlantest_process_80211(struct wlantest *wt, const u8 *data, size_t len);
 void wlantest_process_wired(struct wlantest *wt, const u8 *data, size_t len);
+const u8 * wlantest_radiotap_frame(const u8 *data, size_t len,
+				   size_t *frame_len);
+const u8 * wlantest_prism_frame(const u8 *data, size_t len,
+				size_t *frame_len);
 u32 crc32(const u8 *frame, size_t frame_len);
 int monitor_init(struct wlantest *wt, const char *ifname);
 int monitor_init_wired(struct wlantest *wt, const char *ifname);
@@ -204,10 +254,12 @@ void rx_data_ip(struct wlantest *wt, const u8 *bssid, const u8 *sta_addr,
 void rx_data_80211_encap(struct wlantest *wt, const u8 *bssid,
 			 const u8 *sta_addr, const u8 *dst, const u8 *src,
 			 const u8 *data, size_t len);
+int rx_data_decrypt_job(struct wlantest *wt, const u8 *data, size_t len,
+			struct decrypt_job *job);
 
 struct wlantest_bss * bss_find(struct wlantest *wt, const u8 *bssid);
 struct wlantest_bss * bss_get(struct wlantest *wt, const u8 *bssid);
-void bss_deinit(struct wlantest_bss *bss);
+void bss_deinit(struct wlantest *wt, struct wlantest_bss *bss);
 void bss_update(struct wlantest *wt, struct wlantest_bss *bss,
 		struct ieee802_11_elems *elems);
 void bss_flush(struct wlantest *wt);
@@ -224,16 +276,29 @@ void sta_update_assoc(struct wlantest_sta *sta,
 
 u8 * ccmp_decrypt(const u8 *tk, const struct ieee80211_hdr *hdr,
 		  const u8 *data, size_t data_len, size_t *decrypted_len);
+u8 * ccmp_try_decrypt(const u8 *tk, const struct ieee80211_hdr *hdr,
+		      const u8 *data, size_t data_len, size_t *decrypted_len);
 u8 * ccmp_encrypt(const u8 *tk, u8 *frame, size_t len, size_t hdrlen, u8 *qos,
 		  u8 *pn, int keyid, size_t *encrypted_len);
 void ccmp_get_pn(u8 *pn, const u8 *data);
 
 u8 * tkip_decrypt(const u8 *tk, const struct ieee80211_hdr *hdr,
 		  const u8 *data, size_t data_len, size_t *decrypted_len);
+u8 * tkip_try_decrypt(const u8 *tk, const struct ieee80211_hdr *hdr,
+		      const u8 *data, size_t data_len, size_t *decrypted_len);
 u8 * tkip_encrypt(const u8 *tk, u8 *frame, size_t len, size_t hdrlen, u8 *qos,
 		  u8 *pn, int keyid, size_t *encrypted_len);
 void tkip_get_pn(u8 *pn, const u8 *data);
 
+struct decrypt_pool * decrypt_pool_init(int threads);
+void decrypt_pool_deinit(struct decrypt_pool *pool);
+void decrypt_pool_submit(struct decrypt_pool *pool, struct decrypt_job *job);
+void decrypt_pool_wait(struct decrypt_pool *pool, struct decrypt_job *job);
+void decrypt_job_key(struct decrypt_job *job, int cipher, const u8 *tk);
+u8 * wlantest_decrypt(struct wlantest *wt, int cipher, const u8 *tk,
+		      const struct ieee80211_hdr *hdr, const u8 *data,
+		      size_t data_len, size_t *decrypted_len);
+
 u8 * wep_decrypt(struct wlantest *wt, const struct ieee80211_hdr *hdr,
 		 const u8 *data, size_t data_len, size_t *decrypted_len);
 
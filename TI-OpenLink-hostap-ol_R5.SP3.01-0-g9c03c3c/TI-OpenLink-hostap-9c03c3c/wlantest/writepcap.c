@@ -61,6 +61,23 @@ void write_pcap_captured(struct wlantest *wt, const u8 *buf, size_t len)
 }
 
 
+void write_pcap_frame(struct wlantest *wt, const struct timeval *ts,
+		      const u8 *buf, size_t caplen, size_t len)
+{
+	struct pcap_pkthdr h;
+
+	if (!wt->write_pcap_dumper)
+		return;
+
+	os_memset(&h, 0, sizeof(h));
+	wt->write_pcap_time = *ts;
+	h.ts = *ts;
+	h.caplen = caplen;
+	h.len = len;
+	pcap_dump(wt->write_pcap_dumper, &h, buf);
+}
+
+
 void write_pcap_decrypted(struct wlantest *wt, const u8 *buf1, size_t len1,
 			  const u8 *buf2, size_t len2)
 {
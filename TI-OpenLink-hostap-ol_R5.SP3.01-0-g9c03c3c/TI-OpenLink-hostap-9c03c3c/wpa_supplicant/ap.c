@@ -1003,9 +1003,13 @@ int wpa_supplicant_ap_mac_addr_filter(struct wpa_supplicant *wpa_s,
 	os_free(conf->accept_mac);
 	conf->accept_mac = NULL;
 	conf->num_accept_mac = 0;
+	hostapd_maclist_hash_free(conf->accept_mac_hash);
+	conf->accept_mac_hash = NULL;
 	os_free(conf->deny_mac);
 	conf->deny_mac = NULL;
 	conf->num_deny_mac = 0;
+	hostapd_maclist_hash_free(conf->deny_mac_hash);
+	conf->deny_mac_hash = NULL;
 
 	if (addr == NULL) {
 		conf->macaddr_acl = ACCEPT_UNLESS_DENIED;
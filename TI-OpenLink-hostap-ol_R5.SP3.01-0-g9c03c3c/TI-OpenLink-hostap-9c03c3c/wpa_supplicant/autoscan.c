@@ -121,14 +121,12 @@ void autoscan_deinit(struct wpa_supplicant *wpa_s)
 }
 
 
-int autoscan_notify_scan(struct wpa_supplicant *wpa_s,
-			 struct wpa_scan_results *scan_res)
+int autoscan_notify_scan(struct wpa_supplicant *wpa_s)
 {
 	int interval;
 
 	if (wpa_s->autoscan && wpa_s->autoscan_priv) {
-		interval = wpa_s->autoscan->notify_scan(wpa_s->autoscan_priv,
-							scan_res);
+		interval = wpa_s->autoscan->notify_scan(wpa_s->autoscan_priv);
 
 		if (interval <= 0)
 			return -1;
@@ -17,15 +17,15 @@ struct autoscan_ops {
 	void * (*init)(struct wpa_supplicant *wpa_s, const char *params);
 	void (*deinit)(void *priv);
 
-	int (*notify_scan)(void *priv, struct wpa_scan_results *scan_res);
+	/* The BSSes from the scan are listed in wpa_s->last_scan_res */
+	int (*notify_scan)(void *priv);
 };
 
 #ifdef CONFIG_AUTOSCAN
 
 int autoscan_init(struct wpa_supplicant *wpa_s, int req_scan);
 void autoscan_deinit(struct wpa_supplicant *wpa_s);
-int autoscan_notify_scan(struct wpa_supplicant *wpa_s,
-			 struct wpa_scan_results *scan_res);
+int autoscan_notify_scan(struct wpa_supplicant *wpa_s);
 
 #else /* CONFIG_AUTOSCAN */
 
@@ -38,8 +38,7 @@ static inline void autoscan_deinit(struct wpa_supplicant *wpa_s)
 {
 }
 
-static inline int autoscan_notify_scan(struct wpa_supplicant *wpa_s,
-				       struct wpa_scan_results *scan_res)
+static inline int autoscan_notify_scan(struct wpa_supplicant *wpa_s)
 {
 	return 0;
 }
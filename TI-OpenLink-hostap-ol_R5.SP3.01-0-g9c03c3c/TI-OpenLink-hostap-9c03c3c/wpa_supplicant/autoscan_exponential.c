@@ -73,8 +73,7 @@ static void autoscan_exponential_deinit(void *priv)
 }
 
 
-static int autoscan_exponential_notify_scan(void *priv,
-					    struct wpa_scan_results *scan_res)
+static int autoscan_exponential_notify_scan(void *priv)
 {
 	struct autoscan_exponential_data *data = priv;
 
@@ -66,8 +66,7 @@ static void autoscan_periodic_deinit(void *priv)
 }
 
 
-static int autoscan_periodic_notify_scan(void *priv,
-					 struct wpa_scan_results *scan_res)
+static int autoscan_periodic_notify_scan(void *priv)
 {
 	struct autoscan_periodic_data *data = priv;
 
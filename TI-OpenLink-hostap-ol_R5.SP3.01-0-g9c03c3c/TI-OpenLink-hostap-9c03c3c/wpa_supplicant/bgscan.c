@@ -88,12 +88,10 @@ void bgscan_deinit(struct wpa_supplicant *wpa_s)
 }
 
 
-int bgscan_notify_scan(struct wpa_supplicant *wpa_s,
-		       struct wpa_scan_results *scan_res)
+int bgscan_notify_scan(struct wpa_supplicant *wpa_s)
 {
 	if (wpa_s->bgscan && wpa_s->bgscan_priv)
-		return wpa_s->bgscan->notify_scan(wpa_s->bgscan_priv,
-						  scan_res);
+		return wpa_s->bgscan->notify_scan(wpa_s->bgscan_priv);
 	return 0;
 }
 
@@ -19,7 +19,8 @@ struct bgscan_ops {
 		       const struct wpa_ssid *ssid);
 	void (*deinit)(void *priv);
 
-	int (*notify_scan)(void *priv, struct wpa_scan_results *scan_res);
+	/* The BSSes from the scan are listed in wpa_s->last_scan_res */
+	int (*notify_scan)(void *priv);
 	void (*notify_beacon_loss)(void *priv);
 	void (*notify_signal_change)(void *priv, int above,
 				     int current_signal,
@@ -31,8 +32,7 @@ struct bgscan_ops {
 
 int bgscan_init(struct wpa_supplicant *wpa_s, struct wpa_ssid *ssid);
 void bgscan_deinit(struct wpa_supplicant *wpa_s);
-int bgscan_notify_scan(struct wpa_supplicant *wpa_s,
-		       struct wpa_scan_results *scan_res);
+int bgscan_notify_scan(struct wpa_supplicant *wpa_s);
 void bgscan_notify_beacon_loss(struct wpa_supplicant *wpa_s);
 void bgscan_notify_signal_change(struct wpa_supplicant *wpa_s, int above,
 				 int current_signal, int current_noise,
@@ -50,8 +50,7 @@ static inline void bgscan_deinit(struct wpa_supplicant *wpa_s)
 {
 }
 
-static inline int bgscan_notify_scan(struct wpa_supplicant *wpa_s,
-				     struct wpa_scan_results *scan_res)
+static inline int bgscan_notify_scan(struct wpa_supplicant *wpa_s)
 {
 	return 0;
 }
@@ -17,6 +17,7 @@
 #include "wpa_supplicant_i.h"
 #include "driver_i.h"
 #include "scan.h"
+#include "bss.h"
 #include "bgscan.h"
 
 struct bgscan_learn_bss {
@@ -477,26 +478,20 @@ static void bgscan_learn_deinit(void *priv)
 
 
 static int bgscan_learn_bss_match(struct bgscan_learn_data *data,
-				  struct wpa_scan_res *bss)
+				  struct wpa_bss *bss)
 {
-	const u8 *ie;
-
-	ie = wpa_scan_get_ie(bss, WLAN_EID_SSID);
-	if (ie == NULL)
-		return 0;
-
-	if (data->ssid->ssid_len != ie[1] ||
-	    os_memcmp(data->ssid->ssid, ie + 2, ie[1]) != 0)
+	if (data->ssid->ssid_len != bss->ssid_len ||
+	    os_memcmp(data->ssid->ssid, bss->ssid, bss->ssid_len) != 0)
 		return 0; /* SSID mismatch */
 
 	return 1;
 }
 
 
-static int bgscan_learn_notify_scan(void *priv,
-				    struct wpa_scan_results *scan_res)
+static int bgscan_learn_notify_scan(void *priv)
 {
 	struct bgscan_learn_data *data = priv;
+	struct wpa_supplicant *wpa_s = data->wpa_s;
 	size_t i, j;
 #define MAX_BSS 50
 	u8 bssid[MAX_BSS * ETH_ALEN];
@@ -508,8 +503,8 @@ static int bgscan_learn_notify_scan(void *priv,
 	eloop_register_timeout(data->scan_interval, 0, bgscan_learn_timeout,
 			       data, NULL);
 
-	for (i = 0; i < scan_res->num; i++) {
-		struct wpa_scan_res *res = scan_res->res[i];
+	for (i = 0; i < wpa_s->last_scan_res_used; i++) {
+		struct wpa_bss *res = wpa_s->last_scan_res[i];
 		if (!bgscan_learn_bss_match(data, res))
 			continue;
 
@@ -522,8 +517,8 @@ static int bgscan_learn_notify_scan(void *priv,
 	wpa_printf(MSG_DEBUG, "bgscan learn: %u matching BSSes in scan "
 		   "results", (unsigned int) num_bssid);
 
-	for (i = 0; i < scan_res->num; i++) {
-		struct wpa_scan_res *res = scan_res->res[i];
+	for (i = 0; i < wpa_s->last_scan_res_used; i++) {
+		struct wpa_bss *res = wpa_s->last_scan_res[i];
 		struct bgscan_learn_bss *bss;
 
 		if (!bgscan_learn_bss_match(data, res))
@@ -40,12 +40,12 @@ static void blacklist_timeout(void *eloop_ctx, void *timeout_ctx)
 	struct wpa_supplicant *wpa_s = eloop_ctx;
 	struct wpa_blacklist *e, *prev = NULL, *next = NULL;
 	struct wpa_blacklist *earliest = NULL;
-	struct os_time now;
+	struct os_reltime now;
 	unsigned long next_time;
 
 	wpa_printf(MSG_DEBUG, "Starting blacklist timeout eloop");
 
-	os_get_time(&now);
+	os_get_reltime(&now);
 	e = wpa_s->blacklist;
 	while (e) {
 		if (now.sec >= e->last_add.sec + BLACKLIST_TIMEOUT) {
@@ -64,7 +64,7 @@ static void blacklist_timeout(void *eloop_ctx, void *timeout_ctx)
 			continue;
 		}
 		if (!earliest ||
-		    os_time_before(&e->last_add, &earliest->last_add))
+		    os_reltime_before(&e->last_add, &earliest->last_add))
 			earliest = e;
 		prev = e;
 		e = e->next;
@@ -101,7 +101,7 @@ int wpa_blacklist_add(struct wpa_supplicant *wpa_s, const u8 *bssid)
 	e = wpa_blacklist_get(wpa_s, bssid);
 	if (e) {
 		e->count++;
-		os_get_time(&e->last_add);
+		os_get_reltime(&e->last_add);
 		wpa_printf(MSG_DEBUG, "BSSID " MACSTR " blacklist count "
 			   "incremented to %d",
 			   MAC2STR(bssid), e->count);
@@ -113,7 +113,7 @@ int wpa_blacklist_add(struct wpa_supplicant *wpa_s, const u8 *bssid)
 		return -1;
 	os_memcpy(e->bssid, bssid, ETH_ALEN);
 	e->count = 1;
-	os_get_time(&e->last_add);
+	os_get_reltime(&e->last_add);
 	e->next = wpa_s->blacklist;
 	wpa_s->blacklist = e;
 	wpa_printf(MSG_DEBUG, "Added BSSID " MACSTR " into blacklist",
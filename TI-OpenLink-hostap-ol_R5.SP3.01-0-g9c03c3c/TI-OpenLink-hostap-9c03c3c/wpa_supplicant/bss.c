@@ -34,12 +34,72 @@
 #define WPA_BSS_RATES_CHANGED_FLAG	BIT(7)
 #define WPA_BSS_IES_CHANGED_FLAG	BIT(8)
 
+#define WPA_BSS_HASH(bssid) \
+	(((bssid)[4] ^ (bssid)[5]) & (WPA_BSS_HASH_SIZE - 1))
+#define WPA_BSS_ID_HASH(id) ((id) & (WPA_BSS_HASH_SIZE - 1))
+
+
+static void wpa_bss_hash_add(struct wpa_supplicant *wpa_s, struct wpa_bss *bss)
+{
+	dl_list_add(&wpa_s->bss_hash[WPA_BSS_HASH(bss->bssid)],
+		    &bss->hash_bssid);
+	dl_list_add(&wpa_s->bss_id_hash[WPA_BSS_ID_HASH(bss->id)],
+		    &bss->hash_id);
+}
+
+
+static void wpa_bss_hash_del(struct wpa_bss *bss)
+{
+	dl_list_del(&bss->hash_bssid);
+	dl_list_del(&bss->hash_id);
+}
+
+
+static void wpa_bss_last_scan_res_del(struct wpa_supplicant *wpa_s,
+				      struct wpa_bss *bss)
+{
+	unsigned int i;
+
+	for (i = 0; i < wpa_s->last_scan_res_used; i++) {
+		if (wpa_s->last_scan_res[i] == bss) {
+			os_memmove(&wpa_s->last_scan_res[i],
+				   &wpa_s->last_scan_res[i + 1],
+				   (wpa_s->last_scan_res_used - i - 1) *
+				   sizeof(struct wpa_bss *));
+			wpa_s->last_scan_res_used--;
+			break;
+		}
+	}
+}
+
+
+static void wpa_bss_last_scan_res_add(struct wpa_supplicant *wpa_s,
+				      struct wpa_bss *bss)
+{
+	if (wpa_s->last_scan_res_used == wpa_s->last_scan_res_size) {
+		struct wpa_bss **n;
+		unsigned int size;
+
+		size = wpa_s->last_scan_res_size ?
+			wpa_s->last_scan_res_size * 2 : 32;
+		n = os_realloc(wpa_s->last_scan_res, size * sizeof(*n));
+		if (n == NULL)
+			return;
+		wpa_s->last_scan_res = n;
+		wpa_s->last_scan_res_size = size;
+	}
+	wpa_s->last_scan_res[wpa_s->last_scan_res_used++] = bss;
+}
+
 
 static void wpa_bss_remove(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 			   const char *reason)
 {
+	if (bss->last_update_idx == wpa_s->bss_update_idx)
+		wpa_bss_last_scan_res_del(wpa_s, bss);
 	dl_list_del(&bss->list);
 	dl_list_del(&bss->list_id);
+	wpa_bss_hash_del(bss);
 	wpa_s->num_bss--;
 	wpa_dbg(wpa_s, MSG_DEBUG, "BSS: Remove id %u BSSID " MACSTR
 		" SSID '%s' due to %s", bss->id, MAC2STR(bss->bssid),
@@ -70,7 +130,8 @@ struct wpa_bss * wpa_bss_get(struct wpa_supplicant *wpa_s, const u8 *bssid,
 	struct wpa_bss *bss;
 	if (!wpa_supplicant_filter_bssid_match(wpa_s, bssid))
 		return NULL;
-	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
+	dl_list_for_each(bss, &wpa_s->bss_hash[WPA_BSS_HASH(bssid)],
+			 struct wpa_bss, hash_bssid) {
 		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) == 0 &&
 		    bss->ssid_len == ssid_len &&
 		    os_memcmp(bss->ssid, ssid, ssid_len) == 0)
@@ -94,7 +155,7 @@ static void wpa_bss_copy_res(struct wpa_bss *dst, struct wpa_scan_res *src)
 	dst->level = src->level;
 	dst->tsf = src->tsf;
 
-	os_get_time(&dst->last_update);
+	os_get_reltime(&dst->last_update);
 	dst->last_update.sec -= src->age / 1000;
 	usec = (src->age % 1000) * 1000;
 	if (dst->last_update.usec < usec) {
@@ -121,6 +182,16 @@ static int wpa_bss_known(struct wpa_supplicant *wpa_s, struct wpa_bss *bss)
 }
 
 
+static int wpa_bss_freq_in_current_band(struct wpa_supplicant *wpa_s, int freq)
+{
+	if ((wpa_s->setband == WPA_SETBAND_2G && freq > 2500) ||
+	    (wpa_s->setband == WPA_SETBAND_5G && freq < 2500))
+		return 0;
+
+	return 1;
+}
+
+
 static int wpa_bss_in_use(struct wpa_supplicant *wpa_s, struct wpa_bss *bss)
 {
 	return bss == wpa_s->current_bss ||
@@ -189,11 +260,13 @@ static void wpa_bss_add(struct wpa_supplicant *wpa_s,
 
 	dl_list_add_tail(&wpa_s->bss, &bss->list);
 	dl_list_add_tail(&wpa_s->bss_id, &bss->list_id);
+	wpa_bss_hash_add(wpa_s, bss);
 	wpa_s->num_bss++;
 	wpa_dbg(wpa_s, MSG_DEBUG, "BSS: Add new id %u BSSID " MACSTR
 		" SSID '%s'",
 		bss->id, MAC2STR(bss->bssid), wpa_ssid_txt(ssid, ssid_len));
 	wpas_notify_bss_added(wpa_s, bss->bssid, bss->id);
+	wpa_bss_last_scan_res_add(wpa_s, bss);
 	if (wpa_s->num_bss > wpa_s->conf->bss_max_count &&
 	    wpa_bss_remove_oldest(wpa_s) != 0) {
 		wpa_printf(MSG_ERROR, "Increasing the MAX BSS count to %d "
@@ -336,13 +409,15 @@ static void wpa_bss_update(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 			   struct wpa_scan_res *res)
 {
 	u32 changes;
+	int seen = bss->last_update_idx == wpa_s->bss_update_idx;
 
 	changes = wpa_bss_compare_res(bss, res);
 	bss->scan_miss_count = 0;
 	bss->last_update_idx = wpa_s->bss_update_idx;
 	wpa_bss_copy_res(bss, res);
-	/* Move the entry to the end of the list */
+	/* Move the entry to the end of the list and the head of its hash chain */
 	dl_list_del(&bss->list);
+	wpa_bss_hash_del(bss);
 	if (bss->ie_len + bss->beacon_ie_len >=
 	    res->ie_len + res->beacon_ie_len) {
 		os_memcpy(bss + 1, res + 1, res->ie_len + res->beacon_ie_len);
@@ -352,6 +427,11 @@ static void wpa_bss_update(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 		struct wpa_bss *nbss;
 		struct dl_list *prev = bss->list_id.prev;
 		dl_list_del(&bss->list_id);
+		if (seen) {
+			/* Added back below since the entry may move */
+			wpa_bss_last_scan_res_del(wpa_s, bss);
+			seen = 0;
+		}
 		nbss = os_realloc(bss, sizeof(*bss) + res->ie_len +
 				  res->beacon_ie_len);
 		if (nbss) {
@@ -366,6 +446,9 @@ static void wpa_bss_update(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 		dl_list_add(prev, &bss->list_id);
 	}
 	dl_list_add_tail(&wpa_s->bss, &bss->list);
+	wpa_bss_hash_add(wpa_s, bss);
+	if (!seen)
+		wpa_bss_last_scan_res_add(wpa_s, bss);
 
 	notify_bss_changes(wpa_s, changes, bss);
 }
@@ -374,6 +457,7 @@ static void wpa_bss_update(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 void wpa_bss_update_start(struct wpa_supplicant *wpa_s)
 {
 	wpa_s->bss_update_idx++;
+	wpa_s->last_scan_res_used = 0;
 	wpa_dbg(wpa_s, MSG_DEBUG, "BSS: Start scan result update %u",
 		wpa_s->bss_update_idx);
 }
@@ -417,6 +501,30 @@ void wpa_bss_update_scan_res(struct wpa_supplicant *wpa_s,
 	/* TODO: add option for ignoring BSSes we are not interested in
 	 * (to save memory) */
 	bss = wpa_bss_get(wpa_s, res->bssid, ssid + 2, ssid[1]);
+	if (bss && bss->last_update_idx == wpa_s->bss_update_idx &&
+	    (bss->flags & WPA_SCAN_ASSOCIATED) &&
+	    !(res->flags & WPA_SCAN_ASSOCIATED)) {
+		/*
+		 * Same BSSID,SSID pair was already seen in this update on
+		 * another channel. Prefer the associated entry in order to
+		 * keep the correct frequency in the BSS table.
+		 */
+		return;
+	}
+	if (!wpa_bss_freq_in_current_band(wpa_s, res->freq) &&
+	    (bss == NULL || !wpa_bss_in_use(wpa_s, bss))) {
+		/*
+		 * Entries not in the selected band are not kept in the table.
+		 * Drop them here instead of adding and then expiring them in
+		 * wpa_bss_update_end().
+		 */
+		if (bss) {
+			wpa_dbg(wpa_s, MSG_DEBUG, "BSS: Expire BSS %u due to "
+				"freq not in current band", bss->id);
+			wpa_bss_remove(wpa_s, bss, "non-selected band");
+		}
+		return;
+	}
 	if (bss == NULL)
 		wpa_bss_add(wpa_s, ssid + 2, ssid[1], res);
 	else
@@ -466,11 +574,7 @@ static int wpa_bss_included_in_scan(const struct wpa_bss *bss,
 
 int wpa_bss_in_current_band(struct wpa_supplicant *wpa_s, struct wpa_bss *bss)
 {
-	if ((wpa_s->setband == WPA_SETBAND_2G && bss->freq > 2500) ||
-	    (wpa_s->setband == WPA_SETBAND_5G && bss->freq < 2500))
-		return 0;
-
-	return 1;
+	return wpa_bss_freq_in_current_band(wpa_s, bss->freq);
 }
 
 void wpa_bss_update_end(struct wpa_supplicant *wpa_s, struct scan_info *info,
@@ -481,7 +585,14 @@ void wpa_bss_update_end(struct wpa_supplicant *wpa_s, struct scan_info *info,
 	if (!new_scan)
 		return; /* do not expire entries without new scan */
 
+	/*
+	 * Entries updated in this scan were moved to the end of the list in
+	 * update order, so only the entries before the first updated one need
+	 * to be considered for expiration.
+	 */
 	dl_list_for_each_safe(bss, n, &wpa_s->bss, struct wpa_bss, list) {
+		if (bss->last_update_idx == wpa_s->bss_update_idx)
+			break;
 		if (wpa_bss_in_use(wpa_s, bss))
 			continue;
 		if (!wpa_bss_in_current_band(wpa_s, bss)) {
@@ -505,19 +616,19 @@ void wpa_bss_update_end(struct wpa_supplicant *wpa_s, struct scan_info *info,
 void wpa_bss_flush_by_age(struct wpa_supplicant *wpa_s, int age)
 {
 	struct wpa_bss *bss, *n;
-	struct os_time t;
+	struct os_reltime t;
 
 	if (dl_list_empty(&wpa_s->bss))
 		return;
 
-	os_get_time(&t);
+	os_get_reltime(&t);
 	t.sec -= age;
 
 	dl_list_for_each_safe(bss, n, &wpa_s->bss, struct wpa_bss, list) {
 		if (wpa_bss_in_use(wpa_s, bss))
 			continue;
 
-		if (os_time_before(&bss->last_update, &t)) {
+		if (os_reltime_before(&bss->last_update, &t)) {
 			wpa_bss_remove(wpa_s, bss, __func__);
 		} else
 			break;
@@ -537,8 +648,14 @@ static void wpa_bss_timeout(void *eloop_ctx, void *timeout_ctx)
 
 int wpa_bss_init(struct wpa_supplicant *wpa_s)
 {
+	int i;
+
 	dl_list_init(&wpa_s->bss);
 	dl_list_init(&wpa_s->bss_id);
+	for (i = 0; i < WPA_BSS_HASH_SIZE; i++) {
+		dl_list_init(&wpa_s->bss_hash[i]);
+		dl_list_init(&wpa_s->bss_id_hash[i]);
+	}
 	eloop_register_timeout(WPA_BSS_EXPIRATION_PERIOD, 0,
 			       wpa_bss_timeout, wpa_s, NULL);
 	return 0;
@@ -564,6 +681,10 @@ void wpa_bss_deinit(struct wpa_supplicant *wpa_s)
 {
 	eloop_cancel_timeout(wpa_bss_timeout, wpa_s, NULL);
 	wpa_bss_flush(wpa_s);
+	os_free(wpa_s->last_scan_res);
+	wpa_s->last_scan_res = NULL;
+	wpa_s->last_scan_res_used = 0;
+	wpa_s->last_scan_res_size = 0;
 }
 
 
@@ -573,7 +694,9 @@ struct wpa_bss * wpa_bss_get_bssid(struct wpa_supplicant *wpa_s,
 	struct wpa_bss *bss;
 	if (!wpa_supplicant_filter_bssid_match(wpa_s, bssid))
 		return NULL;
-	dl_list_for_each_reverse(bss, &wpa_s->bss, struct wpa_bss, list) {
+	/* Hash chains are kept with the most recently updated entry first */
+	dl_list_for_each(bss, &wpa_s->bss_hash[WPA_BSS_HASH(bssid)],
+			 struct wpa_bss, hash_bssid) {
 		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) == 0)
 			return bss;
 	}
@@ -601,7 +724,8 @@ struct wpa_bss * wpa_bss_get_p2p_dev_addr(struct wpa_supplicant *wpa_s,
 struct wpa_bss * wpa_bss_get_id(struct wpa_supplicant *wpa_s, unsigned int id)
 {
 	struct wpa_bss *bss;
-	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
+	dl_list_for_each(bss, &wpa_s->bss_id_hash[WPA_BSS_ID_HASH(id)],
+			 struct wpa_bss, hash_id) {
 		if (bss->id == id)
 			return bss;
 	}
@@ -679,6 +803,41 @@ struct wpabuf * wpa_bss_get_vendor_ie_multi(const struct wpa_bss *bss,
 }
 
 
+struct wpabuf * wpa_bss_get_vendor_ie_multi_beacon(const struct wpa_bss *bss,
+						   u32 vendor_type)
+{
+	struct wpabuf *buf;
+	const u8 *end, *pos;
+
+	if (bss->beacon_ie_len == 0)
+		return NULL;
+
+	buf = wpabuf_alloc(bss->beacon_ie_len);
+	if (buf == NULL)
+		return NULL;
+
+	pos = (const u8 *) (bss + 1);
+	pos += bss->ie_len;
+	end = pos + bss->beacon_ie_len;
+
+	while (pos + 1 < end) {
+		if (pos + 2 + pos[1] > end)
+			break;
+		if (pos[0] == WLAN_EID_VENDOR_SPECIFIC && pos[1] >= 4 &&
+		    vendor_type == WPA_GET_BE32(&pos[2]))
+			wpabuf_put_data(buf, pos + 2 + 4, pos[1] - 4);
+		pos += 2 + pos[1];
+	}
+
+	if (wpabuf_len(buf) == 0) {
+		wpabuf_free(buf);
+		buf = NULL;
+	}
+
+	return buf;
+}
+
+
 int wpa_bss_get_max_rate(const struct wpa_bss *bss)
 {
 	int rate = 0;
@@ -23,6 +23,8 @@ struct wpa_scan_res;
  * struct wpa_bss - BSS table
  * @list: List entry for struct wpa_supplicant::bss
  * @list_id: List entry for struct wpa_supplicant::bss_id
+ * @hash_bssid: List entry for struct wpa_supplicant::bss_hash
+ * @hash_id: List entry for struct wpa_supplicant::bss_id_hash
  * @id: Unique identifier for this BSS entry
  * @scan_miss_count: Number of counts without seeing this BSS
  * @flags: information flags about the BSS/IBSS (WPA_BSS_*)
@@ -45,6 +47,8 @@ struct wpa_scan_res;
 struct wpa_bss {
 	struct dl_list list;
 	struct dl_list list_id;
+	struct dl_list hash_bssid;
+	struct dl_list hash_id;
 	unsigned int id;
 	unsigned int scan_miss_count;
 	unsigned int last_update_idx;
@@ -59,7 +63,7 @@ struct wpa_bss {
 	int noise;
 	int level;
 	u64 tsf;
-	struct os_time last_update;
+	struct os_reltime last_update;
 #ifdef CONFIG_INTERWORKING
 	struct wpabuf *anqp_venue_name;
 	struct wpabuf *anqp_network_auth_type;
@@ -101,6 +105,8 @@ const u8 * wpa_bss_get_ie(const struct wpa_bss *bss, u8 ie);
 const u8 * wpa_bss_get_vendor_ie(const struct wpa_bss *bss, u32 vendor_type);
 struct wpabuf * wpa_bss_get_vendor_ie_multi(const struct wpa_bss *bss,
 					    u32 vendor_type);
+struct wpabuf * wpa_bss_get_vendor_ie_multi_beacon(const struct wpa_bss *bss,
+						   u32 vendor_type);
 int wpa_bss_get_max_rate(const struct wpa_bss *bss);
 int wpa_bss_get_bit_rates(const struct wpa_bss *bss, u8 **rates);
 int wpa_bss_in_current_band(struct wpa_supplicant *wpa_s, struct wpa_bss *bss);
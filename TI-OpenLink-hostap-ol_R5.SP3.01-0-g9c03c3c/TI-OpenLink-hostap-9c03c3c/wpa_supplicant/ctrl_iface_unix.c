@@ -11,6 +11,10 @@
 #include <sys/stat.h>
 #include <grp.h>
 #include <stddef.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+#endif /* __linux__ */
 #ifdef ANDROID
 #include <cutils/sockets.h>
 #endif /* ANDROID */
@@ -18,6 +22,7 @@
 #include "utils/common.h"
 #include "utils/eloop.h"
 #include "utils/list.h"
+#include "common/wpa_ctrl.h"
 #include "eapol_supp/eapol_supp_sm.h"
 #include "config.h"
 #include "wpa_supplicant_i.h"
@@ -25,6 +30,35 @@
 
 /* Per-interface ctrl_iface */
 
+/*
+ * Events that cannot be sent to a monitor immediately (its socket buffer is
+ * full or it uses batched delivery) are queued for the monitor. These limit
+ * the queue length; further events are dropped until the monitor catches up.
+ */
+#define CTRL_IFACE_MAX_QUEUED 256
+#define CTRL_IFACE_MAX_QUEUED_BYTES 65536
+/* Maximum number of events in one batched message */
+#define CTRL_IFACE_MAX_BATCH_EVENTS 64
+/* Interval for retrying delivery to monitors with full socket buffers */
+#define CTRL_IFACE_RETRY_USEC 100000
+/*
+ * Datagrams that a monitor has not yet read are charged to the send buffer of
+ * the control interface socket, so a monitor that does not read its socket
+ * could otherwise use all of it and block the command responses. Events are
+ * queued instead of sent once this share of the send buffer is in use.
+ */
+#define CTRL_IFACE_MONITOR_SNDBUF_SHARE 2 /* 1/2 */
+
+/**
+ * struct ctrl_iface_msg - Event queued for a control interface monitor
+ */
+struct ctrl_iface_msg {
+	struct dl_list list;
+	size_t len; /* length of "<level>" prefix and event text */
+	size_t txt; /* offset of the event text */
+	/* followed by len octets of data */
+};
+
 /**
  * struct wpa_ctrl_dst - Internal data structure of control interface monitors
  *
@@ -38,24 +72,55 @@ struct wpa_ctrl_dst {
 	socklen_t addrlen;
 	int debug_level;
 	int errors;
+	int batch; /* attached with ATTACH BATCH */
+	int overflow; /* events dropped since the queue was last empty */
+	struct dl_list queue; /* struct ctrl_iface_msg */
+	unsigned int queued;
+	size_t queued_bytes;
+
+	/* Statistics for MONITOR_STATS */
+	unsigned int sent;
+	unsigned int datagrams;
+	unsigned int coalesced;
+	unsigned int dropped;
+	unsigned int send_errors;
 };
 
 
 struct ctrl_iface_priv {
 	struct wpa_supplicant *wpa_s;
 	int sock;
+	int sndbuf;
 	struct dl_list ctrl_dst;
+	enum {
+		CTRL_FLUSH_NONE, CTRL_FLUSH_NOW, CTRL_FLUSH_RETRY
+	} flush;
 };
 
 
 static void wpa_supplicant_ctrl_iface_send(struct ctrl_iface_priv *priv,
 					   int level, const char *buf,
 					   size_t len);
+static void wpa_supplicant_ctrl_iface_flush(void *eloop_ctx,
+					    void *timeout_ctx);
+static char * wpa_supplicant_ctrl_iface_monitor_stats(
+	struct ctrl_iface_priv *priv, size_t *resp_len);
+
+
+static void wpa_supplicant_ctrl_iface_free_dst(struct wpa_ctrl_dst *dst)
+{
+	struct ctrl_iface_msg *msg, *prev;
+
+	dl_list_for_each_safe(msg, prev, &dst->queue, struct ctrl_iface_msg,
+			      list)
+		os_free(msg);
+	os_free(dst);
+}
 
 
 static int wpa_supplicant_ctrl_iface_attach(struct ctrl_iface_priv *priv,
 					    struct sockaddr_un *from,
-					    socklen_t fromlen)
+					    socklen_t fromlen, int batch)
 {
 	struct wpa_ctrl_dst *dst;
 
@@ -65,6 +130,8 @@ static int wpa_supplicant_ctrl_iface_attach(struct ctrl_iface_priv *priv,
 	os_memcpy(&dst->addr, from, sizeof(struct sockaddr_un));
 	dst->addrlen = fromlen;
 	dst->debug_level = MSG_INFO;
+	dst->batch = batch;
+	dl_list_init(&dst->queue);
 	dl_list_add(&priv->ctrl_dst, &dst->list);
 	wpa_hexdump(MSG_DEBUG, "CTRL_IFACE monitor attached",
 		    (u8 *) from->sun_path,
@@ -85,7 +152,7 @@ static int wpa_supplicant_ctrl_iface_detach(struct ctrl_iface_priv *priv,
 			      fromlen - offsetof(struct sockaddr_un, sun_path))
 		    == 0) {
 			dl_list_del(&dst->list);
-			os_free(dst);
+			wpa_supplicant_ctrl_iface_free_dst(dst);
 			wpa_hexdump(MSG_DEBUG, "CTRL_IFACE monitor detached",
 				    (u8 *) from->sun_path,
 				    fromlen -
@@ -145,13 +212,20 @@ static void wpa_supplicant_ctrl_iface_receive(int sock, void *eloop_ctx,
 	}
 	buf[res] = '\0';
 
-	if (os_strcmp(buf, "ATTACH") == 0) {
-		if (wpa_supplicant_ctrl_iface_attach(priv, &from, fromlen))
+	if (os_strcmp(buf, "ATTACH") == 0 ||
+	    os_strcmp(buf, "ATTACH BATCH") == 0) {
+		if (wpa_supplicant_ctrl_iface_attach(priv, &from, fromlen,
+						     buf[6] != '\0'))
 			reply_len = 1;
 		else {
 			new_attached = 1;
 			reply_len = 2;
 		}
+	} else if (os_strcmp(buf, "MONITOR_STATS") == 0) {
+		reply = wpa_supplicant_ctrl_iface_monitor_stats(priv,
+								&reply_len);
+		if (reply == NULL)
+			reply_len = 1;
 	} else if (os_strcmp(buf, "DETACH") == 0) {
 		if (wpa_supplicant_ctrl_iface_detach(priv, &from, fromlen))
 			reply_len = 1;
@@ -288,6 +362,7 @@ wpa_supplicant_ctrl_iface_init(struct wpa_supplicant *wpa_s)
 	char *buf, *dir = NULL, *gid_str = NULL;
 	struct group *grp;
 	char *endp;
+	socklen_t optlen;
 
 	priv = os_zalloc(sizeof(*priv));
 	if (priv == NULL)
@@ -434,6 +509,10 @@ wpa_supplicant_ctrl_iface_init(struct wpa_supplicant *wpa_s)
 #ifdef ANDROID
 havesock:
 #endif /* ANDROID */
+	optlen = sizeof(priv->sndbuf);
+	if (getsockopt(priv->sock, SOL_SOCKET, SO_SNDBUF, &priv->sndbuf,
+		       &optlen) < 0)
+		priv->sndbuf = 0;
 	eloop_register_read_sock(priv->sock, wpa_supplicant_ctrl_iface_receive,
 				 wpa_s, priv);
 	wpa_msg_register_cb(wpa_supplicant_ctrl_iface_msg_cb);
@@ -462,6 +541,7 @@ void wpa_supplicant_ctrl_iface_deinit(struct ctrl_iface_priv *priv)
 		char *fname;
 		char *buf, *dir = NULL, *gid_str = NULL;
 		eloop_unregister_read_sock(priv->sock);
+		wpa_supplicant_ctrl_iface_flush(priv, NULL);
 		if (!dl_list_empty(&priv->ctrl_dst)) {
 			/*
 			 * Wait a second before closing the control socket if
@@ -506,13 +586,287 @@ void wpa_supplicant_ctrl_iface_deinit(struct ctrl_iface_priv *priv)
 	}
 
 free_dst:
+	eloop_cancel_timeout(wpa_supplicant_ctrl_iface_flush, priv, NULL);
 	dl_list_for_each_safe(dst, prev, &priv->ctrl_dst, struct wpa_ctrl_dst,
 			      list)
-		os_free(dst);
+		wpa_supplicant_ctrl_iface_free_dst(dst);
 	os_free(priv);
 }
 
 
+static void wpa_supplicant_ctrl_iface_schedule(struct ctrl_iface_priv *priv,
+					       int retry)
+{
+	if (priv->flush == CTRL_FLUSH_NOW ||
+	    (retry && priv->flush == CTRL_FLUSH_RETRY))
+		return;
+	eloop_cancel_timeout(wpa_supplicant_ctrl_iface_flush, priv, NULL);
+	eloop_register_timeout(0, retry ? CTRL_IFACE_RETRY_USEC : 0,
+			       wpa_supplicant_ctrl_iface_flush, priv, NULL);
+	priv->flush = retry ? CTRL_FLUSH_RETRY : CTRL_FLUSH_NOW;
+}
+
+
+/*
+ * Check whether the monitors have so much unread data in the socket send
+ * buffer that no more events should be sent for now.
+ */
+static int wpa_supplicant_ctrl_iface_congested(struct ctrl_iface_priv *priv)
+{
+#ifdef SIOCOUTQ
+	int outq;
+
+	if (priv->sndbuf <= 0 || ioctl(priv->sock, SIOCOUTQ, &outq) < 0)
+		return 0;
+	return outq > priv->sndbuf / CTRL_IFACE_MONITOR_SNDBUF_SHARE;
+#else /* SIOCOUTQ */
+	return 0;
+#endif /* SIOCOUTQ */
+}
+
+
+/*
+ * Returns 0 if the message was sent, 1 if the monitor did not accept it
+ * (socket buffer full), -1 if sending failed, or -2 if the monitor was
+ * detached.
+ */
+static int wpa_supplicant_ctrl_iface_sendmsg(struct ctrl_iface_priv *priv,
+					     struct wpa_ctrl_dst *dst,
+					     struct msghdr *msg, int idx)
+{
+	int _errno;
+
+	msg->msg_name = (void *) &dst->addr;
+	msg->msg_namelen = dst->addrlen;
+	if (sendmsg(priv->sock, msg, MSG_DONTWAIT) >= 0) {
+		dst->errors = 0;
+		dst->datagrams++;
+		return 0;
+	}
+
+	_errno = errno;
+	if (_errno == EAGAIN || _errno == EWOULDBLOCK || _errno == ENOBUFS)
+		return 1;
+
+	wpa_printf(MSG_INFO, "CTRL_IFACE monitor[%d]: %d - %s",
+		   idx, _errno, strerror(_errno));
+	dst->send_errors++;
+	dst->errors++;
+	if (dst->errors > 10 || _errno == ENOENT) {
+		wpa_supplicant_ctrl_iface_detach(priv, &dst->addr,
+						 dst->addrlen);
+		return -2;
+	}
+	return -1;
+}
+
+
+static int ctrl_iface_event_is(const struct ctrl_iface_msg *msg,
+			       const char *event, const char **rest,
+			       size_t *rest_len)
+{
+	const char *txt = (const char *) (msg + 1) + msg->txt;
+	size_t len = os_strlen(event);
+
+	if (msg->len - msg->txt < len || os_memcmp(txt, event, len) != 0)
+		return 0;
+	*rest = txt + len;
+	*rest_len = msg->len - msg->txt - len;
+	return 1;
+}
+
+
+/*
+ * Check whether a new event can be combined with the ones that are already
+ * queued for the monitor. Returns 1 if the new event is not needed.
+ */
+static int wpa_supplicant_ctrl_iface_coalesce(struct wpa_ctrl_dst *dst,
+					      const struct ctrl_iface_msg *new)
+{
+	struct ctrl_iface_msg *msg;
+	const char *rest, *new_rest;
+	size_t rest_len, new_rest_len;
+
+	if (ctrl_iface_event_is(new, WPA_EVENT_SCAN_RESULTS, &new_rest,
+				&new_rest_len)) {
+		/* Monitor fetches the results once for all pending events */
+		dl_list_for_each(msg, &dst->queue, struct ctrl_iface_msg,
+				 list) {
+			if (msg->len == new->len &&
+			    os_memcmp(msg + 1, new + 1, msg->len) == 0)
+				return 1;
+		}
+		return 0;
+	}
+
+	if (ctrl_iface_event_is(new, WPA_EVENT_BSS_REMOVED, &new_rest,
+				&new_rest_len)) {
+		/* BSS that was added and removed without being reported */
+		dl_list_for_each(msg, &dst->queue, struct ctrl_iface_msg,
+				 list) {
+			if (ctrl_iface_event_is(msg, WPA_EVENT_BSS_ADDED,
+						&rest, &rest_len) &&
+			    rest_len == new_rest_len &&
+			    os_memcmp(rest, new_rest, rest_len) == 0) {
+				dl_list_del(&msg->list);
+				dst->queued--;
+				dst->queued_bytes -= msg->len;
+				dst->coalesced++;
+				os_free(msg);
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+
+static void wpa_supplicant_ctrl_iface_queue(struct ctrl_iface_priv *priv,
+					    struct wpa_ctrl_dst *dst,
+					    const char *levelstr,
+					    const char *buf, size_t len,
+					    int idx)
+{
+	struct ctrl_iface_msg *msg;
+	size_t prefix = os_strlen(levelstr);
+
+	if (dst->queued >= CTRL_IFACE_MAX_QUEUED ||
+	    dst->queued_bytes + prefix + len > CTRL_IFACE_MAX_QUEUED_BYTES) {
+		if (!dst->overflow)
+			wpa_printf(MSG_DEBUG, "CTRL_IFACE monitor[%d]: Event "
+				   "queue full - dropping events", idx);
+		dst->overflow = 1;
+		dst->dropped++;
+		return;
+	}
+
+	msg = os_malloc(sizeof(*msg) + prefix + len);
+	if (msg == NULL) {
+		dst->dropped++;
+		return;
+	}
+	msg->len = prefix + len;
+	msg->txt = prefix;
+	os_memcpy(msg + 1, levelstr, prefix);
+	os_memcpy((char *) (msg + 1) + prefix, buf, len);
+
+	if (wpa_supplicant_ctrl_iface_coalesce(dst, msg)) {
+		dst->coalesced++;
+		os_free(msg);
+		return;
+	}
+
+	dl_list_add_tail(&dst->queue, &msg->list);
+	dst->queued++;
+	dst->queued_bytes += msg->len;
+}
+
+
+/*
+ * Send the first queued events to a monitor in a single datagram. Returns 1 if
+ * the events were removed from the queue, 0 if they could not be sent now, or
+ * -1 if the monitor was detached.
+ */
+static int wpa_supplicant_ctrl_iface_flush_dst(struct ctrl_iface_priv *priv,
+					       struct wpa_ctrl_dst *dst,
+					       int idx)
+{
+	struct ctrl_iface_msg *msg, *first;
+	struct iovec io[2 * CTRL_IFACE_MAX_BATCH_EVENTS];
+	struct msghdr mh;
+	size_t total;
+	int count, res, i;
+
+	if (dl_list_empty(&dst->queue) ||
+	    wpa_supplicant_ctrl_iface_congested(priv))
+		return 0;
+
+	first = dl_list_first(&dst->queue, struct ctrl_iface_msg, list);
+	count = 0;
+	total = 0;
+	dl_list_for_each(msg, &dst->queue, struct ctrl_iface_msg, list) {
+		if (count > 0 &&
+		    (!dst->batch || count == CTRL_IFACE_MAX_BATCH_EVENTS ||
+		     total + 1 + msg->len > WPA_CTRL_BATCH_MAX))
+			break;
+		if (count > 0) {
+			io[2 * count - 1].iov_base = "\n";
+			io[2 * count - 1].iov_len = 1;
+			total++;
+		}
+		io[2 * count].iov_base = msg + 1;
+		io[2 * count].iov_len = msg->len;
+		total += msg->len;
+		count++;
+	}
+
+	os_memset(&mh, 0, sizeof(mh));
+	mh.msg_iov = io;
+	mh.msg_iovlen = 2 * count - 1;
+	res = wpa_supplicant_ctrl_iface_sendmsg(priv, dst, &mh, idx);
+	if (res == 1)
+		return 0;
+	if (res == -2)
+		return -1;
+
+	for (i = 0; i < count; i++) {
+		msg = first;
+		first = dl_list_entry(msg->list.next, struct ctrl_iface_msg,
+				      list);
+		dl_list_del(&msg->list);
+		dst->queued--;
+		dst->queued_bytes -= msg->len;
+		if (res == 0)
+			dst->sent++;
+		else
+			dst->dropped++;
+		os_free(msg);
+	}
+	if (dl_list_empty(&dst->queue))
+		dst->overflow = 0;
+	return 1;
+}
+
+
+static void wpa_supplicant_ctrl_iface_flush(void *eloop_ctx,
+					    void *timeout_ctx)
+{
+	struct ctrl_iface_priv *priv = eloop_ctx;
+	struct wpa_ctrl_dst *dst, *next;
+	int idx, progress;
+
+	priv->flush = CTRL_FLUSH_NONE;
+	eloop_cancel_timeout(wpa_supplicant_ctrl_iface_flush, priv, NULL);
+	if (priv->sock < 0)
+		return;
+
+	/*
+	 * Send one datagram to each monitor in turn so that a monitor that
+	 * does not read its socket cannot use all of the send buffer space
+	 * that becomes available.
+	 */
+	do {
+		progress = 0;
+		idx = 0;
+		dl_list_for_each_safe(dst, next, &priv->ctrl_dst,
+				      struct wpa_ctrl_dst, list) {
+			if (wpa_supplicant_ctrl_iface_flush_dst(priv, dst,
+								idx) > 0)
+				progress = 1;
+			idx++;
+		}
+	} while (progress);
+
+	dl_list_for_each(dst, &priv->ctrl_dst, struct wpa_ctrl_dst, list) {
+		if (!dl_list_empty(&dst->queue)) {
+			wpa_supplicant_ctrl_iface_schedule(priv, 1);
+			break;
+		}
+	}
+}
+
+
 /**
  * wpa_supplicant_ctrl_iface_send - Send a control interface packet to monitors
  * @priv: Pointer to private data from wpa_supplicant_ctrl_iface_init()
@@ -521,6 +875,10 @@ free_dst:
  * @len: Message length
  *
  * Send a packet to all monitor programs attached to the control interface.
+ * Monitors that use batched delivery and monitors that have not received the
+ * earlier events get the event queued and delivered from an eloop timeout.
+ * Events are queued for all monitors while the data that the monitors have
+ * not yet read uses a large part of the socket send buffer.
  */
 static void wpa_supplicant_ctrl_iface_send(struct ctrl_iface_priv *priv,
 					   int level, const char *buf,
@@ -531,6 +889,7 @@ static void wpa_supplicant_ctrl_iface_send(struct ctrl_iface_priv *priv,
 	int idx, res;
 	struct msghdr msg;
 	struct iovec io[2];
+	int congested = -1;
 
 	if (priv->sock < 0 || dl_list_empty(&priv->ctrl_dst))
 		return;
@@ -553,29 +912,79 @@ static void wpa_supplicant_ctrl_iface_send(struct ctrl_iface_priv *priv,
 			wpa_hexdump(MSG_DEBUG, "CTRL_IFACE monitor send",
 				    (u8 *) dst->addr.sun_path, dst->addrlen -
 				    offsetof(struct sockaddr_un, sun_path));
-			msg.msg_name = (void *) &dst->addr;
-			msg.msg_namelen = dst->addrlen;
-			if (sendmsg(priv->sock, &msg, 0) < 0) {
-				int _errno = errno;
-				wpa_printf(MSG_INFO, "CTRL_IFACE monitor[%d]: "
-					   "%d - %s",
-					   idx, errno, strerror(errno));
-				dst->errors++;
-				if (dst->errors > 1000 ||
-				    (_errno != ENOBUFS && dst->errors > 10) ||
-				    _errno == ENOENT) {
-					wpa_supplicant_ctrl_iface_detach(
-						priv, &dst->addr,
-						dst->addrlen);
+			if (!dst->batch && dl_list_empty(&dst->queue) &&
+			    congested < 0)
+				congested = wpa_supplicant_ctrl_iface_congested(
+					priv);
+			if (!dst->batch && dl_list_empty(&dst->queue) &&
+			    !congested) {
+				res = wpa_supplicant_ctrl_iface_sendmsg(
+					priv, dst, &msg, idx);
+				if (res == 0)
+					dst->sent++;
+				else if (res == -1)
+					dst->dropped++;
+				if (res != 1) {
+					idx++;
+					continue;
 				}
-			} else
-				dst->errors = 0;
+			}
+			wpa_supplicant_ctrl_iface_queue(priv, dst, levelstr,
+							buf, len, idx);
+			wpa_supplicant_ctrl_iface_schedule(
+				priv, !dst->batch || dst->queued > 1);
 		}
 		idx++;
 	}
 }
 
 
+static char * wpa_supplicant_ctrl_iface_monitor_stats(
+	struct ctrl_iface_priv *priv, size_t *resp_len)
+{
+	struct wpa_ctrl_dst *dst;
+	char *buf, *pos, *end;
+	int idx = 0, ret;
+	size_t i, plen;
+	const char *path;
+
+	buf = os_malloc(4096);
+	if (buf == NULL)
+		return NULL;
+	pos = buf;
+	end = buf + 4096;
+
+	dl_list_for_each(dst, &priv->ctrl_dst, struct wpa_ctrl_dst, list) {
+		ret = os_snprintf(pos, end - pos, "%d ", idx++);
+		if (ret < 0 || ret >= end - pos)
+			break;
+		pos += ret;
+		/* Abstract socket names start with a null character */
+		path = dst->addr.sun_path;
+		plen = dst->addrlen - offsetof(struct sockaddr_un, sun_path);
+		for (i = 0; i < plen && end - pos > 1; i++) {
+			if (path[i] == '\0' && i > 0)
+				break;
+			*pos++ = (path[i] >= 32 && path[i] < 127 &&
+				  path[i] != ' ') ? path[i] : '@';
+		}
+		ret = os_snprintf(pos, end - pos,
+				  " level=%d batch=%d queued=%u sent=%u "
+				  "datagrams=%u coalesced=%u dropped=%u "
+				  "errors=%u\n",
+				  dst->debug_level, dst->batch, dst->queued,
+				  dst->sent, dst->datagrams, dst->coalesced,
+				  dst->dropped, dst->send_errors);
+		if (ret < 0 || ret >= end - pos)
+			break;
+		pos += ret;
+	}
+
+	*resp_len = pos - buf;
+	return buf;
+}
+
+
 void wpa_supplicant_ctrl_iface_wait(struct ctrl_iface_priv *priv)
 {
 	char buf[256];
@@ -599,7 +1008,7 @@ void wpa_supplicant_ctrl_iface_wait(struct ctrl_iface_priv *priv)
 		if (os_strcmp(buf, "ATTACH") == 0) {
 			/* handle ATTACH signal of first monitor interface */
 			if (!wpa_supplicant_ctrl_iface_attach(priv, &from,
-							      fromlen)) {
+							      fromlen, 0)) {
 				sendto(priv->sock, "OK\n", 3, 0,
 				       (struct sockaddr *) &from, fromlen);
 				/* OK to continue */
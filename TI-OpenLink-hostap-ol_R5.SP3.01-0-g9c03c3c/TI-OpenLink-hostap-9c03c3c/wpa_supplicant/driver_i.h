@@ -103,6 +103,16 @@ static inline struct wpa_scan_results * wpa_drv_get_scan_results2(
 	return NULL;
 }
 
+static inline int wpa_drv_get_scan_results_cb(
+	struct wpa_supplicant *wpa_s,
+	void (*cb)(void *ctx, struct wpa_scan_res *res), void *ctx)
+{
+	if (wpa_s->driver->get_scan_results_cb)
+		return wpa_s->driver->get_scan_results_cb(wpa_s->drv_priv,
+							  cb, ctx);
+	return -1;
+}
+
 static inline int wpa_drv_get_bssid(struct wpa_supplicant *wpa_s, u8 *bssid)
 {
 	if (wpa_s->driver->get_bssid) {
@@ -73,6 +73,10 @@ static void usage(void)
 	       "  -p = driver parameters\n"
 	       "  -P = PID file\n"
 	       "  -q = decrease debugging verbosity (-qq even less)\n");
+#ifdef CONFIG_DEBUG_RING
+	printf("  -r = buffer debug messages in a ring buffer of the given "
+	       "size (kB)\n");
+#endif /* CONFIG_DEBUG_RING */
 #ifdef CONFIG_DBUS
 	printf("  -u = enable DBus control interface\n");
 #endif /* CONFIG_DBUS */
@@ -144,7 +148,7 @@ int main(int argc, char *argv[])
 
 	for (;;) {
 		c = getopt(argc, argv,
-			   "b:Bc:C:D:de:f:g:hi:KLNo:O:p:P:qsTtuvW");
+			   "b:Bc:C:D:de:f:g:hi:KLNo:O:p:P:qr:sTtuvW");
 		if (c < 0)
 			break;
 		switch (c) {
@@ -214,6 +218,11 @@ int main(int argc, char *argv[])
 		case 'q':
 			params.wpa_debug_level++;
 			break;
+#ifdef CONFIG_DEBUG_RING
+		case 'r':
+			params.wpa_debug_ring_size = atoi(optarg);
+			break;
+#endif /* CONFIG_DEBUG_RING */
 #ifdef CONFIG_DEBUG_SYSLOG
 		case 's':
 			params.wpa_debug_syslog++;
@@ -378,7 +378,7 @@ void wpas_notify_suspend(struct wpa_global *global)
 {
 	struct wpa_supplicant *wpa_s;
 
-	os_get_time(&global->suspend_time);
+	os_get_reltime(&global->suspend_time);
 	wpa_printf(MSG_DEBUG, "System suspend notification");
 	for (wpa_s = global->ifaces; wpa_s; wpa_s = wpa_s->next)
 		wpa_drv_suspend(wpa_s);
@@ -387,14 +387,14 @@ void wpas_notify_suspend(struct wpa_global *global)
 
 void wpas_notify_resume(struct wpa_global *global)
 {
-	struct os_time now;
+	struct os_reltime now;
 	int slept;
 	struct wpa_supplicant *wpa_s;
 
 	if (global->suspend_time.sec == 0)
 		slept = -1;
 	else {
-		os_get_time(&now);
+		os_get_reltime(&now);
 		slept = now.sec - global->suspend_time.sec;
 	}
 	wpa_printf(MSG_DEBUG, "System resume notification (slept %d seconds)",
@@ -1059,28 +1059,6 @@ void wpa_supplicant_notify_scanning(struct wpa_supplicant *wpa_s,
 }
 
 
-static int wpa_scan_get_max_rate(const struct wpa_scan_res *res)
-{
-	int rate = 0;
-	const u8 *ie;
-	int i;
-
-	ie = wpa_scan_get_ie(res, WLAN_EID_SUPP_RATES);
-	for (i = 0; ie && i < ie[1]; i++) {
-		if ((ie[i + 2] & 0x7f) > rate)
-			rate = ie[i + 2] & 0x7f;
-	}
-
-	ie = wpa_scan_get_ie(res, WLAN_EID_EXT_SUPP_RATES);
-	for (i = 0; ie && i < ie[1]; i++) {
-		if ((ie[i + 2] & 0x7f) > rate)
-			rate = ie[i + 2] & 0x7f;
-	}
-
-	return rate;
-}
-
-
 const u8 * wpa_scan_get_ie(const struct wpa_scan_res *res, u8 ie)
 {
 	const u8 *end, *pos;
@@ -1196,24 +1174,24 @@ struct wpabuf * wpa_scan_get_vendor_ie_multi_beacon(
  */
 #define GREAT_SNR 30
 
-/* Compare function for sorting scan results. Return >0 if @b is considered
- * better. */
+/* Compare function for sorting the BSSes from a scan. Return >0 if @b is
+ * considered better. */
 static int wpa_scan_result_compar(const void *a, const void *b)
 {
 #define IS_5GHZ(n) (n > 4000)
 #define MIN(a,b) a < b ? a : b
-	struct wpa_scan_res **_wa = (void *) a;
-	struct wpa_scan_res **_wb = (void *) b;
-	struct wpa_scan_res *wa = *_wa;
-	struct wpa_scan_res *wb = *_wb;
+	struct wpa_bss **_wa = (void *) a;
+	struct wpa_bss **_wb = (void *) b;
+	struct wpa_bss *wa = *_wa;
+	struct wpa_bss *wb = *_wb;
 	int wpa_a, wpa_b, maxrate_a, maxrate_b;
 	int snr_a, snr_b;
 
 	/* WPA/WPA2 support preferred */
-	wpa_a = wpa_scan_get_vendor_ie(wa, WPA_IE_VENDOR_TYPE) != NULL ||
-		wpa_scan_get_ie(wa, WLAN_EID_RSN) != NULL;
-	wpa_b = wpa_scan_get_vendor_ie(wb, WPA_IE_VENDOR_TYPE) != NULL ||
-		wpa_scan_get_ie(wb, WLAN_EID_RSN) != NULL;
+	wpa_a = wpa_bss_get_vendor_ie(wa, WPA_IE_VENDOR_TYPE) != NULL ||
+		wpa_bss_get_ie(wa, WLAN_EID_RSN) != NULL;
+	wpa_b = wpa_bss_get_vendor_ie(wb, WPA_IE_VENDOR_TYPE) != NULL ||
+		wpa_bss_get_ie(wb, WLAN_EID_RSN) != NULL;
 
 	if (wpa_b && !wpa_a)
 		return 1;
@@ -1228,8 +1206,8 @@ static int wpa_scan_result_compar(const void *a, const void *b)
 	    (wb->caps & IEEE80211_CAP_PRIVACY) == 0)
 		return -1;
 
-	if ((wa->flags & wb->flags & WPA_SCAN_LEVEL_DBM) &&
-	    !((wa->flags | wb->flags) & WPA_SCAN_NOISE_INVALID)) {
+	if ((wa->flags & wb->flags & WPA_BSS_LEVEL_DBM) &&
+	    !((wa->flags | wb->flags) & WPA_BSS_NOISE_INVALID)) {
 		snr_a = MIN(wa->level - wa->noise, GREAT_SNR);
 		snr_b = MIN(wb->level - wb->noise, GREAT_SNR);
 	} else {
@@ -1241,8 +1219,8 @@ static int wpa_scan_result_compar(const void *a, const void *b)
 	/* best/max rate preferred if SNR close enough */
         if ((snr_a && snr_b && abs(snr_b - snr_a) < 5) ||
 	    (wa->qual && wb->qual && abs(wb->qual - wa->qual) < 10)) {
-		maxrate_a = wpa_scan_get_max_rate(wa);
-		maxrate_b = wpa_scan_get_max_rate(wb);
+		maxrate_a = wpa_bss_get_max_rate(wa);
+		maxrate_b = wpa_bss_get_max_rate(wb);
 		if (maxrate_a != maxrate_b)
 			return maxrate_b - maxrate_a;
 		if (IS_5GHZ(wa->freq) ^ IS_5GHZ(wb->freq))
@@ -1263,30 +1241,30 @@ static int wpa_scan_result_compar(const void *a, const void *b)
 
 
 #ifdef CONFIG_WPS
-/* Compare function for sorting scan results when searching a WPS AP for
- * provisioning. Return >0 if @b is considered better. */
+/* Compare function for sorting the BSSes from a scan when searching a WPS AP
+ * for provisioning. Return >0 if @b is considered better. */
 static int wpa_scan_result_wps_compar(const void *a, const void *b)
 {
-	struct wpa_scan_res **_wa = (void *) a;
-	struct wpa_scan_res **_wb = (void *) b;
-	struct wpa_scan_res *wa = *_wa;
-	struct wpa_scan_res *wb = *_wb;
+	struct wpa_bss **_wa = (void *) a;
+	struct wpa_bss **_wb = (void *) b;
+	struct wpa_bss *wa = *_wa;
+	struct wpa_bss *wb = *_wb;
 	int uses_wps_a, uses_wps_b;
 	struct wpabuf *wps_a, *wps_b;
 	int res;
 
 	/* Optimization - check WPS IE existence before allocated memory and
 	 * doing full reassembly. */
-	uses_wps_a = wpa_scan_get_vendor_ie(wa, WPS_IE_VENDOR_TYPE) != NULL;
-	uses_wps_b = wpa_scan_get_vendor_ie(wb, WPS_IE_VENDOR_TYPE) != NULL;
+	uses_wps_a = wpa_bss_get_vendor_ie(wa, WPS_IE_VENDOR_TYPE) != NULL;
+	uses_wps_b = wpa_bss_get_vendor_ie(wb, WPS_IE_VENDOR_TYPE) != NULL;
 	if (uses_wps_a && !uses_wps_b)
 		return -1;
 	if (!uses_wps_a && uses_wps_b)
 		return 1;
 
 	if (uses_wps_a && uses_wps_b) {
-		wps_a = wpa_scan_get_vendor_ie_multi(wa, WPS_IE_VENDOR_TYPE);
-		wps_b = wpa_scan_get_vendor_ie_multi(wb, WPS_IE_VENDOR_TYPE);
+		wps_a = wpa_bss_get_vendor_ie_multi(wa, WPS_IE_VENDOR_TYPE);
+		wps_b = wpa_bss_get_vendor_ie_multi(wb, WPS_IE_VENDOR_TYPE);
 		res = wps_ap_priority_compar(wps_a, wps_b);
 		wpabuf_free(wps_a);
 		wpabuf_free(wps_b);
@@ -1310,21 +1288,21 @@ static int wpa_scan_result_wps_compar(const void *a, const void *b)
 #endif /* CONFIG_WPS */
 
 
-static void dump_scan_res(struct wpa_scan_results *scan_res)
+static void dump_scan_res(struct wpa_supplicant *wpa_s)
 {
 #ifndef CONFIG_NO_STDOUT_DEBUG
-	size_t i;
+	unsigned int i;
 
-	if (scan_res->res == NULL || scan_res->num == 0)
+	if (wpa_s->last_scan_res_used == 0)
 		return;
 
 	wpa_printf(MSG_EXCESSIVE, "Sorted scan results");
 
-	for (i = 0; i < scan_res->num; i++) {
-		struct wpa_scan_res *r = scan_res->res[i];
+	for (i = 0; i < wpa_s->last_scan_res_used; i++) {
+		struct wpa_bss *r = wpa_s->last_scan_res[i];
 		u8 *pos;
-		if ((r->flags & (WPA_SCAN_LEVEL_DBM | WPA_SCAN_NOISE_INVALID))
-		    == WPA_SCAN_LEVEL_DBM) {
+		if ((r->flags & (WPA_BSS_LEVEL_DBM | WPA_BSS_NOISE_INVALID))
+		    == WPA_BSS_LEVEL_DBM) {
 			int snr = r->level - r->noise;
 			wpa_printf(MSG_EXCESSIVE, MACSTR " freq=%d qual=%d "
 				   "noise=%d level=%d snr=%d%s flags=0x%x",
@@ -1393,6 +1371,24 @@ static void filter_scan_res(struct wpa_supplicant *wpa_s,
 }
 
 
+static void wpa_supplicant_sort_scan_res(struct wpa_supplicant *wpa_s)
+{
+	int (*compar)(const void *, const void *) = wpa_scan_result_compar;
+
+#ifdef CONFIG_WPS
+	if (wpas_wps_in_progress(wpa_s)) {
+		wpa_dbg(wpa_s, MSG_DEBUG, "WPS: Order scan results with WPS "
+			"provisioning rules");
+		compar = wpa_scan_result_wps_compar;
+	}
+#endif /* CONFIG_WPS */
+
+	qsort(wpa_s->last_scan_res, wpa_s->last_scan_res_used,
+	      sizeof(struct wpa_bss *), compar);
+	dump_scan_res(wpa_s);
+}
+
+
 /**
  * wpa_supplicant_get_scan_results - Get scan results
  * @wpa_s: Pointer to wpa_supplicant data
@@ -1401,8 +1397,11 @@ static void filter_scan_res(struct wpa_supplicant *wpa_s,
  * Returns: Scan results, %NULL on failure
  *
  * This function request the current scan results from the driver and updates
- * the local BSS list wpa_s->bss. The caller is responsible for freeing the
- * results with wpa_scan_results_free().
+ * the local BSS list wpa_s->bss. The BSSes from the scan are listed in
+ * wpa_s->last_scan_res in order of preference. The caller is responsible for
+ * freeing the results with wpa_scan_results_free(). Use
+ * wpa_supplicant_get_scan_bss() if the results are only needed in the BSS
+ * table.
  */
 struct wpa_scan_results *
 wpa_supplicant_get_scan_results(struct wpa_supplicant *wpa_s,
@@ -1410,7 +1409,6 @@ wpa_supplicant_get_scan_results(struct wpa_supplicant *wpa_s,
 {
 	struct wpa_scan_results *scan_res;
 	size_t i;
-	int (*compar)(const void *, const void *) = wpa_scan_result_compar;
 
 	scan_res = wpa_drv_get_scan_results2(wpa_s);
 	if (scan_res == NULL) {
@@ -1419,30 +1417,99 @@ wpa_supplicant_get_scan_results(struct wpa_supplicant *wpa_s,
 	}
 	filter_scan_res(wpa_s, scan_res);
 
-#ifdef CONFIG_WPS
-	if (wpas_wps_in_progress(wpa_s)) {
-		wpa_dbg(wpa_s, MSG_DEBUG, "WPS: Order scan results with WPS "
-			"provisioning rules");
-		compar = wpa_scan_result_wps_compar;
-	}
-#endif /* CONFIG_WPS */
-
-	qsort(scan_res->res, scan_res->num, sizeof(struct wpa_scan_res *),
-	      compar);
-	dump_scan_res(scan_res);
-
 	wpa_bss_update_start(wpa_s);
 	for (i = 0; i < scan_res->num; i++)
 		wpa_bss_update_scan_res(wpa_s, scan_res->res[i]);
 	wpa_bss_update_end(wpa_s, info, new_scan);
+	wpa_supplicant_sort_scan_res(wpa_s);
 
 	return scan_res;
 }
 
 
+static void wpa_supplicant_update_scan_res_cb(void *ctx,
+					      struct wpa_scan_res *res)
+{
+	struct wpa_supplicant *wpa_s = ctx;
+
+	if (!wpa_supplicant_filter_bssid_match(wpa_s, res->bssid))
+		return;
+	wpa_bss_update_scan_res(wpa_s, res);
+}
+
+
+static int wpa_supplicant_stream_scan_results(struct wpa_supplicant *wpa_s,
+					      struct scan_info *info,
+					      int new_scan)
+{
+	int num;
+
+	/*
+	 * Let the driver pass each BSS directly to the BSS table instead of
+	 * building the full scan result array.
+	 */
+	wpa_bss_update_start(wpa_s);
+	num = wpa_drv_get_scan_results_cb(
+		wpa_s, wpa_supplicant_update_scan_res_cb, wpa_s);
+	if (num < 0) {
+		wpa_dbg(wpa_s, MSG_DEBUG, "Failed to get scan results");
+		/* Do not expire entries based on a partial update */
+		wpa_bss_update_end(wpa_s, info, 0);
+		return -1;
+	}
+	wpa_bss_update_end(wpa_s, info, new_scan);
+
+	return 0;
+}
+
+
+/**
+ * wpa_supplicant_get_scan_bss - Update the BSS table from scan results
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @info: Information about what was scanned or %NULL if not available
+ * @new_scan: Whether a new scan was performed
+ * Returns: 0 on success, -1 on failure
+ *
+ * This function is like wpa_supplicant_get_scan_results(), but the results
+ * are only stored in the BSS table. If the driver supports it, each BSS is
+ * passed to the BSS table as it is received without building the full scan
+ * result array. The BSSes from the scan are listed in wpa_s->last_scan_res in
+ * order of preference.
+ */
+int wpa_supplicant_get_scan_bss(struct wpa_supplicant *wpa_s,
+				struct scan_info *info, int new_scan)
+{
+	struct wpa_scan_results *scan_res;
+
+	if (wpa_s->driver->get_scan_results_cb) {
+		if (wpa_supplicant_stream_scan_results(wpa_s, info, new_scan) <
+		    0)
+			return -1;
+		wpa_supplicant_sort_scan_res(wpa_s);
+		return 0;
+	}
+
+	scan_res = wpa_supplicant_get_scan_results(wpa_s, info, new_scan);
+	if (scan_res == NULL)
+		return -1;
+	wpa_scan_results_free(scan_res);
+
+	return 0;
+}
+
+
 int wpa_supplicant_update_scan_results(struct wpa_supplicant *wpa_s)
 {
 	struct wpa_scan_results *scan_res;
+
+	if (wpa_s->driver->get_scan_results_cb) {
+		/*
+		 * Only the BSS table is updated here, so the BSSes do not need
+		 * to be sorted for network selection.
+		 */
+		return wpa_supplicant_stream_scan_results(wpa_s, NULL, 0);
+	}
+
 	scan_res = wpa_supplicant_get_scan_results(wpa_s, NULL, 0);
 	if (scan_res == NULL)
 		return -1;
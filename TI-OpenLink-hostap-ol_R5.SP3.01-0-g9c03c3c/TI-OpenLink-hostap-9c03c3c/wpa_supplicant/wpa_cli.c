@@ -299,6 +299,32 @@ static int wpa_cli_show_event(const char *event)
 }
 
 
+static int wpa_cli_attach(struct wpa_ctrl *ctrl)
+{
+	/* Batched delivery is not supported by older wpa_supplicant versions */
+	if (wpa_ctrl_attach_batch(ctrl) == 0)
+		return 0;
+	return wpa_ctrl_attach(ctrl);
+}
+
+
+/* Get the next event from a message that may contain batched events */
+static char * wpa_cli_next_event(char **pos)
+{
+	char *msg = *pos, *end;
+
+	if (msg == NULL || *msg == '\0')
+		return NULL;
+	end = os_strstr(msg, "\n<");
+	if (end) {
+		*end = '\0';
+		*pos = end + 1;
+	} else
+		*pos = NULL;
+	return msg;
+}
+
+
 static int wpa_cli_open_connection(const char *ifname, int attach)
 {
 #if defined(CONFIG_CTRL_IFACE_UDP) || defined(CONFIG_CTRL_IFACE_NAMED_PIPE)
@@ -352,7 +378,7 @@ static int wpa_cli_open_connection(const char *ifname, int attach)
 #endif /* CONFIG_CTRL_IFACE_UDP || CONFIG_CTRL_IFACE_NAMED_PIPE */
 
 	if (mon_conn) {
-		if (wpa_ctrl_attach(mon_conn) == 0) {
+		if (wpa_cli_attach(mon_conn) == 0) {
 			wpa_cli_attached = 1;
 			if (interactive)
 				eloop_register_read_sock(
@@ -452,6 +478,20 @@ static int wpa_cli_cmd_relog(struct wpa_ctrl *ctrl, int argc, char *argv[])
 }
 
 
+static int wpa_cli_cmd_debug_dump(struct wpa_ctrl *ctrl, int argc,
+				  char *argv[])
+{
+	return wpa_ctrl_command(ctrl, "DEBUG_DUMP");
+}
+
+
+static int wpa_cli_cmd_monitor_stats(struct wpa_ctrl *ctrl, int argc,
+				     char *argv[])
+{
+	return wpa_ctrl_command(ctrl, "MONITOR_STATS");
+}
+
+
 static int wpa_cli_cmd_note(struct wpa_ctrl *ctrl, int argc, char *argv[])
 {
 	char cmd[256];
@@ -3002,6 +3042,12 @@ static struct wpa_cli_cmd wpa_cli_commands[] = {
 	{ "relog", wpa_cli_cmd_relog,
 	  cli_cmd_flag_none,
 	  "= re-open log-file (allow rolling logs)" },
+	{ "debug_dump", wpa_cli_cmd_debug_dump,
+	  cli_cmd_flag_none,
+	  "= write buffered debug messages to the debug log" },
+	{ "monitor_stats", wpa_cli_cmd_monitor_stats,
+	  cli_cmd_flag_none,
+	  "= show event delivery statistics for attached monitors" },
 	{ "note", wpa_cli_cmd_note,
 	  cli_cmd_flag_none,
 	  "<text> = add a note to wpa_supplicant debug log" },
@@ -3664,7 +3710,10 @@ static void wpa_cli_action_process(const char *msg)
 #ifndef CONFIG_ANSI_C_EXTRA
 static void wpa_cli_action_cb(char *msg, size_t len)
 {
-	wpa_cli_action_process(msg);
+	char *pos = msg;
+
+	while ((msg = wpa_cli_next_event(&pos)) != NULL)
+		wpa_cli_action_process(msg);
 }
 #endif /* CONFIG_ANSI_C_EXTRA */
 
@@ -3751,17 +3800,20 @@ static void wpa_cli_recv_pending(struct wpa_ctrl *ctrl, int action_monitor)
 		return;
 	}
 	while (wpa_ctrl_pending(ctrl) > 0) {
-		char buf[256];
+		char buf[WPA_CTRL_BATCH_MAX + 1], *pos, *msg;
 		size_t len = sizeof(buf) - 1;
 		if (wpa_ctrl_recv(ctrl, buf, &len) == 0) {
 			buf[len] = '\0';
-			if (action_monitor)
-				wpa_cli_action_process(buf);
-			else {
-				cli_event(buf);
-				if (wpa_cli_show_event(buf)) {
+			pos = buf;
+			while ((msg = wpa_cli_next_event(&pos)) != NULL) {
+				if (action_monitor) {
+					wpa_cli_action_process(msg);
+					continue;
+				}
+				cli_event(msg);
+				if (wpa_cli_show_event(msg)) {
 					edit_clear_line();
-					printf("\r%s\n", buf);
+					printf("\r%s\n", msg);
 					edit_redraw();
 				}
 			}
@@ -3892,7 +3944,8 @@ static void wpa_cli_action(struct wpa_ctrl *ctrl)
 	fd_set rfds;
 	int fd, res;
 	struct timeval tv;
-	char buf[256]; /* note: large enough to fit in unsolicited messages */
+	/* note: large enough to fit in unsolicited (batched) messages */
+	char buf[WPA_CTRL_BATCH_MAX + 1];
 	size_t len;
 
 	fd = wpa_ctrl_get_fd(ctrl);
@@ -4112,7 +4165,7 @@ int main(int argc, char *argv[])
 		}
 
 		if (action_file) {
-			if (wpa_ctrl_attach(ctrl_conn) == 0) {
+			if (wpa_cli_attach(ctrl_conn) == 0) {
 				wpa_cli_attached = 1;
 			} else {
 				printf("Warning: Failed to attach to "
@@ -555,14 +555,9 @@ void wpa_supplicant_start_bgscan(struct wpa_supplicant *wpa_s)
 			 * affected.
 			 */
 		} else {
-			struct wpa_scan_results *scan_res;
 			wpa_s->bgscan_ssid = wpa_s->current_ssid;
-			scan_res = wpa_supplicant_get_scan_results(wpa_s, NULL,
-								   0);
-			if (scan_res) {
-				bgscan_notify_scan(wpa_s, scan_res);
-				wpa_scan_results_free(scan_res);
-			}
+			if (wpa_supplicant_update_scan_results(wpa_s) == 0)
+				bgscan_notify_scan(wpa_s);
 		}
 	} else
 		wpa_s->bgscan_ssid = NULL;
@@ -2196,7 +2191,7 @@ void wpa_supplicant_rx_eapol(void *ctx, const u8 *src_addr,
 		wpabuf_free(wpa_s->pending_eapol_rx);
 		wpa_s->pending_eapol_rx = wpabuf_alloc_copy(buf, len);
 		if (wpa_s->pending_eapol_rx) {
-			os_get_time(&wpa_s->pending_eapol_rx_time);
+			os_get_reltime(&wpa_s->pending_eapol_rx_time);
 			os_memcpy(wpa_s->pending_eapol_rx_src, src_addr,
 				  ETH_ALEN);
 		}
@@ -3129,6 +3124,7 @@ struct wpa_global * wpa_supplicant_init(struct wpa_params *params)
 	global->params.daemonize = params->daemonize;
 	global->params.wait_for_monitor = params->wait_for_monitor;
 	global->params.dbus_ctrl_interface = params->dbus_ctrl_interface;
+	global->params.wpa_debug_ring_size = params->wpa_debug_ring_size;
 	if (params->pid_file)
 		global->params.pid_file = os_strdup(params->pid_file);
 	if (params->ctrl_interface)
@@ -3202,6 +3198,13 @@ int wpa_supplicant_run(struct wpa_global *global)
 	    wpa_supplicant_daemon(global->params.pid_file))
 		return -1;
 
+	/* The flusher thread is started only after the fork in os_daemonize() */
+	if (global->params.wpa_debug_ring_size > 0 &&
+	    wpa_debug_ring_init(global->params.wpa_debug_ring_size * 1024,
+				wpa_debug_level < MSG_DEBUG ?
+				wpa_debug_level : MSG_DEBUG) < 0)
+		wpa_printf(MSG_ERROR, "Could not enable debug ring buffer");
+
 	if (global->params.wait_for_monitor) {
 		for (wpa_s = global->ifaces; wpa_s; wpa_s = wpa_s->next)
 			if (wpa_s->ctrl_iface)
@@ -3271,6 +3274,7 @@ void wpa_supplicant_deinit(struct wpa_global *global)
 	os_free(global->p2p_disallow_freq);
 
 	os_free(global);
+	wpa_debug_ring_deinit();
 	wpa_debug_close_syslog();
 	wpa_debug_close_file();
 	wpa_debug_close_linux_tracing();
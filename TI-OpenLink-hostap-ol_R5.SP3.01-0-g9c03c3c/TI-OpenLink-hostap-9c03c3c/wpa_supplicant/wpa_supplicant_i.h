@@ -165,6 +165,14 @@ struct wpa_params {
 	 */
 	int wpa_debug_tracing;
 
+	/**
+	 * wpa_debug_ring_size - Size of debug ring buffer in kB
+	 *
+	 * If set, debug messages are recorded into a ring buffer and written
+	 * out by a separate thread. 0 = write debug messages directly.
+	 */
+	int wpa_debug_ring_size;
+
 	/**
 	 * override_driver - Optional driver parameter override
 	 *
@@ -223,7 +231,7 @@ struct wpa_global {
 	struct wpas_dbus_priv *dbus;
 	void **drv_priv;
 	size_t drv_count;
-	struct os_time suspend_time;
+	struct os_reltime suspend_time;
 	struct p2p_data *p2p;
 	struct wpa_supplicant *p2p_init_wpa_s;
 	struct wpa_supplicant *p2p_group_formation;
@@ -249,6 +257,8 @@ enum offchannel_send_action_result {
 	OFFCHANNEL_SEND_ACTION_FAILED /* Frame was not sent due to a failure */
 };
 
+#define WPA_BSS_HASH_SIZE 256
+
 /**
  * struct wpa_supplicant - Internal data for wpa_supplicant interface
  *
@@ -335,9 +345,19 @@ struct wpa_supplicant {
 				 struct wpa_scan_results *scan_res);
 	struct dl_list bss; /* struct wpa_bss::list */
 	struct dl_list bss_id; /* struct wpa_bss::list_id */
+	/* struct wpa_bss::hash_bssid; most recently updated entry first */
+	struct dl_list bss_hash[WPA_BSS_HASH_SIZE];
+	struct dl_list bss_id_hash[WPA_BSS_HASH_SIZE]; /* wpa_bss::hash_id */
 	size_t num_bss;
 	unsigned int bss_update_idx;
 	unsigned int bss_next_id;
+	/*
+	 * BSSes reported in the latest scan result update; sorted in order of
+	 * preference for network selection after a new scan
+	 */
+	struct wpa_bss **last_scan_res;
+	unsigned int last_scan_res_used;
+	unsigned int last_scan_res_size;
 
 	struct wpa_driver_ops *driver;
 	int interface_removed; /* whether the network interface has been
@@ -402,7 +422,7 @@ struct wpa_supplicant {
 	int blacklist_cleared;
 
 	struct wpabuf *pending_eapol_rx;
-	struct os_time pending_eapol_rx_time;
+	struct os_reltime pending_eapol_rx_time;
 	u8 pending_eapol_rx_src[ETH_ALEN];
 
 	struct ibss_rsn *ibss_rsn;
@@ -435,7 +455,7 @@ struct wpa_supplicant {
 		u8 *sa_query_trans_id; /* buffer of WLAN_SA_QUERY_TR_ID_LEN *
 					* sa_query_count octets of pending
 					* SA Query transaction identifiers */
-		struct os_time sa_query_start;
+		struct os_reltime sa_query_start;
 		u8 sched_obss_scan;
 		u16 obss_scan_int;
 		u16 bss_max_idle_period;
@@ -545,7 +565,7 @@ struct wpa_supplicant {
 	int p2p_persistent_id;
 	int p2p_go_intent;
 	int p2p_connect_freq;
-	struct os_time p2p_auto_started;
+	struct os_reltime p2p_auto_started;
 #endif /* CONFIG_P2P */
 
 	struct wpa_ssid *bgscan_ssid;